@@ -45,6 +45,29 @@ struct arch_specific_insn {
 	kprobe_insn_handler_t	*insn_handler;
 };
 
+/* optinsn template addresses */
+extern kprobe_opcode_t optprobe_template_entry;
+extern kprobe_opcode_t optprobe_template_val;
+extern kprobe_opcode_t optprobe_template_call;
+extern kprobe_opcode_t optprobe_template_end;
+
+/* An optimized probe replaces just the probed instruction with a branch */
+#define MAX_OPTIMIZED_LENGTH	sizeof(kprobe_opcode_t)
+#define MAX_OPTINSN_SIZE						\
+	(((unsigned long)&optprobe_template_end -			\
+	  (unsigned long)&optprobe_template_entry) / sizeof(kprobe_opcode_t))
+
+struct arch_optimized_insn {
+	/* detour code buffer */
+	kprobe_opcode_t *insn;
+};
+
+/* Return true (!0) if optinsn is prepared for optimization. */
+static inline int arch_prepared_optinsn(struct arch_optimized_insn *optinsn)
+{
+	return optinsn->insn != NULL;
+}
+
 struct prev_kprobe {
 	struct kprobe *kp;
 	unsigned int status;
@@ -82,7 +82,11 @@ static inline void check_context(struct mm_struct *mm)
 
 #endif
 
+#if defined(CONFIG_CPU_HAS_ASID) && !defined(CONFIG_SMP)
+void destroy_context(struct mm_struct *mm);
+#else
 #define destroy_context(mm)		do { } while(0)
+#endif
 
 /*
  * This is called when "tsk" is about to enter lazy TLB mode.
@@ -150,7 +154,7 @@ do { \
 		else \
 			mm->mmap = NULL; \
 		rb_erase(&high_vma->vm_rb, &mm->mm_rb); \
-		mm->mmap_cache = NULL; \
+		vmacache_invalidate(mm); \
 		mm->map_count--; \
 		remove_vma(high_vma); \
 	} \
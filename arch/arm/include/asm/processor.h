@@ -112,6 +112,20 @@ extern int kernel_thread(int (*fn)(void *), void *arg, unsigned long flags);
 #define KSTK_EIP(tsk)	task_pt_regs(tsk)->ARM_pc
 #define KSTK_ESP(tsk)	task_pt_regs(tsk)->ARM_sp
 
+#ifdef CONFIG_VFP
+/* VFP RunFast mode control, see prctl(PR_SET_FP_RUNFAST) */
+extern int vfp_get_runfast(struct task_struct *tsk);
+extern int vfp_set_runfast(struct task_struct *tsk, unsigned long val);
+
+#define GET_FP_RUNFAST_CTL(tsk)		vfp_get_runfast((tsk))
+#define SET_FP_RUNFAST_CTL(tsk, val)	vfp_set_runfast((tsk), (val))
+
+/* VFP lines in /proc/<pid>/status */
+struct seq_file;
+extern void arch_task_status(struct seq_file *m, struct task_struct *tsk);
+#define arch_task_status arch_task_status
+#endif
+
 /*
  * Prefetching support - only ARMv5.
  */
@@ -62,6 +62,10 @@ struct thread_info {
 	struct crunch_state	crunchstate;
 	union fp_state		fpstate __attribute__((aligned(8)));
 	union vfp_state		vfpstate;
+#ifdef CONFIG_VFP
+	__u32			vfp_runfast;	/* FPSCR bits forced by PR_SET_FP_RUNFAST */
+	unsigned long		vfp_bounces;	/* VFP_bounce() calls */
+#endif
 #ifdef CONFIG_ARM_THUMBEE
 	unsigned long		thumbee_state;	/* ThumbEE Handler Base register */
 #endif
@@ -454,6 +454,245 @@ int __kprobes longjmp_break_handler(struct kprobe *p, struct pt_regs *regs)
 	return 0;
 }
 
+#ifdef CONFIG_OPTPROBES
+/*
+ * The detour code builds its pt_regs this far below the stack pointer
+ * of the probed context, so the emulated instruction may push up to
+ * OPTPROBE_STACK_GAP bytes (an STMDB of all 16 registers needs 64)
+ * without overwriting them.
+ */
+#define OPTPROBE_STACK_GAP	sizeof(struct pt_regs)
+
+/*
+ * Optimized probes branch to a copy of this template.  The two words
+ * at optprobe_template_val and optprobe_template_call are filled with
+ * the optimized_kprobe and the callback address.  After the callback
+ * the saved registers, including the pc left by the emulation of the
+ * probed instruction, are reloaded all at once.
+ */
+static void __used __kprobes kprobes_optinsn_template_holder(void)
+{
+	__asm__ __volatile__ (
+		".global optprobe_template_entry	\n\t"
+		"optprobe_template_entry:		\n\t"
+		"sub	sp, sp, %0			\n\t"
+		"stmia	sp, {r0 - r14}			\n\t"
+		"add	r3, sp, %0			\n\t"
+		"str	r3, [sp, %1]			\n\t"
+		"mrs	r4, cpsr			\n\t"
+		"str	r4, [sp, %2]			\n\t"
+		"mov	r1, sp				\n\t"
+		"ldr	r0, 1f				\n\t"
+		/* AAPCS wants an 8 byte aligned stack for the call */
+		"and	r4, sp, #4			\n\t"
+		"sub	sp, sp, r4			\n\t"
+		"mov	lr, pc				\n\t"
+		"ldr	pc, 2f				\n\t"
+		"add	sp, sp, r4			\n\t"
+		"ldr	r1, [sp, %2]			\n\t"
+		"msr	cpsr_cxsf, r1			\n\t"
+		"ldmia	sp, {r0 - pc}			\n\t"
+		".global optprobe_template_val		\n\t"
+		"optprobe_template_val:			\n\t"
+		"1:	.long	0			\n\t"
+		".global optprobe_template_call		\n\t"
+		"optprobe_template_call:		\n\t"
+		"2:	.long	0			\n\t"
+		".global optprobe_template_end		\n\t"
+		"optprobe_template_end:			\n\t"
+		:
+		: "I" (sizeof(struct pt_regs) + OPTPROBE_STACK_GAP),
+		  "J" (offsetof(struct pt_regs, ARM_sp)),
+		  "J" (offsetof(struct pt_regs, ARM_cpsr))
+		: "memory", "cc");
+}
+
+#define TMPL_VAL_IDX \
+	(&optprobe_template_val - &optprobe_template_entry)
+#define TMPL_CALL_IDX \
+	(&optprobe_template_call - &optprobe_template_entry)
+#define TMPL_END_IDX \
+	(&optprobe_template_end - &optprobe_template_entry)
+
+/* Called from the detour buffer with the registers of the probed context */
+static __used __kprobes void optimized_callback(struct optimized_kprobe *op,
+						struct pt_regs *regs)
+{
+	struct kprobe *p = &op->kp;
+	struct kprobe_ctlblk *kcb;
+	unsigned long flags;
+
+	regs->ARM_pc = (unsigned long)p->addr;
+	regs->ARM_ORIG_r0 = ~0UL;
+
+	local_irq_save(flags);
+	kcb = get_kprobe_ctlblk();
+
+	if (kprobe_running()) {
+		kprobes_inc_nmissed_count(p);
+	} else if (!kprobe_disabled(p)) {
+		/* the probe may be disabled while unoptimizing is delayed */
+		set_current_kprobe(p);
+		kcb->kprobe_status = KPROBE_HIT_ACTIVE;
+		opt_pre_handler(p, regs);
+		reset_current_kprobe();
+	}
+
+	/* The displaced instruction has to be executed in any case. */
+	singlestep(p, regs, kcb);
+
+	local_irq_restore(flags);
+}
+
+/*
+ * Reject probed instructions which store further below the stack
+ * pointer than OPTPROBE_STACK_GAP, they would overwrite the pt_regs
+ * of the detour code.
+ */
+static int __kprobes can_optimize(kprobe_opcode_t insn)
+{
+	int rn = (insn >> 16) & 0xf;
+	int store = !(insn & (1 << 20));
+	int down = !(insn & (1 << 23));
+
+	if (rn != 13 || !store || !down)
+		return 1;
+
+	switch ((insn >> 25) & 7) {
+	case 0:
+		if ((insn & 0x90) != 0x90)
+			return 1;	/* data processing */
+		/* STRH/STRD, and multiplies, which we don't tell apart */
+		if (!(insn & (1 << 22)))
+			return 0;
+		return (((insn >> 4) & 0xf0) | (insn & 0xf)) <=
+			OPTPROBE_STACK_GAP;
+	case 1:
+		return 1;		/* data processing immediate */
+	case 2:
+		return (insn & 0xfff) <= OPTPROBE_STACK_GAP;
+	case 4:
+		return 1;		/* STMDA/STMDB: 64 bytes at most */
+	case 5:
+	case 7:
+		return 1;		/* branches, coprocessor transfers */
+	default:
+		return 0;
+	}
+}
+
+int __kprobes arch_check_optimized_kprobe(struct optimized_kprobe *op)
+{
+	/* Only the probed instruction itself is replaced. */
+	return 0;
+}
+
+int __kprobes arch_within_optimized_kprobe(struct optimized_kprobe *op,
+					   unsigned long addr)
+{
+	return ((unsigned long)op->kp.addr <= addr &&
+		(unsigned long)op->kp.addr + MAX_OPTIMIZED_LENGTH > addr);
+}
+
+void __kprobes arch_remove_optimized_kprobe(struct optimized_kprobe *op)
+{
+	if (op->optinsn.insn) {
+		free_optinsn_slot(op->optinsn.insn, 1);
+		op->optinsn.insn = NULL;
+	}
+}
+
+int __kprobes arch_prepare_optimized_kprobe(struct optimized_kprobe *op)
+{
+	kprobe_opcode_t *code;
+	long rel;
+
+	if (!can_optimize(op->kp.opcode))
+		return -EILSEQ;
+
+	code = get_optinsn_slot();
+	if (!code)
+		return -ENOMEM;
+
+	/* B reaches +/-32MB from the probed address plus 8 */
+	rel = (long)code - ((long)op->kp.addr + 8);
+	if (rel < -0x2000000 || rel > 0x1fffffc) {
+		free_optinsn_slot(code, 0);
+		return -ERANGE;
+	}
+
+	memcpy(code, &optprobe_template_entry,
+	       TMPL_END_IDX * sizeof(kprobe_opcode_t));
+	code[TMPL_VAL_IDX] = (unsigned long)op;
+	code[TMPL_CALL_IDX] = (unsigned long)optimized_callback;
+	flush_insns(code, TMPL_END_IDX);
+
+	op->optinsn.insn = code;
+	return 0;
+}
+
+struct patch_insn {
+	kprobe_opcode_t *addr;
+	kprobe_opcode_t insn;
+};
+
+/* Same reasoning as for __arch_disarm_kprobe() */
+static int __kprobes __patch_insn(void *data)
+{
+	struct patch_insn *patch = data;
+
+	*patch->addr = patch->insn;
+	flush_insns(patch->addr, 1);
+	return 0;
+}
+
+static void __kprobes patch_insn(kprobe_opcode_t *addr, kprobe_opcode_t insn)
+{
+	struct patch_insn patch = { .addr = addr, .insn = insn };
+
+	stop_machine(__patch_insn, &patch, &cpu_online_map);
+}
+
+/*
+ * Replace breakpoints with branches to the detour buffers.
+ * Caller must call with locking kprobe_mutex and text_mutex.
+ */
+void __kprobes arch_optimize_kprobes(struct list_head *oplist)
+{
+	struct optimized_kprobe *op, *tmp;
+	long rel;
+
+	list_for_each_entry_safe(op, tmp, oplist, list) {
+		WARN_ON(kprobe_disabled(&op->kp));
+		rel = (long)op->optinsn.insn - ((long)op->kp.addr + 8);
+		/* always executed B */
+		patch_insn(op->kp.addr, 0xea000000 | ((rel >> 2) & 0x00ffffff));
+		list_del_init(&op->list);
+	}
+}
+
+/* Replace a branch with a breakpoint. */
+void __kprobes arch_unoptimize_kprobe(struct optimized_kprobe *op)
+{
+	patch_insn(op->kp.addr, KPROBE_BREAKPOINT_INSTRUCTION);
+}
+
+/*
+ * Recover breakpoints from branches.
+ * Caller must call with locking kprobe_mutex.
+ */
+void __kprobes arch_unoptimize_kprobes(struct list_head *oplist,
+				       struct list_head *done_list)
+{
+	struct optimized_kprobe *op, *tmp;
+
+	list_for_each_entry_safe(op, tmp, oplist, list) {
+		arch_unoptimize_kprobe(op);
+		list_move(&op->list, done_list);
+	}
+}
+#endif /* CONFIG_OPTPROBES */
+
 int __kprobes arch_trampoline_kprobe(struct kprobe *p)
 {
 	return 0;
@@ -12,6 +12,7 @@
  */
 #define pr_fmt(fmt) "hw perfevents: " fmt
 
+#include <linux/hrtimer.h>
 #include <linux/interrupt.h>
 #include <linux/kernel.h>
 #include <linux/module.h>
@@ -377,6 +378,56 @@ validate_group(struct perf_event *event)
 	return 0;
 }
 
+/*
+ * Without a usable overflow interrupt the counters are polled from an
+ * hrtimer on each CPU instead.  The irq handlers only act on counters
+ * whose overflow flag is set, so they are simply called from the timer;
+ * samples are then taken at the granularity of the poll period.
+ */
+#define ARMPMU_POLL_PERIOD_NS	NSEC_PER_MSEC
+
+static bool armpmu_polled;
+static DEFINE_PER_CPU(struct hrtimer, armpmu_poll_timer);
+
+static enum hrtimer_restart
+armpmu_poll(struct hrtimer *timer)
+{
+	armpmu->handle_irq(-1, NULL);
+	hrtimer_forward_now(timer, ns_to_ktime(ARMPMU_POLL_PERIOD_NS));
+	return HRTIMER_RESTART;
+}
+
+static void
+armpmu_poll_start(void *info)
+{
+	struct hrtimer *timer = &__get_cpu_var(armpmu_poll_timer);
+
+	hrtimer_init(timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	timer->function = armpmu_poll;
+	hrtimer_start(timer, ns_to_ktime(ARMPMU_POLL_PERIOD_NS),
+		      HRTIMER_MODE_REL_PINNED);
+}
+
+static int
+armpmu_start_polling(void)
+{
+	pr_info("no PMU interrupt, sampling every %ld ns\n",
+		ARMPMU_POLL_PERIOD_NS);
+	armpmu_polled = true;
+	on_each_cpu(armpmu_poll_start, NULL, 1);
+	return 0;
+}
+
+static void
+armpmu_stop_polling(void)
+{
+	int cpu;
+
+	for_each_online_cpu(cpu)
+		hrtimer_cancel(&per_cpu(armpmu_poll_timer, cpu));
+	armpmu_polled = false;
+}
+
 static int
 armpmu_reserve_hardware(void)
 {
@@ -390,10 +441,8 @@ armpmu_reserve_hardware(void)
 
 	init_pmu(ARM_PMU_DEVICE_CPU);
 
-	if (pmu_device->num_resources < 1) {
-		pr_err("no irqs for PMUs defined\n");
-		return -ENODEV;
-	}
+	if (pmu_device->num_resources < 1)
+		return armpmu_start_polling();
 
 	for (i = 0; i < pmu_device->num_resources; ++i) {
 		irq = platform_get_irq(pmu_device, i);
@@ -416,8 +465,7 @@ armpmu_reserve_hardware(void)
 			if (irq >= 0)
 				free_irq(irq, NULL);
 		}
-		release_pmu(pmu_device);
-		pmu_device = NULL;
+		err = armpmu_start_polling();
 	}
 
 	return err;
@@ -428,10 +476,14 @@ armpmu_release_hardware(void)
 {
 	int i, irq;
 
-	for (i = pmu_device->num_resources - 1; i >= 0; --i) {
-		irq = platform_get_irq(pmu_device, i);
-		if (irq >= 0)
-			free_irq(irq, NULL);
+	if (armpmu_polled) {
+		armpmu_stop_polling();
+	} else {
+		for (i = pmu_device->num_resources - 1; i >= 0; --i) {
+			irq = platform_get_irq(pmu_device, i);
+			if (irq >= 0)
+				free_irq(irq, NULL);
+		}
 	}
 	armpmu->stop();
 
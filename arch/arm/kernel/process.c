@@ -368,6 +368,10 @@ copy_thread(unsigned long clone_flags, unsigned long stack_start,
 	thread->cpu_context.pc = (unsigned long)ret_from_fork;
 
 	clear_ptrace_hw_breakpoint(p);
+#ifdef CONFIG_VFP
+	/* the RunFast mode is inherited, the bounce count is not */
+	thread->vfp_bounces = 0;
+#endif
 
 	if (clone_flags & CLONE_SETTLS)
 		thread->tp_value = regs->ARM_r3;
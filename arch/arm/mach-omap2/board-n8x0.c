@@ -11,8 +11,10 @@
  * published by the Free Software Foundation.
  */
 
+#include <linux/async.h>
 #include <linux/clk.h>
 #include <linux/delay.h>
+#include <linux/hrtimer.h>
 #include <linux/gpio.h>
 #include <linux/init.h>
 #include <linux/irq.h>
@@ -810,6 +812,7 @@ static int n8x0_mmc_late_init(struct device *dev)
 {
 	int r, bit, *openp;
 	int vs2sel;
+	ktime_t start = ktime_get();
 
 	mmc_device = dev;
 
@@ -860,6 +863,9 @@ static int n8x0_mmc_late_init(struct device *dev)
 
 	r = menelaus_register_mmc_callback(n8x0_mmc_callback, NULL);
 
+	pr_debug("n8x0: MMC slot setup took %lld us\n",
+		 ktime_to_us(ktime_sub(ktime_get(), start)));
+
 	return r;
 }
 
@@ -1010,16 +1016,28 @@ static int n8x0_auto_voltage_scale(void)
 	return 0;
 }
 
-static int n8x0_menelaus_late_init(struct device *dev)
+static void n8x0_menelaus_setup(void *data, async_cookie_t cookie)
 {
-	int ret;
+	ktime_t start = ktime_get();
 
-	ret = n8x0_auto_voltage_scale();
-	if (ret < 0)
-		return ret;
-	ret = n8x0_auto_sleep_regulators();
-	if (ret < 0)
-		return ret;
+	if (n8x0_auto_voltage_scale() < 0)
+		return;
+	if (n8x0_auto_sleep_regulators() < 0)
+		return;
+
+	pr_debug("n8x0: menelaus setup took %lld us\n",
+		 ktime_to_us(ktime_sub(ktime_get(), start)));
+}
+
+/*
+ * Nothing else depends on the VCORE and regulator sleep setup, so run it
+ * in the background instead of stalling the menelaus probe.  The MMC
+ * slot setup uses menelaus too, but is serialized by the menelaus lock
+ * and does not depend on these settings.
+ */
+static int n8x0_menelaus_late_init(struct device *dev)
+{
+	async_schedule(n8x0_menelaus_setup, NULL);
 	return 0;
 }
 
@@ -1120,6 +1138,8 @@ static inline void board_serial_init(void)
 
 static void __init n8x0_init_machine(void)
 {
+	ktime_t start = ktime_get();
+
 	omap2420_mux_init(board_mux, OMAP_PACKAGE_ZAC);
 	n8x0_gpio_switches_init();
 	n8x0_cbus_init();
@@ -1141,6 +1161,9 @@ static void __init n8x0_init_machine(void)
 	gpmc_onenand_init(board_onenand_data);
 	n8x0_mmc_init();
 	n8x0_usb_init();
+
+	pr_debug("n8x0: board init took %lld us\n",
+		 ktime_to_us(ktime_sub(ktime_get(), start)));
 }
 
 MACHINE_START(NOKIA_N800, "Nokia N800")
@@ -24,6 +24,7 @@
 #include <linux/errno.h>
 #include <linux/clk.h>
 #include <linux/io.h>
+#include <linux/hrtimer.h>
 
 #include <plat/clock.h>
 #include <plat/sram.h>
@@ -37,6 +38,80 @@
 
 /* #define DOWN_VARIABLE_DPLL 1 */		/* Experimental */
 
+/*
+ * SDRC refresh settings validated in the rate table, keyed by the
+ * CORE_CLK rate and CORE dividers they were specified for.  Filled once on first use so
+ * a reprogram does not have to walk rate_table or fall back to the
+ * worst case bypass refresh rate for rates the table already covers.
+ */
+#define DPLLCORE_MAX_RFR	8
+
+static struct {
+	unsigned long rate;
+	u32 clksel1_core;
+	u32 rfr;
+} dpllcore_rfr[DPLLCORE_MAX_RFR];
+static int dpllcore_rfr_cnt = -1;
+
+static void omap2_dpllcore_init_rfr(void)
+{
+	const struct prcm_config *prcm;
+	int i;
+
+	dpllcore_rfr_cnt = 0;
+
+	for (prcm = rate_table; prcm && prcm->mpu_speed; prcm++) {
+		if (!(prcm->flags & cpu_mask))
+			continue;
+		if (prcm->xtal_speed != sclk->rate)
+			continue;
+		if (prcm->dpll_speed == prcm->xtal_speed)
+			continue;
+
+		for (i = 0; i < dpllcore_rfr_cnt; i++)
+			if (dpllcore_rfr[i].rate == prcm->dpll_speed &&
+			    dpllcore_rfr[i].clksel1_core ==
+			    prcm->cm_clksel1_core)
+				break;
+		if (i < dpllcore_rfr_cnt)
+			continue;
+
+		if (dpllcore_rfr_cnt == DPLLCORE_MAX_RFR) {
+			pr_warning("clock: too many CORE rates for rfr cache\n");
+			break;
+		}
+		dpllcore_rfr[dpllcore_rfr_cnt].rate = prcm->dpll_speed;
+		dpllcore_rfr[dpllcore_rfr_cnt].clksel1_core =
+			prcm->cm_clksel1_core;
+		dpllcore_rfr[dpllcore_rfr_cnt].rfr = prcm->base_sdrc_rfr;
+		dpllcore_rfr_cnt++;
+	}
+}
+
+/*
+ * Return the validated SDRC_RFR_CTRL value for CORE_CLK @rate with the
+ * current CORE dividers, or the worst case (bypass) setting if no rate
+ * set covers it.
+ */
+static u32 omap2_dpllcore_get_rfr(unsigned long rate)
+{
+	u32 core;
+	int i;
+
+	if (dpllcore_rfr_cnt < 0)
+		omap2_dpllcore_init_rfr();
+
+	core = omap2_cm_read_mod_reg(CORE_MOD, CM_CLKSEL1);
+	core &= ~OMAP24XX_CLKSEL_DSS2_MASK;
+
+	for (i = 0; i < dpllcore_rfr_cnt; i++)
+		if (dpllcore_rfr[i].rate == rate &&
+		    dpllcore_rfr[i].clksel1_core == core)
+			return dpllcore_rfr[i].rfr;
+
+	return SDRC_RFR_CTRL_BYPASS;
+}
+
 /**
  * omap2xxx_clk_get_core_rate - return the CORE_CLK rate
  * @clk: pointer to the combined dpll_ck + core_ck (currently "dpll_ck")
@@ -109,6 +184,9 @@ int omap2_reprogram_dpllcore(struct clk *clk, unsigned long rate)
 	u32 bypass = 0;
 	struct prcm_config tmpset;
 	const struct dpll_data *dd;
+	ktime_t start;
+
+	start = ktime_get();
 
 	cur_rate = omap2xxx_clk_get_core_rate(dclk);
 	mult = omap2_cm_read_mod_reg(PLL_MOD, CM_CLKSEL2);
@@ -150,8 +228,11 @@ int omap2_reprogram_dpllcore(struct clk *clk, unsigned long rate)
 		tmpset.cm_clksel1_pll |= (div << __ffs(dd->mult_mask));
 		tmpset.cm_clksel1_pll |= (mult << __ffs(dd->div1_mask));
 
-		/* Worst case */
-		tmpset.base_sdrc_rfr = SDRC_RFR_CTRL_BYPASS;
+		/* Worst case unless the rate table validated this rate */
+		if (done_rate == CORE_CLK_SRC_DPLL_X2)
+			tmpset.base_sdrc_rfr = omap2_dpllcore_get_rfr(rate);
+		else
+			tmpset.base_sdrc_rfr = SDRC_RFR_CTRL_BYPASS;
 
 		if (rate == curr_prcm_set->xtal_speed)	/* If asking for 1-1 */
 			bypass = 1;
@@ -168,6 +249,9 @@ int omap2_reprogram_dpllcore(struct clk *clk, unsigned long rate)
 		omap2xxx_sdrc_reprogram(done_rate, 0);
 	}
 
+	pr_debug("clock: dpllcore %u -> %lu Hz took %lld us\n", cur_rate, rate,
+		 ktime_to_us(ktime_sub(ktime_get(), start)));
+
 	return 0;
 }
 
@@ -27,15 +27,18 @@
 #undef DEBUG
 
 #include <linux/kernel.h>
+#include <linux/init.h>
 #include <linux/errno.h>
 #include <linux/clk.h>
 #include <linux/io.h>
 #include <linux/cpufreq.h>
 #include <linux/slab.h>
+#include <linux/opp.h>
 
 #include <plat/clock.h>
 #include <plat/sram.h>
 #include <plat/sdrc.h>
+#include <plat/common.h>
 
 #include "clock.h"
 #include "clock2xxx.h"
@@ -244,3 +247,50 @@ void omap2_clk_exit_cpufreq_table(struct cpufreq_frequency_table **table)
 }
 
 #endif
+
+#ifdef CONFIG_PM_OPP
+/*
+ * Register each usable rate set as an OPP of the MPU device so that
+ * cpufreq can build its table through the generic OPP layer.  No
+ * voltage data exists for 24xx, so every OPP is registered at 0 uV.
+ */
+static int __init omap2xxx_opp_init(void)
+{
+	const struct prcm_config *prcm;
+	struct device *mpu_dev;
+	int r, cnt = 0;
+
+	if (!cpu_is_omap24xx() || !rate_table || !sclk)
+		return -ENODEV;
+
+	mpu_dev = omap2_get_mpuss_device();
+	if (!mpu_dev) {
+		pr_warning("%s: no MPU device\n", __func__);
+		return -ENODEV;
+	}
+
+	for (prcm = rate_table; prcm->mpu_speed; prcm++) {
+		if (!(prcm->flags & cpu_mask))
+			continue;
+		if (prcm->xtal_speed != sclk->rate)
+			continue;
+
+		/* don't register bypass rates */
+		if (prcm->dpll_speed == prcm->xtal_speed)
+			continue;
+
+		r = opp_add(mpu_dev, prcm->mpu_speed, 0);
+		if (r) {
+			pr_err("%s: could not add OPP %lu: %d\n", __func__,
+			       prcm->mpu_speed, r);
+			return r;
+		}
+		cnt++;
+	}
+
+	pr_info("OMAP2xxx: registered %d MPU OPPs\n", cnt);
+
+	return 0;
+}
+device_initcall(omap2xxx_opp_init);
+#endif
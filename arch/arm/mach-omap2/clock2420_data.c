@@ -1840,6 +1840,10 @@ static struct omap_clk omap2420_clks[] = {
 	CLK(NULL,	"uart3_fck",	&uart3_fck,	CK_242X),
 	CLK(NULL,	"gpios_ick",	&gpios_ick,	CK_242X),
 	CLK(NULL,	"gpios_fck",	&gpios_fck,	CK_242X),
+	CLK("omap_gpio.0",	"dbclk",	&gpios_fck,	CK_242X),
+	CLK("omap_gpio.1",	"dbclk",	&gpios_fck,	CK_242X),
+	CLK("omap_gpio.2",	"dbclk",	&gpios_fck,	CK_242X),
+	CLK("omap_gpio.3",	"dbclk",	&gpios_fck,	CK_242X),
 	CLK("omap_wdt",	"ick",		&mpu_wdt_ick,	CK_242X),
 	CLK("omap_wdt",	"fck",		&mpu_wdt_fck,	CK_242X),
 	CLK(NULL,	"sync_32k_ick",	&sync_32k_ick,	CK_242X),
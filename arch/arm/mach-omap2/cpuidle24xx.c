@@ -0,0 +1,143 @@
+/*
+ * linux/arch/arm/mach-omap2/cpuidle24xx.c
+ *
+ * OMAP24xx CPU IDLE Routines
+ *
+ * Copyright (C) 2006-2008 Nokia Corporation
+ * Tony Lindgren <tony@atomide.com>
+ *
+ * Copyright (C) 2005 Texas Instruments, Inc.
+ * Richard Woodruff <r-woodruff2@ti.com>
+ *
+ * Based on cpuidle34xx.c and the idle loop in pm24xx.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/sched.h>
+#include <linux/cpuidle.h>
+
+#include <plat/irqs.h>
+
+#include "pm.h"
+
+#ifdef CONFIG_CPU_IDLE
+
+#define OMAP2_MAX_STATES	3
+#define OMAP2_STATE_C1		0 /* C1 - MPU WFI + Core active */
+#define OMAP2_STATE_C2		1 /* C2 - MPU RET + Core active */
+#define OMAP2_STATE_C3		2 /* C3 - MPU RET + Core RET */
+
+/*
+ * Default latencies and thresholds in microseconds. C3 stops the
+ * oscillator, so its wakeup is dominated by PRCM_CLKSSETUP as
+ * programmed in prcm_setup_regs().
+ */
+static struct cpuidle_params omap2_cpuidle_params[OMAP2_MAX_STATES] = {
+	/* C1 */
+	{1, 1, 1, 5},
+	/* C2 */
+	{1, 10, 10, 50},
+	/* C3 */
+	{1, 500, 1000, 5000},
+};
+
+static DEFINE_PER_CPU(struct cpuidle_device, omap2_idle_dev);
+
+/**
+ * omap2_enter_idle - Programs OMAP2 to enter the specified state
+ * @dev: cpuidle device
+ * @state: The target state to be programmed
+ *
+ * Called from the CPUidle framework to program the device to the
+ * specified target state selected by the governor. Falls back to a
+ * shallower state when the deeper one is not possible right now, and
+ * accounts the time to the state actually used.
+ */
+static int omap2_enter_idle(struct cpuidle_device *dev,
+			struct cpuidle_state *state)
+{
+	int type = (int)cpuidle_get_statedata(state);
+	struct timespec ts_preidle, ts_postidle, ts_idle;
+
+	getnstimeofday(&ts_preidle);
+
+	local_irq_disable();
+	local_fiq_disable();
+
+	if (type == OMAP2_STATE_C3 && !omap2_can_sleep())
+		type = OMAP2_STATE_C2;
+	dev->last_state = &dev->states[type];
+
+	if (omap_irq_pending() || need_resched())
+		goto return_sleep_time;
+
+	if (type == OMAP2_STATE_C3)
+		omap2_enter_full_retention();
+	else
+		omap2_enter_mpu_retention(type == OMAP2_STATE_C2);
+
+return_sleep_time:
+	getnstimeofday(&ts_postidle);
+	ts_idle = timespec_sub(ts_postidle, ts_preidle);
+
+	local_fiq_enable();
+	local_irq_enable();
+
+	return ts_idle.tv_nsec / NSEC_PER_USEC + ts_idle.tv_sec * USEC_PER_SEC;
+}
+
+static struct cpuidle_driver omap2_idle_driver = {
+	.name =		"omap2_idle",
+	.owner =	THIS_MODULE,
+};
+
+/**
+ * omap2_idle_init - Init routine for OMAP2 idle
+ *
+ * Registers the OMAP2 specific cpuidle driver with the cpuidle
+ * framework. Once registered it replaces omap2_pm_idle().
+ */
+int __init omap2_idle_init(void)
+{
+	struct cpuidle_params *params;
+	struct cpuidle_state *state;
+	struct cpuidle_device *dev;
+	int i;
+
+	cpuidle_register_driver(&omap2_idle_driver);
+
+	dev = &per_cpu(omap2_idle_dev, smp_processor_id());
+
+	for (i = OMAP2_STATE_C1; i < OMAP2_MAX_STATES; i++) {
+		params = &omap2_cpuidle_params[i];
+		state = &dev->states[i];
+
+		cpuidle_set_statedata(state, (void *)i);
+		state->exit_latency = params->sleep_latency +
+				      params->wake_latency;
+		state->target_residency = params->threshold;
+		state->flags = CPUIDLE_FLAG_TIME_VALID;
+		state->enter = omap2_enter_idle;
+		sprintf(state->name, "C%d", i + 1);
+	}
+	dev->state_count = OMAP2_MAX_STATES;
+	dev->safe_state = &dev->states[OMAP2_STATE_C1];
+
+	if (cpuidle_register_device(dev)) {
+		printk(KERN_ERR "%s: CPUidle register device failed\n",
+		       __func__);
+		cpuidle_unregister_driver(&omap2_idle_driver);
+		return -EIO;
+	}
+
+	return 0;
+}
+#else
+int __init omap2_idle_init(void)
+{
+	return 0;
+}
+#endif /* CONFIG_CPU_IDLE */
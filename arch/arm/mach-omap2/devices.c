@@ -443,8 +443,8 @@ static inline void omap_init_mcspi(void) {}
 #endif
 
 static struct resource omap2_pmu_resource = {
-	.start	= 3,
-	.end	= 3,
+	.start	= INT_24XX_BENCH_MPU_EMUL,
+	.end	= INT_24XX_BENCH_MPU_EMUL,
 	.flags	= IORESOURCE_IRQ,
 };
 
@@ -639,7 +639,7 @@ static struct omap_hwmod_ocp_if omap2420_l4_wkup__gpio4 = {
 /* gpio dev_attr */
 static struct omap_gpio_dev_attr gpio_dev_attr = {
 	.bank_width = 32,
-	.dbck_flag = false,
+	.dbck_flag = true,	/* debounce runs off the shared gpios_fck */
 };
 
 static struct omap_hwmod_class_sysconfig omap242x_gpio_sysc = {
@@ -370,6 +370,11 @@ struct prcm_config {
 #define MII_CM_CLKSEL1_PLL_13_VAL	(MX_48M_SRC | MX_54M_SRC |	\
 					 MII_DPLL_DIV_13 | MII_DPLL_MULT_13 | \
 					 MX_APLLS_CLIKIN_13)
+#define MII_DPLL_MULT_19		(125 << 12)
+#define MII_DPLL_DIV_19			(7 << 8)
+#define MII_CM_CLKSEL1_PLL_19_VAL	(MX_48M_SRC | MX_54M_SRC |	\
+					 MII_DPLL_DIV_19 | MII_DPLL_MULT_19 | \
+					 MX_APLLS_CLIKIN_19_2)
 
 /* PRCM III target DPLL = 2*266 = 532MHz*/
 #define MIII_DPLL_MULT_12		(133 << 12)
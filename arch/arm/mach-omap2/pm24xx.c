@@ -49,6 +49,7 @@
 #include "sdrc.h"
 #include "pm.h"
 #include "control.h"
+#include "timer-gp.h"
 
 #include "powerdomain.h"
 #include "clockdomain.h"
@@ -86,15 +87,26 @@ static int omap2_fclks_active(void)
 	f1 &= ~(OMAP24XX_EN_UART1_MASK | OMAP24XX_EN_UART2_MASK);
 	f2 &= ~OMAP24XX_EN_UART3_MASK;
 
+	/* The sched_clock GPTIMER is stopped in omap2_enter_full_retention() */
+	if (omap2_gpt_sched_clock_id)
+		f1 &= ~(1 << (OMAP24XX_EN_GPT2_SHIFT +
+			      omap2_gpt_sched_clock_id - 2));
+
 	if (f1 | f2)
 		return 1;
 	return 0;
 }
 
-static void omap2_enter_full_retention(void)
+void omap2_enter_full_retention(void)
 {
 	u32 l;
 	struct timespec ts_preidle, ts_postidle, ts_idle;
+	u64 t_entry, t_sleep, t_wake = 0;
+
+	t_entry = sched_clock();
+
+	/* sched_clock() follows the 32KiHz counter until we are back */
+	omap2_gpt_sched_clock_suspend();
 
 	/* There is 1 reference hold for all children of the oscillator
 	 * clock, the following will remove it. If no one else uses the
@@ -141,11 +153,21 @@ static void omap2_enter_full_retention(void)
 	omap_uart_prepare_idle(1);
 	omap_uart_prepare_idle(2);
 
+	t_sleep = sched_clock();
+	if (is_suspending())
+		dpm_timing_record("omap2", "retention entry ",
+				  PM_EVENT_SUSPEND, t_entry, 0);
+
 	/* Jump to SRAM suspend code */
 	omap2_sram_suspend(sdrc_read_reg(SDRC_DLLA_CTRL),
 			   OMAP_SDRC_REGADDR(SDRC_DLLA_CTRL),
 			   OMAP_SDRC_REGADDR(SDRC_POWER));
 
+	t_wake = sched_clock();
+	if (is_suspending())
+		dpm_timing_record("omap2", "retention ", PM_EVENT_SUSPEND,
+				  t_sleep, 0);
+
 	omap_uart_resume_idle(2);
 	omap_uart_resume_idle(1);
 	omap_uart_resume_idle(0);
@@ -166,6 +188,8 @@ no_sleep:
 
 	clk_enable(osc_ck);
 
+	omap2_gpt_sched_clock_resume();
+
 	/* clear CORE wake-up events */
 	omap2_prm_write_mod_reg(0xffffffff, CORE_MOD, PM_WKST1);
 	omap2_prm_write_mod_reg(0xffffffff, CORE_MOD, OMAP24XX_PM_WKST2);
@@ -184,6 +208,10 @@ no_sleep:
 
 	/* Mask future PRCM-to-MPU interrupts */
 	omap2_prm_write_mod_reg(0x0, OCP_MOD, OMAP2_PRCM_IRQSTATUS_MPU_OFFSET);
+
+	if (is_suspending() && t_wake)
+		dpm_timing_record("omap2", "retention exit ", PM_EVENT_RESUME,
+				  t_wake, 0);
 }
 
 static int omap2_i2c_active(void)
@@ -216,7 +244,11 @@ static int omap2_allow_mpu_retention(void)
 	return 1;
 }
 
-static void omap2_enter_mpu_retention(void)
+/*
+ * Enter MPU retention if @allow_ret is set and the active peripherals
+ * allow it, plain WFI otherwise.
+ */
+void omap2_enter_mpu_retention(int allow_ret)
 {
 	int only_idle = 0;
 	struct timespec ts_preidle, ts_postidle, ts_idle;
@@ -228,7 +260,7 @@ static void omap2_enter_mpu_retention(void)
 
 	/* The peripherals seem not to be able to wake up the MPU when
 	 * it is in retention mode. */
-	if (omap2_allow_mpu_retention()) {
+	if (allow_ret && omap2_allow_mpu_retention()) {
 		/* REVISIT: These write to reserved bits? */
 		omap2_prm_write_mod_reg(0xffffffff, CORE_MOD, PM_WKST1);
 		omap2_prm_write_mod_reg(0xffffffff, CORE_MOD, OMAP24XX_PM_WKST2);
@@ -263,7 +295,7 @@ static void omap2_enter_mpu_retention(void)
 	}
 }
 
-static int omap2_can_sleep(void)
+int omap2_can_sleep(void)
 {
 	if (omap2_fclks_active())
 		return 0;
@@ -285,7 +317,7 @@ static void omap2_pm_idle(void)
 	if (!omap2_can_sleep()) {
 		if (omap_irq_pending())
 			goto out;
-		omap2_enter_mpu_retention();
+		omap2_enter_mpu_retention(1);
 		goto out;
 	}
 
@@ -585,6 +617,8 @@ static int __init omap2_pm_init(void)
 	suspend_set_ops(&omap_pm_ops);
 	pm_idle = omap2_pm_idle;
 
+	omap2_idle_init();
+
 	return 0;
 }
 
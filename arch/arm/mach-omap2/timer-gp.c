@@ -173,6 +173,92 @@ static void __init omap2_gp_clockevent_init(void)
 	clockevents_register_device(&clockevent_gpt);
 }
 
+/*
+ * GPTIMER sched_clock
+ *
+ * The 32KiHz sync counter limits sched_clock() to a resolution of about
+ * 30us.  A free running GPTIMER clocked from sys_clk resolves well below
+ * a microsecond.  On 24xx its functional clock is cut around full chip
+ * retention, and the time spent there is taken from the 32KiHz counter.
+ */
+static DEFINE_CLOCK_DATA(cd);
+static struct omap_dm_timer *gpt_sched_clock;
+static u64 gpt_sched_clock_offset;
+static u64 gpt_sleep_ns, gpt_sleep_32k;
+static u32 gpt_sleep_cyc;
+static int gpt_sched_clock_stopped;
+
+/* sched_clock() reads gpt_sched_clock rather than the 32KiHz counter */
+int omap_gpt_sched_clock_enabled;
+
+/* GPTIMER that only feeds sched_clock() and may be stopped for retention */
+int omap2_gpt_sched_clock_id;
+
+static void notrace gpt_update_sched_clock(void)
+{
+	u32 cyc;
+
+	if (gpt_sched_clock_stopped)
+		return;
+	cyc = omap_dm_timer_read_counter(gpt_sched_clock);
+	update_sched_clock(&cd, cyc, (u32)~0);
+}
+
+unsigned long long notrace omap2_gpt_sched_clock(void)
+{
+	u32 cyc;
+
+	if (unlikely(gpt_sched_clock_stopped))
+		return gpt_sleep_ns + (omap_32k_sched_clock() - gpt_sleep_32k);
+
+	cyc = omap_dm_timer_read_counter(gpt_sched_clock);
+	return cyc_to_sched_clock(&cd, cyc, (u32)~0) + gpt_sched_clock_offset;
+}
+
+static void __init omap2_gpt_sched_clock_init(struct omap_dm_timer *gpt,
+					      u32 rate)
+{
+	u64 now_32k = omap_32k_sched_clock();
+
+	init_sched_clock(&cd, gpt_update_sched_clock, 32, rate);
+	gpt_sched_clock = gpt;
+
+	/* continue from where the 32KiHz sched_clock() got to */
+	gpt_sched_clock_offset = now_32k - omap2_gpt_sched_clock();
+	omap_gpt_sched_clock_enabled = 1;
+}
+
+/**
+ * omap2_gpt_sched_clock_suspend - stop the sched_clock GPTIMER
+ *
+ * Called with interrupts disabled before sys_clk is released for
+ * retention.  Until omap2_gpt_sched_clock_resume(), sched_clock()
+ * advances with the 32KiHz counter.
+ */
+void omap2_gpt_sched_clock_suspend(void)
+{
+	if (!omap2_gpt_sched_clock_id)
+		return;
+
+	gpt_sleep_cyc = omap_dm_timer_read_counter(gpt_sched_clock);
+	gpt_sleep_ns = omap2_gpt_sched_clock();
+	gpt_sleep_32k = omap_32k_sched_clock();
+	gpt_sched_clock_stopped = 1;
+	omap_dm_timer_disable(gpt_sched_clock);
+}
+
+void omap2_gpt_sched_clock_resume(void)
+{
+	if (!omap2_gpt_sched_clock_id)
+		return;
+
+	omap_dm_timer_enable(gpt_sched_clock);
+	/* the counter is not guaranteed to survive retention */
+	omap_dm_timer_write_counter(gpt_sched_clock, gpt_sleep_cyc);
+	gpt_sched_clock_offset += omap_32k_sched_clock() - gpt_sleep_32k;
+	gpt_sched_clock_stopped = 0;
+}
+
 /* Clocksource code */
 
 #ifdef CONFIG_OMAP_32K_TIMER
@@ -182,16 +268,56 @@ static void __init omap2_gp_clockevent_init(void)
  * sync counter.  See clocksource setup in plat-omap/counter_32k.c
  */
 
+static u8 __initdata gpt_sched_clock_id;
+
+/* omap_gpt_sched_clock=<n>: drive sched_clock() from GPTIMER<n> */
+static int __init omap_gpt_sched_clock_setup(char *str)
+{
+	unsigned long id;
+
+	if (!strict_strtoul(str, 0, &id))
+		gpt_sched_clock_id = id;
+	return 0;
+}
+early_param("omap_gpt_sched_clock", omap_gpt_sched_clock_setup);
+
 static void __init omap2_gp_clocksource_init(void)
 {
+	struct omap_dm_timer *gpt;
+	u32 tick_rate;
+
 	omap_init_clocksource_32k();
+
+	if (!gpt_sched_clock_id)
+		return;
+
+	/* GPTIMER1 has the tick, GPTIMER12 only runs from 32KiHz */
+	if (!cpu_is_omap24xx() || gpt_sched_clock_id < 2 ||
+	    gpt_sched_clock_id > 11 || gpt_sched_clock_id == gptimer_id) {
+		pr_err("OMAP sched_clock: GPTIMER%d not usable\n",
+		       gpt_sched_clock_id);
+		return;
+	}
+
+	gpt = omap_dm_timer_request_specific(gpt_sched_clock_id);
+	if (!gpt)
+		return;
+
+	omap_dm_timer_set_source(gpt, OMAP_TIMER_SRC_SYS_CLK);
+	tick_rate = clk_get_rate(omap_dm_timer_get_fclk(gpt));
+	omap_dm_timer_set_load_start(gpt, 1, 0);
+
+	omap2_gpt_sched_clock_init(gpt, tick_rate);
+	omap2_gpt_sched_clock_id = gpt_sched_clock_id;
+
+	pr_info("OMAP sched_clock: GPTIMER%d at %u Hz\n",
+		gpt_sched_clock_id, tick_rate);
 }
 
 #else
 /*
  * clocksource
  */
-static DEFINE_CLOCK_DATA(cd);
 static struct omap_dm_timer *gpt_clocksource;
 static cycle_t clocksource_read_cycles(struct clocksource *cs)
 {
@@ -206,15 +332,6 @@ static struct clocksource clocksource_gpt = {
 	.flags		= CLOCK_SOURCE_IS_CONTINUOUS,
 };
 
-static void notrace dmtimer_update_sched_clock(void)
-{
-	u32 cyc;
-
-	cyc = omap_dm_timer_read_counter(gpt_clocksource);
-
-	update_sched_clock(&cd, cyc, (u32)~0);
-}
-
 /* Setup free-running counter for clocksource */
 static void __init omap2_gp_clocksource_init(void)
 {
@@ -235,7 +352,8 @@ static void __init omap2_gp_clocksource_init(void)
 
 	omap_dm_timer_set_load_start(gpt, 1, 0);
 
-	init_sched_clock(&cd, dmtimer_update_sched_clock, 32, tick_rate);
+	/* the clocksource keeps running in retention, see omap2_fclks_active() */
+	omap2_gpt_sched_clock_init(gpt, tick_rate);
 
 	if (clocksource_register_hz(&clocksource_gpt, tick_rate))
 		printk(err2, clocksource_gpt.name);
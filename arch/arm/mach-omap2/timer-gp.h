@@ -13,4 +13,8 @@
 
 extern int __init omap2_gp_clockevent_set_gptimer(u8 id);
 
+extern int omap2_gpt_sched_clock_id;
+extern void omap2_gpt_sched_clock_suspend(void);
+extern void omap2_gpt_sched_clock_resume(void);
+
 #endif
@@ -12,6 +12,9 @@
 #include <linux/mm.h>
 #include <linux/smp.h>
 #include <linux/percpu.h>
+#include <linux/bitops.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <asm/mmu_context.h>
 #include <asm/tlbflush.h>
@@ -103,22 +106,11 @@ static void reset_context(void *info)
 	isb();
 }
 
-#else
-
-static inline void set_mm_context(struct mm_struct *mm, unsigned int asid)
-{
-	mm->context.id = asid;
-	cpumask_copy(mm_cpumask(mm), cpumask_of(smp_processor_id()));
-}
-
-#endif
-
 void __new_context(struct mm_struct *mm)
 {
 	unsigned int asid;
 
 	spin_lock(&cpu_asid_lock);
-#ifdef CONFIG_SMP
 	/*
 	 * Check the ASID again, in case the change was broadcast from
 	 * another CPU before we acquired the lock.
@@ -128,7 +120,6 @@ void __new_context(struct mm_struct *mm)
 		spin_unlock(&cpu_asid_lock);
 		return;
 	}
-#endif
 	/*
 	 * At this point, it is guaranteed that the current mm (with
 	 * an old ASID) isn't active on any other CPU since the ASIDs
@@ -145,13 +136,128 @@ void __new_context(struct mm_struct *mm)
 	if (unlikely((asid & ~ASID_MASK) == 0)) {
 		asid = cpu_last_asid + smp_processor_id() + 1;
 		flush_context();
-#ifdef CONFIG_SMP
 		smp_wmb();
 		smp_call_function(reset_context, NULL, 1);
-#endif
 		cpu_last_asid += NR_CPUS;
 	}
 
 	set_mm_context(mm, asid);
 	spin_unlock(&cpu_asid_lock);
 }
+
+#else
+
+/*
+ * On uniprocessor systems an ASID stays with its mm until the mm is
+ * destroyed.  asid_map holds the ASIDs owned by live mms of the current
+ * generation; asid_dirty those released since the TLB was last flushed,
+ * whose entries are dropped with a flush by ASID when they are handed
+ * out again.  Only when every ASID is owned by a live mm does a new
+ * generation start, with a full TLB flush, as before.
+ */
+#define NUM_USER_ASIDS		(1 << ASID_BITS)
+
+static DECLARE_BITMAP(asid_map, NUM_USER_ASIDS);
+static DECLARE_BITMAP(asid_dirty, NUM_USER_ASIDS);
+
+static unsigned long asid_allocations;
+static unsigned long asid_recycles;
+static unsigned long asid_rollovers;
+
+static inline void set_mm_context(struct mm_struct *mm, unsigned int asid)
+{
+	mm->context.id = asid;
+	cpumask_copy(mm_cpumask(mm), cpumask_of(smp_processor_id()));
+}
+
+void __new_context(struct mm_struct *mm)
+{
+	unsigned int asid;
+
+	spin_lock(&cpu_asid_lock);
+	asid = find_next_zero_bit(asid_map, NUM_USER_ASIDS,
+				  (cpu_last_asid & ~ASID_MASK) + 1);
+	if (asid == NUM_USER_ASIDS)
+		asid = find_next_zero_bit(asid_map, NUM_USER_ASIDS, 1);
+
+	if (unlikely(asid == NUM_USER_ASIDS)) {
+		/*
+		 * All ASIDs are in use: start a new version, which gives
+		 * every live mm a new ASID when it next runs.
+		 */
+		cpu_last_asid = (cpu_last_asid & ASID_MASK) + ASID_FIRST_VERSION;
+		if (cpu_last_asid == 0)
+			cpu_last_asid = ASID_FIRST_VERSION;
+		bitmap_zero(asid_map, NUM_USER_ASIDS);
+		bitmap_zero(asid_dirty, NUM_USER_ASIDS);
+		flush_context();
+		asid_rollovers++;
+		asid = 1;
+	}
+
+	__set_bit(asid, asid_map);
+	cpu_last_asid = (cpu_last_asid & ASID_MASK) | asid;
+	set_mm_context(mm, cpu_last_asid);
+	asid_allocations++;
+
+	if (__test_and_clear_bit(asid, asid_dirty)) {
+		/* drop what the previous owner left behind */
+		local_flush_tlb_mm(mm);
+		if (icache_is_vivt_asid_tagged()) {
+			__flush_icache_all();
+			dsb();
+		}
+		asid_recycles++;
+	}
+	spin_unlock(&cpu_asid_lock);
+}
+
+void destroy_context(struct mm_struct *mm)
+{
+	unsigned int asid = mm->context.id;
+
+	spin_lock(&cpu_asid_lock);
+	if (asid && !((asid ^ cpu_last_asid) >> ASID_BITS)) {
+		asid &= ~ASID_MASK;
+		__clear_bit(asid, asid_map);
+		__set_bit(asid, asid_dirty);
+	}
+	spin_unlock(&cpu_asid_lock);
+}
+
+#ifdef CONFIG_DEBUG_FS
+static int asid_stats_show(struct seq_file *m, void *v)
+{
+	spin_lock(&cpu_asid_lock);
+	seq_printf(m, "version:     %u\n", cpu_last_asid >> ASID_BITS);
+	seq_printf(m, "live:        %d\n",
+		   bitmap_weight(asid_map, NUM_USER_ASIDS));
+	seq_printf(m, "allocations: %lu\n", asid_allocations);
+	seq_printf(m, "recycles:    %lu\n", asid_recycles);
+	seq_printf(m, "rollovers:   %lu\n", asid_rollovers);
+	spin_unlock(&cpu_asid_lock);
+	return 0;
+}
+
+static int asid_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, asid_stats_show, NULL);
+}
+
+static const struct file_operations asid_stats_fops = {
+	.open		= asid_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init asid_stats_init(void)
+{
+	debugfs_create_file("asid_stats", S_IRUGO, NULL, NULL,
+			    &asid_stats_fops);
+	return 0;
+}
+late_initcall(asid_stats_init);
+#endif
+
+#endif
@@ -0,0 +1,89 @@
+/*
+ *  linux/arch/arm/mm/copypage-bench.c
+ *
+ *  Boot time bandwidth measurement of the page copy routines.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/gfp.h>
+#include <linux/string.h>
+#include <linux/hrtimer.h>
+#include <linux/math64.h>
+#include <linux/irqflags.h>
+
+#include <asm/cputype.h>
+
+#include "mm.h"
+
+/* 512KB buffers, well beyond the L1 data cache */
+#define BENCH_ORDER	7
+#define BENCH_PAGES	(1 << BENCH_ORDER)
+#define BENCH_LOOPS	8
+
+static void memcpy_page(void *kto, const void *kfrom)
+{
+	memcpy(kto, kfrom, PAGE_SIZE);
+}
+
+static void __init bench_one(const char *name,
+			     void (*copy)(void *, const void *),
+			     char *dst, const char *src)
+{
+	unsigned long flags;
+	ktime_t start, end;
+	u64 ns, bytes;
+	int loop, i;
+
+	/* warm up the TLB and cache state the steady loop sees */
+	for (i = 0; i < BENCH_PAGES; i++)
+		copy(dst + i * PAGE_SIZE, src + i * PAGE_SIZE);
+
+	local_irq_save(flags);
+	start = ktime_get();
+	for (loop = 0; loop < BENCH_LOOPS; loop++)
+		for (i = 0; i < BENCH_PAGES; i++)
+			copy(dst + i * PAGE_SIZE, src + i * PAGE_SIZE);
+	end = ktime_get();
+	local_irq_restore(flags);
+
+	ns = ktime_to_ns(ktime_sub(end, start));
+	bytes = (u64)BENCH_LOOPS * BENCH_PAGES * PAGE_SIZE;
+	printk(KERN_INFO "copypage-bench: %-10s %6llu KB/s\n", name,
+	       ns ? (unsigned long long)div64_u64(bytes * 1000000ULL, ns * 1024)
+		  : 0ULL);
+}
+
+static int __init copypage_bench_init(void)
+{
+	unsigned long src, dst;
+
+	src = __get_free_pages(GFP_KERNEL, BENCH_ORDER);
+	dst = __get_free_pages(GFP_KERNEL, BENCH_ORDER);
+	if (!src || !dst) {
+		printk(KERN_ERR "copypage-bench: out of memory\n");
+		goto out;
+	}
+	memset((void *)src, 0x5a, BENCH_PAGES * PAGE_SIZE);
+
+	printk(KERN_INFO "copypage-bench: CPU id %08x, %lu KB per pass\n",
+	       read_cpuid_id(), BENCH_PAGES * PAGE_SIZE / 1024);
+	bench_one("copy_page", copy_page, (char *)dst, (char *)src);
+	bench_one("memcpy", memcpy_page, (char *)dst, (char *)src);
+#ifdef CONFIG_CPU_COPY_V6
+	bench_one("arm1136", v6_arm1136_copy_page, (char *)dst, (char *)src);
+	if (memcmp((void *)dst, (void *)src, BENCH_PAGES * PAGE_SIZE))
+		printk(KERN_ERR "copypage-bench: arm1136 copy corrupted data\n");
+#endif
+out:
+	if (dst)
+		free_pages(dst, BENCH_ORDER);
+	if (src)
+		free_pages(src, BENCH_ORDER);
+	return 0;
+}
+late_initcall(copypage_bench_init);
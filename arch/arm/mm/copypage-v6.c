@@ -17,6 +17,7 @@
 #include <asm/tlbflush.h>
 #include <asm/cacheflush.h>
 #include <asm/cachetype.h>
+#include <asm/cputype.h>
 
 #include "mm.h"
 
@@ -29,6 +30,56 @@
 
 static DEFINE_SPINLOCK(v6_lock);
 
+/*
+ * ARM1136 optimised page copy
+ *  r0 = destination
+ *  r1 = source
+ *
+ * Each iteration moves two 32-byte cache lines with one eight register
+ * ldm/stm pair per line, keeping the write buffer fed with full lines.
+ * The source is preloaded four lines ahead to cover the SDRAM latency
+ * of the OMAP2420; the last two iterations do not preload, so no line
+ * beyond the page, which may belong to a differently coloured alias of
+ * the destination, is ever pulled into the cache.
+ */
+void __naked v6_arm1136_copy_page(void *kto, const void *kfrom)
+{
+	asm("\
+	stmfd	sp!, {r4-r9, lr}		\n\
+	mov	lr, %2				\n\
+	pld	[r1, #0]			\n\
+	pld	[r1, #32]			\n\
+	pld	[r1, #64]			\n\
+	pld	[r1, #96]			\n\
+1:	pld	[r1, #128]			\n\
+	pld	[r1, #160]			\n\
+	ldmia	r1!, {r2-r9}			\n\
+	stmia	r0!, {r2-r9}			\n\
+	ldmia	r1!, {r2-r9}			\n\
+	subs	lr, lr, #1			\n\
+	stmia	r0!, {r2-r9}			\n\
+	bne	1b				\n\
+	mov	lr, #2				\n\
+2:	ldmia	r1!, {r2-r9}			\n\
+	stmia	r0!, {r2-r9}			\n\
+	ldmia	r1!, {r2-r9}			\n\
+	subs	lr, lr, #1			\n\
+	stmia	r0!, {r2-r9}			\n\
+	bne	2b				\n\
+	ldmfd	sp!, {r4-r9, pc}"
+	:
+	: "r" (kto), "r" (kfrom), "I" (PAGE_SIZE / 64 - 2));
+}
+
+static void (*v6_copy_page)(void *kto, const void *kfrom) __read_mostly =
+	copy_page;
+
+static inline int cpu_is_arm1136(void)
+{
+	/* ARM Ltd implementor, primary part number 0xb36 */
+	return (read_cpuid_id() & 0xff00fff0) == 0x4100b360;
+}
+
 /*
  * Copy the user page.  No aliasing to deal with so we can just
  * attack the kernel's existing mapping of these pages.
@@ -40,7 +91,7 @@ static void v6_copy_user_highpage_nonaliasing(struct page *to,
 
 	kfrom = kmap_atomic(from, KM_USER0);
 	kto = kmap_atomic(to, KM_USER1);
-	copy_page(kto, kfrom);
+	v6_copy_page(kto, kfrom);
 	__cpuc_flush_dcache_area(kto, PAGE_SIZE);
 	kunmap_atomic(kto, KM_USER1);
 	kunmap_atomic(kfrom, KM_USER0);
@@ -100,7 +151,7 @@ static void v6_copy_user_highpage_aliasing(struct page *to,
 	flush_tlb_kernel_page(kfrom);
 	flush_tlb_kernel_page(kto);
 
-	copy_page((void *)kto, (void *)kfrom);
+	v6_copy_page((void *)kto, (void *)kfrom);
 
 	spin_unlock(&v6_lock);
 }
@@ -138,6 +189,9 @@ struct cpu_user_fns v6_user_fns __initdata = {
 
 static int __init v6_userpage_init(void)
 {
+	if (cpu_is_arm1136())
+		v6_copy_page = v6_arm1136_copy_page;
+
 	if (cache_is_vipt_aliasing()) {
 		cpu_user.cpu_clear_user_highpage = v6_clear_user_highpage_aliasing;
 		cpu_user.cpu_copy_user_highpage = v6_copy_user_highpage_aliasing;
@@ -18,6 +18,7 @@
 #include <linux/device.h>
 #include <linux/dma-mapping.h>
 #include <linux/highmem.h>
+#include <linux/genalloc.h>
 
 #include <asm/memory.h>
 #include <asm/highmem.h>
@@ -180,6 +181,125 @@ static int __init consistent_init(void)
 
 core_initcall(consistent_init);
 
+/*
+ * Coherent pool: a block of pages allocated and mapped into the
+ * consistent region once at boot.  Allocations are carved out of it
+ * with a bitmap, so they need neither a walk of the vmregion list nor
+ * page table updates.  When the pool is exhausted, allocations fall
+ * back to mapping fresh pages as before.
+ */
+#define DEFAULT_COHERENT_POOL_SIZE	SZ_256K
+
+static size_t coherent_pool_size __initdata = DEFAULT_COHERENT_POOL_SIZE;
+
+static struct coherent_pool {
+	struct gen_pool	*pool;
+	unsigned long	vaddr;
+	size_t		size;
+	struct page	*page;
+} coherent_pool;
+
+static int __init early_coherent_pool(char *p)
+{
+	coherent_pool_size = PAGE_ALIGN(memparse(p, &p));
+	return 0;
+}
+early_param("coherent_pool", early_coherent_pool);
+
+static void *__dma_alloc_remap(struct page *, size_t, gfp_t, pgprot_t);
+static void __dma_free_remap(void *, size_t);
+
+static int __init coherent_pool_init(void)
+{
+	struct coherent_pool *cp = &coherent_pool;
+	size_t size = coherent_pool_size;
+	struct page *page;
+	void *ptr;
+
+	if (!size || arch_is_coherent())
+		return 0;
+	if (size > CONSISTENT_DMA_SIZE / 2)
+		size = CONSISTENT_DMA_SIZE / 2;
+
+	cp->pool = gen_pool_create(PAGE_SHIFT, -1);
+	if (!cp->pool)
+		goto fail;
+
+	page = __dma_alloc_buffer(NULL, size, GFP_KERNEL);
+	if (!page)
+		goto destroy;
+
+	ptr = __dma_alloc_remap(page, size, GFP_KERNEL,
+				pgprot_dmacoherent(pgprot_kernel));
+	if (!ptr)
+		goto free;
+
+	if (gen_pool_add(cp->pool, (unsigned long)ptr, size, -1))
+		goto unmap;
+
+	cp->vaddr = (unsigned long)ptr;
+	cp->size = size;
+	cp->page = page;
+	printk(KERN_INFO "DMA: coherent pool of %zuKiB at %p\n",
+	       size >> 10, ptr);
+	return 0;
+
+unmap:
+	__dma_free_remap(ptr, size);
+free:
+	__dma_free_buffer(page, size);
+destroy:
+	gen_pool_destroy(cp->pool);
+	cp->pool = NULL;
+fail:
+	printk(KERN_ERR "DMA: failed to set up %zuKiB coherent pool\n",
+	       size >> 10);
+	return -ENOMEM;
+}
+postcore_initcall(coherent_pool_init);
+
+static inline bool in_coherent_pool(void *cpu_addr, size_t size)
+{
+	unsigned long addr = (unsigned long)cpu_addr;
+
+	return coherent_pool.size && addr >= coherent_pool.vaddr &&
+	       addr + size <= coherent_pool.vaddr + coherent_pool.size;
+}
+
+static inline struct page *coherent_pool_page(void *cpu_addr)
+{
+	return coherent_pool.page +
+	       (((unsigned long)cpu_addr - coherent_pool.vaddr) >> PAGE_SHIFT);
+}
+
+static void *
+__dma_alloc_from_pool(struct device *dev, size_t size, dma_addr_t *handle,
+		      pgprot_t prot)
+{
+	struct coherent_pool *cp = &coherent_pool;
+	u64 mask = get_coherent_dma_mask(dev);
+	void *ptr;
+
+	/*
+	 * The pool is mapped with the DMA coherent attributes, which are
+	 * also those of write-combining mappings when DMA memory is
+	 * bufferable.  It is below the GFP_DMA limit, so it only has to
+	 * be checked against masks smaller than that.
+	 */
+	if (!cp->size || !mask ||
+	    pgprot_val(prot) != pgprot_val(pgprot_dmacoherent(pgprot_kernel)) ||
+	    page_to_phys(cp->page) + cp->size - 1 > mask)
+		return NULL;
+
+	ptr = (void *)gen_pool_alloc(cp->pool, size);
+	if (!ptr)
+		return NULL;
+
+	memset(ptr, 0, size);
+	*handle = pfn_to_dma(dev, page_to_pfn(coherent_pool_page(ptr)));
+	return ptr;
+}
+
 static void *
 __dma_alloc_remap(struct page *page, size_t size, gfp_t gfp, pgprot_t prot)
 {
@@ -289,6 +409,8 @@ static void __dma_free_remap(void *cpu_addr, size_t size)
 
 #define __dma_alloc_remap(page, size, gfp, prot)	page_address(page)
 #define __dma_free_remap(addr, size)			do { } while (0)
+#define __dma_alloc_from_pool(dev, size, handle, prot)	NULL
+#define in_coherent_pool(addr, size)			false
 
 #endif	/* CONFIG_MMU */
 
@@ -302,6 +424,10 @@ __dma_alloc(struct device *dev, size_t size, dma_addr_t *handle, gfp_t gfp,
 	*handle = ~0;
 	size = PAGE_ALIGN(size);
 
+	addr = __dma_alloc_from_pool(dev, size, handle, prot);
+	if (addr)
+		return addr;
+
 	page = __dma_alloc_buffer(dev, size, gfp);
 	if (!page)
 		return NULL;
@@ -356,6 +482,17 @@ static int dma_mmap(struct device *dev, struct vm_area_struct *vma,
 
 	user_size = (vma->vm_end - vma->vm_start) >> PAGE_SHIFT;
 
+	if (in_coherent_pool(cpu_addr, PAGE_ALIGN(size))) {
+		unsigned long off = vma->vm_pgoff;
+
+		kern_size = PAGE_ALIGN(size) >> PAGE_SHIFT;
+		if (off < kern_size && user_size <= (kern_size - off))
+			ret = remap_pfn_range(vma, vma->vm_start,
+				page_to_pfn(coherent_pool_page(cpu_addr)) + off,
+				user_size << PAGE_SHIFT, vma->vm_page_prot);
+		return ret;
+	}
+
 	c = arm_vmregion_find(&consistent_head, (unsigned long)cpu_addr);
 	if (c) {
 		unsigned long off = vma->vm_pgoff;
@@ -404,6 +541,13 @@ void dma_free_coherent(struct device *dev, size_t size, void *cpu_addr, dma_addr
 
 	size = PAGE_ALIGN(size);
 
+#ifdef CONFIG_MMU
+	if (in_coherent_pool(cpu_addr, size)) {
+		gen_pool_free(coherent_pool.pool, (unsigned long)cpu_addr, size);
+		return;
+	}
+#endif
+
 	if (!arch_is_coherent())
 		__dma_free_remap(cpu_addr, size);
 
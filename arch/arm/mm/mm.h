@@ -26,6 +26,8 @@ const struct mem_type *get_mem_type(unsigned int type);
 
 extern void __flush_dcache_page(struct address_space *mapping, struct page *page);
 
+extern void v6_arm1136_copy_page(void *kto, const void *kfrom);
+
 #endif
 
 void __init bootmem_init(void);
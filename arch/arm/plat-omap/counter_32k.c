@@ -126,14 +126,18 @@ static inline unsigned long long notrace _omap_32k_sched_clock(void)
 	return cyc_to_fixed_sched_clock(&cd, cyc, (u32)~0, SC_MULT, SC_SHIFT);
 }
 
-#ifndef CONFIG_OMAP_MPU_TIMER
-unsigned long long notrace sched_clock(void)
+unsigned long long notrace omap_32k_sched_clock(void)
 {
 	return _omap_32k_sched_clock();
 }
-#else
-unsigned long long notrace omap_32k_sched_clock(void)
+
+#ifndef CONFIG_OMAP_MPU_TIMER
+unsigned long long notrace sched_clock(void)
 {
+#ifdef CONFIG_ARCH_OMAP2PLUS
+	if (omap_gpt_sched_clock_enabled)
+		return omap2_gpt_sched_clock();
+#endif
 	return _omap_32k_sched_clock();
 }
 #endif
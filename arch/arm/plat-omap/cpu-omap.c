@@ -21,14 +21,24 @@
 #include <linux/err.h>
 #include <linux/clk.h>
 #include <linux/io.h>
+#include <linux/slab.h>
+#include <linux/opp.h>
+#include <linux/ktime.h>
 
 #include <mach/hardware.h>
 #include <plat/clock.h>
+#include <plat/common.h>
 #include <asm/system.h>
 
 #define VERY_HI_RATE	900000000
 
 static struct cpufreq_frequency_table *freq_table;
+static bool freq_table_from_opp;
+
+/* Measured cost of a rate change, in microseconds */
+static unsigned int trans_count;
+static unsigned int trans_last_us;
+static unsigned int trans_max_us;
 
 #ifdef CONFIG_ARCH_OMAP1
 #define MPU_CLK		"mpu"
@@ -74,6 +84,8 @@ static int omap_target(struct cpufreq_policy *policy,
 		       unsigned int relation)
 {
 	struct cpufreq_freqs freqs;
+	ktime_t start;
+	unsigned int us;
 	int ret = 0;
 
 	/* Ensure desired rate is within allowed range.  Some govenors
@@ -95,7 +107,16 @@ static int omap_target(struct cpufreq_policy *policy,
 	printk(KERN_DEBUG "cpufreq-omap: transition: %u --> %u\n",
 	       freqs.old, freqs.new);
 #endif
+	start = ktime_get();
 	ret = clk_set_rate(mpu_clk, freqs.new * 1000);
+	us = ktime_to_us(ktime_sub(ktime_get(), start));
+	if (!ret) {
+		trans_count++;
+		trans_last_us = us;
+		if (us > trans_max_us)
+			trans_max_us = us;
+	}
+	freqs.new = omap_getspeed(0);
 	cpufreq_notify_transition(&freqs, CPUFREQ_POSTCHANGE);
 
 	return ret;
@@ -114,7 +135,17 @@ static int __init omap_cpu_init(struct cpufreq_policy *policy)
 
 	policy->cur = policy->min = policy->max = omap_getspeed(0);
 
-	clk_init_cpufreq_table(&freq_table);
+#ifndef CONFIG_ARCH_OMAP1
+	/* Prefer the OPP table registered for the MPU, if there is one */
+	{
+		struct device *mpu_dev = omap2_get_mpuss_device();
+
+		if (mpu_dev && !opp_init_cpufreq_table(mpu_dev, &freq_table))
+			freq_table_from_opp = true;
+	}
+#endif
+	if (!freq_table)
+		clk_init_cpufreq_table(&freq_table);
 	if (freq_table) {
 		result = cpufreq_frequency_table_cpuinfo(policy, freq_table);
 		if (!result)
@@ -126,7 +157,10 @@ static int __init omap_cpu_init(struct cpufreq_policy *policy)
 							VERY_HI_RATE) / 1000;
 	}
 
-	/* FIXME: what's the actual transition time? */
+	/*
+	 * Rough upper bound for the SRAM rate set switch, DPLL relock
+	 * included; the measured cost is reported in transition_stats.
+	 */
 	policy->cpuinfo.transition_latency = 300 * 1000;
 
 	return 0;
@@ -134,13 +168,27 @@ static int __init omap_cpu_init(struct cpufreq_policy *policy)
 
 static int omap_cpu_exit(struct cpufreq_policy *policy)
 {
-	clk_exit_cpufreq_table(&freq_table);
+	if (freq_table_from_opp) {
+		kfree(freq_table);
+		freq_table = NULL;
+		freq_table_from_opp = false;
+	} else {
+		clk_exit_cpufreq_table(&freq_table);
+	}
 	clk_put(mpu_clk);
 	return 0;
 }
 
+static ssize_t show_transition_stats(struct cpufreq_policy *policy, char *buf)
+{
+	return sprintf(buf, "count %u last_us %u max_us %u\n",
+		       trans_count, trans_last_us, trans_max_us);
+}
+cpufreq_freq_attr_ro(transition_stats);
+
 static struct freq_attr *omap_cpufreq_attr[] = {
 	&cpufreq_freq_attr_scaling_available_freqs,
+	&transition_stats,
 	NULL,
 };
 
@@ -160,7 +208,8 @@ static int __init omap_cpufreq_init(void)
 	return cpufreq_register_driver(&omap_driver);
 }
 
-arch_initcall(omap_cpufreq_init);
+/* Registered late so the OPP table for the MPU is already populated */
+late_initcall(omap_cpufreq_init);
 
 /*
  * if ever we want to remove this, upon cleanup call:
@@ -35,6 +35,7 @@
 #include <linux/io.h>
 #include <linux/slab.h>
 #include <linux/delay.h>
+#include <linux/scatterlist.h>
 
 #include <asm/system.h>
 #include <mach/hardware.h>
@@ -784,6 +785,9 @@ void omap_free_dma(int lch)
 	dma_chan[lch].dev_id = -1;
 	dma_chan[lch].next_lch = -1;
 	dma_chan[lch].callback = NULL;
+#ifndef CONFIG_ARCH_OMAP1
+	dma_chan[lch].sg_left = 0;
+#endif
 	spin_unlock_irqrestore(&dma_chan_lock, flags);
 }
 EXPORT_SYMBOL(omap_free_dma);
@@ -983,6 +987,9 @@ void omap_stop_dma(int lch)
 		} while (next_lch != -1);
 	}
 
+#ifndef CONFIG_ARCH_OMAP1
+	dma_chan[lch].sg_left = 0;
+#endif
 	dma_chan[lch].flags &= ~OMAP_DMA_ACTIVE;
 }
 EXPORT_SYMBOL(omap_stop_dma);
@@ -1768,6 +1775,117 @@ int omap_get_dma_chain_src_pos(int chain_id)
 	return p->dma_read(CSAC, lch);
 }
 EXPORT_SYMBOL(omap_get_dma_chain_src_pos);
+
+/**
+ * omap_dma_save_desc - capture the current setup of a channel
+ * @lch: channel already configured with the omap_set_dma_* setters
+ * @desc: descriptor to fill
+ *
+ * The descriptor can then be reloaded with omap_dma_load_desc() for each
+ * transfer, which avoids the read-modify-write cycles of the setters.
+ */
+void omap_dma_save_desc(int lch, struct omap_dma_desc *desc)
+{
+	desc->csdp = p->dma_read(CSDP, lch);
+	desc->ccr = p->dma_read(CCR, lch) & ~OMAP_DMA_CCR_EN;
+	desc->cen = p->dma_read(CEN, lch);
+	desc->cfn = p->dma_read(CFN, lch);
+	desc->cssa = p->dma_read(CSSA, lch);
+	desc->cdsa = p->dma_read(CDSA, lch);
+	desc->csei = p->dma_read(CSEI, lch);
+	desc->csfi = p->dma_read(CSFI, lch);
+	desc->cdei = p->dma_read(CDEI, lch);
+	desc->cdfi = p->dma_read(CDFI, lch);
+}
+EXPORT_SYMBOL(omap_dma_save_desc);
+
+/**
+ * omap_dma_load_desc - program a channel from a prepared descriptor
+ * @lch: channel, which must not be running
+ * @desc: descriptor from omap_dma_save_desc()
+ *
+ * Only writes registers; start the channel with omap_start_dma().
+ */
+void omap_dma_load_desc(int lch, const struct omap_dma_desc *desc)
+{
+	p->dma_write(desc->csdp, CSDP, lch);
+	p->dma_write(desc->cen, CEN, lch);
+	p->dma_write(desc->cfn, CFN, lch);
+	p->dma_write(desc->cssa, CSSA, lch);
+	p->dma_write(desc->cdsa, CDSA, lch);
+	p->dma_write(desc->csei, CSEI, lch);
+	p->dma_write(desc->csfi, CSFI, lch);
+	p->dma_write(desc->cdei, CDEI, lch);
+	p->dma_write(desc->cdfi, CDFI, lch);
+	p->dma_write(desc->ccr, CCR, lch);
+}
+EXPORT_SYMBOL(omap_dma_load_desc);
+
+/* Program and start the next scatterlist entry of a channel */
+static int omap_dma_sg_next(int lch)
+{
+	struct omap_dma_lch *c = &dma_chan[lch];
+	struct omap_dma_desc *desc = &c->sg_desc;
+	u32 frame = desc->cen << (desc->csdp & 0x3);
+	u32 len = sg_dma_len(c->sg);
+
+	if (unlikely(!frame || len % frame)) {
+		printk(KERN_ERR "omap_dma: sg entry of %u bytes is not a "
+		       "multiple of the %u byte frame\n", len, frame);
+		c->sg_left = 0;
+		return -EINVAL;
+	}
+
+	if (c->sg_mem_is_dst)
+		desc->cdsa = sg_dma_address(c->sg);
+	else
+		desc->cssa = sg_dma_address(c->sg);
+	desc->cfn = len / frame;
+
+	c->sg = sg_next(c->sg);
+	c->sg_left--;
+
+	omap_dma_load_desc(lch, desc);
+	omap_start_dma(lch);
+
+	return 0;
+}
+
+/**
+ * omap_start_dma_sg - run a channel over a mapped scatterlist
+ * @lch: allocated channel
+ * @desc: prepared descriptor; CEN is the frame size in elements
+ * @sg: scatterlist already mapped with dma_map_sg()
+ * @nents: number of mapped entries
+ * @mem_is_dst: memory is the destination (device to memory transfer)
+ *
+ * Each entry is transferred as one block; the next entry is programmed
+ * from the completion interrupt and the channel callback only runs once
+ * the last block is done or an error stops the list.
+ */
+int omap_start_dma_sg(int lch, const struct omap_dma_desc *desc,
+		      struct scatterlist *sg, int nents, int mem_is_dst)
+{
+	struct omap_dma_lch *c;
+
+	if (unlikely(lch < 0 || lch >= dma_lch_count || nents <= 0))
+		return -EINVAL;
+
+	c = &dma_chan[lch];
+	if (c->dev_id == -1)
+		return -EINVAL;
+	if (c->sg_left)
+		return -EBUSY;
+
+	c->sg_desc = *desc;
+	c->sg = sg;
+	c->sg_left = nents;
+	c->sg_mem_is_dst = mem_is_dst;
+	c->enabled_irqs |= OMAP_DMA_BLOCK_IRQ;
+
+	return omap_dma_sg_next(lch);
+}
+EXPORT_SYMBOL(omap_start_dma_sg);
 #endif	/* ifndef CONFIG_ARCH_OMAP1 */
 
 /*----------------------------------------------------------------------------*/
@@ -1896,6 +2014,15 @@ static int omap2_dma_handle_ch(int ch)
 		p->dma_write(status, CSR, ch);
 	}
 
+	/* Move on to the next entry of a scatter-gather transfer */
+	if (dma_chan[ch].sg_left) {
+		if ((status & OMAP_DMA_BLOCK_IRQ) &&
+		    !(status & OMAP2_DMA_TRANS_ERR_IRQ) &&
+		    !omap_dma_sg_next(ch))
+			return 0;
+		dma_chan[ch].sg_left = 0;
+	}
+
 	if (likely(dma_chan[ch].callback != NULL))
 		dma_chan[ch].callback(ch, status, dma_chan[ch].data);
 
@@ -18,6 +18,7 @@
 #include <linux/module.h>
 #include <linux/platform_device.h>
 #include <linux/timer.h>
+#include <linux/spinlock.h>
 #include <linux/err.h>
 #include <linux/slab.h>
 #include <linux/gpio.h>
@@ -37,18 +38,31 @@ struct gpio_switch {
 
 	u16		debounce_rising;
 	u16		debounce_falling;
+	u16		hw_debounce;
 
 	void (* notify)(void *data, int state);
 	void *notify_data;
 
-	struct work_struct	work;
-	struct timer_list	timer;
+	unsigned long		expires;
+	struct list_head	pending;
 	struct platform_device	pdev;
 
 	struct list_head	node;
 };
 
 static LIST_HEAD(gpio_switches);
+
+/*
+ * Switches waiting for their debounce delay to pass.  One timer and
+ * one work item serve all of them, so a slide opening that bounces
+ * several lines at once is reported in a single pass.
+ */
+static LIST_HEAD(gpio_sw_pending);
+static DEFINE_SPINLOCK(gpio_sw_lock);
+static void gpio_sw_timer_fn(unsigned long arg);
+static DEFINE_TIMER(gpio_sw_timer, gpio_sw_timer_fn, 0, 0);
+static void gpio_sw_handler(struct work_struct *work);
+static DECLARE_WORK(gpio_sw_work, gpio_sw_handler);
 static struct platform_device *gpio_sw_platform_dev;
 static struct platform_driver gpio_sw_driver;
 
@@ -64,6 +78,12 @@ static const char *activity_str[2] = { "inactive", "active" };
  */
 #define OMAP_GPIO_SW_DEFAULT_DEBOUNCE		10
 
+/*
+ * Part of the debounce delay done by the GPIO module, in ms.  The
+ * debounce time is per bank, so all switches use the same value.
+ */
+#define OMAP_GPIO_SW_HW_DEBOUNCE		7
+
 static const char **get_sw_str(struct gpio_switch *sw)
 {
 	switch (sw->type) {
@@ -184,6 +204,14 @@ static ssize_t gpio_sw_direction_show(struct device *dev,
 static DEVICE_ATTR(direction, S_IRUGO, gpio_sw_direction_show, NULL);
 
 
+/* Called with gpio_sw_lock held */
+static void gpio_sw_arm_timer(unsigned long expires)
+{
+	if (!timer_pending(&gpio_sw_timer) ||
+	    time_before(expires, gpio_sw_timer.expires))
+		mod_timer(&gpio_sw_timer, expires);
+}
+
 static irqreturn_t gpio_sw_irq_handler(int irq, void *arg)
 {
 	struct gpio_switch *sw = arg;
@@ -205,35 +233,68 @@ static irqreturn_t gpio_sw_irq_handler(int irq, void *arg)
 		timeout = sw->debounce_rising;
 	else
 		timeout = sw->debounce_falling;
+	if (timeout > sw->hw_debounce)
+		timeout -= sw->hw_debounce;
+	else
+		timeout = 0;
+
+	spin_lock(&gpio_sw_lock);
+	sw->expires = jiffies + msecs_to_jiffies(timeout);
+	list_move_tail(&sw->pending, &gpio_sw_pending);
 	if (!timeout)
-		schedule_work(&sw->work);
+		schedule_work(&gpio_sw_work);
 	else
-		mod_timer(&sw->timer, jiffies + msecs_to_jiffies(timeout));
+		gpio_sw_arm_timer(sw->expires);
+	spin_unlock(&gpio_sw_lock);
 
 	return IRQ_HANDLED;
 }
 
-static void gpio_sw_timer(unsigned long arg)
+static void gpio_sw_timer_fn(unsigned long arg)
 {
-	struct gpio_switch *sw = (struct gpio_switch *) arg;
-
-	schedule_work(&sw->work);
+	schedule_work(&gpio_sw_work);
 }
 
 static void gpio_sw_handler(struct work_struct *work)
 {
-	struct gpio_switch *sw = container_of(work, struct gpio_switch, work);
-	int state;
+	struct gpio_switch *sw, *tmp;
+	unsigned long next = 0;
+	int rearm = 0;
+	LIST_HEAD(due);
+
+	spin_lock_irq(&gpio_sw_lock);
+	list_for_each_entry_safe(sw, tmp, &gpio_sw_pending, pending) {
+		if (time_after_eq(jiffies, sw->expires)) {
+			list_move_tail(&sw->pending, &due);
+		} else if (!rearm || time_before(sw->expires, next)) {
+			next = sw->expires;
+			rearm = 1;
+		}
+	}
+	if (rearm)
+		gpio_sw_arm_timer(next);
 
-	state = gpio_sw_get_state(sw);
-	if (sw->state == state)
-		return;
+	/* A switch bouncing again while we work moves back to the
+	 * pending list, so take them off the local list one by one. */
+	while (!list_empty(&due)) {
+		int state;
 
-	sw->state = state;
-	if (sw->notify != NULL)
-		sw->notify(sw->notify_data, state);
-	sysfs_notify(&sw->pdev.dev.kobj, NULL, "state");
-	print_sw_state(sw, state);
+		sw = list_first_entry(&due, struct gpio_switch, pending);
+		list_del_init(&sw->pending);
+		spin_unlock_irq(&gpio_sw_lock);
+
+		state = gpio_sw_get_state(sw);
+		if (sw->state != state) {
+			sw->state = state;
+			if (sw->notify != NULL)
+				sw->notify(sw->notify_data, state);
+			sysfs_notify(&sw->pdev.dev.kobj, NULL, "state");
+			print_sw_state(sw, state);
+		}
+
+		spin_lock_irq(&gpio_sw_lock);
+	}
+	spin_unlock_irq(&gpio_sw_lock);
 }
 
 static int __init can_do_both_edges(struct gpio_switch *sw)
@@ -250,6 +311,21 @@ static void gpio_sw_release(struct device *dev)
 {
 }
 
+/*
+ * Let the GPIO module filter the first few ms of bouncing, so fewer
+ * edges reach gpio_sw_irq_handler().  Banks without a debounce clock
+ * refuse and the whole delay stays in software.
+ */
+static void __init gpio_sw_set_hw_debounce(struct gpio_switch *sw)
+{
+	if (min(sw->debounce_rising, sw->debounce_falling) <
+	    OMAP_GPIO_SW_HW_DEBOUNCE)
+		return;
+
+	if (gpio_set_debounce(sw->gpio, OMAP_GPIO_SW_HW_DEBOUNCE * 1000) == 0)
+		sw->hw_debounce = OMAP_GPIO_SW_HW_DEBOUNCE;
+}
+
 static int __init new_switch(struct gpio_switch *sw)
 {
 	int r, direction, trigger;
@@ -305,6 +381,9 @@ static int __init new_switch(struct gpio_switch *sw)
 	if (!direction)
 		return 0;
 
+	INIT_LIST_HEAD(&sw->pending);
+	gpio_sw_set_hw_debounce(sw);
+
 	if (can_do_both_edges(sw)) {
 		trigger = IRQF_TRIGGER_FALLING | IRQF_TRIGGER_RISING;
 		sw->both_edges = 1;
@@ -324,12 +403,6 @@ static int __init new_switch(struct gpio_switch *sw)
 		return r;
 	}
 
-	INIT_WORK(&sw->work, gpio_sw_handler);
-	init_timer(&sw->timer);
-
-	sw->timer.function = gpio_sw_timer;
-	sw->timer.data = (unsigned long)sw;
-
 	list_add(&sw->node, &gpio_switches);
 
 	return 0;
@@ -443,13 +516,21 @@ static void gpio_sw_cleanup(void)
 {
 	struct gpio_switch *sw = NULL, *old = NULL;
 
+	list_for_each_entry(sw, &gpio_switches, node)
+		free_irq(OMAP_GPIO_IRQ(sw->gpio), sw);
+
+	spin_lock_irq(&gpio_sw_lock);
+	while (!list_empty(&gpio_sw_pending))
+		list_del_init(gpio_sw_pending.next);
+	spin_unlock_irq(&gpio_sw_lock);
+
+	cancel_work_sync(&gpio_sw_work);
+	del_timer_sync(&gpio_sw_timer);
+	cancel_work_sync(&gpio_sw_work);
+
 	list_for_each_entry(sw, &gpio_switches, node) {
 		if (old != NULL)
 			kfree(old);
-		flush_scheduled_work();
-		del_timer_sync(&sw->timer);
-
-		free_irq(OMAP_GPIO_IRQ(sw->gpio), sw);
 
 		device_remove_file(&sw->pdev.dev, &dev_attr_state);
 		device_remove_file(&sw->pdev.dev, &dev_attr_type);
@@ -151,6 +151,7 @@ struct gpio_bank {
 	u32 saved_risingdetect;
 	u32 level_mask;
 	u32 toggle_mask;
+	u32 acked;
 	spinlock_t lock;
 	struct gpio_chip chip;
 	struct clk *dbck;
@@ -1197,6 +1198,10 @@ static void gpio_irq_handler(unsigned int irq, struct irq_desc *desc)
 		_clear_gpio_irqbank(bank, isr_saved & ~level_mask);
 		_enable_gpio_irqbank(bank, isr_saved & ~level_mask, 1);
 
+		/* the write above acked all of them, so let gpio_ack_irq()
+		skip the per-line status write for these */
+		bank->acked |= isr_saved & ~level_mask;
+
 		/* if there is only edge sensitive GPIO pin interrupts
 		configured, we could unmask GPIO bank interrupt immediately */
 		if (!level_mask && !unmasked) {
@@ -1231,6 +1236,7 @@ static void gpio_irq_handler(unsigned int irq, struct irq_desc *desc)
 			generic_handle_irq(gpio_irq);
 		}
 	}
+	bank->acked = 0;
 	/* if bank has any level sensitive GPIO pin interrupt
 	configured, we must unmask the bank interrupt only after
 	handler(s) are executed in order to avoid spurious bank
@@ -1252,6 +1258,14 @@ static void gpio_ack_irq(struct irq_data *d)
 {
 	unsigned int gpio = d->irq - IH_GPIO_BASE;
 	struct gpio_bank *bank = irq_data_get_irq_chip_data(d);
+	u32 mask = 1 << get_gpio_index(gpio);
+
+	/* already cleared along with the rest of the bank in
+	 * gpio_irq_handler() */
+	if (bank->acked & mask) {
+		bank->acked &= ~mask;
+		return;
+	}
 
 	_clear_gpio_irqstatus(bank, gpio);
 }
@@ -1507,10 +1521,17 @@ static int gpio_debounce(struct gpio_chip *chip, unsigned offset,
 
 	bank = container_of(chip, struct gpio_bank, chip);
 
+	if (!bank->dbck_flag)
+		return -EINVAL;
+
 	if (!bank->dbck) {
-		bank->dbck = clk_get(bank->dev, "dbclk");
-		if (IS_ERR(bank->dbck))
+		struct clk *dbck = clk_get(bank->dev, "dbclk");
+
+		if (IS_ERR(dbck)) {
 			dev_err(bank->dev, "Could not get gpio dbck\n");
+			return PTR_ERR(dbck);
+		}
+		bank->dbck = dbck;
 	}
 
 	spin_lock_irqsave(&bank->lock, flags);
@@ -38,6 +38,8 @@ extern struct sys_timer omap_timer;
 extern bool omap_32k_timer_init(void);
 extern int __init omap_init_clocksource_32k(void);
 extern unsigned long long notrace omap_32k_sched_clock(void);
+extern unsigned long long notrace omap2_gpt_sched_clock(void);
+extern int omap_gpt_sched_clock_enabled;
 
 extern void omap_reserve(void);
 
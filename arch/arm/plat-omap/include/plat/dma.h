@@ -401,6 +401,28 @@ struct omap_dma_channel_params {
 #endif
 };
 
+#ifndef CONFIG_ARCH_OMAP1
+struct scatterlist;
+
+/*
+ * Prepared channel setup.  Captured once with omap_dma_save_desc() after
+ * the channel has been configured with the omap_set_dma_* setters, then
+ * written back in one pass for every later transfer.
+ */
+struct omap_dma_desc {
+	u32 csdp;
+	u32 ccr;
+	u32 cen;
+	u32 cfn;
+	u32 cssa;
+	u32 cdsa;
+	u32 csei;
+	u32 csfi;
+	u32 cdei;
+	u32 cdfi;
+};
+#endif
+
 struct omap_dma_lch {
 	int next_lch;
 	int dev_id;
@@ -416,6 +438,13 @@ struct omap_dma_lch {
 	int state;
 	int chain_id;
 	int status;
+#ifndef CONFIG_ARCH_OMAP1
+	/* required for scatter-gather transfers */
+	struct omap_dma_desc sg_desc;
+	struct scatterlist *sg;
+	int sg_left;
+	int sg_mem_is_dst;
+#endif
 };
 
 struct omap_dma_dev_attr {
@@ -519,6 +548,23 @@ extern int omap_get_dma_chain_src_pos(int chain_id);
 extern int omap_modify_dma_chain_params(int chain_id,
 					struct omap_dma_channel_params params);
 extern int omap_dma_chain_status(int chain_id);
+
+/* Prepared descriptor and scatter-gather APIs */
+extern void omap_dma_save_desc(int lch, struct omap_dma_desc *desc);
+extern void omap_dma_load_desc(int lch, const struct omap_dma_desc *desc);
+extern int omap_start_dma_sg(int lch, const struct omap_dma_desc *desc,
+			     struct scatterlist *sg, int nents,
+			     int mem_is_dst);
+
+static inline void omap_dma_desc_set_xfer(struct omap_dma_desc *desc,
+					  dma_addr_t src, dma_addr_t dst,
+					  u32 elem_count, u32 frame_count)
+{
+	desc->cssa = src;
+	desc->cdsa = dst;
+	desc->cen = elem_count;
+	desc->cfn = frame_count;
+}
 #endif
 
 #if defined(CONFIG_ARCH_OMAP1) && defined(CONFIG_FB_OMAP)
@@ -14,6 +14,7 @@
 
 #define ONENAND_SYNC_READ	(1 << 0)
 #define ONENAND_SYNC_READWRITE	(1 << 1)
+#define ONENAND_FLASH_BBT	(1 << 2)
 
 struct omap_onenand_platform_data {
 	int			cs;
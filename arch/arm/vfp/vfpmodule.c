@@ -13,6 +13,8 @@
 #include <linux/cpu.h>
 #include <linux/kernel.h>
 #include <linux/notifier.h>
+#include <linux/prctl.h>
+#include <linux/seq_file.h>
 #include <linux/signal.h>
 #include <linux/sched.h>
 #include <linux/smp.h>
@@ -42,6 +44,13 @@ union vfp_state *last_VFP_context[NR_CPUS];
  */
 unsigned int VFP_arch;
 
+/*
+ * FPSCR bits for RunFast mode.  With flush-to-zero and default NaN set,
+ * and no trapped exceptions enabled, VFP11 handles subnormal operands in
+ * hardware instead of bouncing them to the support code.
+ */
+#define FPSCR_RUNFAST	(FPSCR_FLUSHTOZERO | FPSCR_DEFAULT_NAN)
+
 /*
  * Per-thread VFP initialization.
  */
@@ -53,7 +62,7 @@ static void vfp_thread_flush(struct thread_info *thread)
 	memset(vfp, 0, sizeof(union vfp_state));
 
 	vfp->hard.fpexc = FPEXC_EN;
-	vfp->hard.fpscr = FPSCR_ROUND_NEAREST;
+	vfp->hard.fpscr = FPSCR_ROUND_NEAREST | thread->vfp_runfast;
 
 	/*
 	 * Disable VFP to ensure we initialize it first.  We must ensure
@@ -274,6 +283,8 @@ void VFP_bounce(u32 trigger, u32 fpexc, struct pt_regs *regs)
 
 	pr_debug("VFP: bounce: trigger %08x fpexc %08x\n", trigger, fpexc);
 
+	current_thread_info()->vfp_bounces++;
+
 	/*
 	 * At this point, FPEXC can have the following configuration:
 	 *
@@ -487,6 +498,66 @@ void vfp_flush_hwstate(struct thread_info *thread)
 	put_cpu();
 }
 
+int vfp_get_runfast(struct task_struct *tsk)
+{
+	if (vfp_vector != vfp_support_entry)
+		return -EINVAL;
+
+	return task_thread_info(tsk)->vfp_runfast ?
+		PR_FP_RUNFAST_ON : PR_FP_RUNFAST_OFF;
+}
+
+/*
+ * Switch the task's FPSCR into or out of RunFast mode.  The mode also
+ * applies to the FPSCR a new program starts with after exec, and is
+ * inherited by children.  Only called for current.
+ */
+int vfp_set_runfast(struct task_struct *tsk, unsigned long val)
+{
+	struct thread_info *thread = task_thread_info(tsk);
+	u32 mode;
+
+	if (vfp_vector != vfp_support_entry)
+		return -EINVAL;
+
+	switch (val) {
+	case PR_FP_RUNFAST_OFF:
+		mode = 0;
+		break;
+	case PR_FP_RUNFAST_ON:
+		mode = FPSCR_RUNFAST;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	/*
+	 * Nobody else may save our hardware state over the saved copy
+	 * between the update and the flush.
+	 */
+	preempt_disable();
+	vfp_sync_hwstate(thread);
+	thread->vfp_runfast = mode;
+	thread->vfpstate.hard.fpscr &= ~FPSCR_RUNFAST;
+	thread->vfpstate.hard.fpscr |= mode;
+	vfp_flush_hwstate(thread);
+	preempt_enable();
+
+	return 0;
+}
+
+void arch_task_status(struct seq_file *m, struct task_struct *tsk)
+{
+	struct thread_info *thread = task_thread_info(tsk);
+
+	if (vfp_vector != vfp_support_entry)
+		return;
+
+	seq_printf(m, "VfpRunFast:\t%u\n"
+		      "VfpBounces:\t%lu\n",
+		   thread->vfp_runfast ? 1 : 0, thread->vfp_bounces);
+}
+
 /*
  * VFP hardware can lose all context when a CPU goes offline.
  * Safely clear our held state when a CPU has been killed, and
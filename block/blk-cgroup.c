@@ -399,7 +399,8 @@ void blkiocg_update_dispatch_stats(struct blkio_group *blkg,
 EXPORT_SYMBOL_GPL(blkiocg_update_dispatch_stats);
 
 void blkiocg_update_completion_stats(struct blkio_group *blkg,
-	uint64_t start_time, uint64_t io_start_time, bool direction, bool sync)
+	uint64_t start_time, uint64_t io_start_time, bool direction, bool sync,
+	bool discard)
 {
 	struct blkio_group_stats *stats;
 	unsigned long flags;
@@ -413,6 +414,15 @@ void blkiocg_update_completion_stats(struct blkio_group *blkg,
 	if (time_after64(io_start_time, start_time))
 		blkio_add_stat(stats->stat_arr[BLKIO_STAT_WAIT_TIME],
 				io_start_time - start_time, direction, sync);
+	if (time_after64(now, start_time)) {
+		uint64_t latency = now - start_time;
+		int dir = discard ? DISK_LAT_DISCARD : direction;
+
+		if (latency > stats->max_latency)
+			stats->max_latency = latency;
+		stats->lat_hist[dir][disk_lat_bucket(div_u64(latency,
+							NSEC_PER_USEC))]++;
+	}
 	spin_unlock_irqrestore(&blkg->stats_lock, flags);
 }
 EXPORT_SYMBOL_GPL(blkiocg_update_completion_stats);
@@ -589,6 +599,38 @@ static uint64_t blkio_fill_stat(char *str, int chars_left, uint64_t val,
 	return val;
 }
 
+/* Only non-empty buckets are shown, keyed by their upper bound in us */
+static uint64_t blkio_get_lat_hist(struct blkio_group *blkg,
+		struct cgroup_map_cb *cb, dev_t dev)
+{
+	static const char * const names[DISK_LAT_NR] = {
+		[DISK_LAT_READ]		= "Read",
+		[DISK_LAT_WRITE]	= "Write",
+		[DISK_LAT_DISCARD]	= "Discard",
+	};
+	char key_str[MAX_KEY_LEN];
+	uint64_t val, total = 0;
+	int dir, i;
+
+	for (dir = 0; dir < DISK_LAT_NR; dir++) {
+		for (i = 0; i < DISK_LAT_BUCKETS; i++) {
+			val = blkg->stats.lat_hist[dir][i];
+			if (!val)
+				continue;
+			if (i == DISK_LAT_BUCKETS - 1)
+				snprintf(key_str, MAX_KEY_LEN, "%d:%d %s max",
+					 MAJOR(dev), MINOR(dev), names[dir]);
+			else
+				snprintf(key_str, MAX_KEY_LEN, "%d:%d %s %lu",
+					 MAJOR(dev), MINOR(dev), names[dir],
+					 1UL << i);
+			cb->fill(cb, key_str, val);
+			total += val;
+		}
+	}
+	return total;
+}
+
 /* This should be called with blkg->stats_lock held */
 static uint64_t blkio_get_stat(struct blkio_group *blkg,
 		struct cgroup_map_cb *cb, dev_t dev, enum stat_type type)
@@ -603,6 +645,11 @@ static uint64_t blkio_get_stat(struct blkio_group *blkg,
 	if (type == BLKIO_STAT_SECTORS)
 		return blkio_fill_stat(key_str, MAX_KEY_LEN - 1,
 					blkg->stats.sectors, cb, dev);
+	if (type == BLKIO_STAT_MAX_LATENCY)
+		return blkio_fill_stat(key_str, MAX_KEY_LEN - 1,
+					blkg->stats.max_latency, cb, dev);
+	if (type == BLKIO_STAT_LAT_HIST)
+		return blkio_get_lat_hist(blkg, cb, dev);
 #ifdef CONFIG_DEBUG_BLK_CGROUP
 	if (type == BLKIO_STAT_AVG_QUEUE_SIZE) {
 		uint64_t sum = blkg->stats.avg_queue_size_sum;
@@ -1118,6 +1165,12 @@ static int blkiocg_file_read_map(struct cgroup *cgrp, struct cftype *cft,
 		case BLKIO_PROP_io_wait_time:
 			return blkio_read_blkg_stats(blkcg, cft, cb,
 						BLKIO_STAT_WAIT_TIME, 1);
+		case BLKIO_PROP_io_max_latency:
+			return blkio_read_blkg_stats(blkcg, cft, cb,
+						BLKIO_STAT_MAX_LATENCY, 0);
+		case BLKIO_PROP_io_latency_hist:
+			return blkio_read_blkg_stats(blkcg, cft, cb,
+						BLKIO_STAT_LAT_HIST, 0);
 		case BLKIO_PROP_io_merged:
 			return blkio_read_blkg_stats(blkcg, cft, cb,
 						BLKIO_STAT_MERGED, 1);
@@ -1285,6 +1338,18 @@ struct cftype blkio_files[] = {
 				BLKIO_PROP_io_wait_time),
 		.read_map = blkiocg_file_read_map,
 	},
+	{
+		.name = "io_max_latency",
+		.private = BLKIOFILE_PRIVATE(BLKIO_POLICY_PROP,
+				BLKIO_PROP_io_max_latency),
+		.read_map = blkiocg_file_read_map,
+	},
+	{
+		.name = "io_latency_hist",
+		.private = BLKIOFILE_PRIVATE(BLKIO_POLICY_PROP,
+				BLKIO_PROP_io_latency_hist),
+		.read_map = blkiocg_file_read_map,
+	},
 	{
 		.name = "io_merged",
 		.private = BLKIOFILE_PRIVATE(BLKIO_POLICY_PROP,
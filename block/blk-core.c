@@ -27,11 +27,13 @@
 #include <linux/writeback.h>
 #include <linux/task_io_accounting_ops.h>
 #include <linux/fault-inject.h>
+#include <linux/list_sort.h>
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/block.h>
 
 #include "blk.h"
+#include "blk-mq.h"
 
 EXPORT_TRACEPOINT_SYMBOL_GPL(block_bio_remap);
 EXPORT_TRACEPOINT_SYMBOL_GPL(block_rq_remap);
@@ -475,6 +477,9 @@ void blk_cleanup_queue(struct request_queue *q)
 	if (q->elevator)
 		elevator_exit(q->elevator);
 
+	if (q->mq_ops)
+		blk_mq_free_queue(q);
+
 	blk_put_queue(q);
 }
 EXPORT_SYMBOL(blk_cleanup_queue);
@@ -1198,15 +1203,122 @@ static inline bool queue_should_plug(struct request_queue *q)
 	return !(blk_queue_nonrot(q) && blk_queue_tagged(q));
 }
 
+static bool bio_attempt_back_merge(struct request_queue *q,
+				   struct request *req, struct bio *bio)
+{
+	const unsigned long ff = bio->bi_rw & REQ_FAILFAST_MASK;
+
+	if (!ll_back_merge_fn(q, req, bio))
+		return false;
+
+	trace_block_bio_backmerge(q, bio);
+
+	if ((req->cmd_flags & REQ_FAILFAST_MASK) != ff)
+		blk_rq_set_mixed_merge(req);
+
+	req->biotail->bi_next = bio;
+	req->biotail = bio;
+	req->__data_len += bio->bi_size;
+	req->ioprio = ioprio_best(req->ioprio, bio_prio(bio));
+	if (!blk_rq_cpu_valid(req))
+		req->cpu = bio->bi_comp_cpu;
+	elv_bio_merged(q, req, bio);
+	return true;
+}
+
+static bool bio_attempt_front_merge(struct request_queue *q,
+				    struct request *req, struct bio *bio)
+{
+	const unsigned long ff = bio->bi_rw & REQ_FAILFAST_MASK;
+
+	if (!ll_front_merge_fn(q, req, bio))
+		return false;
+
+	trace_block_bio_frontmerge(q, bio);
+
+	if ((req->cmd_flags & REQ_FAILFAST_MASK) != ff) {
+		blk_rq_set_mixed_merge(req);
+		req->cmd_flags &= ~REQ_FAILFAST_MASK;
+		req->cmd_flags |= ff;
+	}
+
+	bio->bi_next = req->bio;
+	req->bio = bio;
+
+	/*
+	 * may not be valid. if the low level driver said
+	 * it didn't need a bounce buffer then it better
+	 * not touch req->buffer either...
+	 */
+	req->buffer = bio_data(bio);
+	req->__sector = bio->bi_sector;
+	req->__data_len += bio->bi_size;
+	req->ioprio = ioprio_best(req->ioprio, bio_prio(bio));
+	if (!blk_rq_cpu_valid(req))
+		req->cpu = bio->bi_comp_cpu;
+	elv_bio_merged(q, req, bio);
+	return true;
+}
+
+/*
+ * Requests on a plug list are private to the submitting task and not yet
+ * accounted to a partition, so merges into them are counted here without
+ * the queue lock.
+ */
+static void plug_merge_stat_acct(struct request *rq)
+{
+	struct hd_struct *part;
+	int cpu;
+
+	if (!blk_do_io_stat(rq))
+		return;
+
+	cpu = part_stat_lock();
+	part = disk_map_sector_rcu(rq->rq_disk, blk_rq_pos(rq));
+	part_stat_inc(cpu, part, merges[rq_data_dir(rq)]);
+	part_stat_unlock();
+}
+
+/*
+ * Try to merge @bio into a request sitting on the current task's plug
+ * list.  No locks are needed, nobody else can see those requests.
+ */
+static bool attempt_plug_merge(struct task_struct *tsk,
+			       struct request_queue *q, struct bio *bio)
+{
+	struct blk_plug *plug = tsk->plug;
+	struct request *rq;
+
+	if (!plug || blk_queue_nomerges(q))
+		return false;
+
+	list_for_each_entry_reverse(rq, &plug->list, queuelist) {
+		if (rq->q != q || !rq_mergeable(rq))
+			continue;
+		if (!elv_rq_merge_ok(rq, bio))
+			continue;
+
+		if (blk_rq_pos(rq) + blk_rq_sectors(rq) == bio->bi_sector) {
+			if (bio_attempt_back_merge(q, rq, bio))
+				goto merged;
+		} else if (bio->bi_sector + bio_sectors(bio) == blk_rq_pos(rq)) {
+			if (bio_attempt_front_merge(q, rq, bio))
+				goto merged;
+		}
+	}
+	return false;
+merged:
+	plug_merge_stat_acct(rq);
+	return true;
+}
+
 static int __make_request(struct request_queue *q, struct bio *bio)
 {
 	struct request *req;
+	struct blk_plug *plug;
 	int el_ret;
-	unsigned int bytes = bio->bi_size;
-	const unsigned short prio = bio_prio(bio);
 	const bool sync = !!(bio->bi_rw & REQ_SYNC);
 	const bool unplug = !!(bio->bi_rw & REQ_UNPLUG);
-	const unsigned long ff = bio->bi_rw & REQ_FAILFAST_MASK;
 	int where = ELEVATOR_INSERT_SORT;
 	int rw_flags;
 
@@ -1217,13 +1329,21 @@ static int __make_request(struct request_queue *q, struct bio *bio)
 	 */
 	blk_queue_bounce(q, &bio);
 
-	spin_lock_irq(q->queue_lock);
-
 	if (bio->bi_rw & (REQ_FLUSH | REQ_FUA)) {
+		spin_lock_irq(q->queue_lock);
 		where = ELEVATOR_INSERT_FRONT;
 		goto get_rq;
 	}
 
+	/*
+	 * Check if we can merge with the plugged list before grabbing
+	 * any locks.
+	 */
+	if (attempt_plug_merge(current, q, bio))
+		return 0;
+
+	spin_lock_irq(q->queue_lock);
+
 	if (elv_queue_empty(q))
 		goto get_rq;
 
@@ -1232,22 +1352,10 @@ static int __make_request(struct request_queue *q, struct bio *bio)
 	case ELEVATOR_BACK_MERGE:
 		BUG_ON(!rq_mergeable(req));
 
-		if (!ll_back_merge_fn(q, req, bio))
+		if (!bio_attempt_back_merge(q, req, bio))
 			break;
 
-		trace_block_bio_backmerge(q, bio);
-
-		if ((req->cmd_flags & REQ_FAILFAST_MASK) != ff)
-			blk_rq_set_mixed_merge(req);
-
-		req->biotail->bi_next = bio;
-		req->biotail = bio;
-		req->__data_len += bytes;
-		req->ioprio = ioprio_best(req->ioprio, prio);
-		if (!blk_rq_cpu_valid(req))
-			req->cpu = bio->bi_comp_cpu;
 		drive_stat_acct(req, 0);
-		elv_bio_merged(q, req, bio);
 		if (!attempt_back_merge(q, req))
 			elv_merged_request(q, req, el_ret);
 		goto out;
@@ -1255,33 +1363,10 @@ static int __make_request(struct request_queue *q, struct bio *bio)
 	case ELEVATOR_FRONT_MERGE:
 		BUG_ON(!rq_mergeable(req));
 
-		if (!ll_front_merge_fn(q, req, bio))
+		if (!bio_attempt_front_merge(q, req, bio))
 			break;
 
-		trace_block_bio_frontmerge(q, bio);
-
-		if ((req->cmd_flags & REQ_FAILFAST_MASK) != ff) {
-			blk_rq_set_mixed_merge(req);
-			req->cmd_flags &= ~REQ_FAILFAST_MASK;
-			req->cmd_flags |= ff;
-		}
-
-		bio->bi_next = req->bio;
-		req->bio = bio;
-
-		/*
-		 * may not be valid. if the low level driver said
-		 * it didn't need a bounce buffer then it better
-		 * not touch req->buffer either...
-		 */
-		req->buffer = bio_data(bio);
-		req->__sector = bio->bi_sector;
-		req->__data_len += bytes;
-		req->ioprio = ioprio_best(req->ioprio, prio);
-		if (!blk_rq_cpu_valid(req))
-			req->cpu = bio->bi_comp_cpu;
 		drive_stat_acct(req, 0);
-		elv_bio_merged(q, req, bio);
 		if (!attempt_front_merge(q, req))
 			elv_merged_request(q, req, el_ret);
 		goto out;
@@ -1315,10 +1400,31 @@ get_rq:
 	 */
 	init_request_from_bio(req, bio);
 
-	spin_lock_irq(q->queue_lock);
 	if (test_bit(QUEUE_FLAG_SAME_COMP, &q->queue_flags) ||
 	    bio_flagged(bio, BIO_CPU_AFFINE))
-		req->cpu = blk_cpu_to_group(smp_processor_id());
+		req->cpu = blk_cpu_to_group(raw_smp_processor_id());
+
+	plug = current->plug;
+	if (plug && where == ELEVATOR_INSERT_SORT) {
+		/*
+		 * Keep the list in submission order; only requests for
+		 * several queues need sorting when it is flushed.
+		 */
+		if (list_empty(&plug->list))
+			trace_block_plug(q);
+		else {
+			if (!plug->should_sort &&
+			    list_entry_rq(plug->list.prev)->q != q)
+				plug->should_sort = 1;
+			if (plug->count >= BLK_MAX_REQUEST_COUNT)
+				blk_flush_plug_list(plug, false);
+		}
+		list_add_tail(&req->queuelist, &plug->list);
+		plug->count++;
+		return 0;
+	}
+
+	spin_lock_irq(q->queue_lock);
 	if (queue_should_plug(q) && elv_queue_empty(q))
 		blk_plug_device(q);
 
@@ -1332,6 +1438,112 @@ out:
 	return 0;
 }
 
+#define PLUG_MAGIC	0x91827364
+
+/**
+ * blk_start_plug - initialize blk_plug and track it inside the task_struct
+ * @plug:	The &struct blk_plug that needs to be initialized
+ *
+ * Description:
+ *   Requests submitted by the current task are collected on @plug
+ *   instead of going to the queue one by one, until blk_finish_plug()
+ *   is called or the task blocks.  Nested plugs are folded into the
+ *   outermost one.
+ */
+void blk_start_plug(struct blk_plug *plug)
+{
+	struct task_struct *tsk = current;
+
+	plug->magic = PLUG_MAGIC;
+	INIT_LIST_HEAD(&plug->list);
+	plug->should_sort = 0;
+	plug->count = 0;
+
+	if (!tsk->plug)
+		tsk->plug = plug;
+}
+EXPORT_SYMBOL(blk_start_plug);
+
+static int plug_rq_cmp(void *priv, struct list_head *a, struct list_head *b)
+{
+	struct request *rqa = container_of(a, struct request, queuelist);
+	struct request *rqb = container_of(b, struct request, queuelist);
+
+	return !(rqa->q <= rqb->q);
+}
+
+static void queue_unplugged(struct request_queue *q, bool from_schedule)
+	__releases(q->queue_lock)
+{
+	trace_block_unplug_io(q);
+	__blk_run_queue(q, from_schedule);
+	spin_unlock(q->queue_lock);
+}
+
+/**
+ * blk_flush_plug_list - hand the plugged requests to their queues
+ * @plug:	The &struct blk_plug to flush
+ * @from_schedule: called from the scheduler, defer running the queues
+ *		   to kblockd rather than growing the stack of schedule()
+ *
+ * Description:
+ *   Inserts every plugged request in its elevator and runs the queue,
+ *   taking each queue_lock once per batch of requests for that queue.
+ */
+void blk_flush_plug_list(struct blk_plug *plug, bool from_schedule)
+{
+	struct request_queue *q;
+	unsigned long flags;
+	struct request *rq;
+	LIST_HEAD(list);
+
+	BUG_ON(plug->magic != PLUG_MAGIC);
+
+	if (list_empty(&plug->list))
+		return;
+
+	list_splice_init(&plug->list, &list);
+	plug->count = 0;
+
+	if (plug->should_sort) {
+		list_sort(NULL, &list, plug_rq_cmp);
+		plug->should_sort = 0;
+	}
+
+	q = NULL;
+	local_irq_save(flags);
+	while (!list_empty(&list)) {
+		rq = list_entry_rq(list.next);
+		list_del_init(&rq->queuelist);
+		BUG_ON(!rq->q);
+		if (rq->q != q) {
+			if (q)
+				queue_unplugged(q, from_schedule);
+			q = rq->q;
+			spin_lock(q->queue_lock);
+		}
+		drive_stat_acct(rq, 1);
+		__elv_add_request(q, rq, ELEVATOR_INSERT_SORT, 0);
+	}
+	if (q)
+		queue_unplugged(q, from_schedule);
+	local_irq_restore(flags);
+}
+EXPORT_SYMBOL(blk_flush_plug_list);
+
+/**
+ * blk_finish_plug - flush a plug started by blk_start_plug()
+ * @plug:	The &struct blk_plug passed to blk_start_plug()
+ */
+void blk_finish_plug(struct blk_plug *plug)
+{
+	blk_flush_plug_list(plug, false);
+
+	if (plug == current->plug)
+		current->plug = NULL;
+}
+EXPORT_SYMBOL(blk_finish_plug);
+
 /*
  * If bio->bi_dev is a partition, remap the location
  */
@@ -1798,6 +2010,22 @@ static void blk_account_io_completion(struct request *req, unsigned int bytes)
 	}
 }
 
+/*
+ * Completion latency for the histograms.  Uses the queueing timestamp
+ * when the blkio controller keeps one, jiffies otherwise.
+ */
+static unsigned long blk_rq_latency_us(struct request *req,
+				       unsigned long duration)
+{
+#ifdef CONFIG_BLK_CGROUP
+	u64 now = sched_clock();
+
+	if (time_after64(now, rq_start_time_ns(req)))
+		return div_u64(now - rq_start_time_ns(req), NSEC_PER_USEC);
+#endif
+	return jiffies_to_usecs(duration);
+}
+
 static void blk_account_io_done(struct request *req)
 {
 	/*
@@ -1808,6 +2036,10 @@ static void blk_account_io_done(struct request *req)
 	if (blk_do_io_stat(req) && req != &req->q->flush_rq) {
 		unsigned long duration = jiffies - req->start_time;
 		const int rw = rq_data_dir(req);
+		const int lat_dir = (req->cmd_flags & REQ_DISCARD) ?
+					DISK_LAT_DISCARD : rw;
+		const int bucket =
+			disk_lat_bucket(blk_rq_latency_us(req, duration));
 		struct hd_struct *part;
 		int cpu;
 
@@ -1816,6 +2048,7 @@ static void blk_account_io_done(struct request *req)
 
 		part_stat_inc(cpu, part, ios[rw]);
 		part_stat_add(cpu, part, ticks[rw], duration);
+		part_stat_inc(cpu, part, lat_hist[lat_dir][bucket]);
 		part_round_stats(cpu, part);
 		part_dec_in_flight(part, rw);
 
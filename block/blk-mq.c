@@ -0,0 +1,462 @@
+/*
+ * Multi-queue request submission: per-CPU software queues mapped onto
+ * driver hardware queues, with per-hardware-queue tags.
+ *
+ * No elevator and no queue_lock on this path.  A bio is turned into a
+ * tagged request on the submitting CPU's software queue and the
+ * hardware queue it maps to is run, either inline for sync I/O or from
+ * kblockd so that async submitters batch up.  Completions are steered
+ * back to the submitting CPU through the block softirq.
+ */
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/bio.h>
+#include <linux/blkdev.h>
+#include <linux/blk-mq.h>
+#include <linux/slab.h>
+#include <linux/percpu.h>
+#include <linux/wait.h>
+#include <linux/sched.h>
+
+#include <trace/events/block.h>
+
+#include "blk.h"
+#include "blk-mq.h"
+
+static struct blk_mq_hw_ctx *blk_mq_map_queue(struct request_queue *q,
+					      unsigned int cpu)
+{
+	return q->queue_hw_ctx[q->mq_map[cpu]];
+}
+
+static bool blk_mq_hctx_has_pending(struct blk_mq_hw_ctx *hctx)
+{
+	return find_first_bit(hctx->ctx_map, hctx->nr_ctx) < hctx->nr_ctx ||
+		!list_empty_careful(&hctx->dispatch);
+}
+
+static struct request *blk_mq_alloc_tag(struct blk_mq_hw_ctx *hctx)
+{
+	unsigned int tag;
+
+	do {
+		tag = find_first_zero_bit(hctx->tag_map, hctx->queue_depth);
+		if (tag >= hctx->queue_depth)
+			return NULL;
+	} while (test_and_set_bit_lock(tag, hctx->tag_map));
+
+	return &hctx->rqs[tag];
+}
+
+/*
+ * Grab a tagged request from the hardware queue the current CPU maps
+ * to, sleeping until one is freed if they are all in flight.
+ */
+static struct request *blk_mq_get_request(struct request_queue *q)
+{
+	struct blk_mq_hw_ctx *hctx;
+	struct blk_mq_ctx *ctx;
+	struct request *rq;
+	DEFINE_WAIT(wait);
+	unsigned int cpu;
+
+	for (;;) {
+		cpu = get_cpu();
+		ctx = per_cpu_ptr(q->queue_ctx, cpu);
+		hctx = blk_mq_map_queue(q, cpu);
+		put_cpu();
+
+		rq = blk_mq_alloc_tag(hctx);
+		if (rq)
+			break;
+
+		/* let the driver make progress before we wait for a tag */
+		blk_mq_run_hw_queue(hctx, false);
+
+		prepare_to_wait(&hctx->tag_wait, &wait, TASK_UNINTERRUPTIBLE);
+		rq = blk_mq_alloc_tag(hctx);
+		if (!rq)
+			io_schedule();
+		finish_wait(&hctx->tag_wait, &wait);
+		if (rq)
+			break;
+	}
+
+	blk_rq_init(q, rq);
+	rq->tag = rq - hctx->rqs;
+	rq->mq_ctx = ctx;
+	return rq;
+}
+
+static void blk_mq_free_request(struct request *rq)
+{
+	struct blk_mq_hw_ctx *hctx = rq->mq_ctx->hctx;
+
+	clear_bit_unlock(rq->tag, hctx->tag_map);
+	smp_mb__after_clear_bit();
+	if (waitqueue_active(&hctx->tag_wait))
+		wake_up(&hctx->tag_wait);
+}
+
+/**
+ * blk_mq_end_io - end all I/O on a multi-queue request
+ * @rq:		the request being completed
+ * @error:	0 for success, < 0 for error
+ *
+ * Description:
+ *     Completes every bio of @rq and gives its tag back to the hardware
+ *     queue.  May be called from any context.
+ */
+void blk_mq_end_io(struct request *rq, int error)
+{
+	blk_update_request(rq, error, blk_rq_bytes(rq));
+
+	if (rq->end_io)
+		rq->end_io(rq, error);
+	else
+		blk_mq_free_request(rq);
+}
+EXPORT_SYMBOL(blk_mq_end_io);
+
+static void blk_mq_softirq_done(struct request *rq)
+{
+	struct request_queue *q = rq->q;
+
+	if (q->mq_ops->complete)
+		q->mq_ops->complete(rq);
+	else
+		blk_mq_end_io(rq, rq->errors);
+}
+
+/**
+ * blk_mq_complete_request - complete a request on its submitting CPU
+ * @rq:		the request being completed
+ *
+ * Description:
+ *     Drivers call this from their interrupt handler; the request is
+ *     finished from the block softirq of the CPU that submitted it.
+ */
+void blk_mq_complete_request(struct request *rq)
+{
+	blk_complete_request(rq);
+}
+EXPORT_SYMBOL(blk_mq_complete_request);
+
+static void __blk_mq_run_hw_queue(struct blk_mq_hw_ctx *hctx)
+{
+	struct request_queue *q = hctx->queue;
+	struct blk_mq_ctx *ctx;
+	struct request *rq;
+	LIST_HEAD(rq_list);
+	unsigned int bit;
+	int ret;
+
+again:
+	if (test_and_set_bit_lock(BLK_MQ_S_RUNNING, &hctx->state))
+		return;
+
+	hctx->run++;
+
+	spin_lock(&hctx->lock);
+	list_splice_init(&hctx->dispatch, &rq_list);
+	spin_unlock(&hctx->lock);
+
+	for_each_set_bit(bit, hctx->ctx_map, hctx->nr_ctx) {
+		clear_bit(bit, hctx->ctx_map);
+		ctx = hctx->ctxs[bit];
+		spin_lock(&ctx->lock);
+		list_splice_tail_init(&ctx->rq_list, &rq_list);
+		spin_unlock(&ctx->lock);
+	}
+
+	while (!list_empty(&rq_list)) {
+		rq = list_first_entry(&rq_list, struct request, queuelist);
+		list_del_init(&rq->queuelist);
+
+		trace_block_rq_issue(q, rq);
+		rq->cmd_flags |= REQ_STARTED;
+
+		ret = q->mq_ops->queue_rq(hctx, rq);
+		if (ret == BLK_MQ_RQ_QUEUE_OK) {
+			hctx->queued++;
+			continue;
+		}
+		if (ret == BLK_MQ_RQ_QUEUE_BUSY) {
+			/*
+			 * Keep the rest in order on ->dispatch, the driver
+			 * restarts us once it has room again.
+			 */
+			list_add(&rq->queuelist, &rq_list);
+			spin_lock(&hctx->lock);
+			list_splice(&rq_list, &hctx->dispatch);
+			spin_unlock(&hctx->lock);
+			blk_mq_stop_hw_queue(hctx);
+			clear_bit_unlock(BLK_MQ_S_RUNNING, &hctx->state);
+			return;
+		}
+		rq->errors = -EIO;
+		blk_mq_end_io(rq, -EIO);
+	}
+
+	clear_bit_unlock(BLK_MQ_S_RUNNING, &hctx->state);
+	smp_mb__after_clear_bit();
+
+	/* somebody may have queued while we held BLK_MQ_S_RUNNING */
+	if (blk_mq_hctx_has_pending(hctx) &&
+	    !test_bit(BLK_MQ_S_STOPPED, &hctx->state))
+		goto again;
+}
+
+/**
+ * blk_mq_run_hw_queue - hand pending requests to the driver
+ * @hctx:	the hardware queue to run
+ * @async:	defer the run to kblockd
+ *
+ * Description:
+ *     A synchronous run must come from process context; interrupt
+ *     handlers have to pass @async.
+ */
+void blk_mq_run_hw_queue(struct blk_mq_hw_ctx *hctx, bool async)
+{
+	if (unlikely(test_bit(BLK_MQ_S_STOPPED, &hctx->state)))
+		return;
+
+	if (async)
+		kblockd_schedule_work(hctx->queue, &hctx->run_work);
+	else
+		__blk_mq_run_hw_queue(hctx);
+}
+EXPORT_SYMBOL(blk_mq_run_hw_queue);
+
+void blk_mq_run_queues(struct request_queue *q, bool async)
+{
+	struct blk_mq_hw_ctx *hctx;
+	unsigned int i;
+
+	queue_for_each_hw_ctx(q, hctx, i) {
+		if (blk_mq_hctx_has_pending(hctx))
+			blk_mq_run_hw_queue(hctx, async);
+	}
+}
+EXPORT_SYMBOL(blk_mq_run_queues);
+
+void blk_mq_stop_hw_queue(struct blk_mq_hw_ctx *hctx)
+{
+	set_bit(BLK_MQ_S_STOPPED, &hctx->state);
+}
+EXPORT_SYMBOL(blk_mq_stop_hw_queue);
+
+void blk_mq_start_stopped_hw_queue(struct blk_mq_hw_ctx *hctx)
+{
+	if (test_and_clear_bit(BLK_MQ_S_STOPPED, &hctx->state))
+		blk_mq_run_hw_queue(hctx, true);
+}
+EXPORT_SYMBOL(blk_mq_start_stopped_hw_queue);
+
+static void blk_mq_run_work_fn(struct work_struct *work)
+{
+	struct blk_mq_hw_ctx *hctx =
+		container_of(work, struct blk_mq_hw_ctx, run_work);
+
+	__blk_mq_run_hw_queue(hctx);
+}
+
+static void blk_mq_unplug(struct request_queue *q)
+{
+	blk_mq_run_queues(q, false);
+}
+
+static int blk_mq_make_request(struct request_queue *q, struct bio *bio)
+{
+	const bool sync = rw_is_sync(bio->bi_rw) ||
+			  (bio->bi_rw & REQ_UNPLUG);
+	struct blk_mq_hw_ctx *hctx;
+	struct blk_mq_ctx *ctx;
+	struct request *rq;
+
+	blk_queue_bounce(q, &bio);
+
+	rq = blk_mq_get_request(q);
+	init_request_from_bio(rq, bio);
+
+	/* complete on the submitting CPU */
+	ctx = rq->mq_ctx;
+	hctx = ctx->hctx;
+	rq->cpu = ctx->cpu;
+
+	spin_lock(&ctx->lock);
+	list_add_tail(&rq->queuelist, &ctx->rq_list);
+	spin_unlock(&ctx->lock);
+	if (!test_bit(ctx->index_hw, hctx->ctx_map))
+		set_bit(ctx->index_hw, hctx->ctx_map);
+	/* pairs with the pending check after BLK_MQ_S_RUNNING is dropped */
+	smp_mb();
+
+	blk_mq_run_hw_queue(hctx, !sync);
+	return 0;
+}
+
+static void blk_mq_free_hw_queues(struct request_queue *q)
+{
+	struct blk_mq_hw_ctx *hctx;
+	unsigned int i;
+
+	for (i = 0; q->queue_hw_ctx && i < q->nr_hw_queues; i++) {
+		hctx = q->queue_hw_ctx[i];
+		if (!hctx)
+			continue;
+		kfree(hctx->rqs);
+		kfree(hctx->tag_map);
+		kfree(hctx->ctx_map);
+		kfree(hctx->ctxs);
+		kfree(hctx);
+	}
+	kfree(q->queue_hw_ctx);
+	free_percpu(q->queue_ctx);
+	kfree(q->mq_map);
+}
+
+static int blk_mq_init_hw_queues(struct request_queue *q,
+				 struct blk_mq_reg *reg)
+{
+	struct blk_mq_hw_ctx *hctx;
+	unsigned int i;
+	int node = reg->numa_node;
+
+	q->nr_hw_queues = reg->nr_hw_queues;
+	q->mq_map = kcalloc(nr_cpu_ids, sizeof(*q->mq_map), GFP_KERNEL);
+	q->queue_ctx = alloc_percpu(struct blk_mq_ctx);
+	q->queue_hw_ctx = kzalloc_node(reg->nr_hw_queues * sizeof(hctx),
+				       GFP_KERNEL, node);
+	if (!q->mq_map || !q->queue_ctx || !q->queue_hw_ctx)
+		return -ENOMEM;
+
+	for (i = 0; i < reg->nr_hw_queues; i++) {
+		hctx = kzalloc_node(sizeof(*hctx), GFP_KERNEL, node);
+		if (!hctx)
+			return -ENOMEM;
+		q->queue_hw_ctx[i] = hctx;
+
+		spin_lock_init(&hctx->lock);
+		INIT_LIST_HEAD(&hctx->dispatch);
+		INIT_WORK(&hctx->run_work, blk_mq_run_work_fn);
+		init_waitqueue_head(&hctx->tag_wait);
+		hctx->queue = q;
+		hctx->queue_num = i;
+		hctx->queue_depth = reg->queue_depth;
+
+		hctx->ctxs = kcalloc(nr_cpu_ids, sizeof(*hctx->ctxs),
+				     GFP_KERNEL);
+		hctx->ctx_map = kzalloc(BITS_TO_LONGS(nr_cpu_ids) *
+					sizeof(long), GFP_KERNEL);
+		hctx->tag_map = kzalloc(BITS_TO_LONGS(reg->queue_depth) *
+					sizeof(long), GFP_KERNEL);
+		hctx->rqs = kcalloc(reg->queue_depth, sizeof(struct request),
+				    GFP_KERNEL);
+		if (!hctx->ctxs || !hctx->ctx_map || !hctx->tag_map ||
+		    !hctx->rqs)
+			return -ENOMEM;
+	}
+
+	/*
+	 * Spread the CPUs over the hardware queues; each software queue
+	 * takes the next bit of its hardware queue's ctx_map.
+	 */
+	for_each_possible_cpu(i) {
+		struct blk_mq_ctx *ctx = per_cpu_ptr(q->queue_ctx, i);
+
+		q->mq_map[i] = i % reg->nr_hw_queues;
+		hctx = blk_mq_map_queue(q, i);
+
+		spin_lock_init(&ctx->lock);
+		INIT_LIST_HEAD(&ctx->rq_list);
+		ctx->cpu = i;
+		ctx->queue = q;
+		ctx->hctx = hctx;
+		ctx->index_hw = hctx->nr_ctx;
+		hctx->ctxs[hctx->nr_ctx++] = ctx;
+	}
+
+	return 0;
+}
+
+/**
+ * blk_mq_init_queue - set up a multi-queue request queue
+ * @reg:	driver description: ops, number and depth of hardware queues
+ * @driver_data: stored in ->queuedata and passed to ->init_hctx()
+ *
+ * Description:
+ *     Returns a queue whose bios bypass the elevator and are handed to
+ *     @reg->ops->queue_rq() as tagged requests, or %NULL on failure.
+ *     Per-partition I/O accounting and request timeouts are not done
+ *     for these queues; the driver owns error handling.
+ */
+struct request_queue *blk_mq_init_queue(struct blk_mq_reg *reg,
+					void *driver_data)
+{
+	struct request_queue *q;
+	struct blk_mq_hw_ctx *hctx;
+	unsigned int i;
+
+	if (!reg->ops || !reg->ops->queue_rq || !reg->nr_hw_queues ||
+	    !reg->queue_depth || reg->queue_depth > BLK_MQ_MAX_DEPTH)
+		return NULL;
+
+	q = blk_alloc_queue_node(GFP_KERNEL, reg->numa_node);
+	if (!q)
+		return NULL;
+
+	if (blk_mq_init_hw_queues(q, reg))
+		goto err_free;
+
+	q->queuedata = driver_data;
+	q->mq_ops = reg->ops;
+
+	blk_queue_make_request(q, blk_mq_make_request);
+	q->unplug_fn = blk_mq_unplug;
+	blk_queue_softirq_done(q, blk_mq_softirq_done);
+
+	queue_flag_clear_unlocked(QUEUE_FLAG_IO_STAT, q);
+	queue_flag_set_unlocked(QUEUE_FLAG_SAME_COMP, q);
+	queue_flag_set_unlocked(QUEUE_FLAG_SAME_FORCE, q);
+
+	queue_for_each_hw_ctx(q, hctx, i) {
+		if (reg->ops->init_hctx &&
+		    reg->ops->init_hctx(hctx, driver_data, i))
+			goto err_exit;
+	}
+
+	return q;
+
+err_exit:
+	while (i--) {
+		hctx = q->queue_hw_ctx[i];
+		if (reg->ops->exit_hctx)
+			reg->ops->exit_hctx(hctx, i);
+	}
+err_free:
+	blk_mq_free_hw_queues(q);
+	q->mq_ops = NULL;
+	q->nr_hw_queues = 0;
+	blk_cleanup_queue(q);
+	return NULL;
+}
+EXPORT_SYMBOL(blk_mq_init_queue);
+
+/*
+ * Called from blk_cleanup_queue(), once no more I/O can be submitted.
+ */
+void blk_mq_free_queue(struct request_queue *q)
+{
+	struct blk_mq_hw_ctx *hctx;
+	unsigned int i;
+
+	queue_for_each_hw_ctx(q, hctx, i) {
+		cancel_work_sync(&hctx->run_work);
+		if (q->mq_ops->exit_hctx)
+			q->mq_ops->exit_hctx(hctx, i);
+	}
+	blk_mq_free_hw_queues(q);
+	q->mq_ops = NULL;
+	q->nr_hw_queues = 0;
+}
@@ -0,0 +1,18 @@
+#ifndef INT_BLK_MQ_H
+#define INT_BLK_MQ_H
+
+/*
+ * Per-CPU software submission queue.
+ */
+struct blk_mq_ctx {
+	spinlock_t		lock;
+	struct list_head	rq_list;
+	unsigned int		cpu;
+	unsigned int		index_hw;	/* bit in hctx->ctx_map */
+	struct blk_mq_hw_ctx	*hctx;
+	struct request_queue	*queue;
+} ____cacheline_aligned_in_smp;
+
+void blk_mq_free_queue(struct request_queue *q);
+
+#endif
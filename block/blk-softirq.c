@@ -105,13 +105,14 @@ void __blk_complete_request(struct request *req)
 {
 	struct request_queue *q = req->q;
 	unsigned long flags;
-	int ccpu, cpu, group_cpu;
+	int ccpu, cpu, group_cpu = -1;
 
 	BUG_ON(!q->softirq_done_fn);
 
 	local_irq_save(flags);
 	cpu = smp_processor_id();
-	group_cpu = blk_cpu_to_group(cpu);
+	if (!test_bit(QUEUE_FLAG_SAME_FORCE, &q->queue_flags))
+		group_cpu = blk_cpu_to_group(cpu);
 
 	/*
 	 * Select completion CPU
@@ -27,6 +27,8 @@
 #include <linux/sched.h>
 #include <linux/async.h>
 #include <linux/suspend.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include "../base.h"
 #include "power.h"
@@ -152,6 +154,132 @@ void device_pm_move_last(struct device *dev)
 	list_move_tail(&dev->power.entry, &dpm_list);
 }
 
+static char *pm_verb(int event);
+
+#ifdef CONFIG_PM_SLEEP_TIMING
+/*
+ * Ring buffer of the most recent suspend/resume callback durations.
+ * Timestamps come from sched_clock() so that entries can also be
+ * recorded after timekeeping has been suspended.
+ */
+#define DPM_TIMING_ENTRIES	256
+
+struct dpm_timing_entry {
+	char name[24];
+	const char *info;
+	int event;
+	int error;
+	u64 start;
+	u64 duration;
+};
+
+static struct dpm_timing_entry dpm_timing_log[DPM_TIMING_ENTRIES];
+static unsigned int dpm_timing_count;
+static DEFINE_SPINLOCK(dpm_timing_lock);
+
+/**
+ * dpm_timing_record - Add an entry to the suspend/resume timing log.
+ * @name: Device or platform step the entry belongs to.
+ * @info: Phase description; must be a static string.
+ * @event: PM event being carried out.
+ * @start: sched_clock() value taken when the step started.
+ * @error: Result of the step.
+ */
+void dpm_timing_record(const char *name, const char *info, int event,
+		       u64 start, int error)
+{
+	struct dpm_timing_entry *e;
+	unsigned long flags;
+	u64 now = sched_clock();
+
+	spin_lock_irqsave(&dpm_timing_lock, flags);
+	e = &dpm_timing_log[dpm_timing_count++ % DPM_TIMING_ENTRIES];
+	strlcpy(e->name, name, sizeof(e->name));
+	e->info = info;
+	e->event = event;
+	e->error = error;
+	e->start = start;
+	e->duration = now - start;
+	spin_unlock_irqrestore(&dpm_timing_lock, flags);
+}
+EXPORT_SYMBOL_GPL(dpm_timing_record);
+
+static int dpm_timing_show(struct seq_file *s, void *unused)
+{
+	struct dpm_timing_entry e;
+	unsigned int i, first;
+	unsigned long flags, rem;
+	u64 start, usecs;
+
+	spin_lock_irqsave(&dpm_timing_lock, flags);
+	first = dpm_timing_count > DPM_TIMING_ENTRIES ?
+		dpm_timing_count - DPM_TIMING_ENTRIES : 0;
+	spin_unlock_irqrestore(&dpm_timing_lock, flags);
+
+	for (i = first; ; i++) {
+		spin_lock_irqsave(&dpm_timing_lock, flags);
+		if (i >= dpm_timing_count) {
+			spin_unlock_irqrestore(&dpm_timing_lock, flags);
+			break;
+		}
+		e = dpm_timing_log[i % DPM_TIMING_ENTRIES];
+		spin_unlock_irqrestore(&dpm_timing_lock, flags);
+
+		start = e.start;
+		rem = do_div(start, NSEC_PER_SEC);
+		usecs = e.duration;
+		do_div(usecs, NSEC_PER_USEC);
+		seq_printf(s, "%5llu.%06lu %-24s %s%s %d %llu us\n",
+			   (unsigned long long)start, rem / NSEC_PER_USEC,
+			   e.name, e.info, pm_verb(e.event), e.error,
+			   (unsigned long long)usecs);
+	}
+
+	return 0;
+}
+
+static int dpm_timing_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dpm_timing_show, NULL);
+}
+
+static const struct file_operations dpm_timing_fops = {
+	.open		= dpm_timing_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init dpm_timing_init(void)
+{
+	debugfs_create_file("suspend_timing", S_IRUGO, NULL, NULL,
+			    &dpm_timing_fops);
+	return 0;
+}
+late_initcall(dpm_timing_init);
+
+static inline u64 dpm_timing_start(void)
+{
+	return sched_clock();
+}
+
+static inline void dpm_timing_report(struct device *dev, char *info,
+				     pm_message_t state, u64 start, int error)
+{
+	dpm_timing_record(dev_name(dev), info, state.event, start, error);
+}
+#else
+static inline u64 dpm_timing_start(void)
+{
+	return 0;
+}
+
+static inline void dpm_timing_report(struct device *dev, char *info,
+				     pm_message_t state, u64 start, int error)
+{
+}
+#endif /* CONFIG_PM_SLEEP_TIMING */
+
 static ktime_t initcall_debug_start(struct device *dev)
 {
 	ktime_t calltime = ktime_set(0, 0);
@@ -215,6 +343,7 @@ static int pm_op(struct device *dev,
 {
 	int error = 0;
 	ktime_t calltime;
+	u64 start = dpm_timing_start();
 
 	calltime = initcall_debug_start(dev);
 
@@ -266,6 +395,7 @@ static int pm_op(struct device *dev,
 	}
 
 	initcall_debug_report(dev, calltime, error);
+	dpm_timing_report(dev, "", state, start, error);
 
 	return error;
 }
@@ -285,6 +415,7 @@ static int pm_noirq_op(struct device *dev,
 {
 	int error = 0;
 	ktime_t calltime = ktime_set(0, 0), delta, rettime;
+	u64 start = dpm_timing_start();
 
 	if (initcall_debug) {
 		pr_info("calling  %s+ @ %i, parent: %s\n",
@@ -347,6 +478,7 @@ static int pm_noirq_op(struct device *dev,
 			dev_name(dev), error,
 			(unsigned long long)ktime_to_ns(delta) >> 10);
 	}
+	dpm_timing_report(dev, "noirq ", state, start, error);
 
 	return error;
 }
@@ -489,6 +621,7 @@ static int legacy_resume(struct device *dev, int (*cb)(struct device *dev))
 {
 	int error;
 	ktime_t calltime;
+	u64 start = dpm_timing_start();
 
 	calltime = initcall_debug_start(dev);
 
@@ -496,6 +629,7 @@ static int legacy_resume(struct device *dev, int (*cb)(struct device *dev))
 	suspend_report_result(cb, error);
 
 	initcall_debug_report(dev, calltime, error);
+	dpm_timing_report(dev, "legacy ", PMSG_RESUME, start, error);
 
 	return error;
 }
@@ -804,6 +938,7 @@ static int legacy_suspend(struct device *dev, pm_message_t state,
 {
 	int error;
 	ktime_t calltime;
+	u64 start = dpm_timing_start();
 
 	calltime = initcall_debug_start(dev);
 
@@ -811,6 +946,7 @@ static int legacy_suspend(struct device *dev, pm_message_t state,
 	suspend_report_result(cb, error);
 
 	initcall_debug_report(dev, calltime, error);
+	dpm_timing_report(dev, "legacy ", state, start, error);
 
 	return error;
 }
@@ -83,6 +83,7 @@ static DEFINE_MUTEX(loop_devices_mutex);
 
 static int max_part;
 static int part_shift;
+static struct workqueue_struct *loop_wq;
 
 /*
  * Transfer functions
@@ -466,6 +467,26 @@ lo_receive(struct loop_device *lo, struct bio *bio, int bsize, loff_t pos)
 	return ret;
 }
 
+/*
+ * LO_FLAGS_DIRECT_IO: the data now lives in the page cache of the loop
+ * device itself, so do not keep a second copy in the backing file's.
+ * Writes are pushed to the backing store before completing, like
+ * O_DIRECT writes would be, so that their pages can be dropped too.
+ */
+static void loop_drop_cache(struct loop_device *lo, struct bio *bio,
+			    loff_t pos, int ret)
+{
+	struct address_space *mapping = lo->lo_backing_file->f_mapping;
+	loff_t end = pos + bio->bi_size - 1;
+
+	if (!bio->bi_size)
+		return;
+	if (bio_rw(bio) == WRITE && !ret)
+		filemap_write_and_wait_range(mapping, pos, end);
+	invalidate_mapping_pages(mapping, pos >> PAGE_CACHE_SHIFT,
+				 end >> PAGE_CACHE_SHIFT);
+}
+
 static int do_bio_filebacked(struct loop_device *lo, struct bio *bio)
 {
 	loff_t pos;
@@ -494,6 +515,8 @@ static int do_bio_filebacked(struct loop_device *lo, struct bio *bio)
 	} else
 		ret = lo_receive(lo, bio, lo->lo_blocksize, pos);
 
+	if (lo->lo_flags & LO_FLAGS_DIRECT_IO)
+		loop_drop_cache(lo, bio, pos, ret);
 out:
 	return ret;
 }
@@ -529,6 +552,14 @@ static int loop_make_request(struct request_queue *q, struct bio *old_bio)
 		goto out;
 	if (unlikely(rw == WRITE && (lo->lo_flags & LO_FLAGS_READ_ONLY)))
 		goto out;
+	if (lo->transfer == transfer_none) {
+		unsigned int i = lo->lo_next_worker++ % LO_NR_WORKERS;
+
+		bio_list_add(&lo->lo_wq_list, old_bio);
+		spin_unlock_irq(&lo->lo_lock);
+		queue_work(loop_wq, &lo->lo_workers[i].work);
+		return 0;
+	}
 	loop_add_bio(lo, old_bio);
 	wake_up(&lo->lo_event);
 	spin_unlock_irq(&lo->lo_lock);
@@ -607,6 +638,36 @@ static int loop_thread(void *data)
 	return 0;
 }
 
+/*
+ * Requests that need no transfer function are independent of each
+ * other, so several workers service them concurrently; each one drains
+ * the shared list.  Only switch requests and transfers keep going
+ * through lo_thread.
+ */
+static void loop_worker_fn(struct work_struct *work)
+{
+	struct loop_device *lo = container_of(work, struct loop_worker,
+					      work)->lo;
+	struct bio *bio;
+
+	for (;;) {
+		spin_lock_irq(&lo->lo_lock);
+		bio = bio_list_pop(&lo->lo_wq_list);
+		spin_unlock_irq(&lo->lo_lock);
+		if (!bio)
+			break;
+		bio_endio(bio, do_bio_filebacked(lo, bio));
+	}
+}
+
+static void loop_flush_workers(struct loop_device *lo)
+{
+	int i;
+
+	for (i = 0; i < LO_NR_WORKERS; i++)
+		flush_work(&lo->lo_workers[i].work);
+}
+
 /*
  * loop_switch performs the hard work of switching a backing store.
  * First it needs to flush existing IO, it does this by sending a magic
@@ -624,6 +685,8 @@ static int loop_switch(struct loop_device *lo, struct file *file)
 	bio->bi_bdev = NULL;
 	loop_make_request(lo->lo_queue, bio);
 	wait_for_completion(&w.wait);
+	/* workers may still hold the old file, let them finish with it */
+	loop_flush_workers(lo);
 	return 0;
 }
 
@@ -795,16 +858,25 @@ static ssize_t loop_attr_autoclear_show(struct loop_device *lo, char *buf)
 	return sprintf(buf, "%s\n", autoclear ? "1" : "0");
 }
 
+static ssize_t loop_attr_dio_show(struct loop_device *lo, char *buf)
+{
+	int dio = (lo->lo_flags & LO_FLAGS_DIRECT_IO);
+
+	return sprintf(buf, "%s\n", dio ? "1" : "0");
+}
+
 LOOP_ATTR_RO(backing_file);
 LOOP_ATTR_RO(offset);
 LOOP_ATTR_RO(sizelimit);
 LOOP_ATTR_RO(autoclear);
+LOOP_ATTR_RO(dio);
 
 static struct attribute *loop_attrs[] = {
 	&loop_attr_backing_file.attr,
 	&loop_attr_offset.attr,
 	&loop_attr_sizelimit.attr,
 	&loop_attr_autoclear.attr,
+	&loop_attr_dio.attr,
 	NULL,
 };
 
@@ -910,6 +982,7 @@ static int loop_set_fd(struct loop_device *lo, fmode_t mode,
 	mapping_set_gfp_mask(mapping, lo->old_gfp_mask & ~(__GFP_IO|__GFP_FS));
 
 	bio_list_init(&lo->lo_bio_list);
+	bio_list_init(&lo->lo_wq_list);
 
 	/*
 	 * set queue make_request_fn, and add limits based on lower level
@@ -1018,6 +1091,7 @@ static int loop_clr_fd(struct loop_device *lo, struct block_device *bdev)
 	spin_unlock_irq(&lo->lo_lock);
 
 	kthread_stop(lo->lo_thread);
+	loop_flush_workers(lo);
 
 	lo->lo_queue->unplug_fn = NULL;
 	lo->lo_backing_file = NULL;
@@ -1118,6 +1192,10 @@ loop_set_status(struct loop_device *lo, const struct loop_info64 *info)
 	     (info->lo_flags & LO_FLAGS_AUTOCLEAR))
 		lo->lo_flags ^= LO_FLAGS_AUTOCLEAR;
 
+	if ((lo->lo_flags & LO_FLAGS_DIRECT_IO) !=
+	     (info->lo_flags & LO_FLAGS_DIRECT_IO))
+		lo->lo_flags ^= LO_FLAGS_DIRECT_IO;
+
 	lo->lo_encrypt_key_size = info->lo_encrypt_key_size;
 	lo->lo_init[0] = info->lo_init[0];
 	lo->lo_init[1] = info->lo_init[1];
@@ -1269,6 +1347,18 @@ loop_get_status64(struct loop_device *lo, struct loop_info64 __user *arg) {
 	return err;
 }
 
+static int loop_set_direct_io(struct loop_device *lo, unsigned long arg)
+{
+	if (lo->lo_state != Lo_bound)
+		return -ENXIO;
+
+	if (arg)
+		lo->lo_flags |= LO_FLAGS_DIRECT_IO;
+	else
+		lo->lo_flags &= ~LO_FLAGS_DIRECT_IO;
+	return 0;
+}
+
 static int loop_set_capacity(struct loop_device *lo, struct block_device *bdev)
 {
 	int err;
@@ -1332,6 +1422,11 @@ static int lo_ioctl(struct block_device *bdev, fmode_t mode,
 		if ((mode & FMODE_WRITE) || capable(CAP_SYS_ADMIN))
 			err = loop_set_capacity(lo, bdev);
 		break;
+	case LOOP_SET_DIRECT_IO:
+		err = -EPERM;
+		if ((mode & FMODE_WRITE) || capable(CAP_SYS_ADMIN))
+			err = loop_set_direct_io(lo, arg);
+		break;
 	default:
 		err = lo->ioctl ? lo->ioctl(lo, cmd, arg) : -EINVAL;
 	}
@@ -1480,6 +1575,7 @@ static int lo_compat_ioctl(struct block_device *bdev, fmode_t mode,
 		mutex_unlock(&lo->lo_ctl_mutex);
 		break;
 	case LOOP_SET_CAPACITY:
+	case LOOP_SET_DIRECT_IO:
 	case LOOP_CLR_FD:
 	case LOOP_GET_STATUS64:
 	case LOOP_SET_STATUS64:
@@ -1600,6 +1696,7 @@ static struct loop_device *loop_alloc(int i)
 {
 	struct loop_device *lo;
 	struct gendisk *disk;
+	int j;
 
 	lo = kzalloc(sizeof(*lo), GFP_KERNEL);
 	if (!lo)
@@ -1618,6 +1715,10 @@ static struct loop_device *loop_alloc(int i)
 	lo->lo_thread		= NULL;
 	init_waitqueue_head(&lo->lo_event);
 	spin_lock_init(&lo->lo_lock);
+	for (j = 0; j < LO_NR_WORKERS; j++) {
+		INIT_WORK(&lo->lo_workers[j].work, loop_worker_fn);
+		lo->lo_workers[j].lo = lo;
+	}
 	disk->major		= LOOP_MAJOR;
 	disk->first_minor	= i << part_shift;
 	disk->fops		= &lo_fops;
@@ -1721,8 +1822,14 @@ static int __init loop_init(void)
 		range = 1UL << MINORBITS;
 	}
 
-	if (register_blkdev(LOOP_MAJOR, "loop"))
+	loop_wq = alloc_workqueue("kloopd", WQ_MEM_RECLAIM, 0);
+	if (!loop_wq)
+		return -ENOMEM;
+
+	if (register_blkdev(LOOP_MAJOR, "loop")) {
+		destroy_workqueue(loop_wq);
 		return -EIO;
+	}
 
 	for (i = 0; i < nr; i++) {
 		lo = loop_alloc(i);
@@ -1749,6 +1856,7 @@ Enomem:
 		loop_free(lo);
 
 	unregister_blkdev(LOOP_MAJOR, "loop");
+	destroy_workqueue(loop_wq);
 	return -ENOMEM;
 }
 
@@ -1764,6 +1872,7 @@ static void __exit loop_exit(void)
 
 	blk_unregister_region(MKDEV(LOOP_MAJOR, 0), range);
 	unregister_blkdev(LOOP_MAJOR, "loop");
+	destroy_workqueue(loop_wq);
 }
 
 module_init(loop_init);
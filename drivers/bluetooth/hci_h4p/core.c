@@ -411,6 +411,14 @@ static void hci_h4p_rx_tasklet(unsigned long data)
 		case WAIT_FOR_DATA:
 			info->rx_count--;
 			*skb_put(info->rx_skb, 1) = byte;
+			/* Copy the rest of the payload already in the FIFO */
+			while (info->rx_count &&
+			       (hci_h4p_inb(info, UART_LSR) & UART_LSR_DR)) {
+				*skb_put(info->rx_skb, 1) =
+					hci_h4p_inb(info, UART_RX);
+				info->rx_count--;
+				info->hdev->stat.byte_rx++;
+			}
 			if (info->rx_count == 0) {
 				/* H4+ devices should allways send word aligned packets */
 				if (!(info->rx_skb->len % 2)) {
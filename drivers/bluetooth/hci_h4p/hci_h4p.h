@@ -37,6 +37,14 @@
 #define UART_OMAP_SSR_WAKEUP	0x02
 #define UART_OMAP_SSR_TXFULL	0x01
 
+/*
+ * FIFO trigger levels in units of four bytes, programmed through TLR.
+ * RX interrupts at 48 bytes and relies on the RX timeout interrupt for
+ * the tail of a frame; flow control halts the chip at 60 bytes (TCR).
+ */
+#define UART_OMAP_TLR_RX_TRIG	12
+#define UART_OMAP_TLR_TX_TRIG	15
+
 #if 0
 #define NBT_DBG(fmt, arg...)  printk("%s: " fmt "" , __FUNCTION__ , ## arg)
 #else
@@ -159,7 +159,8 @@ int hci_h4p_init_uart(struct hci_h4p_info *info)
 	hci_h4p_outb(info, UART_OMAP_SCR, 0x80);
 	hci_h4p_outb(info, UART_EFR, UART_EFR_ECB);
 	hci_h4p_outb(info, UART_MCR, UART_MCR_TCRTLR);
-	hci_h4p_outb(info, UART_TI752_TLR, 0x1f);
+	hci_h4p_outb(info, UART_TI752_TLR,
+		     (UART_OMAP_TLR_RX_TRIG << 4) | UART_OMAP_TLR_TX_TRIG);
 	hci_h4p_outb(info, UART_TI752_TCR, 0xef);
 	hci_h4p_outb(info, UART_FCR, UART_FCR_ENABLE_FIFO | UART_FCR_CLEAR_RCVR |
 		     UART_FCR_CLEAR_XMIT | UART_FCR_R_TRIG_00);
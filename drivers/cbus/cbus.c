@@ -145,23 +145,21 @@ out:
 }
 
 /**
- * cbus_transfer - transfers data over the bus
+ * __cbus_transfer - transfers data over the bus
  * @host: the host we're using
  * @rw: read/write flag
  * @dev: device address
  * @reg: register address
  * @data: if @rw == 0 data to send otherwise 0
+ *
+ * Must be called with host->lock held and interrupts disabled.
  */
-static int cbus_transfer(struct cbus_host *host, unsigned rw, unsigned dev,
+static int __cbus_transfer(struct cbus_host *host, unsigned rw, unsigned dev,
 		unsigned reg, unsigned data)
 {
-	unsigned long flags;
 	int input = 0;
 	int ret = 0;
 
-	/* We don't want interrupts disturbing our transfer */
-	spin_lock_irqsave(&host->lock, flags);
-
 	/* Reset state and start of transfer, SEL stays down during transfer */
 	gpio_set_value(host->sel_gpio, 0);
 
@@ -214,11 +212,72 @@ static int cbus_transfer(struct cbus_host *host, unsigned rw, unsigned dev,
 	gpio_set_value(host->clk_gpio, 0);
 
 out:
+	return ret;
+}
+
+/**
+ * cbus_transfer - transfers data over the bus
+ * @host: the host we're using
+ * @rw: read/write flag
+ * @dev: device address
+ * @reg: register address
+ * @data: if @rw == 0 data to send otherwise 0
+ */
+static int cbus_transfer(struct cbus_host *host, unsigned rw, unsigned dev,
+		unsigned reg, unsigned data)
+{
+	unsigned long flags;
+	int ret;
+
+	/* We don't want interrupts disturbing our transfer */
+	spin_lock_irqsave(&host->lock, flags);
+	ret = __cbus_transfer(host, rw, dev, reg, data);
 	spin_unlock_irqrestore(&host->lock, flags);
 
 	return ret;
 }
 
+/**
+ * cbus_transfer_op - executes one queued operation
+ * @host: the host we're using
+ * @dev: device address
+ * @op: the operation to execute
+ *
+ * Must be called with host->lock held and interrupts disabled.
+ * A read-modify-write is done as two back to back frames so no
+ * other transfer can sneak in between the read and the write.
+ */
+static int cbus_transfer_op(struct cbus_host *host, unsigned dev,
+		struct cbus_op *op)
+{
+	int ret;
+
+	switch (op->op) {
+	case CBUS_OP_READ:
+		ret = __cbus_transfer(host, CBUS_XFER_READ, dev, op->reg, 0);
+		if (ret >= 0)
+			op->val = ret;
+		break;
+	case CBUS_OP_WRITE:
+		ret = __cbus_transfer(host, CBUS_XFER_WRITE, dev, op->reg,
+				op->val);
+		break;
+	case CBUS_OP_MASKSET:
+		ret = __cbus_transfer(host, CBUS_XFER_READ, dev, op->reg, 0);
+		if (ret < 0)
+			break;
+		op->val |= ret & ~op->mask;
+		ret = __cbus_transfer(host, CBUS_XFER_WRITE, dev, op->reg,
+				op->val);
+		break;
+	default:
+		ret = -EINVAL;
+		break;
+	}
+
+	return ret;
+}
+
 /**
  * cbus_read_reg - reads a given register from the device
  * @dev: device address
@@ -242,6 +301,43 @@ int cbus_write_reg(unsigned dev, unsigned reg, unsigned val)
 }
 EXPORT_SYMBOL(cbus_write_reg);
 
+/**
+ * cbus_transfer_batch - executes a vector of operations on a device
+ * @dev: device address
+ * @ops: the operations to execute, in order
+ * @num: number of entries in @ops
+ *
+ * Reads store their result in op->val.  A CBUS_OP_MASKSET clears
+ * op->mask and sets op->val, leaving the value written in op->val.
+ * The host lock is only held across one operation at a time, so the
+ * interrupts-off window stays that of a single register access no
+ * matter how long the vector is.
+ *
+ * Returns zero on success or the first negative error, in which case
+ * the remaining operations are not executed.
+ */
+int cbus_transfer_batch(unsigned dev, struct cbus_op *ops, unsigned num)
+{
+	struct cbus_host *host = cbus_host;
+	unsigned long flags;
+	unsigned i;
+	int ret;
+
+	for (i = 0; i < num; i++) {
+		spin_lock_irqsave(&host->lock, flags);
+		ret = cbus_transfer_op(host, dev, &ops[i]);
+		spin_unlock_irqrestore(&host->lock, flags);
+		if (ret < 0) {
+			dev_dbg(host->dev, "batch op %u (reg 0x%02x) failed\n",
+					i, ops[i].reg);
+			return ret;
+		}
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL(cbus_transfer_batch);
+
 static int __init cbus_bus_probe(struct platform_device *pdev)
 {
 	struct cbus_host *chost;
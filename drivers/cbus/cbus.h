@@ -23,8 +23,31 @@
 #ifndef __DRIVERS_CBUS_CBUS_H
 #define __DRIVERS_CBUS_CBUS_H
 
+#include <linux/types.h>
+
+/* Queued operation types */
+#define CBUS_OP_READ		0
+#define CBUS_OP_WRITE		1
+#define CBUS_OP_MASKSET		2	/* read, clear mask, set val, write */
+
+/**
+ * struct cbus_op - one entry of a batched CBUS transaction
+ * @op: CBUS_OP_READ, CBUS_OP_WRITE or CBUS_OP_MASKSET
+ * @reg: register address
+ * @mask: bits to clear (CBUS_OP_MASKSET only)
+ * @val: data to write, bits to set, or the read result
+ */
+struct cbus_op {
+	u8	op;
+	u8	reg;
+	u16	mask;
+	u16	val;
+};
+
 extern int cbus_read_reg(unsigned dev, unsigned reg);
 extern int cbus_write_reg(unsigned dev, unsigned reg, unsigned val);
+extern int cbus_transfer_batch(unsigned dev, struct cbus_op *ops,
+		unsigned num);
 
 NORET_TYPE void cbus_emergency(void) ATTRIB_NORET;
 
@@ -27,6 +27,18 @@
 
 /* Threshold constants */
 #define FINISH_CURRENT_PERCENT	3
+#define OVERVOLTAGE_MARGIN	50 /* mV above top_voltage to cut the PWM */
+
+/* Voltage error which corresponds to a full scale (1000 permille)
+ * controller error in the constant voltage stage. */
+#define CV_ERROR_SPAN		100 /* mV */
+
+/* PID gains, in 1/1024 units, for the incremental controller
+ *   delta = KP * (e[k] - e[k-1]) + KI * e[k] + KD * (e[k] - 2e[k-1] + e[k-2])
+ * KI matches the old proportional step of half the relative error. */
+#define PID_KP			256
+#define PID_KI			512
+#define PID_KD			64
 
 
 /* Returns the requested first-stage charge current in mA */
@@ -62,6 +74,8 @@ int lipocharge_start(struct lipocharge *c)
 	err = c->set_current_pwm(c, c->active_duty_cycle);
 	if (err)
 		return err;
+	c->error[0] = 0;
+	c->error[1] = 0;
 	c->state = LIPO_FIRST_STAGE;
 
 	return 0;
@@ -74,42 +88,45 @@ void lipocharge_stop(struct lipocharge *c)
 	c->state = LIPO_IDLE;
 }
 
-static int lipocharge_increase_current(struct lipocharge *c,
-				       unsigned int inc_permille)
+/* Run one step of the incremental PID controller.
+ * @error_permille: The control error, relative to full scale.
+ *		    positive -> more current needed.
+ * The output is clamped to the duty cycle range, which also keeps the
+ * incremental form free of integral windup. */
+static int lipocharge_pid_update(struct lipocharge *c, int error_permille)
 {
-	int old_pwm, new_pwm;
+	int old_pwm, new_pwm, delta;
+
+	delta = PID_KP * (error_permille - c->error[0]) +
+		PID_KI * error_permille +
+		PID_KD * (error_permille - 2 * c->error[0] + c->error[1]);
+	c->error[1] = c->error[0];
+	c->error[0] = error_permille;
 
-	if (c->active_duty_cycle >= c->duty_cycle_max)
+	/* permille/1024 -> duty cycle units */
+	delta = delta * (int)c->duty_cycle_max / (1024 * 1000);
+	if (!delta)
 		return 0;
 
 	old_pwm = c->active_duty_cycle;
-	new_pwm = old_pwm + (c->duty_cycle_max * inc_permille / 1000);
-	new_pwm = min(new_pwm, (int)c->duty_cycle_max);
+	new_pwm = clamp(old_pwm + delta, 0, (int)c->duty_cycle_max);
+	if (new_pwm == old_pwm)
+		return 0;
 	c->active_duty_cycle = new_pwm;
 
-	dev_dbg(c->dev, "lipo: Increasing duty_cycle by "
-		"%u permille (0x%02X -> 0x%02X)",
-		inc_permille, old_pwm, new_pwm);
+	dev_dbg(c->dev, "lipo: PID error %d permille, "
+		"duty_cycle 0x%02X -> 0x%02X",
+		error_permille, old_pwm, new_pwm);
 
 	return c->set_current_pwm(c, c->active_duty_cycle);
 }
 
-static int lipocharge_decrease_current(struct lipocharge *c,
-				       unsigned int dec_permille)
+/* Cut the charge current immediately. */
+static int lipocharge_cut_current(struct lipocharge *c)
 {
-	int old_pwm, new_pwm;
-
-	if (c->active_duty_cycle <= 0)
-		return 0;
-
-	old_pwm = c->active_duty_cycle;
-	new_pwm = old_pwm - (c->duty_cycle_max * dec_permille / 1000);
-	new_pwm = max(0, new_pwm);
-	c->active_duty_cycle = new_pwm;
-
-	dev_dbg(c->dev, "lipo: Decreasing duty_cycle by "
-		"%u permille (0x%02X -> 0x%02X)",
-		dec_permille, old_pwm, new_pwm);
+	c->active_duty_cycle = 0;
+	c->error[0] = 0;
+	c->error[1] = 0;
 
 	return c->set_current_pwm(c, c->active_duty_cycle);
 }
@@ -130,53 +147,59 @@ int lipocharge_update_state(struct lipocharge *c,
 			    int current_mA,
 			    unsigned int temp_K)
 {
-	int requested_current, current_diff;
-	int err;
-	unsigned int permille;
+	int requested_current, current_diff, voltage_diff;
 
 	//TODO temp
 
+	requested_current = get_stage1_charge_current(c);
+	if (current_mA < 0)
+		current_mA = 0;
+
+	if (c->state != LIPO_IDLE &&
+	    voltage_mV > c->top_voltage + OVERVOLTAGE_MARGIN) {
+		dev_err(c->dev, "lipo: Overvoltage (%u mV), cutting current",
+			voltage_mV);
+		return lipocharge_cut_current(c);
+	}
+
 restart:
 	switch (c->state) {
 	case LIPO_IDLE:
 		dev_err(c->dev, "%s: called while idle", __func__);
 		return -EINVAL;
 	case LIPO_FIRST_STAGE:	/* Constant current */
-//printk("GOT %u %d %u\n", voltage_mV, current_mA, temp_K);
 		if (voltage_mV >= c->top_voltage) {
 			/* Float voltage reached.
-			 * Switch charger mode to "constant current" */
+			 * Switch charger mode to "constant voltage" */
 			c->state = LIPO_SECOND_STAGE;
 			dev_dbg(c->dev, "Switched to second charging stage.");
 			goto restart;
 		}
 		/* Float voltage not reached, yet.
-		 * Try to get the requested constant current. */
-		requested_current = get_stage1_charge_current(c);
-		if (current_mA < 0)
-			current_mA = 0;
+		 * Regulate towards the requested constant current. */
 		current_diff = requested_current - current_mA;
-		if (abs(requested_current - current_mA) > CURRENT_HYST) {
-			if (current_diff > 0) {
-				/* Increase current */
-				permille = current_diff * 1000 / requested_current;
-				permille /= 2;
-				err = lipocharge_increase_current(c, permille);
-				if (err)
-					return err;
-			} else {
-				/* Decrease current */
-				permille = (-current_diff) * 1000 / requested_current;
-				permille /= 2;
-				err = lipocharge_decrease_current(c, permille);
-				if (err)
-					return err;
-			}
-		}
-		break;
+		if (abs(current_diff) <= CURRENT_HYST)
+			current_diff = 0;
+		return lipocharge_pid_update(c,
+				current_diff * 1000 / requested_current);
 	case LIPO_SECOND_STAGE:	/* Constant voltage */
-		//TODO
-		break;
+		if (current_mA <
+		    requested_current * FINISH_CURRENT_PERCENT / 100) {
+			/* The current tapered off. We're done. */
+			dev_dbg(c->dev, "Charge current tapered off (%d mA).",
+				current_mA);
+			return 1;
+		}
+		/* Hold the float voltage, but never exceed the
+		 * constant current stage current. */
+		voltage_diff = (int)c->top_voltage - (int)voltage_mV;
+		if (abs(voltage_diff) <= VOLTAGE_HYST)
+			voltage_diff = 0;
+		if (voltage_diff > 0 && current_mA >= requested_current)
+			voltage_diff = 0;
+		return lipocharge_pid_update(c,
+				clamp(voltage_diff * 1000 / CV_ERROR_SPAN,
+				      -1000, 1000));
 	}
 
 	return 0;
@@ -37,6 +37,7 @@ struct lipocharge {
 	struct device *dev;
 	enum lipocharge_state state;
 	unsigned int active_duty_cycle;
+	int error[2];		/* Last two controller errors, in permille */
 
 	//TODO implement timer to cut power after maximum charge time.
 };
@@ -30,6 +30,7 @@
 #include <linux/bitops.h>
 #include <linux/workqueue.h>
 #include <linux/delay.h>
+#include <linux/power_supply.h>
 
 #include "cbus.h"
 #include "retu.h"
@@ -42,8 +43,18 @@
 #define N810BM_PMM_GROUP_SIZE		0x200
 #define N810BM_PMM_ELEM_SIZE		0x10
 
-#define N810BM_CHECK_INTERVAL		(HZ * 2)
+#define N810BM_CHECK_INTERVAL		(HZ * 2)	/* Tight check interval */
+#define N810BM_CHECK_INTERVAL_MAX	(HZ * 32)	/* Relaxed (deferrable) check interval */
 #define N810BM_MIN_VOLTAGE_THRES	3200 /* Absolute minimum voltage threshold */
+#define N810BM_LOW_VOLTAGE_MARGIN	300 /* Poll tightly below THRES + MARGIN mV */
+#define N810BM_STEADY_VOLTAGE_DELTA	20 /* Max mV change per check to relax polling */
+
+#define N810BM_CURRMEAS_INTERVAL	250	/* Current measure interval while regulating (ms) */
+#define N810BM_CURRMEAS_INTERVAL_MAX	2000	/* Current measure interval when settled (ms) */
+
+#define N810BM_GAUGE_INTERVAL		4000	/* Current measure interval for the fuel gauge (ms) */
+
+#define N810BM_ADC_RING_SIZE		8 /* Samples kept per ADC channel */
 
 
 /* RETU_ADC_BSI
@@ -125,6 +136,23 @@ enum n810bm_capacity {
 	N810BM_CAP_1500MAH	= 1500,	/* 1500 mAh battery */
 };
 
+/* ADC channels sampled by the periodic pipeline */
+enum n810bm_adc_slot {
+	N810BM_ADC_SLOT_BATTVOLT,
+	N810BM_ADC_SLOT_BATTEMP,
+	N810BM_ADC_SLOT_CHGVOLT,
+	N810BM_ADC_SLOT_BKUPVOLT,
+	N810BM_NR_ADC_SLOTS,
+};
+
+/* Ring of recent (already oversampled) ADC results for one channel */
+struct n810bm_adc_ring {
+	u16 samples[N810BM_ADC_RING_SIZE];
+	unsigned int head;			/* Next slot to write */
+	unsigned int count;			/* Number of valid samples */
+	unsigned long stamp;			/* jiffies of the newest sample */
+};
+
 enum n810bm_notify_flags {
 	N810BM_NOTIFY_charger_present,
 	N810BM_NOTIFY_charger_state,
@@ -144,12 +172,30 @@ struct n810bm {
 	struct platform_device *pdev;
 	struct n810bm_calib calib;		/* Calibration data */
 
+	struct n810bm_adc_ring adc_ring[N810BM_NR_ADC_SLOTS]; /* Sampled ADC values */
+
 	bool verbose_charge_log;		/* Verbose charge logging */
 
 	unsigned long notify_flags;
 	struct work_struct notify_work;
 	struct work_struct currmeas_irq_work;
-	struct delayed_work periodic_check_work;
+	struct delayed_work periodic_check_work;	/* Tight checks */
+	struct delayed_work periodic_check_idle_work;	/* Relaxed, deferrable checks */
+
+	bool checks_stopped;			/* No periodic check may be queued */
+	unsigned long check_interval;		/* Current check interval, in jiffies */
+	int last_check_mv;			/* Battery voltage at the last check */
+	unsigned int check_count;		/* Number of tight checks */
+	unsigned int check_idle_count;		/* Number of relaxed checks */
+	unsigned int currmeas_interval;		/* Current measure timer interval (ms) */
+	unsigned int currmeas_count;		/* Number of current measure IRQs */
+
+	bool gauge_enabled;			/* Coulomb counting is running */
+	bool gauge_valid;			/* gauge_charge has been seeded */
+	s64 gauge_charge;			/* Remaining charge, in uAs */
+	int gauge_current;			/* Last measured current, in uA (negative -> drain) */
+	unsigned long gauge_stamp;		/* jiffies of the last current sample */
+	struct power_supply psy;		/* Battery power supply class device */
 
 	bool initialized;			/* The hardware was initialized */
 	struct mutex mutex;
@@ -186,11 +232,6 @@ static void n810bm_emergency(struct n810bm *bm, const char *message)
 	cbus_emergency();
 }
 
-static u16 tahvo_read(struct n810bm *bm, unsigned int reg)
-{
-	return tahvo_read_reg(reg);
-}
-
 static void tahvo_maskset(struct n810bm *bm, unsigned int reg, u16 mask, u16 set)
 {
 	tahvo_set_clear_reg_bits(reg, set, mask);
@@ -198,11 +239,7 @@ static void tahvo_maskset(struct n810bm *bm, unsigned int reg, u16 mask, u16 set
 
 static inline void tahvo_write(struct n810bm *bm, unsigned int reg, u16 value)
 {
-	unsigned long flags;
-
-	spin_lock_irqsave(&tahvo_lock, flags);
 	tahvo_write_reg(reg, value);
-	spin_unlock_irqrestore(&tahvo_lock, flags);
 }
 
 static inline void tahvo_set(struct n810bm *bm, unsigned int reg, u16 mask)
@@ -249,6 +286,92 @@ static int retu_adc_average(struct n810bm *bm, unsigned int chan,
 	return value;
 }
 
+/* ADC channel and oversampling factor of each pipeline slot */
+static const struct {
+	u8 channel;
+	u8 nr_passes;
+} n810bm_adc_slots[N810BM_NR_ADC_SLOTS] = {
+	[N810BM_ADC_SLOT_BATTVOLT]	= { RETU_ADC_BATTVOLT, 5, },
+	[N810BM_ADC_SLOT_BATTEMP]	= { RETU_ADC_BATTEMP, 3, },
+	[N810BM_ADC_SLOT_CHGVOLT]	= { RETU_ADC_CHGVOLT, 5, },
+	[N810BM_ADC_SLOT_BKUPVOLT]	= { RETU_ADC_BKUPVOLT, 3, },
+};
+
+#define N810BM_ADC_BATCH_SIZE		16 /* Sum of all nr_passes */
+
+/* Sample all pipeline channels in one Retu batch and push the averaged
+ * results into the rings. Requires bm->mutex locked. */
+static int n810bm_adc_sample_batch(struct n810bm *bm)
+{
+	u8 channels[N810BM_ADC_BATCH_SIZE];
+	u16 results[N810BM_ADC_BATCH_SIZE];
+	struct n810bm_adc_ring *ring;
+	unsigned int slot, i, n = 0, value;
+	int err;
+
+	for (slot = 0; slot < N810BM_NR_ADC_SLOTS; slot++) {
+		for (i = 0; i < n810bm_adc_slots[slot].nr_passes; i++)
+			channels[n++] = n810bm_adc_slots[slot].channel;
+	}
+	BUILD_BUG_ON(ARRAY_SIZE(channels) != N810BM_ADC_BATCH_SIZE);
+
+	err = retu_read_adc_batch(&n810bm_retu_device->dev,
+				  channels, results, n);
+	if (err)
+		return err;
+
+	for (slot = 0, n = 0; slot < N810BM_NR_ADC_SLOTS; slot++) {
+		value = 0;
+		for (i = 0; i < n810bm_adc_slots[slot].nr_passes; i++)
+			value += results[n++];
+		value /= n810bm_adc_slots[slot].nr_passes;
+
+		ring = &bm->adc_ring[slot];
+		ring->samples[ring->head] = value;
+		ring->head = (ring->head + 1) % N810BM_ADC_RING_SIZE;
+		if (ring->count < N810BM_ADC_RING_SIZE)
+			ring->count++;
+		ring->stamp = jiffies;
+	}
+
+	return 0;
+}
+
+/* Get the newest sample of a pipeline slot (or negative value on error).
+ * Requires bm->mutex locked. */
+static int n810bm_adc_latest(struct n810bm *bm, enum n810bm_adc_slot slot)
+{
+	struct n810bm_adc_ring *ring = &bm->adc_ring[slot];
+
+	if (!ring->count)
+		return -ENODATA;
+
+	return ring->samples[(ring->head + N810BM_ADC_RING_SIZE - 1) %
+			     N810BM_ADC_RING_SIZE];
+}
+
+/* Get the average of the recent samples of a pipeline slot.
+ * A new batch is only sampled, if the ring went stale.
+ * Requires bm->mutex locked. */
+static int n810bm_adc_sampled(struct n810bm *bm, enum n810bm_adc_slot slot)
+{
+	struct n810bm_adc_ring *ring = &bm->adc_ring[slot];
+	unsigned int i, value = 0;
+	int err;
+
+	if (!ring->count ||
+	    time_after(jiffies, ring->stamp + bm->check_interval * 2)) {
+		err = n810bm_adc_sample_batch(bm);
+		if (err)
+			return err;
+	}
+
+	for (i = 0; i < ring->count; i++)
+		value += ring->samples[i];
+
+	return value / ring->count;
+}
+
 static struct n810bm_adc_calib * n810bm_get_adc_calib(struct n810bm *bm,
 						enum n810bm_pmm_adc_id id)
 {
@@ -630,6 +753,14 @@ static void n810bm_set_current_measure_timer(struct n810bm *bm,
 					     u16 millisec_interval)
 {
 	u16 value = millisec_interval;
+	struct cbus_op ops[] = {
+		{ .op = CBUS_OP_WRITE, .reg = TAHVO_REG_BATCURRTIMER, },
+		{ .op = CBUS_OP_MASKSET, .reg = TAHVO_REG_CHGCTL,
+		  .mask = TAHVO_REG_CHGCTL_CURTIMRST,
+		  .val = TAHVO_REG_CHGCTL_CURTIMRST, },
+		{ .op = CBUS_OP_MASKSET, .reg = TAHVO_REG_CHGCTL,
+		  .mask = TAHVO_REG_CHGCTL_CURTIMRST, },
+	};
 
 	if (value <= 0xF905) {
 		value = ((u64)0x10624DD3 * (u64)(value + 0xF9)) >> 32;
@@ -637,12 +768,9 @@ static void n810bm_set_current_measure_timer(struct n810bm *bm,
 	} else
 		value = 0xFF;
 
-	tahvo_write(bm, TAHVO_REG_BATCURRTIMER, value & 0xFF);
-
-	tahvo_set(bm, TAHVO_REG_CHGCTL,
-		  TAHVO_REG_CHGCTL_CURTIMRST);
-	tahvo_clear(bm, TAHVO_REG_CHGCTL,
-		    TAHVO_REG_CHGCTL_CURTIMRST);
+	/* Program the timer and pulse its reset in one batch */
+	ops[0].val = value & 0xFF;
+	tahvo_transfer(ops, ARRAY_SIZE(ops));
 
 	if (millisec_interval)
 		tahvo_enable_irq(TAHVO_INT_BATCURR);
@@ -682,16 +810,20 @@ static void n810bm_disable_current_measure(struct n810bm *bm)
  * Does only work, if current measurement was enabled. */
 static int n810bm_measure_batt_current(struct n810bm *bm)
 {
-	u16 retval;
+	struct cbus_op ops[3];
 	int adc = 0, ma, i;
 
 	if (WARN_ON(bm->current_measure_enabled <= 0))
 		return 0;
-	for (i = 0; i < 3; i++) {
-		retval = tahvo_read(bm, TAHVO_REG_BATCURR);
-		adc += (s16)retval; /* Value is signed */
+	for (i = 0; i < ARRAY_SIZE(ops); i++) {
+		ops[i].op = CBUS_OP_READ;
+		ops[i].reg = TAHVO_REG_BATCURR;
 	}
-	adc /= 3;
+	if (tahvo_transfer(ops, ARRAY_SIZE(ops)))
+		return 0;
+	for (i = 0; i < ARRAY_SIZE(ops); i++)
+		adc += (s16)ops[i].val; /* Value is signed */
+	adc /= (int)ARRAY_SIZE(ops);
 
 	//TODO convert to mA
 	ma = adc;
@@ -762,14 +894,12 @@ static int n810bm_check_adc_sanity(struct n810bm *bm)
 	return 0;
 }
 
-/* Measure the battery voltage. Returns the value in mV (or negative value on error). */
-static int n810bm_measure_batt_voltage(struct n810bm *bm)
+/* Convert a battery voltage ADC value to mV (or pass on a negative error). */
+static int n810bm_batt_adc2mvolt(int adc)
 {
-	int adc;
 	unsigned int mv;
 	const unsigned int scale = 1000;
 
-	adc = retu_adc_average(bm, RETU_ADC_BATTVOLT, 5);
 	if (adc < 0)
 		return adc;
 	if (adc <= 0x37)
@@ -782,34 +912,10 @@ static int n810bm_measure_batt_voltage(struct n810bm *bm)
 	return mv;
 }
 
-/* Measure the charger voltage. Returns the value in mV (or negative value on error). */
-static int n810bm_measure_charger_voltage(struct n810bm *bm)
+/* Measure the battery voltage. Returns the value in mV (or negative value on error). */
+static int n810bm_measure_batt_voltage(struct n810bm *bm)
 {
-	int adc;
-	unsigned int mv;
-
-	adc = retu_adc_average(bm, RETU_ADC_CHGVOLT, 5);
-	if (adc < 0)
-		return adc;
-	//TODO convert to mV
-	mv = adc;
-
-	return mv;
-}
-
-/* Measure backup battery voltage. Returns the value in mV (or negative value on error). */
-static int n810bm_measure_backup_batt_voltage(struct n810bm *bm)
-{
-	int adc;
-	unsigned int mv;
-
-	adc = retu_adc_average(bm, RETU_ADC_BKUPVOLT, 3);
-	if (adc < 0)
-		return adc;
-	//TODO convert to mV
-	mv = adc;
-
-	return mv;
+	return n810bm_batt_adc2mvolt(retu_adc_average(bm, RETU_ADC_BATTVOLT, 5));
 }
 
 /* Measure the battery temperature. Returns the value in K (or negative value on error). */
@@ -860,6 +966,69 @@ static unsigned int n810bm_mvolt2percent(unsigned int mv)
 	return percent;
 }
 
+/* Convert a TAHVO_REG_BATCURR value to uA.
+ * The PMM calibration gives the zero offset (field1) and the gain
+ * (field2, in 0.1 uA per LSB). */
+static int n810bm_batt_current_adc2ua(struct n810bm *bm, int adc)
+{
+	struct n810bm_adc_calib *cal;
+
+	cal = n810bm_get_adc_calib(bm, N810BM_PMM_ADC_BATCURR);
+	if (WARN_ON(!cal))
+		return 0;
+
+	return div_s64((s64)(adc - (s32)cal->field1) * cal->field2, 10);
+}
+
+/* Full charge of the inserted battery, in uAs. */
+static inline s64 n810bm_gauge_full_charge(struct n810bm *bm)
+{
+	return (s64)bm->capacity * 3600 * 1000;
+}
+
+/* (Re)seed the coulomb counter from the battery voltage.
+ * Requires bm->mutex locked. */
+static void n810bm_gauge_seed(struct n810bm *bm, unsigned int mv)
+{
+	bm->gauge_charge = div_s64(n810bm_gauge_full_charge(bm) *
+				   n810bm_mvolt2percent(mv), 100);
+	bm->gauge_valid = 1;
+	/* Only integrate the current drawn from now on */
+	bm->gauge_stamp = jiffies;
+	dev_dbg(&bm->pdev->dev, "Fuel gauge seeded to %u%% at %u mV",
+		n810bm_mvolt2percent(mv), mv);
+}
+
+/* Integrate a new current sample (in uA) into the coulomb counter.
+ * Requires bm->mutex locked. */
+static void n810bm_gauge_account(struct n810bm *bm, int ua)
+{
+	unsigned long now = jiffies;
+	unsigned int ms;
+	s64 full;
+
+	if (bm->gauge_valid && n810bm_known_battery_present(bm)) {
+		ms = jiffies_to_msecs(now - bm->gauge_stamp);
+		/* Trapezoidal rule between the previous and this sample */
+		bm->gauge_charge += div_s64(((s64)bm->gauge_current + ua) * ms,
+					    2000);
+		full = n810bm_gauge_full_charge(bm);
+		if (bm->gauge_charge > full)
+			bm->gauge_charge = full;
+		if (bm->gauge_charge < 0)
+			bm->gauge_charge = 0;
+	}
+	bm->gauge_current = ua;
+	bm->gauge_stamp = now;
+}
+
+/* Remaining capacity in percent. Requires bm->mutex locked. */
+static unsigned int n810bm_gauge_percent(struct n810bm *bm)
+{
+	return div64_s64(bm->gauge_charge * 100,
+			 n810bm_gauge_full_charge(bm));
+}
+
 static void n810bm_start_charge(struct n810bm *bm)
 {
 	int err;
@@ -885,7 +1054,8 @@ static void n810bm_start_charge(struct n810bm *bm)
 
 	/* Initialize current measurement circuitry */
 	n810bm_enable_current_measure(bm);
-	n810bm_set_current_measure_timer(bm, 250);
+	bm->currmeas_interval = N810BM_CURRMEAS_INTERVAL;
+	n810bm_set_current_measure_timer(bm, bm->currmeas_interval);
 
 	dev_info(&bm->pdev->dev, "Charging battery");
 	n810bm_notify_charger_state(bm);
@@ -895,7 +1065,9 @@ static void n810bm_start_charge(struct n810bm *bm)
 static void n810bm_stop_charge(struct n810bm *bm)
 {
 	if (lipocharge_is_charging(&bm->charger)) {
-		n810bm_set_current_measure_timer(bm, 0);
+		bm->currmeas_interval = bm->gauge_enabled ?
+					N810BM_GAUGE_INTERVAL : 0;
+		n810bm_set_current_measure_timer(bm, bm->currmeas_interval);
 		n810bm_disable_current_measure(bm);
 	}
 	lipocharge_stop(&bm->charger);
@@ -916,17 +1088,51 @@ static void n810bm_stop_charge(struct n810bm *bm)
 	n810bm_notify_charger_pwm(bm);
 }
 
+/* Queue the next periodic check. Requires bm->mutex locked.
+ * As long as something is going on (charging, low battery, voltage moving)
+ * we check on a tight cadence. While the battery drains steadily the interval
+ * backs off exponentially and the check is queued on a deferrable timer,
+ * so it never pulls the CPU out of idle on its own. */
+static void n810bm_schedule_check(struct n810bm *bm, int mv)
+{
+	bool tight;
+
+	if (bm->checks_stopped)
+		return;
+
+	tight = bm->charger_present ||
+		lipocharge_is_charging(&bm->charger) ||
+		!n810bm_known_battery_present(bm) ||
+		mv < N810BM_MIN_VOLTAGE_THRES + N810BM_LOW_VOLTAGE_MARGIN ||
+		abs(mv - bm->last_check_mv) > N810BM_STEADY_VOLTAGE_DELTA;
+	bm->last_check_mv = mv;
+
+	if (tight) {
+		bm->check_interval = N810BM_CHECK_INTERVAL;
+		schedule_delayed_work(&bm->periodic_check_work,
+				      round_jiffies_relative(bm->check_interval));
+	} else {
+		bm->check_interval = min(bm->check_interval * 2,
+					 (unsigned long)N810BM_CHECK_INTERVAL_MAX);
+		schedule_delayed_work(&bm->periodic_check_idle_work,
+				      round_jiffies_relative(bm->check_interval));
+	}
+}
+
 /* Periodic check */
-static void n810bm_periodic_check_work(struct work_struct *work)
+static void n810bm_periodic_check(struct n810bm *bm, bool idle)
 {
-	struct n810bm *bm = container_of(to_delayed_work(work),
-					 struct n810bm, periodic_check_work);
 	u16 status;
 	bool battery_was_present, charger_was_present;
-	int mv;
+	int mv, err;
 
 	mutex_lock(&bm->mutex);
 
+	if (idle)
+		bm->check_idle_count++;
+	else
+		bm->check_count++;
+
 	status = retu_read(bm, RETU_REG_STATUS);
 	battery_was_present = bm->battery_present;
 	charger_was_present = bm->charger_present;
@@ -945,6 +1151,7 @@ static void n810bm_periodic_check_work(struct work_struct *work)
 			}
 		} else {
 			bm->capacity = N810BM_CAP_NONE;
+			bm->gauge_valid = 0;
 			dev_info(&bm->pdev->dev, "The main battery was removed");
 			//TODO disable charging
 		}
@@ -957,10 +1164,22 @@ static void n810bm_periodic_check_work(struct work_struct *work)
 		n810bm_notify_charger_present(bm);
 	}
 
+	/* Refresh all sampled ADC channels in one batch */
+	err = n810bm_adc_sample_batch(bm);
+	if (err)
+		dev_err(&bm->pdev->dev, "Failed to sample ADC channels (%d)", err);
+	mv = n810bm_batt_adc2mvolt(err ? err :
+		n810bm_adc_latest(bm, N810BM_ADC_SLOT_BATTVOLT));
+
+	/* The voltage is only meaningful for seeding the gauge with
+	 * no charge current flowing. */
+	if (bm->gauge_enabled && !bm->gauge_valid && mv >= 0 &&
+	    n810bm_known_battery_present(bm) && !bm->charger_present)
+		n810bm_gauge_seed(bm, mv);
+
 	if ((bm->battery_present && !bm->charger_present) ||
 	    !n810bm_known_battery_present(bm)){
 		/* We're draining the battery */
-		mv = n810bm_measure_batt_voltage(bm);
 		if (mv < 0) {
 			n810bm_emergency(bm,
 				"check: Failed to measure voltage");
@@ -987,9 +1206,24 @@ static void n810bm_periodic_check_work(struct work_struct *work)
 		n810bm_stop_charge(bm);
 	}
 
+	n810bm_schedule_check(bm, mv);
 	mutex_unlock(&bm->mutex);
-	schedule_delayed_work(&bm->periodic_check_work,
-			      round_jiffies_relative(N810BM_CHECK_INTERVAL));
+}
+
+static void n810bm_periodic_check_work(struct work_struct *work)
+{
+	struct n810bm *bm = container_of(to_delayed_work(work),
+					 struct n810bm, periodic_check_work);
+
+	n810bm_periodic_check(bm, 0);
+}
+
+static void n810bm_periodic_check_idle_work(struct work_struct *work)
+{
+	struct n810bm *bm = container_of(to_delayed_work(work),
+					 struct n810bm, periodic_check_idle_work);
+
+	n810bm_periodic_check(bm, 1);
 }
 
 /*XXX
@@ -1007,16 +1241,26 @@ static void n810bm_tahvo_current_measure_work(struct work_struct *work)
 {
 	struct n810bm *bm = container_of(work, struct n810bm, currmeas_irq_work);
 	int res, ma, mv, temp;
+	unsigned int old_pwm, interval;
 
 	mutex_lock(&bm->mutex);
-	if (!lipocharge_is_charging(&bm->charger))
+	bm->currmeas_count++;
+	if (!lipocharge_is_charging(&bm->charger)) {
+		/* Fuel gauge sample only */
+		if (bm->gauge_enabled && bm->battery_present) {
+			ma = n810bm_measure_batt_current_async(bm);
+			n810bm_gauge_account(bm,
+				n810bm_batt_current_adc2ua(bm, ma));
+		}
 		goto out_unlock;
+	}
 
 	tahvo_maskset(bm, TAHVO_REG_CHGCTL,
 		      TAHVO_REG_CHGCTL_PWMOVR |
 		      TAHVO_REG_CHGCTL_PWMOVRZERO,
 		      TAHVO_REG_CHGCTL_PWMOVR);
 	ma = n810bm_measure_batt_current(bm);
+	n810bm_gauge_account(bm, n810bm_batt_current_adc2ua(bm, ma));
 	tahvo_maskset(bm, TAHVO_REG_CHGCTL,
 		      TAHVO_REG_CHGCTL_PWMOVR |
 		      TAHVO_REG_CHGCTL_PWMOVRZERO,
@@ -1040,11 +1284,29 @@ static void n810bm_tahvo_current_measure_work(struct work_struct *work)
 			 mv, ma,
 			 (ma <= 0) ? "discharging" : "charging");
 	}
+	old_pwm = bm->active_current_pwm;
 	res = lipocharge_update_state(&bm->charger, mv, ma, temp);
 	if (res) {
-		if (res > 0)
+		if (res > 0) {
 			dev_info(&bm->pdev->dev, "Battery fully charged");
+			/* Calibrate the gauge at the top of charge */
+			bm->gauge_charge = n810bm_gauge_full_charge(bm);
+			bm->gauge_valid = 1;
+		}
 		n810bm_stop_charge(bm);
+		goto out_unlock;
+	}
+
+	/* Measure at full rate while the PWM is being adjusted and back off
+	 * once the charge current settled within the hysteresis. */
+	if (bm->active_current_pwm != old_pwm)
+		interval = N810BM_CURRMEAS_INTERVAL;
+	else
+		interval = min(bm->currmeas_interval * 2,
+			       (unsigned int)N810BM_CURRMEAS_INTERVAL_MAX);
+	if (interval != bm->currmeas_interval) {
+		bm->currmeas_interval = interval;
+		n810bm_set_current_measure_timer(bm, interval);
 	}
 out_unlock:
 	mutex_unlock(&bm->mutex);
@@ -1120,6 +1382,27 @@ DEFINE_ATTR_SHOW_INT(charger_pwm, active_current_pwm);
 static DEFINE_ATTR_NOTIFY(charger_pwm);
 DEFINE_ATTR_SHOW_STORE_INT(charger_enable, charger_enabled);
 DEFINE_ATTR_SHOW_STORE_INT(charger_verbose, verbose_charge_log);
+DEFINE_ATTR_SHOW_INT(check_count, check_count);
+DEFINE_ATTR_SHOW_INT(check_idle_count, check_idle_count);
+DEFINE_ATTR_SHOW_INT(currmeas_interval, currmeas_interval);
+DEFINE_ATTR_SHOW_INT(currmeas_count, currmeas_count);
+
+static ssize_t n810bm_attr_check_interval_show(struct device *dev,
+					       struct device_attribute *attr,
+					       char *buf)
+{
+	struct n810bm *bm = device_to_n810bm(dev);
+	ssize_t count;
+
+	mutex_lock(&bm->mutex);
+	count = snprintf(buf, PAGE_SIZE, "%u\n",
+			 jiffies_to_msecs(bm->check_interval));
+	mutex_unlock(&bm->mutex);
+
+	return count;
+}
+static DEVICE_ATTR(check_interval, S_IRUGO,
+		   n810bm_attr_check_interval_show, NULL);
 
 static ssize_t n810bm_attr_battery_level_show(struct device *dev,
 					      struct device_attribute *attr,
@@ -1133,7 +1416,8 @@ static ssize_t n810bm_attr_battery_level_show(struct device *dev,
 	if (!bm->battery_present || lipocharge_is_charging(&bm->charger))
 		millivolt = 0;
 	else
-		millivolt = n810bm_measure_batt_voltage(bm);
+		millivolt = n810bm_batt_adc2mvolt(
+			n810bm_adc_sampled(bm, N810BM_ADC_SLOT_BATTVOLT));
 	if (millivolt >= 0) {
 		count = snprintf(buf, PAGE_SIZE, "%u\n",
 				 n810bm_mvolt2percent(millivolt));
@@ -1173,7 +1457,8 @@ static ssize_t n810bm_attr_battery_temp_show(struct device *dev,
 	int k;
 
 	mutex_lock(&bm->mutex);
-	k = n810bm_measure_batt_temp(bm);
+	//TODO convert to K
+	k = n810bm_adc_sampled(bm, N810BM_ADC_SLOT_BATTEMP);
 	if (k >= 0)
 		count = snprintf(buf, PAGE_SIZE, "%d\n", k);
 	mutex_unlock(&bm->mutex);
@@ -1192,8 +1477,10 @@ static ssize_t n810bm_attr_charger_voltage_show(struct device *dev,
 	int mv = 0;
 
 	mutex_lock(&bm->mutex);
-	if (bm->charger_present)
-		mv = n810bm_measure_charger_voltage(bm);
+	if (bm->charger_present) {
+		//TODO convert to mV
+		mv = n810bm_adc_sampled(bm, N810BM_ADC_SLOT_CHGVOLT);
+	}
 	if (mv >= 0)
 		count = snprintf(buf, PAGE_SIZE, "%d\n", mv);
 	mutex_unlock(&bm->mutex);
@@ -1212,7 +1499,8 @@ static ssize_t n810bm_attr_backup_battery_voltage_show(struct device *dev,
 	int mv;
 
 	mutex_lock(&bm->mutex);
-	mv = n810bm_measure_backup_batt_voltage(bm);
+	//TODO convert to mV
+	mv = n810bm_adc_sampled(bm, N810BM_ADC_SLOT_BKUPVOLT);
 	if (mv >= 0)
 		count = snprintf(buf, PAGE_SIZE, "%d\n", mv);
 	mutex_unlock(&bm->mutex);
@@ -1254,8 +1542,100 @@ static const struct device_attribute *n810bm_attrs[] = {
 	&dev_attr_charger_voltage,
 	&dev_attr_charger_enable,
 	&dev_attr_charger_pwm,
+	&dev_attr_check_interval,
+	&dev_attr_check_count,
+	&dev_attr_check_idle_count,
+	&dev_attr_currmeas_interval,
+	&dev_attr_currmeas_count,
+};
+
+static enum power_supply_property n810bm_psy_props[] = {
+	POWER_SUPPLY_PROP_STATUS,
+	POWER_SUPPLY_PROP_PRESENT,
+	POWER_SUPPLY_PROP_TECHNOLOGY,
+	POWER_SUPPLY_PROP_VOLTAGE_NOW,
+	POWER_SUPPLY_PROP_CURRENT_NOW,
+	POWER_SUPPLY_PROP_CHARGE_FULL_DESIGN,
+	POWER_SUPPLY_PROP_CHARGE_NOW,
+	POWER_SUPPLY_PROP_CAPACITY,
 };
 
+static int n810bm_psy_get_property(struct power_supply *psy,
+				   enum power_supply_property psp,
+				   union power_supply_propval *val)
+{
+	struct n810bm *bm = container_of(psy, struct n810bm, psy);
+	int err = 0, mv;
+
+	mutex_lock(&bm->mutex);
+	switch (psp) {
+	case POWER_SUPPLY_PROP_STATUS:
+		if (lipocharge_is_charging(&bm->charger))
+			val->intval = POWER_SUPPLY_STATUS_CHARGING;
+		else if (bm->charger_present && bm->gauge_valid &&
+			 n810bm_gauge_percent(bm) >= 100)
+			val->intval = POWER_SUPPLY_STATUS_FULL;
+		else if (bm->charger_present)
+			val->intval = POWER_SUPPLY_STATUS_NOT_CHARGING;
+		else
+			val->intval = POWER_SUPPLY_STATUS_DISCHARGING;
+		break;
+	case POWER_SUPPLY_PROP_PRESENT:
+		val->intval = bm->battery_present;
+		break;
+	case POWER_SUPPLY_PROP_TECHNOLOGY:
+		val->intval = POWER_SUPPLY_TECHNOLOGY_LIPO;
+		break;
+	case POWER_SUPPLY_PROP_VOLTAGE_NOW:
+		mv = n810bm_batt_adc2mvolt(
+			n810bm_adc_sampled(bm, N810BM_ADC_SLOT_BATTVOLT));
+		if (mv < 0)
+			err = mv;
+		else
+			val->intval = mv * 1000;
+		break;
+	case POWER_SUPPLY_PROP_CURRENT_NOW:
+		if (!bm->gauge_valid)
+			err = -ENODATA;
+		else
+			val->intval = bm->gauge_current;
+		break;
+	case POWER_SUPPLY_PROP_CHARGE_FULL_DESIGN:
+		if (!n810bm_known_battery_present(bm))
+			err = -ENODATA;
+		else
+			val->intval = (int)bm->capacity * 1000;
+		break;
+	case POWER_SUPPLY_PROP_CHARGE_NOW:
+		if (!bm->gauge_valid || !n810bm_known_battery_present(bm))
+			err = -ENODATA;
+		else
+			val->intval = div_s64(bm->gauge_charge, 3600);
+		break;
+	case POWER_SUPPLY_PROP_CAPACITY:
+		if (!n810bm_known_battery_present(bm)) {
+			err = -ENODATA;
+		} else if (bm->gauge_valid) {
+			val->intval = n810bm_gauge_percent(bm);
+		} else {
+			/* Fall back to the voltage estimate */
+			mv = n810bm_batt_adc2mvolt(
+				n810bm_adc_sampled(bm, N810BM_ADC_SLOT_BATTVOLT));
+			if (mv < 0)
+				err = mv;
+			else
+				val->intval = n810bm_mvolt2percent(mv);
+		}
+		break;
+	default:
+		err = -EINVAL;
+		break;
+	}
+	mutex_unlock(&bm->mutex);
+
+	return err;
+}
+
 static void n810bm_notify_work(struct work_struct *work)
 {
 	struct n810bm *bm = container_of(work, struct n810bm, notify_work);
@@ -1275,6 +1655,11 @@ static void n810bm_notify_work(struct work_struct *work)
 	do_notify(charger_present);
 	do_notify(charger_state);
 	do_notify(charger_pwm);
+
+	if (bm->initialized &&
+	    (notify_flags & ((1 << N810BM_NOTIFY_charger_present) |
+			     (1 << N810BM_NOTIFY_charger_state))))
+		power_supply_changed(&bm->psy);
 }
 
 static int n810bm_charger_set_current_pwm(struct lipocharge *c,
@@ -1331,7 +1716,14 @@ static int n810bm_hw_init(struct n810bm *bm)
 
 static void n810bm_cancel_and_flush_work(struct n810bm *bm)
 {
+	/* Each check work queues the next check on either of the two works,
+	 * so stop the re-arming before cancelling them one after the other. */
+	mutex_lock(&bm->mutex);
+	bm->checks_stopped = 1;
+	mutex_unlock(&bm->mutex);
+
 	cancel_delayed_work_sync(&bm->periodic_check_work);
+	cancel_delayed_work_sync(&bm->periodic_check_idle_work);
 	cancel_work_sync(&bm->notify_work);
 	cancel_work_sync(&bm->currmeas_irq_work);
 	flush_scheduled_work();
@@ -1352,6 +1744,16 @@ static int n810bm_device_init(struct n810bm *bm)
 	err = n810bm_hw_init(bm);
 	if (err)
 		goto error;
+
+	bm->psy.name = "n810-battery";
+	bm->psy.type = POWER_SUPPLY_TYPE_BATTERY;
+	bm->psy.properties = n810bm_psy_props;
+	bm->psy.num_properties = ARRAY_SIZE(n810bm_psy_props);
+	bm->psy.get_property = n810bm_psy_get_property;
+	err = power_supply_register(&bm->pdev->dev, &bm->psy);
+	if (err)
+		goto err_exit;
+
 	for (attr_index = 0; attr_index < ARRAY_SIZE(n810bm_attrs); attr_index++) {
 		err = device_create_file(&bm->pdev->dev, n810bm_attrs[attr_index]);
 		if (err)
@@ -1371,8 +1773,20 @@ static int n810bm_device_init(struct n810bm *bm)
 		goto err_free_retu_irq;
 	tahvo_disable_irq(TAHVO_INT_BATCURR);
 
+	/* Start the fuel gauge current sampling */
+	mutex_lock(&bm->mutex);
+	bm->gauge_enabled = 1;
+	n810bm_enable_current_measure(bm);
+	bm->currmeas_interval = N810BM_GAUGE_INTERVAL;
+	n810bm_set_current_measure_timer(bm, bm->currmeas_interval);
+	mutex_unlock(&bm->mutex);
+
+	mutex_lock(&bm->mutex);
+	bm->checks_stopped = 0;
+	bm->check_interval = N810BM_CHECK_INTERVAL;
 	schedule_delayed_work(&bm->periodic_check_work,
-			      round_jiffies_relative(N810BM_CHECK_INTERVAL));
+			      round_jiffies_relative(bm->check_interval));
+	mutex_unlock(&bm->mutex);
 
 	bm->initialized = 1;
 	dev_info(&bm->pdev->dev, "Battery management initialized");
@@ -1384,7 +1798,8 @@ err_free_retu_irq:
 err_unwind_attrs:
 	for (attr_index--; attr_index >= 0; attr_index--)
 		device_remove_file(&bm->pdev->dev, n810bm_attrs[attr_index]);
-/*err_exit:*/
+	power_supply_unregister(&bm->psy);
+err_exit:
 	n810bm_hw_exit(bm);
 error:
 	n810bm_cancel_and_flush_work(bm);
@@ -1399,6 +1814,16 @@ static void n810bm_device_exit(struct n810bm *bm)
 	if (!bm->initialized)
 		return;
 
+	mutex_lock(&bm->mutex);
+	n810bm_stop_charge(bm);
+	if (bm->gauge_enabled) {
+		bm->gauge_enabled = 0;
+		bm->currmeas_interval = 0;
+		n810bm_set_current_measure_timer(bm, 0);
+		n810bm_disable_current_measure(bm);
+	}
+	mutex_unlock(&bm->mutex);
+
 	lipocharge_exit(&bm->charger);
 	tahvo_free_irq(TAHVO_INT_BATCURR);
 //XXX	retu_free_irq(RETU_INT_ADCS);
@@ -1410,6 +1835,7 @@ static void n810bm_device_exit(struct n810bm *bm)
 	n810bm_hw_exit(bm);
 
 	bm->initialized = 0;
+	power_supply_unregister(&bm->psy);
 }
 
 static void n810bm_pmm_block_found(const struct firmware *fw, void *context)
@@ -1464,6 +1890,9 @@ static int __devinit n810bm_probe(void)
 	platform_set_drvdata(n810bm_tahvo_device, bm);
 	mutex_init(&bm->mutex);
 	INIT_DELAYED_WORK(&bm->periodic_check_work, n810bm_periodic_check_work);
+	INIT_DELAYED_WORK_DEFERRABLE(&bm->periodic_check_idle_work,
+				     n810bm_periodic_check_idle_work);
+	bm->check_interval = N810BM_CHECK_INTERVAL;
 	INIT_WORK(&bm->notify_work, n810bm_notify_work);
 	INIT_WORK(&bm->currmeas_irq_work, n810bm_tahvo_current_measure_work);
 
@@ -28,6 +28,7 @@
 #include <linux/delay.h>
 #include <linux/input.h>
 #include <linux/platform_device.h>
+#include <linux/workqueue.h>
 
 #include "retu.h"
 
@@ -35,6 +36,14 @@
 
 #define RETU_HEADSET_KEY		KEY_PHONE
 
+/*
+ * After a hook interrupt, detection is masked for a short window and then
+ * re-armed.  A button still held retriggers the interrupt; if none comes
+ * within the release window the button is reported released.
+ */
+#define RETU_HEADSET_MASK_MS		50
+#define RETU_HEADSET_RELEASE_MS		350
+
 struct retu_headset {
 	spinlock_t			lock;
 	struct mutex			mutex;
@@ -43,8 +52,8 @@ struct retu_headset {
 	unsigned			bias_enabled;
 	unsigned			detection_enabled;
 	unsigned			pressed;
-	struct timer_list		enable_timer;
-	struct timer_list		detect_timer;
+	struct delayed_work		enable_work;
+	struct delayed_work		detect_work;
 	int				irq;
 };
 
@@ -100,8 +109,8 @@ static void retu_headset_det_disable(struct retu_headset *hs)
 	mutex_lock(&hs->mutex);
 	if (hs->detection_enabled) {
 		hs->detection_enabled = 0;
-		del_timer_sync(&hs->enable_timer);
-		del_timer_sync(&hs->detect_timer);
+		cancel_delayed_work_sync(&hs->enable_work);
+		cancel_delayed_work_sync(&hs->detect_work);
 		spin_lock_irqsave(&hs->lock, flags);
 		if (hs->pressed)
 			input_report_key(hs->idev, RETU_HEADSET_KEY, 0);
@@ -195,23 +204,32 @@ static irqreturn_t retu_headset_hook_interrupt(int irq, void *_hs)
 	spin_unlock_irqrestore(&hs->lock, flags);
 	retu_set_clear_reg_bits(hs->dev, RETU_REG_CC1, 0,
 			(1 << 10) | (1 << 8));
-	mod_timer(&hs->enable_timer, jiffies + msecs_to_jiffies(50));
+	cancel_delayed_work(&hs->detect_work);
+	schedule_delayed_work(&hs->enable_work,
+			      msecs_to_jiffies(RETU_HEADSET_MASK_MS));
 
 	return IRQ_HANDLED;
 }
 
-static void retu_headset_enable_timer(unsigned long arg)
+/*
+ * Re-arming detection is a CBUS transfer, which sleeps on the Retu lock,
+ * so both steps run from process context rather than from timers.
+ */
+static void retu_headset_enable_work(struct work_struct *work)
 {
-	struct retu_headset *hs = (struct retu_headset *) arg;
+	struct retu_headset *hs = container_of(work, struct retu_headset,
+					       enable_work.work);
 
 	retu_set_clear_reg_bits(hs->dev, RETU_REG_CC1,
 			(1 << 10) | (1 << 8), 0);
-	mod_timer(&hs->detect_timer, jiffies + msecs_to_jiffies(350));
+	schedule_delayed_work(&hs->detect_work,
+			      msecs_to_jiffies(RETU_HEADSET_RELEASE_MS));
 }
 
-static void retu_headset_detect_timer(unsigned long arg)
+static void retu_headset_detect_work(struct work_struct *work)
 {
-	struct retu_headset *hs = (struct retu_headset *) arg;
+	struct retu_headset *hs = container_of(work, struct retu_headset,
+					       detect_work.work);
 	unsigned long flags;
 
 	spin_lock_irqsave(&hs->lock, flags);
@@ -260,10 +278,8 @@ static int __init retu_headset_probe(struct platform_device *pdev)
 
 	spin_lock_init(&hs->lock);
 	mutex_init(&hs->mutex);
-	setup_timer(&hs->enable_timer, retu_headset_enable_timer,
-		    (unsigned long) hs);
-	setup_timer(&hs->detect_timer, retu_headset_detect_timer,
-		    (unsigned long) hs);
+	INIT_DELAYED_WORK(&hs->enable_work, retu_headset_enable_work);
+	INIT_DELAYED_WORK(&hs->detect_work, retu_headset_detect_work);
 
 	irq = platform_get_irq(pdev, 0);
 	hs->irq = irq;
@@ -38,6 +38,9 @@
 #include <linux/interrupt.h>
 #include <linux/platform_device.h>
 #include <linux/gpio.h>
+#include <linux/ktime.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <asm/uaccess.h>
 #include <asm/mach-types.h>
@@ -49,6 +52,16 @@
 #include "cbus.h"
 #include "retu.h"
 
+/* Latency histogram buckets, bucket n counts latencies below 2^(n+4) us */
+#define RETU_LAT_BUCKETS	8
+
+struct retu_irq_stats {
+	unsigned long		count;
+	unsigned long		hist[RETU_LAT_BUCKETS];
+	u32			max_us;
+	u64			total_us;
+};
+
 struct retu {
 	/* Device lock */
 	struct mutex		mutex;
@@ -67,11 +80,58 @@ struct retu {
 	int			mask;
 	bool			mask_pending;
 
+	/* Set while the demux thread runs, defers IMR/IDR writes */
+	bool			in_demux;
+
 	bool			is_vilma;
+
+	/* Time of the last top half, used for latency accounting */
+	ktime_t			irq_stamp;
+	struct retu_irq_stats	stats[MAX_RETU_IRQ_HANDLERS];
+	unsigned long		imr_writes;
+	unsigned long		imr_coalesced;
+#ifdef CONFIG_DEBUG_FS
+	struct dentry		*debugfs;
+#endif
+
+	/* Shadow copies of the registers only software changes */
+	u16			cache[RETU_REG_MAX + 1];
+	u32			cache_valid;
 };
 
 static struct retu *the_retu;
 
+/*
+ * Registers whose contents never change behind our back. Reads of
+ * these are served from the shadow cache once it has been filled.
+ */
+#define RETU_CACHED_REGS	(BIT(RETU_REG_IMR) | BIT(RETU_REG_CC1) | \
+				 BIT(RETU_REG_CC2) | BIT(RETU_REG_AUDTXR))
+
+static inline bool retu_reg_cacheable(unsigned reg)
+{
+	return reg <= RETU_REG_MAX && (RETU_CACHED_REGS & BIT(reg));
+}
+
+static inline bool retu_reg_cached(struct retu *retu, unsigned reg)
+{
+	return retu_reg_cacheable(reg) && (retu->cache_valid & BIT(reg));
+}
+
+static void retu_cache_update(struct retu *retu, unsigned reg, int val)
+{
+	if (!retu_reg_cacheable(reg))
+		return;
+
+	if (val < 0) {
+		retu->cache_valid &= ~BIT(reg);
+		return;
+	}
+
+	retu->cache[reg] = val;
+	retu->cache_valid |= BIT(reg);
+}
+
 /**
  * __retu_read_reg - Read a value from a register in Retu
  * @retu: pointer to retu structure
@@ -79,7 +139,15 @@ static struct retu *the_retu;
  */
 static int __retu_read_reg(struct retu *retu, unsigned reg)
 {
-	return cbus_read_reg(retu->devid, reg);
+	int			ret;
+
+	if (retu_reg_cached(retu, reg))
+		return retu->cache[reg];
+
+	ret = cbus_read_reg(retu->devid, reg);
+	retu_cache_update(retu, reg, ret);
+
+	return ret;
 }
 
 /**
@@ -90,7 +158,72 @@ static int __retu_read_reg(struct retu *retu, unsigned reg)
  */
 static void __retu_write_reg(struct retu *retu, unsigned reg, u16 val)
 {
-	cbus_write_reg(retu->devid, reg, val);
+	int			ret;
+
+	ret = cbus_write_reg(retu->devid, reg, val);
+	retu_cache_update(retu, reg, ret < 0 ? ret : val);
+}
+
+/**
+ * __retu_flush_ops - Send a run of queued operations down to CBUS
+ * @retu: pointer to retu structure
+ * @ops: the operations to send
+ * @num: number of operations
+ */
+static int __retu_flush_ops(struct retu *retu, struct cbus_op *ops,
+		unsigned num)
+{
+	unsigned		i;
+	int			ret;
+
+	if (!num)
+		return 0;
+
+	ret = cbus_transfer_batch(retu->devid, ops, num);
+	for (i = 0; i < num; i++)
+		retu_cache_update(retu, ops[i].reg, ret < 0 ? ret : ops[i].val);
+
+	return ret;
+}
+
+/**
+ * __retu_transfer - Execute a vector of register operations
+ * @retu: pointer to retu structure
+ * @ops: the operations to execute
+ * @num: number of operations
+ *
+ * Operations which can be answered from the shadow cache are not sent
+ * over the bus; everything in between goes down as one CBUS batch.
+ * Must be called with retu->mutex held.
+ */
+static int __retu_transfer(struct retu *retu, struct cbus_op *ops,
+		unsigned num)
+{
+	unsigned		i, start = 0;
+	int			ret;
+
+	for (i = 0; i < num; i++) {
+		struct cbus_op	*op = &ops[i];
+
+		if (op->op == CBUS_OP_WRITE || !retu_reg_cached(retu, op->reg))
+			continue;
+
+		/* Earlier writes may touch the cached value, flush them */
+		ret = __retu_flush_ops(retu, ops + start, i - start);
+		if (ret < 0)
+			return ret;
+		start = i + 1;
+
+		if (op->op == CBUS_OP_READ) {
+			op->val = retu->cache[op->reg];
+			continue;
+		}
+
+		op->val |= retu->cache[op->reg] & ~op->mask;
+		__retu_write_reg(retu, op->reg, op->val);
+	}
+
+	return __retu_flush_ops(retu, ops + start, num - start);
 }
 
 /**
@@ -126,6 +259,28 @@ void retu_write_reg(struct device *child, unsigned reg, u16 val)
 }
 EXPORT_SYMBOL_GPL(retu_write_reg);
 
+/**
+ * retu_transfer - Execute a batch of register operations
+ * @child: device pointer for the calling child
+ * @ops: the operations to execute, in order
+ * @num: number of operations
+ *
+ * The whole batch runs under the Retu lock, so it is atomic against
+ * other Retu users. Returns zero or the first negative error.
+ */
+int retu_transfer(struct device *child, struct cbus_op *ops, unsigned num)
+{
+	struct retu		*retu = dev_get_drvdata(child->parent);
+	int			ret;
+
+	mutex_lock(&retu->mutex);
+	ret = __retu_transfer(retu, ops, num);
+	mutex_unlock(&retu->mutex);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(retu_transfer);
+
 /**
  * retu_set_clear_reg_bits - helper function to read/set/clear bits
  * @child: device pointer to calling child
@@ -137,19 +292,52 @@ void retu_set_clear_reg_bits(struct device *child, unsigned reg, u16 set,
 		u16 clear)
 {
 	struct retu		*retu = dev_get_drvdata(child->parent);
-	u16			w;
+	struct cbus_op		op = {
+		.op	= CBUS_OP_MASKSET,
+		.reg	= reg,
+		.mask	= clear,
+		.val	= set,
+	};
 
 	mutex_lock(&retu->mutex);
-	w = __retu_read_reg(retu, reg);
-	w &= ~clear;
-	w |= set;
-	__retu_write_reg(retu, reg, w);
+	__retu_transfer(retu, &op, 1);
 	mutex_unlock(&retu->mutex);
 }
 EXPORT_SYMBOL_GPL(retu_set_clear_reg_bits);
 
 #define ADC_MAX_CHAN_NUMBER	13
 
+/**
+ * __retu_read_adc - Reads one AD conversion result
+ * @retu: pointer to retu structure
+ * @channel: the ADC channel to read from
+ *
+ * Must be called with retu->mutex held.
+ */
+static int __retu_read_adc(struct retu *retu, int channel)
+{
+	struct cbus_op		ops[] = {
+		{ .op = CBUS_OP_WRITE, .reg = RETU_REG_ADCR,
+		  .val = channel << 10, },
+		{ .op = CBUS_OP_READ, .reg = RETU_REG_ADCR, },
+	};
+	int			res;
+
+	if ((channel == 8) && retu->is_vilma) {
+		int scr = __retu_read_reg(retu, RETU_REG_ADCSCR);
+		int ch = (__retu_read_reg(retu, RETU_REG_ADCR) >> 10) & 0xf;
+		if (((scr & 0xff) != 0) && (ch != 8))
+			__retu_write_reg(retu, RETU_REG_ADCSCR, (scr & ~0xff));
+	}
+
+	/* Select the channel and read result */
+	res = __retu_transfer(retu, ops, ARRAY_SIZE(ops));
+	if (res == 0)
+		res = ops[1].val & 0x3ff;
+
+	return res;
+}
+
 /**
  * retu_read_adc - Reads AD conversion result
  * @child: device pointer to calling child
@@ -168,16 +356,7 @@ int retu_read_adc(struct device *child, int channel)
 
 	mutex_lock(&retu->mutex);
 
-	if ((channel == 8) && retu->is_vilma) {
-		int scr = __retu_read_reg(retu, RETU_REG_ADCSCR);
-		int ch = (__retu_read_reg(retu, RETU_REG_ADCR) >> 10) & 0xf;
-		if (((scr & 0xff) != 0) && (ch != 8))
-			__retu_write_reg(retu, RETU_REG_ADCSCR, (scr & ~0xff));
-	}
-
-	/* Select the channel and read result */
-	__retu_write_reg(retu, RETU_REG_ADCR, channel << 10);
-	res = __retu_read_reg(retu, RETU_REG_ADCR) & 0x3ff;
+	res = __retu_read_adc(retu, channel);
 
 	if (retu->is_vilma)
 		__retu_write_reg(retu, RETU_REG_ADCR, (1 << 13));
@@ -189,9 +368,110 @@ int retu_read_adc(struct device *child, int channel)
 }
 EXPORT_SYMBOL_GPL(retu_read_adc);
 
+/**
+ * retu_read_adc_batch - Reads a list of AD conversion results
+ * @child: device pointer to calling child
+ * @channels: the ADC channels to read from, in order
+ * @results: where to store the conversion results
+ * @num: number of conversions
+ *
+ * All conversions run back to back under one hold of the Retu lock,
+ * so a whole set of measurements costs a single lock round trip and
+ * sees a consistent ADC setup. Returns zero or a negative error.
+ */
+int retu_read_adc_batch(struct device *child, const u8 *channels,
+		u16 *results, unsigned num)
+{
+	struct retu		*retu = dev_get_drvdata(child->parent);
+	unsigned		i;
+	int			res = 0;
+
+	if (!retu)
+		return -ENODEV;
+
+	for (i = 0; i < num; i++)
+		if (channels[i] > ADC_MAX_CHAN_NUMBER)
+			return -EINVAL;
+
+	mutex_lock(&retu->mutex);
+
+	for (i = 0; i < num; i++) {
+		res = __retu_read_adc(retu, channels[i]);
+		if (res < 0)
+			break;
+		results[i] = res;
+	}
+
+	if (retu->is_vilma)
+		__retu_write_reg(retu, RETU_REG_ADCR, (1 << 13));
+
+	mutex_unlock(&retu->mutex);
+
+	return res < 0 ? res : 0;
+}
+EXPORT_SYMBOL_GPL(retu_read_adc_batch);
+
+/**
+ * __retu_sync_irq_regs - Write out pending IMR and IDR updates
+ * @retu: pointer to retu structure
+ *
+ * The mask is only written when it actually differs from what the
+ * chip has. Must be called with retu->mutex held.
+ */
+static void __retu_sync_irq_regs(struct retu *retu)
+{
+	if (retu->mask_pending) {
+		if (retu_reg_cached(retu, RETU_REG_IMR) &&
+				retu->cache[RETU_REG_IMR] == (u16)retu->mask) {
+			retu->imr_coalesced++;
+		} else {
+			__retu_write_reg(retu, RETU_REG_IMR, retu->mask);
+			retu->imr_writes++;
+		}
+		retu->mask_pending = false;
+	}
+
+	if (retu->ack_pending) {
+		__retu_write_reg(retu, RETU_REG_IDR, retu->ack);
+		retu->ack = 0;
+		retu->ack_pending = false;
+	}
+}
+
+static void retu_irq_account(struct retu *retu, int bit, ktime_t start)
+{
+	struct retu_irq_stats	*stats = &retu->stats[bit];
+	s64			us;
+	int			bucket;
+
+	us = ktime_us_delta(ktime_get(), start);
+	if (us < 0)
+		us = 0;
+
+	bucket = fls((u32)(us >> 4));
+	if (bucket >= RETU_LAT_BUCKETS)
+		bucket = RETU_LAT_BUCKETS - 1;
+
+	stats->count++;
+	stats->hist[bucket]++;
+	stats->total_us += us;
+	if (us > stats->max_us)
+		stats->max_us = us;
+}
+
+static irqreturn_t retu_irq_hardirq(int irq, void *_retu)
+{
+	struct retu		*retu = _retu;
+
+	retu->irq_stamp = ktime_get();
+
+	return IRQ_WAKE_THREAD;
+}
+
 static irqreturn_t retu_irq_handler(int irq, void *_retu)
 {
 	struct retu		*retu = _retu;
+	ktime_t			stamp = retu->irq_stamp;
 
 	int			i;
 
@@ -201,11 +481,15 @@ static irqreturn_t retu_irq_handler(int irq, void *_retu)
 	mutex_lock(&retu->mutex);
 	idr = __retu_read_reg(retu, RETU_REG_IDR);
 	imr = __retu_read_reg(retu, RETU_REG_IMR);
+	retu->in_demux = true;
 	mutex_unlock(&retu->mutex);
 
 	idr &= ~imr;
 	if (!idr) {
 		dev_vdbg(retu->dev, "No IRQ, spurious?\n");
+		mutex_lock(&retu->mutex);
+		retu->in_demux = false;
+		mutex_unlock(&retu->mutex);
 		return IRQ_NONE;
 	}
 
@@ -214,11 +498,82 @@ static irqreturn_t retu_irq_handler(int irq, void *_retu)
 			continue;
 
 		handle_nested_irq(i);
+		retu_irq_account(retu, i - retu->irq_base, stamp);
 	}
 
+	/*
+	 * Mask and ack changes made by the children while they ran are
+	 * written out once here, instead of once per child.
+	 */
+	mutex_lock(&retu->mutex);
+	retu->in_demux = false;
+	__retu_sync_irq_regs(retu);
+	mutex_unlock(&retu->mutex);
+
 	return IRQ_HANDLED;
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int retu_irq_stats_show(struct seq_file *s, void *unused)
+{
+	struct retu		*retu = s->private;
+	int			i, j;
+
+	seq_printf(s, "imr writes %lu coalesced %lu\n",
+			retu->imr_writes, retu->imr_coalesced);
+	seq_printf(s, "irq    count   max_us   avg_us  histogram (<16us, x2 per bucket)\n");
+
+	for (i = 0; i < MAX_RETU_IRQ_HANDLERS; i++) {
+		struct retu_irq_stats	*stats = &retu->stats[i];
+
+		if (!stats->count)
+			continue;
+
+		seq_printf(s, "%3d %8lu %8u %8llu ", i, stats->count,
+				stats->max_us,
+				div_u64(stats->total_us, stats->count));
+		for (j = 0; j < RETU_LAT_BUCKETS; j++)
+			seq_printf(s, " %lu", stats->hist[j]);
+		seq_printf(s, "\n");
+	}
+
+	return 0;
+}
+
+static int retu_irq_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, retu_irq_stats_show, inode->i_private);
+}
+
+static const struct file_operations retu_irq_stats_fops = {
+	.open		= retu_irq_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+	.owner		= THIS_MODULE,
+};
+
+static void retu_debugfs_init(struct retu *retu)
+{
+	retu->debugfs = debugfs_create_dir("retu", NULL);
+	if (IS_ERR_OR_NULL(retu->debugfs)) {
+		retu->debugfs = NULL;
+		return;
+	}
+
+	debugfs_create_file("irq_stats", S_IRUGO, retu->debugfs, retu,
+			&retu_irq_stats_fops);
+}
+
+static void retu_debugfs_exit(struct retu *retu)
+{
+	debugfs_remove_recursive(retu->debugfs);
+}
+#else
+static inline void retu_debugfs_init(struct retu *retu) { }
+static inline void retu_debugfs_exit(struct retu *retu) { }
+#endif
+
 /* -------------------------------------------------------------------------- */
 
 static void retu_irq_mask(struct irq_data *data)
@@ -260,15 +615,9 @@ static void retu_bus_sync_unlock(struct irq_data *data)
 {
 	struct retu		*retu = irq_data_get_irq_chip_data(data);
 
-	if (retu->mask_pending) {
-		__retu_write_reg(retu, RETU_REG_IMR, retu->mask);
-		retu->mask_pending = false;
-	}
-
-	if (retu->ack_pending) {
-		__retu_write_reg(retu, RETU_REG_IDR, retu->ack);
-		retu->ack_pending = false;
-	}
+	/* The demux thread flushes everything once it is done */
+	if (!retu->in_demux)
+		__retu_sync_irq_regs(retu);
 
 	mutex_unlock(&retu->mutex);
 }
@@ -460,6 +809,7 @@ static int __init retu_probe(struct platform_device *pdev)
 	retu->irq_base	= pdata->irq_base;
 	retu->irq_end	= pdata->irq_end;
 	retu->devid	= pdata->devid;
+	retu->dev	= &pdev->dev;
 	the_retu	= retu;
 
 	mutex_init(&retu->mutex);
@@ -475,10 +825,11 @@ static int __init retu_probe(struct platform_device *pdev)
 			(rev >> 4) & 0x07, rev & 0x0f);
 
 	/* Mask all RETU interrupts */
-	__retu_write_reg(retu, RETU_REG_IMR, 0xffff);
+	retu->mask = 0xffff;
+	__retu_write_reg(retu, RETU_REG_IMR, retu->mask);
 
-	ret = request_threaded_irq(retu->irq, NULL, retu_irq_handler, 0,
-			  "retu", retu);
+	ret = request_threaded_irq(retu->irq, retu_irq_hardirq,
+			retu_irq_handler, 0, "retu", retu);
 	if (ret < 0) {
 		dev_err(&pdev->dev, "Unable to register IRQ handler\n");
 		goto err1;
@@ -495,6 +846,8 @@ static int __init retu_probe(struct platform_device *pdev)
 		goto err2;
 	}
 
+	retu_debugfs_init(retu);
+
 	return 0;
 
 err2:
@@ -517,6 +870,8 @@ static int __exit retu_remove(struct platform_device *pdev)
 	pm_power_off = NULL;
 	the_retu = NULL;
 
+	retu_debugfs_exit(retu);
+
 	/* Mask all RETU interrupts */
 	__retu_write_reg(retu, RETU_REG_IMR, 0xffff);
 
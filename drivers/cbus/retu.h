@@ -25,6 +25,8 @@
 
 #include <linux/types.h>
 
+struct cbus_op;
+
 /* Registers */
 #define RETU_REG_ASICR		0x00	/* ASIC ID & revision */
 #define RETU_REG_IDR		0x01	/* Interrupt ID */
@@ -81,5 +83,8 @@ void retu_write_reg(struct device *child, unsigned reg, u16 val);
 void retu_set_clear_reg_bits(struct device *child, unsigned reg, u16 set,
 		u16 clear);
 int retu_read_adc(struct device *child, int channel);
+int retu_read_adc_batch(struct device *child, const u8 *channels,
+		u16 *results, unsigned num);
+int retu_transfer(struct device *child, struct cbus_op *ops, unsigned num);
 
 #endif /* __DRIVERS_CBUS_RETU_H */
@@ -93,7 +93,9 @@ struct tahvo_usb {
 	struct platform_device *pt_dev;
 	struct otg_transceiver otg;
 	int vbus_state;
-	struct work_struct irq_work;
+	int idsr;		/* IDSR as last read by the VBUS interrupt */
+	int vbus_check;		/* act on the next VBUS work even if unchanged */
+	struct delayed_work irq_work;
 	struct mutex serialize;
 #ifdef CONFIG_USB_OTG
 	int tahvo_mode;
@@ -277,11 +279,13 @@ static int host_resume(struct tahvo_usb *tu)
 
 #endif
 
-static void check_vbus_state(struct tahvo_usb *tu)
+/* Time VBUS has to stay put before a cable event is acted upon */
+#define TAHVO_VBUS_DEBOUNCE	msecs_to_jiffies(20)
+
+static void __check_vbus_state(struct tahvo_usb *tu, int reg)
 {
-	int reg, prev_state;
+	int prev_state;
 
-	reg = tahvo_read_reg(TAHVO_REG_IDSR);
 	if (reg & 0x01) {
 		u32 l;
 
@@ -332,6 +336,11 @@ static void check_vbus_state(struct tahvo_usb *tu)
 		sysfs_notify(&tu->pt_dev->dev.kobj, NULL, "vbus_state");
 }
 
+static void check_vbus_state(struct tahvo_usb *tu)
+{
+	__check_vbus_state(tu, tahvo_read_reg(TAHVO_REG_IDSR));
+}
+
 static void tahvo_usb_become_host(struct tahvo_usb *tu)
 {
 	u32 l;
@@ -445,16 +454,13 @@ static int tahvo_usb_set_power(struct otg_transceiver *dev, unsigned mA)
 static int tahvo_usb_set_suspend(struct otg_transceiver *dev, int suspend)
 {
 	struct tahvo_usb *tu = container_of(dev, struct tahvo_usb, otg);
-	u16 w;
 
 	dev_dbg(&tu->pt_dev->dev, "set_suspend\n");
 
-	w = tahvo_read_reg(TAHVO_REG_USBR);
 	if (suspend)
-		w &= ~USBR_NSUSPEND;
+		tahvo_set_clear_reg_bits(TAHVO_REG_USBR, 0, USBR_NSUSPEND);
 	else
-		w |= USBR_NSUSPEND;
-	tahvo_write_reg(TAHVO_REG_USBR, w);
+		tahvo_set_clear_reg_bits(TAHVO_REG_USBR, USBR_NSUSPEND, 0);
 
 	return 0;
 }
@@ -571,10 +577,19 @@ static int tahvo_usb_set_peripheral(struct otg_transceiver *otg, struct usb_gadg
 
 static void tahvo_usb_irq_work(struct work_struct *work)
 {
-	struct tahvo_usb *tu = container_of(work, struct tahvo_usb, irq_work);
+	struct tahvo_usb *tu = container_of(work, struct tahvo_usb,
+					    irq_work.work);
 
 	mutex_lock(&tu->serialize);
-	check_vbus_state(tu);
+	/*
+	 * The IDSR value cached by the interrupt is the settled one, as any
+	 * later edge would have pushed this work out again.  A cable that
+	 * bounced back to where it was needs no role change at all.
+	 */
+	if (tu->vbus_check || (tu->idsr & 0x01) != tu->vbus_state) {
+		tu->vbus_check = 0;
+		__check_vbus_state(tu, tu->idsr);
+	}
 	mutex_unlock(&tu->serialize);
 }
 
@@ -584,8 +599,11 @@ static void tahvo_usb_vbus_interrupt(unsigned long arg)
 
 	tahvo_ack_irq(TAHVO_INT_VBUSON);
 	/* Seems we need this to acknowledge the interrupt */
-	tahvo_read_reg(TAHVO_REG_IDSR);
-	schedule_work(&tu->irq_work);
+	tu->idsr = tahvo_read_reg(TAHVO_REG_IDSR);
+
+	/* Restart the debounce window on every edge */
+	cancel_delayed_work(&tu->irq_work);
+	schedule_delayed_work(&tu->irq_work, TAHVO_VBUS_DEBOUNCE);
 }
 
 #ifdef CONFIG_USB_OTG
@@ -671,7 +689,7 @@ static int __init tahvo_usb_probe(struct platform_device *pdev)
 #endif
 #endif
 
-	INIT_WORK(&tu->irq_work, tahvo_usb_irq_work);
+	INIT_DELAYED_WORK(&tu->irq_work, tahvo_usb_irq_work);
 	mutex_init(&tu->serialize);
 
 	tu->ick = clk_get(NULL, "usb_l4_ick");
@@ -684,7 +702,9 @@ static int __init tahvo_usb_probe(struct platform_device *pdev)
 
 	/* Set initial state, so that we generate kevents only on
 	 * state changes */
-	tu->vbus_state = tahvo_read_reg(TAHVO_REG_IDSR) & 0x01;
+	tu->idsr = tahvo_read_reg(TAHVO_REG_IDSR);
+	tu->vbus_state = tu->idsr & 0x01;
+	tu->vbus_check = 1;
 
 	/* We cannot enable interrupt until omap_udc is initialized */
 	ret = tahvo_request_irq(TAHVO_INT_VBUSON, tahvo_usb_vbus_interrupt,
@@ -723,7 +743,7 @@ static int __init tahvo_usb_probe(struct platform_device *pdev)
 
 	/* Act upon current vbus state once at startup. A vbus state irq may or
 	 * may not be generated in addition to this. */
-	schedule_work(&tu->irq_work);
+	schedule_delayed_work(&tu->irq_work, 0);
 	return 0;
 
 err_free_irq:
@@ -745,7 +765,7 @@ static int __exit tahvo_usb_remove(struct platform_device *pdev)
 	dev_dbg(&pdev->dev, "remove\n");
 
 	tahvo_free_irq(TAHVO_INT_VBUSON);
-	flush_scheduled_work();
+	cancel_delayed_work_sync(&tu->irq_work);
 	otg_set_transceiver(0);
 	device_remove_file(&pdev->dev, &dev_attr_vbus_state);
 #ifdef CONFIG_USB_OTG
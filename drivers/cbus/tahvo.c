@@ -64,12 +64,74 @@ struct tahvo_irq_handler_desc {
 
 static struct tahvo_irq_handler_desc tahvo_irq_handlers[MAX_TAHVO_IRQ_HANDLERS];
 
+/*
+ * Shadow copies of the registers only software changes. Reads of
+ * these are served from the cache once it has been filled.
+ */
+#define TAHVO_CACHED_REGS	(BIT(TAHVO_REG_IMR) | \
+				 BIT(TAHVO_REG_CHGCURR) | \
+				 BIT(TAHVO_REG_LEDPWMR) | \
+				 BIT(TAHVO_REG_USBR) | \
+				 BIT(TAHVO_REG_CHGCTL) | \
+				 BIT(TAHVO_REG_BATCURRTIMER))
+
+/* Both protected by tahvo_lock */
+static u16 tahvo_cache[TAHVO_REG_MAX + 1];
+static u16 tahvo_cache_valid;
+
+static inline int tahvo_reg_cacheable(unsigned reg)
+{
+	return reg <= TAHVO_REG_MAX && (TAHVO_CACHED_REGS & BIT(reg));
+}
+
+static inline int tahvo_reg_cached(unsigned reg)
+{
+	return tahvo_reg_cacheable(reg) && (tahvo_cache_valid & BIT(reg));
+}
+
+static void tahvo_cache_update(unsigned reg, int val)
+{
+	if (!tahvo_reg_cacheable(reg))
+		return;
+
+	if (val < 0) {
+		tahvo_cache_valid &= ~BIT(reg);
+		return;
+	}
+
+	tahvo_cache[reg] = val;
+	tahvo_cache_valid |= BIT(reg);
+}
+
 int tahvo_get_status(void)
 {
 	return tahvo_initialized;
 }
 EXPORT_SYMBOL(tahvo_get_status);
 
+static int __tahvo_read_reg(unsigned reg)
+{
+	int ret;
+
+	BUG_ON(!tahvo_initialized);
+	if (tahvo_reg_cached(reg))
+		return tahvo_cache[reg];
+
+	ret = cbus_read_reg(TAHVO_ID, reg);
+	tahvo_cache_update(reg, ret);
+
+	return ret;
+}
+
+static void __tahvo_write_reg(unsigned reg, u16 val)
+{
+	int ret;
+
+	BUG_ON(!tahvo_initialized);
+	ret = cbus_write_reg(TAHVO_ID, reg, val);
+	tahvo_cache_update(reg, ret < 0 ? ret : val);
+}
+
 /**
  * tahvo_read_reg - Read a value from a register in Tahvo
  * @reg: the register to read from
@@ -78,8 +140,14 @@ EXPORT_SYMBOL(tahvo_get_status);
  */
 int tahvo_read_reg(unsigned reg)
 {
-	BUG_ON(!tahvo_initialized);
-	return cbus_read_reg(TAHVO_ID, reg);
+	unsigned long flags;
+	int ret;
+
+	spin_lock_irqsave(&tahvo_lock, flags);
+	ret = __tahvo_read_reg(reg);
+	spin_unlock_irqrestore(&tahvo_lock, flags);
+
+	return ret;
 }
 EXPORT_SYMBOL(tahvo_read_reg);
 
@@ -92,11 +160,85 @@ EXPORT_SYMBOL(tahvo_read_reg);
  */
 void tahvo_write_reg(unsigned reg, u16 val)
 {
-	BUG_ON(!tahvo_initialized);
-	cbus_write_reg(TAHVO_ID, reg, val);
+	unsigned long flags;
+
+	spin_lock_irqsave(&tahvo_lock, flags);
+	__tahvo_write_reg(reg, val);
+	spin_unlock_irqrestore(&tahvo_lock, flags);
 }
 EXPORT_SYMBOL(tahvo_write_reg);
 
+static int tahvo_flush_ops(struct cbus_op *ops, unsigned num)
+{
+	unsigned i;
+	int ret;
+
+	if (!num)
+		return 0;
+
+	ret = cbus_transfer_batch(TAHVO_ID, ops, num);
+	for (i = 0; i < num; i++)
+		tahvo_cache_update(ops[i].reg, ret < 0 ? ret : ops[i].val);
+
+	return ret;
+}
+
+/*
+ * Execute a vector of operations; must be called with tahvo_lock held.
+ * Operations answered from the shadow cache are not sent over the bus,
+ * everything in between goes down as one CBUS batch.
+ */
+static int __tahvo_transfer(struct cbus_op *ops, unsigned num)
+{
+	unsigned i, start = 0;
+	int ret;
+
+	BUG_ON(!tahvo_initialized);
+	for (i = 0; i < num; i++) {
+		struct cbus_op *op = &ops[i];
+
+		if (op->op == CBUS_OP_WRITE || !tahvo_reg_cached(op->reg))
+			continue;
+
+		/* Earlier writes may touch the cached value, flush them */
+		ret = tahvo_flush_ops(ops + start, i - start);
+		if (ret < 0)
+			return ret;
+		start = i + 1;
+
+		if (op->op == CBUS_OP_READ) {
+			op->val = tahvo_cache[op->reg];
+			continue;
+		}
+
+		op->val |= tahvo_cache[op->reg] & ~op->mask;
+		__tahvo_write_reg(op->reg, op->val);
+	}
+
+	return tahvo_flush_ops(ops + start, num - start);
+}
+
+/**
+ * tahvo_transfer - execute a batch of register operations
+ * @ops: the operations to execute, in order
+ * @num: number of operations
+ *
+ * The batch is atomic against other users of tahvo_lock.
+ * Returns zero or the first negative error.
+ */
+int tahvo_transfer(struct cbus_op *ops, unsigned num)
+{
+	unsigned long flags;
+	int ret;
+
+	spin_lock_irqsave(&tahvo_lock, flags);
+	ret = __tahvo_transfer(ops, num);
+	spin_unlock_irqrestore(&tahvo_lock, flags);
+
+	return ret;
+}
+EXPORT_SYMBOL(tahvo_transfer);
+
 /**
  * tahvo_set_clear_reg_bits - set and clear register bits atomically
  * @reg: the register to write to
@@ -106,15 +248,14 @@ EXPORT_SYMBOL(tahvo_write_reg);
  */
 void tahvo_set_clear_reg_bits(unsigned reg, u16 set, u16 clear)
 {
-	unsigned long flags;
-	u16 w;
-
-	spin_lock_irqsave(&tahvo_lock, flags);
-	w = tahvo_read_reg(reg);
-	w &= ~clear;
-	w |= set;
-	tahvo_write_reg(reg, w);
-	spin_unlock_irqrestore(&tahvo_lock, flags);
+	struct cbus_op op = {
+		.op	= CBUS_OP_MASKSET,
+		.reg	= reg,
+		.mask	= clear,
+		.val	= set,
+	};
+
+	tahvo_transfer(&op, 1);
 }
 EXPORT_SYMBOL(tahvo_set_clear_reg_bits);
 
@@ -127,9 +268,9 @@ void tahvo_disable_irq(int id)
 	u16 mask;
 
 	spin_lock_irqsave(&tahvo_lock, flags);
-	mask = tahvo_read_reg(TAHVO_REG_IMR);
+	mask = __tahvo_read_reg(TAHVO_REG_IMR);
 	mask |= 1 << id;
-	tahvo_write_reg(TAHVO_REG_IMR, mask);
+	__tahvo_write_reg(TAHVO_REG_IMR, mask);
 	spin_unlock_irqrestore(&tahvo_lock, flags);
 }
 EXPORT_SYMBOL(tahvo_disable_irq);
@@ -143,9 +284,9 @@ void tahvo_enable_irq(int id)
 	u16 mask;
 
 	spin_lock_irqsave(&tahvo_lock, flags);
-	mask = tahvo_read_reg(TAHVO_REG_IMR);
+	mask = __tahvo_read_reg(TAHVO_REG_IMR);
 	mask &= ~(1 << id);
-	tahvo_write_reg(TAHVO_REG_IMR, mask);
+	__tahvo_write_reg(TAHVO_REG_IMR, mask);
 	spin_unlock_irqrestore(&tahvo_lock, flags);
 }
 EXPORT_SYMBOL(tahvo_enable_irq);
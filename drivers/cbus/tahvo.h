@@ -25,6 +25,8 @@
 
 #include <linux/types.h>
 
+struct cbus_op;
+
 /* Registers */
 #define TAHVO_REG_ASICR		0x00	/* ASIC ID & revision */
 #define TAHVO_REG_IDR		0x01	/* Interrupt ID */
@@ -54,6 +56,7 @@ int tahvo_get_status(void);
 int tahvo_read_reg(unsigned reg);
 void tahvo_write_reg(unsigned reg, u16 val);
 void tahvo_set_clear_reg_bits(unsigned reg, u16 set, u16 clear);
+int tahvo_transfer(struct cbus_op *ops, unsigned num);
 int tahvo_request_irq(int id, void *irq_handler, unsigned long arg, char *name);
 void tahvo_free_irq(int id);
 void tahvo_enable_irq(int id);
@@ -118,6 +118,8 @@
  * requested without giving time for the entropy pool to recharge,
  * this will result in random numbers that are merely cryptographically
  * strong.  For many applications, however, this is acceptable.
+ * /dev/urandom and get_random_bytes() are served from a per-CPU
+ * generator which is periodically reseeded from the entropy pools.
  *
  * Exported interfaces ---- input
  * ==============================
@@ -138,7 +140,8 @@
  * good choice, because the periodicity of the interrupts is too
  * regular, and hence predictable to an attacker.  Disk interrupts are
  * a better measure, since the timing of the disk interrupts are more
- * unpredictable.
+ * unpredictable.  Interrupt timings are collected in a small per-CPU
+ * pool first, which is mixed into the entropy pool in batches.
  *
  * All of these routines try to estimate how many bits of randomness a
  * particular randomness source.  They do this by keeping track of the
@@ -281,6 +284,22 @@ static int trickle_thresh __read_mostly = INPUT_POOL_WORDS * 28;
 
 static DEFINE_PER_CPU(int, trickle_count);
 
+/*
+ * Interrupt timings are first gathered in a small per-CPU pool, which is
+ * mixed into the input pool every FAST_POOL_EVENTS interrupts, once
+ * FAST_POOL_MAX_CREDIT bits have been estimated or once a second.
+ */
+#define FAST_POOL_EVENTS	64
+#define FAST_POOL_MAX_CREDIT	64
+
+/*
+ * The per-CPU /dev/urandom generators are reseeded from the nonblocking
+ * pool after this long or after generating this many bytes, whichever
+ * comes first.
+ */
+#define URANDOM_RESEED_INTERVAL	(60 * HZ)
+#define URANDOM_RESEED_BYTES	(1024 * 1024)
+
 /*
  * A pool of size .poolwords is stirred with a primitive polynomial
  * of degree .poolwords over GF(2).  The taps for various sizes are
@@ -447,6 +466,10 @@ static struct entropy_store nonblocking_pool = {
 	.pool = nonblocking_pool_data
 };
 
+static __u32 const twist_table[8] = {
+	0x00000000, 0x3b6e20c8, 0x76dc4190, 0x4db26158,
+	0xedb88320, 0xd6d6a3e8, 0x9b64c2b0, 0xa00ae278 };
+
 /*
  * This function adds bytes into the entropy "pool".  It does not
  * update the entropy estimate.  The caller should call
@@ -460,9 +483,6 @@ static struct entropy_store nonblocking_pool = {
 static void mix_pool_bytes_extract(struct entropy_store *r, const void *in,
 				   int nbytes, __u8 out[64])
 {
-	static __u32 const twist_table[8] = {
-		0x00000000, 0x3b6e20c8, 0x76dc4190, 0x4db26158,
-		0xedb88320, 0xd6d6a3e8, 0x9b64c2b0, 0xa00ae278 };
 	unsigned long i, j, tap1, tap2, tap3, tap4, tap5;
 	int input_rotate;
 	int wordmask = r->poolinfo->poolwords - 1;
@@ -604,6 +624,45 @@ static void set_timer_rand_state(unsigned int irq,
 
 static struct timer_rand_state input_timer_state;
 
+/*
+ * Estimate how many bits of randomness an event at time now adds, from
+ * the first, second and third-order deltas of the event timings.
+ */
+static int timer_entropy_bits(struct timer_rand_state *state, long now)
+{
+	long delta, delta2, delta3;
+
+	if (state->dont_count_entropy)
+		return 0;
+
+	delta = now - state->last_time;
+	state->last_time = now;
+
+	delta2 = delta - state->last_delta;
+	state->last_delta = delta;
+
+	delta3 = delta2 - state->last_delta2;
+	state->last_delta2 = delta2;
+
+	if (delta < 0)
+		delta = -delta;
+	if (delta2 < 0)
+		delta2 = -delta2;
+	if (delta3 < 0)
+		delta3 = -delta3;
+	if (delta > delta2)
+		delta = delta2;
+	if (delta > delta3)
+		delta = delta3;
+
+	/*
+	 * delta is now minimum absolute delta.
+	 * Round down by 1 bit on general principles,
+	 * and limit entropy entimate to 12 bits.
+	 */
+	return min_t(int, fls(delta>>1), 11);
+}
+
 /*
  * This function adds entropy to the entropy "pool" by using timing
  * delays.  It uses the timer_rand_state structure to make an estimate
@@ -621,7 +680,6 @@ static void add_timer_randomness(struct timer_rand_state *state, unsigned num)
 		long jiffies;
 		unsigned num;
 	} sample;
-	long delta, delta2, delta3;
 
 	preempt_disable();
 	/* if over the trickle threshold, use only 1 in 4096 samples */
@@ -634,41 +692,9 @@ static void add_timer_randomness(struct timer_rand_state *state, unsigned num)
 	sample.num = num;
 	mix_pool_bytes(&input_pool, &sample, sizeof(sample));
 
-	/*
-	 * Calculate number of bits of randomness we probably added.
-	 * We take into account the first, second and third-order deltas
-	 * in order to make our estimate.
-	 */
-
-	if (!state->dont_count_entropy) {
-		delta = sample.jiffies - state->last_time;
-		state->last_time = sample.jiffies;
-
-		delta2 = delta - state->last_delta;
-		state->last_delta = delta;
-
-		delta3 = delta2 - state->last_delta2;
-		state->last_delta2 = delta2;
-
-		if (delta < 0)
-			delta = -delta;
-		if (delta2 < 0)
-			delta2 = -delta2;
-		if (delta3 < 0)
-			delta3 = -delta3;
-		if (delta > delta2)
-			delta = delta2;
-		if (delta > delta3)
-			delta = delta3;
-
-		/*
-		 * delta is now minimum absolute delta.
-		 * Round down by 1 bit on general principles,
-		 * and limit entropy entimate to 12 bits.
-		 */
-		credit_entropy_bits(&input_pool,
-				    min_t(int, fls(delta>>1), 11));
-	}
+	/* Calculate number of bits of randomness we probably added. */
+	credit_entropy_bits(&input_pool,
+			    timer_entropy_bits(state, sample.jiffies));
 out:
 	preempt_enable();
 }
@@ -689,9 +715,56 @@ void add_input_randomness(unsigned int type, unsigned int code,
 }
 EXPORT_SYMBOL_GPL(add_input_randomness);
 
+/*
+ * Interrupts can come in at a high rate on every CPU, so their timings
+ * are not mixed into the input pool (and its lock) one by one but
+ * gathered in a per-CPU fast pool first.
+ */
+struct fast_pool {
+	__u32		pool[4];
+	unsigned long	last;		/* jiffies at the last flush */
+	unsigned short	count;		/* bytes mixed in */
+	unsigned short	events;		/* interrupts since the last flush */
+	unsigned char	rotate;
+	unsigned char	credit;		/* estimated bits since the last flush */
+};
+
+static DEFINE_PER_CPU(struct fast_pool, irq_randomness);
+
+/*
+ * A cheaper version of mix_pool_bytes() for the fast pool, which has
+ * no lock and no taps.
+ */
+static void fast_mix(struct fast_pool *f, const void *in, int nbytes)
+{
+	const char *bytes = in;
+	unsigned int i = f->count;
+	unsigned int input_rotate = f->rotate;
+	__u32 w;
+
+	while (nbytes--) {
+		w = rol32(*bytes++, input_rotate & 31) ^ f->pool[i & 3] ^
+			f->pool[(i + 1) & 3];
+		f->pool[i & 3] = (w >> 3) ^ twist_table[w & 7];
+		input_rotate += (i++ & 3) ? 7 : 14;
+	}
+	f->count = i;
+	f->rotate = input_rotate;
+}
+
 void add_interrupt_randomness(int irq)
 {
 	struct timer_rand_state *state;
+	struct fast_pool *fast_pool;
+	struct {
+		cycles_t cycles;
+		long jiffies;
+		unsigned num;
+	} sample;
+	__u32 pool[4];
+	unsigned long flags;
+	bool flush;
+	int credit;
 
 	state = get_timer_rand_state(irq);
 
@@ -699,7 +772,40 @@ void add_interrupt_randomness(int irq)
 		return;
 
 	DEBUG_ENT("irq event %d\n", irq);
-	add_timer_randomness(state, 0x100 + irq);
+
+	sample.jiffies = jiffies;
+	sample.cycles = get_cycles();
+	sample.num = 0x100 + irq;
+
+	/* handlers may have enabled interrupts, and we may be nested */
+	local_irq_save(flags);
+	fast_pool = &__get_cpu_var(irq_randomness);
+	fast_mix(fast_pool, &sample, sizeof(sample));
+	credit = fast_pool->credit +
+		 timer_entropy_bits(state, sample.jiffies);
+	fast_pool->credit = min_t(int, credit, FAST_POOL_MAX_CREDIT);
+	fast_pool->events++;
+
+	flush = time_after(jiffies, fast_pool->last + HZ);
+	/* over the trickle threshold, only hand the pool over once a second */
+	if (input_pool.entropy_count <= trickle_thresh)
+		flush |= fast_pool->events >= FAST_POOL_EVENTS ||
+			 fast_pool->credit >= FAST_POOL_MAX_CREDIT;
+	if (!flush) {
+		local_irq_restore(flags);
+		return;
+	}
+
+	memcpy(pool, fast_pool->pool, sizeof(pool));
+	credit = fast_pool->credit;
+	fast_pool->credit = 0;
+	fast_pool->events = 0;
+	fast_pool->last = jiffies;
+	local_irq_restore(flags);
+
+	mix_pool_bytes(&input_pool, pool, sizeof(pool));
+	credit_entropy_bits(&input_pool, credit);
+	memset(pool, 0, sizeof(pool));
 }
 
 #ifdef CONFIG_BLOCK
@@ -918,6 +1024,141 @@ static ssize_t extract_entropy_user(struct entropy_store *r, void __user *buf,
 	return ret;
 }
 
+/*
+ * Per-CPU output generators for /dev/urandom and get_random_bytes().
+ *
+ * Instead of hashing the whole nonblocking pool under its lock for every
+ * EXTRACT_SIZE bytes, each CPU runs SHA-1 over a 512-bit block of key
+ * material with a counter in its last word.  The key is reseeded from
+ * the nonblocking pool periodically, and is replaced by output nobody
+ * sees after every request, so earlier output cannot be recovered from
+ * the current state.
+ */
+#define URANDOM_BLOCK_SIZE	20	/* one SHA-1 digest */
+#define URANDOM_CHUNK		(4 * URANDOM_BLOCK_SIZE)
+
+struct urandom_state {
+	__u32		key[16];	/* key[15] is the block counter */
+	unsigned long	reseed_time;
+	size_t		since_reseed;
+	unsigned int	generation;
+};
+
+static DEFINE_PER_CPU(struct urandom_state, urandom_state);
+
+/*
+ * Per-CPU data is not usable before the per-CPU areas are set up, at
+ * which point everything written to it would be copied to every CPU.
+ */
+static bool urandom_ready __read_mostly;
+
+/* bumped to make every CPU reseed on its next request */
+static atomic_t urandom_generation = ATOMIC_INIT(1);
+
+static void urandom_force_reseed(void)
+{
+	atomic_inc(&urandom_generation);
+}
+
+static bool urandom_need_reseed(const struct urandom_state *u)
+{
+	return u->generation != atomic_read(&urandom_generation) ||
+	       u->since_reseed >= URANDOM_RESEED_BYTES ||
+	       time_after(jiffies, u->reseed_time + URANDOM_RESEED_INTERVAL);
+}
+
+static void urandom_block(struct urandom_state *u,
+			  __u8 out[URANDOM_BLOCK_SIZE])
+{
+	__u32 hash[5], workspace[SHA_WORKSPACE_WORDS];
+
+	sha_init(hash);
+	u->key[15]++;
+	sha_transform(hash, (__u8 *)u->key, workspace);
+	memcpy(out, hash, URANDOM_BLOCK_SIZE);
+
+	memset(workspace, 0, sizeof(workspace));
+	memset(hash, 0, sizeof(hash));
+}
+
+/*
+ * Fill buf with at most URANDOM_CHUNK bytes from this CPU's generator.
+ * Interrupts are off so that get_random_bytes() can be called from
+ * interrupt context.
+ */
+static void urandom_extract(void *buf, size_t nbytes)
+{
+	struct urandom_state *u;
+	__u8 block[URANDOM_BLOCK_SIZE];
+	__u32 seed[15];
+	unsigned long flags;
+	size_t i;
+
+	local_irq_save(flags);
+	u = &__get_cpu_var(urandom_state);
+
+	if (urandom_need_reseed(u)) {
+		u->generation = atomic_read(&urandom_generation);
+		extract_entropy(&nonblocking_pool, seed, sizeof(seed), 0, 0);
+		for (i = 0; i < ARRAY_SIZE(seed); i++)
+			u->key[i] ^= seed[i];
+		memset(seed, 0, sizeof(seed));
+		u->reseed_time = jiffies;
+		u->since_reseed = 0;
+	}
+	u->since_reseed += nbytes;
+
+	while (nbytes) {
+		urandom_block(u, block);
+		i = min_t(size_t, nbytes, URANDOM_BLOCK_SIZE);
+		memcpy(buf, block, i);
+		nbytes -= i;
+		buf += i;
+	}
+
+	/* back-tracking protection: overwrite key[0..9] */
+	urandom_block(u, block);
+	memcpy(&u->key[0], block, URANDOM_BLOCK_SIZE);
+	urandom_block(u, block);
+	memcpy(&u->key[5], block, URANDOM_BLOCK_SIZE);
+
+	local_irq_restore(flags);
+	memset(block, 0, sizeof(block));
+}
+
+static ssize_t urandom_extract_user(void __user *buf, size_t nbytes)
+{
+	ssize_t ret = 0, i;
+	__u8 tmp[URANDOM_CHUNK];
+
+	while (nbytes) {
+		if (need_resched()) {
+			if (signal_pending(current)) {
+				if (ret == 0)
+					ret = -ERESTARTSYS;
+				break;
+			}
+			schedule();
+		}
+
+		i = min_t(size_t, nbytes, sizeof(tmp));
+		urandom_extract(tmp, i);
+		if (copy_to_user(buf, tmp, i)) {
+			ret = -EFAULT;
+			break;
+		}
+
+		nbytes -= i;
+		buf += i;
+		ret += i;
+	}
+
+	/* Wipe data just returned from memory */
+	memset(tmp, 0, sizeof(tmp));
+
+	return ret;
+}
+
 /*
  * This function is the exported kernel interface.  It returns some
  * number of good random numbers, suitable for seeding TCP sequence
@@ -925,7 +1166,20 @@ static ssize_t extract_entropy_user(struct entropy_store *r, void __user *buf,
  */
 void get_random_bytes(void *buf, int nbytes)
 {
-	extract_entropy(&nonblocking_pool, buf, nbytes, 0, 0);
+	int i;
+
+	/* the FIPS continuous test is done on the pool output */
+	if (fips_enabled || !urandom_ready) {
+		extract_entropy(&nonblocking_pool, buf, nbytes, 0, 0);
+		return;
+	}
+
+	while (nbytes > 0) {
+		i = min_t(int, nbytes, URANDOM_CHUNK);
+		urandom_extract(buf, i);
+		nbytes -= i;
+		buf += i;
+	}
 }
 EXPORT_SYMBOL(get_random_bytes);
 
@@ -957,6 +1211,8 @@ static int rand_initialize(void)
 	init_std_data(&input_pool);
 	init_std_data(&blocking_pool);
 	init_std_data(&nonblocking_pool);
+	urandom_force_reseed();
+	urandom_ready = true;
 	return 0;
 }
 module_init(rand_initialize);
@@ -1053,7 +1309,9 @@ random_read(struct file *file, char __user *buf, size_t nbytes, loff_t *ppos)
 static ssize_t
 urandom_read(struct file *file, char __user *buf, size_t nbytes, loff_t *ppos)
 {
-	return extract_entropy_user(&nonblocking_pool, buf, nbytes);
+	if (fips_enabled)
+		return extract_entropy_user(&nonblocking_pool, buf, nbytes);
+	return urandom_extract_user(buf, nbytes);
 }
 
 static unsigned int
@@ -1105,6 +1363,9 @@ static ssize_t random_write(struct file *file, const char __user *buffer,
 	if (ret)
 		return ret;
 
+	/* let a restored seed reach the per-CPU generators right away */
+	urandom_force_reseed();
+
 	return (ssize_t)count;
 }
 
@@ -1141,6 +1402,7 @@ static long random_ioctl(struct file *f, unsigned int cmd, unsigned long arg)
 		if (retval < 0)
 			return retval;
 		credit_entropy_bits(&input_pool, ent_count);
+		urandom_force_reseed();
 		return 0;
 	case RNDZAPENTCNT:
 	case RNDCLEARPOOL:
@@ -14,6 +14,7 @@
 #define EVDEV_MINORS		32
 #define EVDEV_MIN_BUFFER_SIZE	64U
 #define EVDEV_BUF_PACKETS	8
+#define EVDEV_READ_BATCH	16
 
 #include <linux/poll.h>
 #include <linux/sched.h>
@@ -41,6 +42,7 @@ struct evdev {
 struct evdev_client {
 	int head;
 	int tail;
+	int packet_head; /* end of the last complete packet */
 	spinlock_t buffer_lock; /* protects access to buffer, head and tail */
 	struct fasync_struct *fasync;
 	struct evdev *evdev;
@@ -55,20 +57,27 @@ static DEFINE_MUTEX(evdev_table_mutex);
 static void evdev_pass_event(struct evdev_client *client,
 			     struct input_event *event)
 {
-	/*
-	 * Interrupts are disabled, just acquire the lock.
-	 * Make sure we don't leave with the client buffer
-	 * "empty" by having client->head == client->tail.
-	 */
+	/* Interrupts are disabled, just acquire the lock. */
 	spin_lock(&client->buffer_lock);
-	do {
-		client->buffer[client->head++] = *event;
-		client->head &= client->bufsize - 1;
-	} while (client->head == client->tail);
-	spin_unlock(&client->buffer_lock);
 
-	if (event->type == EV_SYN)
+	client->buffer[client->head++] = *event;
+	client->head &= client->bufsize - 1;
+
+	if (unlikely(client->head == client->tail)) {
+		/*
+		 * Don't leave the buffer "empty" by having head == tail:
+		 * drop all unconsumed events but the newest one.
+		 */
+		client->tail = (client->head - 1) & (client->bufsize - 1);
+		client->packet_head = client->tail;
+	}
+
+	if (event->type == EV_SYN && event->code == SYN_REPORT) {
+		client->packet_head = client->head;
 		kill_fasync(&client->fasync, SIGIO, POLL_IN);
+	}
+
+	spin_unlock(&client->buffer_lock);
 }
 
 /*
@@ -101,7 +110,9 @@ static void evdev_event(struct input_handle *handle,
 
 	rcu_read_unlock();
 
-	wake_up_interruptible(&evdev->wait);
+	/* Readers only get to see complete packets, wake them up per packet */
+	if (type == EV_SYN && code == SYN_REPORT)
+		wake_up_interruptible(&evdev->wait);
 }
 
 static int evdev_fasync(int fd, struct file *file, int on)
@@ -351,22 +362,42 @@ static ssize_t evdev_write(struct file *file, const char __user *buffer,
 	return retval;
 }
 
-static int evdev_fetch_next_event(struct evdev_client *client,
-				  struct input_event *event)
+/*
+ * Fetch up to @max events of complete packets from the client buffer,
+ * taking the buffer lock only once.
+ */
+static int evdev_fetch_events(struct evdev_client *client,
+			      struct input_event *events, int max)
 {
-	int have_event;
+	int n = 0;
 
 	spin_lock_irq(&client->buffer_lock);
 
-	have_event = client->head != client->tail;
-	if (have_event) {
-		*event = client->buffer[client->tail++];
+	while (n < max && client->tail != client->packet_head) {
+		events[n++] = client->buffer[client->tail++];
 		client->tail &= client->bufsize - 1;
 	}
 
 	spin_unlock_irq(&client->buffer_lock);
 
-	return have_event;
+	return n;
+}
+
+static int evdev_events_to_user(char __user *buffer,
+				const struct input_event *events, int n)
+{
+	int i;
+
+	if (input_event_size() == sizeof(struct input_event))
+		return copy_to_user(buffer, events, n * sizeof(*events)) ?
+			-EFAULT : 0;
+
+	for (i = 0; i < n; i++)
+		if (input_event_to_user(buffer + i * input_event_size(),
+					&events[i]))
+			return -EFAULT;
+
+	return 0;
 }
 
 static ssize_t evdev_read(struct file *file, char __user *buffer,
@@ -374,31 +405,35 @@ static ssize_t evdev_read(struct file *file, char __user *buffer,
 {
 	struct evdev_client *client = file->private_data;
 	struct evdev *evdev = client->evdev;
-	struct input_event event;
-	int retval;
+	struct input_event events[EVDEV_READ_BATCH];
+	int retval, n;
 
 	if (count < input_event_size())
 		return -EINVAL;
 
-	if (client->head == client->tail && evdev->exist &&
+	if (client->packet_head == client->tail && evdev->exist &&
 	    (file->f_flags & O_NONBLOCK))
 		return -EAGAIN;
 
 	retval = wait_event_interruptible(evdev->wait,
-		client->head != client->tail || !evdev->exist);
+		client->packet_head != client->tail || !evdev->exist);
 	if (retval)
 		return retval;
 
 	if (!evdev->exist)
 		return -ENODEV;
 
-	while (retval + input_event_size() <= count &&
-	       evdev_fetch_next_event(client, &event)) {
+	while (retval + input_event_size() <= count) {
+		n = min_t(size_t, (count - retval) / input_event_size(),
+			  EVDEV_READ_BATCH);
+		n = evdev_fetch_events(client, events, n);
+		if (!n)
+			break;
 
-		if (input_event_to_user(buffer + retval, &event))
+		if (evdev_events_to_user(buffer + retval, events, n))
 			return -EFAULT;
 
-		retval += input_event_size();
+		retval += n * input_event_size();
 	}
 
 	return retval;
@@ -414,7 +449,7 @@ static unsigned int evdev_poll(struct file *file, poll_table *wait)
 	poll_wait(file, &evdev->wait, wait);
 
 	mask = evdev->exist ? POLLOUT | POLLWRNORM : POLLHUP | POLLERR;
-	if (client->head != client->tail)
+	if (client->packet_head != client->tail)
 		mask |= POLLIN | POLLRDNORM;
 
 	return mask;
@@ -263,6 +263,7 @@ static void process_keys(struct lm8323_chip *lm)
 	int old_keys_down = lm->keys_down;
 	int ret;
 	int i = 0;
+	int reported = 0;
 
 	/*
 	 * Read all key events from the FIFO at once. Next READ_FIFO clears the
@@ -287,7 +288,7 @@ static void process_keys(struct lm8323_chip *lm)
 		if (lm->kp_enabled) {
 			input_event(lm->idev, EV_MSC, MSC_SCAN, key);
 			input_report_key(lm->idev, keycode, isdown);
-			input_sync(lm->idev);
+			reported = 1;
 		}
 
 		if (isdown)
@@ -296,6 +297,10 @@ static void process_keys(struct lm8323_chip *lm)
 			lm->keys_down--;
 	}
 
+	/* One sync for everything drained from the FIFO */
+	if (reported)
+		input_sync(lm->idev);
+
 	/*
 	 * Errata: We need to ensure that the chip never enters halt mode
 	 * during a keypress, so set active time to 0.  When it's released,
@@ -361,13 +366,23 @@ static int lm8323_configure(struct lm8323_chip *lm)
 	return 0;
 }
 
+static void lm8323_pwm_work(struct work_struct *work);
+
+/*
+ * Called from the interrupt work, so the next script for the engine can
+ * be written right away instead of bouncing through the workqueue.
+ */
 static void pwm_done(struct lm8323_pwm *pwm)
 {
+	bool pending;
+
 	mutex_lock(&pwm->lock);
 	pwm->running = false;
-	if (pwm->desired_brightness != pwm->brightness)
-		schedule_work(&pwm->work);
+	pending = pwm->desired_brightness != pwm->brightness;
 	mutex_unlock(&pwm->lock);
+
+	if (pending)
+		lm8323_pwm_work(&pwm->work);
 }
 
 /*
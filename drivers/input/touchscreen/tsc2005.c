@@ -175,9 +175,17 @@
 				 TSC2005_CFR2_AVG_7)
 
 #define MAX_12BIT					((1 << 12) - 1)
-#define TS_SAMPLES					4
 #define TSC2005_TS_PENUP_TIME				40
 
+/* Weight of a new sample in the position IIR filter, as a shift:
+ * out += (in - out) >> TSC2005_TS_IIR_SHIFT */
+#define TSC2005_TS_IIR_SHIFT				1
+/* Fixed point fraction bits of the IIR filter state */
+#define TSC2005_TS_IIR_FRAC				4
+
+/* Conversion batch delays selectable in CFR1, in ms */
+static const u8 tsc2005_batch_delay_ms[] = { 0, 1, 2, 4, 10, 20, 40, 100 };
+
 static const u32 tsc2005_read_reg[] = {
 	(TSC2005_REG | TSC2005_REG_X | TSC2005_REG_READ) << 16,
 	(TSC2005_REG | TSC2005_REG_Y | TSC2005_REG_READ) << 16,
@@ -222,12 +230,17 @@ struct tsc2005 {
 	int			in_y;
 	int			in_z1;
 	int			in_z2;
-	/* average accumulators for each component */
-	int			sample_cnt;
-	int			avg_x;
-	int			avg_y;
-	int			avg_z1;
-	int			avg_z2;
+	/* position filter: median of the last three raw samples,
+	 * smoothed by a first order IIR filter in fixed point */
+	int			hist_cnt;
+	int			hist_x[3];
+	int			hist_y[3];
+	int			iir_x;
+	int			iir_y;
+	/* report rate control, via the hardware conversion batch delay */
+	unsigned int		report_rate;	/* Hz, 0 for the default */
+	u16			cfr1;
+	unsigned int		penup_time;	/* ms */
 	/* configuration */
 	int			x_plate_ohm;
 	int			hw_avg_max;
@@ -322,6 +335,63 @@ static void tsc2005_ts_update_pen_state(struct tsc2005 *ts,
 	input_sync(ts->idev);
 }
 
+static int tsc2005_median3(const int *v)
+{
+	int a = v[0], b = v[1], c = v[2];
+
+	if (a > b)
+		swap(a, b);
+	if (b > c)
+		swap(b, c);
+	if (a > b)
+		swap(a, b);
+
+	return b;
+}
+
+/*
+ * Run a new raw position through the median and IIR filters. The
+ * median rejects single sample spikes, the IIR filter smoothes the
+ * remaining jitter without holding back samples like a block average
+ * would. On pen down the filter state is reset, so the first event
+ * goes out without any delay.
+ */
+static void tsc2005_ts_filter(struct tsc2005 *ts, int *x, int *y)
+{
+	int i = ts->hist_cnt % 3;
+	int mx, my;
+
+	if (!ts->sample_sent) {
+		ts->hist_cnt = 0;
+		i = 0;
+	}
+
+	ts->hist_x[i] = *x;
+	ts->hist_y[i] = *y;
+	if (++ts->hist_cnt >= 3) {
+		mx = tsc2005_median3(ts->hist_x);
+		my = tsc2005_median3(ts->hist_y);
+	} else {
+		mx = *x;
+		my = *y;
+	}
+
+	if (!ts->sample_sent) {
+		ts->iir_x = mx << TSC2005_TS_IIR_FRAC;
+		ts->iir_y = my << TSC2005_TS_IIR_FRAC;
+	} else {
+		ts->iir_x += ((mx << TSC2005_TS_IIR_FRAC) - ts->iir_x) >>
+			     TSC2005_TS_IIR_SHIFT;
+		ts->iir_y += ((my << TSC2005_TS_IIR_FRAC) - ts->iir_y) >>
+			     TSC2005_TS_IIR_SHIFT;
+	}
+
+	*x = (ts->iir_x + (1 << (TSC2005_TS_IIR_FRAC - 1))) >>
+	     TSC2005_TS_IIR_FRAC;
+	*y = (ts->iir_y + (1 << (TSC2005_TS_IIR_FRAC - 1))) >>
+	     TSC2005_TS_IIR_FRAC;
+}
+
 /*
  * This function is called by the SPI framework after the coordinates
  * have been read from TSC2005
@@ -364,35 +434,15 @@ static void tsc2005_ts_rx(void *arg)
 		goto out;
 
 	/* At this point we are happy we have a valid and useful reading.
-	 * Remember it for later comparisons. We may now begin downsampling
+	 * Remember it for later comparisons.
 	 */
 	ts->in_x = x;
 	ts->in_y = y;
 	ts->in_z1 = z1;
 	ts->in_z2 = z2;
 
-	/* don't run average on the "pen down" event */
-	if (ts->sample_sent) {
-		ts->avg_x += x;
-		ts->avg_y += y;
-		ts->avg_z1 += z1;
-		ts->avg_z2 += z2;
-
-		if (++ts->sample_cnt < TS_SAMPLES)
-			goto out;
-
-		x = ts->avg_x / TS_SAMPLES;
-		y = ts->avg_y / TS_SAMPLES;
-		z1 = ts->avg_z1 / TS_SAMPLES;
-		z2 = ts->avg_z2 / TS_SAMPLES;
-	}
-
-	ts->sample_cnt = 0;
-	ts->avg_x = 0;
-	ts->avg_y = 0;
-	ts->avg_z1 = 0;
-	ts->avg_z2 = 0;
-
+	/* The pressure is computed from the raw sample, the filtered
+	 * position is what gets reported */
 	pressure = x * (z2 - z1) / z1;
 	pressure = pressure * ts->x_plate_ohm / 4096;
 
@@ -400,6 +450,8 @@ static void tsc2005_ts_rx(void *arg)
 	if (pressure > pressure_limit)
 		goto out;
 
+	tsc2005_ts_filter(ts, &x, &y);
+
 	/* Discard the event if it still is within the previous rect -
 	 * unless the pressure is clearly harder, but then use previous
 	 * x,y position. If any coordinate deviates enough, fudging
@@ -437,7 +489,7 @@ out:
 	/* kick pen up timer - to make sure it expires again(!) */
 	if (ts->sample_sent) {
 		mod_timer(&ts->penup_timer,
-			  jiffies + msecs_to_jiffies(TSC2005_TS_PENUP_TIME));
+			  jiffies + msecs_to_jiffies(ts->penup_time));
 		/* Also kick the watchdog, as we still think we're alive */
 		if (ts->esd_timeout && ts->disable_depth == 0) {
 			unsigned long wdj = msecs_to_jiffies(ts->esd_timeout);
@@ -491,7 +543,7 @@ static irqreturn_t tsc2005_ts_irq_handler(int irq, void *dev_id)
 	 * If it times out with an SPI pending, it's ignored anyway.
 	 */
 	if (!timer_pending(&ts->penup_timer)) {
-		unsigned long pu = msecs_to_jiffies(TSC2005_TS_PENUP_TIME);
+		unsigned long pu = msecs_to_jiffies(ts->penup_time);
 		ts->penup_timer.expires = jiffies + pu;
 		add_timer(&ts->penup_timer);
 	}
@@ -531,10 +583,36 @@ static ssize_t tsc2005_ts_pen_down_show(struct device *dev,
 
 static DEVICE_ATTR(pen_down, S_IRUGO, tsc2005_ts_pen_down_show, NULL);
 
+/*
+ * Limit the report rate by letting the controller wait between
+ * conversion batches: every DAV interrupt and SPI read we don't get
+ * is one we don't have to handle. The pen up timeout has to cover
+ * the batch delay.
+ */
+static void tsc2005_set_report_rate(struct tsc2005 *ts, unsigned int rate)
+{
+	unsigned int delay, i;
+
+	ts->report_rate = rate;
+	if (!rate) {
+		ts->cfr1 = TSC2005_CFR1_INITVALUE;
+		ts->penup_time = TSC2005_TS_PENUP_TIME;
+		return;
+	}
+
+	delay = 1000 / rate;
+	for (i = ARRAY_SIZE(tsc2005_batch_delay_ms) - 1; i > 0; i--)
+		if (tsc2005_batch_delay_ms[i] <= delay)
+			break;
+	ts->cfr1 = i;
+	ts->penup_time = TSC2005_TS_PENUP_TIME +
+			 2 * tsc2005_batch_delay_ms[i];
+}
+
 static int tsc2005_configure(struct tsc2005 *ts, int flags)
 {
 	tsc2005_write(ts, TSC2005_REG_CFR0, TSC2005_CFR0_INITVALUE);
-	tsc2005_write(ts, TSC2005_REG_CFR1, TSC2005_CFR1_INITVALUE);
+	tsc2005_write(ts, TSC2005_REG_CFR1, ts->cfr1);
 	tsc2005_write(ts, TSC2005_REG_CFR2, TSC2005_CFR2_INITVALUE);
 	tsc2005_cmd(ts, flags);
 
@@ -622,6 +700,38 @@ out:
 static DEVICE_ATTR(disable_ts, 0664, tsc2005_disable_show,
 		   tsc2005_disable_store);
 
+static ssize_t tsc2005_report_rate_show(struct device *dev,
+					struct device_attribute *attr,
+					char *buf)
+{
+	struct tsc2005 *ts = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%u\n", ts->report_rate);
+}
+
+static ssize_t tsc2005_report_rate_store(struct device *dev,
+					 struct device_attribute *attr,
+					 const char *buf, size_t count)
+{
+	struct tsc2005 *ts = dev_get_drvdata(dev);
+	unsigned long res;
+
+	if (strict_strtoul(buf, 10, &res) < 0 || res > 1000)
+		return -EINVAL;
+
+	mutex_lock(&ts->mutex);
+	/* Restart scanning so the new batch delay takes effect */
+	tsc2005_disable(ts);
+	tsc2005_set_report_rate(ts, res);
+	tsc2005_enable(ts);
+	mutex_unlock(&ts->mutex);
+
+	return count;
+}
+
+static DEVICE_ATTR(report_rate, 0664, tsc2005_report_rate_show,
+		   tsc2005_report_rate_store);
+
 static ssize_t tsc2005_ctrl_selftest_show(struct device *dev,
 					  struct device_attribute *attr,
 					  char *buf)
@@ -756,6 +866,8 @@ static int __devinit tsc2005_ts_init(struct tsc2005 *ts,
 
 	ts->set_reset		= pdata->set_reset;
 
+	tsc2005_set_report_rate(ts, pdata->ts_report_rate);
+
 	idev = input_allocate_device();
 	if (idev == NULL) {
 		r = -ENOMEM;
@@ -815,6 +927,11 @@ static int __devinit tsc2005_ts_init(struct tsc2005 *ts,
 		dev_warn(&ts->spi->dev, "can't create sysfs file for %s: %d\n",
 			 dev_attr_disable_ts.attr.name, r);
 
+	r = device_create_file(&ts->spi->dev, &dev_attr_report_rate);
+	if (r < 0)
+		dev_warn(&ts->spi->dev, "can't create sysfs file for %s: %d\n",
+			 dev_attr_report_rate.attr.name, r);
+
 	/* Finally, configure and start the optional EDD watchdog. */
 	ts->esd_timeout = pdata->esd_timeout;
 	if (ts->esd_timeout && ts->set_reset) {
@@ -888,6 +1005,7 @@ static int __devexit tsc2005_remove(struct spi_device *spi)
 	tsc2005_disable(ts);
 	mutex_unlock(&ts->mutex);
 
+	device_remove_file(&ts->spi->dev, &dev_attr_report_rate);
 	device_remove_file(&ts->spi->dev, &dev_attr_disable_ts);
 	device_remove_file(&ts->spi->dev, &dev_attr_pen_down);
 	device_remove_file(&ts->spi->dev, &dev_attr_ts_ctrl_selftest);
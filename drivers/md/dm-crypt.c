@@ -19,6 +19,7 @@
 #include <linux/workqueue.h>
 #include <linux/backing-dev.h>
 #include <linux/percpu.h>
+#include <linux/kthread.h>
 #include <asm/atomic.h>
 #include <linux/scatterlist.h>
 #include <asm/page.h>
@@ -45,6 +46,7 @@ struct convert_context {
 	unsigned int idx_out;
 	sector_t sector;
 	atomic_t pending;
+	struct ablkcipher_request *req;
 };
 
 /*
@@ -103,13 +105,14 @@ struct iv_lmk_private {
  * Crypt: maps a linear range of a block device
  * and encrypts / decrypts at the same time.
  */
-enum flags { DM_CRYPT_SUSPENDED, DM_CRYPT_KEY_VALID };
+enum flags { DM_CRYPT_SUSPENDED, DM_CRYPT_KEY_VALID,
+	     DM_CRYPT_SAME_CPU, DM_CRYPT_NO_OFFLOAD,
+	     DM_CRYPT_NO_READ_WORKQUEUE };
 
 /*
  * Duplicated per-CPU state for cipher.
  */
 struct crypt_cpu {
-	struct ablkcipher_request *req;
 	/* ESSIV: struct crypto_cipher *essiv_tfm */
 	void *iv_private;
 	struct crypto_ablkcipher *tfms[0];
@@ -134,6 +137,12 @@ struct crypt_config {
 
 	struct workqueue_struct *io_queue;
 	struct workqueue_struct *crypt_queue;
+	int last_cpu;
+
+	/* sorted submission of encrypted writes, see dmcrypt_write() */
+	struct task_struct *write_thread;
+	wait_queue_head_t write_thread_wait;
+	struct bio_list write_bios;
 
 	char *cipher;
 	char *cipher_string;
@@ -183,11 +192,17 @@ static struct kmem_cache *_crypt_io_pool;
 
 static void clone_init(struct dm_crypt_io *, struct bio *);
 static void kcryptd_queue_crypt(struct dm_crypt_io *io);
+static void kcryptd_crypt_read_convert(struct dm_crypt_io *io);
 static u8 *iv_of_dmreq(struct crypt_config *cc, struct dm_crypt_request *dmreq);
 
+/*
+ * The crypto requests are private to each conversion context and the
+ * transforms are reentrant, so it is fine to migrate to another CPU
+ * while still using the state found here.
+ */
 static struct crypt_cpu *this_crypt_config(struct crypt_config *cc)
 {
-	return this_cpu_ptr(cc->cpu);
+	return __this_cpu_ptr(cc->cpu);
 }
 
 /*
@@ -667,6 +682,7 @@ static void crypt_convert_init(struct crypt_config *cc,
 	ctx->idx_in = bio_in ? bio_in->bi_idx : 0;
 	ctx->idx_out = bio_out ? bio_out->bi_idx : 0;
 	ctx->sector = sector + cc->iv_offset;
+	ctx->req = NULL;
 	init_completion(&ctx->restart);
 }
 
@@ -753,13 +769,22 @@ static void crypt_alloc_req(struct crypt_config *cc,
 	struct crypt_cpu *this_cc = this_crypt_config(cc);
 	unsigned key_index = ctx->sector & (cc->tfms_count - 1);
 
-	if (!this_cc->req)
-		this_cc->req = mempool_alloc(cc->req_pool, GFP_NOIO);
+	if (!ctx->req)
+		ctx->req = mempool_alloc(cc->req_pool, GFP_NOIO);
 
-	ablkcipher_request_set_tfm(this_cc->req, this_cc->tfms[key_index]);
-	ablkcipher_request_set_callback(this_cc->req,
+	ablkcipher_request_set_tfm(ctx->req, this_cc->tfms[key_index]);
+	ablkcipher_request_set_callback(ctx->req,
 	    CRYPTO_TFM_REQ_MAY_BACKLOG | CRYPTO_TFM_REQ_MAY_SLEEP,
-	    kcryptd_async_done, dmreq_of_req(cc, this_cc->req));
+	    kcryptd_async_done, dmreq_of_req(cc, ctx->req));
+}
+
+static void crypt_free_req(struct crypt_config *cc,
+			   struct convert_context *ctx)
+{
+	if (ctx->req) {
+		mempool_free(ctx->req, cc->req_pool);
+		ctx->req = NULL;
+	}
 }
 
 /*
@@ -768,7 +793,6 @@ static void crypt_alloc_req(struct crypt_config *cc,
 static int crypt_convert(struct crypt_config *cc,
 			 struct convert_context *ctx)
 {
-	struct crypt_cpu *this_cc = this_crypt_config(cc);
 	int r;
 
 	atomic_set(&ctx->pending, 1);
@@ -780,7 +804,7 @@ static int crypt_convert(struct crypt_config *cc,
 
 		atomic_inc(&ctx->pending);
 
-		r = crypt_convert_block(cc, ctx, this_cc->req);
+		r = crypt_convert_block(cc, ctx, ctx->req);
 
 		switch (r) {
 		/* async */
@@ -789,7 +813,7 @@ static int crypt_convert(struct crypt_config *cc,
 			INIT_COMPLETION(ctx->restart);
 			/* fall through*/
 		case -EINPROGRESS:
-			this_cc->req = NULL;
+			ctx->req = NULL;
 			ctx->sector++;
 			continue;
 
@@ -803,10 +827,12 @@ static int crypt_convert(struct crypt_config *cc,
 		/* error */
 		default:
 			atomic_dec(&ctx->pending);
+			crypt_free_req(cc, ctx);
 			return r;
 		}
 	}
 
+	crypt_free_req(cc, ctx);
 	return 0;
 }
 
@@ -970,7 +996,15 @@ static void crypt_endio(struct bio *clone, int error)
 	bio_put(clone);
 
 	if (rw == READ && !error) {
-		kcryptd_queue_crypt(io);
+		/*
+		 * Completions that already run in process context can
+		 * decrypt right away instead of bouncing through kcryptd.
+		 */
+		if (test_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags) &&
+		    !in_interrupt() && !irqs_disabled())
+			kcryptd_crypt_read_convert(io);
+		else
+			kcryptd_queue_crypt(io);
 		return;
 	}
 
@@ -1054,11 +1088,109 @@ static void kcryptd_queue_io(struct dm_crypt_io *io)
 	queue_work(cc->io_queue, &io->work);
 }
 
+/*
+ * Merge sort a bi_next chain of bios by starting sector.
+ */
+static struct bio *crypt_sort_bios(struct bio *head)
+{
+	struct bio *slow, *fast, *a, *b;
+	struct bio **tail;
+
+	if (!head || !head->bi_next)
+		return head;
+
+	slow = head;
+	fast = head->bi_next;
+	while (fast && fast->bi_next) {
+		slow = slow->bi_next;
+		fast = fast->bi_next->bi_next;
+	}
+
+	b = slow->bi_next;
+	slow->bi_next = NULL;
+	a = crypt_sort_bios(head);
+	b = crypt_sort_bios(b);
+
+	tail = &head;
+	while (a && b) {
+		if (b->bi_sector < a->bi_sector) {
+			*tail = b;
+			b = b->bi_next;
+		} else {
+			*tail = a;
+			a = a->bi_next;
+		}
+		tail = &(*tail)->bi_next;
+	}
+	*tail = a ? a : b;
+
+	return head;
+}
+
+/*
+ * dmcrypt_write:
+ *
+ * Encryption runs on all CPUs, so the encrypted writes finish in no
+ * particular order. Collect them here and submit each batch sorted by
+ * sector under one plug, so the device still sees sequential streams.
+ */
+static int dmcrypt_write(void *data)
+{
+	struct crypt_config *cc = data;
+	struct blk_plug plug;
+	struct bio *bio, *next;
+
+	while (1) {
+		DECLARE_WAITQUEUE(wait, current);
+
+		spin_lock_irq(&cc->write_thread_wait.lock);
+continue_locked:
+		if (!bio_list_empty(&cc->write_bios))
+			goto pop_bios;
+
+		__set_current_state(TASK_INTERRUPTIBLE);
+		__add_wait_queue(&cc->write_thread_wait, &wait);
+
+		spin_unlock_irq(&cc->write_thread_wait.lock);
+
+		if (unlikely(kthread_should_stop())) {
+			set_task_state(current, TASK_RUNNING);
+			remove_wait_queue(&cc->write_thread_wait, &wait);
+			break;
+		}
+
+		schedule();
+
+		set_task_state(current, TASK_RUNNING);
+		spin_lock_irq(&cc->write_thread_wait.lock);
+		__remove_wait_queue(&cc->write_thread_wait, &wait);
+		goto continue_locked;
+
+pop_bios:
+		bio = bio_list_get(&cc->write_bios);
+		spin_unlock_irq(&cc->write_thread_wait.lock);
+
+		bio = crypt_sort_bios(bio);
+
+		blk_start_plug(&plug);
+		while (bio) {
+			next = bio->bi_next;
+			bio->bi_next = NULL;
+			generic_make_request(bio);
+			bio = next;
+		}
+		blk_finish_plug(&plug);
+	}
+
+	return 0;
+}
+
 static void kcryptd_crypt_write_io_submit(struct dm_crypt_io *io,
 					  int error, int async)
 {
 	struct bio *clone = io->ctx.bio_out;
 	struct crypt_config *cc = io->target->private;
+	unsigned long flags;
 
 	if (unlikely(error < 0)) {
 		crypt_free_buffer_pages(cc, clone);
@@ -1073,10 +1205,18 @@ static void kcryptd_crypt_write_io_submit(struct dm_crypt_io *io,
 
 	clone->bi_sector = cc->start + io->sector;
 
-	if (async)
-		kcryptd_queue_io(io);
-	else
-		generic_make_request(clone);
+	if (test_bit(DM_CRYPT_NO_OFFLOAD, &cc->flags)) {
+		if (async)
+			kcryptd_queue_io(io);
+		else
+			generic_make_request(clone);
+		return;
+	}
+
+	spin_lock_irqsave(&cc->write_thread_wait.lock, flags);
+	bio_list_add(&cc->write_bios, clone);
+	wake_up_locked(&cc->write_thread_wait);
+	spin_unlock_irqrestore(&cc->write_thread_wait.lock, flags);
 }
 
 static void kcryptd_crypt_write_convert(struct dm_crypt_io *io)
@@ -1236,9 +1376,25 @@ static void kcryptd_crypt(struct work_struct *work)
 static void kcryptd_queue_crypt(struct dm_crypt_io *io)
 {
 	struct crypt_config *cc = io->target->private;
+	int cpu;
 
 	INIT_WORK(&io->work, kcryptd_crypt);
-	queue_work(cc->crypt_queue, &io->work);
+
+	if (test_bit(DM_CRYPT_SAME_CPU, &cc->flags)) {
+		queue_work(cc->crypt_queue, &io->work);
+		return;
+	}
+
+	/*
+	 * Spread the bios over the online CPUs; the racy update of
+	 * last_cpu only affects how evenly they are spread.
+	 */
+	cpu = cpumask_next(ACCESS_ONCE(cc->last_cpu), cpu_online_mask);
+	if (cpu >= nr_cpu_ids)
+		cpu = cpumask_first(cpu_online_mask);
+	cc->last_cpu = cpu;
+
+	queue_work_on(cpu, cc->crypt_queue, &io->work);
 }
 
 /*
@@ -1358,7 +1514,6 @@ static int crypt_wipe_key(struct crypt_config *cc)
 static void crypt_dtr(struct dm_target *ti)
 {
 	struct crypt_config *cc = ti->private;
-	struct crypt_cpu *cpu_cc;
 	int cpu;
 
 	ti->private = NULL;
@@ -1366,6 +1521,9 @@ static void crypt_dtr(struct dm_target *ti)
 	if (!cc)
 		return;
 
+	if (cc->write_thread)
+		kthread_stop(cc->write_thread);
+
 	if (cc->io_queue)
 		destroy_workqueue(cc->io_queue);
 	if (cc->crypt_queue)
@@ -1373,9 +1531,6 @@ static void crypt_dtr(struct dm_target *ti)
 
 	if (cc->cpu)
 		for_each_possible_cpu(cpu) {
-			cpu_cc = per_cpu_ptr(cc->cpu, cpu);
-			if (cpu_cc->req)
-				mempool_free(cpu_cc->req, cc->req_pool);
 			crypt_free_tfms(cc, cpu);
 		}
 
@@ -1575,9 +1730,10 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 	struct crypt_config *cc;
 	unsigned int key_size;
 	unsigned long long tmpll;
+	unsigned int opt_params, i;
 	int ret;
 
-	if (argc != 5) {
+	if (argc < 5) {
 		ti->error = "Not enough arguments";
 		return -EINVAL;
 	}
@@ -1646,6 +1802,28 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 	}
 	cc->start = tmpll;
 
+	/* Optional parameters */
+	if (argc > 5) {
+		if (sscanf(argv[5], "%u", &opt_params) != 1 ||
+		    opt_params != argc - 6) {
+			ti->error = "Invalid number of feature args";
+			goto bad;
+		}
+
+		for (i = 6; i < argc; i++) {
+			if (!strcasecmp(argv[i], "same_cpu_crypt"))
+				set_bit(DM_CRYPT_SAME_CPU, &cc->flags);
+			else if (!strcasecmp(argv[i], "submit_from_crypt_cpus"))
+				set_bit(DM_CRYPT_NO_OFFLOAD, &cc->flags);
+			else if (!strcasecmp(argv[i], "no_read_workqueue"))
+				set_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags);
+			else {
+				ti->error = "Invalid feature arguments";
+				goto bad;
+			}
+		}
+	}
+
 	ret = -ENOMEM;
 	cc->io_queue = alloc_workqueue("kcryptd_io",
 				       WQ_NON_REENTRANT|
@@ -1666,6 +1844,20 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 		goto bad;
 	}
 
+	init_waitqueue_head(&cc->write_thread_wait);
+	bio_list_init(&cc->write_bios);
+
+	if (!test_bit(DM_CRYPT_NO_OFFLOAD, &cc->flags)) {
+		cc->write_thread = kthread_run(dmcrypt_write, cc,
+					       "dmcrypt_write");
+		if (IS_ERR(cc->write_thread)) {
+			ret = PTR_ERR(cc->write_thread);
+			cc->write_thread = NULL;
+			ti->error = "Couldn't spawn write thread";
+			goto bad;
+		}
+	}
+
 	ti->num_flush_requests = 1;
 	return 0;
 
@@ -1702,6 +1894,7 @@ static int crypt_status(struct dm_target *ti, status_type_t type,
 {
 	struct crypt_config *cc = ti->private;
 	unsigned int sz = 0;
+	int num_feature_args;
 
 	switch (type) {
 	case STATUSTYPE_INFO:
@@ -1725,6 +1918,19 @@ static int crypt_status(struct dm_target *ti, status_type_t type,
 
 		DMEMIT(" %llu %s %llu", (unsigned long long)cc->iv_offset,
 				cc->dev->name, (unsigned long long)cc->start);
+
+		num_feature_args = test_bit(DM_CRYPT_SAME_CPU, &cc->flags) +
+			test_bit(DM_CRYPT_NO_OFFLOAD, &cc->flags) +
+			test_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags);
+		if (num_feature_args) {
+			DMEMIT(" %d", num_feature_args);
+			if (test_bit(DM_CRYPT_SAME_CPU, &cc->flags))
+				DMEMIT(" same_cpu_crypt");
+			if (test_bit(DM_CRYPT_NO_OFFLOAD, &cc->flags))
+				DMEMIT(" submit_from_crypt_cpus");
+			if (test_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags))
+				DMEMIT(" no_read_workqueue");
+		}
 		break;
 	}
 	return 0;
@@ -1821,7 +2027,7 @@ static int crypt_iterate_devices(struct dm_target *ti,
 
 static struct target_type crypt_target = {
 	.name   = "crypt",
-	.version = {1, 10, 0},
+	.version = {1, 11, 0},
 	.module = THIS_MODULE,
 	.ctr    = crypt_ctr,
 	.dtr    = crypt_dtr,
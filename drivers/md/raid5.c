@@ -69,6 +69,10 @@
 #define NR_HASH			(PAGE_SIZE / sizeof(struct hlist_head))
 #define HASH_MASK		(NR_HASH - 1)
 
+#define MAX_STRIPE_BATCH	8
+
+static struct workqueue_struct *raid5_wq;
+
 #define stripe_hash(conf, sect)	(&((conf)->stripe_hashtbl[((sect) >> STRIPE_SHIFT) & HASH_MASK]))
 
 /* bio's attached to a stripe+device for I/O are linked together in bi_sector
@@ -208,6 +212,16 @@ static void __release_stripe(raid5_conf_t *conf, struct stripe_head *sh)
 				plugger_set_plug(&conf->plug);
 			} else {
 				clear_bit(STRIPE_BIT_DELAY, &sh->state);
+				if (conf->worker_cnt) {
+					struct r5worker *worker;
+
+					worker = &conf->workers[sh->cpu %
+								conf->worker_cnt];
+					list_add_tail(&sh->lru,
+						      &worker->handle_list);
+					queue_work(raid5_wq, &worker->work);
+					return;
+				}
 				list_add_tail(&sh->lru, &conf->handle_list);
 			}
 			md_wakeup_thread(conf->mddev->thread);
@@ -332,6 +346,7 @@ static void init_stripe(struct stripe_head *sh, sector_t sector, int previous)
 	sh->sector = sector;
 	stripe_set_idx(sector, conf, previous, sh);
 	sh->state = 0;
+	sh->cpu = smp_processor_id();
 
 
 	for (i = sh->disks; i--; ) {
@@ -3936,10 +3951,19 @@ static int chunk_aligned_read(mddev_t *mddev, struct bio * raid_bio)
  * head of the hold_list has changed, i.e. the head was promoted to the
  * handle_list.
  */
-static struct stripe_head *__get_priority_stripe(raid5_conf_t *conf)
+static struct stripe_head *__get_priority_stripe(raid5_conf_t *conf,
+						 struct r5worker *worker)
 {
 	struct stripe_head *sh;
 
+	/* workers only serve their own list, raid5d keeps the hold_list */
+	if (worker) {
+		if (list_empty(&worker->handle_list))
+			return NULL;
+		sh = list_entry(worker->handle_list.next, typeof(*sh), lru);
+		goto found;
+	}
+
 	pr_debug("%s: handle: %s hold: %s full_writes: %d bypass_count: %d\n",
 		  __func__,
 		  list_empty(&conf->handle_list) ? "empty" : "busy",
@@ -3973,6 +3997,7 @@ static struct stripe_head *__get_priority_stripe(raid5_conf_t *conf)
 	} else
 		return NULL;
 
+found:
 	list_del_init(&sh->lru);
 	atomic_inc(&sh->count);
 	BUG_ON(atomic_read(&sh->count) != 1);
@@ -4510,6 +4535,70 @@ static int  retry_aligned_read(raid5_conf_t *conf, struct bio *raid_bio)
 }
 
 
+/*
+ * Handle up to MAX_STRIPE_BATCH stripes with a single drop and retake of
+ * device_lock, which must be held on entry and is held again on return.
+ * Returns the number of stripes handled.
+ */
+static int handle_active_stripes(raid5_conf_t *conf, struct r5worker *worker)
+{
+	struct stripe_head *batch[MAX_STRIPE_BATCH];
+	int i, batch_size = 0;
+	u64 total = 0, max = 0;
+
+	while (batch_size < MAX_STRIPE_BATCH &&
+	       (batch[batch_size] = __get_priority_stripe(conf, worker)) != NULL)
+		batch_size++;
+
+	if (batch_size == 0)
+		return 0;
+	spin_unlock_irq(&conf->device_lock);
+
+	for (i = 0; i < batch_size; i++) {
+		ktime_t start = ktime_get();
+		u64 ns;
+
+		handle_stripe(batch[i]);
+		ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+		total += ns;
+		if (ns > max)
+			max = ns;
+		cond_resched();
+	}
+
+	spin_lock_irq(&conf->device_lock);
+	for (i = 0; i < batch_size; i++)
+		__release_stripe(conf, batch[i]);
+
+	conf->stripes_handled += batch_size;
+	conf->handle_time_ns += total;
+	if (max > conf->handle_time_max_ns)
+		conf->handle_time_max_ns = max;
+	return batch_size;
+}
+
+static void raid5_do_work(struct work_struct *work)
+{
+	struct r5worker *worker = container_of(work, struct r5worker, work);
+	raid5_conf_t *conf = worker->conf;
+	int handled = 0;
+	int batch_size;
+
+	pr_debug("+++ raid5worker active\n");
+
+	spin_lock_irq(&conf->device_lock);
+	while ((batch_size = handle_active_stripes(conf, worker)))
+		handled += batch_size;
+	spin_unlock_irq(&conf->device_lock);
+
+	pr_debug("%d stripes handled\n", handled);
+
+	async_tx_issue_pending_all();
+	unplug_slaves(conf->mddev);
+
+	pr_debug("--- raid5worker inactive\n");
+}
+
 /*
  * This is our raid5 kernel thread.
  *
@@ -4519,9 +4608,9 @@ static int  retry_aligned_read(raid5_conf_t *conf, struct bio *raid_bio)
  */
 static void raid5d(mddev_t *mddev)
 {
-	struct stripe_head *sh;
 	raid5_conf_t *conf = mddev->private;
 	int handled;
+	int batch_size;
 
 	pr_debug("+++ raid5d active\n");
 
@@ -4551,18 +4640,10 @@ static void raid5d(mddev_t *mddev)
 			handled++;
 		}
 
-		sh = __get_priority_stripe(conf);
-
-		if (!sh)
+		batch_size = handle_active_stripes(conf, NULL);
+		if (!batch_size)
 			break;
-		spin_unlock_irq(&conf->device_lock);
-		
-		handled++;
-		handle_stripe(sh);
-		release_stripe(sh);
-		cond_resched();
-
-		spin_lock_irq(&conf->device_lock);
+		handled += batch_size;
 	}
 	pr_debug("%d stripes handled\n", handled);
 
@@ -4682,10 +4763,107 @@ stripe_cache_active_show(mddev_t *mddev, char *page)
 static struct md_sysfs_entry
 raid5_stripecache_active = __ATTR_RO(stripe_cache_active);
 
+static void free_stripe_workers(struct r5worker *workers, int cnt)
+{
+	int i;
+
+	for (i = 0; i < cnt; i++)
+		cancel_work_sync(&workers[i].work);
+	kfree(workers);
+}
+
+static ssize_t
+raid5_show_stripe_workers(mddev_t *mddev, char *page)
+{
+	raid5_conf_t *conf = mddev->private;
+	if (conf)
+		return sprintf(page, "%d\n", conf->worker_cnt);
+	else
+		return 0;
+}
+
+static ssize_t
+raid5_store_stripe_workers(mddev_t *mddev, const char *page, size_t len)
+{
+	raid5_conf_t *conf = mddev->private;
+	struct r5worker *workers = NULL, *old_workers;
+	unsigned long new;
+	int i, old_cnt;
+
+	if (len >= PAGE_SIZE)
+		return -EINVAL;
+	if (!conf)
+		return -ENODEV;
+
+	if (strict_strtoul(page, 10, &new))
+		return -EINVAL;
+	if (new > num_possible_cpus())
+		return -EINVAL;
+	if (new == conf->worker_cnt)
+		return len;
+
+	if (new) {
+		workers = kcalloc(new, sizeof(*workers), GFP_KERNEL);
+		if (!workers)
+			return -ENOMEM;
+		for (i = 0; i < new; i++) {
+			INIT_WORK(&workers[i].work, raid5_do_work);
+			workers[i].conf = conf;
+			INIT_LIST_HEAD(&workers[i].handle_list);
+		}
+	}
+
+	/* Quiescing drains every handle list, so nothing is left behind. */
+	mddev_suspend(mddev);
+	spin_lock_irq(&conf->device_lock);
+	old_workers = conf->workers;
+	old_cnt = conf->worker_cnt;
+	conf->workers = workers;
+	conf->worker_cnt = new;
+	spin_unlock_irq(&conf->device_lock);
+	mddev_resume(mddev);
+
+	free_stripe_workers(old_workers, old_cnt);
+	return len;
+}
+
+static struct md_sysfs_entry
+raid5_stripe_workers = __ATTR(stripe_workers, S_IRUGO | S_IWUSR,
+			      raid5_show_stripe_workers,
+			      raid5_store_stripe_workers);
+
+static ssize_t
+stripe_handle_stats_show(mddev_t *mddev, char *page)
+{
+	raid5_conf_t *conf = mddev->private;
+	unsigned long long handled;
+	u64 total, max;
+
+	if (!conf)
+		return 0;
+
+	spin_lock_irq(&conf->device_lock);
+	handled = conf->stripes_handled;
+	total = conf->handle_time_ns;
+	max = conf->handle_time_max_ns;
+	spin_unlock_irq(&conf->device_lock);
+
+	if (handled)
+		do_div(total, handled);
+	/* stripes handled, average and maximum handling time in ns */
+	return sprintf(page, "%llu %llu %llu\n", handled,
+		       (unsigned long long)total, (unsigned long long)max);
+}
+
+static struct md_sysfs_entry
+raid5_stripe_handle_stats = __ATTR_RO(stripe_handle_stats);
+
 static struct attribute *raid5_attrs[] =  {
 	&raid5_stripecache_size.attr,
 	&raid5_stripecache_active.attr,
 	&raid5_preread_bypass_threshold.attr,
+	&raid5_stripe_workers.attr,
+	&raid5_stripe_handle_stats.attr,
 	NULL,
 };
 static struct attribute_group raid5_attrs_group = {
@@ -4733,6 +4911,7 @@ static void raid5_free_percpu(raid5_conf_t *conf)
 
 static void free_conf(raid5_conf_t *conf)
 {
+	free_stripe_workers(conf->workers, conf->worker_cnt);
 	shrink_stripes(conf);
 	raid5_free_percpu(conf);
 	kfree(conf->disks);
@@ -6033,6 +6212,10 @@ static struct mdk_personality raid4_personality =
 
 static int __init raid5_init(void)
 {
+	raid5_wq = alloc_workqueue("raid5wq",
+				   WQ_UNBOUND | WQ_MEM_RECLAIM, 0);
+	if (!raid5_wq)
+		return -ENOMEM;
 	register_md_personality(&raid6_personality);
 	register_md_personality(&raid5_personality);
 	register_md_personality(&raid4_personality);
@@ -6044,6 +6227,7 @@ static void raid5_exit(void)
 	unregister_md_personality(&raid6_personality);
 	unregister_md_personality(&raid5_personality);
 	unregister_md_personality(&raid4_personality);
+	destroy_workqueue(raid5_wq);
 }
 
 module_init(raid5_init);
@@ -212,6 +212,7 @@ struct stripe_head {
 	spinlock_t		lock;
 	int			bm_seq;	/* sequence number for bitmap flushes */
 	int			disks;		/* disks in stripe */
+	int			cpu;		/* picks the stripe worker */
 	enum check_states	check_state;
 	enum reconstruct_states reconstruct_state;
 	/**
@@ -384,6 +385,13 @@ struct raid5_private_data {
 	int			bypass_threshold; /* preread nice */
 	struct list_head	*last_hold; /* detect hold_list promotions */
 
+	struct r5worker		*workers; /* stripe handling workers */
+	int			worker_cnt;
+	/* stripe handling statistics, protected by device_lock */
+	unsigned long long	stripes_handled;
+	u64			handle_time_ns;
+	u64			handle_time_max_ns;
+
 	atomic_t		reshape_stripes; /* stripes with pending writes for reshape */
 	/* unfortunately we need two cache names as we temporarily have
 	 * two caches.
@@ -440,6 +448,18 @@ struct raid5_private_data {
 
 typedef struct raid5_private_data raid5_conf_t;
 
+/*
+ * Stripe handling worker.  When conf->worker_cnt is non-zero,
+ * stripes needing handling go to the handle_list of the worker picked
+ * by the CPU that activated them, instead of conf->handle_list, and
+ * are processed from raid5_wq rather than by raid5d.
+ */
+struct r5worker {
+	struct work_struct	work;
+	raid5_conf_t		*conf;
+	struct list_head	handle_list; /* protected by device_lock */
+};
+
 /*
  * Our supported algorithms
  */
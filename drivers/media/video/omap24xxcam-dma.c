@@ -439,6 +439,7 @@ void omap24xxcam_sgdma_process(struct omap24xxcam_sgdma *sgdma)
 {
 	unsigned long flags;
 	int queued_sgdma, sgslot;
+	int started = 0;
 	struct sgdma_state *sg_state;
 	const u32 csr_error = CAMDMA_CSR_MISALIGNED_ERR
 		| CAMDMA_CSR_SUPERVISOR_ERR | CAMDMA_CSR_SECURE_ERR
@@ -454,17 +455,36 @@ void omap24xxcam_sgdma_process(struct omap24xxcam_sgdma *sgdma)
 		       !(sg_state->csr & csr_error)) {
 			const struct scatterlist *sglist;
 			unsigned int len;
+			int n = 1;
 
 			sglist = sg_state->sglist + sg_state->next_sglist;
+			len = sg_dma_len(sglist);
+
+			/*
+			 * Only four logical channels are available, so
+			 * cover as much of the buffer as possible with
+			 * each: physically contiguous entries (high-order
+			 * mmap pages, adjacent user pages) go out as a
+			 * single transfer.
+			 */
+			while (sg_state->next_sglist + n < sg_state->sglen) {
+				const struct scatterlist *sg = sglist + n;
+
+				if (sg_dma_address(sg) !=
+				    sg_dma_address(sglist) + len
+				    || len + sg_dma_len(sg) > DMA_MAX_TRANSFER)
+					break;
+				len += sg_dma_len(sg);
+				n++;
+			}
+
 			/* try to start the next DMA transfer */
-			if (sg_state->next_sglist + 1 == sg_state->sglen) {
+			if (sg_state->next_sglist + n == sg_state->sglen) {
 				/*
 				 *  On the last sg, we handle the case where
 				 *  cam->img.pix.sizeimage % PAGE_ALIGN != 0
 				 */
 				len = sg_state->len - sg_state->bytes_read;
-			} else {
-				len = sg_dma_len(sglist);
 			}
 
 			if (omap24xxcam_dma_start(&sgdma->dma,
@@ -473,24 +493,24 @@ void omap24xxcam_sgdma_process(struct omap24xxcam_sgdma *sgdma)
 						  omap24xxcam_sgdma_callback,
 						  (void *)sgslot)) {
 				/* DMA start failed */
-				spin_unlock_irqrestore(&sgdma->lock, flags);
-				return;
+				goto out;
 			} else {
-				unsigned long expires;
 				/* DMA start was successful */
-				sg_state->next_sglist++;
+				sg_state->next_sglist += n;
 				sg_state->bytes_read += len;
 				sg_state->queued_sglist++;
-
-				/* We start the reset timer */
-				expires = jiffies + HZ;
-				mod_timer(&sgdma->reset_timer, expires);
+				started = 1;
 			}
 		}
 		queued_sgdma--;
 		sgslot = (sgslot + 1) % NUM_SG_DMA;
 	}
 
+out:
+	/* We start the reset timer */
+	if (started)
+		mod_timer(&sgdma->reset_timer, jiffies + HZ);
+
 	spin_unlock_irqrestore(&sgdma->lock, flags);
 }
 
@@ -43,6 +43,12 @@
 /* number of bytes transferred per DMA request */
 #define DMA_THRESHOLD				32
 
+/*
+ * Largest transfer a single logical channel takes: CEN counts 8-bit
+ * elements in 24 bits.  Kept page aligned.
+ */
+#define DMA_MAX_TRANSFER			(0xffffff & PAGE_MASK)
+
 /*
  * NUM_CAMDMA_CHANNELS is the number of logical channels provided by
  * the camera DMA controller.
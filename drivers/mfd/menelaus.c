@@ -109,6 +109,7 @@
 #define MENELAUS_MCT_CTRL3		0x38
 #define MENELAUS_MCT_PIN_ST		0x39
 #define MENELAUS_DEBOUNCE1		0x3A
+#define MENELAUS_NUM_REGS		(MENELAUS_DEBOUNCE1 + 1)
 
 #define IH_MENELAUS_IRQS		12
 #define MENELAUS_MMC_S1CD_IRQ		0	/* MMC slot 1 card change */
@@ -177,28 +178,76 @@ struct menelaus_chip {
 	void			(*handlers[16])(struct menelaus_chip *);
 	void			(*mmc_callback)(void *data, u8 mask);
 	void			*mmc_callback_data;
+	/* shadow copies of the control registers, see menelaus_reg_cached() */
+	u8			reg_cache[MENELAUS_NUM_REGS];
+	unsigned long		reg_valid[BITS_TO_LONGS(MENELAUS_NUM_REGS)];
 };
 
 static struct menelaus_chip *the_menelaus;
 
+/*
+ * Regulator, sleep, GPIO control and MMC slot control registers only
+ * change when we write them, so they are read over I2C once and
+ * served from the shadow copy afterwards.  Writes that would not
+ * change the register are dropped.  Status, interrupt and RTC
+ * registers always go to the chip.
+ */
+static inline int menelaus_reg_cached(int reg)
+{
+	switch (reg) {
+	case MENELAUS_VCORE_CTRL1 ... MENELAUS_SLEEP_CTRL2:
+	case MENELAUS_GPIO_CTRL:
+	case MENELAUS_MCT_CTRL1 ... MENELAUS_MCT_CTRL3:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
 static int menelaus_write_reg(int reg, u8 value)
 {
-	int val = i2c_smbus_write_byte_data(the_menelaus->client, reg, value);
+	struct menelaus_chip *m = the_menelaus;
+	int cached = menelaus_reg_cached(reg);
+	int val;
 
+	if (cached && test_bit(reg, m->reg_valid) && m->reg_cache[reg] == value)
+		return 0;
+
+	val = i2c_smbus_write_byte_data(m->client, reg, value);
 	if (val < 0) {
 		pr_err(DRIVER_NAME ": write error");
+		if (cached)
+			clear_bit(reg, m->reg_valid);
 		return val;
 	}
 
+	if (cached) {
+		m->reg_cache[reg] = value;
+		set_bit(reg, m->reg_valid);
+	}
+
 	return 0;
 }
 
 static int menelaus_read_reg(int reg)
 {
-	int val = i2c_smbus_read_byte_data(the_menelaus->client, reg);
+	struct menelaus_chip *m = the_menelaus;
+	int cached = menelaus_reg_cached(reg);
+	int val;
 
-	if (val < 0)
+	if (cached && test_bit(reg, m->reg_valid))
+		return m->reg_cache[reg];
+
+	val = i2c_smbus_read_byte_data(m->client, reg);
+	if (val < 0) {
 		pr_err(DRIVER_NAME ": read error");
+		return val;
+	}
+
+	if (cached) {
+		m->reg_cache[reg] = val;
+		set_bit(reg, m->reg_valid);
+	}
 
 	return val;
 }
@@ -371,6 +420,9 @@ int menelaus_set_mmc_slot(int slot, int enable, int power, int cd_en)
 			val |= MCT_CTRL2_S2CD_BUFEN | MCT_CTRL2_S2CD_BEN;
 		else
 			val &= ~(MCT_CTRL2_S2CD_BUFEN | MCT_CTRL2_S2CD_BEN);
+		/* Slot 2 voltage select lives in the same register */
+		val &= ~(MCT_CTRL2_VS2_SEL_D0 | MCT_CTRL2_VS2_SEL_D1);
+		val |= power;
 	}
 	ret = menelaus_write_reg(MENELAUS_MCT_CTRL2, val);
 	if (ret < 0)
@@ -386,18 +438,10 @@ int menelaus_set_mmc_slot(int slot, int enable, int power, int cd_en)
 		else
 			val &= ~MCT_CTRL3_SLOT1_EN;
 	} else {
-		int b;
-
 		if (enable)
 			val |= MCT_CTRL3_SLOT2_EN;
 		else
 			val &= ~MCT_CTRL3_SLOT2_EN;
-		b = menelaus_read_reg(MENELAUS_MCT_CTRL2);
-		b &= ~(MCT_CTRL2_VS2_SEL_D0 | MCT_CTRL2_VS2_SEL_D1);
-		b |= power;
-		ret = menelaus_write_reg(MENELAUS_MCT_CTRL2, b);
-		if (ret < 0)
-			goto out;
 	}
 	/* Disable autonomous shutdown */
 	val &= ~(MCT_CTRL3_S1_AUTO_EN | MCT_CTRL3_S2_AUTO_EN);
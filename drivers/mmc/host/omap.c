@@ -155,6 +155,7 @@ struct mmc_omap_host {
 	unsigned		brs_received:1, dma_done:1;
 	unsigned		dma_is_read:1;
 	unsigned		dma_in_use:1;
+	unsigned		dma_sg:1;
 	int			dma_ch;
 	spinlock_t		dma_lock;
 	struct timer_list	dma_timer;
@@ -994,6 +995,12 @@ static void mmc_omap_dma_cb(int lch, u16 ch_status, void *data)
 	if (!(ch_status & OMAP_DMA_BLOCK_IRQ)) {
 		return;
 	}
+	if (host->dma_sg) {
+		/* The DMA layer ran every segment before calling back */
+		mmcdat->bytes_xfered = mmcdat->blocks * mmcdat->blksz;
+		mmc_omap_dma_done(host, host->data);
+		return;
+	}
 	mmcdat->bytes_xfered += host->dma_len;
 	host->sg_idx++;
 	if (host->sg_idx < host->sg_len) {
@@ -1129,6 +1136,13 @@ mmc_omap_prepare_data(struct mmc_omap_host *host, struct mmc_request *req)
 			host->sg_len = dma_map_sg(mmc_dev(host->mmc), data->sg,
 						sg_len, dma_data_dir);
 			host->total_bytes_left = 0;
+			/*
+			 * On 24xx the DMA layer can walk the scatterlist by
+			 * itself as long as each segment holds whole frames.
+			 */
+			host->dma_sg = cpu_class_is_omap2() &&
+				host->sg_len > 1 &&
+				(block_size <= 64 || block_size % 64 == 0);
 			mmc_omap_prepare_dma(host, req->data);
 			host->brs_received = 0;
 			host->dma_done = 0;
@@ -1139,6 +1153,7 @@ mmc_omap_prepare_data(struct mmc_omap_host *host, struct mmc_request *req)
 
 	/* Revert to PIO? */
 	if (!use_dma) {
+		host->dma_sg = 0;
 		OMAP_MMC_WRITE(host, BUF, 0x1f1f);
 		host->total_bytes_left = data->blocks * block_size;
 		host->sg_len = sg_len;
@@ -1147,6 +1162,24 @@ mmc_omap_prepare_data(struct mmc_omap_host *host, struct mmc_request *req)
 	}
 }
 
+#ifndef CONFIG_ARCH_OMAP1
+/*
+ * Hand the whole mapped scatterlist to the DMA layer, which loads each
+ * following segment from its completion interrupt using the channel
+ * setup mmc_omap_prepare_dma() made for the first one.
+ */
+static int mmc_omap_start_dma_sg(struct mmc_omap_host *host)
+{
+	struct omap_dma_desc desc;
+
+	omap_dma_save_desc(host->dma_ch, &desc);
+
+	return omap_start_dma_sg(host->dma_ch, &desc, host->data->sg,
+				 host->sg_len,
+				 !(host->data->flags & MMC_DATA_WRITE));
+}
+#endif
+
 static void mmc_omap_start_request(struct mmc_omap_host *host,
 				   struct mmc_request *req)
 {
@@ -1157,8 +1190,14 @@ static void mmc_omap_start_request(struct mmc_omap_host *host,
 	/* only touch fifo AFTER the controller readies it */
 	mmc_omap_prepare_data(host, req);
 	mmc_omap_start_command(host, req->cmd);
-	if (host->dma_in_use)
+	if (host->dma_in_use) {
+#ifndef CONFIG_ARCH_OMAP1
+		if (host->dma_sg && mmc_omap_start_dma_sg(host) == 0)
+			return;
+		host->dma_sg = 0;
+#endif
 		omap_start_dma(host->dma_ch);
+	}
 }
 
 static void mmc_omap_request(struct mmc_host *mmc, struct mmc_request *req)
@@ -28,32 +28,56 @@
 #include <linux/slab.h>
 #include <linux/types.h>
 #include <linux/vmalloc.h>
+#include <linux/list.h>
+#include <linux/jiffies.h>
+#include <linux/workqueue.h>
+#include <linux/moduleparam.h>
 
 #include <linux/mtd/mtd.h>
 #include <linux/mtd/blktrans.h>
 #include <linux/mutex.h>
 
 
+struct mtdblk_cache_line {
+	struct list_head lru;
+	unsigned char *data;
+	unsigned long offset;
+	unsigned long dirtied;		/* jiffies when it became dirty */
+	enum { STATE_EMPTY, STATE_CLEAN, STATE_DIRTY } state;
+};
+
 struct mtdblk_dev {
 	struct mtd_blktrans_dev mbd;
 	int count;
 	struct mutex cache_mutex;
-	unsigned char *cache_data;
-	unsigned long cache_offset;
+	struct mtdblk_cache_line *lines;
+	int nr_lines;
+	struct list_head lru;		/* most recently used line first */
 	unsigned int cache_size;
-	enum { STATE_EMPTY, STATE_CLEAN, STATE_DIRTY } cache_state;
+	struct delayed_work flush_work;
 };
 
 static struct mutex mtdblks_lock;
 
+static int cache_blocks = 1;
+module_param(cache_blocks, int, 0444);
+MODULE_PARM_DESC(cache_blocks, "Number of erase blocks cached per device (default 1)");
+
+static unsigned int writeback_ms = 5000;
+module_param(writeback_ms, uint, 0644);
+MODULE_PARM_DESC(writeback_ms, "Write back a dirty cached erase block after this many milliseconds (default 5000, 0 to write back only on flush or eviction)");
+
 /*
  * Cache stuff...
  *
  * Since typical flash erasable sectors are much larger than what Linux's
  * buffer cache can handle, we must implement read-modify-write on flash
  * sectors for each block write requests.  To avoid over-erasing flash sectors
- * and to speed things up, we locally cache a whole flash sector while it is
- * being written to until a different sector is required.
+ * and to speed things up, we locally cache up to cache_blocks whole flash
+ * sectors while they are being written to.  When a sector which is not cached
+ * is required, the least recently used one is written back and reused.
+ * Dirty sectors are also written back by a delayed work once they have been
+ * dirty for writeback_ms, so that data does not linger in RAM indefinitely.
  */
 
 static void erase_callback(struct erase_info *done)
@@ -111,20 +135,21 @@ static int erase_write (struct mtd_info *mtd, unsigned long pos,
 }
 
 
-static int write_cached_data (struct mtdblk_dev *mtdblk)
+static int write_cached_line (struct mtdblk_dev *mtdblk,
+			      struct mtdblk_cache_line *line)
 {
 	struct mtd_info *mtd = mtdblk->mbd.mtd;
 	int ret;
 
-	if (mtdblk->cache_state != STATE_DIRTY)
+	if (line->state != STATE_DIRTY)
 		return 0;
 
 	DEBUG(MTD_DEBUG_LEVEL2, "mtdblock: writing cached data for \"%s\" "
 			"at 0x%lx, size 0x%x\n", mtd->name,
-			mtdblk->cache_offset, mtdblk->cache_size);
+			line->offset, mtdblk->cache_size);
 
-	ret = erase_write (mtd, mtdblk->cache_offset,
-			   mtdblk->cache_size, mtdblk->cache_data);
+	ret = erase_write (mtd, line->offset,
+			   mtdblk->cache_size, line->data);
 	if (ret)
 		return ret;
 
@@ -135,16 +160,81 @@ static int write_cached_data (struct mtdblk_dev *mtdblk)
 	 * means.  Let's declare it empty and leave buffering tasks to
 	 * the buffer cache instead.
 	 */
-	mtdblk->cache_state = STATE_EMPTY;
+	line->state = STATE_EMPTY;
+	list_move_tail(&line->lru, &mtdblk->lru);
 	return 0;
 }
 
 
+static int write_cached_data (struct mtdblk_dev *mtdblk)
+{
+	int i, ret, err = 0;
+
+	for (i = 0; i < mtdblk->nr_lines; i++) {
+		ret = write_cached_line(mtdblk, &mtdblk->lines[i]);
+		if (ret && !err)
+			err = ret;
+	}
+	return err;
+}
+
+
+static struct mtdblk_cache_line *find_cached_line (struct mtdblk_dev *mtdblk,
+						   unsigned long sect_start)
+{
+	struct mtdblk_cache_line *line;
+
+	list_for_each_entry(line, &mtdblk->lru, lru)
+		if (line->state != STATE_EMPTY && line->offset == sect_start)
+			return line;
+	return NULL;
+}
+
+
+/*
+ * Write back dirty sectors that have been dirty for writeback_ms, and
+ * come back for the rest when the oldest of them is due.
+ */
+static void mtdblock_flush_work(struct work_struct *work)
+{
+	struct mtdblk_dev *mtdblk = container_of(work, struct mtdblk_dev,
+						 flush_work.work);
+	unsigned long expire = msecs_to_jiffies(writeback_ms);
+	unsigned long next = 0;
+	int i, pending = 0;
+
+	mutex_lock(&mtdblk->cache_mutex);
+	for (i = 0; i < mtdblk->nr_lines; i++) {
+		struct mtdblk_cache_line *line = &mtdblk->lines[i];
+
+		if (line->state != STATE_DIRTY)
+			continue;
+		if (time_after_eq(jiffies, line->dirtied + expire)) {
+			if (write_cached_line(mtdblk, line))
+				printk(KERN_WARNING "mtdblock: write back of "
+				       "0x%lx on \"%s\" failed\n",
+				       line->offset, mtdblk->mbd.mtd->name);
+			continue;
+		}
+		if (!pending || time_before(line->dirtied + expire, next))
+			next = line->dirtied + expire;
+		pending = 1;
+	}
+	mutex_unlock(&mtdblk->cache_mutex);
+
+	if (pending)
+		schedule_delayed_work(&mtdblk->flush_work,
+				      (long)(next - jiffies) > 0 ?
+				      next - jiffies : 1);
+}
+
+
 static int do_cached_write (struct mtdblk_dev *mtdblk, unsigned long pos,
 			    int len, const char *buf)
 {
 	struct mtd_info *mtd = mtdblk->mbd.mtd;
 	unsigned int sect_size = mtdblk->cache_size;
+	struct mtdblk_cache_line *line;
 	size_t retlen;
 	int ret;
 
@@ -161,44 +251,68 @@ static int do_cached_write (struct mtdblk_dev *mtdblk, unsigned long pos,
 		if( size > len )
 			size = len;
 
+		line = find_cached_line(mtdblk, sect_start);
+
 		if (size == sect_size) {
 			/*
 			 * We are covering a whole sector.  Thus there is no
 			 * need to bother with the cache while it may still be
-			 * useful for other partial writes.
+			 * useful for other partial writes.  A cached copy of
+			 * this sector is stale from now on.
 			 */
+			if (line) {
+				line->state = STATE_EMPTY;
+				list_move_tail(&line->lru, &mtdblk->lru);
+			}
 			ret = erase_write (mtd, pos, size, buf);
 			if (ret)
 				return ret;
 		} else {
 			/* Partial sector: need to use the cache */
 
-			if (mtdblk->cache_state == STATE_DIRTY &&
-			    mtdblk->cache_offset != sect_start) {
-				ret = write_cached_data(mtdblk);
+			if (!line) {
+				/* reuse the least recently used line */
+				line = list_entry(mtdblk->lru.prev,
+					struct mtdblk_cache_line, lru);
+				ret = write_cached_line(mtdblk, line);
 				if (ret)
 					return ret;
-			}
 
-			if (mtdblk->cache_state == STATE_EMPTY ||
-			    mtdblk->cache_offset != sect_start) {
+				if (!line->data) {
+					line->data = vmalloc(sect_size);
+					if (!line->data)
+						return -EINTR;
+					/* -EINTR is not really correct, but
+					 * it is the best match documented in
+					 * man 2 write for all cases.  We could
+					 * also return -EAGAIN sometimes, but
+					 * why bother?
+					 */
+				}
+
 				/* fill the cache with the current sector */
-				mtdblk->cache_state = STATE_EMPTY;
+				line->state = STATE_EMPTY;
 				ret = mtd->read(mtd, sect_start, sect_size,
-						&retlen, mtdblk->cache_data);
+						&retlen, line->data);
 				if (ret)
 					return ret;
 				if (retlen != sect_size)
 					return -EIO;
 
-				mtdblk->cache_offset = sect_start;
-				mtdblk->cache_size = sect_size;
-				mtdblk->cache_state = STATE_CLEAN;
+				line->offset = sect_start;
+				line->state = STATE_CLEAN;
 			}
 
 			/* write data to our local cache */
-			memcpy (mtdblk->cache_data + offset, buf, size);
-			mtdblk->cache_state = STATE_DIRTY;
+			memcpy (line->data + offset, buf, size);
+			if (line->state != STATE_DIRTY) {
+				line->state = STATE_DIRTY;
+				line->dirtied = jiffies;
+				if (writeback_ms)
+					schedule_delayed_work(&mtdblk->flush_work,
+						msecs_to_jiffies(writeback_ms));
+			}
+			list_move(&line->lru, &mtdblk->lru);
 		}
 
 		buf += size;
@@ -215,6 +329,7 @@ static int do_cached_read (struct mtdblk_dev *mtdblk, unsigned long pos,
 {
 	struct mtd_info *mtd = mtdblk->mbd.mtd;
 	unsigned int sect_size = mtdblk->cache_size;
+	struct mtdblk_cache_line *line;
 	size_t retlen;
 	int ret;
 
@@ -237,9 +352,9 @@ static int do_cached_read (struct mtdblk_dev *mtdblk, unsigned long pos,
 		 * contains what we want, otherwise we read the data directly
 		 * from flash.
 		 */
-		if (mtdblk->cache_state != STATE_EMPTY &&
-		    mtdblk->cache_offset == sect_start) {
-			memcpy (buf, mtdblk->cache_data + offset, size);
+		line = find_cached_line(mtdblk, sect_start);
+		if (line) {
+			memcpy (buf, line->data + offset, size);
 		} else {
 			ret = mtd->read(mtd, pos, size, &retlen, buf);
 			if (ret)
@@ -260,23 +375,24 @@ static int mtdblock_readsect(struct mtd_blktrans_dev *dev,
 			      unsigned long block, char *buf)
 {
 	struct mtdblk_dev *mtdblk = container_of(dev, struct mtdblk_dev, mbd);
-	return do_cached_read(mtdblk, block<<9, 512, buf);
+	int ret;
+
+	mutex_lock(&mtdblk->cache_mutex);
+	ret = do_cached_read(mtdblk, block<<9, 512, buf);
+	mutex_unlock(&mtdblk->cache_mutex);
+	return ret;
 }
 
 static int mtdblock_writesect(struct mtd_blktrans_dev *dev,
 			      unsigned long block, char *buf)
 {
 	struct mtdblk_dev *mtdblk = container_of(dev, struct mtdblk_dev, mbd);
-	if (unlikely(!mtdblk->cache_data && mtdblk->cache_size)) {
-		mtdblk->cache_data = vmalloc(mtdblk->mbd.mtd->erasesize);
-		if (!mtdblk->cache_data)
-			return -EINTR;
-		/* -EINTR is not really correct, but it is the best match
-		 * documented in man 2 write for all cases.  We could also
-		 * return -EAGAIN sometimes, but why bother?
-		 */
-	}
-	return do_cached_write(mtdblk, block<<9, 512, buf);
+	int ret;
+
+	mutex_lock(&mtdblk->cache_mutex);
+	ret = do_cached_write(mtdblk, block<<9, 512, buf);
+	mutex_unlock(&mtdblk->cache_mutex);
+	return ret;
 }
 
 static int mtdblock_open(struct mtd_blktrans_dev *mbd)
@@ -293,13 +409,28 @@ static int mtdblock_open(struct mtd_blktrans_dev *mbd)
 	}
 
 	/* OK, it's not open. Create cache info for it */
-	mtdblk->count = 1;
 	mutex_init(&mtdblk->cache_mutex);
-	mtdblk->cache_state = STATE_EMPTY;
+	INIT_LIST_HEAD(&mtdblk->lru);
+	INIT_DELAYED_WORK(&mtdblk->flush_work, mtdblock_flush_work);
+	mtdblk->cache_size = 0;
 	if (!(mbd->mtd->flags & MTD_NO_ERASE) && mbd->mtd->erasesize) {
+		int i;
+
+		/* Line buffers are allocated on first write */
+		mtdblk->nr_lines = max(cache_blocks, 1);
+		mtdblk->lines = kcalloc(mtdblk->nr_lines,
+					sizeof(*mtdblk->lines), GFP_KERNEL);
+		if (!mtdblk->lines) {
+			mutex_unlock(&mtdblks_lock);
+			return -ENOMEM;
+		}
+		for (i = 0; i < mtdblk->nr_lines; i++) {
+			mtdblk->lines[i].state = STATE_EMPTY;
+			list_add_tail(&mtdblk->lines[i].lru, &mtdblk->lru);
+		}
 		mtdblk->cache_size = mbd->mtd->erasesize;
-		mtdblk->cache_data = NULL;
 	}
+	mtdblk->count = 1;
 
 	mutex_unlock(&mtdblks_lock);
 
@@ -321,10 +452,20 @@ static int mtdblock_release(struct mtd_blktrans_dev *mbd)
 	mutex_unlock(&mtdblk->cache_mutex);
 
 	if (!--mtdblk->count) {
+		int i;
+
 		/* It was the last usage. Free the cache */
+		cancel_delayed_work_sync(&mtdblk->flush_work);
+		mutex_lock(&mtdblk->cache_mutex);
+		write_cached_data(mtdblk);
+		mutex_unlock(&mtdblk->cache_mutex);
 		if (mbd->mtd->sync)
 			mbd->mtd->sync(mbd->mtd);
-		vfree(mtdblk->cache_data);
+		for (i = 0; i < mtdblk->nr_lines; i++)
+			vfree(mtdblk->lines[i].data);
+		kfree(mtdblk->lines);
+		mtdblk->lines = NULL;
+		mtdblk->nr_lines = 0;
 	}
 
 	mutex_unlock(&mtdblks_lock);
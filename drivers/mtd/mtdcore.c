@@ -638,6 +638,102 @@ int default_mtd_writev(struct mtd_info *mtd, const struct kvec *vecs,
 	return ret;
 }
 
+/* default_mtd_readv - default mtd readv method for MTD devices that
+ *			don't implement their own
+ */
+
+int default_mtd_readv(struct mtd_info *mtd, struct kvec *vecs,
+		      unsigned long count, loff_t from, size_t *retlen)
+{
+	unsigned long i;
+	size_t totlen = 0, thislen;
+	int ret = 0, corrected = 0;
+
+	for (i=0; i<count; i++) {
+		if (!vecs[i].iov_len)
+			continue;
+		ret = mtd->read(mtd, from, vecs[i].iov_len, &thislen, vecs[i].iov_base);
+		totlen += thislen;
+		/* Corrected bitflips don't stop the read, report them at the end */
+		if (ret == -EUCLEAN) {
+			corrected = 1;
+			ret = 0;
+		}
+		if (ret || thislen != vecs[i].iov_len)
+			break;
+		from += vecs[i].iov_len;
+	}
+	if (!ret && corrected)
+		ret = -EUCLEAN;
+	if (retlen)
+		*retlen = totlen;
+	return ret;
+}
+
+/**
+ * mtd_do_io - carry out an I/O request synchronously
+ * @mtd: device to access
+ * @req: request, @req->retlen and @req->error are filled in
+ *
+ * Used as the fallback for devices without an asynchronous submit_io
+ * method, and by drivers which complete requests from a worker thread.
+ */
+void mtd_do_io(struct mtd_info *mtd, struct mtd_io_req *req)
+{
+	if (req->rw == MTD_IO_WRITE) {
+		if (!(mtd->flags & MTD_WRITEABLE))
+			req->error = -EROFS;
+		else if (mtd->writev)
+			req->error = mtd->writev(mtd, req->vecs, req->count,
+						 req->ofs, &req->retlen);
+		else
+			req->error = default_mtd_writev(mtd, req->vecs,
+						req->count, req->ofs,
+						&req->retlen);
+	} else {
+		if (mtd->readv)
+			req->error = mtd->readv(mtd, req->vecs, req->count,
+						req->ofs, &req->retlen);
+		else
+			req->error = default_mtd_readv(mtd, req->vecs,
+						req->count, req->ofs,
+						&req->retlen);
+	}
+}
+
+/**
+ * mtd_submit_io - submit an asynchronous I/O request
+ * @mtd: device to access
+ * @req: request to carry out
+ *
+ * Returns 0 if the request was accepted, in which case @req->callback is
+ * called once it has completed (possibly before this function returns),
+ * or a negative error code if the request is invalid.
+ */
+int mtd_submit_io(struct mtd_info *mtd, struct mtd_io_req *req)
+{
+	size_t len = 0;
+	unsigned long i;
+
+	for (i = 0; i < req->count; i++)
+		len += req->vecs[i].iov_len;
+	if (req->ofs < 0 || req->ofs + len > mtd->size)
+		return -EINVAL;
+	if (req->rw == MTD_IO_WRITE && !(mtd->flags & MTD_WRITEABLE))
+		return -EROFS;
+
+	req->mtd = mtd;
+	req->retlen = 0;
+	req->error = 0;
+
+	if (mtd->submit_io)
+		return mtd->submit_io(mtd, req);
+
+	mtd_do_io(mtd, req);
+	mtd_io_callback(req);
+	return 0;
+}
+
 EXPORT_SYMBOL_GPL(add_mtd_device);
 EXPORT_SYMBOL_GPL(del_mtd_device);
 EXPORT_SYMBOL_GPL(get_mtd_device);
@@ -648,6 +744,9 @@ EXPORT_SYMBOL_GPL(__put_mtd_device);
 EXPORT_SYMBOL_GPL(register_mtd_user);
 EXPORT_SYMBOL_GPL(unregister_mtd_user);
 EXPORT_SYMBOL_GPL(default_mtd_writev);
+EXPORT_SYMBOL_GPL(default_mtd_readv);
+EXPORT_SYMBOL_GPL(mtd_do_io);
+EXPORT_SYMBOL_GPL(mtd_submit_io);
 
 #ifdef CONFIG_PROC_FS
 
@@ -246,6 +246,45 @@ static int part_writev(struct mtd_info *mtd, const struct kvec *vecs,
 					to + part->offset, retlen);
 }
 
+static int part_readv(struct mtd_info *mtd, struct kvec *vecs,
+		unsigned long count, loff_t from, size_t *retlen)
+{
+	struct mtd_part *part = PART(mtd);
+	struct mtd_ecc_stats stats;
+	int res;
+
+	stats = part->master->ecc_stats;
+	res = part->master->readv(part->master, vecs, count,
+					from + part->offset, retlen);
+	if (unlikely(res)) {
+		if (res == -EUCLEAN)
+			mtd->ecc_stats.corrected += part->master->ecc_stats.corrected - stats.corrected;
+		if (res == -EBADMSG)
+			mtd->ecc_stats.failed += part->master->ecc_stats.failed - stats.failed;
+	}
+	return res;
+}
+
+static int part_submit_io(struct mtd_info *mtd, struct mtd_io_req *req)
+{
+	struct mtd_part *part = PART(mtd);
+
+	/* Bounds and write permission are checked by mtd_submit_io() */
+	req->ofs += part->offset;
+	return part->master->submit_io(part->master, req);
+}
+
+void mtd_io_callback(struct mtd_io_req *req)
+{
+	if (req->mtd->submit_io == part_submit_io) {
+		struct mtd_part *part = PART(req->mtd);
+
+		req->ofs -= part->offset;
+	}
+	req->callback(req);
+}
+EXPORT_SYMBOL_GPL(mtd_io_callback);
+
 static int part_erase(struct mtd_info *mtd, struct erase_info *instr)
 {
 	struct mtd_part *part = PART(mtd);
@@ -452,6 +491,10 @@ static struct mtd_part *allocate_partition(struct mtd_info *master,
 	}
 	if (master->writev)
 		slave->mtd.writev = part_writev;
+	if (master->readv)
+		slave->mtd.readv = part_readv;
+	if (master->submit_io)
+		slave->mtd.submit_io = part_submit_io;
 	if (master->lock)
 		slave->mtd.lock = part_lock;
 	if (master->unlock)
@@ -51,6 +51,10 @@
 #define ONENAND_IO_SIZE		SZ_128K
 #define ONENAND_BUFRAM_SIZE	(1024 * 5)
 
+static int dma_read;
+module_param(dma_read, bool, 0644);
+MODULE_PARM_DESC(dma_read, "Use DMA for OMAP2 BufferRAM page reads");
+
 struct omap2_onenand {
 	struct platform_device *pdev;
 	int gpmc_cs;
@@ -474,25 +478,46 @@ static int omap2_onenand_read_bufferram(struct mtd_info *mtd, int area,
 	struct onenand_chip *this = mtd->priv;
 	dma_addr_t dma_src, dma_dst;
 	int bram_offset;
+	unsigned long timeout;
+	void *buf = (void *)buffer;
+	volatile unsigned *done;
 
 	bram_offset = omap2_onenand_bufferram_offset(mtd, area) + area + offset;
-	/* DMA is not used.  Revisit PM requirements before enabling it. */
-	if (1 || (c->dma_channel < 0) ||
-	    ((void *) buffer >= (void *) high_memory) || (bram_offset & 3) ||
-	    (((unsigned int) buffer) & 3) || (count < 1024) || (count & 3)) {
-		memcpy(buffer, (__force void *)(this->base + bram_offset),
-		       count);
-		return 0;
+	/*
+	 * DMA is off unless asked for, revisit PM requirements before
+	 * making it the default. Only whole data pages are worth it: the
+	 * core has already started loading the next page into the other
+	 * BufferRAM, so this transfer overlaps with that load.
+	 */
+	if (!dma_read || (c->dma_channel < 0) || area != ONENAND_DATARAM ||
+	    (bram_offset & 3) || (((size_t) buf) & 3) || (count < 1024) ||
+	    (count & 3))
+		goto out_copy;
+
+	/* panic_write() may be in an interrupt context */
+	if (in_interrupt() || oops_in_progress)
+		goto out_copy;
+
+	/* UBIFS reads into vmalloc()ed buffers */
+	if (buf >= high_memory) {
+		struct page *p1;
+
+		if (((size_t)buf & PAGE_MASK) !=
+		    ((size_t)(buf + count - 1) & PAGE_MASK))
+			goto out_copy;
+		p1 = vmalloc_to_page(buf);
+		if (!p1)
+			goto out_copy;
+		buf = page_address(p1) + ((size_t)buf & ~PAGE_MASK);
 	}
 
 	dma_src = c->phys_base + bram_offset;
-	dma_dst = dma_map_single(&c->pdev->dev, buffer, count,
-				 DMA_FROM_DEVICE);
+	dma_dst = dma_map_single(&c->pdev->dev, buf, count, DMA_FROM_DEVICE);
 	if (dma_mapping_error(&c->pdev->dev, dma_dst)) {
 		dev_err(&c->pdev->dev,
 			"Couldn't DMA map a %d byte buffer\n",
 			count);
-		return -1;
+		goto out_copy;
 	}
 
 	omap_set_dma_transfer_params(c->dma_channel, OMAP_DMA_DATA_TYPE_S32,
@@ -504,10 +529,26 @@ static int omap2_onenand_read_bufferram(struct mtd_info *mtd, int area,
 
 	INIT_COMPLETION(c->dma_done);
 	omap_start_dma(c->dma_channel);
-	wait_for_completion(&c->dma_done);
+
+	/* A page takes tens of microseconds, don't sleep on it */
+	timeout = jiffies + msecs_to_jiffies(20);
+	done = &c->dma_done.done;
+	while (time_before(jiffies, timeout))
+		if (*done)
+			break;
 
 	dma_unmap_single(&c->pdev->dev, dma_dst, count, DMA_FROM_DEVICE);
 
+	if (!*done) {
+		dev_err(&c->pdev->dev, "timeout waiting for DMA\n");
+		omap_stop_dma(c->dma_channel);
+		goto out_copy;
+	}
+
+	return 0;
+
+out_copy:
+	memcpy(buf, (__force void *)(this->base + bram_offset), count);
 	return 0;
 }
 
@@ -521,7 +562,13 @@ static int omap2_onenand_write_bufferram(struct mtd_info *mtd, int area,
 	int bram_offset;
 
 	bram_offset = omap2_onenand_bufferram_offset(mtd, area) + area + offset;
-	/* DMA is not used.  Revisit PM requirements before enabling it. */
+	/*
+	 * DMA is not used.  Revisit PM requirements before enabling it.
+	 * It would not buy throughput either: onenand_write_ops_nolock()
+	 * fills one BufferRAM while the other one programs, and the copy
+	 * is shorter than the program time, while 24xx can't use sync
+	 * writes (see gpmc_onenand_init()).
+	 */
 	if (1 || (c->dma_channel < 0) ||
 	    ((void *) buffer >= (void *) high_memory) || (bram_offset & 3) ||
 	    (((unsigned int) buffer) & 3) || (count < 1024) || (count & 3)) {
@@ -751,6 +798,9 @@ static int __devinit omap2_onenand_probe(struct platform_device *pdev)
 		c->onenand.disable = omap2_onenand_disable;
 	}
 
+	if (pdata->flags & ONENAND_FLASH_BBT)
+		c->onenand.options |= ONENAND_USE_FLASH_BBT;
+
 	if ((r = onenand_scan(&c->mtd, 1)) < 0)
 		goto err_release_regulator;
 
@@ -29,6 +29,7 @@
 #include <linux/delay.h>
 #include <linux/interrupt.h>
 #include <linux/jiffies.h>
+#include <linux/workqueue.h>
 #include <linux/mtd/mtd.h>
 #include <linux/mtd/onenand.h>
 #include <linux/mtd/partitions.h>
@@ -1441,6 +1442,103 @@ static int onenand_read(struct mtd_info *mtd, loff_t from, size_t len,
 	return ret;
 }
 
+/**
+ * onenand_readv - [MTD Interface] Read data from flash into several buffers
+ * @param mtd		MTD device structure
+ * @param vecs		the buffers to fill, in flash order
+ * @param count		number of buffers
+ * @param from		offset to read from
+ * @param retlen	pointer to variable to store the number of read bytes
+ *
+ * Read with ecc, holding the chip across all the buffers
+ */
+static int onenand_readv(struct mtd_info *mtd, struct kvec *vecs,
+	unsigned long count, loff_t from, size_t *retlen)
+{
+	struct onenand_chip *this = mtd->priv;
+	struct mtd_oob_ops ops;
+	size_t totlen = 0;
+	unsigned long i;
+	int ret = 0, corrected = 0;
+
+	onenand_get_device(mtd, FL_READING);
+	for (i = 0; i < count; i++) {
+		if (!vecs[i].iov_len)
+			continue;
+
+		memset(&ops, 0, sizeof(ops));
+		ops.len = vecs[i].iov_len;
+		ops.datbuf = vecs[i].iov_base;
+		ret = ONENAND_IS_4KB_PAGE(this) ?
+			onenand_mlc_read_ops_nolock(mtd, from, &ops) :
+			onenand_read_ops_nolock(mtd, from, &ops);
+		totlen += ops.retlen;
+
+		/* Corrected bitflips don't stop the read */
+		if (ret == -EUCLEAN) {
+			corrected = 1;
+			ret = 0;
+		}
+		if (ret || ops.retlen != vecs[i].iov_len)
+			break;
+		from += ops.retlen;
+	}
+	onenand_release_device(mtd);
+
+	if (!ret && corrected)
+		ret = -EUCLEAN;
+	*retlen = totlen;
+	return ret;
+}
+
+/**
+ * onenand_io_work - [INTERN] Carry out queued asynchronous requests
+ * @param work		io_work of the OneNAND chip
+ *
+ * Requests are handled one at a time, in the order they were submitted
+ */
+static void onenand_io_work(struct work_struct *work)
+{
+	struct onenand_chip *this = container_of(work, struct onenand_chip,
+						 io_work);
+	struct mtd_io_req *req;
+
+	spin_lock(&this->io_lock);
+	while (!list_empty(&this->io_list)) {
+		req = list_first_entry(&this->io_list, struct mtd_io_req, list);
+		list_del(&req->list);
+		spin_unlock(&this->io_lock);
+
+		mtd_do_io(req->drv_data, req);
+		mtd_io_callback(req);
+
+		spin_lock(&this->io_lock);
+	}
+	spin_unlock(&this->io_lock);
+}
+
+/**
+ * onenand_submit_io - [MTD Interface] Queue an asynchronous request
+ * @param mtd		MTD device structure
+ * @param req		the request
+ *
+ * The request is carried out by a worker thread, so the caller can go on
+ * while the chip is busy
+ */
+static int onenand_submit_io(struct mtd_info *mtd, struct mtd_io_req *req)
+{
+	struct onenand_chip *this = mtd->priv;
+
+	req->drv_data = mtd;
+
+	spin_lock(&this->io_lock);
+	list_add_tail(&req->list, &this->io_list);
+	spin_unlock(&this->io_lock);
+
+	queue_work(system_nrt_wq, &this->io_work);
+	return 0;
+}
+
 /**
  * onenand_read_oob - [MTD Interface] Read main and/or out-of-band
  * @param mtd:		MTD device structure
@@ -2519,6 +2617,65 @@ static int onenand_erase(struct mtd_info *mtd, struct erase_info *instr)
 	return ret;
 }
 
+/**
+ * onenand_bbt_erase - [OneNAND Interface] erase a block for bbt write
+ * @param mtd		MTD device structure
+ * @param addr		start address of the block
+ *
+ * Erase one block regardless of its bad block table entry, so the
+ * blocks reserved for the flash based bad block table can be rewritten
+ */
+int onenand_bbt_erase(struct mtd_info *mtd, loff_t addr)
+{
+	struct onenand_chip *this = mtd->priv;
+	unsigned int block_size;
+	int ret;
+
+	if (FLEXONENAND(this))
+		block_size = mtd->eraseregions[flexonenand_region(mtd, addr)].erasesize;
+	else
+		block_size = 1 << this->erase_shift;
+
+	onenand_get_device(mtd, FL_ERASING);
+
+	this->command(mtd, ONENAND_CMD_ERASE, addr, block_size);
+
+	onenand_invalidate_bufferram(mtd, addr, block_size);
+
+	ret = this->wait(mtd, FL_ERASING);
+
+	onenand_release_device(mtd);
+
+	if (ret) {
+		printk(KERN_ERR "%s: Failed erase, block %d\n",
+			__func__, onenand_block(this, addr));
+		return -EIO;
+	}
+
+	return 0;
+}
+
+/**
+ * onenand_bbt_write - [OneNAND Interface] write main and oob for bbt write
+ * @param mtd		MTD device structure
+ * @param to		offset to write to
+ * @param ops		oob operation description structure
+ *
+ * Write the flash based bad block table into a block erased by
+ * onenand_bbt_erase
+ */
+int onenand_bbt_write(struct mtd_info *mtd, loff_t to,
+		      struct mtd_oob_ops *ops)
+{
+	int ret;
+
+	onenand_get_device(mtd, FL_WRITING);
+	ret = onenand_write_ops_nolock(mtd, to, ops);
+	onenand_release_device(mtd);
+
+	return ret;
+}
+
 /**
  * onenand_sync - [MTD Interface] sync
  * @param mtd		MTD device structure
@@ -2615,6 +2772,12 @@ static int onenand_block_markbad(struct mtd_info *mtd, loff_t ofs)
 	onenand_get_device(mtd, FL_WRITING);
 	ret = this->block_markbad(mtd, ofs);
 	onenand_release_device(mtd);
+	if (ret)
+		return ret;
+
+	/* Keep the flash based bad block table in sync */
+	if (this->options & ONENAND_USE_FLASH_BBT)
+		ret = onenand_update_bbt(mtd, ofs);
 	return ret;
 }
 
@@ -4011,6 +4174,10 @@ int onenand_scan(struct mtd_info *mtd, int maxchips)
 	init_waitqueue_head(&this->wq);
 	spin_lock_init(&this->chip_lock);
 
+	INIT_LIST_HEAD(&this->io_list);
+	spin_lock_init(&this->io_lock);
+	INIT_WORK(&this->io_work, onenand_io_work);
+
 	/*
 	 * Allow subpage writes up to oobsize.
 	 */
@@ -4063,6 +4230,8 @@ int onenand_scan(struct mtd_info *mtd, int maxchips)
 	mtd->write = onenand_write;
 	mtd->read_oob = onenand_read_oob;
 	mtd->write_oob = onenand_write_oob;
+	mtd->readv = onenand_readv;
+	mtd->submit_io = onenand_submit_io;
 	mtd->panic_write = onenand_panic_write;
 #ifdef CONFIG_MTD_ONENAND_OTP
 	mtd->get_fact_prot_info = onenand_get_fact_prot_info;
@@ -4105,6 +4274,9 @@ void onenand_release(struct mtd_info *mtd)
 {
 	struct onenand_chip *this = mtd->priv;
 
+	/* Complete any queued asynchronous requests */
+	flush_work_sync(&this->io_work);
+
 #ifdef CONFIG_MTD_PARTITIONS
 	/* Deregister partitions */
 	del_mtd_partitions (mtd);
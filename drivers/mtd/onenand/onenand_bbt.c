@@ -8,6 +8,14 @@
  *
  *  Derived from nand_bbt.c
  *
+ *  When the chip has the ONENAND_USE_FLASH_BBT option set, the table is
+ *  kept on flash in one of the last good blocks of the device, with a
+ *  mirror in another one. Each copy is marked by a pattern and a version
+ *  counter in the free area of the first page's OOB, the table itself
+ *  (2bit per block) is stored in the main area. The tables are created
+ *  by a full scan if none is found and rewritten when a block is marked
+ *  bad, so a normal boot reads only the table.
+ *
  *  TODO:
  *    Split BBT core and chip specific BBT.
  */
@@ -136,6 +144,352 @@ static inline int onenand_memory_bbt (struct mtd_info *mtd, struct nand_bbt_desc
 	return create_bbt(mtd, this->page_buf, bd, -1);
 }
 
+/**
+ * bbt_numblocks - [GENERIC] number of blocks covered by the bad block table
+ * @param this		OneNAND chip structure
+ */
+static inline int bbt_numblocks(struct onenand_chip *this)
+{
+	return this->chipsize >> this->erase_shift;
+}
+
+/**
+ * bbt_buf_len - [GENERIC] page aligned length of the table on flash
+ * @param mtd		MTD device structure
+ */
+static inline size_t bbt_buf_len(struct mtd_info *mtd)
+{
+	struct onenand_chip *this = mtd->priv;
+
+	return ALIGN(bbt_numblocks(this) >> 2, mtd->writesize);
+}
+
+/**
+ * search_bbt - [GENERIC] scan the device for a specific bad block table
+ * @param mtd		MTD device structure
+ * @param buf		temporary buffer
+ * @param td		descriptor for the bad block table
+ *
+ * Read the OOB free area of the first page of the last td->maxblocks
+ * blocks and check for the table pattern. The page number of the table
+ * and its version are stored in the descriptor.
+ */
+static int search_bbt(struct mtd_info *mtd, uint8_t *buf, struct nand_bbt_descr *td)
+{
+	struct onenand_chip *this = mtd->priv;
+	struct mtd_oob_ops ops;
+	int i, block, ret;
+
+	td->pages[0] = -1;
+	td->version[0] = 0;
+
+	for (i = 0; i < td->maxblocks; i++) {
+		block = bbt_numblocks(this) - 1 - i;
+
+		memset(&ops, 0, sizeof(ops));
+		ops.mode = MTD_OOB_AUTO;
+		ops.ooblen = td->veroffs + 1;
+		ops.oobbuf = buf;
+
+		ret = mtd->read_oob(mtd, onenand_addr(this, block), &ops);
+		if (ret && ret != -EUCLEAN)
+			continue;
+
+		if (memcmp(buf + td->offs, td->pattern, td->len))
+			continue;
+
+		td->pages[0] = onenand_addr(this, block) >> this->page_shift;
+		td->version[0] = buf[td->veroffs];
+		printk(KERN_DEBUG "OneNAND bad block table found at block %d, "
+			"version 0x%02x\n", block, td->version[0]);
+		return 0;
+	}
+
+	printk(KERN_WARNING "OneNAND bad block table '%.*s' not found\n",
+		td->len, td->pattern);
+	return -ENOENT;
+}
+
+/**
+ * read_bbt - [GENERIC] read the bad block table from flash
+ * @param mtd		MTD device structure
+ * @param buf		temporary buffer
+ * @param td		descriptor of the table to read
+ *
+ * Read the table found by search_bbt and merge it into the memory
+ * based bad block table
+ */
+static int read_bbt(struct mtd_info *mtd, uint8_t *buf, struct nand_bbt_descr *td)
+{
+	struct onenand_chip *this = mtd->priv;
+	struct bbm_info *bbm = this->bbm;
+	int i, numblocks = bbt_numblocks(this);
+	size_t retlen, len = bbt_buf_len(mtd);
+	loff_t from = (loff_t) td->pages[0] << this->page_shift;
+	int ret;
+
+	ret = mtd->read(mtd, from, len, &retlen, buf);
+	if (ret < 0 && ret != -EUCLEAN) {
+		printk(KERN_WARNING "OneNAND: error %d reading bad block table "
+			"at 0x%012llx\n", ret, (unsigned long long) from);
+		return ret;
+	}
+
+	for (i = 0; i < numblocks; i++) {
+		uint8_t tmp = (buf[i >> 2] >> ((i & 0x03) << 1)) & 0x03;
+
+		if (tmp == 0x03)
+			continue;
+
+		/* Factory marked bad or worn out ? */
+		bbm->bbt[i >> 2] |= (tmp ? 0x01 : 0x03) << ((i & 0x03) << 1);
+		mtd->ecc_stats.badblocks++;
+		printk(KERN_DEBUG "OneNAND eraseblock %d is marked bad "
+			"in the bad block table\n", i);
+	}
+
+	return 0;
+}
+
+/**
+ * write_bbt - [GENERIC] write the bad block table to flash
+ * @param mtd		MTD device structure
+ * @param buf		temporary buffer
+ * @param td		descriptor of the table to write
+ * @param md		descriptor of the mirror table, which must not be
+ *			overwritten
+ *
+ * Write the memory based table to the block td already lives in, or to
+ * the last good block not used by the mirror. A block which fails to
+ * erase or program is marked bad and the next one is tried.
+ */
+static int write_bbt(struct mtd_info *mtd, uint8_t *buf,
+		     struct nand_bbt_descr *td, struct nand_bbt_descr *md)
+{
+	struct onenand_chip *this = mtd->priv;
+	struct bbm_info *bbm = this->bbm;
+	int i, block, numblocks = bbt_numblocks(this);
+	size_t len = bbt_buf_len(mtd);
+	uint8_t *oob = buf + len;
+	struct mtd_oob_ops ops;
+	loff_t to;
+	int ret;
+
+	for (i = 0; i < td->maxblocks; i++) {
+		if (td->pages[0] != -1) {
+			/* Reuse the block of the previous version */
+			to = (loff_t) td->pages[0] << this->page_shift;
+			i--;
+		} else {
+			block = numblocks - 1 - i;
+			to = onenand_addr(this, block);
+
+			/* Skip bad blocks and the block used by the mirror */
+			if (bbm->bbt[block >> 2] & (0x01 << ((block & 0x03) << 1)))
+				continue;
+			if (md && md->pages[0] == (int) (to >> this->page_shift))
+				continue;
+		}
+
+		/* Preset the buffer with 0xff, so good blocks read as 0x03 */
+		memset(buf, 0xff, len);
+		for (block = 0; block < numblocks; block++) {
+			uint8_t dat = (bbm->bbt[block >> 2] >> ((block & 0x03) << 1)) & 0x03;
+
+			/* Do not store the reserved bbt blocks */
+			if (dat == 0x01)
+				buf[block >> 2] &= ~(0x01 << ((block & 0x03) << 1));
+			else if (dat == 0x03)
+				buf[block >> 2] &= ~(0x03 << ((block & 0x03) << 1));
+		}
+
+		memset(oob, 0xff, td->veroffs + 1);
+		memcpy(oob + td->offs, td->pattern, td->len);
+		oob[td->veroffs] = td->version[0];
+
+		block = onenand_block(this, to);
+		ret = onenand_bbt_erase(mtd, to);
+		if (!ret) {
+			memset(&ops, 0, sizeof(ops));
+			ops.mode = MTD_OOB_AUTO;
+			ops.len = len;
+			ops.datbuf = buf;
+			ops.ooblen = td->veroffs + 1;
+			ops.oobbuf = oob;
+			ret = onenand_bbt_write(mtd, to, &ops);
+		}
+
+		if (!ret) {
+			td->pages[0] = to >> this->page_shift;
+			printk(KERN_DEBUG "OneNAND bad block table written to "
+				"block %d, version 0x%02x\n", block, td->version[0]);
+			return 0;
+		}
+
+		printk(KERN_WARNING "OneNAND: error %d writing bad block table "
+			"to block %d\n", ret, block);
+
+		/* The block wore out, take the next one */
+		bbm->bbt[block >> 2] |= 0x01 << ((block & 0x03) << 1);
+		mtd->ecc_stats.badblocks++;
+		td->pages[0] = -1;
+	}
+
+	printk(KERN_ERR "OneNAND: no space left to write bad block table\n");
+	return -ENOSPC;
+}
+
+/**
+ * mark_bbt_region - [GENERIC] mark the bad block table regions
+ * @param mtd		MTD device structure
+ * @param td		bad block table descriptor
+ *
+ * The good blocks of the bad block table search area are marked as
+ * reserved, so they are neither used for data nor erased by upper layers
+ */
+static void mark_bbt_region(struct mtd_info *mtd, struct nand_bbt_descr *td)
+{
+	struct onenand_chip *this = mtd->priv;
+	struct bbm_info *bbm = this->bbm;
+	int i, block;
+
+	for (i = 0; i < td->maxblocks; i++) {
+		block = bbt_numblocks(this) - 1 - i;
+		if (!(bbm->bbt[block >> 2] & (0x03 << ((block & 0x03) << 1))))
+			bbm->bbt[block >> 2] |= 0x02 << ((block & 0x03) << 1);
+	}
+}
+
+/**
+ * onenand_flash_bbt - [GENERIC] read or create the flash based bad block table
+ * @param mtd		MTD device structure
+ * @param bd		descriptor for the good/bad block search pattern
+ *
+ * Search for the main and the mirror table and read the newer one. A
+ * missing or outdated copy is rewritten from it; if no table exists the
+ * device is scanned and both copies are created.
+ */
+static int onenand_flash_bbt(struct mtd_info *mtd, struct nand_bbt_descr *bd)
+{
+	struct onenand_chip *this = mtd->priv;
+	struct bbm_info *bbm = this->bbm;
+	struct nand_bbt_descr *td = bbm->bbt_td;
+	struct nand_bbt_descr *md = bbm->bbt_md;
+	struct nand_bbt_descr *rd = NULL;
+	int len = bbt_numblocks(this) >> 2;
+	int writeops = 0;
+	uint8_t *buf;
+	int ret = 0;
+
+	buf = kmalloc(bbt_buf_len(mtd) + mtd->oobsize, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	search_bbt(mtd, buf, td);
+	search_bbt(mtd, buf, md);
+
+	if (td->pages[0] == -1 && md->pages[0] == -1) {
+		writeops = 0x03;
+	} else if (td->pages[0] == -1) {
+		rd = md;
+		writeops = 0x01;
+	} else if (md->pages[0] == -1) {
+		rd = td;
+		writeops = 0x02;
+	} else if (td->version[0] == md->version[0]) {
+		rd = td;
+	} else if (((int8_t) (td->version[0] - md->version[0])) > 0) {
+		rd = td;
+		writeops = 0x02;
+	} else {
+		rd = md;
+		writeops = 0x01;
+	}
+
+	/* Fall back to the other copy if the newer one is unreadable */
+	if (rd && read_bbt(mtd, buf, rd)) {
+		memset(bbm->bbt, 0, len);
+		mtd->ecc_stats.badblocks = 0;
+		rd = (rd == td) ? md : td;
+		if (rd->pages[0] == -1 || read_bbt(mtd, buf, rd)) {
+			memset(bbm->bbt, 0, len);
+			mtd->ecc_stats.badblocks = 0;
+			rd = NULL;
+		}
+		writeops = 0x03;
+	}
+
+	if (!rd) {
+		/* Create the table in memory by scanning the device */
+		ret = onenand_memory_bbt(mtd, bd);
+		if (ret)
+			goto out;
+		td->version[0] = md->version[0] = 1;
+	} else {
+		td->version[0] = md->version[0] = rd->version[0];
+	}
+
+	/* Failing to write a copy leaves us with the RAM based table */
+	if (writeops & 0x01)
+		write_bbt(mtd, buf, td, md);
+	if (writeops & 0x02)
+		write_bbt(mtd, buf, md, td);
+
+	mark_bbt_region(mtd, td);
+	mark_bbt_region(mtd, md);
+out:
+	kfree(buf);
+	return ret;
+}
+
+/**
+ * onenand_update_bbt - [OneNAND Interface] update the flash based bad block table
+ * @param mtd		MTD device structure
+ * @param offs		offset of the bad block
+ *
+ * Mark the block bad in the memory based table and write new versions
+ * of both copies of the flash based table
+ */
+int onenand_update_bbt(struct mtd_info *mtd, loff_t offs)
+{
+	struct onenand_chip *this = mtd->priv;
+	struct bbm_info *bbm = this->bbm;
+	struct nand_bbt_descr *td = bbm->bbt_td;
+	struct nand_bbt_descr *md = bbm->bbt_md;
+	int block, ret, res;
+	uint8_t *buf;
+
+	if (!bbm->bbt || !td)
+		return -EINVAL;
+
+	buf = kmalloc(bbt_buf_len(mtd) + mtd->oobsize, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	mutex_lock(&bbm->bbt_mutex);
+
+	block = onenand_block(this, offs);
+	bbm->bbt[block >> 2] |= 0x01 << ((block & 0x03) << 1);
+
+	td->version[0]++;
+	md->version[0] = td->version[0];
+
+	/* One good copy is enough to find the block bad on next boot */
+	ret = write_bbt(mtd, buf, td, md);
+	res = write_bbt(mtd, buf, md, td);
+	if (!res)
+		ret = 0;
+
+	/* A block given up while writing may have been a reserved one */
+	mark_bbt_region(mtd, td);
+	mark_bbt_region(mtd, md);
+
+	mutex_unlock(&bbm->bbt_mutex);
+
+	kfree(buf);
+	return ret;
+}
+
 /**
  * onenand_isbad_bbt - [OneNAND Interface] Check if a block is bad
  * @param mtd		MTD device structure
@@ -192,6 +546,7 @@ int onenand_scan_bbt(struct mtd_info *mtd, struct nand_bbt_descr *bd)
 		printk(KERN_ERR "onenand_scan_bbt: Out of memory\n");
 		return -ENOMEM;
 	}
+	mutex_init(&bbm->bbt_mutex);
 
 	/* Set the bad block position */
 	bbm->badblockpos = ONENAND_BADBLOCK_POS;
@@ -202,6 +557,16 @@ int onenand_scan_bbt(struct mtd_info *mtd, struct nand_bbt_descr *bd)
 	if (!bbm->isbad_bbt)
 		bbm->isbad_bbt = onenand_isbad_bbt;
 
+	/* Read the flash based table, if the chip keeps one */
+	if ((this->options & ONENAND_USE_FLASH_BBT) && bbm->bbt_td) {
+		if ((ret = onenand_flash_bbt(mtd, bd))) {
+			printk(KERN_ERR "onenand_scan_bbt: Can't read or create the flash based BBT\n");
+			kfree(bbm->bbt);
+			bbm->bbt = NULL;
+		}
+		return ret;
+	}
+
 	/* Scan the device to build a memory based bad block table */
 	if ((ret = onenand_memory_bbt(mtd, bd))) {
 		printk(KERN_ERR "onenand_scan_bbt: Can't scan flash and build the RAM-based BBT\n");
@@ -225,6 +590,33 @@ static struct nand_bbt_descr largepage_memorybased = {
 	.pattern = scan_ff_pattern,
 };
 
+/*
+ * Descriptors of the flash based bad block table and its mirror. Pattern
+ * and version are placed in the OOB free area (MTD_OOB_AUTO).
+ */
+static uint8_t bbt_pattern[] = { 'B', 'b', 't', '0' };
+static uint8_t mirror_pattern[] = { '1', 't', 'b', 'B' };
+
+static struct nand_bbt_descr onenand_bbt_main_descr = {
+	.options = NAND_BBT_LASTBLOCK | NAND_BBT_CREATE | NAND_BBT_WRITE
+		| NAND_BBT_2BIT | NAND_BBT_VERSION,
+	.offs = 0,
+	.len = 4,
+	.veroffs = 4,
+	.maxblocks = NAND_BBT_SCAN_MAXBLOCKS,
+	.pattern = bbt_pattern,
+};
+
+static struct nand_bbt_descr onenand_bbt_mirror_descr = {
+	.options = NAND_BBT_LASTBLOCK | NAND_BBT_CREATE | NAND_BBT_WRITE
+		| NAND_BBT_2BIT | NAND_BBT_VERSION,
+	.offs = 0,
+	.len = 4,
+	.veroffs = 4,
+	.maxblocks = NAND_BBT_SCAN_MAXBLOCKS,
+	.pattern = mirror_pattern,
+};
+
 /**
  * onenand_default_bbt - [OneNAND Interface] Select a default bad block table for the device
  * @param mtd		MTD device structure
@@ -247,8 +639,14 @@ int onenand_default_bbt(struct mtd_info *mtd)
 	if (!bbm->badblock_pattern)
 		bbm->badblock_pattern = &largepage_memorybased;
 
+	if ((this->options & ONENAND_USE_FLASH_BBT) && !bbm->bbt_td) {
+		bbm->bbt_td = &onenand_bbt_main_descr;
+		bbm->bbt_md = &onenand_bbt_mirror_descr;
+	}
+
 	return onenand_scan_bbt(mtd, bbm->badblock_pattern);
 }
 
 EXPORT_SYMBOL(onenand_scan_bbt);
 EXPORT_SYMBOL(onenand_default_bbt);
+EXPORT_SYMBOL(onenand_update_bbt);
@@ -131,6 +131,14 @@ static struct device_attribute dev_bgt_enabled =
 	__ATTR(bgt_enabled, S_IRUGO, dev_attribute_show, NULL);
 static struct device_attribute dev_mtd_num =
 	__ATTR(mtd_num, S_IRUGO, dev_attribute_show, NULL);
+static struct device_attribute dev_free_reserve =
+	__ATTR(free_reserve, S_IRUGO, dev_attribute_show, NULL);
+static struct device_attribute dev_free_eraseblocks =
+	__ATTR(free_eraseblocks, S_IRUGO, dev_attribute_show, NULL);
+static struct device_attribute dev_min_free_eraseblocks =
+	__ATTR(min_free_eraseblocks, S_IRUGO, dev_attribute_show, NULL);
+static struct device_attribute dev_erase_stalls =
+	__ATTR(erase_stalls, S_IRUGO, dev_attribute_show, NULL);
 
 /**
  * ubi_volume_notify - send a volume change notification.
@@ -355,6 +363,14 @@ static ssize_t dev_attribute_show(struct device *dev,
 		ret = sprintf(buf, "%d\n", ubi->thread_enabled);
 	else if (attr == &dev_mtd_num)
 		ret = sprintf(buf, "%d\n", ubi->mtd->index);
+	else if (attr == &dev_free_reserve)
+		ret = sprintf(buf, "%d\n", ubi->free_reserve);
+	else if (attr == &dev_free_eraseblocks)
+		ret = sprintf(buf, "%d\n", ubi->free_count);
+	else if (attr == &dev_min_free_eraseblocks)
+		ret = sprintf(buf, "%d\n", ubi->min_free_count);
+	else if (attr == &dev_erase_stalls)
+		ret = sprintf(buf, "%d\n", ubi->erase_stalls);
 	else
 		ret = -EINVAL;
 
@@ -422,6 +438,18 @@ static int ubi_sysfs_init(struct ubi_device *ubi, int *ref)
 	if (err)
 		return err;
 	err = device_create_file(&ubi->dev, &dev_mtd_num);
+	if (err)
+		return err;
+	err = device_create_file(&ubi->dev, &dev_free_reserve);
+	if (err)
+		return err;
+	err = device_create_file(&ubi->dev, &dev_free_eraseblocks);
+	if (err)
+		return err;
+	err = device_create_file(&ubi->dev, &dev_min_free_eraseblocks);
+	if (err)
+		return err;
+	err = device_create_file(&ubi->dev, &dev_erase_stalls);
 	return err;
 }
 
@@ -431,6 +459,10 @@ static int ubi_sysfs_init(struct ubi_device *ubi, int *ref)
  */
 static void ubi_sysfs_close(struct ubi_device *ubi)
 {
+	device_remove_file(&ubi->dev, &dev_erase_stalls);
+	device_remove_file(&ubi->dev, &dev_min_free_eraseblocks);
+	device_remove_file(&ubi->dev, &dev_free_eraseblocks);
+	device_remove_file(&ubi->dev, &dev_free_reserve);
 	device_remove_file(&ubi->dev, &dev_mtd_num);
 	device_remove_file(&ubi->dev, &dev_bgt_enabled);
 	device_remove_file(&ubi->dev, &dev_min_io_size);
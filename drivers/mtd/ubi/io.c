@@ -715,8 +715,7 @@ bad:
 int ubi_io_read_ec_hdr(struct ubi_device *ubi, int pnum,
 		       struct ubi_ec_hdr *ec_hdr, int verbose)
 {
-	int err, read_err;
-	uint32_t crc, magic, hdr_crc;
+	int read_err;
 
 	dbg_io("read EC header from PEB %d", pnum);
 	ubi_assert(pnum >= 0 && pnum < ubi->peb_count);
@@ -737,6 +736,26 @@ int ubi_io_read_ec_hdr(struct ubi_device *ubi, int pnum,
 		 */
 	}
 
+	return ubi_io_check_ec_hdr(ubi, pnum, ec_hdr, read_err, verbose);
+}
+
+/**
+ * ubi_io_check_ec_hdr - check an erase counter header which was read.
+ * @ubi: UBI device description object
+ * @pnum: physical eraseblock the header was read from
+ * @ec_hdr: the erase counter header to check
+ * @read_err: what 'ubi_io_read()' returned for the header, %0,
+ * %UBI_IO_BITFLIPS or %-EBADMSG
+ * @verbose: be verbose if the header is corrupted or was not found
+ *
+ * This function returns the same codes as 'ubi_io_read_ec_hdr()'.
+ */
+int ubi_io_check_ec_hdr(struct ubi_device *ubi, int pnum,
+			struct ubi_ec_hdr *ec_hdr, int read_err, int verbose)
+{
+	int err;
+	uint32_t crc, magic, hdr_crc;
+
 	magic = be32_to_cpu(ec_hdr->magic);
 	if (magic != UBI_EC_HDR_MAGIC) {
 		if (read_err == -EBADMSG)
@@ -986,8 +1005,7 @@ bad:
 int ubi_io_read_vid_hdr(struct ubi_device *ubi, int pnum,
 			struct ubi_vid_hdr *vid_hdr, int verbose)
 {
-	int err, read_err;
-	uint32_t crc, magic, hdr_crc;
+	int read_err;
 	void *p;
 
 	dbg_io("read VID header from PEB %d", pnum);
@@ -999,6 +1017,27 @@ int ubi_io_read_vid_hdr(struct ubi_device *ubi, int pnum,
 	if (read_err && read_err != UBI_IO_BITFLIPS && read_err != -EBADMSG)
 		return read_err;
 
+	return ubi_io_check_vid_hdr(ubi, pnum, vid_hdr, read_err, verbose);
+}
+
+/**
+ * ubi_io_check_vid_hdr - check a volume identifier header which was read.
+ * @ubi: UBI device description object
+ * @pnum: physical eraseblock the header was read from
+ * @vid_hdr: the volume identifier header to check
+ * @read_err: what 'ubi_io_read()' returned for the header, %0,
+ * %UBI_IO_BITFLIPS or %-EBADMSG
+ * @verbose: be verbose if the header is corrupted or wasn't found
+ *
+ * This function returns the same codes as 'ubi_io_read_vid_hdr()'.
+ */
+int ubi_io_check_vid_hdr(struct ubi_device *ubi, int pnum,
+			 struct ubi_vid_hdr *vid_hdr, int read_err,
+			 int verbose)
+{
+	int err;
+	uint32_t crc, magic, hdr_crc;
+
 	magic = be32_to_cpu(vid_hdr->magic);
 	if (magic != UBI_VID_HDR_MAGIC) {
 		if (read_err == -EBADMSG)
@@ -1053,6 +1092,44 @@ int ubi_io_read_vid_hdr(struct ubi_device *ubi, int pnum,
 	return read_err ? UBI_IO_BITFLIPS : 0;
 }
 
+/**
+ * ubi_io_read_hdrs - read both headers of a PEB with one flash read.
+ * @ubi: UBI device description object
+ * @pnum: physical eraseblock to read from
+ * @buf: buffer of at least @ubi->vid_hdr_aloffset + @ubi->vid_hdr_alsize
+ * bytes
+ * @ec_hdr: where to store the erase counter header
+ * @vid_hdr: where to store the volume identifier header
+ *
+ * When both headers live in the same minimal I/O unit, as with NAND
+ * sub-pages, reading them separately costs two flash reads of the same
+ * page.  This function reads the headers in one go and copies them out to
+ * @ec_hdr and @vid_hdr, which then have to be checked with
+ * 'ubi_io_check_ec_hdr()' and 'ubi_io_check_vid_hdr()'. It returns %0,
+ * %UBI_IO_BITFLIPS or %-EBADMSG, which is what has to be passed to the
+ * check functions as @read_err, or another negative error code in case of
+ * failure.
+ */
+int ubi_io_read_hdrs(struct ubi_device *ubi, int pnum, void *buf,
+		     struct ubi_ec_hdr *ec_hdr, struct ubi_vid_hdr *vid_hdr)
+{
+	int read_err;
+
+	dbg_io("read EC and VID headers from PEB %d", pnum);
+	ubi_assert(pnum >= 0 &&  pnum < ubi->peb_count);
+
+	read_err = ubi_io_read(ubi, buf, pnum, 0,
+			       ubi->vid_hdr_aloffset + ubi->vid_hdr_alsize);
+	if (read_err && read_err != UBI_IO_BITFLIPS && read_err != -EBADMSG)
+		return read_err;
+
+	memcpy(ec_hdr, buf, UBI_EC_HDR_SIZE);
+	memcpy((char *)vid_hdr - ubi->vid_hdr_shift,
+	       buf + ubi->vid_hdr_aloffset, ubi->vid_hdr_alsize);
+
+	return read_err;
+}
+
 /**
  * ubi_io_write_vid_hdr - write a volume identifier header.
  * @ubi: UBI device description object
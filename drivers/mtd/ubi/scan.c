@@ -83,6 +83,8 @@ static int paranoid_check_si(struct ubi_device *ubi, struct ubi_scan_info *si);
 /* Temporary variables used during scanning */
 static struct ubi_ec_hdr *ech;
 static struct ubi_vid_hdr *vidh;
+/* Both headers at once, if they share a minimal I/O unit */
+static void *hdrs_buf;
 
 /**
  * add_to_list - add physical eraseblock to a list.
@@ -826,6 +828,7 @@ static int process_eb(struct ubi_device *ubi, struct ubi_scan_info *si,
 {
 	long long uninitialized_var(ec);
 	int err, bitflips = 0, vol_id, ec_err = 0;
+	int uninitialized_var(read_err);
 
 	dbg_bld("scan PEB %d", pnum);
 
@@ -843,7 +846,13 @@ static int process_eb(struct ubi_device *ubi, struct ubi_scan_info *si,
 		return 0;
 	}
 
-	err = ubi_io_read_ec_hdr(ubi, pnum, ech, 0);
+	if (hdrs_buf) {
+		read_err = ubi_io_read_hdrs(ubi, pnum, hdrs_buf, ech, vidh);
+		if (read_err < 0 && read_err != -EBADMSG)
+			return read_err;
+		err = ubi_io_check_ec_hdr(ubi, pnum, ech, read_err, 0);
+	} else
+		err = ubi_io_read_ec_hdr(ubi, pnum, ech, 0);
 	if (err < 0)
 		return err;
 	switch (err) {
@@ -926,7 +935,10 @@ static int process_eb(struct ubi_device *ubi, struct ubi_scan_info *si,
 
 	/* OK, we've done with the EC header, let's look at the VID header */
 
-	err = ubi_io_read_vid_hdr(ubi, pnum, vidh, 0);
+	if (hdrs_buf)
+		err = ubi_io_check_vid_hdr(ubi, pnum, vidh, read_err, 0);
+	else
+		err = ubi_io_read_vid_hdr(ubi, pnum, vidh, 0);
 	if (err < 0)
 		return err;
 	switch (err) {
@@ -1160,6 +1172,16 @@ struct ubi_scan_info *ubi_scan(struct ubi_device *ubi)
 	if (!vidh)
 		goto out_ech;
 
+	/*
+	 * If the VID header sits in the same minimal I/O unit as the EC
+	 * header, fetch both with one flash read per PEB. This is not
+	 * critical, so just fall back to separate reads if there is no
+	 * memory.
+	 */
+	if (ubi->vid_hdr_aloffset + ubi->vid_hdr_alsize <= ubi->min_io_size)
+		hdrs_buf = kmalloc(ubi->vid_hdr_aloffset + ubi->vid_hdr_alsize,
+				   GFP_KERNEL);
+
 	for (pnum = 0; pnum < ubi->peb_count; pnum++) {
 		cond_resched();
 
@@ -1206,12 +1228,16 @@ struct ubi_scan_info *ubi_scan(struct ubi_device *ubi)
 	if (err)
 		goto out_vidh;
 
+	kfree(hdrs_buf);
+	hdrs_buf = NULL;
 	ubi_free_vid_hdr(ubi, vidh);
 	kfree(ech);
 
 	return si;
 
 out_vidh:
+	kfree(hdrs_buf);
+	hdrs_buf = NULL;
 	ubi_free_vid_hdr(ubi, vidh);
 out_ech:
 	kfree(ech);
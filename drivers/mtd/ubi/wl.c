@@ -141,6 +141,12 @@
  */
 #define WL_MAX_FAILURES 32
 
+/*
+ * Number of free physical eraseblocks the background thread tries to keep
+ * erased in advance, so that users do not have to wait for erasures.
+ */
+#define WL_FREE_RESERVE CONFIG_MTD_UBI_FREE_RESERVE
+
 /**
  * struct ubi_work - UBI work description data structure.
  * @list: a link in the list of pending works
@@ -386,7 +392,7 @@ static struct ubi_wl_entry *find_wl_entry(struct rb_root *root, int max)
  */
 int ubi_wl_get_peb(struct ubi_device *ubi, int dtype)
 {
-	int err, medium_ec;
+	int err, medium_ec, stalled = 0;
 	struct ubi_wl_entry *e, *first, *last;
 
 	ubi_assert(dtype == UBI_LONGTERM || dtype == UBI_SHORTTERM ||
@@ -401,6 +407,10 @@ retry:
 			spin_unlock(&ubi->wl_lock);
 			return -ENOSPC;
 		}
+		if (!stalled) {
+			ubi->erase_stalls += 1;
+			stalled = 1;
+		}
 		spin_unlock(&ubi->wl_lock);
 
 		err = produce_free_peb(ubi);
@@ -456,6 +466,9 @@ retry:
 	 * be protected from being moved for some time.
 	 */
 	rb_erase(&e->u.rb, &ubi->free);
+	ubi->free_count -= 1;
+	if (ubi->free_count < ubi->min_free_count)
+		ubi->min_free_count = ubi->free_count;
 	dbg_wl("PEB %d EC %d", e->pnum, e->ec);
 	prot_queue_add(ubi, e);
 	spin_unlock(&ubi->wl_lock);
@@ -599,18 +612,26 @@ repeat:
 	spin_unlock(&ubi->wl_lock);
 }
 
+static int erase_worker(struct ubi_device *ubi, struct ubi_work *wl_wrk,
+			int cancel);
+
 /**
  * schedule_ubi_work - schedule a work.
  * @ubi: UBI device description object
  * @wrk: the work to schedule
  *
  * This function adds a work defined by @wrk to the tail of the pending works
- * list.
+ * list. Erase works are added to the head instead if there are less free
+ * physical eraseblocks than @ubi->free_reserve, so that the reserve is refilled
+ * before anything else is done.
  */
 static void schedule_ubi_work(struct ubi_device *ubi, struct ubi_work *wrk)
 {
 	spin_lock(&ubi->wl_lock);
-	list_add_tail(&wrk->list, &ubi->works);
+	if (wrk->func == &erase_worker && ubi->free_count < ubi->free_reserve)
+		list_add(&wrk->list, &ubi->works);
+	else
+		list_add_tail(&wrk->list, &ubi->works);
 	ubi_assert(ubi->works_count >= 0);
 	ubi->works_count += 1;
 	if (ubi->thread_enabled)
@@ -618,9 +639,6 @@ static void schedule_ubi_work(struct ubi_device *ubi, struct ubi_work *wrk)
 	spin_unlock(&ubi->wl_lock);
 }
 
-static int erase_worker(struct ubi_device *ubi, struct ubi_work *wl_wrk,
-			int cancel);
-
 /**
  * schedule_erase - schedule an erase work.
  * @ubi: UBI device description object
@@ -728,6 +746,9 @@ static int wear_leveling_worker(struct ubi_device *ubi, struct ubi_work *wrk,
 
 	paranoid_check_in_wl_tree(e2, &ubi->free);
 	rb_erase(&e2->u.rb, &ubi->free);
+	ubi->free_count -= 1;
+	if (ubi->free_count < ubi->min_free_count)
+		ubi->min_free_count = ubi->free_count;
 	ubi->move_from = e1;
 	ubi->move_to = e2;
 	spin_unlock(&ubi->wl_lock);
@@ -962,6 +983,14 @@ static int ensure_wear_leveling(struct ubi_device *ubi)
 			/* No physical eraseblocks - no deal */
 			goto out_unlock;
 
+		/*
+		 * Wear-leveling takes a free physical eraseblock, so postpone
+		 * it while pending works are refilling the reserve of erased
+		 * ones. We are called again after each erasure.
+		 */
+		if (ubi->free_count < ubi->free_reserve && ubi->works_count)
+			goto out_unlock;
+
 		/*
 		 * We schedule wear-leveling only if the difference between the
 		 * lowest erase counter of used physical eraseblocks and a high
@@ -1031,6 +1060,7 @@ static int erase_worker(struct ubi_device *ubi, struct ubi_work *wl_wrk,
 
 		spin_lock(&ubi->wl_lock);
 		wl_tree_add(e, &ubi->free);
+		ubi->free_count += 1;
 		spin_unlock(&ubi->wl_lock);
 
 		/*
@@ -1436,6 +1466,7 @@ int ubi_wl_init_scan(struct ubi_device *ubi, struct ubi_scan_info *si)
 	init_rwsem(&ubi->work_sem);
 	ubi->max_ec = si->max_ec;
 	INIT_LIST_HEAD(&ubi->works);
+	ubi->free_reserve = WL_FREE_RESERVE;
 
 	sprintf(ubi->bgt_name, UBI_BGT_NAME_PATTERN, ubi->ubi_num);
 
@@ -1475,8 +1506,10 @@ int ubi_wl_init_scan(struct ubi_device *ubi, struct ubi_scan_info *si)
 		e->ec = seb->ec;
 		ubi_assert(e->ec >= 0);
 		wl_tree_add(e, &ubi->free);
+		ubi->free_count += 1;
 		ubi->lookuptbl[e->pnum] = e;
 	}
+	ubi->min_free_count = ubi->free_count;
 
 	ubi_rb_for_each_entry(rb1, sv, &si->volumes, rb) {
 		ubi_rb_for_each_entry(rb2, seb, &sv->root, u.rb) {
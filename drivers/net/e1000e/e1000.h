@@ -352,6 +352,10 @@ struct e1000_adapter {
 	u32 alloc_rx_buff_failed;
 	u32 rx_dma_failed;
 
+	/* Rx buffers recycled from Tx completion */
+	struct skb_recycle_pool *rx_recycle;
+	struct skb_recycle_stats rx_recycle_stats;
+
 	unsigned int rx_ps_pages;
 	u16 rx_ps_bsize0;
 	u32 max_frame_size;
@@ -106,6 +106,9 @@ static const struct e1000_stats e1000_gstrings_stats[] = {
 	E1000_STAT("dropped_smbus", stats.mgpdc),
 	E1000_STAT("rx_dma_failed", rx_dma_failed),
 	E1000_STAT("tx_dma_failed", tx_dma_failed),
+	E1000_STAT("rx_recycled", rx_recycle_stats.recycled),
+	E1000_STAT("rx_recycle_reused", rx_recycle_stats.reused),
+	E1000_STAT("rx_recycle_rejected", rx_recycle_stats.rejected),
 };
 
 #define E1000_GLOBAL_STATS_LEN	ARRAY_SIZE(e1000_gstrings_stats)
@@ -1986,6 +1989,7 @@ static void e1000_get_ethtool_stats(struct net_device *netdev,
 	char *p = NULL;
 
 	e1000e_update_stats(adapter);
+	skb_recycle_pool_stats(adapter->rx_recycle, &adapter->rx_recycle_stats);
 	for (i = 0; i < E1000_GLOBAL_STATS_LEN; i++) {
 		switch (e1000_gstrings_stats[i].type) {
 		case NETDEV_STATS:
@@ -540,7 +540,8 @@ static void e1000_alloc_rx_buffers(struct e1000_adapter *adapter,
 			goto map_skb;
 		}
 
-		skb = netdev_alloc_skb_ip_align(netdev, bufsz);
+		skb = netdev_alloc_skb_recycle(netdev, bufsz,
+					       adapter->rx_recycle);
 		if (!skb) {
 			/* Better luck next round */
 			adapter->alloc_rx_buff_failed++;
@@ -906,7 +907,7 @@ next_desc:
 }
 
 static void e1000_put_txbuf(struct e1000_adapter *adapter,
-			     struct e1000_buffer *buffer_info)
+			     struct e1000_buffer *buffer_info, bool recycle)
 {
 	if (buffer_info->dma) {
 		if (buffer_info->mapped_as_page)
@@ -918,7 +919,9 @@ static void e1000_put_txbuf(struct e1000_adapter *adapter,
 		buffer_info->dma = 0;
 	}
 	if (buffer_info->skb) {
-		dev_kfree_skb_any(buffer_info->skb);
+		if (!recycle ||
+		    !skb_recycle_pool_put(adapter->rx_recycle, buffer_info->skb))
+			dev_kfree_skb_any(buffer_info->skb);
 		buffer_info->skb = NULL;
 	}
 	buffer_info->time_stamp = 0;
@@ -1013,7 +1016,7 @@ static bool e1000_clean_tx_irq(struct e1000_adapter *adapter)
 				total_tx_bytes += buffer_info->bytecount;
 			}
 
-			e1000_put_txbuf(adapter, buffer_info);
+			e1000_put_txbuf(adapter, buffer_info, true);
 			tx_desc->upper.data = 0;
 
 			i++;
@@ -1029,6 +1032,8 @@ static bool e1000_clean_tx_irq(struct e1000_adapter *adapter)
 
 	tx_ring->next_to_clean = i;
 
+	netdev_completed_queue(netdev, total_tx_packets, total_tx_bytes);
+
 #define TX_WAKE_THRESHOLD 32
 	if (count && netif_carrier_ok(netdev) &&
 	    e1000_desc_unused(tx_ring) >= TX_WAKE_THRESHOLD) {
@@ -2157,7 +2162,7 @@ static void e1000_clean_tx_ring(struct e1000_adapter *adapter)
 
 	for (i = 0; i < tx_ring->count; i++) {
 		buffer_info = &tx_ring->buffer_info[i];
-		e1000_put_txbuf(adapter, buffer_info);
+		e1000_put_txbuf(adapter, buffer_info, false);
 	}
 
 	size = sizeof(struct e1000_buffer) * tx_ring->count;
@@ -2165,6 +2170,8 @@ static void e1000_clean_tx_ring(struct e1000_adapter *adapter)
 
 	memset(tx_ring->desc, 0, tx_ring->size);
 
+	netdev_reset_queue(adapter->netdev);
+
 	tx_ring->next_to_use = 0;
 	tx_ring->next_to_clean = 0;
 
@@ -2368,6 +2375,10 @@ static int __devinit e1000_alloc_queues(struct e1000_adapter *adapter)
 	if (!adapter->rx_ring)
 		goto err;
 
+	adapter->rx_recycle = skb_recycle_pool_create(0, E1000_DEFAULT_RXD);
+	if (!adapter->rx_recycle)
+		goto err;
+
 	return 0;
 err:
 	e_err("Unable to allocate memory for queues\n");
@@ -3091,6 +3102,14 @@ static void e1000_configure(struct e1000_adapter *adapter)
 	e1000_configure_tx(adapter);
 	e1000_setup_rctl(adapter);
 	e1000_configure_rx(adapter);
+
+	/* only the legacy Rx path can take recycled buffers */
+	if (adapter->alloc_rx_buf == e1000_alloc_rx_buffers)
+		skb_recycle_pool_resize(adapter->rx_recycle,
+					adapter->rx_buffer_len + NET_IP_ALIGN);
+	else
+		skb_recycle_pool_resize(adapter->rx_recycle, 0);
+
 	adapter->alloc_rx_buf(adapter, e1000_desc_unused(adapter->rx_ring));
 }
 
@@ -4628,7 +4647,7 @@ dma_error:
 			i += tx_ring->count;
 		i--;
 		buffer_info = &tx_ring->buffer_info[i];
-		e1000_put_txbuf(adapter, buffer_info);
+		e1000_put_txbuf(adapter, buffer_info, false);
 	}
 
 	return 0;
@@ -4884,6 +4903,9 @@ static netdev_tx_t e1000_xmit_frame(struct sk_buff *skb,
 	/* if count is 0 then mapping error has occured */
 	count = e1000_tx_map(adapter, skb, first, max_per_txd, nr_frags, mss);
 	if (count) {
+		unsigned int eop = tx_ring->buffer_info[first].next_to_watch;
+
+		netdev_sent_queue(netdev, tx_ring->buffer_info[eop].bytecount);
 		e1000_tx_queue(adapter, tx_flags, count);
 		/* Make sure there is space in the ring for the next send. */
 		e1000_maybe_stop_tx(netdev, MAX_SKB_FRAGS + 2);
@@ -6034,6 +6056,7 @@ err_eeprom:
 err_hw_init:
 	kfree(adapter->tx_ring);
 	kfree(adapter->rx_ring);
+	skb_recycle_pool_destroy(adapter->rx_recycle);
 err_sw_init:
 	if (adapter->hw.flash_address)
 		iounmap(adapter->hw.flash_address);
@@ -6102,6 +6125,7 @@ static void __devexit e1000_remove(struct pci_dev *pdev)
 	e1000e_reset_interrupt_capability(adapter);
 	kfree(adapter->tx_ring);
 	kfree(adapter->rx_ring);
+	skb_recycle_pool_destroy(adapter->rx_recycle);
 
 	iounmap(adapter->hw.hw_addr);
 	if (adapter->hw.flash_address)
@@ -4470,6 +4470,7 @@ static void tg3_tx(struct tg3_napi *tnapi)
 	u32 sw_idx = tnapi->tx_cons;
 	struct netdev_queue *txq;
 	int index = tnapi - tp->napi;
+	unsigned int pkts_compl = 0, bytes_compl = 0;
 
 	if (tp->tg3_flags3 & TG3_FLG3_ENABLE_TSS)
 		index--;
@@ -4507,6 +4508,9 @@ static void tg3_tx(struct tg3_napi *tnapi)
 			sw_idx = NEXT_TX(sw_idx);
 		}
 
+		pkts_compl++;
+		bytes_compl += skb->len;
+
 		dev_kfree_skb(skb);
 
 		if (unlikely(tx_bug)) {
@@ -4515,6 +4519,8 @@ static void tg3_tx(struct tg3_napi *tnapi)
 		}
 	}
 
+	netdev_tx_completed_queue(txq, pkts_compl, bytes_compl);
+
 	tnapi->tx_cons = sw_idx;
 
 	/* Need to make the tx_cons update visible to tg3_start_xmit()
@@ -5760,6 +5766,8 @@ static netdev_tx_t tg3_start_xmit(struct sk_buff *skb,
 		}
 	}
 
+	netdev_tx_sent_queue(txq, skb->len);
+
 	/* Packets are ready, update Tx producer idx local and on card. */
 	tw32_tx_mbox(tnapi->prodmbox, entry);
 
@@ -6053,6 +6061,9 @@ static netdev_tx_t tg3_start_xmit_dma_bug(struct sk_buff *skb,
 		entry = start;
 	}
 
+	/* The workaround may have replaced skb; account what is on the ring. */
+	netdev_tx_sent_queue(txq, tnapi->tx_buffers[tnapi->tx_prod].skb->len);
+
 	/* Packets are ready, update Tx producer idx local and on card. */
 	tw32_tx_mbox(tnapi->prodmbox, entry);
 
@@ -6401,6 +6412,9 @@ static void tg3_free_rings(struct tg3 *tp)
 
 			dev_kfree_skb_any(skb);
 		}
+
+		netdev_tx_reset_queue(netdev_get_tx_queue(tp->dev,
+		    (tp->tg3_flags3 & TG3_FLG3_ENABLE_TSS) ? j - 1 : j));
 	}
 }
 
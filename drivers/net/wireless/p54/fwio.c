@@ -164,6 +164,18 @@ int p54_parse_firmware(struct ieee80211_hw *dev, const struct firmware *fw)
 		   (priv->privacy_caps & BR_DESC_PRIV_CAP_AESCCMP)
 		   ? "YES" : "no");
 
+	/*
+	 * Track the device side tx window in fixed size blocks, so
+	 * p54_assign_address does not have to walk the tx_queue to
+	 * find a hole.
+	 */
+	priv->tx_mem_blocks = (priv->rx_end - priv->rx_start) >>
+			      P54_MEM_BLOCK_SHIFT;
+	priv->tx_mem_map = kzalloc(BITS_TO_LONGS(priv->tx_mem_blocks) *
+				   sizeof(long), GFP_KERNEL);
+	if (!priv->tx_mem_map)
+		return -ENOMEM;
+
 	if (priv->rx_keycache_size) {
 		/*
 		 * NOTE:
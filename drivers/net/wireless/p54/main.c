@@ -214,6 +214,7 @@ static void p54_stop(struct ieee80211_hw *dev)
 	priv->stop(dev);
 	skb_queue_purge(&priv->tx_pending);
 	skb_queue_purge(&priv->tx_queue);
+	bitmap_zero(priv->tx_mem_map, priv->tx_mem_blocks);
 	for (i = 0; i < P54_QUEUE_NUM; i++) {
 		priv->tx_stats[i].count = 0;
 		priv->tx_stats[i].len = 0;
@@ -643,10 +644,12 @@ void p54_free_common(struct ieee80211_hw *dev)
 	kfree(priv->output_limit);
 	kfree(priv->curve_data);
 	kfree(priv->used_rxkeys);
+	kfree(priv->tx_mem_map);
 	priv->iq_autocal = NULL;
 	priv->output_limit = NULL;
 	priv->curve_data = NULL;
 	priv->used_rxkeys = NULL;
+	priv->tx_mem_map = NULL;
 	ieee80211_free_hw(dev);
 }
 EXPORT_SYMBOL_GPL(p54_free_common);
@@ -157,6 +157,10 @@ struct p54_led_dev {
 
 #endif /* CONFIG_P54_LEDS */
 
+/* device memory is handed out to tx frames in blocks of this size */
+#define P54_MEM_BLOCK_SHIFT	6
+#define P54_MEM_BLOCK		(1 << P54_MEM_BLOCK_SHIFT)
+
 struct p54_tx_queue_stats {
 	unsigned int len;
 	unsigned int limit;
@@ -169,6 +173,12 @@ struct p54_common {
 	void (*tx)(struct ieee80211_hw *dev, struct sk_buff *skb);
 	int (*open)(struct ieee80211_hw *dev);
 	void (*stop)(struct ieee80211_hw *dev);
+	/*
+	 * set by bus drivers which never call p54_rx() from hard irq
+	 * context, so frames can go to mac80211 without the extra
+	 * tasklet bounce of ieee80211_rx_irqsafe().
+	 */
+	bool rx_direct;
 	struct sk_buff_head tx_pending;
 	struct sk_buff_head tx_queue;
 	struct mutex conf_mutex;
@@ -176,6 +186,8 @@ struct p54_common {
 	/* memory management (as seen by the firmware) */
 	u32 rx_start;
 	u32 rx_end;
+	unsigned long *tx_mem_map;
+	unsigned int tx_mem_blocks;
 	u16 rx_mtu;
 	u8 headroom;
 	u8 tailroom;
@@ -554,6 +554,8 @@ static int __devinit p54p_probe(struct pci_dev *pdev,
 		err = -ENOMEM;
 		goto err_iounmap;
 	}
+	/* rx runs from p54p_tasklet */
+	priv->common.rx_direct = true;
 	priv->common.open = p54p_open;
 	priv->common.stop = p54p_stop;
 	priv->common.tx = p54p_tx;
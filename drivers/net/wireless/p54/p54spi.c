@@ -57,6 +57,11 @@ static int p54spi_gpio_irq = 87;
 module_param(p54spi_gpio_irq, int, 0444);
 MODULE_PARM_DESC(p54spi_gpio_irq, "gpio number for irq line");
 
+static unsigned int p54spi_sleep_delay = 10;
+module_param(p54spi_sleep_delay, uint, 0644);
+MODULE_PARM_DESC(p54spi_sleep_delay,
+		 "msecs to keep the chip awake after the last transfer");
+
 static void p54spi_spi_read(struct p54s_priv *priv, u8 address,
 			      void *buf, size_t len)
 {
@@ -167,23 +172,35 @@ static int p54spi_spi_write_dma(struct p54s_priv *priv, __le32 base,
 static int p54spi_request_firmware(struct ieee80211_hw *dev)
 {
 	struct p54s_priv *priv = dev->priv;
+	const struct firmware *fw;
 	int ret;
 
 	/* FIXME: should driver use it's own struct device? */
-	ret = request_firmware(&priv->firmware, "3826.arm", &priv->spi->dev);
+	ret = request_firmware(&fw, "3826.arm", &priv->spi->dev);
 
 	if (ret < 0) {
 		dev_err(&priv->spi->dev, "request_firmware() failed: %d", ret);
 		return ret;
 	}
 
-	ret = p54_parse_firmware(dev, priv->firmware);
-	if (ret) {
-		release_firmware(priv->firmware);
-		return ret;
+	ret = p54_parse_firmware(dev, fw);
+	if (ret)
+		goto out;
+
+	/*
+	 * Keep the image for the lifetime of the device in memory the
+	 * SPI controller can DMA from, every interface up uploads it.
+	 */
+	priv->fw_image = kmemdup(fw->data, fw->size, GFP_KERNEL);
+	if (!priv->fw_image) {
+		ret = -ENOMEM;
+		goto out;
 	}
+	priv->fw_len = fw->size;
 
-	return 0;
+out:
+	release_firmware(fw);
+	return ret;
 }
 
 static int p54spi_request_eeprom(struct ieee80211_hw *dev)
@@ -220,12 +237,9 @@ static int p54spi_upload_firmware(struct ieee80211_hw *dev)
 	unsigned long fw_len, _fw_len;
 	unsigned int offset = 0;
 	int err = 0;
-	u8 *fw;
+	u8 *fw = priv->fw_image;
 
-	fw_len = priv->firmware->size;
-	fw = kmemdup(priv->firmware->data, fw_len, GFP_KERNEL);
-	if (!fw)
-		return -ENOMEM;
+	fw_len = priv->fw_len;
 
 	/* stop the device */
 	p54spi_write16(priv, SPI_ADRS_DEV_CTRL_STAT, cpu_to_le16(
@@ -241,7 +255,9 @@ static int p54spi_upload_firmware(struct ieee80211_hw *dev)
 	msleep(TARGET_BOOT_SLEEP);
 
 	while (fw_len > 0) {
-		_fw_len = min_t(long, fw_len, SPI_MAX_PACKET_SIZE);
+		/* Even sized chunks keep every chunk aligned and spare
+		 * the separate transfer for an odd trailing byte */
+		_fw_len = min_t(long, fw_len, SPI_MAX_PACKET_SIZE & ~1);
 
 		err = p54spi_spi_write_dma(priv, cpu_to_le32(
 					   ISL38XX_DEV_FIRMWARE_ADDR + offset),
@@ -271,7 +287,6 @@ static int p54spi_upload_firmware(struct ieee80211_hw *dev)
 	msleep(TARGET_BOOT_SLEEP);
 
 out:
-	kfree(fw);
 	return err;
 }
 
@@ -321,6 +336,54 @@ static inline void p54spi_sleep(struct p54s_priv *priv)
 		       cpu_to_le32(SPI_TARGET_INT_SLEEP));
 }
 
+/*
+ * The wakeup handshake costs several SPI transactions. Once awake, the
+ * chip is kept awake for p54spi_sleep_delay msecs after the last
+ * transfer, so back to back frames share a single wakeup.
+ * Must be called with mutex held.
+ */
+static int p54spi_wake(struct p54s_priv *priv)
+{
+	if (priv->awake)
+		return 0;
+
+	if (p54spi_wakeup(priv) < 0)
+		return -EBUSY;
+
+	priv->awake = true;
+	return 0;
+}
+
+/* Must be called with mutex held */
+static void p54spi_idle(struct p54s_priv *priv)
+{
+	if (!priv->awake)
+		return;
+
+	cancel_delayed_work(&priv->sleep_work);
+	if (!p54spi_sleep_delay) {
+		p54spi_sleep(priv);
+		priv->awake = false;
+		return;
+	}
+
+	ieee80211_queue_delayed_work(priv->hw, &priv->sleep_work,
+				     msecs_to_jiffies(p54spi_sleep_delay));
+}
+
+static void p54spi_sleep_work(struct work_struct *work)
+{
+	struct p54s_priv *priv = container_of(work, struct p54s_priv,
+					      sleep_work.work);
+
+	mutex_lock(&priv->mutex);
+	if (priv->awake && priv->fw_state == FW_STATE_READY) {
+		p54spi_sleep(priv);
+		priv->awake = false;
+	}
+	mutex_unlock(&priv->mutex);
+}
+
 static void p54spi_int_ready(struct p54s_priv *priv)
 {
 	p54spi_write32(priv, SPI_ADRS_HOST_INT_EN, cpu_to_le32(
@@ -340,25 +403,66 @@ static void p54spi_int_ready(struct p54s_priv *priv)
 	}
 }
 
+/*
+ * The rx path takes its buffers from a small pool of rx_mtu sized skbs,
+ * so that nothing has to be allocated while the chip is kept awake.
+ * Buffers which p54_rx() doesn't keep go right back to the pool.
+ */
+static void p54spi_rx_pool_fill(struct p54s_priv *priv, gfp_t gfp)
+{
+	struct sk_buff *skb;
+
+	while (skb_queue_len(&priv->rx_pool) < P54SPI_RX_POOL_SIZE) {
+		skb = __dev_alloc_skb(priv->rx_skb_size, gfp);
+		if (!skb)
+			break;
+		__skb_queue_tail(&priv->rx_pool, skb);
+	}
+}
+
+static void p54spi_rx_recycle(struct p54s_priv *priv, struct sk_buff *skb)
+{
+	if (skb_queue_len(&priv->rx_pool) < P54SPI_RX_POOL_SIZE &&
+	    skb_recycle_check(skb, priv->rx_skb_size))
+		__skb_queue_tail(&priv->rx_pool, skb);
+	else
+		dev_kfree_skb(skb);
+}
+
 static int p54spi_rx(struct p54s_priv *priv)
 {
 	struct sk_buff *skb;
 	u16 len;
-	u16 rx_head[2];
-#define READAHEAD_SZ (sizeof(rx_head)-sizeof(u16))
+#define RX_HEAD_SZ (2 * sizeof(u16))
+#define READAHEAD_SZ (RX_HEAD_SZ - sizeof(u16))
 
-	if (p54spi_wakeup(priv) < 0)
+	skb = __skb_dequeue(&priv->rx_pool);
+	if (!skb) {
+		skb = dev_alloc_skb(priv->rx_skb_size);
+		if (!skb) {
+			dev_err(&priv->spi->dev, "could not alloc skb");
+			return -ENOMEM;
+		}
+	}
+
+	/* The data follows the 16 bit length word, keep it aligned */
+	skb_reserve(skb, 2);
+
+	if (p54spi_wake(priv) < 0) {
+		p54spi_rx_recycle(priv, skb);
 		return -EBUSY;
+	}
 
 	/* Read data size and first data word in one SPI transaction
 	 * This is workaround for firmware/DMA bug,
 	 * when first data word gets lost under high load.
+	 * Both reads go straight into the skb.
 	 */
-	p54spi_spi_read(priv, SPI_ADRS_DMA_DATA, rx_head, sizeof(rx_head));
-	len = rx_head[0];
+	p54spi_spi_read(priv, SPI_ADRS_DMA_DATA, skb->data, RX_HEAD_SZ);
+	len = *(u16 *)skb->data;
 
 	if (len == 0) {
-		p54spi_sleep(priv);
+		p54spi_rx_recycle(priv, skb);
 		dev_err(&priv->spi->dev, "rx request of zero bytes\n");
 		return 0;
 	}
@@ -367,28 +471,32 @@ static int p54spi_rx(struct p54s_priv *priv)
 	 * but it does not amend the size of SPI data transfer.
 	 * Such packets has correct data size in header, thus referencing
 	 * past the end of allocated skb. Reserve extra 4 bytes for this case */
-	skb = dev_alloc_skb(len + 4);
-	if (!skb) {
-		p54spi_sleep(priv);
-		dev_err(&priv->spi->dev, "could not alloc skb");
-		return -ENOMEM;
+	if (skb_tailroom(skb) < sizeof(u16) + len + 4) {
+		struct sk_buff *big = dev_alloc_skb(len + 4 + 2);
+
+		if (!big) {
+			p54spi_rx_recycle(priv, skb);
+			dev_err(&priv->spi->dev, "could not alloc skb");
+			return -ENOMEM;
+		}
+		skb_reserve(big, 2);
+		memcpy(big->data, skb->data, RX_HEAD_SZ);
+		p54spi_rx_recycle(priv, skb);
+		skb = big;
 	}
 
-	if (len <= READAHEAD_SZ) {
-		memcpy(skb_put(skb, len), rx_head + 1, len);
-	} else {
-		memcpy(skb_put(skb, READAHEAD_SZ), rx_head + 1, READAHEAD_SZ);
+	if (len > READAHEAD_SZ)
 		p54spi_spi_read(priv, SPI_ADRS_DMA_DATA,
-				skb_put(skb, len - READAHEAD_SZ),
-				len - READAHEAD_SZ);
-	}
-	p54spi_sleep(priv);
+				skb->data + RX_HEAD_SZ, len - READAHEAD_SZ);
+
+	skb_put(skb, sizeof(u16) + len);
+	skb_pull(skb, sizeof(u16));
 	/* Put additional bytes to compensate for the possible
 	 * alignment-caused truncation */
 	skb_put(skb, 4);
 
 	if (p54_rx(priv->hw, skb) == 0)
-		dev_kfree_skb(skb);
+		p54spi_rx_recycle(priv, skb);
 
 	return 0;
 }
@@ -409,26 +517,23 @@ static int p54spi_tx_frame(struct p54s_priv *priv, struct sk_buff *skb)
 	struct p54_hdr *hdr = (struct p54_hdr *) skb->data;
 	int ret = 0;
 
-	if (p54spi_wakeup(priv) < 0)
+	if (p54spi_wake(priv) < 0)
 		return -EBUSY;
 
 	ret = p54spi_spi_write_dma(priv, hdr->req_id, skb->data, skb->len);
 	if (ret < 0)
-		goto out;
+		return ret;
 
 	if (!p54spi_wait_bit(priv, SPI_ADRS_HOST_INTERRUPTS,
 			     SPI_HOST_INT_WR_READY)) {
 		dev_err(&priv->spi->dev, "WR_READY timeout\n");
-		ret = -EAGAIN;
-		goto out;
+		return -EAGAIN;
 	}
 
 	p54spi_int_ack(priv, SPI_HOST_INT_WR_READY);
 
 	if (FREE_AFTER_TX(skb))
 		p54_free_skb(priv->hw, skb);
-out:
-	p54spi_sleep(priv);
 	return ret;
 }
 
@@ -493,7 +598,7 @@ static void p54spi_op_tx(struct ieee80211_hw *dev, struct sk_buff *skb)
 static void p54spi_work(struct work_struct *work)
 {
 	struct p54s_priv *priv = container_of(work, struct p54s_priv, work);
-	u32 ints;
+	u32 ints, rx_ints;
 	int ret;
 
 	mutex_lock(&priv->mutex);
@@ -511,20 +616,28 @@ static void p54spi_work(struct work_struct *work)
 	if (priv->fw_state != FW_STATE_READY)
 		goto out;
 
-	if (ints & SPI_HOST_INT_UPDATE) {
-		p54spi_int_ack(priv, SPI_HOST_INT_UPDATE);
+	/* Ack all pending rx interrupts with one write */
+	rx_ints = ints & (SPI_HOST_INT_UPDATE | SPI_HOST_INT_SW_UPDATE);
+	if (rx_ints)
+		p54spi_int_ack(priv, rx_ints);
+
+	if (rx_ints & SPI_HOST_INT_UPDATE) {
 		ret = p54spi_rx(priv);
 		if (ret < 0)
-			goto out;
+			goto idle;
 	}
-	if (ints & SPI_HOST_INT_SW_UPDATE) {
-		p54spi_int_ack(priv, SPI_HOST_INT_SW_UPDATE);
+	if (rx_ints & SPI_HOST_INT_SW_UPDATE) {
 		ret = p54spi_rx(priv);
 		if (ret < 0)
-			goto out;
+			goto idle;
 	}
 
 	ret = p54spi_wq_tx(priv);
+idle:
+	p54spi_idle(priv);
+
+	/* Replace the rx buffers the stack kept */
+	p54spi_rx_pool_fill(priv, GFP_KERNEL);
 out:
 	mutex_unlock(&priv->mutex);
 }
@@ -541,6 +654,11 @@ static int p54spi_op_start(struct ieee80211_hw *dev)
 	}
 
 	priv->fw_state = FW_STATE_BOOTING;
+	priv->awake = false;
+
+	/* Room for the frame, the padding and the length word */
+	priv->rx_skb_size = priv->common.rx_mtu + 4 + 2;
+	p54spi_rx_pool_fill(priv, GFP_KERNEL);
 
 	p54spi_power_on(priv);
 
@@ -596,8 +714,13 @@ static void p54spi_op_stop(struct ieee80211_hw *dev)
 	INIT_LIST_HEAD(&priv->tx_pending);
 	spin_unlock_irqrestore(&priv->tx_lock, flags);
 
+	__skb_queue_purge(&priv->rx_pool);
+
 	priv->fw_state = FW_STATE_OFF;
+	priv->awake = false;
 	mutex_unlock(&priv->mutex);
+
+	cancel_delayed_work_sync(&priv->sleep_work);
 }
 
 static int __devinit p54spi_probe(struct spi_device *spi)
@@ -655,10 +778,13 @@ static int __devinit p54spi_probe(struct spi_device *spi)
 	disable_irq(gpio_to_irq(p54spi_gpio_irq));
 
 	INIT_WORK(&priv->work, p54spi_work);
+	INIT_DELAYED_WORK(&priv->sleep_work, p54spi_sleep_work);
 	init_completion(&priv->fw_comp);
 	INIT_LIST_HEAD(&priv->tx_pending);
+	__skb_queue_head_init(&priv->rx_pool);
 	mutex_init(&priv->mutex);
 	SET_IEEE80211_DEV(hw, &spi->dev);
+	priv->common.rx_direct = true;
 	priv->common.open = p54spi_op_start;
 	priv->common.stop = p54spi_op_stop;
 	priv->common.tx = p54spi_op_tx;
@@ -678,6 +804,7 @@ static int __devinit p54spi_probe(struct spi_device *spi)
 	return 0;
 
 err_free_common:
+	kfree(priv->fw_image);
 	p54_free_common(priv->hw);
 	return ret;
 }
@@ -692,7 +819,8 @@ static int __devexit p54spi_remove(struct spi_device *spi)
 
 	gpio_free(p54spi_gpio_power);
 	gpio_free(p54spi_gpio_irq);
-	release_firmware(priv->firmware);
+	kfree(priv->fw_image);
+	__skb_queue_purge(&priv->rx_pool);
 
 	mutex_destroy(&priv->mutex);
 
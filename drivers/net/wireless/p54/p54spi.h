@@ -92,6 +92,9 @@
 
 #define TARGET_BOOT_SLEEP 50
 
+/* Receive buffers kept ready for the rx path */
+#define P54SPI_RX_POOL_SIZE 4
+
 struct p54s_dma_regs {
 	__le16 cmd;
 	__le16 len;
@@ -109,6 +112,7 @@ struct p54s_priv {
 	struct spi_device *spi;
 
 	struct work_struct work;
+	struct delayed_work sleep_work;
 
 	struct mutex mutex;
 	struct completion fw_comp;
@@ -119,7 +123,14 @@ struct p54s_priv {
 	struct list_head tx_pending;
 
 	enum fw_state fw_state;
-	const struct firmware *firmware;
+	/* DMA-able copy of the firmware image, uploaded on each start */
+	u8 *fw_image;
+	size_t fw_len;
+
+	/* protected by mutex */
+	struct sk_buff_head rx_pool;
+	unsigned int rx_skb_size;
+	bool awake;
 };
 
 #endif /* P54SPI_H */
@@ -17,6 +17,7 @@
  */
 
 #include <linux/init.h>
+#include <linux/bitmap.h>
 #include <linux/firmware.h>
 #include <linux/etherdevice.h>
 
@@ -34,37 +35,41 @@ static void p54_dump_tx_queue(struct p54_common *priv)
 	struct sk_buff *skb;
 	struct p54_hdr *hdr;
 	unsigned int i = 0;
-	u32 prev_addr;
-	u32 largest_hole = 0, free;
+	unsigned int bit, next, largest_hole = 0, free;
 
 	spin_lock_irqsave(&priv->tx_queue.lock, flags);
 	wiphy_debug(priv->hw->wiphy, "/ --- tx queue dump (%d entries) ---\n",
 		    skb_queue_len(&priv->tx_queue));
 
-	prev_addr = priv->rx_start;
 	skb_queue_walk(&priv->tx_queue, skb) {
 		info = IEEE80211_SKB_CB(skb);
 		range = (void *) info->rate_driver_data;
 		hdr = (void *) skb->data;
 
-		free = range->start_addr - prev_addr;
 		wiphy_debug(priv->hw->wiphy,
 			    "| [%02d] => [skb:%p skb_len:0x%04x "
 			    "hdr:{flags:%02x len:%04x req_id:%04x type:%02x} "
-			    "mem:{start:%04x end:%04x, free:%d}]\n",
+			    "mem:{start:%04x end:%04x}]\n",
 			    i++, skb, skb->len,
 			    le16_to_cpu(hdr->flags), le16_to_cpu(hdr->len),
 			    le32_to_cpu(hdr->req_id), le16_to_cpu(hdr->type),
-			    range->start_addr, range->end_addr, free);
+			    range->start_addr, range->end_addr);
+	}
 
-		prev_addr = range->end_addr;
-		largest_hole = max(largest_hole, free);
+	free = priv->tx_mem_blocks -
+	       bitmap_weight(priv->tx_mem_map, priv->tx_mem_blocks);
+	bit = find_first_zero_bit(priv->tx_mem_map, priv->tx_mem_blocks);
+	while (bit < priv->tx_mem_blocks) {
+		next = find_next_bit(priv->tx_mem_map, priv->tx_mem_blocks,
+				     bit);
+		largest_hole = max(largest_hole, next - bit);
+		bit = find_next_zero_bit(priv->tx_mem_map,
+					 priv->tx_mem_blocks, next);
 	}
-	free = priv->rx_end - prev_addr;
-	largest_hole = max(largest_hole, free);
 	wiphy_debug(priv->hw->wiphy,
 		    "\\ --- [free: %d], largest free block: %d ---\n",
-		    free, largest_hole);
+		    free << P54_MEM_BLOCK_SHIFT,
+		    largest_hole << P54_MEM_BLOCK_SHIFT);
 	spin_unlock_irqrestore(&priv->tx_queue.lock, flags);
 }
 #endif /* P54_MM_DEBUG */
@@ -77,16 +82,19 @@ static void p54_dump_tx_queue(struct p54_common *priv)
  * it is done with it. This function finds empty places we can upload to and
  * marks allocated areas as reserved if necessary. p54_find_and_unlink_skb or
  * p54_free_skb frees allocated areas.
+ *
+ * The window is tracked by a bitmap of P54_MEM_BLOCK sized blocks, so an
+ * allocation no longer depends on the tx_queue being sorted by address.
  */
 static int p54_assign_address(struct p54_common *priv, struct sk_buff *skb)
 {
-	struct sk_buff *entry, *target_skb = NULL;
 	struct ieee80211_tx_info *info;
 	struct p54_tx_info *range;
 	struct p54_hdr *data = (void *) skb->data;
 	unsigned long flags;
-	u32 last_addr = priv->rx_start;
-	u32 target_addr = priv->rx_start;
+	unsigned long block;
+	unsigned int nr;
+	u32 target_addr;
 	u16 len = priv->headroom + skb->len + priv->tailroom + 3;
 
 	info = IEEE80211_SKB_CB(skb);
@@ -104,36 +112,16 @@ static int p54_assign_address(struct p54_common *priv, struct sk_buff *skb)
 		return -EBUSY;
 	}
 
-	skb_queue_walk(&priv->tx_queue, entry) {
-		u32 hole_size;
-		info = IEEE80211_SKB_CB(entry);
-		range = (void *) info->rate_driver_data;
-		hole_size = range->start_addr - last_addr;
-
-		if (!target_skb && hole_size >= len) {
-			target_skb = entry->prev;
-			hole_size -= len;
-			target_addr = last_addr;
-			break;
-		}
-		last_addr = range->end_addr;
-	}
-	if (unlikely(!target_skb)) {
-		if (priv->rx_end - last_addr >= len) {
-			target_skb = priv->tx_queue.prev;
-			if (!skb_queue_empty(&priv->tx_queue)) {
-				info = IEEE80211_SKB_CB(target_skb);
-				range = (void *)info->rate_driver_data;
-				target_addr = range->end_addr;
-			}
-		} else {
-			spin_unlock_irqrestore(&priv->tx_queue.lock, flags);
-			return -ENOSPC;
-		}
+	nr = DIV_ROUND_UP(len, P54_MEM_BLOCK);
+	block = bitmap_find_next_zero_area(priv->tx_mem_map,
+					   priv->tx_mem_blocks, 0, nr, 0);
+	if (unlikely(block >= priv->tx_mem_blocks)) {
+		spin_unlock_irqrestore(&priv->tx_queue.lock, flags);
+		return -ENOSPC;
 	}
+	bitmap_set(priv->tx_mem_map, block, nr);
 
-	info = IEEE80211_SKB_CB(skb);
-	range = (void *) info->rate_driver_data;
+	target_addr = priv->rx_start + (block << P54_MEM_BLOCK_SHIFT);
 	range->start_addr = target_addr;
 	range->end_addr = target_addr + len;
 	data->req_id = cpu_to_le32(target_addr + priv->headroom);
@@ -141,11 +129,24 @@ static int p54_assign_address(struct p54_common *priv, struct sk_buff *skb)
 	    unlikely(GET_HW_QUEUE(skb) == P54_QUEUE_BEACON))
 		priv->beacon_req_id = data->req_id;
 
-	__skb_queue_after(&priv->tx_queue, target_skb, skb);
+	__skb_queue_tail(&priv->tx_queue, skb);
 	spin_unlock_irqrestore(&priv->tx_queue.lock, flags);
 	return 0;
 }
 
+/* must be called with the tx_queue.lock held */
+static void p54_release_address(struct p54_common *priv, struct sk_buff *skb)
+{
+	struct ieee80211_tx_info *info = IEEE80211_SKB_CB(skb);
+	struct p54_tx_info *range = (void *) info->rate_driver_data;
+	unsigned int block;
+
+	block = (range->start_addr - priv->rx_start) >> P54_MEM_BLOCK_SHIFT;
+	bitmap_clear(priv->tx_mem_map, block,
+		     DIV_ROUND_UP(range->end_addr - range->start_addr,
+				  P54_MEM_BLOCK));
+}
+
 static void p54_tx_pending(struct p54_common *priv)
 {
 	struct sk_buff *skb;
@@ -235,10 +236,15 @@ static void p54_tx_qos_accounting_free(struct p54_common *priv,
 void p54_free_skb(struct ieee80211_hw *dev, struct sk_buff *skb)
 {
 	struct p54_common *priv = dev->priv;
+	unsigned long flags;
+
 	if (unlikely(!skb))
 		return ;
 
-	skb_unlink(skb, &priv->tx_queue);
+	spin_lock_irqsave(&priv->tx_queue.lock, flags);
+	__skb_unlink(skb, &priv->tx_queue);
+	p54_release_address(priv, skb);
+	spin_unlock_irqrestore(&priv->tx_queue.lock, flags);
 	p54_tx_qos_accounting_free(priv, skb);
 	dev_kfree_skb_any(skb);
 }
@@ -256,6 +262,7 @@ static struct sk_buff *p54_find_and_unlink_skb(struct p54_common *priv,
 
 		if (hdr->req_id == req_id) {
 			__skb_unlink(entry, &priv->tx_queue);
+			p54_release_address(priv, entry);
 			spin_unlock_irqrestore(&priv->tx_queue.lock, flags);
 			p54_tx_qos_accounting_free(priv, entry);
 			return entry;
@@ -379,7 +386,10 @@ static int p54_rx_data(struct p54_common *priv, struct sk_buff *skb)
 	if (unlikely(priv->hw->conf.flags & IEEE80211_CONF_PS))
 		p54_pspoll_workaround(priv, skb);
 
-	ieee80211_rx_irqsafe(priv->hw, skb);
+	if (priv->rx_direct)
+		ieee80211_rx_ni(priv->hw, skb);
+	else
+		ieee80211_rx_irqsafe(priv->hw, skb);
 
 	ieee80211_queue_delayed_work(priv->hw, &priv->work,
 			   msecs_to_jiffies(P54_STATISTICS_UPDATE));
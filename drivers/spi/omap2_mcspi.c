@@ -33,6 +33,7 @@
 #include <linux/clk.h>
 #include <linux/io.h>
 #include <linux/slab.h>
+#include <linux/ktime.h>
 
 #include <linux/spi/spi.h>
 
@@ -115,6 +116,18 @@ struct omap2_mcspi_dma {
  */
 #define DMA_MIN_BYTES			160
 
+static unsigned dma_min_bytes = DMA_MIN_BYTES;
+module_param(dma_min_bytes, uint, 0444);
+MODULE_PARM_DESC(dma_min_bytes, "Smallest transfer done with DMA");
+
+/* Per chip select traffic accounting, in the "stats" sysfs file */
+struct omap2_mcspi_stats {
+	unsigned long	messages;
+	unsigned long	pio_xfers;
+	unsigned long	dma_xfers;
+	u64		bytes;
+	u64		time_ns;	/* spent with the message active */
+};
 
 struct omap2_mcspi {
 	struct work_struct	work;
@@ -129,6 +142,7 @@ struct omap2_mcspi {
 	unsigned long		phys;
 	/* SPI1 has 4 channels, while SPI2 has 2 */
 	struct omap2_mcspi_dma	*dma_channels;
+	struct omap2_mcspi_stats *stats;
 };
 
 struct omap2_mcspi_cs {
@@ -395,6 +409,11 @@ omap2_mcspi_txrx_dma(struct spi_device *spi, struct spi_transfer *xfer)
 		omap2_mcspi_set_dma_req(spi, 1, 1);
 	}
 
+	/* In full duplex mode the RX channel finishes last, wait for it
+	 * first so that the TX wait normally doesn't have to sleep. */
+	if (rx != NULL && tx != NULL)
+		wait_for_completion(&mcspi_dma->dma_rx_completion);
+
 	if (tx != NULL) {
 		wait_for_completion(&mcspi_dma->dma_tx_completion);
 		dma_unmap_single(&spi->dev, xfer->tx_dma, count, DMA_TO_DEVICE);
@@ -411,7 +430,8 @@ omap2_mcspi_txrx_dma(struct spi_device *spi, struct spi_transfer *xfer)
 	}
 
 	if (rx != NULL) {
-		wait_for_completion(&mcspi_dma->dma_rx_completion);
+		if (tx == NULL)
+			wait_for_completion(&mcspi_dma->dma_rx_completion);
 		dma_unmap_single(&spi->dev, xfer->rx_dma, count, DMA_FROM_DEVICE);
 		omap2_mcspi_set_enable(spi, 0);
 
@@ -884,6 +904,8 @@ static void omap2_mcspi_work(struct work_struct *work)
 		int				par_override = 0;
 		int				status = 0;
 		u32				chconf;
+		struct omap2_mcspi_stats	*stats;
+		ktime_t				start;
 
 		m = container_of(mcspi->msg_queue.next, struct spi_message,
 				 queue);
@@ -894,6 +916,8 @@ static void omap2_mcspi_work(struct work_struct *work)
 		spi = m->spi;
 		cs = spi->controller_state;
 		cd = spi->controller_data;
+		stats = &mcspi->stats[spi->chip_select];
+		start = ktime_get();
 
 		omap2_mcspi_set_enable(spi, 1);
 		list_for_each_entry(t, &m->transfers, transfer_list) {
@@ -940,11 +964,15 @@ static void omap2_mcspi_work(struct work_struct *work)
 					__raw_writel(0, cs->base
 							+ OMAP2_MCSPI_TX0);
 
-				if (m->is_dma_mapped || t->len >= DMA_MIN_BYTES)
+				if (m->is_dma_mapped || t->len >= dma_min_bytes) {
 					count = omap2_mcspi_txrx_dma(spi, t);
-				else
+					stats->dma_xfers++;
+				} else {
 					count = omap2_mcspi_txrx_pio(spi, t);
+					stats->pio_xfers++;
+				}
 				m->actual_length += count;
+				stats->bytes += count;
 
 				if (count != t->len) {
 					status = -EIO;
@@ -973,6 +1001,9 @@ static void omap2_mcspi_work(struct work_struct *work)
 
 		omap2_mcspi_set_enable(spi, 0);
 
+		stats->messages++;
+		stats->time_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+
 		m->status = status;
 		m->complete(m->context);
 
@@ -1022,7 +1053,7 @@ static int omap2_mcspi_transfer(struct spi_device *spi, struct spi_message *m)
 			return -EINVAL;
 		}
 
-		if (m->is_dma_mapped || len < DMA_MIN_BYTES)
+		if (m->is_dma_mapped || len < dma_min_bytes)
 			continue;
 
 		if (tx_buf != NULL) {
@@ -1058,6 +1089,32 @@ static int omap2_mcspi_transfer(struct spi_device *spi, struct spi_message *m)
 	return 0;
 }
 
+static ssize_t omap2_mcspi_stats_show(struct device *dev,
+				      struct device_attribute *attr,
+				      char *buf)
+{
+	struct spi_master *master = dev_get_drvdata(dev);
+	struct omap2_mcspi *mcspi = spi_master_get_devdata(master);
+	ssize_t len = 0;
+	int i;
+
+	len += snprintf(buf + len, PAGE_SIZE - len,
+			"cs messages pio dma bytes time_us\n");
+	for (i = 0; i < master->num_chipselect; i++) {
+		struct omap2_mcspi_stats *s = &mcspi->stats[i];
+
+		len += snprintf(buf + len, PAGE_SIZE - len,
+				"%d %lu %lu %lu %llu %llu\n", i,
+				s->messages, s->pio_xfers, s->dma_xfers,
+				(unsigned long long)s->bytes,
+				(unsigned long long)div_u64(s->time_ns, 1000));
+	}
+
+	return len;
+}
+
+static DEVICE_ATTR(stats, S_IRUGO, omap2_mcspi_stats_show, NULL);
+
 static int __init omap2_mcspi_reset(struct omap2_mcspi *mcspi)
 {
 	struct spi_master	*master = mcspi->master;
@@ -1240,6 +1297,14 @@ static int __init omap2_mcspi_probe(struct platform_device *pdev)
 	if (mcspi->dma_channels == NULL)
 		goto err3;
 
+	mcspi->stats = kcalloc(master->num_chipselect,
+			sizeof(struct omap2_mcspi_stats),
+			GFP_KERNEL);
+	if (mcspi->stats == NULL) {
+		status = -ENOMEM;
+		goto err4;
+	}
+
 	for (i = 0; i < num_chipselect; i++) {
 		mcspi->dma_channels[i].dma_rx_channel = -1;
 		mcspi->dma_channels[i].dma_rx_sync_dev = rxdma_id[i];
@@ -1254,9 +1319,13 @@ static int __init omap2_mcspi_probe(struct platform_device *pdev)
 	if (status < 0)
 		goto err4;
 
+	if (device_create_file(&pdev->dev, &dev_attr_stats) < 0)
+		dev_warn(&pdev->dev, "can't create sysfs file for stats\n");
+
 	return status;
 
 err4:
+	kfree(mcspi->stats);
 	kfree(mcspi->dma_channels);
 err3:
 	clk_put(mcspi->fck);
@@ -1276,12 +1345,14 @@ static int __exit omap2_mcspi_remove(struct platform_device *pdev)
 	struct spi_master	*master;
 	struct omap2_mcspi	*mcspi;
 	struct omap2_mcspi_dma	*dma_channels;
+	struct omap2_mcspi_stats *stats;
 	struct resource		*r;
 	void __iomem *base;
 
 	master = dev_get_drvdata(&pdev->dev);
 	mcspi = spi_master_get_devdata(master);
 	dma_channels = mcspi->dma_channels;
+	stats = mcspi->stats;
 
 	clk_put(mcspi->fck);
 	clk_put(mcspi->ick);
@@ -1289,10 +1360,13 @@ static int __exit omap2_mcspi_remove(struct platform_device *pdev)
 	r = platform_get_resource(pdev, IORESOURCE_MEM, 0);
 	release_mem_region(r->start, (r->end - r->start) + 1);
 
+	device_remove_file(&pdev->dev, &dev_attr_stats);
+
 	base = mcspi->base;
 	spi_unregister_master(master);
 	iounmap(base);
 	kfree(dma_channels);
+	kfree(stats);
 
 	return 0;
 }
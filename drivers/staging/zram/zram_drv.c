@@ -19,6 +19,7 @@
 #include <linux/kernel.h>
 #include <linux/bio.h>
 #include <linux/bitops.h>
+#include <linux/bit_spinlock.h>
 #include <linux/blkdev.h>
 #include <linux/buffer_head.h>
 #include <linux/device.h>
@@ -28,6 +29,7 @@
 #include <linux/lzo.h>
 #include <linux/string.h>
 #include <linux/vmalloc.h>
+#include <linux/percpu.h>
 
 #include "zram_drv.h"
 
@@ -38,28 +40,39 @@ struct zram *devices;
 /* Module params (documentation at end) */
 unsigned int num_devices;
 
-static void zram_stat_inc(u32 *v)
+static void zram_stat_inc(struct zram *zram, u32 *v)
 {
+	spin_lock(&zram->stat_lock);
 	*v = *v + 1;
+	spin_unlock(&zram->stat_lock);
 }
 
-static void zram_stat_dec(u32 *v)
+static void zram_stat_dec(struct zram *zram, u32 *v)
 {
+	spin_lock(&zram->stat_lock);
 	*v = *v - 1;
+	spin_unlock(&zram->stat_lock);
+}
+
+static int zram_hist_bucket(size_t clen)
+{
+	int bucket = (clen - 1) / (PAGE_SIZE / ZRAM_HIST_BUCKETS);
+
+	return min(bucket, ZRAM_HIST_BUCKETS - 1);
 }
 
 static void zram_stat64_add(struct zram *zram, u64 *v, u64 inc)
 {
-	spin_lock(&zram->stat64_lock);
+	spin_lock(&zram->stat_lock);
 	*v = *v + inc;
-	spin_unlock(&zram->stat64_lock);
+	spin_unlock(&zram->stat_lock);
 }
 
 static void zram_stat64_sub(struct zram *zram, u64 *v, u64 dec)
 {
-	spin_lock(&zram->stat64_lock);
+	spin_lock(&zram->stat_lock);
 	*v = *v - dec;
-	spin_unlock(&zram->stat64_lock);
+	spin_unlock(&zram->stat_lock);
 }
 
 static void zram_stat64_inc(struct zram *zram, u64 *v)
@@ -67,36 +80,69 @@ static void zram_stat64_inc(struct zram *zram, u64 *v)
 	zram_stat64_add(zram, v, 1);
 }
 
+/*
+ * Table entries may be changed by writes, swap slot free notifications
+ * and writeback at the same time. Everything below is done with the
+ * entry locked.
+ */
+static void zram_slot_lock(struct zram *zram, u32 index)
+{
+	bit_spin_lock(ZRAM_LOCK, &zram->table[index].value);
+}
+
+static void zram_slot_unlock(struct zram *zram, u32 index)
+{
+	bit_spin_unlock(ZRAM_LOCK, &zram->table[index].value);
+}
+
 static int zram_test_flag(struct zram *zram, u32 index,
 			enum zram_pageflags flag)
 {
-	return zram->table[index].flags & BIT(flag);
+	return zram->table[index].value & BIT(flag);
 }
 
 static void zram_set_flag(struct zram *zram, u32 index,
 			enum zram_pageflags flag)
 {
-	zram->table[index].flags |= BIT(flag);
+	zram->table[index].value |= BIT(flag);
 }
 
 static void zram_clear_flag(struct zram *zram, u32 index,
 			enum zram_pageflags flag)
 {
-	zram->table[index].flags &= ~BIT(flag);
+	zram->table[index].value &= ~BIT(flag);
+}
+
+static size_t zram_get_obj_size(struct zram *zram, u32 index)
+{
+	return zram->table[index].value & (BIT(ZRAM_FLAG_SHIFT) - 1);
 }
 
-static int page_zero_filled(void *ptr)
+static void zram_set_obj_size(struct zram *zram, u32 index, size_t size)
+{
+	unsigned long flags = zram->table[index].value >> ZRAM_FLAG_SHIFT;
+
+	zram->table[index].value = (flags << ZRAM_FLAG_SHIFT) | size;
+}
+
+/*
+ * Check whether the page consists of one repeated word, as zero pages and
+ * freshly initialised buffers often do. Such pages are stored as just the
+ * word, without allocating any memory.
+ */
+static int page_same_filled(void *ptr, unsigned long *element)
 {
 	unsigned int pos;
 	unsigned long *page;
 
 	page = (unsigned long *)ptr;
 
-	for (pos = 0; pos != PAGE_SIZE / sizeof(*page); pos++) {
-		if (page[pos])
+	for (pos = 1; pos != PAGE_SIZE / sizeof(*page); pos++) {
+		if (page[pos] != page[0])
 			return 0;
 	}
 
+	*element = page[0];
 	return 1;
 }
 
@@ -129,56 +175,182 @@ static void zram_set_disksize(struct zram *zram, size_t totalram_bytes)
 	zram->disksize &= PAGE_MASK;
 }
 
+#ifdef CONFIG_ZRAM_WRITEBACK
+/* Block 0 is never handed out, so that it can mean "no block" */
+static unsigned long alloc_block_bdev(struct zram *zram)
+{
+	unsigned long blk;
+
+	do {
+		blk = find_next_zero_bit(zram->bitmap, zram->nr_pages, 1);
+		if (blk >= zram->nr_pages)
+			return 0;
+	} while (test_and_set_bit(blk, zram->bitmap));
+
+	zram_stat_inc(zram, &zram->stats.bd_count);
+	return blk;
+}
+
+static void free_block_bdev(struct zram *zram, unsigned long blk)
+{
+	WARN_ON(!test_and_clear_bit(blk, zram->bitmap));
+	zram_stat_dec(zram, &zram->stats.bd_count);
+}
+
+struct zram_bdev_io {
+	struct completion done;
+	int error;
+};
+
+static void zram_bdev_end_io(struct bio *bio, int err)
+{
+	struct zram_bdev_io *io = bio->bi_private;
+
+	if (!err && !test_bit(BIO_UPTODATE, &bio->bi_flags))
+		err = -EIO;
+	io->error = err;
+	complete(&io->done);
+}
+
+/* Synchronously transfer one page to or from the backing device */
+static int zram_bdev_rw(struct zram *zram, int rw, struct page *page,
+			unsigned long blk)
+{
+	struct bio *bio;
+	struct zram_bdev_io io;
+
+	bio = bio_alloc(GFP_NOIO, 1);
+	if (!bio)
+		return -ENOMEM;
+
+	bio->bi_sector = blk << SECTORS_PER_PAGE_SHIFT;
+	bio->bi_bdev = zram->bdev;
+	if (!bio_add_page(bio, page, PAGE_SIZE, 0)) {
+		bio_put(bio);
+		return -EIO;
+	}
+
+	init_completion(&io.done);
+	io.error = 0;
+	bio->bi_private = &io;
+	bio->bi_end_io = zram_bdev_end_io;
+
+	submit_bio(rw == WRITE ? WRITE_SYNC : READ_SYNC, bio);
+	wait_for_completion(&io.done);
+	bio_put(bio);
+
+	return io.error;
+}
+
+struct zram_bdev_work {
+	struct work_struct work;
+	struct zram *zram;
+	struct page *page;
+	unsigned long blk;
+	int error;
+};
+
+static void zram_bdev_read_work(struct work_struct *work)
+{
+	struct zram_bdev_work *zw =
+		container_of(work, struct zram_bdev_work, work);
+
+	zw->error = zram_bdev_rw(zw->zram, READ, zw->page, zw->blk);
+}
+
+/*
+ * Bios submitted from within zram_make_request() are only issued after
+ * it returns, so waiting for one there would never finish. Have a worker
+ * do the read instead.
+ */
+static int read_from_bdev(struct zram *zram, struct page *page,
+			unsigned long blk)
+{
+	struct zram_bdev_work zw;
+
+	zw.zram = zram;
+	zw.page = page;
+	zw.blk = blk;
+
+	INIT_WORK_ONSTACK(&zw.work, zram_bdev_read_work);
+	schedule_work(&zw.work);
+	flush_work(&zw.work);
+	destroy_work_on_stack(&zw.work);
+
+	if (!zw.error)
+		zram_stat64_inc(zram, &zram->stats.bd_reads);
+
+	return zw.error;
+}
+#endif
+
+/* Called with the slot locked */
 static void zram_free_page(struct zram *zram, size_t index)
 {
 	u32 clen;
-	void *obj;
+	unsigned long handle = zram->table[index].handle;
+
+	/* Rewritten or freed: not idle, and any writeback is moot */
+	zram_clear_flag(zram, index, ZRAM_IDLE);
+	zram_clear_flag(zram, index, ZRAM_UNDER_WB);
 
-	struct page *page = zram->table[index].page;
-	u32 offset = zram->table[index].offset;
+#ifdef CONFIG_ZRAM_WRITEBACK
+	if (zram_test_flag(zram, index, ZRAM_WB)) {
+		zram_clear_flag(zram, index, ZRAM_WB);
+		free_block_bdev(zram, zram->table[index].element);
+		zram->table[index].element = 0;
+		return;
+	}
+#endif
 
-	if (unlikely(!page)) {
+	if (zram_test_flag(zram, index, ZRAM_SAME)) {
+		zram_clear_flag(zram, index, ZRAM_SAME);
+		zram_stat_dec(zram, &zram->stats.pages_same);
+		zram->table[index].element = 0;
+		return;
+	}
+
+	if (unlikely(!handle)) {
 		/*
 		 * No memory is allocated for zero filled pages.
 		 * Simply clear zero page flag.
 		 */
 		if (zram_test_flag(zram, index, ZRAM_ZERO)) {
 			zram_clear_flag(zram, index, ZRAM_ZERO);
-			zram_stat_dec(&zram->stats.pages_zero);
+			zram_stat_dec(zram, &zram->stats.pages_zero);
 		}
 		return;
 	}
 
+	clen = zram_get_obj_size(zram, index);
+	zs_free(zram->mem_pool, handle);
+
 	if (unlikely(zram_test_flag(zram, index, ZRAM_UNCOMPRESSED))) {
-		clen = PAGE_SIZE;
-		__free_page(page);
 		zram_clear_flag(zram, index, ZRAM_UNCOMPRESSED);
-		zram_stat_dec(&zram->stats.pages_expand);
-		goto out;
+		zram_stat_dec(zram, &zram->stats.pages_expand);
+	} else if (clen <= PAGE_SIZE / 2) {
+		zram_stat_dec(zram, &zram->stats.good_compress);
 	}
 
-	obj = kmap_atomic(page, KM_USER0) + offset;
-	clen = xv_get_object_size(obj) - sizeof(struct zobj_header);
-	kunmap_atomic(obj, KM_USER0);
-
-	xv_free(zram->mem_pool, page, offset);
-	if (clen <= PAGE_SIZE / 2)
-		zram_stat_dec(&zram->stats.good_compress);
-
-out:
 	zram_stat64_sub(zram, &zram->stats.compr_size, clen);
-	zram_stat_dec(&zram->stats.pages_stored);
+	zram_stat_dec(zram, &zram->stats.pages_stored);
+	zram_stat_dec(zram, &zram->stats.compr_hist[zram_hist_bucket(clen)]);
 
-	zram->table[index].page = NULL;
-	zram->table[index].offset = 0;
+	zram->table[index].handle = 0;
+	zram_set_obj_size(zram, index, 0);
 }
 
-static void handle_zero_page(struct page *page)
+static void handle_same_page(struct page *page, unsigned long element)
 {
-	void *user_mem;
+	unsigned long *user_mem;
+	unsigned int pos;
 
 	user_mem = kmap_atomic(page, KM_USER0);
-	memset(user_mem, 0, PAGE_SIZE);
+	if (!element)
+		memset(user_mem, 0, PAGE_SIZE);
+	else
+		for (pos = 0; pos != PAGE_SIZE / sizeof(*user_mem); pos++)
+			user_mem[pos] = element;
 	kunmap_atomic(user_mem, KM_USER0);
 
 	flush_dcache_page(page);
@@ -189,15 +361,69 @@ static void handle_uncompressed_page(struct zram *zram,
 {
 	unsigned char *user_mem, *cmem;
 
+	cmem = zs_map_object(zram->mem_pool, zram->table[index].handle,
+				ZS_MM_RO);
 	user_mem = kmap_atomic(page, KM_USER0);
-	cmem = kmap_atomic(zram->table[index].page, KM_USER1) +
-			zram->table[index].offset;
 
 	memcpy(user_mem, cmem, PAGE_SIZE);
 	kunmap_atomic(user_mem, KM_USER0);
-	kunmap_atomic(cmem, KM_USER1);
+	zs_unmap_object(zram->mem_pool, zram->table[index].handle);
+
+	flush_dcache_page(page);
+}
+
+/* Fill page with the contents of the slot; called with the slot locked */
+static int zram_decompress_page(struct zram *zram, struct page *page,
+				u32 index)
+{
+	int ret;
+	size_t clen;
+	unsigned char *user_mem, *cmem;
+	unsigned long handle = zram->table[index].handle;
+
+	if (zram_test_flag(zram, index, ZRAM_ZERO)) {
+		handle_same_page(page, 0);
+		return 0;
+	}
+
+	if (zram_test_flag(zram, index, ZRAM_SAME)) {
+		handle_same_page(page, zram->table[index].element);
+		return 0;
+	}
+
+	/* Requested page is not present in compressed area */
+	if (unlikely(!handle)) {
+		pr_debug("Read before write: page=%u\n", index);
+		/* Do nothing */
+		return 0;
+	}
+
+	/* Page is stored uncompressed since it's incompressible */
+	if (unlikely(zram_test_flag(zram, index, ZRAM_UNCOMPRESSED))) {
+		handle_uncompressed_page(zram, page, index);
+		return 0;
+	}
+
+	clen = PAGE_SIZE;
+
+	cmem = zs_map_object(zram->mem_pool, handle, ZS_MM_RO);
+	user_mem = kmap_atomic(page, KM_USER0);
+
+	ret = lzo1x_decompress_safe(cmem, zram_get_obj_size(zram, index),
+				user_mem, &clen);
+
+	kunmap_atomic(user_mem, KM_USER0);
+	zs_unmap_object(zram->mem_pool, handle);
+
+	/* Should NEVER happen. Return bio error if it does. */
+	if (unlikely(ret != LZO_E_OK)) {
+		pr_err("Decompression failed! err=%d, page=%u\n",
+			ret, index);
+		return -EIO;
+	}
 
 	flush_dcache_page(page);
+	return 0;
 }
 
 static int zram_read(struct zram *zram, struct bio *bio)
@@ -218,58 +444,38 @@ static int zram_read(struct zram *zram, struct bio *bio)
 
 	bio_for_each_segment(bvec, bio, i) {
 		int ret;
-		size_t clen;
 		struct page *page;
-		struct zobj_header *zheader;
-		unsigned char *user_mem, *cmem;
 
 		page = bvec->bv_page;
 
-		if (zram_test_flag(zram, index, ZRAM_ZERO)) {
-			handle_zero_page(page);
-			index++;
-			continue;
-		}
-
-		/* Requested page is not present in compressed area */
-		if (unlikely(!zram->table[index].page)) {
-			pr_debug("Read before write: sector=%lu, size=%u",
-				(ulong)(bio->bi_sector), bio->bi_size);
-			/* Do nothing */
-			index++;
-			continue;
-		}
-
-		/* Page is stored uncompressed since it's incompressible */
-		if (unlikely(zram_test_flag(zram, index, ZRAM_UNCOMPRESSED))) {
-			handle_uncompressed_page(zram, page, index);
+		zram_slot_lock(zram, index);
+		zram_clear_flag(zram, index, ZRAM_IDLE);
+#ifdef CONFIG_ZRAM_WRITEBACK
+		if (zram_test_flag(zram, index, ZRAM_WB)) {
+			unsigned long blk = zram->table[index].element;
+
+			zram_slot_unlock(zram, index);
+			ret = read_from_bdev(zram, page, blk);
+			if (unlikely(ret)) {
+				pr_err("Backing device read failed! "
+					"err=%d, page=%u\n", ret, index);
+				zram_stat64_inc(zram,
+					&zram->stats.failed_reads);
+				goto out;
+			}
+			flush_dcache_page(page);
 			index++;
 			continue;
 		}
+#endif
+		ret = zram_decompress_page(zram, page, index);
+		zram_slot_unlock(zram, index);
 
-		user_mem = kmap_atomic(page, KM_USER0);
-		clen = PAGE_SIZE;
-
-		cmem = kmap_atomic(zram->table[index].page, KM_USER1) +
-				zram->table[index].offset;
-
-		ret = lzo1x_decompress_safe(
-			cmem + sizeof(*zheader),
-			xv_get_object_size(cmem) - sizeof(*zheader),
-			user_mem, &clen);
-
-		kunmap_atomic(user_mem, KM_USER0);
-		kunmap_atomic(cmem, KM_USER1);
-
-		/* Should NEVER happen. Return bio error if it does. */
-		if (unlikely(ret != LZO_E_OK)) {
-			pr_err("Decompression failed! err=%d, page=%u\n",
-				ret, index);
+		if (unlikely(ret)) {
 			zram_stat64_inc(zram, &zram->stats.failed_reads);
 			goto out;
 		}
 
-		flush_dcache_page(page);
 		index++;
 	}
 
@@ -298,42 +504,54 @@ static int zram_write(struct zram *zram, struct bio *bio)
 	index = bio->bi_sector >> SECTORS_PER_PAGE_SHIFT;
 
 	bio_for_each_segment(bvec, bio, i) {
-		u32 offset;
 		size_t clen;
-		struct zobj_header *zheader;
-		struct page *page, *page_store;
+		unsigned long handle, element;
+		struct zram_comp *comp;
+		struct page *page;
 		unsigned char *user_mem, *cmem, *src;
 
 		page = bvec->bv_page;
-		src = zram->compress_buffer;
-
-		/*
-		 * System overwrites unused sectors. Free memory associated
-		 * with this sector now.
-		 */
-		if (zram->table[index].page ||
-				zram_test_flag(zram, index, ZRAM_ZERO))
-			zram_free_page(zram, index);
-
-		mutex_lock(&zram->lock);
 
 		user_mem = kmap_atomic(page, KM_USER0);
-		if (page_zero_filled(user_mem)) {
+		if (page_same_filled(user_mem, &element)) {
 			kunmap_atomic(user_mem, KM_USER0);
-			mutex_unlock(&zram->lock);
-			zram_stat_inc(&zram->stats.pages_zero);
-			zram_set_flag(zram, index, ZRAM_ZERO);
+
+			/*
+			 * System overwrites unused sectors. Free memory
+			 * associated with this sector now.
+			 */
+			zram_slot_lock(zram, index);
+			zram_free_page(zram, index);
+			if (!element) {
+				zram_stat_inc(zram, &zram->stats.pages_zero);
+				zram_set_flag(zram, index, ZRAM_ZERO);
+			} else {
+				zram_stat_inc(zram, &zram->stats.pages_same);
+				zram->table[index].element = element;
+				zram_set_flag(zram, index, ZRAM_SAME);
+			}
+			zram_slot_unlock(zram, index);
 			index++;
 			continue;
 		}
+		kunmap_atomic(user_mem, KM_USER0);
+
+		/*
+		 * Use this CPU's compression buffers. Writers on different
+		 * CPUs no longer serialise on a device-wide lock.
+		 */
+		comp = per_cpu_ptr(zram->comp, raw_smp_processor_id());
+		mutex_lock(&comp->lock);
+		src = comp->buffer;
 
+		user_mem = kmap_atomic(page, KM_USER0);
 		ret = lzo1x_1_compress(user_mem, PAGE_SIZE, src, &clen,
-					zram->compress_workmem);
+					comp->workmem);
 
 		kunmap_atomic(user_mem, KM_USER0);
 
 		if (unlikely(ret != LZO_E_OK)) {
-			mutex_unlock(&zram->lock);
+			mutex_unlock(&comp->lock);
 			pr_err("Compression failed! err=%d\n", ret);
 			zram_stat64_inc(zram, &zram->stats.failed_writes);
 			goto out;
@@ -344,64 +562,52 @@ static int zram_write(struct zram *zram, struct bio *bio)
 		 * since we do not want to return too many disk write
 		 * errors which has side effect of hanging the system.
 		 */
-		if (unlikely(clen > max_zpage_size)) {
+		if (unlikely(clen > max_zpage_size))
 			clen = PAGE_SIZE;
-			page_store = alloc_page(GFP_NOIO | __GFP_HIGHMEM);
-			if (unlikely(!page_store)) {
-				mutex_unlock(&zram->lock);
-				pr_info("Error allocating memory for "
-					"incompressible page: %u\n", index);
-				zram_stat64_inc(zram,
-					&zram->stats.failed_writes);
-				goto out;
-			}
-
-			offset = 0;
-			zram_set_flag(zram, index, ZRAM_UNCOMPRESSED);
-			zram_stat_inc(&zram->stats.pages_expand);
-			zram->table[index].page = page_store;
-			src = kmap_atomic(page, KM_USER0);
-			goto memstore;
-		}
 
-		if (xv_malloc(zram->mem_pool, clen + sizeof(*zheader),
-				&zram->table[index].page, &offset,
-				GFP_NOIO | __GFP_HIGHMEM)) {
-			mutex_unlock(&zram->lock);
+		handle = zs_malloc(zram->mem_pool, clen,
+				GFP_NOIO | __GFP_HIGHMEM);
+		if (unlikely(!handle)) {
+			mutex_unlock(&comp->lock);
 			pr_info("Error allocating memory for compressed "
 				"page: %u, size=%zu\n", index, clen);
 			zram_stat64_inc(zram, &zram->stats.failed_writes);
 			goto out;
 		}
 
-memstore:
-		zram->table[index].offset = offset;
-
-		cmem = kmap_atomic(zram->table[index].page, KM_USER1) +
-				zram->table[index].offset;
-
-#if 0
-		/* Back-reference needed for memory defragmentation */
-		if (!zram_test_flag(zram, index, ZRAM_UNCOMPRESSED)) {
-			zheader = (struct zobj_header *)cmem;
-			zheader->table_idx = index;
-			cmem += sizeof(*zheader);
-		}
-#endif
+		if (unlikely(clen == PAGE_SIZE))
+			src = kmap_atomic(page, KM_USER0);
 
+		cmem = zs_map_object(zram->mem_pool, handle, ZS_MM_WO);
 		memcpy(cmem, src, clen);
+		zs_unmap_object(zram->mem_pool, handle);
 
-		kunmap_atomic(cmem, KM_USER1);
-		if (unlikely(zram_test_flag(zram, index, ZRAM_UNCOMPRESSED)))
+		if (unlikely(clen == PAGE_SIZE))
 			kunmap_atomic(src, KM_USER0);
 
+		/*
+		 * System overwrites unused sectors. Free memory associated
+		 * with this sector now.
+		 */
+		zram_slot_lock(zram, index);
+		zram_free_page(zram, index);
+		if (unlikely(clen == PAGE_SIZE)) {
+			zram_set_flag(zram, index, ZRAM_UNCOMPRESSED);
+			zram_stat_inc(zram, &zram->stats.pages_expand);
+		}
+		zram->table[index].handle = handle;
+		zram_set_obj_size(zram, index, clen);
+		zram_slot_unlock(zram, index);
+
 		/* Update stats */
 		zram_stat64_add(zram, &zram->stats.compr_size, clen);
-		zram_stat_inc(&zram->stats.pages_stored);
+		zram_stat_inc(zram, &zram->stats.pages_stored);
 		if (clen <= PAGE_SIZE / 2)
-			zram_stat_inc(&zram->stats.good_compress);
+			zram_stat_inc(zram, &zram->stats.good_compress);
+		zram_stat_inc(zram,
+			&zram->stats.compr_hist[zram_hist_bucket(clen)]);
 
-		mutex_unlock(&zram->lock);
+		mutex_unlock(&comp->lock);
 		index++;
 	}
 
@@ -458,43 +664,250 @@ static int zram_make_request(struct request_queue *queue, struct bio *bio)
 	return ret;
 }
 
-void zram_reset_device(struct zram *zram)
+#ifdef CONFIG_ZRAM_WRITEBACK
+static void zram_reset_backing_dev(struct zram *zram)
 {
-	size_t index;
+	if (!zram->bdev)
+		return;
 
-	mutex_lock(&zram->init_lock);
-	zram->init_done = 0;
+	blkdev_put(zram->bdev, FMODE_READ | FMODE_WRITE | FMODE_EXCL);
+	vfree(zram->bitmap);
+	kfree(zram->backing_dev);
 
-	/* Free various per-device buffers */
-	kfree(zram->compress_workmem);
-	free_pages((unsigned long)zram->compress_buffer, 1);
+	zram->bdev = NULL;
+	zram->bitmap = NULL;
+	zram->backing_dev = NULL;
+	zram->nr_pages = 0;
+}
+
+/*
+ * Use the block device at path to write back pages to. Must be called
+ * with init_lock held, before the device is initialized.
+ */
+int zram_set_backing_dev(struct zram *zram, const char *path)
+{
+	int ret;
+	char *name;
+	unsigned long nr_pages, *bitmap;
+	struct block_device *bdev;
+
+	name = kstrdup(path, GFP_KERNEL);
+	if (!name)
+		return -ENOMEM;
+
+	bdev = blkdev_get_by_path(name, FMODE_READ | FMODE_WRITE |
+				FMODE_EXCL, zram);
+	if (IS_ERR(bdev)) {
+		ret = PTR_ERR(bdev);
+		goto out_free;
+	}
+
+	nr_pages = i_size_read(bdev->bd_inode) >> PAGE_SHIFT;
+	if (nr_pages < 2) {
+		ret = -EINVAL;
+		goto out_put;
+	}
+
+	ret = set_blocksize(bdev, PAGE_SIZE);
+	if (ret)
+		goto out_put;
+
+	bitmap = vzalloc(BITS_TO_LONGS(nr_pages) * sizeof(long));
+	if (!bitmap) {
+		ret = -ENOMEM;
+		goto out_put;
+	}
 
-	zram->compress_workmem = NULL;
-	zram->compress_buffer = NULL;
+	zram_reset_backing_dev(zram);
+
+	zram->bdev = bdev;
+	zram->bitmap = bitmap;
+	zram->backing_dev = name;
+	zram->nr_pages = nr_pages;
+
+	pr_info("Using %s as backing device, %lu pages\n", name, nr_pages);
+	return 0;
+
+out_put:
+	blkdev_put(bdev, FMODE_READ | FMODE_WRITE | FMODE_EXCL);
+out_free:
+	kfree(name);
+	return ret;
+}
+
+/*
+ * Mark all stored pages idle. Pages still idle at the next
+ * zram_writeback(ZRAM_WB_IDLE) have not been touched in between.
+ */
+void zram_mark_idle(struct zram *zram)
+{
+	size_t index;
 
-	/* Free all pages that are still in this zram device */
 	for (index = 0; index < zram->disksize >> PAGE_SHIFT; index++) {
-		struct page *page;
-		u16 offset;
+		zram_slot_lock(zram, index);
+		if (zram->table[index].handle &&
+				!zram_test_flag(zram, index, ZRAM_SAME) &&
+				!zram_test_flag(zram, index, ZRAM_WB))
+			zram_set_flag(zram, index, ZRAM_IDLE);
+		zram_slot_unlock(zram, index);
+	}
+}
 
-		page = zram->table[index].page;
-		offset = zram->table[index].offset;
+static int zram_wb_candidate(struct zram *zram, size_t index,
+			enum zram_wb_mode mode)
+{
+	if (!zram->table[index].handle ||
+			zram_test_flag(zram, index, ZRAM_SAME) ||
+			zram_test_flag(zram, index, ZRAM_WB) ||
+			zram_test_flag(zram, index, ZRAM_UNDER_WB))
+		return 0;
 
-		if (!page)
+	if (mode == ZRAM_WB_HUGE)
+		return zram_test_flag(zram, index, ZRAM_UNCOMPRESSED);
+
+	return zram_test_flag(zram, index, ZRAM_IDLE);
+}
+
+/*
+ * Move incompressible or idle pages to the backing device, releasing
+ * the memory they took. Called with init_lock held.
+ */
+int zram_writeback(struct zram *zram, enum zram_wb_mode mode)
+{
+	int ret = 0;
+	size_t index;
+	unsigned long blk;
+	struct page *page;
+
+	if (!zram->bdev)
+		return -ENODEV;
+
+	page = alloc_page(GFP_KERNEL);
+	if (!page)
+		return -ENOMEM;
+
+	for (index = 0; index < zram->disksize >> PAGE_SHIFT; index++) {
+		zram_slot_lock(zram, index);
+		if (!zram_wb_candidate(zram, index, mode)) {
+			zram_slot_unlock(zram, index);
 			continue;
+		}
+
+		zram_set_flag(zram, index, ZRAM_UNDER_WB);
+		ret = zram_decompress_page(zram, page, index);
+		if (ret) {
+			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
+			zram_slot_unlock(zram, index);
+			break;
+		}
+		zram_slot_unlock(zram, index);
 
-		if (unlikely(zram_test_flag(zram, index, ZRAM_UNCOMPRESSED)))
-			__free_page(page);
+		blk = alloc_block_bdev(zram);
+		if (!blk)
+			ret = -ENOSPC;
 		else
-			xv_free(zram->mem_pool, page, offset);
+			ret = zram_bdev_rw(zram, WRITE, page, blk);
+
+		zram_slot_lock(zram, index);
+		/*
+		 * Give up on the page if the write failed, or if it was
+		 * freed, rewritten or (in idle mode) read meanwhile.
+		 */
+		if (ret || !zram_test_flag(zram, index, ZRAM_UNDER_WB) ||
+				(mode == ZRAM_WB_IDLE &&
+				 !zram_test_flag(zram, index, ZRAM_IDLE))) {
+			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
+			zram_slot_unlock(zram, index);
+			if (blk)
+				free_block_bdev(zram, blk);
+			if (ret)
+				break;
+			continue;
+		}
+
+		zram_free_page(zram, index);
+		zram_set_flag(zram, index, ZRAM_WB);
+		zram->table[index].element = blk;
+		zram_slot_unlock(zram, index);
+
+		zram_stat64_inc(zram, &zram->stats.bd_writes);
+		cond_resched();
+	}
+
+	__free_page(page);
+	return ret;
+}
+#endif
+
+static void zram_free_comp(struct zram *zram)
+{
+	int cpu;
+
+	if (!zram->comp)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		struct zram_comp *comp = per_cpu_ptr(zram->comp, cpu);
+
+		kfree(comp->workmem);
+		free_pages((unsigned long)comp->buffer, 1);
+	}
+
+	free_percpu(zram->comp);
+	zram->comp = NULL;
+}
+
+static int zram_alloc_comp(struct zram *zram)
+{
+	int cpu;
+
+	zram->comp = alloc_percpu(struct zram_comp);
+	if (!zram->comp) {
+		pr_err("Error allocating compressor buffers!\n");
+		return -ENOMEM;
+	}
+
+	for_each_possible_cpu(cpu) {
+		struct zram_comp *comp = per_cpu_ptr(zram->comp, cpu);
+
+		mutex_init(&comp->lock);
+
+		comp->workmem = kzalloc(LZO1X_MEM_COMPRESS, GFP_KERNEL);
+		if (!comp->workmem) {
+			pr_err("Error allocating compressor working memory!\n");
+			return -ENOMEM;
+		}
+
+		comp->buffer = (void *)__get_free_pages(__GFP_ZERO, 1);
+		if (!comp->buffer) {
+			pr_err("Error allocating compressor buffer space\n");
+			return -ENOMEM;
+		}
 	}
 
+	return 0;
+}
+
+void zram_reset_device(struct zram *zram)
+{
+	mutex_lock(&zram->init_lock);
+	zram->init_done = 0;
+
+	/* Free various per-device buffers */
+	zram_free_comp(zram);
+
 	vfree(zram->table);
 	zram->table = NULL;
 
-	xv_destroy_pool(zram->mem_pool);
+	/* Also frees all objects that are still in this zram device */
+	if (zram->mem_pool)
+		zs_destroy_pool(zram->mem_pool);
 	zram->mem_pool = NULL;
 
+#ifdef CONFIG_ZRAM_WRITEBACK
+	zram_reset_backing_dev(zram);
+#endif
+
 	/* Reset stats */
 	memset(&zram->stats, 0, sizeof(zram->stats));
 
@@ -516,19 +929,9 @@ int zram_init_device(struct zram *zram)
 
 	zram_set_disksize(zram, totalram_pages << PAGE_SHIFT);
 
-	zram->compress_workmem = kzalloc(LZO1X_MEM_COMPRESS, GFP_KERNEL);
-	if (!zram->compress_workmem) {
-		pr_err("Error allocating compressor working memory!\n");
-		ret = -ENOMEM;
-		goto fail;
-	}
-
-	zram->compress_buffer = (void *)__get_free_pages(__GFP_ZERO, 1);
-	if (!zram->compress_buffer) {
-		pr_err("Error allocating compressor buffer space\n");
-		ret = -ENOMEM;
+	ret = zram_alloc_comp(zram);
+	if (ret)
 		goto fail;
-	}
 
 	num_pages = zram->disksize >> PAGE_SHIFT;
 	zram->table = vzalloc(num_pages * sizeof(*zram->table));
@@ -545,7 +948,7 @@ int zram_init_device(struct zram *zram)
 	/* zram devices sort of resembles non-rotational disks */
 	queue_flag_set_unlocked(QUEUE_FLAG_NONROT, zram->disk->queue);
 
-	zram->mem_pool = xv_create_pool();
+	zram->mem_pool = zs_create_pool();
 	if (!zram->mem_pool) {
 		pr_err("Error creating memory pool\n");
 		ret = -ENOMEM;
@@ -571,7 +974,9 @@ void zram_slot_free_notify(struct block_device *bdev, unsigned long index)
 	struct zram *zram;
 
 	zram = bdev->bd_disk->private_data;
+	zram_slot_lock(zram, index);
 	zram_free_page(zram, index);
+	zram_slot_unlock(zram, index);
 	zram_stat64_inc(zram, &zram->stats.notify_free);
 }
 
@@ -584,9 +989,8 @@ static int create_device(struct zram *zram, int device_id)
 {
 	int ret = 0;
 
-	mutex_init(&zram->lock);
 	mutex_init(&zram->init_lock);
-	spin_lock_init(&zram->stat64_lock);
+	spin_lock_init(&zram->stat_lock);
 
 	zram->queue = blk_alloc_queue(GFP_KERNEL);
 	if (!zram->queue) {
@@ -18,7 +18,7 @@
 #include <linux/spinlock.h>
 #include <linux/mutex.h>
 
-#include "xvmalloc.h"
+#include "zsmalloc.h"
 
 /*
  * Some arbitrary value. This is just to catch
@@ -26,18 +26,6 @@
  */
 static const unsigned max_num_devices = 32;
 
-/*
- * Stored at beginning of each compressed object.
- *
- * It stores back-reference to table entry which points to this
- * object. This is required to support memory defragmentation.
- */
-struct zobj_header {
-#if 0
-	u32 table_idx;
-#endif
-};
-
 /*-- Configurable parameters */
 
 /* Default zram disk size: 25% of total RAM */
@@ -50,9 +38,8 @@ static const unsigned default_disksize_perc_ram = 25;
 static const unsigned max_zpage_size = PAGE_SIZE / 4 * 3;
 
 /*
- * NOTE: max_zpage_size must be less than or equal to:
- *   XV_MAX_ALLOC_SIZE - sizeof(struct zobj_header)
- * otherwise, xv_malloc() would always return failure.
+ * NOTE: max_zpage_size must be less than or equal to ZS_MAX_ALLOC_SIZE,
+ * otherwise, zs_malloc() would always return failure.
  */
 
 /*-- End of configurable params */
@@ -62,14 +49,41 @@ static const unsigned max_zpage_size = PAGE_SIZE / 4 * 3;
 #define SECTORS_PER_PAGE_SHIFT	(PAGE_SHIFT - SECTOR_SHIFT)
 #define SECTORS_PER_PAGE	(1 << SECTORS_PER_PAGE_SHIFT)
 
-/* Flags for zram pages (table[page_no].flags) */
+/*
+ * Stored pages are counted in buckets of PAGE_SIZE / ZRAM_HIST_BUCKETS
+ * bytes of compressed size; incompressible pages land in the last one.
+ */
+#define ZRAM_HIST_BUCKETS	8
+
+/*
+ * The lower ZRAM_FLAG_SHIFT bits of table[page_no].value hold the object
+ * size; the zram_pageflags are kept above them.
+ */
+#define ZRAM_FLAG_SHIFT		24
+
+/* Flags for zram pages (table[page_no].value) */
 enum zram_pageflags {
+	/* Bit spinlock guarding the table entry */
+	ZRAM_LOCK = ZRAM_FLAG_SHIFT,
+
 	/* Page is stored uncompressed */
 	ZRAM_UNCOMPRESSED,
 
 	/* Page consists entirely of zeros */
 	ZRAM_ZERO,
 
+	/* Page is filled with one repeated word, kept in table.element */
+	ZRAM_SAME,
+
+	/* Page lives on the backing device, block number in table.element */
+	ZRAM_WB,
+
+	/* Page is being written back to the backing device */
+	ZRAM_UNDER_WB,
+
+	/* Page has not been accessed since it was marked idle */
+	ZRAM_IDLE,
+
 	__NR_ZRAM_PAGEFLAGS,
 };
 
@@ -77,11 +91,12 @@ enum zram_pageflags {
 
 /* Allocated for each disk page */
 struct table {
-	struct page *page;
-	u16 offset;
-	u8 count;	/* object ref count (not yet used) */
-	u8 flags;
-} __attribute__((aligned(4)));
+	union {
+		unsigned long handle;	/* zsmalloc object */
+		unsigned long element;	/* ZRAM_SAME and ZRAM_WB pages */
+	};
+	unsigned long value;	/* object size and zram_pageflags */
+};
 
 struct zram_stats {
 	u64 compr_size;		/* compressed size of pages stored */
@@ -95,16 +110,31 @@ struct zram_stats {
 	u32 pages_stored;	/* no. of pages currently stored */
 	u32 good_compress;	/* % of pages with compression ratio<=50% */
 	u32 pages_expand;	/* % of incompressible pages */
+	u32 pages_same;		/* no. of non-zero same filled pages */
+	u32 compr_hist[ZRAM_HIST_BUCKETS];	/* pages stored, by size */
+#ifdef CONFIG_ZRAM_WRITEBACK
+	u32 bd_count;		/* no. of pages on the backing device */
+	u64 bd_reads;		/* pages read from the backing device */
+	u64 bd_writes;		/* pages written to the backing device */
+#endif
+};
+
+/*
+ * Compression buffers, one set per CPU. The mutex is normally
+ * uncontended; it only matters if a writer is migrated while
+ * compressing, or when the device is reset.
+ */
+struct zram_comp {
+	struct mutex lock;
+	void *workmem;
+	void *buffer;
 };
 
 struct zram {
-	struct xv_pool *mem_pool;
-	void *compress_workmem;
-	void *compress_buffer;
+	struct zs_pool *mem_pool;
+	struct zram_comp __percpu *comp;
 	struct table *table;
-	spinlock_t stat64_lock;	/* protect 64-bit stats */
-	struct mutex lock;	/* protect compression buffers against
-				 * concurrent writes */
+	spinlock_t stat_lock;	/* protect stats */
 	struct request_queue *queue;
 	struct gendisk *disk;
 	int init_done;
@@ -115,6 +145,12 @@ struct zram {
 	 * we can store in a disk.
 	 */
 	u64 disksize;	/* bytes */
+#ifdef CONFIG_ZRAM_WRITEBACK
+	struct block_device *bdev;
+	char *backing_dev;	/* path of bdev, for sysfs */
+	unsigned long *bitmap;	/* bdev blocks in use */
+	unsigned long nr_pages;	/* size of bdev */
+#endif
 
 	struct zram_stats stats;
 };
@@ -128,4 +164,16 @@ extern struct attribute_group zram_disk_attr_group;
 extern int zram_init_device(struct zram *zram);
 extern void zram_reset_device(struct zram *zram);
 
+#ifdef CONFIG_ZRAM_WRITEBACK
+/* What zram_writeback() writes back */
+enum zram_wb_mode {
+	ZRAM_WB_HUGE,		/* incompressible pages */
+	ZRAM_WB_IDLE,		/* pages not accessed since zram_mark_idle() */
+};
+
+extern int zram_set_backing_dev(struct zram *zram, const char *path);
+extern void zram_mark_idle(struct zram *zram);
+extern int zram_writeback(struct zram *zram, enum zram_wb_mode mode);
+#endif
+
 #endif
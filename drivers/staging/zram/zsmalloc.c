@@ -0,0 +1,654 @@
+/*
+ * zsmalloc memory allocator
+ *
+ * This code is released using a dual license strategy: BSD/GPL
+ * You can choose the licence that better fits your requirements.
+ *
+ * Released under the terms of 3-clause BSD License
+ * Released under the terms of GNU General Public License Version 2.0
+ */
+
+/*
+ * Objects are sorted into size classes. Each class carves its zspages
+ * (groups of 1 to ZS_MAX_PAGES_PER_ZSPAGE pages) into equal sized slots,
+ * choosing the number of pages that wastes the least space, so objects
+ * are packed across page boundaries instead of being rounded up to
+ * fill a page.
+ *
+ * Users get an opaque handle rather than an address. An object is only
+ * accessible between zs_map_object() and zs_unmap_object(), and while
+ * it is not mapped it may be moved to another zspage of its class by
+ * zs_compact(), which is also driven by memory pressure through a
+ * shrinker. That way partially used zspages are merged and their pages
+ * given back instead of fragmentation growing over time.
+ *
+ * Locking: a handle's HANDLE_PIN_BIT is taken before the class lock.
+ * Compaction, which already holds the class lock, only ever trylocks
+ * the pin, and skips objects that are in use.
+ */
+
+#include <linux/bit_spinlock.h>
+#include <linux/errno.h>
+#include <linux/highmem.h>
+#include <linux/percpu.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+
+#include "zsmalloc.h"
+#include "zsmalloc_int.h"
+
+static unsigned int get_size_class_index(size_t size)
+{
+	if (size <= ZS_MIN_ALLOC_SIZE)
+		return 0;
+
+	return DIV_ROUND_UP(size - ZS_MIN_ALLOC_SIZE, ZS_SIZE_CLASS_DELTA);
+}
+
+/*
+ * Pick the zspage size (in pages) that leaves the smallest fraction of
+ * it unused for objects of the given size.
+ */
+static unsigned int get_pages_per_zspage(unsigned int size)
+{
+	unsigned int i, best = 1, best_usedpc = 0;
+
+	for (i = 1; i <= ZS_MAX_PAGES_PER_ZSPAGE; i++) {
+		unsigned int zspage_size = i * PAGE_SIZE;
+		unsigned int waste = zspage_size % size;
+		unsigned int usedpc = (zspage_size - waste) * 100 / zspage_size;
+
+		if (usedpc > best_usedpc) {
+			best_usedpc = usedpc;
+			best = i;
+		}
+	}
+
+	return best;
+}
+
+static enum fullness_group get_fullness_group(struct size_class *class,
+					struct zspage *zspage)
+{
+	if (!zspage->inuse)
+		return ZS_EMPTY;
+	if (zspage->inuse == class->objs_per_zspage)
+		return ZS_FULL;
+	if (zspage->inuse * 4 <= class->objs_per_zspage *
+					ZS_ALMOST_FULL_QUARTERS)
+		return ZS_ALMOST_EMPTY;
+
+	return ZS_ALMOST_FULL;
+}
+
+static struct zspage *alloc_zspage(struct size_class *class, gfp_t flags)
+{
+	unsigned int i;
+	struct zspage *zspage;
+
+	zspage = kzalloc(sizeof(*zspage) +
+			class->objs_per_zspage * sizeof(zspage->slots[0]),
+			flags & ~__GFP_HIGHMEM);
+	if (!zspage)
+		return NULL;
+
+	for (i = 0; i < class->pages_per_zspage; i++) {
+		zspage->pages[i] = alloc_page(flags);
+		if (!zspage->pages[i])
+			goto fail;
+	}
+
+	for (i = 0; i < class->objs_per_zspage; i++)
+		zspage->slots[i] = free_slot(i + 1);
+
+	zspage->class = class;
+	zspage->free_idx = 0;
+	INIT_LIST_HEAD(&zspage->list);
+
+	return zspage;
+
+fail:
+	while (i--)
+		__free_page(zspage->pages[i]);
+	kfree(zspage);
+	return NULL;
+}
+
+static void free_zspage(struct zspage *zspage)
+{
+	unsigned int i;
+
+	for (i = 0; i < zspage->class->pages_per_zspage; i++)
+		__free_page(zspage->pages[i]);
+	kfree(zspage);
+}
+
+/*
+ * Add a new zspage; obj_alloc() and fix_fullness_group() put it where
+ * it belongs. Called with class->lock held.
+ */
+static void insert_zspage(struct size_class *class, struct zspage *zspage)
+{
+	class->zspages++;
+	zspage->fullness = ZS_ALMOST_EMPTY;
+	list_add(&zspage->list, &class->fullness_list[ZS_ALMOST_EMPTY]);
+}
+
+/*
+ * Move the zspage to the list matching its use count, or release it
+ * once it is empty. Returns the number of pages released.
+ * Called with class->lock held.
+ */
+static unsigned int fix_fullness_group(struct zs_pool *pool,
+			struct size_class *class, struct zspage *zspage)
+{
+	enum fullness_group fg;
+
+	fg = get_fullness_group(class, zspage);
+	if (fg == ZS_EMPTY) {
+		list_del(&zspage->list);
+		class->zspages--;
+		free_zspage(zspage);
+		atomic_long_sub(class->pages_per_zspage,
+				&pool->pages_allocated);
+		return class->pages_per_zspage;
+	}
+
+	if (fg != zspage->fullness) {
+		list_move(&zspage->list, &class->fullness_list[fg]);
+		zspage->fullness = fg;
+	}
+
+	return 0;
+}
+
+/*
+ * Find a zspage with a free slot, preferring fuller ones so that the
+ * emptier ones drain. Called with class->lock held.
+ */
+static struct zspage *find_free_zspage(struct size_class *class)
+{
+	enum fullness_group fg;
+
+	for (fg = ZS_ALMOST_FULL; fg <= ZS_ALMOST_EMPTY; fg++) {
+		struct list_head *head = &class->fullness_list[fg];
+
+		if (!list_empty(head))
+			return list_first_entry(head, struct zspage, list);
+	}
+
+	return NULL;
+}
+
+/* Called with class->lock held */
+static unsigned int obj_alloc(struct zspage *zspage, struct zs_handle *h)
+{
+	unsigned int idx = zspage->free_idx;
+
+	zspage->free_idx = free_slot_next(zspage->slots[idx]);
+	zspage->slots[idx] = (unsigned long)h;
+	zspage->inuse++;
+	zspage->class->objs_inuse++;
+
+	h->zspage = zspage;
+	h->idx = idx;
+
+	return idx;
+}
+
+/* Called with class->lock held */
+static void obj_free(struct zspage *zspage, unsigned int idx)
+{
+	zspage->slots[idx] = free_slot(zspage->free_idx);
+	zspage->free_idx = idx;
+	zspage->inuse--;
+	zspage->class->objs_inuse--;
+}
+
+static unsigned long obj_offset(struct size_class *class, unsigned int idx)
+{
+	return (unsigned long)idx * class->size;
+}
+
+/*
+ * Copy len bytes between buf and the zspage, starting at byte off of the
+ * zspage. to_zspage selects the direction.
+ */
+static void zs_copy(struct zspage *zspage, unsigned long off, char *buf,
+			size_t len, int to_zspage)
+{
+	while (len) {
+		struct page *page = zspage->pages[off >> PAGE_SHIFT];
+		unsigned long poff = off & ~PAGE_MASK;
+		size_t n = min_t(size_t, len, PAGE_SIZE - poff);
+		char *vaddr;
+
+		vaddr = kmap_atomic(page, KM_USER0);
+		if (to_zspage)
+			memcpy(vaddr + poff, buf, n);
+		else
+			memcpy(buf, vaddr + poff, n);
+		kunmap_atomic(vaddr, KM_USER0);
+
+		off += n;
+		buf += n;
+		len -= n;
+	}
+}
+
+/* Copy an object of class between two zspages of it */
+static void zs_move(struct size_class *class, struct zspage *dst,
+		unsigned int dst_idx, struct zspage *src, unsigned int src_idx)
+{
+	unsigned long doff = obj_offset(class, dst_idx);
+	unsigned long soff = obj_offset(class, src_idx);
+	size_t len = class->size;
+
+	while (len) {
+		unsigned long dpoff = doff & ~PAGE_MASK;
+		unsigned long spoff = soff & ~PAGE_MASK;
+		size_t n = min3(len, (size_t)(PAGE_SIZE - dpoff),
+				(size_t)(PAGE_SIZE - spoff));
+		char *s, *d;
+
+		s = kmap_atomic(src->pages[soff >> PAGE_SHIFT], KM_USER0);
+		d = kmap_atomic(dst->pages[doff >> PAGE_SHIFT], KM_USER1);
+		memcpy(d + dpoff, s + spoff, n);
+		kunmap_atomic(d, KM_USER1);
+		kunmap_atomic(s, KM_USER0);
+
+		doff += n;
+		soff += n;
+		len -= n;
+	}
+}
+
+/**
+ * zs_malloc - Allocate an object from the pool
+ * @pool: pool to allocate from
+ * @size: object size, at most ZS_MAX_ALLOC_SIZE
+ * @flags: allocation flags for any new backing pages
+ *
+ * Returns a handle to pass to zs_map_object() and zs_free(), or 0 if
+ * memory could not be allocated.
+ */
+unsigned long zs_malloc(struct zs_pool *pool, size_t size, gfp_t flags)
+{
+	struct zs_handle *h;
+	struct zspage *zspage;
+	struct size_class *class;
+
+	if (unlikely(!size || size > ZS_MAX_ALLOC_SIZE))
+		return 0;
+
+	h = kmalloc(sizeof(*h), flags & ~__GFP_HIGHMEM);
+	if (!h)
+		return 0;
+	h->flags = 0;
+
+	class = &pool->size_class[get_size_class_index(size)];
+
+	spin_lock(&class->lock);
+	zspage = find_free_zspage(class);
+
+	if (!zspage) {
+		spin_unlock(&class->lock);
+
+		zspage = alloc_zspage(class, flags);
+		if (!zspage) {
+			kfree(h);
+			return 0;
+		}
+		atomic_long_add(class->pages_per_zspage,
+				&pool->pages_allocated);
+
+		spin_lock(&class->lock);
+		insert_zspage(class, zspage);
+	}
+
+	obj_alloc(zspage, h);
+	fix_fullness_group(pool, class, zspage);
+	spin_unlock(&class->lock);
+
+	return (unsigned long)h;
+}
+
+/**
+ * zs_free - Release an object
+ * @pool: pool the object was allocated from
+ * @handle: handle returned by zs_malloc()
+ *
+ * The object must not be mapped.
+ */
+void zs_free(struct zs_pool *pool, unsigned long handle)
+{
+	struct zs_handle *h = (struct zs_handle *)handle;
+	struct zspage *zspage;
+	struct size_class *class;
+
+	if (unlikely(!handle))
+		return;
+
+	/* Keep compaction from moving the object under us */
+	bit_spin_lock(HANDLE_PIN_BIT, &h->flags);
+	zspage = h->zspage;
+	class = zspage->class;
+
+	spin_lock(&class->lock);
+	obj_free(zspage, h->idx);
+	fix_fullness_group(pool, class, zspage);
+	spin_unlock(&class->lock);
+
+	bit_spin_unlock(HANDLE_PIN_BIT, &h->flags);
+	kfree(h);
+}
+
+/**
+ * zs_map_object - Get access to an object's data
+ * @pool: pool the object was allocated from
+ * @handle: handle returned by zs_malloc()
+ * @mm: how the data is going to be accessed
+ *
+ * The object stays in place until zs_unmap_object(). As with
+ * kmap_atomic(), the caller must not sleep meanwhile. Only one object
+ * per pool may be mapped at a time on each CPU; other kmap_atomic()
+ * mappings taken in between must be released first.
+ */
+void *zs_map_object(struct zs_pool *pool, unsigned long handle,
+			enum zs_mapmode mm)
+{
+	struct zs_handle *h = (struct zs_handle *)handle;
+	struct zspage *zspage;
+	struct size_class *class;
+	struct mapping_area *area;
+	unsigned long off, poff;
+
+	BUG_ON(!handle);
+
+	bit_spin_lock(HANDLE_PIN_BIT, &h->flags);
+	zspage = h->zspage;
+	class = zspage->class;
+	off = obj_offset(class, h->idx);
+	poff = off & ~PAGE_MASK;
+
+	/* The pin disables preemption, so the area stays ours */
+	area = per_cpu_ptr(pool->area, smp_processor_id());
+
+	/* The common case: the object lies within a single page */
+	if (poff + class->size <= PAGE_SIZE) {
+		area->vaddr = kmap_atomic(zspage->pages[off >> PAGE_SHIFT],
+					KM_USER1);
+		return area->vaddr + poff;
+	}
+
+	area->mm = mm;
+	if (mm != ZS_MM_WO)
+		zs_copy(zspage, off, area->buf, class->size, 0);
+
+	return area->buf;
+}
+
+void zs_unmap_object(struct zs_pool *pool, unsigned long handle)
+{
+	struct zs_handle *h = (struct zs_handle *)handle;
+	struct zspage *zspage = h->zspage;
+	struct size_class *class = zspage->class;
+	struct mapping_area *area;
+	unsigned long off, poff;
+
+	off = obj_offset(class, h->idx);
+	poff = off & ~PAGE_MASK;
+
+	area = per_cpu_ptr(pool->area, smp_processor_id());
+	if (poff + class->size <= PAGE_SIZE)
+		kunmap_atomic(area->vaddr, KM_USER1);
+	else if (area->mm != ZS_MM_RO)
+		zs_copy(zspage, off, area->buf, class->size, 1);
+
+	bit_spin_unlock(HANDLE_PIN_BIT, &h->flags);
+}
+
+/*
+ * Number of zspages the class could do without if its objects were
+ * packed tightly. Called with class->lock held.
+ */
+static unsigned long zs_can_compact(struct size_class *class)
+{
+	unsigned long needed;
+
+	needed = DIV_ROUND_UP(class->objs_inuse, class->objs_per_zspage);
+
+	return class->zspages > needed ? class->zspages - needed : 0;
+}
+
+/*
+ * Empty the emptiest zspages of a class into the ones that still have
+ * room. Every source is visited at most once per pass; sources that
+ * could not be emptied, e.g. because one of their objects is mapped,
+ * are put back afterwards. Returns the number of pages released.
+ */
+static unsigned long compact_class(struct zs_pool *pool,
+				struct size_class *class)
+{
+	LIST_HEAD(done);
+	struct zspage *src, *dst;
+	unsigned long freed = 0;
+	unsigned int idx;
+
+	spin_lock(&class->lock);
+	while (zs_can_compact(class) &&
+			!list_empty(&class->fullness_list[ZS_ALMOST_EMPTY])) {
+		/* The tail has gone longest without receiving objects */
+		src = list_entry(class->fullness_list[ZS_ALMOST_EMPTY].prev,
+				struct zspage, list);
+		list_move(&src->list, &done);
+
+		for (idx = 0; idx < class->objs_per_zspage && src->inuse;
+				idx++) {
+			unsigned long slot = src->slots[idx];
+			struct zs_handle *h = (struct zs_handle *)slot;
+			unsigned int dst_idx;
+
+			if (slot_is_free(slot))
+				continue;
+
+			dst = find_free_zspage(class);
+			if (!dst)
+				goto out;
+
+			/* Leave objects that are mapped or being freed */
+			if (!bit_spin_trylock(HANDLE_PIN_BIT, &h->flags))
+				continue;
+
+			dst_idx = obj_alloc(dst, h);
+			zs_move(class, dst, dst_idx, src, idx);
+			obj_free(src, idx);
+
+			bit_spin_unlock(HANDLE_PIN_BIT, &h->flags);
+			fix_fullness_group(pool, class, dst);
+		}
+
+		/* Releases src if it is now empty, else leaves it on done */
+		freed += fix_fullness_group(pool, class, src);
+
+		spin_unlock(&class->lock);
+		cond_resched();
+		spin_lock(&class->lock);
+	}
+out:
+	/* Sources only ever lost objects, so they are all almost empty */
+	list_splice(&done, &class->fullness_list[ZS_ALMOST_EMPTY]);
+	spin_unlock(&class->lock);
+
+	return freed;
+}
+
+/**
+ * zs_compact - Move objects to release partially used pages
+ * @pool: pool to compact
+ *
+ * Returns the number of pages given back to the system.
+ */
+unsigned long zs_compact(struct zs_pool *pool)
+{
+	unsigned int i;
+	unsigned long freed = 0;
+
+	for (i = 0; i < ZS_SIZE_CLASSES; i++)
+		freed += compact_class(pool, &pool->size_class[i]);
+
+	atomic_long_add(freed, &pool->pages_compacted);
+
+	return freed;
+}
+
+static unsigned long zs_pages_freeable(struct zs_pool *pool)
+{
+	unsigned int i;
+	unsigned long pages = 0;
+
+	for (i = 0; i < ZS_SIZE_CLASSES; i++) {
+		struct size_class *class = &pool->size_class[i];
+
+		spin_lock(&class->lock);
+		pages += zs_can_compact(class) * class->pages_per_zspage;
+		spin_unlock(&class->lock);
+	}
+
+	return pages;
+}
+
+static int zs_shrink(struct shrinker *shrinker, int nr_to_scan,
+			gfp_t gfp_mask)
+{
+	struct zs_pool *pool = container_of(shrinker, struct zs_pool,
+					shrinker);
+
+	if (nr_to_scan)
+		zs_compact(pool);
+
+	return min_t(unsigned long, zs_pages_freeable(pool), INT_MAX);
+}
+
+static void zs_free_areas(struct zs_pool *pool)
+{
+	int cpu;
+
+	if (!pool->area)
+		return;
+
+	for_each_possible_cpu(cpu)
+		kfree(per_cpu_ptr(pool->area, cpu)->buf);
+	free_percpu(pool->area);
+}
+
+struct zs_pool *zs_create_pool(void)
+{
+	int cpu;
+	unsigned int i;
+	struct zs_pool *pool;
+
+	pool = kzalloc(sizeof(*pool), GFP_KERNEL);
+	if (!pool)
+		return NULL;
+
+	for (i = 0; i < ZS_SIZE_CLASSES; i++) {
+		struct size_class *class = &pool->size_class[i];
+		enum fullness_group fg;
+
+		class->size = min_t(unsigned int, ZS_MAX_ALLOC_SIZE,
+				ZS_MIN_ALLOC_SIZE + i * ZS_SIZE_CLASS_DELTA);
+		class->pages_per_zspage = get_pages_per_zspage(class->size);
+		class->objs_per_zspage = class->pages_per_zspage * PAGE_SIZE /
+						class->size;
+		spin_lock_init(&class->lock);
+		for (fg = 0; fg < _ZS_NR_FULLNESS_GROUPS; fg++)
+			INIT_LIST_HEAD(&class->fullness_list[fg]);
+	}
+
+	pool->area = alloc_percpu(struct mapping_area);
+	if (!pool->area)
+		goto fail;
+
+	for_each_possible_cpu(cpu) {
+		struct mapping_area *area = per_cpu_ptr(pool->area, cpu);
+
+		area->buf = kmalloc(ZS_MAX_ALLOC_SIZE, GFP_KERNEL);
+		if (!area->buf)
+			goto fail;
+	}
+
+	atomic_long_set(&pool->pages_allocated, 0);
+	atomic_long_set(&pool->pages_compacted, 0);
+
+	pool->shrinker.shrink = zs_shrink;
+	pool->shrinker.seeks = DEFAULT_SEEKS;
+	register_shrinker(&pool->shrinker);
+
+	return pool;
+
+fail:
+	zs_free_areas(pool);
+	kfree(pool);
+	return NULL;
+}
+
+/*
+ * Releases the pool together with any objects still allocated from it.
+ */
+void zs_destroy_pool(struct zs_pool *pool)
+{
+	unsigned int i, idx;
+	enum fullness_group fg;
+
+	unregister_shrinker(&pool->shrinker);
+
+	for (i = 0; i < ZS_SIZE_CLASSES; i++) {
+		struct size_class *class = &pool->size_class[i];
+
+		for (fg = 0; fg < _ZS_NR_FULLNESS_GROUPS; fg++) {
+			struct zspage *zspage, *tmp;
+
+			list_for_each_entry_safe(zspage, tmp,
+					&class->fullness_list[fg], list) {
+				for (idx = 0; idx < class->objs_per_zspage;
+						idx++) {
+					unsigned long slot = zspage->slots[idx];
+
+					if (!slot_is_free(slot))
+						kfree((void *)slot);
+				}
+				free_zspage(zspage);
+			}
+		}
+	}
+
+	zs_free_areas(pool);
+	kfree(pool);
+}
+
+u64 zs_get_total_size_bytes(struct zs_pool *pool)
+{
+	return (u64)atomic_long_read(&pool->pages_allocated) << PAGE_SHIFT;
+}
+
+void zs_get_pool_stats(struct zs_pool *pool, struct zs_pool_stats *stats)
+{
+	unsigned int i;
+
+	memset(stats, 0, sizeof(*stats));
+
+	for (i = 0; i < ZS_SIZE_CLASSES; i++) {
+		struct size_class *class = &pool->size_class[i];
+
+		spin_lock(&class->lock);
+		stats->objs_allocated += (u64)class->zspages *
+						class->objs_per_zspage;
+		stats->objs_used += class->objs_inuse;
+		spin_unlock(&class->lock);
+	}
+
+	stats->pages_allocated = atomic_long_read(&pool->pages_allocated);
+	stats->pages_compacted = atomic_long_read(&pool->pages_compacted);
+}
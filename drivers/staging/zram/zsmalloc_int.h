@@ -0,0 +1,119 @@
+/*
+ * zsmalloc memory allocator
+ *
+ * This code is released using a dual license strategy: BSD/GPL
+ * You can choose the licence that better fits your requirements.
+ *
+ * Released under the terms of 3-clause BSD License
+ * Released under the terms of GNU General Public License Version 2.0
+ */
+
+#ifndef _ZS_MALLOC_INT_H_
+#define _ZS_MALLOC_INT_H_
+
+#include <linux/kernel.h>
+#include <linux/types.h>
+#include <linux/list.h>
+#include <linux/mm.h>
+#include <linux/spinlock.h>
+
+#include "zsmalloc.h"
+
+/* User configurable params */
+
+/*
+ * Objects are grouped into size classes ZS_SIZE_CLASS_DELTA bytes apart.
+ * Every object starts at a multiple of the delta, so it must be a power
+ * of two no smaller than the alignment callers expect.
+ */
+#define ZS_SIZE_CLASS_DELTA	16
+#define ZS_MIN_ALLOC_SIZE	32
+#define ZS_MAX_ALLOC_SIZE	PAGE_SIZE
+#define ZS_SIZE_CLASSES		((ZS_MAX_ALLOC_SIZE - ZS_MIN_ALLOC_SIZE) \
+					/ ZS_SIZE_CLASS_DELTA + 1)
+
+/*
+ * A zspage is the unit of allocation within a class: up to this many
+ * (not necessarily contiguous) pages, with objects packed back to back
+ * so that one object may straddle two of them.
+ */
+#define ZS_MAX_PAGES_PER_ZSPAGE	4
+
+/*
+ * A zspage is "almost empty" while at most this fraction (in quarters)
+ * of its objects is in use. Such zspages are compaction sources.
+ */
+#define ZS_ALMOST_FULL_QUARTERS	3
+
+/* End of user params */
+
+enum fullness_group {
+	ZS_ALMOST_FULL,
+	ZS_ALMOST_EMPTY,
+	ZS_FULL,
+	_ZS_NR_FULLNESS_GROUPS,
+
+	ZS_EMPTY,	/* never on a list: freed right away */
+};
+
+/* Bit in zs_handle.flags held while the object is mapped or moved */
+#define HANDLE_PIN_BIT	0
+
+/*
+ * What zs_malloc() hands out. The indirection is what allows
+ * compaction to move an object without the user noticing.
+ */
+struct zs_handle {
+	struct zspage *zspage;
+	unsigned int idx;
+	unsigned long flags;
+};
+
+/*
+ * A slot either points to the zs_handle of the object stored there or,
+ * when free, has SLOT_FREE set and holds the index of the next free slot.
+ */
+#define SLOT_FREE		1UL
+#define slot_is_free(s)		((s) & SLOT_FREE)
+#define free_slot(next)		(((unsigned long)(next) << 1) | SLOT_FREE)
+#define free_slot_next(s)	((unsigned int)((s) >> 1))
+
+struct zspage {
+	struct size_class *class;
+	struct list_head list;
+	unsigned int inuse;
+	unsigned int free_idx;		/* == objs_per_zspage when full */
+	enum fullness_group fullness;
+	struct page *pages[ZS_MAX_PAGES_PER_ZSPAGE];
+	unsigned long slots[0];
+};
+
+struct size_class {
+	spinlock_t lock;
+	unsigned int size;
+	unsigned int pages_per_zspage;
+	unsigned int objs_per_zspage;
+	struct list_head fullness_list[_ZS_NR_FULLNESS_GROUPS];
+
+	/* Protected by lock */
+	unsigned long zspages;
+	unsigned long objs_inuse;
+};
+
+/* Per-cpu bounce buffer for mapping objects that span two pages */
+struct mapping_area {
+	char *buf;
+	char *vaddr;		/* kmap_atomic() address, single page case */
+	enum zs_mapmode mm;
+};
+
+struct zs_pool {
+	struct size_class size_class[ZS_SIZE_CLASSES];
+	struct mapping_area __percpu *area;
+	struct shrinker shrinker;
+
+	atomic_long_t pages_allocated;
+	atomic_long_t pages_compacted;
+};
+
+#endif
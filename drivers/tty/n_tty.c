@@ -1341,6 +1341,77 @@ static void n_tty_write_wakeup(struct tty_struct *tty)
 		kill_fasync(&tty->fasync, SIGIO, POLL_OUT);
 }
 
+/**
+ *	n_tty_copy_to_read_buf	-	bulk copy into the read queue
+ *	@tty: terminal device
+ *	@cp: buffer
+ *	@count: characters
+ *
+ *	Copy a block of characters that need no processing into the
+ *	read queue, taking the read lock only once. Characters that do
+ *	not fit are dropped, as they would be by put_tty_queue().
+ *
+ *	Locking: read_lock
+ */
+
+static void n_tty_copy_to_read_buf(struct tty_struct *tty,
+				   const unsigned char *cp, int count)
+{
+	unsigned long cpuflags;
+	int i;
+
+	spin_lock_irqsave(&tty->read_lock, cpuflags);
+	i = min(N_TTY_BUF_SIZE - tty->read_cnt,
+		N_TTY_BUF_SIZE - tty->read_head);
+	i = min(count, i);
+	memcpy(tty->read_buf + tty->read_head, cp, i);
+	tty->read_head = (tty->read_head + i) & (N_TTY_BUF_SIZE-1);
+	tty->read_cnt += i;
+	cp += i;
+	count -= i;
+
+	i = min(N_TTY_BUF_SIZE - tty->read_cnt,
+		N_TTY_BUF_SIZE - tty->read_head);
+	i = min(count, i);
+	memcpy(tty->read_buf + tty->read_head, cp, i);
+	tty->read_head = (tty->read_head + i) & (N_TTY_BUF_SIZE-1);
+	tty->read_cnt += i;
+	spin_unlock_irqrestore(&tty->read_lock, cpuflags);
+}
+
+/**
+ *	n_tty_receive_flagged	-	process one received character
+ *	@tty: terminal device
+ *	@c: character
+ *	@flags: flag the driver attached to the character
+ */
+
+static void n_tty_receive_flagged(struct tty_struct *tty, unsigned char c,
+				  char flags)
+{
+	char buf[64];
+
+	switch (flags) {
+	case TTY_NORMAL:
+		n_tty_receive_char(tty, c);
+		break;
+	case TTY_BREAK:
+		n_tty_receive_break(tty);
+		break;
+	case TTY_PARITY:
+	case TTY_FRAME:
+		n_tty_receive_parity_error(tty, c);
+		break;
+	case TTY_OVERRUN:
+		n_tty_receive_overrun(tty);
+		break;
+	default:
+		printk(KERN_ERR "%s: unknown flag %d\n",
+		       tty_name(tty, buf), flags);
+		break;
+	}
+}
+
 /**
  *	n_tty_receive_buf	-	data receive
  *	@tty: terminal device
@@ -1360,53 +1431,40 @@ static void n_tty_receive_buf(struct tty_struct *tty, const unsigned char *cp,
 	const unsigned char *p;
 	char *f, flags = TTY_NORMAL;
 	int	i;
-	char	buf[64];
-	unsigned long cpuflags;
 
 	if (!tty->read_buf)
 		return;
 
 	if (tty->real_raw) {
-		spin_lock_irqsave(&tty->read_lock, cpuflags);
-		i = min(N_TTY_BUF_SIZE - tty->read_cnt,
-			N_TTY_BUF_SIZE - tty->read_head);
-		i = min(count, i);
-		memcpy(tty->read_buf + tty->read_head, cp, i);
-		tty->read_head = (tty->read_head + i) & (N_TTY_BUF_SIZE-1);
-		tty->read_cnt += i;
-		cp += i;
-		count -= i;
-
-		i = min(N_TTY_BUF_SIZE - tty->read_cnt,
-			N_TTY_BUF_SIZE - tty->read_head);
-		i = min(count, i);
-		memcpy(tty->read_buf + tty->read_head, cp, i);
-		tty->read_head = (tty->read_head + i) & (N_TTY_BUF_SIZE-1);
-		tty->read_cnt += i;
-		spin_unlock_irqrestore(&tty->read_lock, cpuflags);
+		n_tty_copy_to_read_buf(tty, cp, count);
+	} else if (tty->raw) {
+		/*
+		 * No character needs processing, only the flags have to be
+		 * looked at: copy each run of normal characters in one go.
+		 */
+		while (count) {
+			if (fp) {
+				for (i = 0; i < count && fp[i] == TTY_NORMAL;
+				     i++)
+					;
+			} else
+				i = count;
+			if (i) {
+				n_tty_copy_to_read_buf(tty, cp, i);
+				cp += i;
+				if (fp)
+					fp += i;
+				count -= i;
+				continue;
+			}
+			n_tty_receive_flagged(tty, *cp++, *fp++);
+			count--;
+		}
 	} else {
 		for (i = count, p = cp, f = fp; i; i--, p++) {
 			if (f)
 				flags = *f++;
-			switch (flags) {
-			case TTY_NORMAL:
-				n_tty_receive_char(tty, *p);
-				break;
-			case TTY_BREAK:
-				n_tty_receive_break(tty);
-				break;
-			case TTY_PARITY:
-			case TTY_FRAME:
-				n_tty_receive_parity_error(tty, *p);
-				break;
-			case TTY_OVERRUN:
-				n_tty_receive_overrun(tty);
-				break;
-			default:
-				printk(KERN_ERR "%s: unknown flag %d\n",
-				       tty_name(tty, buf), flags);
-				break;
-			}
+			n_tty_receive_flagged(tty, *p, flags);
 		}
 		if (tty->ops->flush_chars)
 			tty->ops->flush_chars(tty);
@@ -63,6 +63,8 @@ static struct tty_buffer *tty_buffer_alloc(struct tty_struct *tty, size_t size)
 	p = kmalloc(sizeof(struct tty_buffer) + 2 * size, GFP_ATOMIC);
 	if (p == NULL)
 		return NULL;
+	/* Use the slack the allocator gave us, the ldisc gets larger chunks */
+	size = (ksize(p) - sizeof(struct tty_buffer)) / 2;
 	p->used = 0;
 	p->size = size;
 	p->next = NULL;
@@ -76,6 +76,11 @@
  *   - MS-Windows drivers sometimes emit undocumented requests.
  */
 
+static unsigned rndis_max_pkt_per_xfer = 4;
+module_param(rndis_max_pkt_per_xfer, uint, S_IRUGO);
+MODULE_PARM_DESC(rndis_max_pkt_per_xfer,
+		"RNDIS packets the host may send in one transfer");
+
 struct rndis_ep_descs {
 	struct usb_endpoint_descriptor	*in;
 	struct usb_endpoint_descriptor	*out;
@@ -396,6 +401,11 @@ static void rndis_command_complete(struct usb_ep *ep, struct usb_request *req)
 	if (status < 0)
 		ERROR(cdev, "RNDIS command error %d, %d/%d\n",
 			status, req->actual, req->length);
+
+	/* REMOTE_NDIS_INITIALIZE_MSG tells how much the host takes
+	 * per IN transfer; u_ether packs frames up to that size.
+	 */
+	rndis->port.tx_aggr_size = rndis_host_max_transfer(rndis->config);
 //	spin_unlock(&dev->lock);
 }
 
@@ -512,6 +522,10 @@ static int rndis_set_alt(struct usb_function *f, unsigned intf, unsigned alt)
 		/* Avoid ZLPs; they can be troublesome. */
 		rndis->port.is_zlp_ok = false;
 
+		/* nothing goes out aggregated before the host's INIT */
+		rndis->port.rx_aggr_frames = rndis_max_pkt_per_xfer;
+		rndis->port.tx_aggr_size = 0;
+
 		/* RNDIS should be in the "RNDIS uninitialized" state,
 		 * either never activated or after rndis_uninit().
 		 *
@@ -704,6 +718,7 @@ rndis_bind(struct usb_configuration *c, struct usb_function *f)
 	rndis->config = status;
 
 	rndis_set_param_medium(rndis->config, NDIS_MEDIUM_802_3, 0);
+	rndis_set_param_max_pkt_xfer(rndis->config, rndis_max_pkt_per_xfer);
 	rndis_set_host_mac(rndis->config, rndis->ethaddr);
 
 #if 0
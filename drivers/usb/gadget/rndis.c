@@ -569,10 +569,14 @@ static int rndis_init_response(int configNr, rndis_init_msg_type *buf)
 	rndis_init_cmplt_type *resp;
 	rndis_resp_t *r;
 	struct rndis_params *params = rndis_per_dev_params + configNr;
+	u32 max_pkt = params->max_pkt_per_xfer ? : 1;
 
 	if (!params->dev)
 		return -ENOTSUPP;
 
+	/* how much we may pack into one transfer towards the host */
+	params->host_max_transfer = le32_to_cpu(buf->MaxTransferSize);
+
 	r = rndis_add_response(configNr, sizeof(rndis_init_cmplt_type));
 	if (!r)
 		return -ENOMEM;
@@ -586,12 +590,12 @@ static int rndis_init_response(int configNr, rndis_init_msg_type *buf)
 	resp->MinorVersion = cpu_to_le32(RNDIS_MINOR_VERSION);
 	resp->DeviceFlags = cpu_to_le32(RNDIS_DF_CONNECTIONLESS);
 	resp->Medium = cpu_to_le32(RNDIS_MEDIUM_802_3);
-	resp->MaxPacketsPerTransfer = cpu_to_le32(1);
-	resp->MaxTransferSize = cpu_to_le32(
+	resp->MaxPacketsPerTransfer = cpu_to_le32(max_pkt);
+	resp->MaxTransferSize = cpu_to_le32(max_pkt * (
 		  params->dev->mtu
 		+ sizeof(struct ethhdr)
 		+ sizeof(struct rndis_packet_msg_type)
-		+ 22);
+		+ 22));
 	resp->PacketAlignmentFactor = cpu_to_le32(0);
 	resp->AFListOffset = cpu_to_le32(0);
 	resp->AFListSize = cpu_to_le32(0);
@@ -780,6 +784,7 @@ void rndis_uninit(int configNr)
 	if (configNr >= RNDIS_MAX_CONFIGS)
 		return;
 	rndis_per_dev_params[configNr].state = RNDIS_UNINITIALIZED;
+	rndis_per_dev_params[configNr].host_max_transfer = 0;
 
 	/* drain the response queue */
 	while ((buf = rndis_get_next_response(configNr, &length)))
@@ -956,6 +961,26 @@ int rndis_set_param_medium(u8 configNr, u32 medium, u32 speed)
 	return 0;
 }
 
+/* number of packets the host may send in one OUT transfer */
+int rndis_set_param_max_pkt_xfer(u8 configNr, u32 max_pkt_per_xfer)
+{
+	pr_debug("%s: %u\n", __func__, max_pkt_per_xfer);
+	if (configNr >= RNDIS_MAX_CONFIGS) return -1;
+
+	rndis_per_dev_params[configNr].max_pkt_per_xfer = max_pkt_per_xfer;
+
+	return 0;
+}
+
+/* IN transfer size the host announced in REMOTE_NDIS_INITIALIZE_MSG,
+ * zero until it did */
+u32 rndis_host_max_transfer(int configNr)
+{
+	if (configNr >= RNDIS_MAX_CONFIGS)
+		return 0;
+	return rndis_per_dev_params[configNr].host_max_transfer;
+}
+
 void rndis_add_hdr(struct sk_buff *skb)
 {
 	struct rndis_packet_msg_type *header;
@@ -1024,30 +1049,65 @@ static rndis_resp_t *rndis_add_response(int configNr, u32 length)
 	return r;
 }
 
+/*
+ * One OUT transfer holds up to MaxPacketsPerTransfer packet messages
+ * back to back, possibly followed by padding.  All but the last are
+ * split off as clones sharing the transfer's buffer.
+ */
 int rndis_rm_hdr(struct gether *port,
 			struct sk_buff *skb,
 			struct sk_buff_head *list)
 {
-	/* tmp points to a struct rndis_packet_msg_type */
-	__le32 *tmp = (void *)skb->data;
+	struct sk_buff *skb2;
+	u32 msg_len, data_offset, data_len;
+
+	for (;;) {
+		/* tmp points to a struct rndis_packet_msg_type */
+		__le32 *tmp = (void *)skb->data;
+
+		if (skb->len < sizeof(struct rndis_packet_msg_type))
+			goto err;
+
+		/* MessageType, MessageLength */
+		if (cpu_to_le32(REMOTE_NDIS_PACKET_MSG)
+				!= get_unaligned(tmp++))
+			goto err;
+		msg_len = get_unaligned_le32(tmp++);
+
+		/* DataOffset, DataLength */
+		data_offset = get_unaligned_le32(tmp++) + 8;
+		data_len = get_unaligned_le32(tmp++);
+		if (msg_len > skb->len || data_offset > msg_len
+				|| data_len > msg_len - data_offset) {
+			dev_kfree_skb_any(skb);
+			return -EOVERFLOW;
+		}
 
-	/* MessageType, MessageLength */
-	if (cpu_to_le32(REMOTE_NDIS_PACKET_MSG)
-			!= get_unaligned(tmp++)) {
-		dev_kfree_skb_any(skb);
-		return -EINVAL;
-	}
-	tmp++;
+		/* no room for another message: this is the last one */
+		if (skb->len - msg_len < sizeof(struct rndis_packet_msg_type))
+			break;
+
+		skb2 = skb_clone(skb, GFP_ATOMIC);
+		if (!skb2) {
+			dev_kfree_skb_any(skb);
+			return -ENOMEM;
+		}
+		skb_pull(skb2, data_offset);
+		skb_trim(skb2, data_len);
+		skb_queue_tail(list, skb2);
 
-	/* DataOffset, DataLength */
-	if (!skb_pull(skb, get_unaligned_le32(tmp++) + 8)) {
-		dev_kfree_skb_any(skb);
-		return -EOVERFLOW;
+		skb_pull(skb, msg_len);
 	}
-	skb_trim(skb, get_unaligned_le32(tmp++));
+
+	skb_pull(skb, data_offset);
+	skb_trim(skb, data_len);
 
 	skb_queue_tail(list, skb);
 	return 0;
+
+err:
+	dev_kfree_skb_any(skb);
+	return -EINVAL;
 }
 
 #ifdef CONFIG_USB_GADGET_DEBUG_FILES
@@ -236,6 +236,8 @@ typedef struct rndis_params
 
 	u32			vendorID;
 	const char		*vendorDescr;
+	u32			max_pkt_per_xfer;
+	u32			host_max_transfer;
 	void			(*resp_avail)(void *v);
 	void			*v;
 	struct list_head	resp_queue;
@@ -250,6 +252,8 @@ int  rndis_set_param_dev (u8 configNr, struct net_device *dev,
 int  rndis_set_param_vendor (u8 configNr, u32 vendorID,
 			    const char *vendorDescr);
 int  rndis_set_param_medium (u8 configNr, u32 medium, u32 speed);
+int  rndis_set_param_max_pkt_xfer(u8 configNr, u32 max_pkt_per_xfer);
+u32  rndis_host_max_transfer(int configNr);
 void rndis_add_hdr (struct sk_buff *skb);
 int rndis_rm_hdr(struct gether *port, struct sk_buff *skb,
 			struct sk_buff_head *list);
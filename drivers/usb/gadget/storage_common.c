@@ -262,8 +262,27 @@ static struct fsg_lun *fsg_lun_from_dev(struct device *dev)
 #define EP0_BUFSIZE	256
 #define DELAYED_STATUS	(EP0_BUFSIZE + 999)	/* An impossibly large value */
 
-/* Number of buffers we will use.  2 is enough for double-buffering */
-#define FSG_NUM_BUFFERS	2
+/*
+ * Number of buffers we will use.  2 is enough for double-buffering;
+ * with more, reads from the backing file run further ahead of the IN
+ * transfers and OUT transfers further ahead of the writes.
+ */
+static unsigned int fsg_num_buffers = CONFIG_USB_GADGET_STORAGE_NUM_BUFFERS;
+module_param_named(num_buffers, fsg_num_buffers, uint, S_IRUGO);
+MODULE_PARM_DESC(num_buffers, "Number of pipeline buffers");
+
+#define FSG_MIN_BUFFERS	2
+#define FSG_MAX_BUFFERS	32
+
+static inline int fsg_num_buffers_validate(void)
+{
+	if (fsg_num_buffers >= FSG_MIN_BUFFERS &&
+	    fsg_num_buffers <= FSG_MAX_BUFFERS)
+		return 0;
+	pr_err("fsg_num_buffers %u is out of range (%d to %d)\n",
+	       fsg_num_buffers, FSG_MIN_BUFFERS, FSG_MAX_BUFFERS);
+	return -EINVAL;
+}
 
 /* Default size of buffer length. */
 #define FSG_BUFLEN	((u32)16384)
@@ -28,6 +28,7 @@
 #include <linux/ctype.h>
 #include <linux/etherdevice.h>
 #include <linux/ethtool.h>
+#include <linux/hrtimer.h>
 
 #include "u_ether.h"
 
@@ -65,11 +66,16 @@ struct eth_dev {
 	struct net_device	*net;
 	struct usb_gadget	*gadget;
 
-	spinlock_t		req_lock;	/* guard {rx,tx}_reqs */
+	spinlock_t		req_lock;	/* guard {rx,tx}_reqs, tx_aggr */
 	struct list_head	tx_reqs, rx_reqs;
 	atomic_t		tx_qlen;
 
+	/* frames waiting to go out together in one IN transfer */
+	struct sk_buff		*tx_aggr;
+	struct hrtimer		tx_aggr_timer;
+
 	struct sk_buff_head	rx_frames;
+	struct napi_struct	napi;
 
 	unsigned		header_len;
 	struct sk_buff		*(*wrap)(struct gether *, struct sk_buff *skb);
@@ -92,6 +98,8 @@ struct eth_dev {
 
 #define DEFAULT_QLEN	2	/* double buffering by default */
 
+#define ETH_NAPI_WEIGHT	64
+
 
 #ifdef CONFIG_USB_GADGET_DUALSPEED
 
@@ -103,6 +111,17 @@ MODULE_PARM_DESC(qmult, "queue length multiplier at high speed");
 #define qmult		1
 #endif
 
+static unsigned tx_aggr_max = 8192;
+module_param(tx_aggr_max, uint, S_IRUGO|S_IWUSR);
+MODULE_PARM_DESC(tx_aggr_max, "max bytes of frames packed per IN transfer");
+
+static unsigned tx_aggr_usecs = 100;
+module_param(tx_aggr_usecs, uint, S_IRUGO|S_IWUSR);
+MODULE_PARM_DESC(tx_aggr_usecs, "max usecs a frame waits to be packed");
+
+/* number of frames in a tx skb, for the statistics */
+#define TX_FRAMES(skb)	(*(unsigned *)(skb)->cb)
+
 /* for dual-speed hardware, use deeper queues at highspeed */
 static inline int qlen(struct usb_gadget *gadget)
 {
@@ -237,6 +256,8 @@ rx_submit(struct eth_dev *dev, struct usb_request *req, gfp_t gfp_flags)
 	 */
 	size += sizeof(struct ethhdr) + dev->net->mtu + RX_EXTRA;
 	size += dev->port_usb->header_len;
+	if (dev->port_usb->rx_aggr_frames > 1)
+		size *= dev->port_usb->rx_aggr_frames;
 	size += out->maxpacket - 1;
 	size -= size % out->maxpacket;
 
@@ -280,53 +301,48 @@ static void rx_complete(struct usb_ep *ep, struct usb_request *req)
 	struct sk_buff	*skb = req->context, *skb2;
 	struct eth_dev	*dev = ep->driver_data;
 	int		status = req->status;
+	struct sk_buff_head frames;
+	unsigned long	flags;
 
 	switch (status) {
 
 	/* normal completion */
 	case 0:
 		skb_put(skb, req->actual);
+		skb_queue_head_init(&frames);
 
 		if (dev->unwrap) {
-			unsigned long	flags;
-
 			spin_lock_irqsave(&dev->lock, flags);
 			if (dev->port_usb) {
 				status = dev->unwrap(dev->port_usb,
 							skb,
-							&dev->rx_frames);
+							&frames);
 			} else {
 				dev_kfree_skb_any(skb);
 				status = -ENOTCONN;
 			}
 			spin_unlock_irqrestore(&dev->lock, flags);
 		} else {
-			skb_queue_tail(&dev->rx_frames, skb);
+			__skb_queue_tail(&frames, skb);
 		}
 		skb = NULL;
 
-		skb2 = skb_dequeue(&dev->rx_frames);
-		while (skb2) {
-			if (status < 0
-					|| ETH_HLEN > skb2->len
-					|| skb2->len > ETH_FRAME_LEN) {
+		/* a framing error invalidates the whole transfer */
+		if (status < 0) {
+			while ((skb2 = __skb_dequeue(&frames))) {
 				dev->net->stats.rx_errors++;
 				dev->net->stats.rx_length_errors++;
 				DBG(dev, "rx length %d\n", skb2->len);
 				dev_kfree_skb_any(skb2);
-				goto next_frame;
 			}
-			skb2->protocol = eth_type_trans(skb2, dev->net);
-			dev->net->stats.rx_packets++;
-			dev->net->stats.rx_bytes += skb2->len;
-
-			/* no buffer copies needed, unless hardware can't
-			 * use skb buffers.
-			 */
-			status = netif_rx(skb2);
-next_frame:
-			skb2 = skb_dequeue(&dev->rx_frames);
+			break;
 		}
+
+		/* eth_poll() hands the frames to the stack in batches */
+		spin_lock_irqsave(&dev->rx_frames.lock, flags);
+		skb_queue_splice_tail_init(&frames, &dev->rx_frames);
+		spin_unlock_irqrestore(&dev->rx_frames.lock, flags);
+		napi_schedule(&dev->napi);
 		break;
 
 	/* software-driven interface shutdown */
@@ -367,6 +383,41 @@ clean:
 		rx_submit(dev, req, GFP_ATOMIC);
 }
 
+static int eth_poll(struct napi_struct *napi, int budget)
+{
+	struct eth_dev	*dev = container_of(napi, struct eth_dev, napi);
+	struct sk_buff	*skb;
+	int		work_done = 0;
+
+	while (work_done < budget &&
+			(skb = skb_dequeue(&dev->rx_frames)) != NULL) {
+		work_done++;
+		if (ETH_HLEN > skb->len || skb->len > ETH_FRAME_LEN) {
+			dev->net->stats.rx_errors++;
+			dev->net->stats.rx_length_errors++;
+			DBG(dev, "rx length %d\n", skb->len);
+			dev_kfree_skb(skb);
+			continue;
+		}
+		skb->protocol = eth_type_trans(skb, dev->net);
+		dev->net->stats.rx_packets++;
+		dev->net->stats.rx_bytes += skb->len;
+
+		/* no buffer copies needed, unless hardware can't
+		 * use skb buffers.
+		 */
+		napi_gro_receive(napi, skb);
+	}
+
+	if (work_done < budget) {
+		napi_complete(napi);
+		/* rx_complete() may have queued more after our last check */
+		if (!skb_queue_empty(&dev->rx_frames))
+			napi_reschedule(napi);
+	}
+	return work_done;
+}
+
 static int prealloc(struct list_head *list, struct usb_ep *ep, unsigned n)
 {
 	unsigned		i;
@@ -461,6 +512,89 @@ static void eth_work(struct work_struct *work)
 		DBG(dev, "work done, flags = 0x%lx\n", dev->todo);
 }
 
+static void tx_complete(struct usb_ep *ep, struct usb_request *req);
+
+/* Put back a request that could not be queued. */
+static void eth_tx_recycle(struct eth_dev *dev, struct usb_request *req)
+{
+	unsigned long	flags;
+
+	spin_lock_irqsave(&dev->req_lock, flags);
+	if (list_empty(&dev->tx_reqs))
+		netif_start_queue(dev->net);
+	list_add(&req->list, &dev->tx_reqs);
+	spin_unlock_irqrestore(&dev->req_lock, flags);
+}
+
+/* Queue a wrapped @skb on @req, taken off dev->tx_reqs. */
+static void eth_tx_submit(struct eth_dev *dev, struct usb_request *req,
+		struct sk_buff *skb)
+{
+	struct net_device	*net = dev->net;
+	int			length = skb->len;
+	int			retval;
+	struct usb_ep		*in = NULL;
+	bool			is_fixed = false;
+	u32			fixed_in_len = 0;
+	unsigned long		flags;
+
+	spin_lock_irqsave(&dev->lock, flags);
+	if (dev->port_usb) {
+		in = dev->port_usb->in_ep;
+		is_fixed = dev->port_usb->is_fixed;
+		fixed_in_len = dev->port_usb->fixed_in_len;
+	}
+	spin_unlock_irqrestore(&dev->lock, flags);
+
+	if (!in) {
+		retval = -ENOTCONN;
+		goto drop;
+	}
+
+	req->buf = skb->data;
+	req->context = skb;
+	req->complete = tx_complete;
+
+	/* NCM requires no zlp if transfer is dwNtbInMaxSize */
+	if (is_fixed &&
+	    length == fixed_in_len &&
+	    (length % in->maxpacket) == 0)
+		req->zero = 0;
+	else
+		req->zero = 1;
+
+	/* use zlp framing on tx for strict CDC-Ether conformance,
+	 * though any robust network rx path ignores extra padding.
+	 * and some hardware doesn't like to write zlps.
+	 */
+	if (req->zero && !dev->zlp && (length % in->maxpacket) == 0)
+		length++;
+
+	req->length = length;
+
+	/* throttle highspeed IRQ rate back slightly */
+	if (gadget_is_dualspeed(dev->gadget))
+		req->no_interrupt = (dev->gadget->speed == USB_SPEED_HIGH)
+			? ((atomic_read(&dev->tx_qlen) % qmult) != 0)
+			: 0;
+
+	retval = usb_ep_queue(in, req, GFP_ATOMIC);
+	switch (retval) {
+	default:
+		DBG(dev, "tx queue err %d\n", retval);
+		break;
+	case 0:
+		net->trans_start = jiffies;
+		atomic_inc(&dev->tx_qlen);
+		return;
+	}
+
+drop:
+	net->stats.tx_dropped += TX_FRAMES(skb);
+	dev_kfree_skb_any(skb);
+	eth_tx_recycle(dev, req);
+}
+
 static void tx_complete(struct usb_ep *ep, struct usb_request *req)
 {
 	struct sk_buff	*skb = req->context;
@@ -477,14 +611,24 @@ static void tx_complete(struct usb_ep *ep, struct usb_request *req)
 	case 0:
 		dev->net->stats.tx_bytes += skb->len;
 	}
-	dev->net->stats.tx_packets++;
+	dev->net->stats.tx_packets += TX_FRAMES(skb);
+	dev_kfree_skb_any(skb);
 
+	/* frames gathered while this one was in flight go out next */
 	spin_lock(&dev->req_lock);
-	list_add(&req->list, &dev->tx_reqs);
+	if (req->status == 0 && dev->tx_aggr) {
+		skb = dev->tx_aggr;
+		dev->tx_aggr = NULL;
+		hrtimer_try_to_cancel(&dev->tx_aggr_timer);
+	} else {
+		list_add(&req->list, &dev->tx_reqs);
+		skb = NULL;
+	}
 	spin_unlock(&dev->req_lock);
-	dev_kfree_skb_any(skb);
 
 	atomic_dec(&dev->tx_qlen);
+	if (skb)
+		eth_tx_submit(dev, req, skb);
 	if (netif_carrier_ok(dev->net))
 		netif_wake_queue(dev->net);
 }
@@ -494,27 +638,175 @@ static inline int is_promisc(u16 cdc_filter)
 	return cdc_filter & USB_CDC_PACKET_TYPE_PROMISCUOUS;
 }
 
+/* no buffer copies needed, unless the network stack did it
+ * or the hardware can't use skb buffers.
+ * or there's not enough space for extra headers we need
+ */
+static struct sk_buff *eth_wrap(struct eth_dev *dev, struct sk_buff *skb)
+{
+	unsigned long	flags;
+
+	if (!dev->wrap)
+		return skb;
+
+	spin_lock_irqsave(&dev->lock, flags);
+	if (dev->port_usb) {
+		skb = dev->wrap(dev->port_usb, skb);
+	} else {
+		dev_kfree_skb_any(skb);
+		skb = NULL;
+	}
+	spin_unlock_irqrestore(&dev->lock, flags);
+
+	return skb;
+}
+
+static enum hrtimer_restart eth_tx_aggr_flush(struct hrtimer *timer)
+{
+	struct eth_dev		*dev =
+		container_of(timer, struct eth_dev, tx_aggr_timer);
+	struct usb_request	*req = NULL;
+	struct sk_buff		*skb = NULL;
+	unsigned long		flags;
+
+	/* with every request busy, tx_complete() sends the frames */
+	spin_lock_irqsave(&dev->req_lock, flags);
+	if (dev->tx_aggr && !list_empty(&dev->tx_reqs)) {
+		req = container_of(dev->tx_reqs.next,
+				struct usb_request, list);
+		list_del(&req->list);
+		skb = dev->tx_aggr;
+		dev->tx_aggr = NULL;
+	}
+	spin_unlock_irqrestore(&dev->req_lock, flags);
+
+	if (skb)
+		eth_tx_submit(dev, req, skb);
+	return HRTIMER_NORESTART;
+}
+
+/* Drop frames still waiting to be packed, on link or interface down. */
+static void eth_tx_aggr_drop(struct eth_dev *dev)
+{
+	struct sk_buff		*skb;
+	unsigned long		flags;
+
+	hrtimer_cancel(&dev->tx_aggr_timer);
+
+	spin_lock_irqsave(&dev->req_lock, flags);
+	skb = dev->tx_aggr;
+	dev->tx_aggr = NULL;
+	spin_unlock_irqrestore(&dev->req_lock, flags);
+
+	if (skb) {
+		dev->net->stats.tx_dropped += TX_FRAMES(skb);
+		dev_kfree_skb_any(skb);
+	}
+}
+
+/*
+ * Framings like RNDIS let several frames share one IN transfer, which
+ * saves the per-request cost of the (MUSB/TUSB) controller.  A frame
+ * for an idle link still goes out at once; otherwise it is copied
+ * behind the frames gathered so far, and the lot is sent when a
+ * request completes, when it is full, or after tx_aggr_usecs.
+ */
+static netdev_tx_t eth_xmit_aggr(struct eth_dev *dev, struct sk_buff *skb,
+		unsigned limit)
+{
+	struct usb_request	*req = NULL;
+	struct sk_buff		*full = NULL;
+	struct sk_buff		*aggr;
+	unsigned long		flags;
+
+	spin_lock_irqsave(&dev->req_lock, flags);
+	if (dev->tx_aggr &&
+	    dev->tx_aggr->len + dev->header_len + skb->len > limit) {
+		if (list_empty(&dev->tx_reqs)) {
+			/* tx_complete() sends the full one and wakes us */
+			netif_stop_queue(dev->net);
+			spin_unlock_irqrestore(&dev->req_lock, flags);
+			return NETDEV_TX_BUSY;
+		}
+		req = container_of(dev->tx_reqs.next,
+				struct usb_request, list);
+		list_del(&req->list);
+		full = dev->tx_aggr;
+		dev->tx_aggr = NULL;
+		hrtimer_try_to_cancel(&dev->tx_aggr_timer);
+	}
+	spin_unlock_irqrestore(&dev->req_lock, flags);
+
+	if (full)
+		eth_tx_submit(dev, req, full);
+
+	skb = eth_wrap(dev, skb);
+	if (!skb) {
+		dev->net->stats.tx_dropped++;
+		return NETDEV_TX_OK;
+	}
+
+	spin_lock_irqsave(&dev->req_lock, flags);
+	aggr = dev->tx_aggr;
+	if (!aggr) {
+		if (!atomic_read(&dev->tx_qlen) && !list_empty(&dev->tx_reqs)) {
+			/* nothing in flight, so nothing to wait for */
+			req = container_of(dev->tx_reqs.next,
+					struct usb_request, list);
+			list_del(&req->list);
+			spin_unlock_irqrestore(&dev->req_lock, flags);
+
+			TX_FRAMES(skb) = 1;
+			eth_tx_submit(dev, req, skb);
+			return NETDEV_TX_OK;
+		}
+
+		aggr = alloc_skb(limit, GFP_ATOMIC);
+		if (!aggr) {
+			spin_unlock_irqrestore(&dev->req_lock, flags);
+			dev->net->stats.tx_dropped++;
+			dev_kfree_skb_any(skb);
+			return NETDEV_TX_OK;
+		}
+		TX_FRAMES(aggr) = 0;
+		dev->tx_aggr = aggr;
+		hrtimer_start(&dev->tx_aggr_timer,
+				ns_to_ktime(tx_aggr_usecs * NSEC_PER_USEC),
+				HRTIMER_MODE_REL);
+	}
+	memcpy(skb_put(aggr, skb->len), skb->data, skb->len);
+	TX_FRAMES(aggr)++;
+	spin_unlock_irqrestore(&dev->req_lock, flags);
+
+	dev_kfree_skb_any(skb);
+	return NETDEV_TX_OK;
+}
+
 static netdev_tx_t eth_start_xmit(struct sk_buff *skb,
 					struct net_device *net)
 {
 	struct eth_dev		*dev = netdev_priv(net);
-	int			length = skb->len;
-	int			retval;
 	struct usb_request	*req = NULL;
 	unsigned long		flags;
 	struct usb_ep		*in;
 	u16			cdc_filter;
+	unsigned		aggr_size = 0;
 
 	spin_lock_irqsave(&dev->lock, flags);
 	if (dev->port_usb) {
 		in = dev->port_usb->in_ep;
 		cdc_filter = dev->port_usb->cdc_filter;
+		aggr_size = min(dev->port_usb->tx_aggr_size, tx_aggr_max);
 	} else {
 		in = NULL;
 		cdc_filter = 0;
 	}
 	spin_unlock_irqrestore(&dev->lock, flags);
 
+	/* leave room for the byte eth_tx_submit() may pad with */
+	if (aggr_size && !dev->zlp)
+		aggr_size--;
+
 	if (!in) {
 		dev_kfree_skb_any(skb);
 		return NETDEV_TX_OK;
@@ -542,6 +834,10 @@ static netdev_tx_t eth_start_xmit(struct sk_buff *skb,
 		/* ignores USB_CDC_PACKET_TYPE_DIRECTED */
 	}
 
+	/* pack the frame with others if the link allows */
+	if (aggr_size && skb->len + dev->header_len <= aggr_size)
+		return eth_xmit_aggr(dev, skb, aggr_size);
+
 	spin_lock_irqsave(&dev->req_lock, flags);
 	/*
 	 * this freelist can be empty if an interrupt triggered disconnect()
@@ -561,69 +857,15 @@ static netdev_tx_t eth_start_xmit(struct sk_buff *skb,
 		netif_stop_queue(net);
 	spin_unlock_irqrestore(&dev->req_lock, flags);
 
-	/* no buffer copies needed, unless the network stack did it
-	 * or the hardware can't use skb buffers.
-	 * or there's not enough space for extra headers we need
-	 */
-	if (dev->wrap) {
-		unsigned long	flags;
-
-		spin_lock_irqsave(&dev->lock, flags);
-		if (dev->port_usb)
-			skb = dev->wrap(dev->port_usb, skb);
-		spin_unlock_irqrestore(&dev->lock, flags);
-		if (!skb)
-			goto drop;
-
-		length = skb->len;
-	}
-	req->buf = skb->data;
-	req->context = skb;
-	req->complete = tx_complete;
-
-	/* NCM requires no zlp if transfer is dwNtbInMaxSize */
-	if (dev->port_usb->is_fixed &&
-	    length == dev->port_usb->fixed_in_len &&
-	    (length % in->maxpacket) == 0)
-		req->zero = 0;
-	else
-		req->zero = 1;
-
-	/* use zlp framing on tx for strict CDC-Ether conformance,
-	 * though any robust network rx path ignores extra padding.
-	 * and some hardware doesn't like to write zlps.
-	 */
-	if (req->zero && !dev->zlp && (length % in->maxpacket) == 0)
-		length++;
-
-	req->length = length;
-
-	/* throttle highspeed IRQ rate back slightly */
-	if (gadget_is_dualspeed(dev->gadget))
-		req->no_interrupt = (dev->gadget->speed == USB_SPEED_HIGH)
-			? ((atomic_read(&dev->tx_qlen) % qmult) != 0)
-			: 0;
-
-	retval = usb_ep_queue(in, req, GFP_ATOMIC);
-	switch (retval) {
-	default:
-		DBG(dev, "tx queue err %d\n", retval);
-		break;
-	case 0:
-		net->trans_start = jiffies;
-		atomic_inc(&dev->tx_qlen);
-	}
-
-	if (retval) {
-		dev_kfree_skb_any(skb);
-drop:
+	skb = eth_wrap(dev, skb);
+	if (!skb) {
 		dev->net->stats.tx_dropped++;
-		spin_lock_irqsave(&dev->req_lock, flags);
-		if (list_empty(&dev->tx_reqs))
-			netif_start_queue(net);
-		list_add(&req->list, &dev->tx_reqs);
-		spin_unlock_irqrestore(&dev->req_lock, flags);
+		eth_tx_recycle(dev, req);
+		return NETDEV_TX_OK;
 	}
+
+	TX_FRAMES(skb) = 1;
+	eth_tx_submit(dev, req, skb);
 	return NETDEV_TX_OK;
 }
 
@@ -647,6 +889,7 @@ static int eth_open(struct net_device *net)
 	struct gether	*link;
 
 	DBG(dev, "%s\n", __func__);
+	napi_enable(&dev->napi);
 	if (netif_carrier_ok(dev->net))
 		eth_start(dev, GFP_KERNEL);
 
@@ -666,6 +909,9 @@ static int eth_stop(struct net_device *net)
 
 	VDBG(dev, "%s\n", __func__);
 	netif_stop_queue(net);
+	eth_tx_aggr_drop(dev);
+	napi_disable(&dev->napi);
+	skb_queue_purge(&dev->rx_frames);
 
 	DBG(dev, "stop stats: rx/tx %ld/%ld, errs %ld/%ld\n",
 		dev->net->stats.rx_packets, dev->net->stats.tx_packets,
@@ -785,8 +1031,12 @@ int gether_setup(struct usb_gadget *g, u8 ethaddr[ETH_ALEN])
 
 	skb_queue_head_init(&dev->rx_frames);
 
+	hrtimer_init(&dev->tx_aggr_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	dev->tx_aggr_timer.function = eth_tx_aggr_flush;
+
 	/* network device setup */
 	dev->net = net;
+	netif_napi_add(net, &dev->napi, eth_poll, ETH_NAPI_WEIGHT);
 	strcpy(net->name, "usb%d");
 
 	if (get_ether_addr(dev_addr, net->dev_addr))
@@ -952,6 +1202,8 @@ void gether_disconnect(struct gether *link)
 	netif_stop_queue(dev->net);
 	netif_carrier_off(dev->net);
 
+	eth_tx_aggr_drop(dev);
+
 	/* disable endpoints, forcing (synchronous) completion
 	 * of all pending i/o.  then free the request objects
 	 * and forget about the endpoints.
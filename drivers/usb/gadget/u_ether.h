@@ -66,6 +66,12 @@ struct gether {
 	bool				is_fixed;
 	u32				fixed_out_len;
 	u32				fixed_in_len;
+	/* RNDIS may pack several frames into one transfer: the host
+	 * sends up to rx_aggr_frames per OUT transfer and accepts IN
+	 * transfers of up to tx_aggr_size bytes; zero disables.
+	 */
+	u32				rx_aggr_frames;
+	u32				tx_aggr_size;
 	struct sk_buff			*(*wrap)(struct gether *port,
 						struct sk_buff *skb);
 	int				(*unwrap)(struct gether *port,
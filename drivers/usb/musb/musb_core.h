@@ -308,6 +308,12 @@ struct musb_hw_ep {
 	dma_addr_t		fifo_async;
 	dma_addr_t		fifo_sync;
 	void __iomem		*fifo_sync_va;
+
+	/* bytes moved by dma and by pio, see debugfs "fifo_stats" */
+	unsigned long		tx_dma_bytes;
+	unsigned long		tx_pio_bytes;
+	unsigned long		rx_dma_bytes;
+	unsigned long		rx_pio_bytes;
 #endif
 
 #ifdef CONFIG_USB_MUSB_HDRC_HCD
@@ -151,6 +151,41 @@ static int musb_regdump_open(struct inode *inode, struct file *file)
 	return single_open(file, musb_regdump_show, inode->i_private);
 }
 
+#ifdef CONFIG_USB_MUSB_TUSB6010
+static int musb_fifo_stats_show(struct seq_file *s, void *unused)
+{
+	struct musb		*musb = s->private;
+	unsigned long		flags;
+	unsigned		i;
+
+	seq_printf(s, "ep     tx dma     tx pio     rx dma     rx pio\n");
+
+	spin_lock_irqsave(&musb->lock, flags);
+	for (i = 0; i < musb->nr_endpoints; i++) {
+		struct musb_hw_ep	*hw_ep = &musb->endpoints[i];
+
+		seq_printf(s, "%-2u %10lu %10lu %10lu %10lu\n", i,
+				hw_ep->tx_dma_bytes, hw_ep->tx_pio_bytes,
+				hw_ep->rx_dma_bytes, hw_ep->rx_pio_bytes);
+	}
+	spin_unlock_irqrestore(&musb->lock, flags);
+
+	return 0;
+}
+
+static int musb_fifo_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, musb_fifo_stats_show, inode->i_private);
+}
+
+static const struct file_operations musb_fifo_stats_fops = {
+	.open			= musb_fifo_stats_open,
+	.read			= seq_read,
+	.llseek			= seq_lseek,
+	.release		= single_release,
+};
+#endif
+
 static int musb_test_mode_show(struct seq_file *s, void *unused)
 {
 	struct musb		*musb = s->private;
@@ -275,6 +310,15 @@ int __init musb_init_debugfs(struct musb *musb)
 		goto err1;
 	}
 
+#ifdef CONFIG_USB_MUSB_TUSB6010
+	file = debugfs_create_file("fifo_stats", S_IRUGO, root, musb,
+			&musb_fifo_stats_fops);
+	if (IS_ERR(file)) {
+		ret = PTR_ERR(file);
+		goto err1;
+	}
+#endif
+
 	musb_debugfs_root = root;
 
 	return 0;
@@ -24,6 +24,23 @@
 #define to_chdat(c)		((struct tusb_omap_dma_ch *)(c)->private_data)
 
 #define MAX_DMAREQ		5	/* REVISIT: Really 6, but req5 not OK */
+#define MAX_DMA_CHANNELS	16
+
+/*
+ * With multichannel DMA the dmareq lines are handed out on demand to the
+ * endpoints moving the most data. An endpoint's load is the number of
+ * bytes it tried to move, halved for every TUSB_DMA_LOAD_PERIOD it was
+ * idle, and an idle line is only taken away from an endpoint with less
+ * than half the load of the one asking for it.
+ */
+#define TUSB_DMA_LOAD_PERIOD	(HZ / 10)
+
+struct tusb_omap_dma_slot {
+	struct dma_channel	*owner;
+	int			ch;
+	s8			dmareq;
+	s8			sync_dev;
+};
 
 struct tusb_omap_dma_ch {
 	struct musb		*musb;
@@ -36,6 +53,10 @@ struct tusb_omap_dma_ch {
 	int			ch;
 	s8			dmareq;
 	s8			sync_dev;
+	struct tusb_omap_dma_slot	*slot;
+
+	unsigned long		load;
+	unsigned long		load_stamp;
 
 	struct tusb_omap_dma	*tusb_dma;
 
@@ -57,6 +78,8 @@ struct tusb_omap_dma {
 	s8				dmareq;
 	s8				sync_dev;
 	unsigned			multichannel:1;
+
+	struct tusb_omap_dma_slot	slot[MAX_DMAREQ];
 };
 
 static int tusb_omap_dma_start(struct dma_controller *c)
@@ -116,6 +139,111 @@ static inline void tusb_omap_free_shared_dmareq(struct tusb_omap_dma_ch *chdat)
 	musb_writel(chdat->tbase, TUSB_DMA_EP_MAP, 0);
 }
 
+static unsigned long tusb_omap_dma_load(struct tusb_omap_dma_ch *chdat)
+{
+	unsigned long periods;
+
+	periods = (jiffies - chdat->load_stamp) / TUSB_DMA_LOAD_PERIOD;
+	if (periods >= BITS_PER_LONG)
+		return 0;
+
+	return chdat->load >> periods;
+}
+
+static void tusb_omap_dma_account(struct tusb_omap_dma_ch *chdat, u32 len)
+{
+	chdat->load = tusb_omap_dma_load(chdat) + len;
+	chdat->load_stamp = jiffies;
+}
+
+static void tusb_omap_dma_unbind(struct tusb_omap_dma_ch *chdat)
+{
+	struct tusb_omap_dma_slot	*slot = chdat->slot;
+	u32				reg;
+
+	omap_stop_dma(slot->ch);
+
+	reg = musb_readl(chdat->tbase, TUSB_DMA_EP_MAP);
+	reg &= ~(0x1f << (slot->dmareq * 5));
+	musb_writel(chdat->tbase, TUSB_DMA_EP_MAP, reg);
+
+	slot->owner = NULL;
+	chdat->slot = NULL;
+	chdat->ch = -1;
+	chdat->dmareq = -1;
+	chdat->sync_dev = -1;
+}
+
+static void tusb_omap_dma_cb(int lch, u16 ch_status, void *data);
+
+/*
+ * Give the channel a dmareq line and the OMAP DMA channel that goes with
+ * it, taking one away from a less busy idle endpoint if they are all in
+ * use. Called with musb->lock held.
+ */
+static int tusb_omap_dma_bind(struct dma_channel *channel)
+{
+	struct tusb_omap_dma_ch		*chdat = to_chdat(channel);
+	struct tusb_omap_dma		*tusb_dma = chdat->tusb_dma;
+	struct tusb_omap_dma_slot	*slot, *victim = NULL;
+	unsigned long			load, victim_load = 0;
+	u32				reg;
+	int				i, ret;
+
+	for (i = 0; i < MAX_DMAREQ; i++) {
+		slot = &tusb_dma->slot[i];
+		if (!slot->owner) {
+			victim = slot;
+			victim_load = 0;
+			break;
+		}
+		if (slot->owner->status == MUSB_DMA_STATUS_BUSY)
+			continue;
+
+		load = tusb_omap_dma_load(to_chdat(slot->owner));
+		if (!victim || load < victim_load) {
+			victim = slot;
+			victim_load = load;
+		}
+	}
+
+	if (!victim)
+		return -EAGAIN;
+
+	if (victim->owner) {
+		if (victim_load * 2 >= chdat->load)
+			return -EAGAIN;
+
+		DBG(3, "ep%i takes dmareq%i from ep%i\n", chdat->epnum,
+			victim->dmareq, to_chdat(victim->owner)->epnum);
+		tusb_omap_dma_unbind(to_chdat(victim->owner));
+	}
+
+	if (victim->ch < 0) {
+		ret = omap_request_dma(victim->sync_dev, "TUSB",
+				tusb_omap_dma_cb, NULL, &victim->ch);
+		if (ret != 0)
+			return ret;
+	}
+
+	reg = musb_readl(chdat->tbase, TUSB_DMA_EP_MAP);
+	reg &= ~(0x1f << (victim->dmareq * 5));
+	reg |= (chdat->epnum << (victim->dmareq * 5));
+	if (chdat->tx)
+		reg |= ((1 << 4) << (victim->dmareq * 5));
+	musb_writel(chdat->tbase, TUSB_DMA_EP_MAP, reg);
+
+	omap_set_dma_callback(victim->ch, tusb_omap_dma_cb, channel);
+
+	victim->owner = channel;
+	chdat->slot = victim;
+	chdat->ch = victim->ch;
+	chdat->dmareq = victim->dmareq;
+	chdat->sync_dev = victim->sync_dev;
+
+	return 0;
+}
+
 /*
  * See also musb_dma_completion in plat_uds.c and musb_g_[tx|rx]() in
  * musb_gadget.c.
@@ -165,6 +293,11 @@ static void tusb_omap_dma_cb(int lch, u16 ch_status, void *data)
 	channel->actual_len = chdat->transfer_len - remaining;
 	pio = chdat->len - channel->actual_len;
 
+	if (chdat->tx)
+		hw_ep->tx_dma_bytes += channel->actual_len;
+	else
+		hw_ep->rx_dma_bytes += channel->actual_len;
+
 	DBG(3, "DMA remaining %lu/%u\n", remaining, chdat->transfer_len);
 
 	/* Transfer remaining 1 - 31 bytes */
@@ -240,9 +373,25 @@ static int tusb_omap_dma_program(struct dma_channel *channel, u16 packet_sz,
 	s8				dmareq;
 	s8				sync_dev;
 
-	if (unlikely(dma_addr & 0x1) || (len < 32) || (len > packet_sz))
+	if (unlikely(dma_addr & 0x1) || (len < 32))
 		return false;
 
+	/*
+	 * TX can cover several packets with one DMA: TUSB splits the
+	 * transfer into transfer_packet_sz packets and with AUTOSET the
+	 * MUSB sends each one as soon as it is in the FIFO, so a double
+	 * buffered FIFO is refilled while the previous packet is on the
+	 * wire. Only whole packets are done this way; the tail is left
+	 * for the next call so the short packet handling below still
+	 * applies. RX stays at one packet per call as the gadget and
+	 * host code expect.
+	 */
+	if (len > packet_sz) {
+		if (!chdat->tx || (packet_sz & 0x1f))
+			return false;
+		len -= len % packet_sz;
+	}
+
 	/*
 	 * HW issue #10: Async dma will eventually corrupt the XFR_SIZE
 	 * register which will cause missed DMA interrupt. We could try to
@@ -278,6 +427,12 @@ static int tusb_omap_dma_program(struct dma_channel *channel, u16 packet_sz,
 		chdat->transfer_packet_sz = packet_sz;
 
 	if (tusb_dma->multichannel) {
+		tusb_omap_dma_account(chdat, len);
+		if (!chdat->slot && tusb_omap_dma_bind(channel) != 0) {
+			DBG(3, "no dmareq for ep%i, using pio\n", chdat->epnum);
+			return false;
+		}
+
 		ch = chdat->ch;
 		dmareq = chdat->dmareq;
 		sync_dev = chdat->sync_dev;
@@ -445,58 +600,7 @@ static int tusb_omap_dma_abort(struct dma_channel *channel)
 	return 0;
 }
 
-static inline int tusb_omap_dma_allocate_dmareq(struct tusb_omap_dma_ch *chdat)
-{
-	u32		reg = musb_readl(chdat->tbase, TUSB_DMA_EP_MAP);
-	int		i, dmareq_nr = -1;
-
-	const int sync_dev[6] = {
-		OMAP24XX_DMA_EXT_DMAREQ0,
-		OMAP24XX_DMA_EXT_DMAREQ1,
-		OMAP242X_DMA_EXT_DMAREQ2,
-		OMAP242X_DMA_EXT_DMAREQ3,
-		OMAP242X_DMA_EXT_DMAREQ4,
-		OMAP242X_DMA_EXT_DMAREQ5,
-	};
-
-	for (i = 0; i < MAX_DMAREQ; i++) {
-		int cur = (reg & (0xf << (i * 5))) >> (i * 5);
-		if (cur == 0) {
-			dmareq_nr = i;
-			break;
-		}
-	}
-
-	if (dmareq_nr == -1)
-		return -EAGAIN;
-
-	reg |= (chdat->epnum << (dmareq_nr * 5));
-	if (chdat->tx)
-		reg |= ((1 << 4) << (dmareq_nr * 5));
-	musb_writel(chdat->tbase, TUSB_DMA_EP_MAP, reg);
-
-	chdat->dmareq = dmareq_nr;
-	chdat->sync_dev = sync_dev[chdat->dmareq];
-
-	return 0;
-}
-
-static inline void tusb_omap_dma_free_dmareq(struct tusb_omap_dma_ch *chdat)
-{
-	u32 reg;
-
-	if (!chdat || chdat->dmareq < 0)
-		return;
-
-	reg = musb_readl(chdat->tbase, TUSB_DMA_EP_MAP);
-	reg &= ~(0x1f << (chdat->dmareq * 5));
-	musb_writel(chdat->tbase, TUSB_DMA_EP_MAP, reg);
-
-	chdat->dmareq = -1;
-	chdat->sync_dev = -1;
-}
-
-static struct dma_channel *dma_channel_pool[MAX_DMAREQ];
+static struct dma_channel *dma_channel_pool[MAX_DMA_CHANNELS];
 
 static struct dma_channel *
 tusb_omap_dma_allocate(struct dma_controller *c,
@@ -504,7 +608,6 @@ tusb_omap_dma_allocate(struct dma_controller *c,
 		u8 tx)
 {
 	int ret, i;
-	const char		*dev_name;
 	struct tusb_omap_dma	*tusb_dma;
 	struct musb		*musb;
 	void __iomem		*tbase;
@@ -529,7 +632,7 @@ tusb_omap_dma_allocate(struct dma_controller *c,
 		return NULL;
 	}
 
-	for (i = 0; i < MAX_DMAREQ; i++) {
+	for (i = 0; i < MAX_DMA_CHANNELS; i++) {
 		struct dma_channel *ch = dma_channel_pool[i];
 		if (ch->status == MUSB_DMA_STATUS_UNKNOWN) {
 			ch->status = MUSB_DMA_STATUS_FREE;
@@ -542,19 +645,18 @@ tusb_omap_dma_allocate(struct dma_controller *c,
 	if (!channel)
 		return NULL;
 
-	if (tx) {
-		chdat->tx = 1;
-		dev_name = "TUSB transmit";
-	} else {
-		chdat->tx = 0;
-		dev_name = "TUSB receive";
-	}
+	chdat->tx = tx ? 1 : 0;
 
 	chdat->musb = tusb_dma->musb;
 	chdat->tbase = tusb_dma->tbase;
 	chdat->hw_ep = hw_ep;
 	chdat->epnum = hw_ep->epnum;
+	chdat->ch = -1;
 	chdat->dmareq = -1;
+	chdat->sync_dev = -1;
+	chdat->slot = NULL;
+	chdat->load = 0;
+	chdat->load_stamp = jiffies;
 	chdat->completed_len = 0;
 	chdat->tusb_dma = tusb_dma;
 
@@ -562,16 +664,8 @@ tusb_omap_dma_allocate(struct dma_controller *c,
 	channel->desired_mode = 0;
 	channel->actual_len = 0;
 
-	if (tusb_dma->multichannel) {
-		ret = tusb_omap_dma_allocate_dmareq(chdat);
-		if (ret != 0)
-			goto free_dmareq;
-
-		ret = omap_request_dma(chdat->sync_dev, dev_name,
-				tusb_omap_dma_cb, channel, &chdat->ch);
-		if (ret != 0)
-			goto free_dmareq;
-	} else if (tusb_dma->ch == -1) {
+	/* With multichannel DMA a dmareq line is bound on first use */
+	if (!tusb_dma->multichannel && tusb_dma->ch == -1) {
 		tusb_dma->dmareq = 0;
 		tusb_dma->sync_dev = OMAP24XX_DMA_EXT_DMAREQ0;
 
@@ -579,25 +673,20 @@ tusb_omap_dma_allocate(struct dma_controller *c,
 		ret = omap_request_dma(tusb_dma->sync_dev, "TUSB shared",
 				tusb_omap_dma_cb, NULL, &tusb_dma->ch);
 		if (ret != 0)
-			goto free_dmareq;
-
-		chdat->dmareq = -1;
-		chdat->ch = -1;
+			goto fail;
 	}
 
-	DBG(3, "ep%i %s dma: %s dma%i dmareq%i sync%i\n",
-		chdat->epnum,
-		chdat->tx ? "tx" : "rx",
-		chdat->ch >= 0 ? "dedicated" : "shared",
-		chdat->ch >= 0 ? chdat->ch : tusb_dma->ch,
-		chdat->dmareq >= 0 ? chdat->dmareq : tusb_dma->dmareq,
-		chdat->sync_dev >= 0 ? chdat->sync_dev : tusb_dma->sync_dev);
+	if (tusb_dma->multichannel)
+		DBG(3, "ep%i %s dma: dynamic dmareq\n",
+			chdat->epnum, chdat->tx ? "tx" : "rx");
+	else
+		DBG(3, "ep%i %s dma: shared dma%i dmareq%i sync%i\n",
+			chdat->epnum, chdat->tx ? "tx" : "rx",
+			tusb_dma->ch, tusb_dma->dmareq, tusb_dma->sync_dev);
 
 	return channel;
 
-free_dmareq:
-	tusb_omap_dma_free_dmareq(chdat);
-
+fail:
 	DBG(3, "ep%i: Could not get a DMA channel\n", chdat->epnum);
 	channel->status = MUSB_DMA_STATUS_UNKNOWN;
 
@@ -629,14 +718,8 @@ static void tusb_omap_dma_release(struct dma_channel *channel)
 
 	channel->status = MUSB_DMA_STATUS_UNKNOWN;
 
-	if (chdat->ch >= 0) {
-		omap_stop_dma(chdat->ch);
-		omap_free_dma(chdat->ch);
-		chdat->ch = -1;
-	}
-
-	if (chdat->dmareq >= 0)
-		tusb_omap_dma_free_dmareq(chdat);
+	if (chdat->slot)
+		tusb_omap_dma_unbind(chdat);
 
 	channel = NULL;
 }
@@ -647,7 +730,7 @@ void dma_controller_destroy(struct dma_controller *c)
 	int			i;
 
 	tusb_dma = container_of(c, struct tusb_omap_dma, controller);
-	for (i = 0; i < MAX_DMAREQ; i++) {
+	for (i = 0; i < MAX_DMA_CHANNELS; i++) {
 		struct dma_channel *ch = dma_channel_pool[i];
 		if (ch) {
 			kfree(ch->private_data);
@@ -655,6 +738,13 @@ void dma_controller_destroy(struct dma_controller *c)
 		}
 	}
 
+	if (tusb_dma && tusb_dma->multichannel) {
+		for (i = 0; i < MAX_DMAREQ; i++) {
+			if (tusb_dma->slot[i].ch >= 0)
+				omap_free_dma(tusb_dma->slot[i].ch);
+		}
+	}
+
 	if (tusb_dma && !tusb_dma->multichannel && tusb_dma->ch >= 0)
 		omap_free_dma(tusb_dma->ch);
 
@@ -668,6 +758,14 @@ dma_controller_create(struct musb *musb, void __iomem *base)
 	struct tusb_omap_dma	*tusb_dma;
 	int			i;
 
+	static const int sync_dev[MAX_DMAREQ] = {
+		OMAP24XX_DMA_EXT_DMAREQ0,
+		OMAP24XX_DMA_EXT_DMAREQ1,
+		OMAP242X_DMA_EXT_DMAREQ2,
+		OMAP242X_DMA_EXT_DMAREQ3,
+		OMAP242X_DMA_EXT_DMAREQ4,
+	};
+
 	/* REVISIT: Get dmareq lines used from board-*.c */
 
 	musb_writel(musb->ctrl_base, TUSB_DMA_INT_MASK, 0x7fffffff);
@@ -700,6 +798,12 @@ dma_controller_create(struct musb *musb, void __iomem *base)
 		tusb_dma->multichannel = 1;
 
 	for (i = 0; i < MAX_DMAREQ; i++) {
+		tusb_dma->slot[i].ch = -1;
+		tusb_dma->slot[i].dmareq = i;
+		tusb_dma->slot[i].sync_dev = sync_dev[i];
+	}
+
+	for (i = 0; i < MAX_DMA_CHANNELS; i++) {
 		struct dma_channel	*ch;
 		struct tusb_omap_dma_ch	*chdat;
 
@@ -25,6 +25,7 @@
 #include <linux/fb.h>
 #include <linux/delay.h>
 #include <linux/clk.h>
+#include <linux/bitops.h>
 
 #include <plat/dma.h>
 #include <plat/blizzard.h>
@@ -87,6 +88,10 @@
 #define REQ_COMPLETE	0
 #define REQ_PENDING	1
 
+/* Number of queued update requests a new one is checked against
+ * for merging. */
+#define MAX_DAMAGE_TILES	8
+
 struct blizzard_reg_list {
 	int	start;
 	int	end;
@@ -155,8 +160,7 @@ struct blizzard_struct {
 	enum omapfb_update_mode	update_mode;
 	enum omapfb_update_mode	update_mode_before_suspend;
 
-	struct timer_list	auto_update_timer;
-	int			stop_auto_update;
+	struct omapfb_update_sched	auto_update;
 	struct omapfb_update_window	auto_update_window;
 	int			enabled_planes;
 	int			vid_nonstd_color;
@@ -171,12 +175,15 @@ struct blizzard_struct {
 	int			screen_height;
 	unsigned		te_connected:1;
 	unsigned		vsync_only:1;
+	int			te_state;	/* TE output enable as last
+						   written, -1 if unknown */
 
 	struct plane_info	plane[OMAPFB_PLANE_NUM];
 
 	struct blizzard_request	req_pool[REQ_POOL_SIZE];
+	/* one bit per req_pool entry, set while it's allocated */
+	unsigned long		req_busy[BITS_TO_LONGS(REQ_POOL_SIZE)];
 	struct list_head	pending_req_list;
-	struct list_head	free_req_list;
 	struct semaphore	req_sema;
 	spinlock_t		req_lock;
 
@@ -331,9 +338,14 @@ static void enable_tearsync(int y, int width, int height, int screen_height,
 {
 	u8 b;
 
-	b = blizzard_read_reg(BLIZZARD_NDISP_CTRL_STATUS);
-	b |= 1 << 3;
-	blizzard_write_reg(BLIZZARD_NDISP_CTRL_STATUS, b);
+	/* Each register access is a round trip on the external bus,
+	 * don't redo it for every frame. */
+	if (blizzard.te_state != 1) {
+		b = blizzard_read_reg(BLIZZARD_NDISP_CTRL_STATUS);
+		b |= 1 << 3;
+		blizzard_write_reg(BLIZZARD_NDISP_CTRL_STATUS, b);
+		blizzard.te_state = 1;
+	}
 
 	if (likely(blizzard.vsync_only || force_vsync)) {
 		blizzard.extif->enable_tearsync(1, 0);
@@ -359,50 +371,69 @@ static void disable_tearsync(void)
 	u8 b;
 
 	blizzard.extif->enable_tearsync(0, 0);
+	if (blizzard.te_state == 0)
+		return;
 	b = blizzard_read_reg(BLIZZARD_NDISP_CTRL_STATUS);
 	b &= ~(1 << 3);
 	blizzard_write_reg(BLIZZARD_NDISP_CTRL_STATUS, b);
 	b = blizzard_read_reg(BLIZZARD_NDISP_CTRL_STATUS);
+	blizzard.te_state = 0;
 }
 
 static inline void set_extif_timings(const struct extif_timings *t);
+static void coalesce_req_list(struct list_head *head);
 
+/*
+ * The request pool is managed with atomic bit operations on req_busy,
+ * so allocating and freeing a request from the submitter or from the
+ * transfer completion callbacks doesn't need req_lock. The semaphore
+ * only keeps process context from using up the slots reserved for
+ * IRQ context, it guarantees that a free slot exists.
+ */
 static inline struct blizzard_request *alloc_req(void)
 {
-	unsigned long flags;
 	struct blizzard_request *req;
 	int req_flags = 0;
+	int i;
 
 	if (!in_interrupt())
 		down(&blizzard.req_sema);
 	else
 		req_flags = REQ_FROM_IRQ_POOL;
 
-	spin_lock_irqsave(&blizzard.req_lock, flags);
-	BUG_ON(list_empty(&blizzard.free_req_list));
-	req = list_entry(blizzard.free_req_list.next,
-			 struct blizzard_request, entry);
-	list_del(&req->entry);
-	spin_unlock_irqrestore(&blizzard.req_lock, flags);
+	do {
+		i = find_first_zero_bit(blizzard.req_busy, REQ_POOL_SIZE);
+		BUG_ON(i >= REQ_POOL_SIZE);
+	} while (test_and_set_bit(i, blizzard.req_busy));
 
+	req = &blizzard.req_pool[i];
 	INIT_LIST_HEAD(&req->entry);
 	req->flags = req_flags;
 
 	return req;
 }
 
+/* The request must already be off the pending list. */
 static inline void free_req(struct blizzard_request *req)
+{
+	int from_irq = req->flags & REQ_FROM_IRQ_POOL;
+
+	smp_mb__before_clear_bit();
+	clear_bit(req - blizzard.req_pool, blizzard.req_busy);
+	if (!from_irq)
+		up(&blizzard.req_sema);
+}
+
+/* Take a finished request off the head of the pending list and free it */
+static void retire_req(struct blizzard_request *req)
 {
 	unsigned long flags;
 
 	spin_lock_irqsave(&blizzard.req_lock, flags);
-
 	list_del(&req->entry);
-	list_add(&req->entry, &blizzard.free_req_list);
-	if (!(req->flags & REQ_FROM_IRQ_POOL))
-		up(&blizzard.req_sema);
-
 	spin_unlock_irqrestore(&blizzard.req_lock, flags);
+
+	free_req(req);
 }
 
 static void process_pending_requests(void)
@@ -425,7 +456,7 @@ static void process_pending_requests(void)
 
 		complete = req->complete;
 		complete_data = req->complete_data;
-		free_req(req);
+		retire_req(req);
 
 		if (complete)
 			complete(complete_data);
@@ -442,8 +473,10 @@ static void submit_req_list(struct list_head *head)
 	int process = 1;
 
 	spin_lock_irqsave(&blizzard.req_lock, flags);
-	if (likely(!list_empty(&blizzard.pending_req_list)))
+	if (likely(!list_empty(&blizzard.pending_req_list))) {
 		process = 0;
+		coalesce_req_list(head);
+	}
 	list_splice_init(head, blizzard.pending_req_list.prev);
 	spin_unlock_irqrestore(&blizzard.req_lock, flags);
 
@@ -460,7 +493,7 @@ static void request_complete(void *data)
 	complete = req->complete;
 	complete_data = req->complete_data;
 
-	free_req(req);
+	retire_req(req);
 
 	if (complete)
 		complete(complete_data);
@@ -747,6 +780,101 @@ static void send_frame_complete(void *data)
 {
 }
 
+/* The area of a merged request was sent along with an earlier one. */
+static int merged_frame_handler(struct blizzard_request *req)
+{
+	return REQ_COMPLETE;
+}
+
+static int can_merge_update(const struct update_param *a,
+			    const struct update_param *b)
+{
+	if (a->plane != b->plane || a->color_mode != b->color_mode ||
+	    a->bpp != b->bpp || a->flags != b->flags)
+		return 0;
+	/* Only plain 1:1 updates, scaled ones have their own out window */
+	if (a->color_mode == OMAPFB_COLOR_YUV420 ||
+	    (a->flags & OMAPFB_FORMAT_FLAG_DOUBLE))
+		return 0;
+	if (a->x != a->out_x || a->y != a->out_y ||
+	    a->width != a->out_width || a->height != a->out_height ||
+	    b->x != b->out_x || b->y != b->out_y ||
+	    b->width != b->out_width || b->height != b->out_height)
+		return 0;
+	return 1;
+}
+
+/*
+ * Grow the queued update 'q' to cover 'n' as well, if the two areas
+ * overlap or touch and their bounding box doesn't cost more pixels
+ * on the external interface than sending both separately.
+ */
+static int merge_update(struct update_param *q, const struct update_param *n)
+{
+	int x1, y1, x2, y2;
+
+	if (!check_1d_intersect(q->x, q->x + q->width + 1,
+				n->x, n->x + n->width + 1) ||
+	    !check_1d_intersect(q->y, q->y + q->height + 1,
+				n->y, n->y + n->height + 1))
+		return 0;
+
+	x1 = min(q->x, n->x);
+	y1 = min(q->y, n->y);
+	x2 = max(q->x + q->width, n->x + n->width);
+	y2 = max(q->y + q->height, n->y + n->height);
+
+	if ((x2 - x1) * (y2 - y1) >
+	    q->width * q->height + n->width * n->height)
+		return 0;
+	if ((x2 - x1) * (y2 - y1) * q->bpp / 8 > blizzard.max_transmit_size)
+		return 0;
+
+	q->x = q->out_x = x1;
+	q->y = q->out_y = y1;
+	q->width = q->out_width = x2 - x1;
+	q->height = q->out_height = y2 - y1;
+
+	return 1;
+}
+
+/*
+ * Called with req_lock held, before the new requests on 'head' are
+ * added to the pending list. The UI tends to send many small, often
+ * overlapping updates while a transfer is in progress; fold each new
+ * update into a queued one where possible, so that the pixels go over
+ * the external interface only once. The merged request stays in the
+ * queue as a no-op, so completions are still signaled in order.
+ *
+ * The first pending request may already be in progress, leave it
+ * alone.
+ */
+static void coalesce_req_list(struct list_head *head)
+{
+	struct blizzard_request *n, *q;
+	int tiles;
+
+	list_for_each_entry(n, head, entry) {
+		if (n->handler != send_frame_handler)
+			continue;
+
+		tiles = 0;
+		list_for_each_entry_reverse(q, &blizzard.pending_req_list,
+					    entry) {
+			if (q->entry.prev == &blizzard.pending_req_list ||
+			    tiles++ >= MAX_DAMAGE_TILES)
+				break;
+			if (q->handler != send_frame_handler ||
+			    !can_merge_update(&q->par.update, &n->par.update))
+				continue;
+			if (merge_update(&q->par.update, &n->par.update)) {
+				n->handler = merged_frame_handler;
+				break;
+			}
+		}
+	}
+}
+
 #define ADD_PREQ(_x, _y, _w, _h, _x_out, _y_out, _w_out, _h_out) do {	\
 	req = alloc_req();			\
 	req->handler	= send_frame_handler;	\
@@ -820,14 +948,7 @@ static void create_req_list(int plane_idx,
 		 width_out, yspan_out);
 }
 
-static void auto_update_complete(void *data)
-{
-	if (!blizzard.stop_auto_update)
-		mod_timer(&blizzard.auto_update_timer,
-			  jiffies + BLIZZARD_AUTO_UPDATE_TIME);
-}
-
-static void blizzard_update_window_auto(unsigned long arg)
+static void blizzard_update_window_auto(struct omapfb_update_sched *sched)
 {
 	LIST_HEAD(req_list);
 	struct blizzard_request *last;
@@ -838,8 +959,8 @@ static void blizzard_update_window_auto(unsigned long arg)
 			&blizzard.auto_update_window, &req_list);
 	last = list_entry(req_list.prev, struct blizzard_request, entry);
 
-	last->complete = auto_update_complete;
-	last->complete_data = NULL;
+	last->complete = omapfb_update_sched_done;
+	last->complete_data = sched;
 
 	submit_req_list(&req_list);
 }
@@ -1049,8 +1170,7 @@ static int blizzard_set_update_mode(enum omapfb_update_mode mode)
 		omapfb_notify_clients(blizzard.fbdev, OMAPFB_EVENT_DISABLED);
 		break;
 	case OMAPFB_AUTO_UPDATE:
-		blizzard.stop_auto_update = 1;
-		del_timer_sync(&blizzard.auto_update_timer);
+		omapfb_update_sched_stop(&blizzard.auto_update);
 		break;
 	case OMAPFB_UPDATE_DISABLED:
 		break;
@@ -1058,14 +1178,13 @@ static int blizzard_set_update_mode(enum omapfb_update_mode mode)
 
 	blizzard.update_mode = mode;
 	blizzard_sync();
-	blizzard.stop_auto_update = 0;
 
 	switch (mode) {
 	case OMAPFB_MANUAL_UPDATE:
 		omapfb_notify_clients(blizzard.fbdev, OMAPFB_EVENT_READY);
 		break;
 	case OMAPFB_AUTO_UPDATE:
-		blizzard_update_window_auto(0);
+		omapfb_update_sched_start(&blizzard.auto_update);
 		break;
 	case OMAPFB_UPDATE_DISABLED:
 		break;
@@ -1476,6 +1595,7 @@ static void blizzard_resume(void)
 	blizzard_restart_sdram();
 
 	blizzard_restore_gen_regs();
+	blizzard.te_state = -1;
 
 	/* Enable display */
 	blizzard_write_reg(BLIZZARD_DISPLAY_MODE, 0x01);
@@ -1492,7 +1612,7 @@ static void blizzard_resume(void)
 static int blizzard_init(struct omapfb_device *fbdev, int ext_mode,
 			 struct omapfb_mem_desc *req_vram)
 {
-	int r = 0, i;
+	int r = 0;
 	u8 rev, conf;
 	unsigned long ext_clk;
 	int extif_div;
@@ -1597,17 +1717,21 @@ static int blizzard_init(struct omapfb_device *fbdev, int ext_mode,
 
 	blizzard.screen_width = fbdev->panel->x_res;
 	blizzard.screen_height = fbdev->panel->y_res;
+	blizzard.te_state = -1;
+
+	/* With the TE line connected every auto update frame is synced
+	 * to the panel refresh, so frames don't tear. */
+	if (blizzard.te_connected)
+		blizzard.auto_update_window.format |= OMAPFB_FORMAT_FLAG_TEARSYNC;
 
-	init_timer(&blizzard.auto_update_timer);
-	blizzard.auto_update_timer.function = blizzard_update_window_auto;
-	blizzard.auto_update_timer.data = 0;
+	omapfb_update_sched_init(&blizzard.auto_update, fbdev,
+				 blizzard_update_window_auto,
+				 BLIZZARD_AUTO_UPDATE_TIME);
 
-	INIT_LIST_HEAD(&blizzard.free_req_list);
 	INIT_LIST_HEAD(&blizzard.pending_req_list);
-	for (i = 0; i < ARRAY_SIZE(blizzard.req_pool); i++)
-		list_add(&blizzard.req_pool[i].entry, &blizzard.free_req_list);
-	BUG_ON(i <= IRQ_REQ_POOL_SIZE);
-	sema_init(&blizzard.req_sema, i - IRQ_REQ_POOL_SIZE);
+	bitmap_zero(blizzard.req_busy, REQ_POOL_SIZE);
+	BUILD_BUG_ON(REQ_POOL_SIZE <= IRQ_REQ_POOL_SIZE);
+	sema_init(&blizzard.req_sema, REQ_POOL_SIZE - IRQ_REQ_POOL_SIZE);
 
 	return 0;
 err3:
@@ -106,8 +106,7 @@ struct {
 	enum omapfb_update_mode	update_mode;
 	enum omapfb_update_mode	update_mode_before_suspend;
 
-	struct timer_list	auto_update_timer;
-	int			stop_auto_update;
+	struct omapfb_update_sched	auto_update;
 	struct omapfb_update_window	auto_update_window;
 	unsigned		te_connected:1;
 	unsigned		vsync_only:1;
@@ -470,14 +469,7 @@ static void create_req_list(struct omapfb_update_window *win,
 		ADD_PREQ(x, y, 1, height);
 }
 
-static void auto_update_complete(void *data)
-{
-	if (!hwa742.stop_auto_update)
-		mod_timer(&hwa742.auto_update_timer,
-			  jiffies + HWA742_AUTO_UPDATE_TIME);
-}
-
-static void hwa742_update_window_auto(unsigned long arg)
+static void hwa742_update_window_auto(struct omapfb_update_sched *sched)
 {
 	LIST_HEAD(req_list);
 	struct hwa742_request *last;
@@ -485,8 +477,8 @@ static void hwa742_update_window_auto(unsigned long arg)
 	create_req_list(&hwa742.auto_update_window, &req_list);
 	last = list_entry(req_list.prev, struct hwa742_request, entry);
 
-	last->complete = auto_update_complete;
-	last->complete_data = NULL;
+	last->complete = omapfb_update_sched_done;
+	last->complete_data = sched;
 
 	submit_req_list(&req_list);
 }
@@ -599,8 +591,7 @@ static int hwa742_set_update_mode(enum omapfb_update_mode mode)
 		omapfb_notify_clients(hwa742.fbdev, OMAPFB_EVENT_DISABLED);
 		break;
 	case OMAPFB_AUTO_UPDATE:
-		hwa742.stop_auto_update = 1;
-		del_timer_sync(&hwa742.auto_update_timer);
+		omapfb_update_sched_stop(&hwa742.auto_update);
 		break;
 	case OMAPFB_UPDATE_DISABLED:
 		break;
@@ -608,14 +599,13 @@ static int hwa742_set_update_mode(enum omapfb_update_mode mode)
 
 	hwa742.update_mode = mode;
 	hwa742_sync();
-	hwa742.stop_auto_update = 0;
 
 	switch (mode) {
 	case OMAPFB_MANUAL_UPDATE:
 		omapfb_notify_clients(hwa742.fbdev, OMAPFB_EVENT_READY);
 		break;
 	case OMAPFB_AUTO_UPDATE:
-		hwa742_update_window_auto(0);
+		omapfb_update_sched_start(&hwa742.auto_update);
 		break;
 	case OMAPFB_UPDATE_DISABLED:
 		break;
@@ -1015,9 +1005,14 @@ static int hwa742_init(struct omapfb_device *fbdev, int ext_mode,
 	hwa742.auto_update_window.height = fbdev->panel->y_res;
 	hwa742.auto_update_window.format = 0;
 
-	init_timer(&hwa742.auto_update_timer);
-	hwa742.auto_update_timer.function = hwa742_update_window_auto;
-	hwa742.auto_update_timer.data = 0;
+	/* With the TE line connected every auto update frame is synced
+	 * to the panel refresh, so frames don't tear. */
+	if (hwa742.te_connected)
+		hwa742.auto_update_window.format |= OMAPFB_FORMAT_FLAG_TEARSYNC;
+
+	omapfb_update_sched_init(&hwa742.auto_update, fbdev,
+				 hwa742_update_window_auto,
+				 HWA742_AUTO_UPDATE_TIME);
 
 	hwa742.prev_color_mode = -1;
 	hwa742.prev_flags = 0;
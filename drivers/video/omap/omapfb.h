@@ -26,6 +26,9 @@
 
 #include <linux/fb.h>
 #include <linux/mutex.h>
+#include <linux/timer.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
 #include <linux/omapfb.h>
 
 #define OMAPFB_EVENT_READY	1
@@ -171,17 +174,46 @@ struct lcd_ctrl {
 	int		(*get_color_key)  (struct omapfb_color_key *ck);
 };
 
+/*
+ * Auto update scheduler for the external controllers. send_frame()
+ * is called from timer context when there is something to update, and
+ * must arrange for omapfb_update_sched_done() to be called once the
+ * frame has gone out.
+ */
+struct omapfb_update_sched {
+	struct timer_list	timer;
+	unsigned long		interval;	/* jiffies between frames */
+	int			stopped;
+	void			(*send_frame)(struct omapfb_update_sched *sched);
+	struct omapfb_device	*fbdev;
+
+	unsigned long		frames_sent;
+	unsigned long		frames_skipped;
+};
+
 enum omapfb_state {
 	OMAPFB_DISABLED		= 0,
 	OMAPFB_SUSPENDED	= 99,
 	OMAPFB_ACTIVE		= 100
 };
 
+/* Scanline ranges collected by deferred I/O before they are merged */
+#define OMAPFB_DEFIO_RANGES	4
+
 struct omapfb_plane_struct {
 	int				idx;
 	struct omapfb_plane_info	info;
 	enum omapfb_color_format	color_mode;
 	struct omapfb_device		*fbdev;
+#ifdef CONFIG_FB_OMAP_DEFERRED_IO
+	struct fb_deferred_io		defio;
+	atomic_t			map_count;	/* user space mappings */
+	struct work_struct		defio_work;
+	spinlock_t			defio_lock;	/* protects the ranges */
+	int				defio_nr;
+	int				defio_y1[OMAPFB_DEFIO_RANGES];
+	int				defio_y2[OMAPFB_DEFIO_RANGES];
+#endif
 };
 
 struct omapfb_device {
@@ -205,6 +237,11 @@ struct omapfb_device {
 	struct fb_info			*fb_info[OMAPFB_PLANE_NUM];
 
 	struct platform_device	*dssdev;	/* dummy dev for clocks */
+
+	struct omapfb_update_sched	*update_sched;
+	atomic_t		dirty;		/* fb changed since last
+						   auto update frame */
+	atomic_t		user_cnt;	/* user space openers */
 };
 
 #ifdef CONFIG_ARCH_OMAP1
@@ -226,4 +263,13 @@ extern int  omapfb_update_window_async(struct fb_info *fbi,
 				       void (*callback)(void *),
 				       void *callback_data);
 
+extern void omapfb_update_sched_init(struct omapfb_update_sched *sched,
+			struct omapfb_device *fbdev,
+			void (*send_frame)(struct omapfb_update_sched *sched),
+			unsigned long interval);
+extern void omapfb_update_sched_start(struct omapfb_update_sched *sched);
+extern void omapfb_update_sched_stop(struct omapfb_update_sched *sched);
+extern void omapfb_update_sched_done(void *data);
+extern void omapfb_mark_dirty(struct omapfb_device *fbdev);
+
 #endif /* __OMAPFB_H */
@@ -245,6 +245,8 @@ static int ctrl_change_mode(struct fb_info *fbi)
 				   plane->info.out_width,
 				   plane->info.out_height);
 
+	omapfb_mark_dirty(fbdev);
+
 	return r;
 }
 
@@ -256,6 +258,10 @@ static int ctrl_change_mode(struct fb_info *fbi)
 /* Called each time the omapfb device is opened */
 static int omapfb_open(struct fb_info *info, int user)
 {
+	struct omapfb_plane_struct *plane = info->par;
+
+	if (user)
+		atomic_inc(&plane->fbdev->user_cnt);
 	return 0;
 }
 
@@ -265,7 +271,11 @@ static void omapfb_sync(struct fb_info *info);
  * gfx DMA operations are ended, before we return. */
 static int omapfb_release(struct fb_info *info, int user)
 {
+	struct omapfb_plane_struct *plane = info->par;
+
 	omapfb_sync(info);
+	if (user)
+		atomic_dec(&plane->fbdev->user_cnt);
 	return 0;
 }
 
@@ -324,6 +334,9 @@ static int _setcolreg(struct fb_info *info, u_int regno, u_int red, u_int green,
 static int omapfb_setcolreg(u_int regno, u_int red, u_int green, u_int blue,
 			    u_int transp, struct fb_info *info)
 {
+	struct omapfb_plane_struct *plane = info->par;
+
+	omapfb_mark_dirty(plane->fbdev);
 	return _setcolreg(info, regno, red, green, blue, transp, 1);
 }
 
@@ -368,6 +381,7 @@ static int omapfb_blank(int blank, struct fb_info *fbi)
 				fbdev->ctrl->resume();
 			fbdev->panel->enable(fbdev->panel);
 			fbdev->state = OMAPFB_ACTIVE;
+			omapfb_mark_dirty(fbdev);
 			if (fbdev->ctrl->get_update_mode() ==
 					OMAPFB_MANUAL_UPDATE)
 				do_update = 1;
@@ -821,6 +835,238 @@ static int omapfb_update_full_screen(struct fb_info *fbi)
 	return r;
 }
 
+#ifdef CONFIG_FB_OMAP_DEFERRED_IO
+/*
+ * Writes through a user space mapping of a plane in SDRAM are tracked with
+ * deferred I/O. In manual update mode the touched pages are turned into
+ * scanline ranges, which are then sent to the controller as partial
+ * updates from a work of our own: the deferred I/O callback runs with the
+ * page list locked and must not wait for the request queue, as
+ * omapfb_setup_mem() drains the page list with the queue locked.
+ */
+static int omapfb_mmap(struct fb_info *info, struct vm_area_struct *vma);
+static int (*omapfb_defio_mmap)(struct fb_info *info,
+				struct vm_area_struct *vma);
+static struct vm_operations_struct omapfb_defio_vm_ops;
+
+static void omapfb_defio_add_lines(struct omapfb_plane_struct *plane,
+				   int y1, int y2)
+{
+	int i;
+
+	for (i = 0; i < plane->defio_nr; i++)
+		if (y1 <= plane->defio_y2[i] && y2 >= plane->defio_y1[i])
+			break;
+	if (i == OMAPFB_DEFIO_RANGES)
+		i--;
+	if (i == plane->defio_nr) {
+		plane->defio_y1[i] = y1;
+		plane->defio_y2[i] = y2;
+		plane->defio_nr++;
+	} else {
+		plane->defio_y1[i] = min(plane->defio_y1[i], y1);
+		plane->defio_y2[i] = max(plane->defio_y2[i], y2);
+	}
+}
+
+static void omapfb_deferred_io(struct fb_info *fbi, struct list_head *pagelist)
+{
+	struct omapfb_plane_struct *plane = fbi->par;
+	struct omapfb_device *fbdev = plane->fbdev;
+	struct fb_var_screeninfo *var = &fbi->var;
+	unsigned long line_len = fbi->fix.line_length;
+	unsigned long base, start, end;
+	struct page *page;
+
+	if (fbdev->ctrl->get_update_mode() != OMAPFB_MANUAL_UPDATE) {
+		omapfb_mark_dirty(fbdev);
+		return;
+	}
+
+	base = var->yoffset * line_len + var->xoffset * var->bits_per_pixel / 8;
+
+	spin_lock(&plane->defio_lock);
+	list_for_each_entry(page, pagelist, lru) {
+		start = page->index << PAGE_SHIFT;
+		end = start + PAGE_SIZE;
+		if (end <= base)
+			continue;
+		start = start > base ? start - base : 0;
+		end -= base;
+		omapfb_defio_add_lines(plane, start / line_len,
+				       DIV_ROUND_UP(end, line_len));
+	}
+	spin_unlock(&plane->defio_lock);
+
+	schedule_work(&plane->defio_work);
+}
+
+static void omapfb_defio_work(struct work_struct *work)
+{
+	struct omapfb_plane_struct *plane =
+		container_of(work, struct omapfb_plane_struct, defio_work);
+	struct fb_info *fbi = plane->fbdev->fb_info[plane->idx];
+	struct omapfb_update_window win;
+	int y1[OMAPFB_DEFIO_RANGES], y2[OMAPFB_DEFIO_RANGES];
+	int i, n;
+
+	spin_lock(&plane->defio_lock);
+	n = plane->defio_nr;
+	memcpy(y1, plane->defio_y1, n * sizeof(*y1));
+	memcpy(y2, plane->defio_y2, n * sizeof(*y2));
+	plane->defio_nr = 0;
+	spin_unlock(&plane->defio_lock);
+
+	if (n && fbi->var.rotate) {
+		/* The ranges are in memory order, not in panel order */
+		omapfb_update_full_screen(fbi);
+		return;
+	}
+
+	for (i = 0; i < n; i++) {
+		y2[i] = min_t(int, y2[i], fbi->var.yres);
+		if (y1[i] >= y2[i])
+			continue;
+
+		win.x = 0;
+		win.y = y1[i];
+		win.width = fbi->var.xres;
+		win.height = y2[i] - y1[i];
+		win.out_x = 0;
+		win.out_y = win.y;
+		win.out_width = win.width;
+		win.out_height = win.height;
+		win.format = 0;
+
+		omapfb_update_win(fbi, &win);
+	}
+}
+
+static void omapfb_defio_vm_open(struct vm_area_struct *vma)
+{
+	struct fb_info *fbi = vma->vm_private_data;
+	struct omapfb_plane_struct *plane = fbi->par;
+
+	atomic_inc(&plane->map_count);
+}
+
+static void omapfb_defio_vm_close(struct vm_area_struct *vma)
+{
+	struct fb_info *fbi = vma->vm_private_data;
+	struct omapfb_plane_struct *plane = fbi->par;
+
+	atomic_dec(&plane->map_count);
+}
+
+/* Called with the request queue locked */
+static int omapfb_defio_mmap_plane(struct fb_info *fbi,
+				   struct vm_area_struct *vma)
+{
+	unsigned long off = vma->vm_pgoff << PAGE_SHIFT;
+	int r;
+
+	if (off >= fbi->fix.smem_len ||
+	    vma->vm_end - vma->vm_start > fbi->fix.smem_len - off)
+		return -EINVAL;
+
+	vma->vm_page_prot = pgprot_writecombine(vma->vm_page_prot);
+	r = omapfb_defio_mmap(fbi, vma);
+	if (r)
+		return r;
+
+	/*
+	 * Count the mappings like the controller does for its own, so
+	 * that the memory isn't reallocated under them.
+	 */
+	if (omapfb_defio_vm_ops.fault == NULL) {
+		omapfb_defio_vm_ops = *vma->vm_ops;
+		omapfb_defio_vm_ops.open = omapfb_defio_vm_open;
+		omapfb_defio_vm_ops.close = omapfb_defio_vm_close;
+	}
+	vma->vm_ops = &omapfb_defio_vm_ops;
+	/* vm_ops.open won't be called for mmap itself. */
+	omapfb_defio_vm_open(vma);
+
+	return 0;
+}
+
+/*
+ * Called with the request queue locked, before the memory of the plane is
+ * released or reallocated.
+ */
+static int omapfb_defio_setup_mem(struct fb_info *fbi, int type)
+{
+	struct omapfb_plane_struct *plane = fbi->par;
+	struct list_head *node, *next;
+	int i;
+
+	if (fbi->fbdefio == NULL)
+		return 0;
+	if (type != OMAPFB_MEMTYPE_SDRAM)
+		return -EINVAL;
+	if (atomic_read(&plane->map_count))
+		return -EBUSY;
+
+	/* The old content is gone, so are the pending updates for it */
+	cancel_delayed_work_sync(&fbi->deferred_work);
+	mutex_lock(&plane->defio.lock);
+	list_for_each_safe(node, next, &plane->defio.pagelist)
+		list_del(node);
+	mutex_unlock(&plane->defio.lock);
+
+	for (i = 0; i < fbi->fix.smem_len; i += PAGE_SIZE)
+		pfn_to_page((fbi->fix.smem_start + i) >> PAGE_SHIFT)->mapping =
+			NULL;
+
+	return 0;
+}
+
+static void omapfb_defio_init(struct fb_info *fbi)
+{
+	struct omapfb_plane_struct *plane = fbi->par;
+	struct omapfb_device *fbdev = plane->fbdev;
+
+	if (fbdev->ctrl->mmap == NULL || fbdev->ctrl->update_window == NULL ||
+	    fbdev->mem_desc.region[plane->idx].type != OMAPFB_MEMTYPE_SDRAM)
+		return;
+
+	atomic_set(&plane->map_count, 0);
+	spin_lock_init(&plane->defio_lock);
+	INIT_WORK(&plane->defio_work, omapfb_defio_work);
+	plane->defio.delay = max(HZ / 30, 1);
+	plane->defio.deferred_io = omapfb_deferred_io;
+	fbi->fbdefio = &plane->defio;
+	fb_deferred_io_init(fbi);
+
+	/*
+	 * fb_deferred_io_init() sets fb_mmap in the ops shared by all the
+	 * planes, omapfb_mmap() picks the right one for each plane.
+	 */
+	omapfb_defio_mmap = fbi->fbops->fb_mmap;
+	fbi->fbops->fb_mmap = omapfb_mmap;
+}
+
+static void omapfb_defio_cleanup(struct fb_info *fbi)
+{
+	struct omapfb_plane_struct *plane = fbi->par;
+
+	if (fbi->fbdefio == NULL)
+		return;
+
+	fb_deferred_io_cleanup(fbi);
+	cancel_work_sync(&plane->defio_work);
+	fbi->fbdefio = NULL;
+}
+#else
+static inline int omapfb_defio_setup_mem(struct fb_info *fbi, int type)
+{
+	return 0;
+}
+
+static inline void omapfb_defio_init(struct fb_info *fbi) { }
+static inline void omapfb_defio_cleanup(struct fb_info *fbi) { }
+#endif
+
 static int omapfb_setup_plane(struct fb_info *fbi, struct omapfb_plane_info *pi)
 {
 	struct omapfb_plane_struct *plane = fbi->par;
@@ -894,6 +1140,10 @@ static int omapfb_setup_mem(struct fb_info *fbi, struct omapfb_mem_info *mi)
 		u8	      old_type = rg->type;
 		unsigned long paddr;
 
+		r = omapfb_defio_setup_mem(fbi, mi->type);
+		if (r < 0)
+			goto out;
+
 		rg->size = size;
 		rg->type = mi->type;
 		/*
@@ -1262,12 +1512,47 @@ static int omapfb_mmap(struct fb_info *info, struct vm_area_struct *vma)
 	int r;
 
 	omapfb_rqueue_lock(fbdev);
-	r = fbdev->ctrl->mmap(info, vma);
+#ifdef CONFIG_FB_OMAP_DEFERRED_IO
+	if (info->fbdefio)
+		r = omapfb_defio_mmap_plane(info, vma);
+	else
+#endif
+		r = fbdev->ctrl->mmap(info, vma);
 	omapfb_rqueue_unlock(fbdev);
 
 	return r;
 }
 
+/*
+ * Drawing from the kernel, mostly fbcon. Note the change for the auto
+ * update scheduler.
+ */
+static void omapfb_fillrect(struct fb_info *info,
+			    const struct fb_fillrect *rect)
+{
+	struct omapfb_plane_struct *plane = info->par;
+
+	cfb_fillrect(info, rect);
+	omapfb_mark_dirty(plane->fbdev);
+}
+
+static void omapfb_copyarea(struct fb_info *info,
+			    const struct fb_copyarea *area)
+{
+	struct omapfb_plane_struct *plane = info->par;
+
+	cfb_copyarea(info, area);
+	omapfb_mark_dirty(plane->fbdev);
+}
+
+static void omapfb_imageblit(struct fb_info *info, const struct fb_image *image)
+{
+	struct omapfb_plane_struct *plane = info->par;
+
+	cfb_imageblit(info, image);
+	omapfb_mark_dirty(plane->fbdev);
+}
+
 /*
  * Callback table for the frame buffer framework. Some of these pointers
  * will be changed according to the current setting of fb_info->accel_flags.
@@ -1278,9 +1563,9 @@ static struct fb_ops omapfb_ops = {
 	.fb_release     = omapfb_release,
 	.fb_setcolreg	= omapfb_setcolreg,
 	.fb_setcmap	= omapfb_setcmap,
-	.fb_fillrect	= cfb_fillrect,
-	.fb_copyarea	= cfb_copyarea,
-	.fb_imageblit	= cfb_imageblit,
+	.fb_fillrect	= omapfb_fillrect,
+	.fb_copyarea	= omapfb_copyarea,
+	.fb_imageblit	= omapfb_imageblit,
 	.fb_blank       = omapfb_blank,
 	.fb_ioctl	= omapfb_ioctl,
 	.fb_check_var	= omapfb_check_var,
@@ -1289,6 +1574,79 @@ static struct fb_ops omapfb_ops = {
 	.fb_pan_display = omapfb_pan_display,
 };
 
+/*
+ * ---------------------------------------------------------------------------
+ * Auto update scheduler
+ * ---------------------------------------------------------------------------
+ */
+/*
+ * In auto update mode the external controllers copy the whole frame
+ * buffer to the display periodically. Skip the frames where nothing
+ * could have changed: kernel drawing and mode changes mark the frame
+ * buffer dirty. Writes through a user space mapping can't be seen, so
+ * while user space has the device open every frame is sent.
+ */
+void omapfb_mark_dirty(struct omapfb_device *fbdev)
+{
+	atomic_set(&fbdev->dirty, 1);
+}
+
+static void omapfb_update_sched_timer(unsigned long data)
+{
+	struct omapfb_update_sched *sched = (struct omapfb_update_sched *)data;
+	struct omapfb_device *fbdev = sched->fbdev;
+
+	if (atomic_xchg(&fbdev->dirty, 0) || atomic_read(&fbdev->user_cnt)) {
+		sched->frames_sent++;
+		sched->send_frame(sched);
+	} else {
+		sched->frames_skipped++;
+		if (!sched->stopped)
+			mod_timer(&sched->timer, jiffies + sched->interval);
+	}
+}
+
+void omapfb_update_sched_init(struct omapfb_update_sched *sched,
+			struct omapfb_device *fbdev,
+			void (*send_frame)(struct omapfb_update_sched *sched),
+			unsigned long interval)
+{
+	setup_timer(&sched->timer, omapfb_update_sched_timer,
+		    (unsigned long)sched);
+	sched->interval = interval;
+	sched->stopped = 1;
+	sched->send_frame = send_frame;
+	sched->fbdev = fbdev;
+	sched->frames_sent = 0;
+	sched->frames_skipped = 0;
+
+	fbdev->update_sched = sched;
+}
+
+/* Start the updates, always with a full frame. */
+void omapfb_update_sched_start(struct omapfb_update_sched *sched)
+{
+	sched->stopped = 0;
+	omapfb_mark_dirty(sched->fbdev);
+	omapfb_update_sched_timer((unsigned long)sched);
+}
+
+/* A frame still in flight when this returns won't restart the timer. */
+void omapfb_update_sched_stop(struct omapfb_update_sched *sched)
+{
+	sched->stopped = 1;
+	del_timer_sync(&sched->timer);
+}
+
+/* Frame completion callback, data is the scheduler */
+void omapfb_update_sched_done(void *data)
+{
+	struct omapfb_update_sched *sched = data;
+
+	if (!sched->stopped)
+		mod_timer(&sched->timer, jiffies + sched->interval);
+}
+
 /*
  * ---------------------------------------------------------------------------
  * Sysfs interface
@@ -1449,8 +1807,32 @@ static ssize_t omapfb_show_ctrl_name(struct device *dev,
 static struct device_attribute dev_attr_ctrl_name =
 	__ATTR(name, 0444, omapfb_show_ctrl_name, NULL);
 
+static ssize_t omapfb_show_frames_sent(struct device *dev,
+				       struct device_attribute *attr, char *buf)
+{
+	struct omapfb_device *fbdev = dev_get_drvdata(dev);
+
+	return snprintf(buf, PAGE_SIZE, "%lu\n", fbdev->update_sched ?
+			fbdev->update_sched->frames_sent : 0);
+}
+
+static ssize_t omapfb_show_frames_skipped(struct device *dev,
+					  struct device_attribute *attr,
+					  char *buf)
+{
+	struct omapfb_device *fbdev = dev_get_drvdata(dev);
+
+	return snprintf(buf, PAGE_SIZE, "%lu\n", fbdev->update_sched ?
+			fbdev->update_sched->frames_skipped : 0);
+}
+
+static DEVICE_ATTR(frames_sent, 0444, omapfb_show_frames_sent, NULL);
+static DEVICE_ATTR(frames_skipped, 0444, omapfb_show_frames_skipped, NULL);
+
 static struct attribute *ctrl_attrs[] = {
 	&dev_attr_ctrl_name.attr,
+	&dev_attr_frames_sent.attr,
+	&dev_attr_frames_skipped.attr,
 	NULL,
 };
 
@@ -1527,6 +1909,8 @@ static int fbinfo_init(struct omapfb_device *fbdev, struct fb_info *info)
 	set_fb_var(info, var);
 	set_fb_fix(info, 1);
 
+	omapfb_defio_init(info);
+
 	r = fb_alloc_cmap(&info->cmap, 16, 0);
 	if (r != 0)
 		dev_err(fbdev->dev, "unable to allocate color map memory\n");
@@ -1537,6 +1921,7 @@ static int fbinfo_init(struct omapfb_device *fbdev, struct fb_info *info)
 /* Release the fb_info object */
 static void fbinfo_cleanup(struct omapfb_device *fbdev, struct fb_info *fbi)
 {
+	omapfb_defio_cleanup(fbi);
 	fb_dealloc_cmap(&fbi->cmap);
 }
 
@@ -497,6 +497,11 @@ static void rfbi_set_bits_per_cycle(int bpc)
 {
 	u32 l;
 
+	/* Called around every register access of the external
+	 * controller, mostly with no change. */
+	if (bpc == rfbi.bits_per_cycle)
+		return;
+
 	rfbi_enable_clocks(1);
 	l = rfbi_read_reg(RFBI_CONFIG0);
 	l &= ~(0x03 << 0);
@@ -546,6 +551,7 @@ static int rfbi_init(struct omapfb_device *fbdev)
 	l = (0x03 << 0) | (0x00 << 2) | (0x01 << 5) | (0x02 << 7);
 	l |= (0 << 9) | (1 << 20) | (1 << 21);
 	rfbi_write_reg(RFBI_CONFIG0, l);
+	rfbi.bits_per_cycle = 16;
 
 	rfbi_write_reg(RFBI_DATA_CYCLE1_0, 0x00000010);
 
@@ -448,6 +448,9 @@ void exit_aio(struct mm_struct *mm)
  * This prevents races between the aio code path referencing the
  * req (after submitting it) and aio_complete() freeing the req.
  */
+static int aio_wake_function(wait_queue_t *wait, unsigned mode,
+			     int sync, void *key);
+
 static struct kiocb *__aio_get_req(struct kioctx *ctx)
 {
 	struct kiocb *req = NULL;
@@ -469,6 +472,8 @@ static struct kiocb *__aio_get_req(struct kioctx *ctx)
 	req->ki_iovec = NULL;
 	INIT_LIST_HEAD(&req->ki_run_list);
 	req->ki_eventfd = NULL;
+	init_waitqueue_func_entry(&req->ki_wait.wait, aio_wake_function);
+	INIT_LIST_HEAD(&req->ki_wait.wait.task_list);
 
 	/* Check if the completion queue has enough free space to
 	 * accept an event from this io.
@@ -900,6 +905,30 @@ void kick_iocb(struct kiocb *iocb)
 }
 EXPORT_SYMBOL(kick_iocb);
 
+/*
+ * aio_wake_function:
+ *	wait queue callback for kiocb->ki_wait, armed by
+ *	wait_on_page_locked_async().  Once the page bit we were waiting
+ *	for clears, take the iocb off the waitqueue and schedule a retry.
+ */
+static int aio_wake_function(wait_queue_t *wait, unsigned mode,
+			     int sync, void *key)
+{
+	struct wait_bit_queue *wb = container_of(wait, struct wait_bit_queue,
+						 wait);
+	struct wait_bit_key *bit = key;
+	struct kiocb *iocb = container_of(wb, struct kiocb, ki_wait);
+
+	if (bit && (wb->key.flags != bit->flags ||
+		    wb->key.bit_nr != bit->bit_nr ||
+		    test_bit(bit->bit_nr, bit->flags)))
+		return 0;
+
+	list_del_init(&wait->task_list);
+	kick_iocb(iocb);
+	return 1;
+}
+
 /* aio_complete
  *	Called when the io request on the given iocb is complete.
  *	Returns true if this is the last user of the request.  The 
@@ -1332,6 +1361,12 @@ static ssize_t aio_rw_vect_retry(struct kiocb *iocb)
 		(iocb->ki_opcode == IOCB_CMD_PREAD)) {
 		rw_op = file->f_op->aio_read;
 		opcode = IOCB_CMD_PREADV;
+		/*
+		 * Buffered reads of regular files wait for page I/O through
+		 * ki_wait and get retried, rather than blocking in here.
+		 */
+		if (S_ISREG(inode->i_mode) && !(file->f_flags & O_DIRECT))
+			kiocbSetAsyncWait(iocb);
 	} else {
 		rw_op = file->f_op->aio_write;
 		opcode = IOCB_CMD_PWRITEV;
@@ -1348,6 +1383,15 @@ static ssize_t aio_rw_vect_retry(struct kiocb *iocb)
 		if (ret > 0)
 			aio_advance_iovec(iocb, ret);
 
+		/*
+		 * A short buffered read that left ki_wait queued on a page
+		 * will be kicked when the page is unlocked: stop here and
+		 * resume from the updated position then.
+		 */
+		if (kiocbIsAsyncWait(iocb) &&
+		    !list_empty_careful(&iocb->ki_wait.wait.task_list))
+			return -EIOCBRETRY;
+
 	/* retry all partial writes.  retry partial reads as long as its a
 	 * regular file. */
 	} while (ret > 0 && iocb->ki_left > 0 &&
@@ -1688,6 +1732,7 @@ long do_io_submit(aio_context_t ctx_id, long nr,
 	long ret = 0;
 	int i;
 	struct hlist_head batch_hash[AIO_BATCH_HASH_SIZE] = { { 0, }, };
+	struct blk_plug plug;
 
 	if (unlikely(nr < 0))
 		return -EINVAL;
@@ -1704,6 +1749,8 @@ long do_io_submit(aio_context_t ctx_id, long nr,
 		return -EINVAL;
 	}
 
+	blk_start_plug(&plug);
+
 	/*
 	 * AKPM: should this return a partial result if some of the IOs were
 	 * successfully submitted?
@@ -1726,6 +1773,7 @@ long do_io_submit(aio_context_t ctx_id, long nr,
 		if (ret)
 			break;
 	}
+	blk_finish_plug(&plug);
 	aio_batch_free(batch_hash);
 
 	put_ioctx(ctx);
@@ -32,6 +32,10 @@
 #include <linux/elf.h>
 #include <linux/utsname.h>
 #include <linux/coredump.h>
+#include <linux/hash.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
 #include <asm/uaccess.h>
 #include <asm/param.h>
 #include <asm/page.h>
@@ -109,6 +113,182 @@ static int padzero(unsigned long elf_bss)
 	return 0;
 }
 
+/*
+ * Cache of the program headers, and the PT_INTERP path, of recently
+ * exec'd binaries and interpreters, so that exec of a hot binary does
+ * not read them from the file again.  Entries are keyed by the inode
+ * and its mtime, ctime and size, so any change to the file makes its
+ * entry miss; a colliding insert just replaces the older entry.  The
+ * file can't change under us while it is being exec'd since exec
+ * denies write access to it.
+ */
+#ifndef ELF_CACHE_PROC_NAME
+#define ELF_CACHE_PROC_NAME	"fs/binfmt_elf"
+#endif
+#define ELF_CACHE_BITS		6
+#define ELF_CACHE_SIZE		(1 << ELF_CACHE_BITS)
+
+struct elf_cache_entry {
+	atomic_t		count;
+	dev_t			dev;
+	unsigned long		ino;
+	__u32			generation;
+	struct timespec		mtime;
+	struct timespec		ctime;
+	loff_t			size;
+	unsigned long		phoff;
+	unsigned int		phsize;
+	char			*interp;	/* NULL if not known */
+	struct elf_phdr		phdata[0];
+};
+
+static struct elf_cache_entry *elf_cache[ELF_CACHE_SIZE];
+static DEFINE_SPINLOCK(elf_cache_lock);
+
+/* protected by elf_cache_lock */
+static struct {
+	unsigned long		hits;
+	unsigned long		misses;
+	unsigned long		execs;
+	u64			exec_ns;
+	u64			exec_ns_max;
+} elf_stats;
+
+static unsigned long elf_cache_hash(struct inode *inode)
+{
+	return hash_long(inode->i_ino ^ inode->i_sb->s_dev, ELF_CACHE_BITS);
+}
+
+static int elf_cache_match(struct elf_cache_entry *e, struct inode *inode,
+			   unsigned long phoff, unsigned int phsize)
+{
+	return e->dev == inode->i_sb->s_dev &&
+		e->ino == inode->i_ino &&
+		e->generation == inode->i_generation &&
+		timespec_equal(&e->mtime, &inode->i_mtime) &&
+		timespec_equal(&e->ctime, &inode->i_ctime) &&
+		e->size == i_size_read(inode) &&
+		e->phoff == phoff && e->phsize == phsize;
+}
+
+static void elf_cache_put(struct elf_cache_entry *e)
+{
+	if (e && atomic_dec_and_test(&e->count))
+		kfree(e);
+}
+
+/*
+ * Copy the cached program headers of @file into @phdata.  If @interp is
+ * not NULL it is set to a kmalloc'ed copy of the cached PT_INTERP path,
+ * or to NULL if there is none.  Returns 0 on a hit.
+ */
+static int elf_cache_lookup(struct file *file, unsigned long phoff,
+			    struct elf_phdr *phdata, unsigned int phsize,
+			    char **interp)
+{
+	struct inode *inode = file->f_path.dentry->d_inode;
+	struct elf_cache_entry *e;
+	int ret = -ENOENT;
+
+	spin_lock(&elf_cache_lock);
+	e = elf_cache[elf_cache_hash(inode)];
+	if (e && elf_cache_match(e, inode, phoff, phsize)) {
+		atomic_inc(&e->count);
+		elf_stats.hits++;
+	} else {
+		e = NULL;
+		elf_stats.misses++;
+	}
+	spin_unlock(&elf_cache_lock);
+	if (!e)
+		return ret;
+
+	if (interp && e->interp) {
+		*interp = kstrdup(e->interp, GFP_KERNEL);
+		ret = -ENOMEM;
+		if (!*interp)
+			goto out;
+	}
+	memcpy(phdata, e->phdata, phsize);
+	ret = 0;
+out:
+	elf_cache_put(e);
+	return ret;
+}
+
+static void elf_cache_insert(struct file *file, unsigned long phoff,
+			     struct elf_phdr *phdata, unsigned int phsize,
+			     const char *interp)
+{
+	struct inode *inode = file->f_path.dentry->d_inode;
+	size_t interp_len = interp ? strlen(interp) + 1 : 0;
+	struct elf_cache_entry *e, *old;
+	unsigned long hash = elf_cache_hash(inode);
+
+	e = kmalloc(sizeof(*e) + phsize + interp_len, GFP_KERNEL);
+	if (!e)
+		return;
+	atomic_set(&e->count, 1);
+	e->dev = inode->i_sb->s_dev;
+	e->ino = inode->i_ino;
+	e->generation = inode->i_generation;
+	e->mtime = inode->i_mtime;
+	e->ctime = inode->i_ctime;
+	e->size = i_size_read(inode);
+	e->phoff = phoff;
+	e->phsize = phsize;
+	memcpy(e->phdata, phdata, phsize);
+	e->interp = NULL;
+	if (interp) {
+		e->interp = (char *)e->phdata + phsize;
+		memcpy(e->interp, interp, interp_len);
+	}
+
+	spin_lock(&elf_cache_lock);
+	old = elf_cache[hash];
+	elf_cache[hash] = e;
+	spin_unlock(&elf_cache_lock);
+	elf_cache_put(old);
+}
+
+static void elf_exec_account(ktime_t start)
+{
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	spin_lock(&elf_cache_lock);
+	elf_stats.execs++;
+	elf_stats.exec_ns += ns;
+	if (ns > elf_stats.exec_ns_max)
+		elf_stats.exec_ns_max = ns;
+	spin_unlock(&elf_cache_lock);
+}
+
+static int elf_stats_show(struct seq_file *m, void *v)
+{
+	spin_lock(&elf_cache_lock);
+	seq_printf(m, "cache_hits %lu\n", elf_stats.hits);
+	seq_printf(m, "cache_misses %lu\n", elf_stats.misses);
+	seq_printf(m, "execs %lu\n", elf_stats.execs);
+	seq_printf(m, "exec_ns_total %llu\n",
+		   (unsigned long long)elf_stats.exec_ns);
+	seq_printf(m, "exec_ns_max %llu\n",
+		   (unsigned long long)elf_stats.exec_ns_max);
+	spin_unlock(&elf_cache_lock);
+	return 0;
+}
+
+static int elf_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, elf_stats_show, NULL);
+}
+
+static const struct file_operations elf_stats_fops = {
+	.open		= elf_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 /* Let's use some macros to make this stack manipulation a little clearer */
 #ifdef CONFIG_STACK_GROWSUP
 #define STACK_ADD(sp, items) ((elf_addr_t __user *)(sp) + (items))
@@ -415,13 +595,18 @@ static unsigned long load_elf_interp(struct elfhdr *interp_elf_ex,
 	if (!elf_phdata)
 		goto out;
 
-	retval = kernel_read(interpreter, interp_elf_ex->e_phoff,
-			     (char *)elf_phdata, size);
 	error = -EIO;
-	if (retval != size) {
-		if (retval < 0)
-			error = retval;	
-		goto out_close;
+	if (elf_cache_lookup(interpreter, interp_elf_ex->e_phoff,
+			     elf_phdata, size, NULL)) {
+		retval = kernel_read(interpreter, interp_elf_ex->e_phoff,
+				     (char *)elf_phdata, size);
+		if (retval != size) {
+			if (retval < 0)
+				error = retval;
+			goto out_close;
+		}
+		elf_cache_insert(interpreter, interp_elf_ex->e_phoff,
+				 elf_phdata, size, NULL);
 	}
 
 	total_size = total_mapping_size(elf_phdata, interp_elf_ex->e_phnum);
@@ -556,6 +741,38 @@ static unsigned long randomize_stack_top(unsigned long stack_top)
 #endif
 }
 
+/*
+ * Read the PT_INTERP path described by @ppnt into a kmalloc'ed buffer
+ */
+static int elf_read_interp(struct file *file, struct elf_phdr *ppnt,
+			   char **interp)
+{
+	char *buf;
+	int retval;
+
+	buf = kmalloc(ppnt->p_filesz, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	retval = kernel_read(file, ppnt->p_offset, buf, ppnt->p_filesz);
+	if (retval != ppnt->p_filesz) {
+		if (retval >= 0)
+			retval = -EIO;
+		goto out_free;
+	}
+	/* make sure path is NULL terminated */
+	retval = -ENOEXEC;
+	if (buf[ppnt->p_filesz - 1] != '\0')
+		goto out_free;
+
+	*interp = buf;
+	return 0;
+
+out_free:
+	kfree(buf);
+	return retval;
+}
+
 static int load_elf_binary(struct linux_binprm *bprm, struct pt_regs *regs)
 {
 	struct file *interpreter = NULL; /* to shut gcc up */
@@ -573,6 +790,8 @@ static int load_elf_binary(struct linux_binprm *bprm, struct pt_regs *regs)
 	unsigned long reloc_func_desc = 0;
 	int executable_stack = EXSTACK_DEFAULT;
 	unsigned long def_flags = 0;
+	int cached;
+	ktime_t start = ktime_get();
 	struct {
 		struct elfhdr elf_ex;
 		struct elfhdr interp_elf_ex;
@@ -611,12 +830,16 @@ static int load_elf_binary(struct linux_binprm *bprm, struct pt_regs *regs)
 	if (!elf_phdata)
 		goto out;
 
-	retval = kernel_read(bprm->file, loc->elf_ex.e_phoff,
-			     (char *)elf_phdata, size);
-	if (retval != size) {
-		if (retval >= 0)
-			retval = -EIO;
-		goto out_free_ph;
+	cached = !elf_cache_lookup(bprm->file, loc->elf_ex.e_phoff,
+				   elf_phdata, size, &elf_interpreter);
+	if (!cached) {
+		retval = kernel_read(bprm->file, loc->elf_ex.e_phoff,
+				     (char *)elf_phdata, size);
+		if (retval != size) {
+			if (retval >= 0)
+				retval = -EIO;
+			goto out_free_ph;
+		}
 	}
 
 	elf_ppnt = elf_phdata;
@@ -637,26 +860,15 @@ static int load_elf_binary(struct linux_binprm *bprm, struct pt_regs *regs)
 			retval = -ENOEXEC;
 			if (elf_ppnt->p_filesz > PATH_MAX || 
 			    elf_ppnt->p_filesz < 2)
-				goto out_free_ph;
-
-			retval = -ENOMEM;
-			elf_interpreter = kmalloc(elf_ppnt->p_filesz,
-						  GFP_KERNEL);
-			if (!elf_interpreter)
-				goto out_free_ph;
-
-			retval = kernel_read(bprm->file, elf_ppnt->p_offset,
-					     elf_interpreter,
-					     elf_ppnt->p_filesz);
-			if (retval != elf_ppnt->p_filesz) {
-				if (retval >= 0)
-					retval = -EIO;
 				goto out_free_interp;
+
+			/* the path may already have come from the cache */
+			if (!elf_interpreter) {
+				retval = elf_read_interp(bprm->file, elf_ppnt,
+							 &elf_interpreter);
+				if (retval)
+					goto out_free_ph;
 			}
-			/* make sure path is NULL terminated */
-			retval = -ENOEXEC;
-			if (elf_interpreter[elf_ppnt->p_filesz - 1] != '\0')
-				goto out_free_interp;
 
 			interpreter = open_exec(elf_interpreter);
 			retval = PTR_ERR(interpreter);
@@ -686,6 +898,10 @@ static int load_elf_binary(struct linux_binprm *bprm, struct pt_regs *regs)
 		elf_ppnt++;
 	}
 
+	if (!cached)
+		elf_cache_insert(bprm->file, loc->elf_ex.e_phoff, elf_phdata,
+				 size, elf_interpreter);
+
 	elf_ppnt = elf_phdata;
 	for (i = 0; i < loc->elf_ex.e_phnum; i++, elf_ppnt++)
 		if (elf_ppnt->p_type == PT_GNU_STACK) {
@@ -976,6 +1192,7 @@ static int load_elf_binary(struct linux_binprm *bprm, struct pt_regs *regs)
 #endif
 
 	start_thread(regs, elf_entry, bprm->p);
+	elf_exec_account(start);
 	retval = 0;
 out:
 	kfree(loc);
@@ -2069,6 +2286,7 @@ out:
 
 static int __init init_elf_binfmt(void)
 {
+	proc_create(ELF_CACHE_PROC_NAME, 0, NULL, &elf_stats_fops);
 	return register_binfmt(&elf_format);
 }
 
@@ -2076,6 +2294,7 @@ static void __exit exit_elf_binfmt(void)
 {
 	/* Remove the COFF and ELF loaders. */
 	unregister_binfmt(&elf_format);
+	remove_proc_entry(ELF_CACHE_PROC_NAME, NULL);
 }
 
 core_initcall(init_elf_binfmt);
@@ -25,6 +25,7 @@
 #include <linux/namei.h>
 #include <linux/log2.h>
 #include <linux/kmemleak.h>
+#include <linux/task_io_accounting_ops.h>
 #include <asm/uaccess.h>
 #include "internal.h"
 
@@ -179,6 +180,94 @@ blkdev_get_blocks(struct inode *inode, sector_t iblock,
 	return 0;
 }
 
+/*
+ * Small synchronous O_DIRECT requests on a block device map straight to
+ * one bio, so they are built and waited for on the stack here rather
+ * than going through the generic direct-io code.
+ */
+#define DIO_INLINE_BIO_VECS 4
+
+static void blkdev_bio_end_io_simple(struct bio *bio, int error)
+{
+	struct task_struct *waiter = bio->bi_private;
+
+	bio->bi_private = NULL;
+	wake_up_process(waiter);
+}
+
+/*
+ * Returns the number of bytes transferred, a negative error, or
+ * -ENOTBLK if the request has to go through __blockdev_direct_IO()
+ */
+static ssize_t
+__blkdev_direct_IO_simple(int rw, struct kiocb *iocb, const struct iovec *iov,
+			  loff_t offset)
+{
+	struct block_device *bdev = I_BDEV(iocb->ki_filp->f_mapping->host);
+	unsigned long addr = (unsigned long)iov->iov_base;
+	size_t len = iov->iov_len, done = 0;
+	unsigned int blkmask = bdev_logical_block_size(bdev) - 1;
+	struct page *pages[DIO_INLINE_BIO_VECS];
+	struct bio_vec vecs[DIO_INLINE_BIO_VECS];
+	struct bio bio;
+	int nr_pages, got, i;
+	ssize_t ret;
+
+	if (!len || ((offset | addr | len) & blkmask))
+		return -ENOTBLK;
+	if (offset + len > i_size_read(bdev->bd_inode))
+		return -ENOTBLK;
+	/* the integrity payload is only freed along with the bio */
+	if (bdev_get_integrity(bdev))
+		return -ENOTBLK;
+	nr_pages = ((addr + len + PAGE_SIZE - 1) >> PAGE_SHIFT) -
+			(addr >> PAGE_SHIFT);
+	if (nr_pages > DIO_INLINE_BIO_VECS)
+		return -ENOTBLK;
+
+	got = get_user_pages_fast(addr, nr_pages, rw == READ, pages);
+	ret = -ENOTBLK;
+	if (got < nr_pages)
+		goto out_put;
+
+	bio_init(&bio);
+	bio.bi_io_vec = vecs;
+	bio.bi_max_vecs = DIO_INLINE_BIO_VECS;
+	bio.bi_bdev = bdev;
+	bio.bi_sector = offset >> 9;
+	bio.bi_private = current;
+	bio.bi_end_io = blkdev_bio_end_io_simple;
+
+	for (i = 0; i < nr_pages; i++) {
+		unsigned int off = i ? 0 : addr & ~PAGE_MASK;
+		unsigned int bytes = min_t(size_t, PAGE_SIZE - off, len - done);
+
+		if (bio_add_page(&bio, pages[i], bytes, off) != bytes)
+			goto out_put;
+		done += bytes;
+	}
+
+	if (rw == WRITE)
+		task_io_account_write(len);
+	submit_bio(rw == WRITE ? WRITE_SYNC : READ_SYNC, &bio);
+	for (;;) {
+		set_current_state(TASK_UNINTERRUPTIBLE);
+		if (!ACCESS_ONCE(bio.bi_private))
+			break;
+		io_schedule();
+	}
+	__set_current_state(TASK_RUNNING);
+
+	ret = test_bit(BIO_UPTODATE, &bio.bi_flags) ? len : -EIO;
+	if (rw == READ)
+		for (i = 0; i < nr_pages; i++)
+			set_page_dirty_lock(pages[i]);
+out_put:
+	for (i = 0; i < got; i++)
+		page_cache_release(pages[i]);
+	return ret;
+}
+
 static ssize_t
 blkdev_direct_IO(int rw, struct kiocb *iocb, const struct iovec *iov,
 			loff_t offset, unsigned long nr_segs)
@@ -186,6 +275,14 @@ blkdev_direct_IO(int rw, struct kiocb *iocb, const struct iovec *iov,
 	struct file *file = iocb->ki_filp;
 	struct inode *inode = file->f_mapping->host;
 
+	if (nr_segs == 1 && is_sync_kiocb(iocb)) {
+		ssize_t ret;
+
+		ret = __blkdev_direct_IO_simple(rw, iocb, iov, offset);
+		if (ret != -ENOTBLK)
+			return ret;
+	}
+
 	return __blockdev_direct_IO(rw, iocb, inode, I_BDEV(inode), iov, offset,
 				    nr_segs, blkdev_get_blocks, NULL, NULL, 0);
 }
@@ -33,6 +33,8 @@
 #include "extent_map.h"
 #include "async-thread.h"
 
+struct crypto_shash;
+
 struct btrfs_trans_handle;
 struct btrfs_transaction;
 struct btrfs_pending_snapshot;
@@ -1021,6 +1023,19 @@ struct btrfs_fs_info {
 	 * for the sys_munmap function call path
 	 */
 	struct btrfs_workers fixup_workers;
+
+	/*
+	 * checksumming of large write bios is split across the csum
+	 * workers, see btrfs_csum_one_bio()
+	 */
+	struct btrfs_workers csum_workers;
+
+	/*
+	 * crc32c transform allocated at mount time, so the fastest
+	 * driver registered by then (e.g. crc32c-intel) is used
+	 */
+	struct crypto_shash *csum_shash;
+
 	struct task_struct *transaction_kthread;
 	struct task_struct *cleaner_kthread;
 	int thread_pool_size;
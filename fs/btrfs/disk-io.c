@@ -27,6 +27,7 @@
 #include <linux/kthread.h>
 #include <linux/freezer.h>
 #include <linux/crc32c.h>
+#include <crypto/hash.h>
 #include <linux/slab.h>
 #include <linux/migrate.h>
 #include "compat.h"
@@ -193,7 +194,25 @@ out:
 
 u32 btrfs_csum_data(struct btrfs_root *root, char *data, u32 seed, size_t len)
 {
-	return crc32c(seed, data, len);
+	struct crypto_shash *tfm = root ? root->fs_info->csum_shash : NULL;
+	int err;
+
+	if (!tfm)
+		return crc32c(seed, data, len);
+	{
+		struct {
+			struct shash_desc shash;
+			char ctx[crypto_shash_descsize(tfm)];
+		} desc;
+
+		desc.shash.tfm = tfm;
+		desc.shash.flags = 0;
+		*(u32 *)desc.ctx = seed;
+
+		err = crypto_shash_update(&desc.shash, data, len);
+		BUG_ON(err);
+		return *(u32 *)desc.ctx;
+	}
 }
 
 void btrfs_csum_final(u32 crc, char *result)
@@ -1826,6 +1845,9 @@ struct btrfs_root *open_ctree(struct super_block *sb,
 
 	btrfs_init_workers(&fs_info->fixup_workers, "fixup", 1,
 			   &fs_info->generic_worker);
+	btrfs_init_workers(&fs_info->csum_workers, "csum",
+			   fs_info->thread_pool_size,
+			   &fs_info->generic_worker);
 	btrfs_init_workers(&fs_info->endio_workers, "endio",
 			   fs_info->thread_pool_size,
 			   &fs_info->generic_worker);
@@ -1861,6 +1883,12 @@ struct btrfs_root *open_ctree(struct super_block *sb,
 	btrfs_start_workers(&fs_info->endio_meta_write_workers, 1);
 	btrfs_start_workers(&fs_info->endio_write_workers, 1);
 	btrfs_start_workers(&fs_info->endio_freespace_worker, 1);
+	btrfs_start_workers(&fs_info->csum_workers, 1);
+
+	/* fall back to crc32c() if no shash driver is available */
+	fs_info->csum_shash = crypto_alloc_shash("crc32c", 0, 0);
+	if (IS_ERR(fs_info->csum_shash))
+		fs_info->csum_shash = NULL;
 
 	fs_info->bdi.ra_pages *= btrfs_super_num_devices(disk_super);
 	fs_info->bdi.ra_pages = max(fs_info->bdi.ra_pages,
@@ -2106,6 +2134,9 @@ fail_sb_buffer:
 	btrfs_stop_workers(&fs_info->endio_write_workers);
 	btrfs_stop_workers(&fs_info->endio_freespace_worker);
 	btrfs_stop_workers(&fs_info->submit_workers);
+	btrfs_stop_workers(&fs_info->csum_workers);
+	if (fs_info->csum_shash)
+		crypto_free_shash(fs_info->csum_shash);
 fail_iput:
 	invalidate_inode_pages2(fs_info->btree_inode->i_mapping);
 	iput(fs_info->btree_inode);
@@ -2553,6 +2584,9 @@ int close_ctree(struct btrfs_root *root)
 	btrfs_stop_workers(&fs_info->endio_write_workers);
 	btrfs_stop_workers(&fs_info->endio_freespace_worker);
 	btrfs_stop_workers(&fs_info->submit_workers);
+	btrfs_stop_workers(&fs_info->csum_workers);
+	if (fs_info->csum_shash)
+		crypto_free_shash(fs_info->csum_shash);
 
 	btrfs_close_devices(fs_info->fs_devices);
 	btrfs_mapping_tree_free(&fs_info->mapping_tree);
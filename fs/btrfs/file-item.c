@@ -370,14 +370,99 @@ fail:
 	return ret;
 }
 
+/* number of sectors each csum worker is handed at a time */
+#define BTRFS_CSUM_CHUNK 64
+
+struct btrfs_csum_work {
+	struct btrfs_work work;
+	struct btrfs_root *root;
+	struct bio_vec *bvec;
+	struct btrfs_sector_sum *sector_sum;
+	int nr;
+	atomic_t *pending;
+	struct completion *done;
+};
+
+static void btrfs_csum_sectors(struct btrfs_root *root, struct bio_vec *bvec,
+			       struct btrfs_sector_sum *sector_sum, int nr)
+{
+	char *data;
+
+	while (nr--) {
+		data = kmap_atomic(bvec->bv_page, KM_USER0);
+		sector_sum->sum = btrfs_csum_data(root,
+						  data + bvec->bv_offset,
+						  ~(u32)0, bvec->bv_len);
+		kunmap_atomic(data, KM_USER0);
+		btrfs_csum_final(sector_sum->sum,
+				 (char *)&sector_sum->sum);
+		sector_sum++;
+		bvec++;
+	}
+}
+
+static void csum_work_func(struct btrfs_work *work)
+{
+	struct btrfs_csum_work *cw;
+
+	cw = container_of(work, struct btrfs_csum_work, work);
+	btrfs_csum_sectors(cw->root, cw->bvec, cw->sector_sum, cw->nr);
+	if (atomic_dec_and_test(cw->pending))
+		complete(cw->done);
+}
+
+/*
+ * checksum nr consecutive bvecs into the matching sector sums.  Runs longer
+ * than BTRFS_CSUM_CHUNK are cut into chunks and all but the last one are
+ * sent to the csum workers, so that a large bio is not limited to the
+ * speed of a single cpu.  If we can't allocate the work items everything
+ * is done inline.
+ */
+static void btrfs_csum_batch(struct btrfs_root *root, struct bio_vec *bvec,
+			     struct btrfs_sector_sum *sector_sum, int nr)
+{
+	struct btrfs_csum_work *works;
+	DECLARE_COMPLETION_ONSTACK(done);
+	atomic_t pending;
+	int nr_works;
+	int i;
+
+	nr_works = nr > 0 ? (nr - 1) / BTRFS_CSUM_CHUNK : 0;
+	works = nr_works ? kcalloc(nr_works, sizeof(*works), GFP_NOFS) : NULL;
+	if (!works) {
+		btrfs_csum_sectors(root, bvec, sector_sum, nr);
+		return;
+	}
+
+	atomic_set(&pending, nr_works + 1);
+	for (i = 0; i < nr_works; i++) {
+		works[i].work.func = csum_work_func;
+		works[i].root = root;
+		works[i].bvec = bvec;
+		works[i].sector_sum = sector_sum;
+		works[i].nr = BTRFS_CSUM_CHUNK;
+		works[i].pending = &pending;
+		works[i].done = &done;
+		btrfs_queue_worker(&root->fs_info->csum_workers,
+				   &works[i].work);
+		bvec += BTRFS_CSUM_CHUNK;
+		sector_sum += BTRFS_CSUM_CHUNK;
+		nr -= BTRFS_CSUM_CHUNK;
+	}
+	btrfs_csum_sectors(root, bvec, sector_sum, nr);
+	if (!atomic_dec_and_test(&pending))
+		wait_for_completion(&done);
+	kfree(works);
+}
+
 int btrfs_csum_one_bio(struct btrfs_root *root, struct inode *inode,
 		       struct bio *bio, u64 file_start, int contig)
 {
 	struct btrfs_ordered_sum *sums;
 	struct btrfs_sector_sum *sector_sum;
 	struct btrfs_ordered_extent *ordered;
-	char *data;
 	struct bio_vec *bvec = bio->bi_io_vec;
+	struct bio_vec *first_bvec = bvec;
 	int bio_index = 0;
 	unsigned long total_bytes = 0;
 	unsigned long this_sum_bytes = 0;
@@ -410,6 +495,9 @@ int btrfs_csum_one_bio(struct btrfs_root *root, struct inode *inode,
 		if (!contig && (offset >= ordered->file_offset + ordered->len ||
 		    offset < ordered->file_offset)) {
 			unsigned long bytes_left;
+			btrfs_csum_batch(root, first_bvec, sums->sums,
+					 sector_sum - sums->sums);
+			first_bvec = bvec;
 			sums->len = this_sum_bytes;
 			this_sum_bytes = 0;
 			btrfs_add_ordered_sum(inode, ordered, sums);
@@ -427,15 +515,6 @@ int btrfs_csum_one_bio(struct btrfs_root *root, struct inode *inode,
 			sums->bytenr = ordered->start;
 		}
 
-		data = kmap_atomic(bvec->bv_page, KM_USER0);
-		sector_sum->sum = ~(u32)0;
-		sector_sum->sum = btrfs_csum_data(root,
-						  data + bvec->bv_offset,
-						  sector_sum->sum,
-						  bvec->bv_len);
-		kunmap_atomic(data, KM_USER0);
-		btrfs_csum_final(sector_sum->sum,
-				 (char *)&sector_sum->sum);
 		sector_sum->bytenr = disk_bytenr;
 
 		sector_sum++;
@@ -446,6 +525,8 @@ int btrfs_csum_one_bio(struct btrfs_root *root, struct inode *inode,
 		offset += bvec->bv_len;
 		bvec++;
 	}
+	btrfs_csum_batch(root, first_bvec, sums->sums,
+			 sector_sum - sums->sums);
 	this_sum_bytes = 0;
 	btrfs_add_ordered_sum(inode, ordered, sums);
 	btrfs_put_ordered_extent(ordered);
@@ -681,6 +681,40 @@ io_error:
 	goto out;
 }
 
+/*
+ * start reading runs of consecutive backing pages in bulk
+ * - the backing fs can then build large bios out of each run rather than
+ *   being asked for one page at a time by cachefiles_read_backing_file()
+ * - pages that are already present in the backing pagecache are skipped
+ */
+static void cachefiles_read_ahead_backing_file(struct cachefiles_object *object,
+					       struct list_head *list)
+{
+	struct address_space *bmapping = object->backer->d_inode->i_mapping;
+	struct page *page;
+	pgoff_t start = 0, end = 0;
+	bool run = false;
+
+	list_for_each_entry(page, list, lru) {
+		if (run && page->index == end + 1) {
+			end++;
+			continue;
+		}
+		if (run && page->index + 1 == start) {
+			start--;
+			continue;
+		}
+		if (run)
+			force_page_cache_readahead(bmapping, NULL, start,
+						   end - start + 1);
+		start = end = page->index;
+		run = true;
+	}
+	if (run)
+		force_page_cache_readahead(bmapping, NULL, start,
+					   end - start + 1);
+}
+
 /*
  * read a list of pages from the cache or allocate blocks in which to store
  * them
@@ -775,6 +809,8 @@ int cachefiles_read_or_alloc_pages(struct fscache_retrieval *op,
 	/* submit the apparently valid pages to the backing fs to be read from
 	 * disk */
 	if (nrbackpages > 0) {
+		if (nrbackpages > 1)
+			cachefiles_read_ahead_backing_file(object, &backpages);
 		ret2 = cachefiles_read_backing_file(object, op, &backpages,
 						    &pagevec);
 		if (ret2 == -ENOMEM || ret2 == -EINTR)
@@ -879,30 +915,34 @@ int cachefiles_allocate_pages(struct fscache_retrieval *op,
 }
 
 /*
- * request a page be stored in the cache
+ * request a run of pages with consecutive indices be stored in the cache
  * - cache withdrawal is prevented by the caller
  * - this request may be ignored if there's no cache block available, in which
  *   case -ENOBUFS will be returned
+ * - the pages are written to the backing file with a single writev
  * - if the op is in progress, 0 will be returned
  */
-int cachefiles_write_page(struct fscache_storage *op, struct page *page)
+int cachefiles_write_pages(struct fscache_storage *op,
+			   struct page **pages, unsigned nr_pages)
 {
 	struct cachefiles_object *object;
 	struct cachefiles_cache *cache;
+	struct iovec iov[FSCACHE_STORE_BATCH];
 	mm_segment_t old_fs;
 	struct file *file;
 	loff_t pos, eof;
 	size_t len;
-	void *data;
+	unsigned loop;
 	int ret;
 
 	ASSERT(op != NULL);
-	ASSERT(page != NULL);
+	ASSERT(pages != NULL);
+	ASSERTCMP(nr_pages, <=, FSCACHE_STORE_BATCH);
 
 	object = container_of(op->op.object,
 			      struct cachefiles_object, fscache);
 
-	_enter("%p,%p{%lx},,,", object, page, page->index);
+	_enter("%p,{%lx},%u,,", object, pages[0]->index, nr_pages);
 
 	if (!object->backer) {
 		_leave(" = -ENOBUFS");
@@ -914,8 +954,8 @@ int cachefiles_write_page(struct fscache_storage *op, struct page *page)
 	cache = container_of(object->fscache.cache,
 			     struct cachefiles_cache, cache);
 
-	/* write the page to the backing filesystem and let it store it in its
-	 * own time */
+	/* write the pages to the backing filesystem and let it store them in
+	 * its own time */
 	dget(object->backer);
 	mntget(cache->mnt);
 	file = dentry_open(object->backer, cache->mnt, O_RDWR,
@@ -924,30 +964,38 @@ int cachefiles_write_page(struct fscache_storage *op, struct page *page)
 		ret = PTR_ERR(file);
 	} else {
 		ret = -EIO;
-		if (file->f_op->write) {
-			pos = (loff_t) page->index << PAGE_SHIFT;
+		if (file->f_op->write || file->f_op->aio_write) {
+			pos = (loff_t) pages[0]->index << PAGE_SHIFT;
+
+			len = 0;
+			for (loop = 0; loop < nr_pages; loop++) {
+				iov[loop].iov_base =
+					(void __user *) kmap(pages[loop]);
+				iov[loop].iov_len = PAGE_SIZE;
+				len += PAGE_SIZE;
+			}
 
 			/* we mustn't write more data than we have, so we have
 			 * to beware of a partial page at EOF */
 			eof = object->fscache.store_limit_l;
-			len = PAGE_SIZE;
 			if (eof & ~PAGE_MASK) {
 				ASSERTCMP(pos, <, eof);
-				if (eof - pos < PAGE_SIZE) {
+				if (eof - pos < len) {
 					_debug("cut short %llx to %llx",
-					       pos, eof);
+					       pos + len, eof);
+					iov[nr_pages - 1].iov_len -=
+						pos + len - eof;
 					len = eof - pos;
-					ASSERTCMP(pos + len, ==, eof);
 				}
 			}
 
-			data = kmap(page);
 			old_fs = get_fs();
 			set_fs(KERNEL_DS);
-			ret = file->f_op->write(
-				file, (const void __user *) data, len, &pos);
+			ret = vfs_writev(file, (const struct iovec __user *) iov,
+					 nr_pages, &pos);
 			set_fs(old_fs);
-			kunmap(page);
+			for (loop = 0; loop < nr_pages; loop++)
+				kunmap(pages[loop]);
 			if (ret != len)
 				ret = -EIO;
 		}
@@ -965,6 +1013,20 @@ int cachefiles_write_page(struct fscache_storage *op, struct page *page)
 	return ret;
 }
 
+/*
+ * request a page be stored in the cache
+ * - cache withdrawal is prevented by the caller
+ * - this request may be ignored if there's no cache block available, in which
+ *   case -ENOBUFS will be returned
+ * - if the op is in progress, 0 will be returned
+ */
+int cachefiles_write_page(struct fscache_storage *op, struct page *page)
+{
+	ASSERT(page != NULL);
+
+	return cachefiles_write_pages(op, &page, 1);
+}
+
 /*
  * detach a backing block from a page
  * - cache withdrawal is prevented by the caller
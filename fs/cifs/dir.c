@@ -631,10 +631,12 @@ lookup_out:
 static int
 cifs_d_revalidate(struct dentry *direntry, struct nameidata *nd)
 {
-	if (nd->flags & LOOKUP_RCU)
-		return -ECHILD;
+	struct inode *inode = ACCESS_ONCE(direntry->d_inode);
 
-	if (direntry->d_inode) {
+	if (inode) {
+		/* rcu-walk may only keep a dentry that needs no revalidation */
+		if (nd && nd->flags & LOOKUP_RCU)
+			return cifs_inode_needs_reval(inode) ? -ECHILD : 1;
 		if (cifs_revalidate_dentry(direntry))
 			return 0;
 		else
@@ -1653,7 +1653,7 @@ cifs_rename_exit:
 	return rc;
 }
 
-static bool
+bool
 cifs_inode_needs_reval(struct inode *inode)
 {
 	struct cifsInodeInfo *cifs_i = CIFS_I(inode);
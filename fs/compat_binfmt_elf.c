@@ -126,6 +126,7 @@ static void cputime_to_compat_timeval(const cputime_t cputime,
 #define elf_format		compat_elf_format
 #define init_elf_binfmt		init_compat_elf_binfmt
 #define exit_elf_binfmt		exit_compat_elf_binfmt
+#define ELF_CACHE_PROC_NAME	"fs/compat_binfmt_elf"
 
 /*
  * We share all the actual code with the native (64-bit) version.
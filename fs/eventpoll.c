@@ -79,7 +79,14 @@
  */
 
 /* Epoll private bits inside the event mask */
-#define EP_PRIVATE_BITS (EPOLLONESHOT | EPOLLET)
+#define EP_PRIVATE_BITS (EPOLLONESHOT | EPOLLET | EPOLLEXCLUSIVE)
+
+/* Events that may be combined with EPOLLEXCLUSIVE */
+#define EPOLLEXCLUSIVE_OK_BITS (POLLIN | POLLOUT | POLLERR | POLLHUP | \
+				EPOLLET | EPOLLEXCLUSIVE)
+
+/* Ready events collected before a single copy to userspace */
+#define EP_SEND_BATCH 16
 
 /* Maximum number of nesting allowed inside epoll sets */
 #define EP_MAX_NESTS 4
@@ -220,6 +227,16 @@ struct ep_send_events_data {
 	struct epoll_event __user *events;
 };
 
+/*
+ * Events harvested by ep_send_events_proc() but not yet copied to
+ * userspace. The items stay off every list until the copy succeeds.
+ */
+struct ep_send_batch {
+	int nr;
+	struct epitem *items[EP_SEND_BATCH];
+	struct epoll_event events[EP_SEND_BATCH];
+};
+
 /*
  * Configuration options available inside /proc/sys/fs/epoll/
  */
@@ -798,11 +815,20 @@ static struct epitem *ep_find(struct eventpoll *ep, struct file *file, int fd)
  */
 static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *key)
 {
-	int pwake = 0;
+	int pwake = 0, ewake = 0;
 	unsigned long flags;
 	struct epitem *epi = ep_item_from_wait(wait);
 	struct eventpoll *ep = epi->ep;
 
+	/*
+	 * Non exclusive entries always claim the wakeup. Exclusive ones
+	 * only do so when they actually woke one of our waiters, so that
+	 * __wake_up_common() moves on to the next epoll set sharing the
+	 * target file when nobody here is waiting.
+	 */
+	if (!(epi->event.events & EPOLLEXCLUSIVE))
+		ewake = 1;
+
 	spin_lock_irqsave(&ep->lock, flags);
 
 	/*
@@ -834,21 +860,34 @@ static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *k
 			epi->next = ep->ovflist;
 			ep->ovflist = epi;
 		}
+		/* A harvest is in progress and will pick this one up */
+		ewake = 1;
 		goto out_unlock;
 	}
 
-	/* If this file is already in the ready list we exit soon */
-	if (!ep_is_linked(&epi->rdllink))
-		list_add_tail(&epi->rdllink, &ep->rdllist);
+	/*
+	 * If this file is already in the ready list we exit soon. Whoever
+	 * linked it there has already issued (or, for items requeued by
+	 * ep_scan_ready_list(), is about to issue) the wakeup, so a burst
+	 * of callbacks on the same file results in a single wakeup.
+	 */
+	if (ep_is_linked(&epi->rdllink))
+		goto out_unlock;
+
+	list_add_tail(&epi->rdllink, &ep->rdllist);
 
 	/*
 	 * Wake up ( if active ) both the eventpoll wait list and the ->poll()
 	 * wait list.
 	 */
-	if (waitqueue_active(&ep->wq))
+	if (waitqueue_active(&ep->wq)) {
 		wake_up_locked(&ep->wq);
-	if (waitqueue_active(&ep->poll_wait))
+		ewake = 1;
+	}
+	if (waitqueue_active(&ep->poll_wait)) {
 		pwake++;
+		ewake = 1;
+	}
 
 out_unlock:
 	spin_unlock_irqrestore(&ep->lock, flags);
@@ -857,7 +896,7 @@ out_unlock:
 	if (pwake)
 		ep_poll_safewake(&ep->poll_wait);
 
-	return 1;
+	return ewake;
 }
 
 /*
@@ -874,7 +913,10 @@ static void ep_ptable_queue_proc(struct file *file, wait_queue_head_t *whead,
 		init_waitqueue_func_entry(&pwq->wait, ep_poll_callback);
 		pwq->whead = whead;
 		pwq->base = epi;
-		add_wait_queue(whead, &pwq->wait);
+		if (epi->event.events & EPOLLEXCLUSIVE)
+			add_wait_queue_exclusive(whead, &pwq->wait);
+		else
+			add_wait_queue(whead, &pwq->wait);
 		list_add_tail(&pwq->llink, &epi->pwqlist);
 		epi->nwait++;
 	} else {
@@ -1054,22 +1096,67 @@ static int ep_modify(struct eventpoll *ep, struct epitem *epi, struct epoll_even
 	return 0;
 }
 
+/*
+ * Copy the batched events to userspace in one go, then apply the
+ * post-delivery state changes to the items. If the copy faults, the
+ * items are put back on the head of the transfer list, in order, so
+ * that ep_scan_ready_list() requeues them.
+ */
+static int ep_send_batch_flush(struct eventpoll *ep, struct list_head *head,
+			       struct ep_send_batch *batch,
+			       struct epoll_event __user *uevent)
+{
+	int i, nr = batch->nr;
+	struct epitem *epi;
+
+	batch->nr = 0;
+	if (__copy_to_user(uevent, batch->events,
+			   nr * sizeof(struct epoll_event))) {
+		for (i = nr - 1; i >= 0; i--)
+			list_add(&batch->items[i]->rdllink, head);
+		return -EFAULT;
+	}
+
+	for (i = 0; i < nr; i++) {
+		epi = batch->items[i];
+		if (epi->event.events & EPOLLONESHOT)
+			epi->event.events &= EP_PRIVATE_BITS;
+		else if (!(epi->event.events & EPOLLET)) {
+			/*
+			 * If this file has been added with Level
+			 * Trigger mode, we need to insert back inside
+			 * the ready list, so that the next call to
+			 * epoll_wait() will check again the events
+			 * availability. At this point, noone can insert
+			 * into ep->rdllist besides us. The epoll_ctl()
+			 * callers are locked out by
+			 * ep_scan_ready_list() holding "mtx" and the
+			 * poll callback will queue them in ep->ovflist.
+			 */
+			list_add_tail(&epi->rdllink, &ep->rdllist);
+		}
+	}
+
+	return nr;
+}
+
 static int ep_send_events_proc(struct eventpoll *ep, struct list_head *head,
 			       void *priv)
 {
 	struct ep_send_events_data *esed = priv;
-	int eventcnt;
+	struct ep_send_batch batch;
+	int eventcnt, res;
 	unsigned int revents;
 	struct epitem *epi;
-	struct epoll_event __user *uevent;
 
 	/*
 	 * We can loop without lock because we are passed a task private list.
 	 * Items cannot vanish during the loop because ep_scan_ready_list() is
 	 * holding "mtx" during this call.
 	 */
-	for (eventcnt = 0, uevent = esed->events;
-	     !list_empty(head) && eventcnt < esed->maxevents;) {
+	batch.nr = 0;
+	for (eventcnt = 0;
+	     !list_empty(head) && eventcnt + batch.nr < esed->maxevents;) {
 		epi = list_first_entry(head, struct epitem, rdllink);
 
 		list_del_init(&epi->rdllink);
@@ -1079,35 +1166,32 @@ static int ep_send_events_proc(struct eventpoll *ep, struct list_head *head,
 
 		/*
 		 * If the event mask intersect the caller-requested one,
-		 * deliver the event to userspace. Again, ep_scan_ready_list()
-		 * is holding "mtx", so no operations coming from userspace
-		 * can change the item.
+		 * queue the event for delivery to userspace. Again,
+		 * ep_scan_ready_list() is holding "mtx", so no operations
+		 * coming from userspace can change the item.
 		 */
-		if (revents) {
-			if (__put_user(revents, &uevent->events) ||
-			    __put_user(epi->event.data, &uevent->data)) {
-				list_add(&epi->rdllink, head);
-				return eventcnt ? eventcnt : -EFAULT;
-			}
-			eventcnt++;
-			uevent++;
-			if (epi->event.events & EPOLLONESHOT)
-				epi->event.events &= EP_PRIVATE_BITS;
-			else if (!(epi->event.events & EPOLLET)) {
-				/*
-				 * If this file has been added with Level
-				 * Trigger mode, we need to insert back inside
-				 * the ready list, so that the next call to
-				 * epoll_wait() will check again the events
-				 * availability. At this point, noone can insert
-				 * into ep->rdllist besides us. The epoll_ctl()
-				 * callers are locked out by
-				 * ep_scan_ready_list() holding "mtx" and the
-				 * poll callback will queue them in ep->ovflist.
-				 */
-				list_add_tail(&epi->rdllink, &ep->rdllist);
-			}
-		}
+		if (!revents)
+			continue;
+
+		batch.items[batch.nr] = epi;
+		batch.events[batch.nr].events = revents;
+		batch.events[batch.nr].data = epi->event.data;
+		if (++batch.nr < EP_SEND_BATCH)
+			continue;
+
+		res = ep_send_batch_flush(ep, head, &batch,
+					  esed->events + eventcnt);
+		if (res < 0)
+			return eventcnt ? eventcnt : res;
+		eventcnt += res;
+	}
+
+	if (batch.nr) {
+		res = ep_send_batch_flush(ep, head, &batch,
+					  esed->events + eventcnt);
+		if (res < 0)
+			return eventcnt ? eventcnt : res;
+		eventcnt += res;
 	}
 
 	return eventcnt;
@@ -1348,6 +1432,19 @@ SYSCALL_DEFINE4(epoll_ctl, int, epfd, int, op, int, fd,
 	if (file == tfile || !is_file_epoll(file))
 		goto error_tgt_fput;
 
+	/*
+	 * EPOLLEXCLUSIVE can only be set at EPOLL_CTL_ADD time, for a
+	 * restricted set of events, and never on a nested epoll file:
+	 * events there must reach every waiter of the inner set.
+	 */
+	if (ep_op_has_event(op) && (epds.events & EPOLLEXCLUSIVE)) {
+		if (op == EPOLL_CTL_MOD)
+			goto error_tgt_fput;
+		if (is_file_epoll(tfile) ||
+		    (epds.events & ~EPOLLEXCLUSIVE_OK_BITS))
+			goto error_tgt_fput;
+	}
+
 	/*
 	 * At this point it is safe to assume that the "private_data" contains
 	 * our own data structure.
@@ -1399,8 +1496,10 @@ SYSCALL_DEFINE4(epoll_ctl, int, epfd, int, op, int, fd,
 		break;
 	case EPOLL_CTL_MOD:
 		if (epi) {
-			epds.events |= POLLERR | POLLHUP;
-			error = ep_modify(ep, epi, &epds);
+			if (!(epi->event.events & EPOLLEXCLUSIVE)) {
+				epds.events |= POLLERR | POLLHUP;
+				error = ep_modify(ep, epi, &epds);
+			}
 		} else
 			error = -ENOENT;
 		break;
@@ -3789,49 +3789,49 @@ static int ext4_ext_fiemap_cb(struct inode *inode, struct ext4_ext_path *path,
 	__u64	length;
 	__u32	flags = 0;
 	int	error;
-
-	logical =  (__u64)newex->ec_block << blksize_bits;
+	struct extent_status es;
 
 	if (newex->ec_start == 0) {
-		pgoff_t offset;
-		struct page *page;
-		struct buffer_head *bh = NULL;
-
-		offset = logical >> PAGE_SHIFT;
-		page = find_get_page(inode->i_mapping, offset);
-		if (!page || !page_has_buffers(page))
-			return EXT_CONTINUE;
-
-		bh = page_buffers(page);
+		ext4_lblk_t end = newex->ec_block + newex->ec_len - 1;
 
-		if (!bh)
+		/*
+		 * A hole may be partly delayed: report the delayed part
+		 * and let the walk come back for what follows it.
+		 */
+		if (!ext4_es_find_extent(inode, newex->ec_block, end, &es))
 			return EXT_CONTINUE;
 
-		if (buffer_delay(bh)) {
-			flags |= FIEMAP_EXTENT_DELALLOC;
-			page_cache_release(page);
-		} else {
-			page_cache_release(page);
+		if (es.es_lblk > newex->ec_block) {
+			newex->ec_len = es.es_lblk - newex->ec_block;
 			return EXT_CONTINUE;
 		}
+		if (es.es_lblk + es.es_len - 1 < end)
+			newex->ec_len = es.es_lblk + es.es_len -
+					newex->ec_block;
+		flags |= FIEMAP_EXTENT_DELALLOC;
 	}
 
+	logical =  (__u64)newex->ec_block << blksize_bits;
+
 	physical = (__u64)newex->ec_start << blksize_bits;
 	length =   (__u64)newex->ec_len << blksize_bits;
 
-	if (ex && ext4_ext_is_uninitialized(ex))
+	if (newex->ec_start && ex && ext4_ext_is_uninitialized(ex))
 		flags |= FIEMAP_EXTENT_UNWRITTEN;
 
 	/*
 	 * If this extent reaches EXT_MAX_BLOCK, it must be last.
 	 *
 	 * Or if ext4_ext_next_allocated_block is EXT_MAX_BLOCK,
-	 * this also indicates no more allocated blocks.
+	 * this also indicates no more allocated blocks, unless
+	 * delayed extents follow.
 	 *
 	 * XXX this might miss a single-block extent at EXT_MAX_BLOCK
 	 */
-	if (ext4_ext_next_allocated_block(path) == EXT_MAX_BLOCK ||
-	    newex->ec_block + newex->ec_len - 1 == EXT_MAX_BLOCK) {
+	if (newex->ec_block + newex->ec_len - 1 == EXT_MAX_BLOCK ||
+	    (ext4_ext_next_allocated_block(path) == EXT_MAX_BLOCK &&
+	     !ext4_es_find_extent(inode, newex->ec_block + newex->ec_len,
+				  EXT_MAX_BLOCK, &es))) {
 		loff_t size = i_size_read(inode);
 		loff_t bs = EXT4_BLOCK_SIZE(inode->i_sb);
 
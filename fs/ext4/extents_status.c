@@ -0,0 +1,229 @@
+/*
+ *  fs/ext4/extents_status.c
+ *
+ * Track the delayed-allocation extents of an inode in an rbtree, so
+ * that delayed blocks can be found without walking the page cache and
+ * without looking them up in the extent tree, where they do not exist
+ * yet.
+ *
+ * An extent is added when ext4_da_get_block_prep() reserves a block
+ * and removed when the block gets allocated or its page is
+ * invalidated.  All access goes through i_es_lock.
+ */
+
+#include <linux/rbtree.h>
+#include <linux/slab.h>
+#include "ext4.h"
+
+static struct kmem_cache *ext4_es_cachep;
+
+int __init ext4_init_es(void)
+{
+	ext4_es_cachep = KMEM_CACHE(extent_status, SLAB_RECLAIM_ACCOUNT);
+	if (ext4_es_cachep == NULL)
+		return -ENOMEM;
+	return 0;
+}
+
+void ext4_exit_es(void)
+{
+	kmem_cache_destroy(ext4_es_cachep);
+}
+
+void ext4_es_init_tree(struct ext4_es_tree *tree)
+{
+	tree->root = RB_ROOT;
+	tree->cache_es = NULL;
+}
+
+static inline ext4_lblk_t ext4_es_end(struct extent_status *es)
+{
+	return es->es_lblk + es->es_len - 1;
+}
+
+/*
+ * Return the extent containing @lblk or, if there is none, the first
+ * extent after it.
+ */
+static struct extent_status *__es_tree_search(struct rb_root *root,
+					      ext4_lblk_t lblk)
+{
+	struct rb_node *node = root->rb_node;
+	struct extent_status *es = NULL;
+
+	while (node) {
+		es = rb_entry(node, struct extent_status, rb_node);
+		if (lblk < es->es_lblk)
+			node = node->rb_left;
+		else if (lblk > ext4_es_end(es))
+			node = node->rb_right;
+		else
+			return es;
+	}
+
+	if (es && lblk > ext4_es_end(es)) {
+		node = rb_next(&es->rb_node);
+		es = node ? rb_entry(node, struct extent_status, rb_node) :
+			    NULL;
+	}
+	return es;
+}
+
+static void __es_link(struct ext4_es_tree *tree, struct extent_status *new)
+{
+	struct rb_node **p = &tree->root.rb_node;
+	struct rb_node *parent = NULL;
+	struct extent_status *es;
+
+	while (*p) {
+		parent = *p;
+		es = rb_entry(parent, struct extent_status, rb_node);
+		if (new->es_lblk < es->es_lblk)
+			p = &(*p)->rb_left;
+		else
+			p = &(*p)->rb_right;
+	}
+	rb_link_node(&new->rb_node, parent, p);
+	rb_insert_color(&new->rb_node, &tree->root);
+}
+
+static void __es_erase(struct ext4_es_tree *tree, struct extent_status *es)
+{
+	rb_erase(&es->rb_node, &tree->root);
+	if (tree->cache_es == es)
+		tree->cache_es = NULL;
+	kmem_cache_free(ext4_es_cachep, es);
+}
+
+/*
+ * Find the first delayed extent overlapping [@lblk, @end] and copy it
+ * to @es.  Returns 1 if one was found, 0 otherwise.
+ */
+int ext4_es_find_extent(struct inode *inode, ext4_lblk_t lblk,
+			ext4_lblk_t end, struct extent_status *es)
+{
+	struct ext4_inode_info *ei = EXT4_I(inode);
+	struct extent_status *es1;
+	int found = 0;
+
+	read_lock(&ei->i_es_lock);
+	es1 = ei->i_es_tree.cache_es;
+	if (!es1 || lblk < es1->es_lblk || lblk > ext4_es_end(es1))
+		es1 = __es_tree_search(&ei->i_es_tree.root, lblk);
+	if (es1 && es1->es_lblk <= end) {
+		es->es_lblk = es1->es_lblk;
+		es->es_len = es1->es_len;
+		found = 1;
+	}
+	read_unlock(&ei->i_es_lock);
+	return found;
+}
+
+/*
+ * Mark [@lblk, @lblk + @len) delayed, merging with the extents it
+ * overlaps or touches.
+ */
+int ext4_es_insert_extent(struct inode *inode, ext4_lblk_t lblk,
+			  ext4_lblk_t len)
+{
+	struct ext4_inode_info *ei = EXT4_I(inode);
+	struct ext4_es_tree *tree = &ei->i_es_tree;
+	ext4_lblk_t end = lblk + len - 1;
+	struct extent_status *es, *next;
+	struct rb_node *node;
+	int err = 0;
+
+	write_lock(&ei->i_es_lock);
+	es = __es_tree_search(&tree->root, lblk ? lblk - 1 : 0);
+	if (es && (es->es_lblk <= end || es->es_lblk == end + 1)) {
+		/* grow the neighbour and swallow whatever it now reaches */
+		if (ext4_es_end(es) > end)
+			end = ext4_es_end(es);
+		if (es->es_lblk > lblk)
+			es->es_lblk = lblk;
+		while ((node = rb_next(&es->rb_node)) != NULL) {
+			next = rb_entry(node, struct extent_status, rb_node);
+			if (next->es_lblk > end + 1)
+				break;
+			if (ext4_es_end(next) > end)
+				end = ext4_es_end(next);
+			__es_erase(tree, next);
+		}
+		es->es_len = end - es->es_lblk + 1;
+	} else {
+		es = kmem_cache_alloc(ext4_es_cachep, GFP_ATOMIC);
+		if (es == NULL) {
+			err = -ENOMEM;
+			goto out;
+		}
+		es->es_lblk = lblk;
+		es->es_len = len;
+		__es_link(tree, es);
+	}
+	tree->cache_es = es;
+out:
+	write_unlock(&ei->i_es_lock);
+	return err;
+}
+
+/*
+ * Forget [@lblk, @lblk + @len), which has been allocated or dropped.
+ * If splitting an extent fails for lack of memory the extent is left
+ * whole; callers use the tree only next to buffer or extent state, so
+ * a stale entry is harmless.
+ */
+int ext4_es_remove_extent(struct inode *inode, ext4_lblk_t lblk,
+			  ext4_lblk_t len)
+{
+	struct ext4_inode_info *ei = EXT4_I(inode);
+	struct ext4_es_tree *tree = &ei->i_es_tree;
+	ext4_lblk_t end = lblk + len - 1;
+	struct extent_status *es, *tail;
+	struct rb_node *node;
+	int err = 0;
+
+	write_lock(&ei->i_es_lock);
+	es = __es_tree_search(&tree->root, lblk);
+	while (es && es->es_lblk <= end) {
+		ext4_lblk_t es_end = ext4_es_end(es);
+
+		node = rb_next(&es->rb_node);
+		if (es->es_lblk < lblk && es_end > end) {
+			tail = kmem_cache_alloc(ext4_es_cachep, GFP_ATOMIC);
+			if (tail == NULL) {
+				err = -ENOMEM;
+				break;
+			}
+			es->es_len = lblk - es->es_lblk;
+			tail->es_lblk = end + 1;
+			tail->es_len = es_end - end;
+			__es_link(tree, tail);
+			break;
+		}
+		if (es->es_lblk < lblk) {
+			es->es_len = lblk - es->es_lblk;
+		} else if (es_end > end) {
+			es->es_lblk = end + 1;
+			es->es_len = es_end - end;
+		} else {
+			__es_erase(tree, es);
+		}
+		es = node ? rb_entry(node, struct extent_status, rb_node) :
+			    NULL;
+	}
+	write_unlock(&ei->i_es_lock);
+	return err;
+}
+
+void ext4_es_free_tree(struct inode *inode)
+{
+	struct ext4_inode_info *ei = EXT4_I(inode);
+	struct ext4_es_tree *tree = &ei->i_es_tree;
+	struct rb_node *node;
+
+	write_lock(&ei->i_es_lock);
+	while ((node = rb_first(&tree->root)) != NULL)
+		__es_erase(tree, rb_entry(node, struct extent_status,
+					  rb_node));
+	write_unlock(&ei->i_es_lock);
+}
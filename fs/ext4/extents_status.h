@@ -0,0 +1,33 @@
+/*
+ *  fs/ext4/extents_status.h
+ *
+ * In-memory tree of the delayed-allocation extents of an inode.
+ */
+
+#ifndef _EXT4_EXTENTS_STATUS_H
+#define _EXT4_EXTENTS_STATUS_H
+
+struct extent_status {
+	struct rb_node rb_node;
+	ext4_lblk_t es_lblk;	/* first logical block extent covers */
+	ext4_lblk_t es_len;	/* length of extent in block */
+};
+
+struct ext4_es_tree {
+	struct rb_root root;
+	struct extent_status *cache_es;	/* recently accessed extent */
+};
+
+extern int __init ext4_init_es(void);
+extern void ext4_exit_es(void);
+extern void ext4_es_init_tree(struct ext4_es_tree *tree);
+extern void ext4_es_free_tree(struct inode *inode);
+
+extern int ext4_es_insert_extent(struct inode *inode, ext4_lblk_t lblk,
+				 ext4_lblk_t len);
+extern int ext4_es_remove_extent(struct inode *inode, ext4_lblk_t lblk,
+				 ext4_lblk_t len);
+extern int ext4_es_find_extent(struct inode *inode, ext4_lblk_t lblk,
+			       ext4_lblk_t end, struct extent_status *es);
+
+#endif /* _EXT4_EXTENTS_STATUS_H */
@@ -1370,6 +1370,10 @@ int ext4_map_blocks(handle_t *handle, struct inode *inode,
 	if (flags & EXT4_GET_BLOCKS_DELALLOC_RESERVE)
 		ext4_clear_inode_state(inode, EXT4_STATE_DELALLOC_RESERVED);
 
+	/* whatever was delayed in the range is now allocated */
+	if (retval > 0)
+		ext4_es_remove_extent(inode, map->m_lblk, retval);
+
 	up_write((&EXT4_I(inode)->i_data_sem));
 	if (retval > 0 && map->m_flags & EXT4_MAP_MAPPED) {
 		int ret = check_block_validity(inode, map);
@@ -1996,6 +2000,9 @@ static void ext4_da_page_release_reservation(struct page *page,
 	int to_release = 0;
 	struct buffer_head *head, *bh;
 	unsigned int curr_off = 0;
+	struct inode *inode = page->mapping->host;
+	int bits = PAGE_CACHE_SHIFT - inode->i_blkbits;
+	ext4_lblk_t lblk, first;
 
 	head = page_buffers(page);
 	bh = head;
@@ -2008,7 +2015,15 @@ static void ext4_da_page_release_reservation(struct page *page,
 		}
 		curr_off = next_off;
 	} while ((bh = bh->b_this_page) != head);
-	ext4_da_release_space(page->mapping->host, to_release);
+
+	if (to_release) {
+		lblk = (ext4_lblk_t)page->index << bits;
+		first = (offset + (1 << inode->i_blkbits) - 1) >>
+			inode->i_blkbits;
+		ext4_es_remove_extent(inode, lblk + first,
+				      (1 << bits) - first);
+	}
+	ext4_da_release_space(inode, to_release);
 }
 
 /*
@@ -2177,6 +2192,11 @@ static void ext4_da_block_invalidatepages(struct mpage_da_data *mpd,
 	index = logical >> (PAGE_CACHE_SHIFT - inode->i_blkbits);
 	end   = (logical + blk_cnt - 1) >>
 				(PAGE_CACHE_SHIFT - inode->i_blkbits);
+	/* the delayed buffers of these pages are thrown away below */
+	ext4_es_remove_extent(inode,
+		(ext4_lblk_t)index << (PAGE_CACHE_SHIFT - inode->i_blkbits),
+		(ext4_lblk_t)(end - index + 1) <<
+				(PAGE_CACHE_SHIFT - inode->i_blkbits));
 	while (index <= end) {
 		nr_pages = pagevec_lookup(&pvec, mapping, index, PAGEVEC_SIZE);
 		if (nr_pages == 0)
@@ -2549,6 +2569,7 @@ static int ext4_da_get_block_prep(struct inode *inode, sector_t iblock,
 				  struct buffer_head *bh, int create)
 {
 	struct ext4_map_blocks map;
+	struct extent_status es;
 	int ret = 0;
 	sector_t invalid_block = ~((sector_t) 0xffff);
 
@@ -2558,6 +2579,13 @@ static int ext4_da_get_block_prep(struct inode *inode, sector_t iblock,
 	BUG_ON(create == 0);
 	BUG_ON(bh->b_size != inode->i_sb->s_blocksize);
 
+	/*
+	 * A block that is already delayed has its space reserved and no
+	 * extent yet, so there is nothing to look up.
+	 */
+	if (buffer_delay(bh) && ext4_es_find_extent(inode, iblock, iblock, &es))
+		return 0;
+
 	map.m_lblk = iblock;
 	map.m_len = 1;
 
@@ -2580,6 +2608,12 @@ static int ext4_da_get_block_prep(struct inode *inode, sector_t iblock,
 			/* not enough space to reserve */
 			return ret;
 
+		ret = ext4_es_insert_extent(inode, iblock, 1);
+		if (ret) {
+			ext4_da_release_space(inode, 1);
+			return ret;
+		}
+
 		map_bh(bh, inode->i_sb, invalid_block);
 		set_buffer_new(bh);
 		set_buffer_delay(bh);
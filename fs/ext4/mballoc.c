@@ -674,11 +674,14 @@ static void ext4_mb_mark_free_simple(struct super_block *sb,
 
 /*
  * Cache the order of the largest free extent we have available in this block
- * group.
+ * group, and keep the group on the matching s_mb_largest_free_orders list.
+ * Called with the group locked.
  */
 static void
 mb_set_largest_free_order(struct super_block *sb, struct ext4_group_info *grp)
 {
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	int old = grp->bb_largest_free_order;
 	int i;
 	int bits;
 
@@ -691,6 +694,22 @@ mb_set_largest_free_order(struct super_block *sb, struct ext4_group_info *grp)
 			break;
 		}
 	}
+
+	if (old == grp->bb_largest_free_order)
+		return;
+
+	if (old >= 0) {
+		spin_lock(&sbi->s_mb_largest_free_orders_locks[old]);
+		list_del_init(&grp->bb_largest_free_order_node);
+		spin_unlock(&sbi->s_mb_largest_free_orders_locks[old]);
+	}
+	i = grp->bb_largest_free_order;
+	if (i >= 0) {
+		spin_lock(&sbi->s_mb_largest_free_orders_locks[i]);
+		list_add_tail(&grp->bb_largest_free_order_node,
+			      &sbi->s_mb_largest_free_orders[i]);
+		spin_unlock(&sbi->s_mb_largest_free_orders_locks[i]);
+	}
 }
 
 static noinline_for_stack
@@ -2009,10 +2028,135 @@ static int ext4_mb_good_group(struct ext4_allocation_context *ac,
 	return 0;
 }
 
+/*
+ * Start reading the block bitmaps of up to @nr groups from @group on
+ * which still need their buddy generated, so that ext4_mb_init_group()
+ * finds the I/O done or at least in flight once the scan gets there.
+ * Returns the group the next prefetch window starts at.
+ */
+static ext4_group_t
+ext4_mb_prefetch(struct super_block *sb, ext4_group_t group,
+		 unsigned int nr, ext4_group_t ngroups)
+{
+	while (nr-- > 0) {
+		struct ext4_group_desc *desc;
+		struct ext4_group_info *grp;
+		struct buffer_head *bh;
+
+		desc = ext4_get_group_desc(sb, group, NULL);
+		grp = ext4_get_group_info(sb, group);
+		if (++group >= ngroups)
+			group = 0;
+
+		if (desc == NULL || !EXT4_MB_GRP_NEED_INIT(grp) ||
+		    grp->bb_free == 0 ||
+		    (desc->bg_flags & cpu_to_le16(EXT4_BG_BLOCK_UNINIT)))
+			continue;
+
+		bh = sb_getblk(sb, ext4_block_bitmap(sb, desc));
+		if (bh == NULL)
+			continue;
+		/*
+		 * Only the buffer is read here; ext4_mb_init_cache()
+		 * still sets the bitmap uptodate bit under the buffer
+		 * lock once it sees the data.
+		 */
+		if (!buffer_uptodate(bh))
+			ll_rw_block(READA, 1, &bh);
+		brelse(bh);
+	}
+	return group;
+}
+
+/*
+ * Pick a cr 0 candidate straight from the per-order lists: the first
+ * group whose largest free extent is at least 2^ac_2order.  The chosen
+ * group is rotated to the tail of its list, so repeated calls hand
+ * out different groups and concurrent allocators spread out.
+ */
+static int ext4_mb_choose_group_by_order(struct ext4_allocation_context *ac,
+					 ext4_group_t *group,
+					 ext4_group_t ngroups)
+{
+	struct super_block *sb = ac->ac_sb;
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	int flex_size = ext4_flex_bg_size(sbi);
+	struct ext4_group_info *grp;
+	int order;
+
+	for (order = ac->ac_2order; order < MB_NUM_ORDERS(sb); order++) {
+		struct list_head *head = &sbi->s_mb_largest_free_orders[order];
+		spinlock_t *lock = &sbi->s_mb_largest_free_orders_locks[order];
+
+		if (list_empty(head))
+			continue;
+
+		spin_lock(lock);
+		list_for_each_entry(grp, head, bb_largest_free_order_node) {
+			if (grp->bb_group >= ngroups)
+				continue;
+			/* same rule as ext4_mb_good_group() */
+			if ((ac->ac_flags & EXT4_MB_HINT_DATA) &&
+			    (flex_size >= EXT4_FLEX_SIZE_DIR_ALLOC_SCHEME) &&
+			    ((grp->bb_group % flex_size) == 0))
+				continue;
+			*group = grp->bb_group;
+			list_move_tail(&grp->bb_largest_free_order_node, head);
+			spin_unlock(lock);
+			return 1;
+		}
+		spin_unlock(lock);
+	}
+	return 0;
+}
+
+static noinline_for_stack int
+ext4_mb_scan_group(struct ext4_allocation_context *ac, ext4_group_t group,
+		   int cr)
+{
+	struct super_block *sb = ac->ac_sb;
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	struct ext4_buddy e4b;
+	int err;
+
+	/* This now checks without needing the buddy page */
+	if (!ext4_mb_good_group(ac, group, cr))
+		return 0;
+
+	err = ext4_mb_load_buddy(sb, group, &e4b);
+	if (err)
+		return err;
+
+	ext4_lock_group(sb, group);
+
+	/*
+	 * We need to check again after locking the
+	 * block group
+	 */
+	if (!ext4_mb_good_group(ac, group, cr)) {
+		ext4_unlock_group(sb, group);
+		ext4_mb_unload_buddy(&e4b);
+		return 0;
+	}
+
+	ac->ac_groups_scanned++;
+	if (cr == 0)
+		ext4_mb_simple_scan_group(ac, &e4b);
+	else if (cr == 1 && sbi->s_stripe &&
+			!(ac->ac_g_ex.fe_len % sbi->s_stripe))
+		ext4_mb_scan_aligned(ac, &e4b);
+	else
+		ext4_mb_complex_scan_group(ac, &e4b);
+
+	ext4_unlock_group(sb, group);
+	ext4_mb_unload_buddy(&e4b);
+	return 0;
+}
+
 static noinline_for_stack int
 ext4_mb_regular_allocator(struct ext4_allocation_context *ac)
 {
-	ext4_group_t ngroups, group, i;
+	ext4_group_t ngroups, group, prefetch_grp, i;
 	int cr;
 	int err = 0;
 	struct ext4_sb_info *sbi;
@@ -2074,48 +2218,47 @@ ext4_mb_regular_allocator(struct ext4_allocation_context *ac)
 repeat:
 	for (; cr < 4 && ac->ac_status == AC_STATUS_CONTINUE; cr++) {
 		ac->ac_criteria = cr;
+
+		/*
+		 * For exact 2^N requests only groups on the order lists
+		 * can satisfy cr 0, so try those instead of walking every
+		 * group.  If no initialized group qualifies, fall back to
+		 * the scan below, which also brings new groups in.
+		 */
+		if (cr == 0 && sbi->s_mb_optimize_scan &&
+		    ext4_mb_choose_group_by_order(ac, &group, ngroups)) {
+			for (i = 0; i < ngroups; i++) {
+				err = ext4_mb_scan_group(ac, group, cr);
+				if (err)
+					goto out;
+				if (ac->ac_status != AC_STATUS_CONTINUE ||
+				    !ext4_mb_choose_group_by_order(ac, &group,
+								   ngroups))
+					break;
+			}
+			continue;
+		}
+
 		/*
 		 * searching for the right group start
 		 * from the goal value specified
 		 */
 		group = ac->ac_g_ex.fe_group;
+		prefetch_grp = group;
 
 		for (i = 0; i < ngroups; group++, i++) {
 			if (group == ngroups)
 				group = 0;
 
-			/* This now checks without needing the buddy page */
-			if (!ext4_mb_good_group(ac, group, cr))
-				continue;
+			if (group == prefetch_grp && sbi->s_mb_prefetch)
+				prefetch_grp = ext4_mb_prefetch(sb, group,
+					min_t(ext4_group_t, sbi->s_mb_prefetch,
+					      ngroups), ngroups);
 
-			err = ext4_mb_load_buddy(sb, group, &e4b);
+			err = ext4_mb_scan_group(ac, group, cr);
 			if (err)
 				goto out;
 
-			ext4_lock_group(sb, group);
-
-			/*
-			 * We need to check again after locking the
-			 * block group
-			 */
-			if (!ext4_mb_good_group(ac, group, cr)) {
-				ext4_unlock_group(sb, group);
-				ext4_mb_unload_buddy(&e4b);
-				continue;
-			}
-
-			ac->ac_groups_scanned++;
-			if (cr == 0)
-				ext4_mb_simple_scan_group(ac, &e4b);
-			else if (cr == 1 && sbi->s_stripe &&
-					!(ac->ac_g_ex.fe_len % sbi->s_stripe))
-				ext4_mb_scan_aligned(ac, &e4b);
-			else
-				ext4_mb_complex_scan_group(ac, &e4b);
-
-			ext4_unlock_group(sb, group);
-			ext4_mb_unload_buddy(&e4b);
-
 			if (ac->ac_status != AC_STATUS_CONTINUE)
 				break;
 		}
@@ -2312,9 +2455,11 @@ int ext4_mb_add_groupinfo(struct super_block *sb, ext4_group_t group,
 	}
 
 	INIT_LIST_HEAD(&meta_group_info[i]->bb_prealloc_list);
+	INIT_LIST_HEAD(&meta_group_info[i]->bb_largest_free_order_node);
 	init_rwsem(&meta_group_info[i]->alloc_sem);
 	meta_group_info[i]->bb_free_root = RB_ROOT;
 	meta_group_info[i]->bb_largest_free_order = -1;  /* uninit */
+	meta_group_info[i]->bb_group = group;
 
 #ifdef DOUBLE_CHECK
 	{
@@ -2493,6 +2638,20 @@ int ext4_mb_init(struct super_block *sb, int needs_recovery)
 		goto out;
 	}
 
+	i = MB_NUM_ORDERS(sb) * sizeof(*sbi->s_mb_largest_free_orders);
+	sbi->s_mb_largest_free_orders = kmalloc(i, GFP_KERNEL);
+	i = MB_NUM_ORDERS(sb) * sizeof(*sbi->s_mb_largest_free_orders_locks);
+	sbi->s_mb_largest_free_orders_locks = kmalloc(i, GFP_KERNEL);
+	if (sbi->s_mb_largest_free_orders == NULL ||
+	    sbi->s_mb_largest_free_orders_locks == NULL) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	for (i = 0; i < MB_NUM_ORDERS(sb); i++) {
+		INIT_LIST_HEAD(&sbi->s_mb_largest_free_orders[i]);
+		spin_lock_init(&sbi->s_mb_largest_free_orders_locks[i]);
+	}
+
 	ret = ext4_groupinfo_create_slab(sb->s_blocksize);
 	if (ret < 0)
 		goto out;
@@ -2527,6 +2686,8 @@ int ext4_mb_init(struct super_block *sb, int needs_recovery)
 	sbi->s_mb_stream_request = MB_DEFAULT_STREAM_THRESHOLD;
 	sbi->s_mb_order2_reqs = MB_DEFAULT_ORDER2_REQS;
 	sbi->s_mb_group_prealloc = MB_DEFAULT_GROUP_PREALLOC;
+	sbi->s_mb_prefetch = MB_DEFAULT_PREFETCH;
+	sbi->s_mb_optimize_scan = MB_DEFAULT_OPTIMIZE_SCAN;
 
 	sbi->s_locality_groups = alloc_percpu(struct ext4_locality_group);
 	if (sbi->s_locality_groups == NULL) {
@@ -2552,6 +2713,8 @@ out:
 	if (ret) {
 		kfree(sbi->s_mb_offsets);
 		kfree(sbi->s_mb_maxs);
+		kfree(sbi->s_mb_largest_free_orders);
+		kfree(sbi->s_mb_largest_free_orders_locks);
 	}
 	return ret;
 }
@@ -2603,6 +2766,8 @@ int ext4_mb_release(struct super_block *sb)
 	}
 	kfree(sbi->s_mb_offsets);
 	kfree(sbi->s_mb_maxs);
+	kfree(sbi->s_mb_largest_free_orders);
+	kfree(sbi->s_mb_largest_free_orders_locks);
 	if (sbi->s_buddy_cache)
 		iput(sbi->s_buddy_cache);
 	if (sbi->s_mb_stats) {
@@ -94,6 +94,21 @@ extern u8 mb_enable_debug;
  */
 #define MB_DEFAULT_GROUP_PREALLOC	512
 
+/*
+ * how many groups ahead of the scan get their block bitmaps read
+ * asynchronously; 0 disables the prefetch
+ */
+#define MB_DEFAULT_PREFETCH		32
+
+/*
+ * pick cr 0 candidates from the per-order group lists instead of
+ * scanning all groups in order
+ */
+#define MB_DEFAULT_OPTIMIZE_SCAN	1
+
+/* number of buddy orders, i.e. of per-order group lists */
+#define MB_NUM_ORDERS(sb)		((sb)->s_blocksize_bits + 2)
+
 
 struct ext4_free_data {
 	/* this links the free block information from group_info */
@@ -32,9 +32,9 @@ void set_close_on_exec(unsigned int fd, int flag)
 	spin_lock(&files->file_lock);
 	fdt = files_fdtable(files);
 	if (flag)
-		FD_SET(fd, fdt->close_on_exec);
+		fdt_set_cloexec(fd, fdt);
 	else
-		FD_CLR(fd, fdt->close_on_exec);
+		fdt_clear_cloexec(fd, fdt);
 	spin_unlock(&files->file_lock);
 }
 
@@ -90,15 +90,15 @@ SYSCALL_DEFINE3(dup3, unsigned int, oldfd, unsigned int, newfd, int, flags)
 	err = -EBUSY;
 	fdt = files_fdtable(files);
 	tofree = fdt->fd[newfd];
-	if (!tofree && FD_ISSET(newfd, fdt->open_fds))
+	/* claim it atomically, alloc_fd() may be racing us without the lock */
+	if (!tofree && test_and_set_bit(newfd, fdt->open_fds->fds_bits))
 		goto out_unlock;
 	get_file(file);
 	rcu_assign_pointer(fdt->fd[newfd], file);
-	FD_SET(newfd, fdt->open_fds);
 	if (flags & O_CLOEXEC)
-		FD_SET(newfd, fdt->close_on_exec);
+		fdt_set_cloexec(newfd, fdt);
 	else
-		FD_CLR(newfd, fdt->close_on_exec);
+		fdt_clear_cloexec(newfd, fdt);
 	spin_unlock(&files->file_lock);
 
 	if (tofree)
@@ -224,9 +224,15 @@ static int expand_fdtable(struct files_struct *files, int nr)
 	 */
 	cur_fdt = files_fdtable(files);
 	if (nr >= cur_fdt->max_fds) {
-		/* Continue as planned */
+		/* Continue as planned, once the lockless users are out */
+		files->resizing = 1;
+		smp_mb();
+		while (atomic_read(&files->nolock_users))
+			cpu_relax();
 		copy_fdtable(new_fdt, cur_fdt);
 		rcu_assign_pointer(files->fdt, new_fdt);
+		smp_wmb();
+		files->resizing = 0;
 		if (cur_fdt->max_fds > NR_OPEN_DEFAULT)
 			free_fdtable(cur_fdt);
 	} else {
@@ -304,6 +310,8 @@ struct files_struct *dup_fd(struct files_struct *oldf, int *errorp)
 
 	spin_lock_init(&newf->file_lock);
 	newf->next_fd = 0;
+	atomic_set(&newf->nolock_users, 0);
+	newf->resizing = 0;
 	new_fdt = &newf->fdtab;
 	new_fdt->max_fds = NR_OPEN_DEFAULT;
 	new_fdt->close_on_exec = (fd_set *)&newf->close_on_exec_init;
@@ -366,7 +374,7 @@ struct files_struct *dup_fd(struct files_struct *oldf, int *errorp)
 			 * is partway through open().  So make sure that this
 			 * fd is available to the new process.
 			 */
-			FD_CLR(open_files - i, new_fdt->open_fds);
+			fdt_clear_open(open_files - i, new_fdt);
 		}
 		rcu_assign_pointer(*new_fds++, f);
 	}
@@ -423,8 +431,47 @@ struct files_struct init_files = {
 		.open_fds	= (fd_set *)&init_files.open_fds_init,
 	},
 	.file_lock	= __SPIN_LOCK_UNLOCKED(init_task.file_lock),
+	.nolock_users	= ATOMIC_INIT(0),
 };
 
+/*
+ * Threads sharing a table claim a free bit of open_fds with an atomic
+ * test_and_set_bit() instead of serialising on file_lock.  next_fd is
+ * only read here: it is a lower bound on the first free descriptor, and
+ * claiming bits above it can never make that untrue.  Returns -1 when
+ * the table would have to grow, and the caller takes the locked path.
+ */
+static int alloc_fd_nolock(struct files_struct *files, unsigned start,
+			   unsigned flags)
+{
+	unsigned int fd, max;
+	struct fdtable *fdt;
+
+	if (!files_nolock_begin(files))
+		return -1;
+	rcu_read_lock();
+	fdt = files_fdtable(files);
+	max = min_t(unsigned long, fdt->max_fds, rlimit(RLIMIT_NOFILE));
+	fd = max_t(unsigned int, start, ACCESS_ONCE(files->next_fd));
+	for (; fd < max; fd++) {
+		fd = find_next_zero_bit(fdt->open_fds->fds_bits, max, fd);
+		if (fd >= max)
+			break;
+		if (test_and_set_bit(fd, fdt->open_fds->fds_bits))
+			continue;
+		if (flags & O_CLOEXEC)
+			fdt_set_cloexec(fd, fdt);
+		else
+			fdt_clear_cloexec(fd, fdt);
+		rcu_read_unlock();
+		files_nolock_end(files);
+		return fd;
+	}
+	rcu_read_unlock();
+	files_nolock_end(files);
+	return -1;
+}
+
 /*
  * allocate a file descriptor, mark it busy.
  */
@@ -435,6 +482,12 @@ int alloc_fd(unsigned start, unsigned flags)
 	int error;
 	struct fdtable *fdt;
 
+	if (atomic_read(&files->count) > 1) {
+		error = alloc_fd_nolock(files, start, flags);
+		if (error >= 0)
+			return error;
+	}
+
 	spin_lock(&files->file_lock);
 repeat:
 	fdt = files_fdtable(files);
@@ -457,14 +510,17 @@ repeat:
 	if (error)
 		goto repeat;
 
+	/* A lockless alloc_fd() may have claimed it since we looked */
+	if (test_and_set_bit(fd, fdt->open_fds->fds_bits))
+		goto repeat;
+
 	if (start <= files->next_fd)
 		files->next_fd = fd + 1;
 
-	FD_SET(fd, fdt->open_fds);
 	if (flags & O_CLOEXEC)
-		FD_SET(fd, fdt->close_on_exec);
+		fdt_set_cloexec(fd, fdt);
 	else
-		FD_CLR(fd, fdt->close_on_exec);
+		fdt_clear_cloexec(fd, fdt);
 	error = fd;
 #if 1
 	/* Sanity check */
@@ -14,6 +14,7 @@
 #include <linux/fs.h>
 #include <linux/security.h>
 #include <linux/eventpoll.h>
+#include <linux/poll.h>
 #include <linux/rcupdate.h>
 #include <linux/mount.h>
 #include <linux/capability.h>
@@ -134,6 +135,7 @@ struct file *get_empty_filp(void)
 	rwlock_init(&f->f_owner.lock);
 	spin_lock_init(&f->f_lock);
 	eventpoll_init_file(f);
+	INIT_LIST_HEAD(&f->f_poll_cache_links);
 	/* f->f_version: 0 */
 	return f;
 
@@ -236,6 +238,7 @@ static void __fput(struct file *file)
 	 * in the file cleanup chain.
 	 */
 	eventpoll_release(file);
+	poll_cache_file_release(file);
 	locks_remove_flock(file);
 
 	if (unlikely(file->f_flags & FASYNC)) {
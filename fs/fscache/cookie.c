@@ -102,6 +102,7 @@ struct fscache_cookie *__fscache_acquire_cookie(
 	cookie->parent		= parent;
 	cookie->netfs_data	= netfs_data;
 	cookie->flags		= 0;
+	fscache_cookie_stat_init(cookie);
 
 	/* radix tree insertion won't use the preallocation pool unless it's
 	 * told it may not wait */
@@ -262,12 +262,47 @@ static inline void fscache_stat_d(atomic_t *stat)
 
 #define __fscache_stat(stat) (stat)
 
+/*
+ * per-cookie statistics, shown in /proc/fs/fscache/objects
+ */
+#define fscache_cookie_stat(cookie, field, n) \
+	atomic_add((n), &(cookie)->stats.field)
+
+static inline void fscache_cookie_stat_init(struct fscache_cookie *cookie)
+{
+	memset(&cookie->stats, 0, sizeof(cookie->stats));
+}
+
+static inline void fscache_cookie_stat_read_op(struct fscache_cookie *cookie,
+					       unsigned long start_jif)
+{
+	atomic_inc(&cookie->stats.read_ops);
+	atomic_long_add(jiffies - start_jif, &cookie->stats.read_jif);
+}
+
 extern const struct file_operations fscache_stats_fops;
 #else
 
 #define __fscache_stat(stat) (NULL)
 #define fscache_stat(stat) do {} while (0)
 #define fscache_stat_d(stat) do {} while (0)
+/* the field is a member name, so only the count can be passed on */
+#define fscache_cookie_stat(cookie, field, n) \
+	__fscache_cookie_stat((cookie), (n))
+
+static inline void __fscache_cookie_stat(struct fscache_cookie *cookie,
+					 unsigned n)
+{
+}
+
+static inline void fscache_cookie_stat_init(struct fscache_cookie *cookie)
+{
+}
+
+static inline void fscache_cookie_stat_read_op(struct fscache_cookie *cookie,
+					       unsigned long start_jif)
+{
+}
 #endif
 
 /*
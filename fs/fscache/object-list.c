@@ -36,6 +36,7 @@ struct fscache_objlist_data {
 #define FSCACHE_OBJLIST_CONFIG_NOEVENTS	0x00000800	/* show objects without no events */
 #define FSCACHE_OBJLIST_CONFIG_WORK	0x00001000	/* show objects with work */
 #define FSCACHE_OBJLIST_CONFIG_NOWORK	0x00002000	/* show objects without work */
+#define FSCACHE_OBJLIST_CONFIG_STATS	0x00004000	/* show cookie statistics */
 
 	u8		buf[512];	/* key and aux data buffer */
 };
@@ -176,6 +177,10 @@ static int fscache_objlist_show(struct seq_file *m, void *v)
 		seq_puts(m, "OBJECT   PARENT   STAT CHLDN OPS OOP IPR EX READS"
 			 " EM EV F S"
 			 " | NETFS_COOKIE_DEF TY FL NETFS_DATA");
+#ifdef CONFIG_FSCACHE_STATS
+		if (config & FSCACHE_OBJLIST_CONFIG_STATS)
+			seq_puts(m, " HITS     MISSES   NOBUFS   STORES   RD_MS");
+#endif
 		if (config & (FSCACHE_OBJLIST_CONFIG_KEY |
 			      FSCACHE_OBJLIST_CONFIG_AUX))
 			seq_puts(m, "       ");
@@ -195,6 +200,10 @@ static int fscache_objlist_show(struct seq_file *m, void *v)
 		seq_puts(m, "======== ======== ==== ===== === === === == ====="
 			 " == == = ="
 			 " | ================ == == ================");
+#ifdef CONFIG_FSCACHE_STATS
+		if (config & FSCACHE_OBJLIST_CONFIG_STATS)
+			seq_puts(m, " ======== ======== ======== ======== =====");
+#endif
 		if (config & (FSCACHE_OBJLIST_CONFIG_KEY |
 			      FSCACHE_OBJLIST_CONFIG_AUX))
 			seq_puts(m, " ================");
@@ -275,6 +284,23 @@ static int fscache_objlist_show(struct seq_file *m, void *v)
 				   obj->cookie->flags,
 				   obj->cookie->netfs_data);
 
+#ifdef CONFIG_FSCACHE_STATS
+			if (config & FSCACHE_OBJLIST_CONFIG_STATS) {
+				struct fscache_cookie_stats *st =
+					&obj->cookie->stats;
+				unsigned ops = atomic_read(&st->read_ops);
+				unsigned long jif =
+					atomic_long_read(&st->read_jif);
+
+				seq_printf(m, " %8u %8u %8u %8u %5u",
+					   atomic_read(&st->read_hits),
+					   atomic_read(&st->read_misses),
+					   atomic_read(&st->read_nobufs),
+					   atomic_read(&st->stores),
+					   ops ? jiffies_to_msecs(jif / ops) : 0);
+			}
+#endif
+
 			if (obj->cookie->def->get_key &&
 			    config & FSCACHE_OBJLIST_CONFIG_KEY)
 				keylen = obj->cookie->def->get_key(
@@ -354,6 +380,7 @@ static void fscache_objlist_config(struct fscache_objlist_data *data)
 		case 'r': config |= FSCACHE_OBJLIST_CONFIG_NOREADS;	break;
 		case 'S': config |= FSCACHE_OBJLIST_CONFIG_WORK;	break;
 		case 's': config |= FSCACHE_OBJLIST_CONFIG_NOWORK;	break;
+		case 'T': config |= FSCACHE_OBJLIST_CONFIG_STATS;	break;
 		}
 	}
 
@@ -227,8 +227,11 @@ static void fscache_release_retrieval_op(struct fscache_operation *_op)
 	_enter("{OP%x}", op->op.debug_id);
 
 	fscache_hist(fscache_retrieval_histogram, op->start_time);
-	if (op->context)
+	if (op->context) {
+		fscache_cookie_stat_read_op(op->op.object->cookie,
+					    op->start_time);
 		fscache_put_context(op->op.object->cookie, op->context);
+	}
 
 	_leave("");
 }
@@ -426,6 +429,13 @@ error:
 	else
 		fscache_stat(&fscache_n_retrievals_ok);
 
+	if (ret == 0)
+		fscache_cookie_stat(cookie, read_hits, 1);
+	else if (ret == -ENODATA)
+		fscache_cookie_stat(cookie, read_misses, 1);
+	else if (ret == -ENOBUFS)
+		fscache_cookie_stat(cookie, read_nobufs, 1);
+
 	fscache_put_retrieval(op);
 	_leave(" = %d", ret);
 	return ret;
@@ -435,6 +445,7 @@ nobufs_unlock:
 	kfree(op);
 nobufs:
 	fscache_stat(&fscache_n_retrievals_nobufs);
+	fscache_cookie_stat(cookie, read_nobufs, 1);
 	_leave(" = -ENOBUFS");
 	return -ENOBUFS;
 }
@@ -468,6 +479,7 @@ int __fscache_read_or_alloc_pages(struct fscache_cookie *cookie,
 {
 	struct fscache_retrieval *op;
 	struct fscache_object *object;
+	unsigned nr_requested = *nr_pages;
 	int ret;
 
 	_enter("%p,,%d,,,", cookie, *nr_pages);
@@ -543,6 +555,13 @@ error:
 	else
 		fscache_stat(&fscache_n_retrievals_ok);
 
+	/* pages the cache is reading have been taken off the list */
+	fscache_cookie_stat(cookie, read_hits, nr_requested - *nr_pages);
+	if (ret == -ENODATA)
+		fscache_cookie_stat(cookie, read_misses, *nr_pages);
+	else if (ret == -ENOBUFS)
+		fscache_cookie_stat(cookie, read_nobufs, *nr_pages);
+
 	fscache_put_retrieval(op);
 	_leave(" = %d", ret);
 	return ret;
@@ -552,6 +571,7 @@ nobufs_unlock:
 	kfree(op);
 nobufs:
 	fscache_stat(&fscache_n_retrievals_nobufs);
+	fscache_cookie_stat(cookie, read_nobufs, *nr_pages);
 	_leave(" = -ENOBUFS");
 	return -ENOBUFS;
 }
@@ -648,6 +668,8 @@ static void fscache_release_write_op(struct fscache_operation *_op)
 
 /*
  * perform the background storage of a page into the cache
+ * - up to FSCACHE_STORE_BATCH pending pages with consecutive indices are
+ *   handed to the cache together if it can write them in one go
  */
 static void fscache_write_op(struct fscache_operation *_op)
 {
@@ -655,9 +677,8 @@ static void fscache_write_op(struct fscache_operation *_op)
 		container_of(_op, struct fscache_storage, op);
 	struct fscache_object *object = op->op.object;
 	struct fscache_cookie *cookie;
-	struct page *page;
-	unsigned n;
-	void *results[1];
+	struct page *pages[FSCACHE_STORE_BATCH];
+	unsigned n, loop, nr_pages;
 	int ret;
 
 	_enter("{OP%x,%d}", op->op.debug_id, atomic_read(&op->op.usage));
@@ -677,34 +698,47 @@ static void fscache_write_op(struct fscache_operation *_op)
 
 	fscache_stat(&fscache_n_store_calls);
 
-	/* find a page to store */
-	page = NULL;
-	n = radix_tree_gang_lookup_tag(&cookie->stores, results, 0, 1,
-				       FSCACHE_COOKIE_PENDING_TAG);
-	if (n != 1)
+	/* find some pages to store */
+	nr_pages = object->cache->ops->write_pages ? FSCACHE_STORE_BATCH : 1;
+	n = radix_tree_gang_lookup_tag(&cookie->stores, (void **) pages, 0,
+				       nr_pages, FSCACHE_COOKIE_PENDING_TAG);
+	if (n == 0)
 		goto superseded;
-	page = results[0];
-	_debug("gang %d [%lx]", n, page->index);
-	if (page->index > op->store_limit) {
+	_debug("gang %d [%lx]", n, pages[0]->index);
+	if (pages[0]->index > op->store_limit) {
 		fscache_stat(&fscache_n_store_pages_over_limit);
 		goto superseded;
 	}
 
-	radix_tree_tag_set(&cookie->stores, page->index,
-			   FSCACHE_COOKIE_STORING_TAG);
-	radix_tree_tag_clear(&cookie->stores, page->index,
-			     FSCACHE_COOKIE_PENDING_TAG);
+	/* only take the run that directly follows the first page */
+	for (nr_pages = 1; nr_pages < n; nr_pages++)
+		if (pages[nr_pages]->index != pages[0]->index + nr_pages ||
+		    pages[nr_pages]->index > op->store_limit)
+			break;
+
+	for (loop = 0; loop < nr_pages; loop++) {
+		radix_tree_tag_set(&cookie->stores, pages[loop]->index,
+				   FSCACHE_COOKIE_STORING_TAG);
+		radix_tree_tag_clear(&cookie->stores, pages[loop]->index,
+				     FSCACHE_COOKIE_PENDING_TAG);
+	}
+	fscache_cookie_stat(cookie, stores, nr_pages);
 
 	spin_unlock(&cookie->stores_lock);
 	spin_unlock(&object->lock);
 
 	fscache_set_op_state(&op->op, "Store");
-	fscache_stat(&fscache_n_store_pages);
+	for (loop = 0; loop < nr_pages; loop++)
+		fscache_stat(&fscache_n_store_pages);
 	fscache_stat(&fscache_n_cop_write_page);
-	ret = object->cache->ops->write_page(op, page);
+	if (nr_pages > 1)
+		ret = object->cache->ops->write_pages(op, pages, nr_pages);
+	else
+		ret = object->cache->ops->write_page(op, pages[0]);
 	fscache_stat_d(&fscache_n_cop_write_page);
 	fscache_set_op_state(&op->op, "EndWrite");
-	fscache_end_page_write(object, page);
+	for (loop = 0; loop < nr_pages; loop++)
+		fscache_end_page_write(object, pages[loop]);
 	if (ret < 0) {
 		fscache_set_op_state(&op->op, "Abort");
 		fscache_abort_object(object);
@@ -25,7 +25,7 @@ MODULE_ALIAS("devname:fuse");
 
 static struct kmem_cache *fuse_req_cachep;
 
-static struct fuse_conn *fuse_get_conn(struct file *file)
+static struct fuse_dev *fuse_get_dev(struct file *file)
 {
 	/*
 	 * Lockless access is OK, because file->private data is set
@@ -34,6 +34,61 @@ static struct fuse_conn *fuse_get_conn(struct file *file)
 	return file->private_data;
 }
 
+static struct fuse_conn *fuse_get_conn(struct file *file)
+{
+	struct fuse_dev *fud = fuse_get_dev(file);
+
+	return fud ? fud->fc : NULL;
+}
+
+struct fuse_dev *fuse_dev_alloc(struct fuse_conn *fc)
+{
+	struct fuse_dev *fud = kzalloc(sizeof(*fud), GFP_KERNEL);
+
+	if (fud) {
+		fud->fc = fc;
+		atomic_inc(&fc->dev_count);
+	}
+	return fud;
+}
+EXPORT_SYMBOL_GPL(fuse_dev_alloc);
+
+void fuse_dev_free(struct fuse_dev *fud)
+{
+	atomic_dec(&fud->fc->dev_count);
+	kfree(fud);
+}
+EXPORT_SYMBOL_GPL(fuse_dev_free);
+
+/*
+ * Wake a reader for a request added to @fq.  Readers of a queue take
+ * requests from the other queues when their own is empty, so if nobody
+ * waits on @fq, wake a reader of another queue instead of leaving the
+ * request sitting there.
+ */
+static void fuse_wake_reader(struct fuse_conn *fc, struct fuse_queue *fq)
+{
+	unsigned i;
+
+	if (fc->nr_queues > 1 && !waitqueue_active(&fq->waitq)) {
+		for (i = 0; i < fc->nr_queues; i++) {
+			if (waitqueue_active(&fc->queues[i].waitq)) {
+				fq = &fc->queues[i];
+				break;
+			}
+		}
+	}
+	wake_up(&fq->waitq);
+}
+
+void fuse_dev_wake_all(struct fuse_conn *fc)
+{
+	unsigned i;
+
+	for (i = 0; i < FUSE_MAX_QUEUES; i++)
+		wake_up_all(&fc->queues[i].waitq);
+}
+
 static void fuse_request_init(struct fuse_req *req)
 {
 	memset(req, 0, sizeof(*req));
@@ -239,15 +294,18 @@ static u64 fuse_get_unique(struct fuse_conn *fc)
 
 static void queue_request(struct fuse_conn *fc, struct fuse_req *req)
 {
+	struct fuse_queue *fq;
+
+	fq = &fc->queues[raw_smp_processor_id() % fc->nr_queues];
 	req->in.h.len = sizeof(struct fuse_in_header) +
 		len_args(req->in.numargs, (struct fuse_arg *) req->in.args);
-	list_add_tail(&req->list, &fc->pending);
+	list_add_tail(&req->list, &fq->pending);
 	req->state = FUSE_REQ_PENDING;
 	if (!req->waiting) {
 		req->waiting = 1;
 		atomic_inc(&fc->num_waiting);
 	}
-	wake_up(&fc->waitq);
+	fuse_wake_reader(fc, fq);
 	kill_fasync(&fc->fasync, SIGIO, POLL_IN);
 }
 
@@ -260,7 +318,7 @@ void fuse_queue_forget(struct fuse_conn *fc, struct fuse_forget_link *forget,
 	spin_lock(&fc->lock);
 	fc->forget_list_tail->next = forget;
 	fc->forget_list_tail = forget;
-	wake_up(&fc->waitq);
+	fuse_wake_reader(fc, &fc->queues[0]);
 	kill_fasync(&fc->fasync, SIGIO, POLL_IN);
 	spin_unlock(&fc->lock);
 }
@@ -334,7 +392,7 @@ __acquires(fc->lock)
 static void queue_interrupt(struct fuse_conn *fc, struct fuse_req *req)
 {
 	list_add_tail(&req->intr_entry, &fc->interrupts);
-	wake_up(&fc->waitq);
+	fuse_wake_reader(fc, &fc->queues[0]);
 	kill_fasync(&fc->fasync, SIGIO, POLL_IN);
 }
 
@@ -909,21 +967,38 @@ static int forget_pending(struct fuse_conn *fc)
 	return fc->forget_list_head.next != NULL;
 }
 
-static int request_pending(struct fuse_conn *fc)
+/*
+ * Return the queue a reader preferring @fq should take its next request
+ * from: @fq itself if it has one, else the first other non-empty queue
+ */
+static struct fuse_queue *next_pending_queue(struct fuse_conn *fc,
+					     struct fuse_queue *fq)
+{
+	unsigned i;
+
+	if (!list_empty(&fq->pending))
+		return fq;
+	for (i = 0; i < fc->nr_queues; i++)
+		if (!list_empty(&fc->queues[i].pending))
+			return &fc->queues[i];
+	return NULL;
+}
+
+static int request_pending(struct fuse_conn *fc, struct fuse_queue *fq)
 {
-	return !list_empty(&fc->pending) || !list_empty(&fc->interrupts) ||
+	return next_pending_queue(fc, fq) || !list_empty(&fc->interrupts) ||
 		forget_pending(fc);
 }
 
-/* Wait until a request is available on the pending list */
-static void request_wait(struct fuse_conn *fc)
+/* Wait until a request is available on one of the pending lists */
+static void request_wait(struct fuse_conn *fc, struct fuse_queue *fq)
 __releases(fc->lock)
 __acquires(fc->lock)
 {
 	DECLARE_WAITQUEUE(wait, current);
 
-	add_wait_queue_exclusive(&fc->waitq, &wait);
-	while (fc->connected && !request_pending(fc)) {
+	add_wait_queue_exclusive(&fq->waitq, &wait);
+	while (fc->connected && !request_pending(fc, fq)) {
 		set_current_state(TASK_INTERRUPTIBLE);
 		if (signal_pending(current))
 			break;
@@ -933,7 +1008,7 @@ __acquires(fc->lock)
 		spin_lock(&fc->lock);
 	}
 	set_current_state(TASK_RUNNING);
-	remove_wait_queue(&fc->waitq, &wait);
+	remove_wait_queue(&fq->waitq, &wait);
 }
 
 /*
@@ -1103,21 +1178,23 @@ static ssize_t fuse_dev_do_read(struct fuse_conn *fc, struct file *file,
 	int err;
 	struct fuse_req *req;
 	struct fuse_in *in;
+	struct fuse_queue *fq;
 	unsigned reqsize;
 
  restart:
 	spin_lock(&fc->lock);
+	fq = &fc->queues[fuse_get_dev(file)->queue];
 	err = -EAGAIN;
 	if ((file->f_flags & O_NONBLOCK) && fc->connected &&
-	    !request_pending(fc))
+	    !request_pending(fc, fq))
 		goto err_unlock;
 
-	request_wait(fc);
+	request_wait(fc, fq);
 	err = -ENODEV;
 	if (!fc->connected)
 		goto err_unlock;
 	err = -ERESTARTSYS;
-	if (!request_pending(fc))
+	if (!request_pending(fc, fq))
 		goto err_unlock;
 
 	if (!list_empty(&fc->interrupts)) {
@@ -1126,15 +1203,16 @@ static ssize_t fuse_dev_do_read(struct fuse_conn *fc, struct file *file,
 		return fuse_read_interrupt(fc, cs, nbytes, req);
 	}
 
+	fq = next_pending_queue(fc, fq);
 	if (forget_pending(fc)) {
-		if (list_empty(&fc->pending) || fc->forget_batch-- > 0)
+		if (!fq || fc->forget_batch-- > 0)
 			return fuse_read_forget(fc, cs, nbytes);
 
 		if (fc->forget_batch <= -8)
 			fc->forget_batch = 16;
 	}
 
-	req = list_entry(fc->pending.next, struct fuse_req, list);
+	req = list_entry(fq->pending.next, struct fuse_req, list);
 	req->state = FUSE_REQ_READING;
 	list_move(&req->list, &fc->io);
 
@@ -1827,16 +1905,20 @@ out:
 static unsigned fuse_dev_poll(struct file *file, poll_table *wait)
 {
 	unsigned mask = POLLOUT | POLLWRNORM;
-	struct fuse_conn *fc = fuse_get_conn(file);
-	if (!fc)
+	struct fuse_queue *fq;
+	struct fuse_dev *fud = fuse_get_dev(file);
+	struct fuse_conn *fc;
+	if (!fud)
 		return POLLERR;
 
-	poll_wait(file, &fc->waitq, wait);
+	fc = fud->fc;
+	fq = &fc->queues[fud->queue];
+	poll_wait(file, &fq->waitq, wait);
 
 	spin_lock(&fc->lock);
 	if (!fc->connected)
 		mask = POLLERR;
-	else if (request_pending(fc))
+	else if (request_pending(fc, fq))
 		mask |= POLLIN | POLLRDNORM;
 	spin_unlock(&fc->lock);
 
@@ -1902,9 +1984,12 @@ static void end_queued_requests(struct fuse_conn *fc)
 __releases(fc->lock)
 __acquires(fc->lock)
 {
+	unsigned i;
+
 	fc->max_background = UINT_MAX;
 	flush_bg_queue(fc);
-	end_requests(fc, &fc->pending);
+	for (i = 0; i < FUSE_MAX_QUEUES; i++)
+		end_requests(fc, &fc->queues[i].pending);
 	end_requests(fc, &fc->processing);
 	while (forget_pending(fc))
 		kfree(dequeue_forget(fc, 1, NULL));
@@ -1937,7 +2022,7 @@ void fuse_abort_conn(struct fuse_conn *fc)
 		fc->blocked = 0;
 		end_io_requests(fc);
 		end_queued_requests(fc);
-		wake_up_all(&fc->waitq);
+		fuse_dev_wake_all(fc);
 		wake_up_all(&fc->blocked_waitq);
 		kill_fasync(&fc->fasync, SIGIO, POLL_IN);
 	}
@@ -1947,21 +2032,92 @@ EXPORT_SYMBOL_GPL(fuse_abort_conn);
 
 int fuse_dev_release(struct inode *inode, struct file *file)
 {
-	struct fuse_conn *fc = fuse_get_conn(file);
-	if (fc) {
-		spin_lock(&fc->lock);
-		fc->connected = 0;
-		fc->blocked = 0;
-		end_queued_requests(fc);
-		wake_up_all(&fc->blocked_waitq);
-		spin_unlock(&fc->lock);
+	struct fuse_dev *fud = fuse_get_dev(file);
+	if (fud) {
+		struct fuse_conn *fc = fud->fc;
+
+		/* The connection goes away with its last device file */
+		if (atomic_dec_and_test(&fc->dev_count)) {
+			spin_lock(&fc->lock);
+			fc->connected = 0;
+			fc->blocked = 0;
+			end_queued_requests(fc);
+			wake_up_all(&fc->blocked_waitq);
+			spin_unlock(&fc->lock);
+		}
 		fuse_conn_put(fc);
+		kfree(fud);
 	}
 
 	return 0;
 }
 EXPORT_SYMBOL_GPL(fuse_dev_release);
 
+/*
+ * Attach @new, a freshly opened /dev/fuse, to the connection of @old.
+ * The clone gets the next request queue, so that a multi-threaded
+ * daemon can give each thread its own file and queue.
+ */
+static int fuse_dev_clone(struct file *new, struct file *old)
+{
+	struct fuse_dev *old_fud, *fud;
+	struct fuse_conn *fc;
+	int err;
+
+	if (new->f_op != &fuse_dev_operations ||
+	    old->f_op != &fuse_dev_operations)
+		return -EINVAL;
+
+	mutex_lock(&fuse_mutex);
+	err = -EINVAL;
+	old_fud = fuse_get_dev(old);
+	if (!old_fud || new->private_data)
+		goto out_unlock;
+
+	fc = old_fud->fc;
+	err = -ENOMEM;
+	fud = fuse_dev_alloc(fc);
+	if (!fud)
+		goto out_unlock;
+
+	spin_lock(&fc->lock);
+	if (fc->nr_queues < FUSE_MAX_QUEUES)
+		fud->queue = fc->nr_queues++;
+	else
+		fud->queue = atomic_read(&fc->dev_count) % FUSE_MAX_QUEUES;
+	spin_unlock(&fc->lock);
+
+	new->private_data = fud;
+	fuse_conn_get(fc);
+	err = 0;
+
+ out_unlock:
+	mutex_unlock(&fuse_mutex);
+	return err;
+}
+
+static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
+			   unsigned long arg)
+{
+	struct file *old;
+	__u32 oldfd;
+	int err;
+
+	if (cmd != FUSE_DEV_IOC_CLONE)
+		return -ENOTTY;
+
+	if (get_user(oldfd, (__u32 __user *) arg))
+		return -EFAULT;
+
+	old = fget(oldfd);
+	if (!old)
+		return -EINVAL;
+
+	err = fuse_dev_clone(file, old);
+	fput(old);
+	return err;
+}
+
 static int fuse_dev_fasync(int fd, struct file *file, int on)
 {
 	struct fuse_conn *fc = fuse_get_conn(file);
@@ -1984,6 +2140,8 @@ const struct file_operations fuse_dev_operations = {
 	.poll		= fuse_dev_poll,
 	.release	= fuse_dev_release,
 	.fasync		= fuse_dev_fasync,
+	.unlocked_ioctl	= fuse_dev_ioctl,
+	.compat_ioctl	= fuse_dev_ioctl,
 };
 EXPORT_SYMBOL_GPL(fuse_dev_operations);
 
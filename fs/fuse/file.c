@@ -512,6 +512,7 @@ static int fuse_readpage(struct file *file, struct page *page)
 	struct inode *inode = page->mapping->host;
 	struct fuse_conn *fc = get_fuse_conn(inode);
 	struct fuse_req *req;
+	struct page *newpage;
 	size_t num_read;
 	loff_t pos = page_offset(page);
 	size_t count = PAGE_CACHE_SIZE;
@@ -536,12 +537,20 @@ static int fuse_readpage(struct file *file, struct page *page)
 
 	attr_ver = fuse_get_attr_version(fc);
 
+	/*
+	 * Let the daemon splice a page of its own in place of ours.  The
+	 * request holds a reference on the page, which is what gets
+	 * dropped if the page is replaced.
+	 */
 	req->out.page_zeroing = 1;
+	req->out.page_replace = 1;
 	req->out.argpages = 1;
 	req->num_pages = 1;
 	req->pages[0] = page;
+	page_cache_get(page);
 	num_read = fuse_send_read(req, file, pos, count, NULL);
 	err = req->out.h.error;
+	newpage = req->pages[0];
 	fuse_put_request(fc, req);
 
 	if (!err) {
@@ -551,10 +560,21 @@ static int fuse_readpage(struct file *file, struct page *page)
 		if (num_read < count)
 			fuse_read_update_size(inode, pos + num_read, attr_ver);
 
-		SetPageUptodate(page);
+		SetPageUptodate(newpage);
 	}
 
 	fuse_invalidate_attr(inode); /* atime changed */
+
+	if (newpage != page) {
+		/*
+		 * The original page has already been unlocked and removed
+		 * from the page cache; have the caller look up the new one.
+		 */
+		unlock_page(newpage);
+		page_cache_release(newpage);
+		return err ? err : AOP_TRUNCATED_PAGE;
+	}
+	page_cache_release(page);
  out:
 	unlock_page(page);
 	return err;
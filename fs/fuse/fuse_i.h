@@ -35,6 +35,9 @@
 /** Number of dentries for each connection in the control filesystem */
 #define FUSE_CTL_NUM_DENTRIES 5
 
+/** Maximum number of request queues of a connection */
+#define FUSE_MAX_QUEUES 8
+
 /** If the FUSE_DEFAULT_PERMISSIONS flag is given, the filesystem
     module will check permissions based on the file mode.  Otherwise no
     permission checking is done in the kernel */
@@ -310,6 +313,17 @@ struct fuse_req {
 	struct file *stolen_file;
 };
 
+/**
+ * A queue of requests waiting to be read by the daemon
+ */
+struct fuse_queue {
+	/** Readers of this queue are waiting on this */
+	wait_queue_head_t waitq;
+
+	/** The list of pending requests */
+	struct list_head pending;
+};
+
 /**
  * A Fuse connection.
  *
@@ -342,11 +356,14 @@ struct fuse_conn {
 	/** Maximum write size */
 	unsigned max_write;
 
-	/** Readers of the connection are waiting on this */
-	wait_queue_head_t waitq;
+	/** Request queues; requests go to the queue of the sending CPU */
+	struct fuse_queue queues[FUSE_MAX_QUEUES];
 
-	/** The list of pending requests */
-	struct list_head pending;
+	/** Number of queues in use, one per device file up to the max */
+	unsigned nr_queues;
+
+	/** Number of open device files attached to the connection */
+	atomic_t dev_count;
 
 	/** The list of requests being processed */
 	struct list_head processing;
@@ -541,6 +558,18 @@ extern const struct file_operations fuse_dev_operations;
 
 extern const struct dentry_operations fuse_dentry_operations;
 
+/**
+ * An open device file of a connection.  Each clone of the device
+ * (FUSE_DEV_IOC_CLONE) reads from its own queue first.
+ */
+struct fuse_dev {
+	/** The connection */
+	struct fuse_conn *fc;
+
+	/** Index of the queue in fc->queues this file prefers */
+	unsigned queue;
+};
+
 /**
  * Inode to nodeid comparison.
  */
@@ -637,6 +666,19 @@ int fuse_dev_init(void);
  */
 void fuse_dev_cleanup(void);
 
+/**
+ * Allocate a device file for the connection.  The caller provides the
+ * connection reference that fuse_dev_release() drops; fuse_dev_free()
+ * discards a device file that was never installed.
+ */
+struct fuse_dev *fuse_dev_alloc(struct fuse_conn *fc);
+void fuse_dev_free(struct fuse_dev *fud);
+
+/**
+ * Wake up every reader of the connection
+ */
+void fuse_dev_wake_all(struct fuse_conn *fc);
+
 int fuse_ctl_init(void);
 void fuse_ctl_cleanup(void);
 
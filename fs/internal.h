@@ -100,6 +100,13 @@ extern int do_remount_sb(struct super_block *, int, void *, int);
 extern void __put_super(struct super_block *sb);
 extern void put_super(struct super_block *sb);
 
+/* Must be called with preemption disabled, as rcu-walk runs */
+#ifdef CONFIG_SMP
+#define sb_walk_stats_inc(sb, field)	__this_cpu_inc((sb)->s_walk_stats->field)
+#else
+#define sb_walk_stats_inc(sb, field)	((sb)->s_walk_stats.field++)
+#endif
+
 /*
  * open.c
  */
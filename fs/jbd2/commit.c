@@ -226,6 +226,27 @@ static int journal_submit_data_buffers(journal_t *journal,
 	return ret;
 }
 
+/*
+ * Called while the commit record is in flight.  If a commit of the
+ * running transaction has already been asked for (fsync), start writing
+ * its ordered data now instead of when its commit begins, so that the
+ * two commits overlap.  The running transaction can only be committed,
+ * and so freed, by this thread.
+ */
+static void journal_submit_next_data(journal_t *journal)
+{
+	transaction_t *next;
+
+	read_lock(&journal->j_state_lock);
+	next = journal->j_running_transaction;
+	if (next && !tid_geq(journal->j_commit_request, next->t_tid))
+		next = NULL;
+	read_unlock(&journal->j_state_lock);
+
+	if (next)
+		journal_submit_data_buffers(journal, next);
+}
+
 /*
  * Wait for data submitted for writeout, refile inodes to proper
  * transaction if needed.
@@ -808,8 +829,10 @@ wait_for_iobuf:
 		if (err)
 			__jbd2_journal_abort_hard(journal);
 	}
-	if (!err && !is_journal_aborted(journal))
+	if (!err && !is_journal_aborted(journal)) {
+		journal_submit_next_data(journal);
 		err = journal_wait_on_commit_record(journal, cbh);
+	}
 	if (JBD2_HAS_INCOMPAT_FEATURE(journal,
 				      JBD2_FEATURE_INCOMPAT_ASYNC_COMMIT) &&
 	    journal->j_flags & JBD2_BARRIER) {
@@ -1001,6 +1024,8 @@ restart_loop:
 	else
 		journal->j_average_commit_time = commit_time;
 	write_unlock(&journal->j_state_lock);
+	jbd2_hist_account(journal, journal->j_stats.ts_commit_hist,
+			  commit_time);
 
 	if (commit_transaction->t_checkpoint_list == NULL &&
 	    commit_transaction->t_checkpoint_io_list == NULL) {
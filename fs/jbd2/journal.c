@@ -709,6 +709,38 @@ static void *jbd2_seq_info_next(struct seq_file *seq, void *v, loff_t *pos)
 	return NULL;
 }
 
+/*
+ * Account a latency of @ns nanoseconds in one of the j_stats
+ * histograms.
+ */
+void jbd2_hist_account(journal_t *journal, unsigned long *hist, u64 ns)
+{
+	int bucket = fls64(div_u64(ns, 1000) >> JBD2_HIST_SHIFT);
+
+	if (bucket > JBD2_HIST_BUCKETS - 1)
+		bucket = JBD2_HIST_BUCKETS - 1;
+
+	spin_lock(&journal->j_history_lock);
+	hist[bucket]++;
+	spin_unlock(&journal->j_history_lock);
+}
+
+static void jbd2_seq_print_hist(struct seq_file *seq, const char *name,
+				unsigned long *hist)
+{
+	int i;
+
+	seq_printf(seq, "%s histogram:\n", name);
+	seq_printf(seq, "  %8s<%6uus: %lu\n", "",
+		   1U << JBD2_HIST_SHIFT, hist[0]);
+	for (i = 1; i < JBD2_HIST_BUCKETS - 1; i++)
+		seq_printf(seq, "  %6uus-%6uus: %lu\n",
+			   1U << (JBD2_HIST_SHIFT + i - 1),
+			   1U << (JBD2_HIST_SHIFT + i), hist[i]);
+	seq_printf(seq, "  %6uus-%8s: %lu\n",
+		   1U << (JBD2_HIST_SHIFT + i - 1), "", hist[i]);
+}
+
 static int jbd2_seq_info_show(struct seq_file *seq, void *v)
 {
 	struct jbd2_stats_proc_session *s = seq->private;
@@ -738,6 +770,8 @@ static int jbd2_seq_info_show(struct seq_file *seq, void *v)
 	    s->stats->run.rs_blocks / s->stats->ts_tid);
 	seq_printf(seq, "  %lu logged blocks per transaction\n",
 	    s->stats->run.rs_blocks_logged / s->stats->ts_tid);
+	jbd2_seq_print_hist(seq, "commit time", s->stats->ts_commit_hist);
+	jbd2_seq_print_hist(seq, "handle wait time", s->stats->ts_wait_hist);
 	return 0;
 }
 
@@ -107,6 +107,18 @@ static inline void update_t_max_wait(transaction_t *transaction)
 #endif
 }
 
+/*
+ * Note when a handle first has to sleep in start_this_handle(), for the
+ * handle wait time histogram.
+ */
+static inline void handle_wait_begin(int *waited, ktime_t *start)
+{
+	if (!*waited) {
+		*waited = 1;
+		*start = ktime_get();
+	}
+}
+
 /*
  * start_this_handle: Given a handle, deal with any locking or stalling
  * needed to make sure that there is enough journal space for the handle
@@ -121,6 +133,8 @@ static int start_this_handle(journal_t *journal, handle_t *handle,
 	tid_t		tid;
 	int		needed, need_to_start;
 	int		nblocks = handle->h_buffer_credits;
+	ktime_t		wait_start = ktime_set(0, 0);
+	int		waited = 0;
 
 	if (nblocks > journal->j_max_transaction_buffers) {
 		printk(KERN_ERR "JBD: %s wants too many credits (%d > %d)\n",
@@ -167,6 +181,7 @@ repeat:
 	/* Wait on the journal's transaction barrier if necessary */
 	if (journal->j_barrier_count) {
 		read_unlock(&journal->j_state_lock);
+		handle_wait_begin(&waited, &wait_start);
 		wait_event(journal->j_wait_transaction_locked,
 				journal->j_barrier_count == 0);
 		goto repeat;
@@ -197,6 +212,7 @@ repeat:
 		prepare_to_wait(&journal->j_wait_transaction_locked,
 					&wait, TASK_UNINTERRUPTIBLE);
 		read_unlock(&journal->j_state_lock);
+		handle_wait_begin(&waited, &wait_start);
 		schedule();
 		finish_wait(&journal->j_wait_transaction_locked, &wait);
 		goto repeat;
@@ -227,6 +243,7 @@ repeat:
 		read_unlock(&journal->j_state_lock);
 		if (need_to_start)
 			jbd2_log_start_commit(journal, tid);
+		handle_wait_begin(&waited, &wait_start);
 		schedule();
 		finish_wait(&journal->j_wait_transaction_locked, &wait);
 		goto repeat;
@@ -261,6 +278,7 @@ repeat:
 		jbd_debug(2, "Handle %p waiting for checkpoint...\n", handle);
 		atomic_sub(nblocks, &transaction->t_outstanding_credits);
 		read_unlock(&journal->j_state_lock);
+		handle_wait_begin(&waited, &wait_start);
 		write_lock(&journal->j_state_lock);
 		if (__jbd2_log_space_left(journal) < jbd_space_needed(journal))
 			__jbd2_log_wait_for_space(journal);
@@ -281,6 +299,11 @@ repeat:
 		  __jbd2_log_space_left(journal));
 	read_unlock(&journal->j_state_lock);
 
+	if (waited)
+		jbd2_hist_account(journal, journal->j_stats.ts_wait_hist,
+				  ktime_to_ns(ktime_sub(ktime_get(),
+							wait_start)));
+
 	lock_map_acquire(&handle->h_lockdep_map);
 	kfree(new_transaction);
 	return 0;
@@ -264,8 +264,17 @@ int jffs2_check_acl(struct inode *inode, int mask, unsigned int flags)
 	struct posix_acl *acl;
 	int rc;
 
-	if (flags & IPERM_FLAG_RCU)
-		return -ECHILD;
+	if (flags & IPERM_FLAG_RCU) {
+		/* only the cached ACL may be used without blocking */
+		acl = get_cached_acl(inode, ACL_TYPE_ACCESS);
+		if (acl == ACL_NOT_CACHED)
+			return -ECHILD;
+		if (!acl)
+			return -EAGAIN;
+		rc = posix_acl_permission(inode, acl, mask);
+		posix_acl_release(acl);
+		return rc;
+	}
 
 	acl = jffs2_get_acl(inode, ACL_TYPE_ACCESS);
 	if (IS_ERR(acl))
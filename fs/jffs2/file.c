@@ -32,8 +32,9 @@ int jffs2_fsync(struct file *filp, int datasync)
 	struct inode *inode = filp->f_mapping->host;
 	struct jffs2_sb_info *c = JFFS2_SB_INFO(inode->i_sb);
 
-	/* Trigger GC to flush any pending writes for this inode */
-	jffs2_flush_wbuf_gc(c, inode->i_ino);
+	/* Flush any pending writes for this inode, batching with
+	   concurrent fsyncs where possible */
+	jffs2_fsync_wbuf(c, inode->i_ino);
 
 	return 0;
 }
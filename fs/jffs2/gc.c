@@ -125,15 +125,24 @@ int jffs2_garbage_collect_pass(struct jffs2_sb_info *c)
 	struct jffs2_raw_node_ref *raw;
 	uint32_t gcblock_dirty;
 	int ret = 0, inum, nlink;
-	int xattr = 0;
+	int xattr = 0, queued;
 
 	if (mutex_lock_interruptible(&c->alloc_sem))
 		return -EINTR;
 
 	for (;;) {
 		spin_lock(&c->erase_completion_lock);
-		if (!c->unchecked_size)
+		if (!c->unchecked_size) {
+			if (c->check_start) {
+				printk(KERN_DEBUG "jffs2: node CRC checks completed in %u ms: "
+				       "%u inodes in order, %u queued, %u on read\n",
+				       jiffies_to_msecs(jiffies - c->check_start),
+				       c->checked_bg, c->checked_queued,
+				       c->checked_on_read);
+				c->check_start = 0;
+			}
 			break;
+		}
 
 		/* We can't start doing GC yet. We haven't finished checking
 		   the node CRCs etc. Do it now. */
@@ -155,6 +164,12 @@ int jffs2_garbage_collect_pass(struct jffs2_sb_info *c)
 
 		spin_lock(&c->inocache_lock);
 
+		ic = jffs2_next_queued_check(c);
+		if (ic) {
+			queued = 1;
+			goto check;
+		}
+		queued = 0;
 		ic = jffs2_get_ino_cache(c, c->checked_ino++);
 
 		if (!ic) {
@@ -201,7 +216,12 @@ int jffs2_garbage_collect_pass(struct jffs2_sb_info *c)
 		case INO_STATE_UNCHECKED:
 			;
 		}
+ check:
 		ic->state = INO_STATE_CHECKING;
+		if (queued)
+			c->checked_queued++;
+		else
+			c->checked_bg++;
 		spin_unlock(&c->inocache_lock);
 
 		D1(printk(KERN_DEBUG "jffs2_garbage_collect_pass() triggering inode scan of ino#%u\n", ic->ino));
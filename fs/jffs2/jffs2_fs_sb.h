@@ -22,6 +22,7 @@
 #include <linux/wait.h>
 #include <linux/list.h>
 #include <linux/rwsem.h>
+#include <asm/atomic.h>
 
 #define JFFS2_SB_FLAG_RO 1
 #define JFFS2_SB_FLAG_SCANNING 2 /* Flash scanning is in progress */
@@ -29,6 +30,8 @@
 
 struct jffs2_inodirty;
 
+#define JFFS2_CHECK_QUEUE_LEN 64
+
 /* A struct for the overall file system control.  Pointers to
    jffs2_sb_info structs are named `c' in the source code.
    Nee jffs_control
@@ -104,6 +107,17 @@ struct jffs2_sb_info {
 	struct jffs2_inode_cache **inocache_list;
 	spinlock_t inocache_lock;
 
+	/* Inodes to CRC-check before continuing in inode number order,
+	   filled as directories are read. Protected by inocache_lock,
+	   as are the counters below. */
+	uint32_t check_queue[JFFS2_CHECK_QUEUE_LEN];
+	int check_queue_head;
+	int check_queue_len;
+	uint32_t checked_bg;		/* Checked in inode number order */
+	uint32_t checked_queued;	/* Checked from check_queue */
+	uint32_t checked_on_read;	/* Checked by being read in */
+	unsigned long check_start;	/* jiffies at mount, while checking */
+
 	/* Sem to allow jffs2_garbage_collect_deletion_dirent to
 	   drop the erase_completion_lock while it's holding a pointer
 	   to an obsoleted node. I don't like this. Alternatives welcomed. */
@@ -121,6 +135,14 @@ struct jffs2_sb_info {
 	struct jffs2_inodirty *wbuf_inodes;
 	struct rw_semaphore wbuf_sem;	/* Protects the write buffer */
 
+	/* Write buffer flush statistics, protected by alloc_sem */
+	uint32_t wbuf_flushes;		/* Pages written from the wbuf */
+	uint32_t wbuf_pad_flushes;	/* ... of which were padded */
+	uint64_t wbuf_pad_bytes;	/* Flash space wasted on padding */
+	uint32_t fsync_coalesced;	/* fsyncs satisfied by another's flush */
+	atomic_t fsync_waiters;		/* Tasks currently in jffs2_fsync() */
+	pid_t last_fsync_pid;		/* Last task to batch an fsync */
+
 	unsigned char *oobbuf;
 	int oobavail; /* How many bytes are available for JFFS2 in OOB */
 #endif
@@ -431,6 +431,43 @@ struct jffs2_inode_cache *jffs2_get_ino_cache(struct jffs2_sb_info *c, uint32_t
 	return ret;
 }
 
+/* Ask for CRC checking of inode @ino ahead of the rest. The queue only
+   holds hints, so if it's full we just drop them. Called with the
+   inocache_lock held. */
+void jffs2_queue_check(struct jffs2_sb_info *c, uint32_t ino)
+{
+	struct jffs2_inode_cache *ic;
+
+	if (c->check_queue_len == JFFS2_CHECK_QUEUE_LEN)
+		return;
+
+	ic = jffs2_get_ino_cache(c, ino);
+	if (!ic || ic->state != INO_STATE_UNCHECKED)
+		return;
+
+	c->check_queue[(c->check_queue_head + c->check_queue_len) %
+		       JFFS2_CHECK_QUEUE_LEN] = ino;
+	c->check_queue_len++;
+}
+
+/* Get the next queued inode which still needs CRC checking, or NULL.
+   Called with the inocache_lock held. */
+struct jffs2_inode_cache *jffs2_next_queued_check(struct jffs2_sb_info *c)
+{
+	struct jffs2_inode_cache *ic;
+
+	while (c->check_queue_len) {
+		ic = jffs2_get_ino_cache(c, c->check_queue[c->check_queue_head]);
+		c->check_queue_head = (c->check_queue_head + 1) %
+				      JFFS2_CHECK_QUEUE_LEN;
+		c->check_queue_len--;
+
+		if (ic && ic->pino_nlink && ic->state == INO_STATE_UNCHECKED)
+			return ic;
+	}
+	return NULL;
+}
+
 void jffs2_add_ino_cache (struct jffs2_sb_info *c, struct jffs2_inode_cache *new)
 {
 	struct jffs2_inode_cache **prev;
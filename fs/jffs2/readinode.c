@@ -1336,6 +1336,8 @@ static int jffs2_do_read_inode_internal(struct jffs2_sb_info *c,
 int jffs2_do_read_inode(struct jffs2_sb_info *c, struct jffs2_inode_info *f,
 			uint32_t ino, struct jffs2_raw_inode *latest_node)
 {
+	int ret;
+
 	dbg_readinode("read inode #%u\n", ino);
 
  retry_inocache:
@@ -1346,6 +1348,8 @@ int jffs2_do_read_inode(struct jffs2_sb_info *c, struct jffs2_inode_info *f,
 		/* Check its state. We may need to wait before we can use it */
 		switch(f->inocache->state) {
 		case INO_STATE_UNCHECKED:
+			c->checked_on_read++;
+			/* fall through */
 		case INO_STATE_CHECKEDABSENT:
 			f->inocache->state = INO_STATE_READING;
 			break;
@@ -1394,7 +1398,20 @@ int jffs2_do_read_inode(struct jffs2_sb_info *c, struct jffs2_inode_info *f,
 		return -ENOENT;
 	}
 
-	return jffs2_do_read_inode_internal(c, f, latest_node);
+	ret = jffs2_do_read_inode_internal(c, f, latest_node);
+
+	/* Files in a directory which is being read are likely to be
+	   opened soon, so have them CRC-checked before the others. */
+	if (!ret && f->dents && c->unchecked_size) {
+		struct jffs2_full_dirent *fd;
+
+		spin_lock(&c->inocache_lock);
+		for (fd = f->dents; fd; fd = fd->next)
+			if (fd->ino)
+				jffs2_queue_check(c, fd->ino);
+		spin_unlock(&c->inocache_lock);
+	}
+	return ret;
 }
 
 int jffs2_do_crccheck_inode(struct jffs2_sb_info *c, struct jffs2_inode_cache *ic)
@@ -206,6 +206,8 @@ static void jffs2_put_super (struct super_block *sb)
 	jffs2_flush_wbuf_pad(c);
 	mutex_unlock(&c->alloc_sem);
 
+	jffs2_wbuf_stats(c);
+
 	jffs2_sum_exit(c);
 
 	jffs2_free_ino_caches(c);
@@ -567,6 +567,10 @@ static void jffs2_wbuf_recover(struct jffs2_sb_info *c)
 #define PAD_NOACCOUNT	1
 #define PAD_ACCOUNTING	2
 
+/* Upper bound, in jiffies, on how long jffs2_fsync_wbuf() waits for
+   concurrent writers to fill the buffer before flushing it. */
+#define JFFS2_FSYNC_BATCH_MAX	4
+
 static int __jffs2_flush_wbuf(struct jffs2_sb_info *c, int pad)
 {
 	struct jffs2_eraseblock *wbuf_jeb;
@@ -669,9 +673,14 @@ static int __jffs2_flush_wbuf(struct jffs2_sb_info *c, int pad)
 		c->dirty_size -= waste;
 		wbuf_jeb->wasted_size += waste;
 		c->wasted_size += waste;
+
+		c->wbuf_pad_flushes++;
+		c->wbuf_pad_bytes += waste;
 	} else
 		spin_lock(&c->erase_completion_lock);
 
+	c->wbuf_flushes++;
+
 	/* Stick any now-obsoleted blocks on the erase_pending_list */
 	jffs2_refile_wbuf_blocks(c);
 	jffs2_clear_wbuf_ino_list(c);
@@ -748,6 +757,66 @@ int jffs2_flush_wbuf_gc(struct jffs2_sb_info *c, uint32_t ino)
 	return ret;
 }
 
+/* Flush the write-buffer on behalf of fsync() of the given inode.
+
+   A small synchronous write followed by fsync() usually leaves the
+   wbuf only partly full, and flushing it wastes the rest of the page
+   on padding. When several tasks are fsyncing at once, let a newcomer
+   wait a jiffy at a time while the others keep filling the same page,
+   so that one padded flush commits all of them (much like ext3 batches
+   synchronous transactions). A task that fsyncs repeatedly on its own
+   is never delayed. Whoever flushes first writes out everyone's data,
+   and the rest then find nothing pending for their inode. */
+int jffs2_fsync_wbuf(struct jffs2_sb_info *c, uint32_t ino)
+{
+	uint32_t old_wbuf_ofs, old_wbuf_len;
+	int pending, ret = 0, tries = 0;
+
+	if (!c->wbuf)
+		return 0;
+
+	mutex_lock(&c->alloc_sem);
+	pending = jffs2_wbuf_pending_for_ino(c, ino);
+	mutex_unlock(&c->alloc_sem);
+	if (!pending)
+		return 0;
+
+	if (atomic_inc_return(&c->fsync_waiters) > 1 &&
+	    c->last_fsync_pid != current->pid) {
+		c->last_fsync_pid = current->pid;
+		do {
+			old_wbuf_ofs = c->wbuf_ofs;
+			old_wbuf_len = c->wbuf_len;
+			schedule_timeout_uninterruptible(1);
+		} while (c->wbuf_ofs == old_wbuf_ofs &&
+			 c->wbuf_len != old_wbuf_len &&
+			 ++tries < JFFS2_FSYNC_BATCH_MAX);
+	}
+
+	mutex_lock(&c->alloc_sem);
+	pending = jffs2_wbuf_pending_for_ino(c, ino);
+	if (!pending)
+		c->fsync_coalesced++;
+	mutex_unlock(&c->alloc_sem);
+
+	if (pending)
+		ret = jffs2_flush_wbuf_gc(c, ino);
+
+	atomic_dec(&c->fsync_waiters);
+	return ret;
+}
+
+void jffs2_wbuf_stats(struct jffs2_sb_info *c)
+{
+	if (!c->wbuf)
+		return;
+
+	printk(KERN_DEBUG "jffs2: wbuf: %u pages written, %u padded, "
+	       "%llu bytes of padding; %u fsyncs coalesced\n",
+	       c->wbuf_flushes, c->wbuf_pad_flushes,
+	       (unsigned long long)c->wbuf_pad_bytes, c->fsync_coalesced);
+}
+
 /* Pad write-buffer to end and write it, wasting space. */
 int jffs2_flush_wbuf_pad(struct jffs2_sb_info *c)
 {
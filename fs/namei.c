@@ -420,11 +420,13 @@ static int nameidata_drop_rcu(struct nameidata *nd)
 	}
 	mntget(nd->path.mnt);
 
+	sb_walk_stats_inc(dentry->d_sb, ref);
 	rcu_read_unlock();
 	br_read_unlock(vfsmount_lock);
 	nd->flags &= ~LOOKUP_RCU;
 	return 0;
 err:
+	sb_walk_stats_inc(dentry->d_sb, ref);
 	spin_unlock(&dentry->d_lock);
 err_root:
 	if (nd->root.mnt)
@@ -482,11 +484,13 @@ static int nameidata_dentry_drop_rcu(struct nameidata *nd, struct dentry *dentry
 	}
 	mntget(nd->path.mnt);
 
+	sb_walk_stats_inc(dentry->d_sb, ref);
 	rcu_read_unlock();
 	br_read_unlock(vfsmount_lock);
 	nd->flags &= ~LOOKUP_RCU;
 	return 0;
 err:
+	sb_walk_stats_inc(dentry->d_sb, ref);
 	spin_unlock(&dentry->d_lock);
 	spin_unlock(&parent->d_lock);
 err_root:
@@ -527,12 +531,14 @@ static int nameidata_drop_rcu_last(struct nameidata *nd)
 
 	mntget(nd->path.mnt);
 
+	sb_walk_stats_inc(dentry->d_sb, rcu);
 	rcu_read_unlock();
 	br_read_unlock(vfsmount_lock);
 
 	return 0;
 
 err_unlock:
+	sb_walk_stats_inc(dentry->d_sb, ref);
 	spin_unlock(&dentry->d_lock);
 	rcu_read_unlock();
 	br_read_unlock(vfsmount_lock);
@@ -915,8 +915,11 @@ void nfs_force_lookup_revalidate(struct inode *dir)
  * In the case it has, we assume that the dentries are untrustworthy
  * and may need to be looked up again.
  */
-static int nfs_check_verifier(struct inode *dir, struct dentry *dentry)
+static int nfs_check_verifier(struct inode *dir, struct dentry *dentry,
+			      int rcu_walk)
 {
+	int ret;
+
 	if (IS_ROOT(dentry))
 		return 1;
 	if (NFS_SERVER(dir)->flags & NFS_MOUNT_LOOKUP_CACHE_NONE)
@@ -924,7 +927,11 @@ static int nfs_check_verifier(struct inode *dir, struct dentry *dentry)
 	if (!nfs_verify_change_attribute(dir, dentry->d_time))
 		return 0;
 	/* Revalidate nfsi->cache_change_attribute before we declare a match */
-	if (nfs_revalidate_inode(NFS_SERVER(dir), dir) < 0)
+	if (rcu_walk)
+		ret = nfs_revalidate_inode_rcu(NFS_SERVER(dir), dir);
+	else
+		ret = nfs_revalidate_inode(NFS_SERVER(dir), dir);
+	if (ret < 0)
 		return 0;
 	if (!nfs_verify_change_attribute(dir, dentry->d_time))
 		return 0;
@@ -986,6 +993,8 @@ int nfs_lookup_verify_inode(struct inode *inode, struct nameidata *nd)
 	}
 	return nfs_revalidate_inode(server, inode);
 out_force:
+	if (nd->flags & LOOKUP_RCU)
+		return -ECHILD;
 	return __nfs_revalidate_inode(server, inode);
 }
 
@@ -1005,7 +1014,7 @@ int nfs_neg_need_reval(struct inode *dir, struct dentry *dentry,
 		return 0;
 	if (NFS_SERVER(dir)->flags & NFS_MOUNT_LOOKUP_CACHE_NONEG)
 		return 1;
-	return !nfs_check_verifier(dir, dentry);
+	return !nfs_check_verifier(dir, dentry, nd && (nd->flags & LOOKUP_RCU));
 }
 
 /*
@@ -1026,13 +1035,22 @@ static int nfs_lookup_revalidate(struct dentry *dentry, struct nameidata *nd)
 	struct dentry *parent;
 	struct nfs_fh *fhandle = NULL;
 	struct nfs_fattr *fattr = NULL;
+	int rcu_walk = nd->flags & LOOKUP_RCU;
 	int error;
 
-	if (nd->flags & LOOKUP_RCU)
-		return -ECHILD;
-
-	parent = dget_parent(dentry);
-	dir = parent->d_inode;
+	/*
+	 * In rcu-walk mode only the cached state may be consulted: anything
+	 * that would need the wire, or would invalidate, returns -ECHILD.
+	 */
+	if (rcu_walk) {
+		parent = ACCESS_ONCE(dentry->d_parent);
+		dir = ACCESS_ONCE(parent->d_inode);
+		if (!dir)
+			return -ECHILD;
+	} else {
+		parent = dget_parent(dentry);
+		dir = parent->d_inode;
+	}
 	nfs_inc_stats(dir, NFSIOS_DENTRYREVALIDATE);
 	inode = dentry->d_inode;
 
@@ -1053,12 +1071,16 @@ static int nfs_lookup_revalidate(struct dentry *dentry, struct nameidata *nd)
 		goto out_set_verifier;
 
 	/* Force a full look up iff the parent directory has changed */
-	if (!nfs_is_exclusive_create(dir, nd) && nfs_check_verifier(dir, dentry)) {
+	if (!nfs_is_exclusive_create(dir, nd) &&
+	    nfs_check_verifier(dir, dentry, rcu_walk)) {
 		if (nfs_lookup_verify_inode(inode, nd))
 			goto out_zap_parent;
 		goto out_valid;
 	}
 
+	if (rcu_walk)
+		return -ECHILD;
+
 	if (NFS_STALE(inode))
 		goto out_bad;
 
@@ -1081,14 +1103,24 @@ static int nfs_lookup_revalidate(struct dentry *dentry, struct nameidata *nd)
 out_set_verifier:
 	nfs_set_verifier(dentry, nfs_save_change_attribute(dir));
  out_valid:
+	if (rcu_walk) {
+		/* a rename may have moved us while we looked */
+		if (parent != ACCESS_ONCE(dentry->d_parent))
+			return -ECHILD;
+		return 1;
+	}
 	dput(parent);
 	dfprintk(LOOKUPCACHE, "NFS: %s(%s/%s) is valid\n",
 			__func__, dentry->d_parent->d_name.name,
 			dentry->d_name.name);
 	return 1;
 out_zap_parent:
+	if (rcu_walk)
+		return -ECHILD;
 	nfs_zap_caches(dir);
  out_bad:
+	if (rcu_walk)
+		return -ECHILD;
 	nfs_mark_for_revalidate(dir);
 	if (inode && S_ISDIR(inode->i_mode)) {
 		/* Purge readdir caches. */
@@ -1413,13 +1445,14 @@ static int nfs_open_revalidate(struct dentry *dentry, struct nameidata *nd)
 	struct nfs_open_context *ctx;
 	int openflags, ret = 0;
 
-	if (nd->flags & LOOKUP_RCU)
-		return -ECHILD;
-
 	inode = dentry->d_inode;
 	if (!is_atomic_open(nd) || d_mountpoint(dentry))
 		goto no_open;
 
+	/* the open itself has to go over the wire */
+	if (nd->flags & LOOKUP_RCU)
+		return -ECHILD;
+
 	parent = dget_parent(dentry);
 	dir = parent->d_inode;
 
@@ -2088,6 +2121,44 @@ out_zap:
 	return -ENOENT;
 }
 
+/*
+ * rcu-walk variant of nfs_access_get_cached(): we can't look up (and
+ * possibly allocate) an rpc_cred here, so only the most recently used
+ * entry is tried, matching it against the caller's credentials.
+ */
+static int nfs_access_get_cached_rcu(struct inode *inode, struct nfs_access_entry *res)
+{
+	const struct cred *cred = current_cred();
+	struct auth_cred acred = {
+		.uid = cred->fsuid,
+		.gid = cred->fsgid,
+		.group_info = cred->group_info,
+	};
+	struct nfs_inode *nfsi = NFS_I(inode);
+	struct nfs_access_entry *cache;
+	int err = -ECHILD;
+
+	spin_lock(&inode->i_lock);
+	if (nfsi->cache_validity & NFS_INO_INVALID_ACCESS)
+		goto out;
+	if (list_empty(&nfsi->access_cache_entry_lru))
+		goto out;
+	cache = list_entry(nfsi->access_cache_entry_lru.prev,
+			   struct nfs_access_entry, lru);
+	if (!cache->cred->cr_ops->crmatch(&acred, cache->cred, 0))
+		goto out;
+	if (!nfs_have_delegated_attributes(inode) &&
+	    !time_in_range_open(jiffies, cache->jiffies, cache->jiffies + nfsi->attrtimeo))
+		goto out;
+	res->jiffies = cache->jiffies;
+	res->cred = cache->cred;
+	res->mask = cache->mask;
+	err = 0;
+out:
+	spin_unlock(&inode->i_lock);
+	return err;
+}
+
 static void nfs_access_add_rbtree(struct inode *inode, struct nfs_access_entry *set)
 {
 	struct nfs_inode *nfsi = NFS_I(inode);
@@ -2200,9 +2271,6 @@ int nfs_permission(struct inode *inode, int mask, unsigned int flags)
 	struct rpc_cred *cred;
 	int res = 0;
 
-	if (flags & IPERM_FLAG_RCU)
-		return -ECHILD;
-
 	nfs_inc_stats(inode, NFSIOS_VFSACCESS);
 
 	if ((mask & (MAY_READ | MAY_WRITE | MAY_EXEC)) == 0)
@@ -2234,6 +2302,16 @@ force_lookup:
 	if (!NFS_PROTO(inode)->access)
 		goto out_notsup;
 
+	if (flags & IPERM_FLAG_RCU) {
+		struct nfs_access_entry cache;
+
+		/* a denial is left for ref-walk to confirm */
+		res = nfs_access_get_cached_rcu(inode, &cache);
+		if (!res && (mask & ~cache.mask & (MAY_READ | MAY_WRITE | MAY_EXEC)))
+			res = -ECHILD;
+		goto out;
+	}
+
 	cred = rpc_lookup_cred();
 	if (!IS_ERR(cred)) {
 		res = nfs_do_access(inode, cred, mask);
@@ -2248,6 +2326,8 @@ out:
 		inode->i_sb->s_id, inode->i_ino, mask, res);
 	return res;
 out_notsup:
+	if (flags & IPERM_FLAG_RCU)
+		return -ECHILD;
 	res = nfs_revalidate_inode(NFS_SERVER(inode), inode);
 	if (res == 0)
 		res = generic_permission(inode, mask, flags, NULL);
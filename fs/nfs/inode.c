@@ -842,6 +842,23 @@ int nfs_revalidate_inode(struct nfs_server *server, struct inode *inode)
 	return __nfs_revalidate_inode(server, inode);
 }
 
+/**
+ * nfs_revalidate_inode_rcu - check the inode attributes without blocking
+ * @server - pointer to nfs_server struct
+ * @inode - pointer to inode struct
+ *
+ * rcu-walk variant of nfs_revalidate_inode(): succeeds if the attribute
+ * cache is still valid, and returns -ECHILD where an on-the-wire
+ * revalidation would be needed.
+ */
+int nfs_revalidate_inode_rcu(struct nfs_server *server, struct inode *inode)
+{
+	if (!(NFS_I(inode)->cache_validity & NFS_INO_INVALID_ATTR)
+			&& !nfs_attribute_cache_expired(inode))
+		return NFS_STALE(inode) ? -ESTALE : 0;
+	return -ECHILD;
+}
+
 static int nfs_invalidate_mapping(struct inode *inode, struct address_space *mapping)
 {
 	struct nfs_inode *nfsi = NFS_I(inode);
@@ -1485,6 +1502,7 @@ static void init_once(void *foo)
 	INIT_RADIX_TREE(&nfsi->nfs_page_tree, GFP_ATOMIC);
 	nfsi->npages = 0;
 	nfsi->ncommit = 0;
+	INIT_LIST_HEAD(&nfsi->write_list);
 	atomic_set(&nfsi->silly_count, 1);
 	INIT_HLIST_HEAD(&nfsi->silly_list);
 	init_waitqueue_head(&nfsi->waitqueue);
@@ -75,6 +75,7 @@ struct nfs_parsed_mount_data {
 	int			flags;
 	int			rsize, wsize;
 	int			timeo, retrans;
+	unsigned int		nconnect;
 	int			acregmin, acregmax,
 				acdirmin, acdirmax;
 	int			namlen;
@@ -225,6 +226,7 @@ extern struct workqueue_struct *nfsiod_workqueue;
 extern struct inode *nfs_alloc_inode(struct super_block *sb);
 extern void nfs_destroy_inode(struct inode *);
 extern int nfs_write_inode(struct inode *, struct writeback_control *);
+extern void nfs_commit_sb(struct super_block *sb);
 extern void nfs_evict_inode(struct inode *);
 #ifdef CONFIG_NFS_V4
 extern void nfs4_evict_inode(struct inode *);
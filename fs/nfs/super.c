@@ -90,7 +90,7 @@ enum {
 	/* Mount options that take integer arguments */
 	Opt_port,
 	Opt_rsize, Opt_wsize, Opt_bsize,
-	Opt_timeo, Opt_retrans,
+	Opt_timeo, Opt_retrans, Opt_nconnect,
 	Opt_acregmin, Opt_acregmax,
 	Opt_acdirmin, Opt_acdirmax,
 	Opt_actimeo,
@@ -155,6 +155,7 @@ static const match_table_t nfs_mount_option_tokens = {
 	{ Opt_bsize, "bsize=%s" },
 	{ Opt_timeo, "timeo=%s" },
 	{ Opt_retrans, "retrans=%s" },
+	{ Opt_nconnect, "nconnect=%s" },
 	{ Opt_acregmin, "acregmin=%s" },
 	{ Opt_acregmax, "acregmax=%s" },
 	{ Opt_acdirmin, "acdirmin=%s" },
@@ -261,6 +262,7 @@ static match_table_t nfs_local_lock_tokens = {
 
 
 static void nfs_umount_begin(struct super_block *);
+static int  nfs_sync_fs(struct super_block *, int);
 static int  nfs_statfs(struct dentry *, struct kstatfs *);
 static int  nfs_show_options(struct seq_file *, struct vfsmount *);
 static int  nfs_show_stats(struct seq_file *, struct vfsmount *);
@@ -291,6 +293,7 @@ static const struct super_operations nfs_sops = {
 	.alloc_inode	= nfs_alloc_inode,
 	.destroy_inode	= nfs_destroy_inode,
 	.write_inode	= nfs_write_inode,
+	.sync_fs	= nfs_sync_fs,
 	.put_super	= nfs_put_super,
 	.statfs		= nfs_statfs,
 	.evict_inode	= nfs_evict_inode,
@@ -361,6 +364,7 @@ static const struct super_operations nfs4_sops = {
 	.alloc_inode	= nfs_alloc_inode,
 	.destroy_inode	= nfs_destroy_inode,
 	.write_inode	= nfs_write_inode,
+	.sync_fs	= nfs_sync_fs,
 	.put_super	= nfs_put_super,
 	.statfs		= nfs_statfs,
 	.evict_inode	= nfs4_evict_inode,
@@ -437,6 +441,18 @@ void nfs_sb_deactive(struct super_block *sb)
 		deactivate_super(sb);
 }
 
+/*
+ * The non-blocking pass of sync(2) has sent out the dirty pages; start
+ * the COMMITs for all of them now, before the blocking pass waits on
+ * them one inode at a time.
+ */
+static int nfs_sync_fs(struct super_block *sb, int wait)
+{
+	if (!wait)
+		nfs_commit_sb(sb);
+	return 0;
+}
+
 /*
  * Deliver file system statistics to userspace
  */
@@ -680,6 +696,8 @@ static void nfs_show_mount_options(struct seq_file *m, struct nfs_server *nfss,
 
 	seq_printf(m, ",timeo=%lu", 10U * nfss->client->cl_timeout->to_initval / HZ);
 	seq_printf(m, ",retrans=%u", nfss->client->cl_timeout->to_retries);
+	if (nfss->client->cl_nxprts > 1)
+		seq_printf(m, ",nconnect=%u", nfss->client->cl_nxprts);
 	seq_printf(m, ",sec=%s", nfs_pseudoflavour_to_name(nfss->client->cl_auth->au_flavor));
 
 	if (version != 4)
@@ -1186,6 +1204,16 @@ static int nfs_parse_mount_options(char *raw,
 				goto out_invalid_value;
 			mnt->retrans = option;
 			break;
+		case Opt_nconnect:
+			string = match_strdup(args);
+			if (string == NULL)
+				goto out_nomem;
+			rc = strict_strtoul(string, 10, &option);
+			kfree(string);
+			if (rc != 0 || option == 0 || option > RPC_MAX_XPRTS)
+				goto out_invalid_value;
+			mnt->nconnect = option;
+			break;
 		case Opt_acregmin:
 			string = match_strdup(args);
 			if (string == NULL)
@@ -2016,6 +2044,7 @@ nfs_compare_remount_data(struct nfs_server *nfss,
 	    data->rsize != nfss->rsize ||
 	    data->wsize != nfss->wsize ||
 	    data->retrans != nfss->client->cl_timeout->to_retries ||
+	    data->nconnect != nfss->client->cl_nxprts ||
 	    data->auth_flavors[0] != nfss->client->cl_auth->au_flavor ||
 	    data->acregmin != nfss->acregmin / HZ ||
 	    data->acregmax != nfss->acregmax / HZ ||
@@ -2061,6 +2090,7 @@ nfs_remount(struct super_block *sb, int *flags, char *raw_data)
 	data->rsize = nfss->rsize;
 	data->wsize = nfss->wsize;
 	data->retrans = nfss->client->cl_timeout->to_retries;
+	data->nconnect = nfss->client->cl_nxprts;
 	data->auth_flavors[0] = nfss->client->cl_auth->au_flavor;
 	data->acregmin = nfss->acregmin / HZ;
 	data->acregmax = nfss->acregmax / HZ;
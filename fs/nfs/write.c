@@ -334,6 +334,49 @@ static int nfs_writepages_callback(struct page *page, struct writeback_control *
 	return ret;
 }
 
+/*
+ * Background writeback of a file that is still being appended to tends
+ * to find a final WRITE that is shorter than wsize.  Put such a tail
+ * back on the dirty list for up to NFS_WRITE_GATHER_DELAY, so that a
+ * later pass can send it as part of a full size RPC.  Integrity,
+ * kupdate and reclaim writeback always send everything.
+ */
+#define NFS_WRITE_GATHER_DELAY	(HZ / 20)
+
+static void nfs_pageio_gather_tail(struct nfs_pageio_descriptor *pgio,
+				   struct writeback_control *wbc)
+{
+	struct inode *inode = pgio->pg_inode;
+	struct nfs_inode *nfsi = NFS_I(inode);
+	struct nfs_page *req;
+
+	if (!wbc->for_background || list_empty(&pgio->pg_list) ||
+	    pgio->pg_bsize < PAGE_CACHE_SIZE ||
+	    pgio->pg_count >= pgio->pg_bsize)
+		goto out_flush;
+	req = nfs_list_entry(pgio->pg_list.prev);
+	if (req_offset(req) + req->wb_bytes < i_size_read(inode))
+		goto out_flush;
+	if (!test_and_set_bit(NFS_INO_GATHER, &nfsi->flags))
+		nfsi->write_gather_start = jiffies;
+	else if (time_after(jiffies, nfsi->write_gather_start +
+					NFS_WRITE_GATHER_DELAY))
+		goto out_flush;
+
+	nfs_inc_stats(inode, NFSIOS_WRITEGATHER);
+	while (!list_empty(&pgio->pg_list)) {
+		req = nfs_list_entry(pgio->pg_list.next);
+		nfs_list_remove_request(req);
+		nfs_redirty_request(req);
+		wbc->pages_skipped++;
+	}
+	pgio->pg_count = 0;
+	pgio->pg_base = 0;
+	return;
+out_flush:
+	clear_bit(NFS_INO_GATHER, &nfsi->flags);
+}
+
 int nfs_writepages(struct address_space *mapping, struct writeback_control *wbc)
 {
 	struct inode *inode = mapping->host;
@@ -351,6 +394,8 @@ int nfs_writepages(struct address_space *mapping, struct writeback_control *wbc)
 
 	nfs_pageio_init_write(&pgio, inode, wb_priority(wbc));
 	err = write_cache_pages(mapping, wbc, nfs_writepages_callback, &pgio);
+	if (err == 0)
+		nfs_pageio_gather_tail(&pgio, wbc);
 	nfs_pageio_complete(&pgio);
 
 	clear_bit_unlock(NFS_INO_FLUSHING, bitlock);
@@ -386,9 +431,14 @@ static int nfs_inode_add_request(struct inode *inode, struct nfs_page *req)
 	error = radix_tree_insert(&nfsi->nfs_page_tree, req->wb_index, req);
 	BUG_ON(error);
 	if (!nfsi->npages) {
+		struct nfs_server *server = NFS_SERVER(inode);
+
 		igrab(inode);
 		if (nfs_have_delegation(inode, FMODE_WRITE))
 			nfsi->change_attr++;
+		spin_lock(&server->write_lock);
+		list_add_tail(&nfsi->write_list, &server->write_inodes);
+		spin_unlock(&server->write_lock);
 	}
 	set_bit(PG_MAPPED, &req->wb_flags);
 	SetPagePrivate(req->wb_page);
@@ -420,6 +470,11 @@ static void nfs_inode_remove_request(struct nfs_page *req)
 	radix_tree_delete(&nfsi->nfs_page_tree, req->wb_index);
 	nfsi->npages--;
 	if (!nfsi->npages) {
+		struct nfs_server *server = NFS_SERVER(inode);
+
+		spin_lock(&server->write_lock);
+		list_del_init(&nfsi->write_list);
+		spin_unlock(&server->write_lock);
 		spin_unlock(&inode->i_lock);
 		iput(inode);
 	} else
@@ -1433,6 +1488,39 @@ out_mark_dirty:
 	return res;
 }
 
+/*
+ * Send a COMMIT for every inode of @sb that has unstable writes, without
+ * waiting for the replies.  sync(2) calls this between its non-blocking
+ * and its blocking pass, so the blocking pass finds the commits already
+ * in flight: the waits overlap rather than costing one round trip per
+ * inode.  COMMIT itself is per file handle, so the RPCs can't be merged.
+ */
+void nfs_commit_sb(struct super_block *sb)
+{
+	struct nfs_server *server = NFS_SB(sb);
+	struct nfs_inode *nfsi;
+	struct inode *inode;
+	LIST_HEAD(batch);
+
+	spin_lock(&server->write_lock);
+	list_splice_init(&server->write_inodes, &batch);
+	while (!list_empty(&batch)) {
+		nfsi = list_first_entry(&batch, struct nfs_inode, write_list);
+		list_move_tail(&nfsi->write_list, &server->write_inodes);
+		if (!nfs_need_commit(nfsi))
+			continue;
+		inode = igrab(&nfsi->vfs_inode);
+		if (!inode)
+			continue;
+		spin_unlock(&server->write_lock);
+		if (nfs_commit_inode(inode, 0) > 0)
+			nfs_inc_server_stats(server, NFSIOS_COMMITBATCH);
+		iput(inode);
+		spin_lock(&server->write_lock);
+	}
+	spin_unlock(&server->write_lock);
+}
+
 static int nfs_commit_unstable_pages(struct inode *inode, struct writeback_control *wbc)
 {
 	struct nfs_inode *nfsi = NFS_I(inode);
@@ -1465,6 +1553,10 @@ out_mark_dirty:
 	return ret;
 }
 #else
+void nfs_commit_sb(struct super_block *sb)
+{
+}
+
 static int nfs_commit_unstable_pages(struct inode *inode, struct writeback_control *wbc)
 {
 	return 0;
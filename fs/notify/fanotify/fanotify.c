@@ -32,19 +32,37 @@ static bool should_merge(struct fsnotify_event *old, struct fsnotify_event *new)
 
 /* and the list better be locked by something too! */
 static struct fsnotify_event *fanotify_merge(struct list_head *list,
-					     struct fsnotify_event *event)
+					     struct fsnotify_event *event,
+					     struct fsnotify_event_private_data *priv)
 {
+	struct fsnotify_group *group = container_of(list, struct fsnotify_group,
+						    notification_list);
 	struct fsnotify_event_holder *test_holder;
 	struct fsnotify_event *test_event = NULL;
 	struct fsnotify_event *new_event;
 
 	pr_debug("%s: list=%p event=%p\n", __func__, list, event);
 
-
-	list_for_each_entry_reverse(test_holder, list, event_list) {
-		if (should_merge(test_holder->event, event)) {
-			test_event = test_holder->event;
-			break;
+	/*
+	 * only events about the same inode can merge, so when the queue is
+	 * hashed there is no need to look at more than its bucket.
+	 */
+	test_holder = fsnotify_find_queued_event(group, event);
+	if (test_holder) {
+		struct hlist_node *pos = &test_holder->hash_node;
+
+		hlist_for_each_entry_from(test_holder, pos, hash_node) {
+			if (should_merge(test_holder->event, event)) {
+				test_event = test_holder->event;
+				break;
+			}
+		}
+	} else if (!group->notification_hash || !event->to_tell) {
+		list_for_each_entry_reverse(test_holder, list, event_list) {
+			if (should_merge(test_holder->event, event)) {
+				test_event = test_holder->event;
+				break;
+			}
 		}
 	}
 
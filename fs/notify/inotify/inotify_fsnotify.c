@@ -68,11 +68,49 @@ static bool event_compare(struct fsnotify_event *old, struct fsnotify_event *new
 	return false;
 }
 
+/*
+ * Only plain events may be merged with an older event further up the queue.
+ * Moves are paired by cookie and the order of the pair matters, and nothing
+ * can be reported about an inode after its IN_IGNORED or IN_UNMOUNT.
+ */
+static bool event_may_merge_queued(struct fsnotify_event *event)
+{
+	return !event->sync_cookie &&
+	       !(event->mask & (FS_MOVED_FROM | FS_MOVED_TO | FS_UNMOUNT |
+				FS_IN_IGNORED | FS_Q_OVERFLOW));
+}
+
+/* the watch descriptor a queued event will be reported with */
+static int inotify_event_wd(struct fsnotify_group *group,
+			    struct fsnotify_event *event)
+{
+	struct fsnotify_event_private_data *fsn_priv;
+	struct inotify_event_private_data *priv;
+	int wd = -1;
+
+	spin_lock(&event->lock);
+	list_for_each_entry(fsn_priv, &event->private_data_list, event_list) {
+		if (fsn_priv->group == group) {
+			priv = container_of(fsn_priv, struct inotify_event_private_data,
+					    fsnotify_event_priv_data);
+			wd = priv->wd;
+			break;
+		}
+	}
+	spin_unlock(&event->lock);
+
+	return wd;
+}
+
 static struct fsnotify_event *inotify_merge(struct list_head *list,
-					    struct fsnotify_event *event)
+					    struct fsnotify_event *event,
+					    struct fsnotify_event_private_data *fsn_priv)
 {
+	struct fsnotify_group *group = container_of(list, struct fsnotify_group,
+						    notification_list);
 	struct fsnotify_event_holder *last_holder;
 	struct fsnotify_event *last_event;
+	struct inotify_event_private_data *priv;
 
 	/* and the list better be locked by something too */
 	spin_lock(&event->lock);
@@ -86,6 +124,27 @@ static struct fsnotify_event *inotify_merge(struct list_head *list,
 
 	spin_unlock(&event->lock);
 
+	if (last_event || !fsn_priv || !event_may_merge_queued(event))
+		return last_event;
+
+	/*
+	 * Not the same as the tail of the queue, but userspace gains nothing
+	 * from a second copy of an event which is still waiting to be read.
+	 * The inode may have been freed and reused since the queued event was
+	 * generated, so it must also carry the same watch descriptor.
+	 */
+	last_holder = fsnotify_find_queued_event(group, event);
+	if (!last_holder)
+		return NULL;
+
+	last_event = last_holder->event;
+	priv = container_of(fsn_priv, struct inotify_event_private_data,
+			    fsnotify_event_priv_data);
+	if (!event_compare(last_event, event) ||
+	    inotify_event_wd(group, last_event) != priv->wd)
+		return NULL;
+
+	fsnotify_get_event(last_event);
 	return last_event;
 }
 
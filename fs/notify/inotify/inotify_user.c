@@ -130,10 +130,23 @@ static unsigned int inotify_poll(struct file *file, poll_table *wait)
  *
  * Called with the group->notification_mutex held.
  */
+/* how many events inotify_read() takes off the queue under one lock hold */
+#define INOTIFY_READ_BATCH	16
+
+/* the size of the inotify_event and padded name we send to userspace */
+static size_t inotify_event_size(struct fsnotify_event *event)
+{
+	size_t event_size = sizeof(struct inotify_event);
+
+	if (event->name_len)
+		event_size += roundup(event->name_len + 1, event_size);
+
+	return event_size;
+}
+
 static struct fsnotify_event *get_one_event(struct fsnotify_group *group,
 					    size_t count)
 {
-	size_t event_size = sizeof(struct inotify_event);
 	struct fsnotify_event *event;
 
 	if (fsnotify_notify_queue_is_empty(group))
@@ -143,10 +156,7 @@ static struct fsnotify_event *get_one_event(struct fsnotify_group *group,
 
 	pr_debug("%s: group=%p event=%p\n", __func__, group, event);
 
-	if (event->name_len)
-		event_size += roundup(event->name_len + 1, event_size);
-
-	if (event_size > count)
+	if (inotify_event_size(event) > count)
 		return ERR_PTR(-EINVAL);
 
 	/* held the notification_mutex the whole time, so this is the
@@ -227,13 +237,29 @@ static ssize_t copy_event_to_user(struct fsnotify_group *group,
 	return event_size;
 }
 
+/* an event we took off the queue but could not put back, free our data on it */
+static void drop_event(struct fsnotify_group *group,
+		       struct fsnotify_event *event)
+{
+	struct fsnotify_event_private_data *fsn_priv;
+
+	spin_lock(&event->lock);
+	fsn_priv = fsnotify_remove_priv_from_event(group, event);
+	spin_unlock(&event->lock);
+
+	if (fsn_priv)
+		inotify_free_event_priv(fsn_priv);
+}
+
 static ssize_t inotify_read(struct file *file, char __user *buf,
 			    size_t count, loff_t *pos)
 {
 	struct fsnotify_group *group;
+	struct fsnotify_event *kevents[INOTIFY_READ_BATCH];
 	struct fsnotify_event *kevent;
 	char __user *start;
-	int ret;
+	size_t room;
+	int i, nr, ret;
 	DEFINE_WAIT(wait);
 
 	start = buf;
@@ -242,24 +268,53 @@ static ssize_t inotify_read(struct file *file, char __user *buf,
 	while (1) {
 		prepare_to_wait(&group->notification_waitq, &wait, TASK_INTERRUPTIBLE);
 
+		/*
+		 * take as many events as fit in the buffer off the queue at
+		 * once, the copies to userspace may fault and must be done
+		 * without the notification_mutex.
+		 */
+		nr = 0;
+		room = count;
 		mutex_lock(&group->notification_mutex);
-		kevent = get_one_event(group, count);
+		do {
+			kevent = get_one_event(group, room);
+			if (!kevent || IS_ERR(kevent))
+				break;
+			room -= inotify_event_size(kevent);
+			kevents[nr++] = kevent;
+		} while (nr < INOTIFY_READ_BATCH);
 		mutex_unlock(&group->notification_mutex);
 
-		pr_debug("%s: group=%p kevent=%p\n", __func__, group, kevent);
+		pr_debug("%s: group=%p nr=%d kevent=%p\n", __func__, group, nr,
+			 kevent);
 
-		if (kevent) {
-			ret = PTR_ERR(kevent);
-			if (IS_ERR(kevent))
-				break;
-			ret = copy_event_to_user(group, kevent, buf);
-			fsnotify_put_event(kevent);
+		ret = 0;
+		for (i = 0; i < nr; i++) {
+			ret = copy_event_to_user(group, kevents[i], buf);
+			fsnotify_put_event(kevents[i]);
 			if (ret < 0)
 				break;
 			buf += ret;
 			count -= ret;
-			continue;
 		}
+		if (ret < 0) {
+			/* put back the events after the one which faulted */
+			mutex_lock(&group->notification_mutex);
+			while (--nr > i) {
+				if (fsnotify_requeue_notify_event(group, kevents[nr]))
+					drop_event(group, kevents[nr]);
+				fsnotify_put_event(kevents[nr]);
+			}
+			mutex_unlock(&group->notification_mutex);
+			wake_up(&group->notification_waitq);
+			break;
+		}
+		if (IS_ERR(kevent)) {
+			ret = PTR_ERR(kevent);
+			break;
+		}
+		if (nr)
+			continue;
 
 		ret = -EAGAIN;
 		if (file->f_flags & O_NONBLOCK)
@@ -716,6 +771,11 @@ static struct fsnotify_group *inotify_new_group(unsigned int max_events)
 		return ERR_PTR(-EMFILE);
 	}
 
+	if (fsnotify_alloc_notify_hash(group)) {
+		fsnotify_put_group(group);
+		return ERR_PTR(-ENOMEM);
+	}
+
 	return group;
 }
 
@@ -32,6 +32,7 @@
  */
 
 #include <linux/fs.h>
+#include <linux/hash.h>
 #include <linux/init.h>
 #include <linux/kernel.h>
 #include <linux/list.h>
@@ -59,6 +60,14 @@ static struct kmem_cache *fsnotify_event_holder_cachep;
 static struct fsnotify_event *q_overflow_event;
 static atomic_t fsnotify_sync_cookie = ATOMIC_INIT(0);
 
+/*
+ * Groups which merge new events into ones already on their queue can keep
+ * the queued events hashed by inode and file name, so that finding the
+ * newest queued event about an object does not mean walking the whole queue.
+ */
+#define FSNOTIFY_HASH_BITS	7
+#define FSNOTIFY_HASH_SIZE	(1 << FSNOTIFY_HASH_BITS)
+
 /**
  * fsnotify_get_cookie - return a unique cookie for use in synchronizing events.
  * Called from fsnotify_move, which is inlined into filesystem modules.
@@ -102,7 +111,12 @@ void fsnotify_put_event(struct fsnotify_event *event)
 
 struct fsnotify_event_holder *fsnotify_alloc_event_holder(void)
 {
-	return kmem_cache_alloc(fsnotify_event_holder_cachep, GFP_KERNEL);
+	struct fsnotify_event_holder *holder;
+
+	holder = kmem_cache_alloc(fsnotify_event_holder_cachep, GFP_KERNEL);
+	if (holder)
+		INIT_HLIST_NODE(&holder->hash_node);
+	return holder;
 }
 
 void fsnotify_destroy_event_holder(struct fsnotify_event_holder *holder)
@@ -132,6 +146,73 @@ struct fsnotify_event_private_data *fsnotify_remove_priv_from_event(struct fsnot
 	return priv;
 }
 
+int fsnotify_alloc_notify_hash(struct fsnotify_group *group)
+{
+	struct hlist_head *hash;
+	int i;
+
+	hash = kmalloc(FSNOTIFY_HASH_SIZE * sizeof(*hash), GFP_KERNEL);
+	if (!hash)
+		return -ENOMEM;
+
+	for (i = 0; i < FSNOTIFY_HASH_SIZE; i++)
+		INIT_HLIST_HEAD(&hash[i]);
+	group->notification_hash = hash;
+
+	return 0;
+}
+
+/*
+ * Events which aren't about an inode (the overflow event and inotify's
+ * IN_IGNORED) are never hashed.
+ */
+static struct hlist_head *fsnotify_event_bucket(struct fsnotify_group *group,
+						struct fsnotify_event *event)
+{
+	unsigned long hash;
+
+	if (!group->notification_hash || !event->to_tell)
+		return NULL;
+
+	hash = hash_ptr(event->to_tell, FSNOTIFY_HASH_BITS);
+	if (event->name_len)
+		hash ^= full_name_hash(event->file_name, event->name_len);
+
+	return &group->notification_hash[hash & (FSNOTIFY_HASH_SIZE - 1)];
+}
+
+/*
+ * Return the holder of the newest event on the group's queue which was sent
+ * to the same inode with the same file name as event, or NULL if there is no
+ * such event or the group doesn't hash its queue.  Must be called with the
+ * group->notification_mutex held.
+ */
+struct fsnotify_event_holder *fsnotify_find_queued_event(struct fsnotify_group *group,
+							 struct fsnotify_event *event)
+{
+	struct fsnotify_event_holder *holder;
+	struct hlist_head *bucket;
+	struct hlist_node *pos;
+
+	BUG_ON(!mutex_is_locked(&group->notification_mutex));
+
+	bucket = fsnotify_event_bucket(group, event);
+	if (!bucket)
+		return NULL;
+
+	/* new events are added at the head, so the first match is the newest */
+	hlist_for_each_entry(holder, pos, bucket, hash_node) {
+		struct fsnotify_event *old = holder->event;
+
+		if (old->to_tell != event->to_tell ||
+		    old->name_len != event->name_len)
+			continue;
+		if (!old->name_len || !strcmp(old->file_name, event->file_name))
+			return holder;
+	}
+	return NULL;
+}
+
 /*
  * Add an event to the group notification queue.  The group can later pull this
  * event off the queue to deal with.  If the event is successfully added to the
@@ -140,11 +221,13 @@ struct fsnotify_event_private_data *fsnotify_remove_priv_from_event(struct fsnot
 struct fsnotify_event *fsnotify_add_notify_event(struct fsnotify_group *group, struct fsnotify_event *event,
 						 struct fsnotify_event_private_data *priv,
 						 struct fsnotify_event *(*merge)(struct list_head *,
-										 struct fsnotify_event *))
+										 struct fsnotify_event *,
+										 struct fsnotify_event_private_data *))
 {
 	struct fsnotify_event *return_event = NULL;
 	struct fsnotify_event_holder *holder = NULL;
 	struct list_head *list = &group->notification_list;
+	struct hlist_head *bucket;
 
 	pr_debug("%s: group=%p event=%p priv=%p\n", __func__, group, event, priv);
 
@@ -182,7 +265,7 @@ alloc_holder:
 	if (!list_empty(list) && merge) {
 		struct fsnotify_event *tmp;
 
-		tmp = merge(list, event);
+		tmp = merge(list, event, priv);
 		if (tmp) {
 			mutex_unlock(&group->notification_mutex);
 
@@ -219,6 +302,9 @@ alloc_holder:
 
 	fsnotify_get_event(event);
 	list_add_tail(&holder->event_list, list);
+	bucket = fsnotify_event_bucket(group, event);
+	if (bucket)
+		hlist_add_head(&holder->hash_node, bucket);
 	if (priv)
 		list_add_tail(&priv->event_list, &event->private_data_list);
 	spin_unlock(&event->lock);
@@ -249,6 +335,8 @@ struct fsnotify_event *fsnotify_remove_notify_event(struct fsnotify_group *group
 	spin_lock(&event->lock);
 	holder->event = NULL;
 	list_del_init(&holder->event_list);
+	if (!hlist_unhashed(&holder->hash_node))
+		hlist_del_init(&holder->hash_node);
 	spin_unlock(&event->lock);
 
 	/* event == holder means we are referenced through the in event holder */
@@ -260,6 +348,61 @@ struct fsnotify_event *fsnotify_remove_notify_event(struct fsnotify_group *group
 	return event;
 }
 
+/*
+ * Put an event taken off the queue with fsnotify_remove_notify_event() back at
+ * the head of the queue, e.g. because it could not be delivered.  The group's
+ * private data must still be attached to the event.  Like adding, this takes a
+ * reference on the event.  Must be called with the group->notification_mutex
+ * held; to put back several events, requeue the newest first.
+ */
+int fsnotify_requeue_notify_event(struct fsnotify_group *group,
+				  struct fsnotify_event *event)
+{
+	struct fsnotify_event_holder *holder, *spare;
+	struct hlist_head *bucket;
+	struct hlist_node *last;
+
+	BUG_ON(!mutex_is_locked(&group->notification_mutex));
+
+	/*
+	 * The in event holder may have been taken by another group since we
+	 * dequeued the event, and we can't allocate under event->lock.
+	 */
+	spare = fsnotify_alloc_event_holder();
+
+	spin_lock(&event->lock);
+	if (list_empty(&event->holder.event_list)) {
+		holder = &event->holder;
+	} else if (spare) {
+		holder = spare;
+		spare = NULL;
+	} else {
+		spin_unlock(&event->lock);
+		return -ENOMEM;
+	}
+
+	group->q_len++;
+	holder->event = event;
+
+	fsnotify_get_event(event);
+	list_add(&holder->event_list, &group->notification_list);
+	bucket = fsnotify_event_bucket(group, event);
+	if (bucket) {
+		/* older than anything queued, so it goes last in its bucket */
+		if (hlist_empty(bucket)) {
+			hlist_add_head(&holder->hash_node, bucket);
+		} else {
+			for (last = bucket->first; last->next; last = last->next)
+				;
+			hlist_add_after(last, &holder->hash_node);
+		}
+	}
+	spin_unlock(&event->lock);
+
+	fsnotify_destroy_event_holder(spare);
+	return 0;
+}
+
 /*
  * This will not remove the event, that must be done with fsnotify_remove_notify_event()
  */
@@ -304,6 +447,7 @@ void fsnotify_flush_notify(struct fsnotify_group *group)
 static void initialize_event(struct fsnotify_event *event)
 {
 	INIT_LIST_HEAD(&event->holder.event_list);
+	INIT_HLIST_NODE(&event->holder.hash_node);
 	atomic_set(&event->refcnt, 1);
 
 	spin_lock_init(&event->lock);
@@ -340,6 +484,11 @@ int fsnotify_replace_event(struct fsnotify_event_holder *old_holder,
 
 	new_holder->event = new_event;
 	list_replace_init(&old_holder->event_list, &new_holder->event_list);
+	/* new_event is a copy of old_event, so it belongs in the same bucket */
+	if (!hlist_unhashed(&old_holder->hash_node)) {
+		hlist_add_before(&new_holder->hash_node, &old_holder->hash_node);
+		hlist_del_init(&old_holder->hash_node);
+	}
 
 	spin_unlock(&new_event->lock);
 	spin_unlock(&old_event->lock);
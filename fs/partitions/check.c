@@ -293,6 +293,28 @@ ssize_t part_inflight_show(struct device *dev,
 	return sprintf(buf, "%8u %8u\n", p->in_flight[0], p->in_flight[1]);
 }
 
+ssize_t part_latency_hist_show(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	static const char * const names[DISK_LAT_NR] = {
+		[DISK_LAT_READ]		= "read",
+		[DISK_LAT_WRITE]	= "write",
+		[DISK_LAT_DISCARD]	= "discard",
+	};
+	struct hd_struct *p = dev_to_part(dev);
+	ssize_t len = 0;
+	int dir, i;
+
+	for (dir = 0; dir < DISK_LAT_NR; dir++) {
+		len += sprintf(buf + len, "%s", names[dir]);
+		for (i = 0; i < DISK_LAT_BUCKETS; i++)
+			len += sprintf(buf + len, " %lu",
+				       part_stat_read(p, lat_hist[dir][i]));
+		len += sprintf(buf + len, "\n");
+	}
+	return len;
+}
+
 #ifdef CONFIG_FAIL_MAKE_REQUEST
 ssize_t part_fail_show(struct device *dev,
 		       struct device_attribute *attr, char *buf)
@@ -325,6 +347,7 @@ static DEVICE_ATTR(discard_alignment, S_IRUGO, part_discard_alignment_show,
 		   NULL);
 static DEVICE_ATTR(stat, S_IRUGO, part_stat_show, NULL);
 static DEVICE_ATTR(inflight, S_IRUGO, part_inflight_show, NULL);
+static DEVICE_ATTR(latency_hist, S_IRUGO, part_latency_hist_show, NULL);
 #ifdef CONFIG_FAIL_MAKE_REQUEST
 static struct device_attribute dev_attr_fail =
 	__ATTR(make-it-fail, S_IRUGO|S_IWUSR, part_fail_show, part_fail_store);
@@ -339,6 +362,7 @@ static struct attribute *part_attrs[] = {
 	&dev_attr_discard_alignment.attr,
 	&dev_attr_stat.attr,
 	&dev_attr_inflight.attr,
+	&dev_attr_latency_hist.attr,
 #ifdef CONFIG_FAIL_MAKE_REQUEST
 	&dev_attr_fail.attr,
 #endif
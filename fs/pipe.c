@@ -35,6 +35,15 @@ unsigned int pipe_max_size = 1048576;
  */
 unsigned int pipe_min_size = PAGE_SIZE;
 
+/*
+ * A writer that has to wait for room this many times while the reader
+ * never ran dry is limited by the pipe size rather than by the reader:
+ * the ring is doubled then, up to pipe_max_size.
+ */
+#define PIPE_GROW_WAITS		4
+
+static long pipe_set_size(struct pipe_inode_info *pipe, unsigned long nr_pages);
+
 /*
  * We use a start+len construction, which provides full use of the 
  * allocated memory.
@@ -201,16 +210,74 @@ static void anon_pipe_buf_release(struct pipe_inode_info *pipe,
 	struct page *page = buf->page;
 
 	/*
-	 * If nobody else uses this page, and we don't already have a
-	 * temporary page, let's keep track of it as a one-deep
-	 * allocation cache. (Otherwise just release our reference to it)
+	 * If nobody else uses this page, and the pool isn't full yet, keep
+	 * it for the next write. (Otherwise just release our reference to it)
 	 */
-	if (page_count(page) == 1 && !pipe->tmp_page)
-		pipe->tmp_page = page;
+	if (page_count(page) == 1 && pipe->nr_pool < pipe->pool_target)
+		pipe->pool[pipe->nr_pool++] = page;
 	else
 		page_cache_release(page);
 }
 
+static struct page *pipe_pool_get(struct pipe_inode_info *pipe)
+{
+	if (pipe->nr_pool)
+		return pipe->pool[--pipe->nr_pool];
+
+	return alloc_page(GFP_HIGHUSER);
+}
+
+static void pipe_pool_put(struct pipe_inode_info *pipe, struct page *page)
+{
+	if (pipe->nr_pool < PIPE_POOL_MAX)
+		pipe->pool[pipe->nr_pool++] = page;
+	else
+		__free_page(page);
+}
+
+/*
+ * The writer found the pipe empty, so the reader has caught up with
+ * everything written so far. Fold the peak number of buffers in flight
+ * since the last time into the pool size, and trim the pool to it.
+ */
+static void pipe_pool_resize(struct pipe_inode_info *pipe)
+{
+	unsigned int target;
+
+	target = (pipe->pool_target + pipe->pool_peak + 1) / 2;
+	target = clamp_t(unsigned int, target, 1, PIPE_POOL_MAX);
+
+	pipe->pool_target = target;
+	pipe->pool_peak = 0;
+	while (pipe->nr_pool > target)
+		__free_page(pipe->pool[--pipe->nr_pool]);
+}
+
+/**
+ * pipe_writer_blocked - note that a writer waits for room in the pipe
+ * @pipe:	the pipe, locked
+ *
+ * Description:
+ *	Called by writers right before they sleep on a full pipe. After
+ *	%PIPE_GROW_WAITS such sleeps with no reader running dry in between,
+ *	the number of buffers is doubled, unless it was set explicitly with
+ *	F_SETPIPE_SZ or would exceed pipe_max_size.
+ */
+void pipe_writer_blocked(struct pipe_inode_info *pipe)
+{
+	unsigned long nr_pages;
+
+	if (pipe->sized || ++pipe->full_waits < PIPE_GROW_WAITS)
+		return;
+
+	pipe->full_waits = 0;
+	nr_pages = pipe->buffers * 2;
+	if (nr_pages > (pipe_max_size >> PAGE_SHIFT))
+		return;
+
+	pipe_set_size(pipe, nr_pages);
+}
+
 /**
  * generic_pipe_buf_map - virtually map a pipe buffer
  * @pipe:	the pipe that the buffer belongs to
@@ -444,6 +511,8 @@ redo:
 			wake_up_interruptible_sync_poll(&pipe->wait, POLLOUT | POLLWRNORM);
  			kill_fasync(&pipe->fasync_writers, SIGIO, POLL_OUT);
 		}
+		/* we are faster than the writers, the pipe is big enough */
+		pipe->full_waits = 0;
 		pipe_wait(pipe);
 	}
 	mutex_unlock(&inode->i_mutex);
@@ -540,17 +609,17 @@ redo1:
 		if (bufs < pipe->buffers) {
 			int newbuf = (pipe->curbuf + bufs) & (pipe->buffers-1);
 			struct pipe_buffer *buf = pipe->bufs + newbuf;
-			struct page *page = pipe->tmp_page;
+			struct page *page;
 			char *src;
 			int error, atomic = 1;
 
-			if (!page) {
-				page = alloc_page(GFP_HIGHUSER);
-				if (unlikely(!page)) {
-					ret = ret ? : -ENOMEM;
-					break;
-				}
-				pipe->tmp_page = page;
+			if (!bufs && pipe->pool_peak)
+				pipe_pool_resize(pipe);
+
+			page = pipe_pool_get(pipe);
+			if (unlikely(!page)) {
+				ret = ret ? : -ENOMEM;
+				break;
 			}
 			/* Always wake up, even if the copy fails. Otherwise
 			 * we lock up (O_NONBLOCK-)readers that sleep due to
@@ -581,6 +650,7 @@ redo2:
 					atomic = 0;
 					goto redo2;
 				}
+				pipe_pool_put(pipe, page);
 				if (!ret)
 					ret = error;
 				break;
@@ -593,7 +663,8 @@ redo2:
 			buf->offset = 0;
 			buf->len = chars;
 			pipe->nrbufs = ++bufs;
-			pipe->tmp_page = NULL;
+			if (bufs > pipe->pool_peak)
+				pipe->pool_peak = bufs;
 
 			total_len -= chars;
 			if (!total_len)
@@ -616,6 +687,7 @@ redo2:
 			kill_fasync(&pipe->fasync_readers, SIGIO, POLL_IN);
 			do_wakeup = 0;
 		}
+		pipe_writer_blocked(pipe);
 		pipe->waiting_writers++;
 		pipe_wait(pipe);
 		pipe->waiting_writers--;
@@ -902,6 +974,7 @@ struct pipe_inode_info * alloc_pipe_info(struct inode *inode)
 			pipe->r_counter = pipe->w_counter = 1;
 			pipe->inode = inode;
 			pipe->buffers = PIPE_DEF_BUFFERS;
+			pipe->pool_target = 1;
 			return pipe;
 		}
 		kfree(pipe);
@@ -919,8 +992,8 @@ void __free_pipe_info(struct pipe_inode_info *pipe)
 		if (buf->ops)
 			buf->ops->release(pipe, buf);
 	}
-	if (pipe->tmp_page)
-		__free_page(pipe->tmp_page);
+	while (pipe->nr_pool)
+		__free_page(pipe->pool[--pipe->nr_pool]);
 	kfree(pipe->bufs);
 	kfree(pipe);
 }
@@ -1237,6 +1310,8 @@ long pipe_fcntl(struct file *file, unsigned int cmd, unsigned long arg)
 			goto out;
 		}
 		ret = pipe_set_size(pipe, nr_pages);
+		if (ret > 0)
+			pipe->sized = true;
 		break;
 		}
 	case F_GETPIPE_SZ:
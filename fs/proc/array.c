@@ -327,6 +327,13 @@ static inline void task_context_switch_counts(struct seq_file *m,
 			p->nivcsw);
 }
 
+#ifndef arch_task_status
+static inline void arch_task_status(struct seq_file *m,
+				    struct task_struct *task)
+{
+}
+#endif
+
 static void task_cpus_allowed(struct seq_file *m, struct task_struct *task)
 {
 	seq_puts(m, "Cpus_allowed:\t");
@@ -354,6 +361,7 @@ int proc_pid_status(struct seq_file *m, struct pid_namespace *ns,
 	task_cpus_allowed(m, task);
 	cpuset_task_status_allowed(m, task);
 	task_context_switch_counts(m, task);
+	arch_task_status(m, task);
 	return 0;
 }
 
@@ -277,6 +277,24 @@ out:
 	return res;
 }
 
+#ifdef CONFIG_KSM
+static int proc_pid_ksm_stat(struct task_struct *task, char *buffer)
+{
+	struct mm_struct *mm = get_task_mm(task);
+	int res = 0;
+
+	if (mm) {
+		res = sprintf(buffer, "pages_scanned %lu\n"
+				      "pages_merged %lu\n"
+				      "pages_skipped %lu\n",
+			      mm->ksm_pages_scanned, mm->ksm_pages_merged,
+			      mm->ksm_pages_skipped);
+		mmput(mm);
+	}
+	return res;
+}
+#endif
+
 static int proc_pid_auxv(struct task_struct *task, char *buffer)
 {
 	int res = 0;
@@ -2797,6 +2815,7 @@ static const struct pid_entry tgid_base_stuff[] = {
 #ifdef CONFIG_PROC_PAGE_MONITOR
 	REG("clear_refs", S_IWUSR, proc_clear_refs_operations),
 	REG("smaps",      S_IRUGO, proc_smaps_operations),
+	REG("smaps_rollup", S_IRUGO, proc_smaps_rollup_operations),
 	REG("pagemap",    S_IRUSR, proc_pagemap_operations),
 #endif
 #ifdef CONFIG_SECURITY
@@ -2821,6 +2840,9 @@ static const struct pid_entry tgid_base_stuff[] = {
 	REG("cgroup",  S_IRUGO, proc_cgroup_operations),
 #endif
 	INF("oom_score",  S_IRUGO, proc_oom_score),
+#ifdef CONFIG_KSM
+	INF("ksm_stat",   S_IRUGO, proc_pid_ksm_stat),
+#endif
 	REG("oom_adj",    S_IRUGO|S_IWUSR, proc_oom_adjust_operations),
 	REG("oom_score_adj", S_IRUGO|S_IWUSR, proc_oom_score_adj_operations),
 #ifdef CONFIG_AUDITSYSCALL
@@ -3138,6 +3160,7 @@ static const struct pid_entry tid_base_stuff[] = {
 #ifdef CONFIG_PROC_PAGE_MONITOR
 	REG("clear_refs", S_IWUSR, proc_clear_refs_operations),
 	REG("smaps",     S_IRUGO, proc_smaps_operations),
+	REG("smaps_rollup", S_IRUGO, proc_smaps_rollup_operations),
 	REG("pagemap",    S_IRUSR, proc_pagemap_operations),
 #endif
 #ifdef CONFIG_SECURITY
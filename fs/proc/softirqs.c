@@ -4,7 +4,9 @@
 #include <linux/seq_file.h>
 
 /*
- * /proc/softirqs  ... display the number of softirqs
+ * /proc/softirqs  ... display the number of softirqs, the time spent
+ * in them (in microseconds) and how often a vector ran over its time
+ * budget and was deferred to ksoftirqd
  */
 static int show_softirqs(struct seq_file *p, void *v)
 {
@@ -21,6 +23,22 @@ static int show_softirqs(struct seq_file *p, void *v)
 			seq_printf(p, " %10u", kstat_softirqs_cpu(i, j));
 		seq_putc(p, '\n');
 	}
+
+	for (i = 0; i < NR_SOFTIRQS; i++) {
+		seq_printf(p, "%9s_us:", softirq_to_name[i]);
+		for_each_possible_cpu(j) {
+			u64 us = kstat_softirq_time_cpu(i, j);
+
+			do_div(us, NSEC_PER_USEC);
+			seq_printf(p, " %10llu", (unsigned long long)us);
+		}
+		seq_putc(p, '\n');
+	}
+
+	seq_printf(p, "%12s:", "DEFERRED");
+	for_each_possible_cpu(j)
+		seq_printf(p, " %10u", kstat_cpu(j).softirqs_deferred);
+	seq_putc(p, '\n');
 	return 0;
 }
 
@@ -109,7 +109,7 @@ static void *m_start(struct seq_file *m, loff_t *pos)
 
 	/*
 	 * We remember last_addr rather than next_addr to hit with
-	 * mmap_cache most of the time. We have zero last_addr at
+	 * vmacache most of the time. We have zero last_addr at
 	 * the beginning and also after lseek. We will have -1 last_addr
 	 * after the end of the vmas.
 	 */
@@ -333,6 +333,7 @@ struct mem_size_stats {
 	unsigned long anonymous;
 	unsigned long swap;
 	u64 pss;
+	u64 pss_locked;
 };
 
 static int smaps_pte_range(pmd_t *pmd, unsigned long addr, unsigned long end,
@@ -388,28 +389,30 @@ static int smaps_pte_range(pmd_t *pmd, unsigned long addr, unsigned long end,
 	return 0;
 }
 
-static int show_smap(struct seq_file *m, void *v)
+/*
+ * Add the page usage of one vma to @mss, which may already hold the totals
+ * of other vmas. The caller must hold mmap_sem.
+ */
+static void smap_gather_stats(struct vm_area_struct *vma,
+			      struct mem_size_stats *mss)
 {
-	struct proc_maps_private *priv = m->private;
-	struct task_struct *task = priv->task;
-	struct vm_area_struct *vma = v;
-	struct mem_size_stats mss;
 	struct mm_walk smaps_walk = {
 		.pmd_entry = smaps_pte_range,
 		.mm = vma->vm_mm,
-		.private = &mss,
+		.private = mss,
 	};
+	u64 pss = mss->pss;
 
-	memset(&mss, 0, sizeof mss);
-	mss.vma = vma;
-	/* mmap_sem is held in m_start */
+	mss->vma = vma;
 	if (vma->vm_mm && !is_vm_hugetlb_page(vma))
 		walk_page_range(vma->vm_start, vma->vm_end, &smaps_walk);
+	if (vma->vm_flags & VM_LOCKED)
+		mss->pss_locked += mss->pss - pss;
+}
 
-	show_map_vma(m, vma);
-
+static void show_smap_usage(struct seq_file *m, struct mem_size_stats *mss)
+{
 	seq_printf(m,
-		   "Size:           %8lu kB\n"
 		   "Rss:            %8lu kB\n"
 		   "Pss:            %8lu kB\n"
 		   "Shared_Clean:   %8lu kB\n"
@@ -418,24 +421,41 @@ static int show_smap(struct seq_file *m, void *v)
 		   "Private_Dirty:  %8lu kB\n"
 		   "Referenced:     %8lu kB\n"
 		   "Anonymous:      %8lu kB\n"
-		   "Swap:           %8lu kB\n"
+		   "Swap:           %8lu kB\n",
+		   mss->resident >> 10,
+		   (unsigned long)(mss->pss >> (10 + PSS_SHIFT)),
+		   mss->shared_clean  >> 10,
+		   mss->shared_dirty  >> 10,
+		   mss->private_clean >> 10,
+		   mss->private_dirty >> 10,
+		   mss->referenced >> 10,
+		   mss->anonymous >> 10,
+		   mss->swap >> 10);
+}
+
+static int show_smap(struct seq_file *m, void *v)
+{
+	struct proc_maps_private *priv = m->private;
+	struct task_struct *task = priv->task;
+	struct vm_area_struct *vma = v;
+	struct mem_size_stats mss;
+
+	memset(&mss, 0, sizeof mss);
+	/* mmap_sem is held in m_start */
+	smap_gather_stats(vma, &mss);
+
+	show_map_vma(m, vma);
+
+	seq_printf(m, "Size:           %8lu kB\n",
+		   (vma->vm_end - vma->vm_start) >> 10);
+	show_smap_usage(m, &mss);
+	seq_printf(m,
 		   "KernelPageSize: %8lu kB\n"
 		   "MMUPageSize:    %8lu kB\n"
 		   "Locked:         %8lu kB\n",
-		   (vma->vm_end - vma->vm_start) >> 10,
-		   mss.resident >> 10,
-		   (unsigned long)(mss.pss >> (10 + PSS_SHIFT)),
-		   mss.shared_clean  >> 10,
-		   mss.shared_dirty  >> 10,
-		   mss.private_clean >> 10,
-		   mss.private_dirty >> 10,
-		   mss.referenced >> 10,
-		   mss.anonymous >> 10,
-		   mss.swap >> 10,
 		   vma_kernel_pagesize(vma) >> 10,
 		   vma_mmu_pagesize(vma) >> 10,
-		   (vma->vm_flags & VM_LOCKED) ?
-			(unsigned long)(mss.pss >> (10 + PSS_SHIFT)) : 0);
+		   (unsigned long)(mss.pss_locked >> (10 + PSS_SHIFT)));
 
 	if (m->count < m->size)  /* vma is copied successfully */
 		m->version = (vma != get_gate_vma(task)) ? vma->vm_start : 0;
@@ -461,6 +481,64 @@ const struct file_operations proc_smaps_operations = {
 	.release	= seq_release_private,
 };
 
+/*
+ * smaps_rollup: one walk over all vmas of the process, printing only the
+ * summed smaps fields. This is much cheaper than reading smaps and adding
+ * up the values in user space.
+ */
+static int show_smaps_rollup(struct seq_file *m, void *v)
+{
+	struct pid *pid = m->private;
+	struct task_struct *task;
+	struct mm_struct *mm;
+	struct vm_area_struct *vma;
+	struct mem_size_stats mss;
+	unsigned long start = 0, end = 0;
+	int len;
+
+	task = get_pid_task(pid, PIDTYPE_PID);
+	if (!task)
+		return -ESRCH;
+
+	mm = mm_for_maps(task);
+	put_task_struct(task);
+	if (!mm)
+		return 0;
+
+	memset(&mss, 0, sizeof mss);
+	down_read(&mm->mmap_sem);
+	if (mm->mmap)
+		start = mm->mmap->vm_start;
+	for (vma = mm->mmap; vma; vma = vma->vm_next) {
+		smap_gather_stats(vma, &mss);
+		end = vma->vm_end;
+	}
+	up_read(&mm->mmap_sem);
+	mmput(mm);
+
+	seq_printf(m, "%08lx-%08lx ---p %08lx %02x:%02x %lu %n",
+		   start, end, 0UL, 0, 0, 0UL, &len);
+	pad_len_spaces(m, len);
+	seq_puts(m, "[rollup]\n");
+
+	show_smap_usage(m, &mss);
+	seq_printf(m, "Locked:         %8lu kB\n",
+		   (unsigned long)(mss.pss_locked >> (10 + PSS_SHIFT)));
+	return 0;
+}
+
+static int smaps_rollup_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, show_smaps_rollup, proc_pid(inode));
+}
+
+const struct file_operations proc_smaps_rollup_operations = {
+	.open		= smaps_rollup_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int clear_refs_pte_range(pmd_t *pmd, unsigned long addr,
 				unsigned long end, struct mm_walk *walk)
 {
@@ -26,6 +26,7 @@
 #include <linux/fs.h>
 #include <linux/rcupdate.h>
 #include <linux/hrtimer.h>
+#include <linux/vmalloc.h>
 
 #include <asm/uaccess.h>
 
@@ -824,6 +825,445 @@ static int do_poll(unsigned int nfds,  struct poll_list *list,
 	return count;
 }
 
+/*
+ * Persistent poll sets.
+ *
+ * A task that enabled PR_SET_POLL_CACHE keeps the wait queue registrations
+ * of its last poll() between calls.  When the next call passes the same
+ * descriptors and events, and each descriptor still refers to the same
+ * file, only the entries whose wait queues fired since are polled again,
+ * so a large and mostly idle set costs O(ready) ->poll calls instead of
+ * O(nfds) calls plus as many wait queue insertions and removals.  Any
+ * change in the set simply rebuilds the cache.
+ *
+ * File references are only held for the duration of a poll() call, so
+ * closing a descriptor between calls releases the file as usual.  Each
+ * entry is linked on its file's f_poll_cache_links, and __fput() calls
+ * poll_cache_release_file() to take the wait queue registrations off the
+ * file and mark the poll set dead, to be rebuilt by the next poll().
+ * poll_cache_files_lock protects those links, the registrations of
+ * linked entries and poll_cache->dead.
+ */
+static DEFINE_SPINLOCK(poll_cache_files_lock);
+
+struct poll_cache_entry {
+	struct file *file;
+	struct poll_cache *pc;
+	struct list_head flink;		/* on file->f_poll_cache_links */
+	int fd;
+	short events;
+	short revents;
+	struct list_head ready;		/* on poll_cache->ready_list */
+	struct list_head waits;		/* poll_cache_wait registrations */
+};
+
+struct poll_cache_wait {
+	struct list_head list;
+	struct poll_cache *pc;
+	struct poll_cache_entry *entry;
+	wait_queue_head_t *wait_address;
+	unsigned long key;
+	wait_queue_t wait;
+};
+
+struct poll_cache {
+	spinlock_t lock;		/* protects ready_list */
+	struct list_head ready_list;
+	wait_queue_head_t wq;
+	unsigned int nfds;
+	int dead;			/* a file in the set was released */
+	struct poll_cache_entry entries[0];
+};
+
+struct poll_cache_table {
+	poll_table pt;
+	struct poll_cache *pc;
+	struct poll_cache_entry *entry;
+	int error;
+};
+
+static int poll_cache_wake(wait_queue_t *wait, unsigned mode, int sync,
+			   void *key)
+{
+	struct poll_cache_wait *pw = container_of(wait, struct poll_cache_wait,
+						  wait);
+	struct poll_cache *pc = pw->pc;
+	unsigned long flags;
+
+	if (key && !((unsigned long)key & pw->key))
+		return 0;
+
+	spin_lock_irqsave(&pc->lock, flags);
+	if (list_empty(&pw->entry->ready))
+		list_add_tail(&pw->entry->ready, &pc->ready_list);
+	spin_unlock_irqrestore(&pc->lock, flags);
+
+	wake_up(&pc->wq);
+	return 0;
+}
+
+static void poll_cache_queue_proc(struct file *filp,
+				  wait_queue_head_t *wait_address,
+				  poll_table *p)
+{
+	struct poll_cache_table *pct = container_of(p, struct poll_cache_table,
+						    pt);
+	struct poll_cache_wait *pw;
+
+	pw = kmalloc(sizeof(*pw), GFP_KERNEL);
+	if (!pw) {
+		pct->error = -ENOMEM;
+		return;
+	}
+	pw->pc = pct->pc;
+	pw->entry = pct->entry;
+	pw->wait_address = wait_address;
+	pw->key = p->key;
+	init_waitqueue_func_entry(&pw->wait, poll_cache_wake);
+	list_add_tail(&pw->list, &pct->entry->waits);
+	add_wait_queue(wait_address, &pw->wait);
+}
+
+static size_t poll_cache_size(unsigned int nfds)
+{
+	return sizeof(struct poll_cache) +
+		nfds * sizeof(struct poll_cache_entry);
+}
+
+/* Called with poll_cache_files_lock held, or before @e is linked */
+static void poll_cache_unregister(struct poll_cache_entry *e)
+{
+	struct poll_cache_wait *pw, *tmp;
+
+	list_for_each_entry_safe(pw, tmp, &e->waits, list) {
+		remove_wait_queue(pw->wait_address, &pw->wait);
+		list_del(&pw->list);
+		kfree(pw);
+	}
+}
+
+static void poll_cache_free(struct poll_cache *pc)
+{
+	unsigned int i;
+
+	spin_lock(&poll_cache_files_lock);
+	for (i = 0; i < pc->nfds; i++) {
+		struct poll_cache_entry *e = &pc->entries[i];
+
+		list_del(&e->flink);
+		poll_cache_unregister(e);
+	}
+	spin_unlock(&poll_cache_files_lock);
+
+	if (poll_cache_size(pc->nfds) > PAGE_SIZE)
+		vfree(pc);
+	else
+		kfree(pc);
+}
+
+/* Drop the references taken for the current poll() call */
+static void poll_cache_put_files(struct poll_cache *pc)
+{
+	unsigned int i;
+
+	for (i = 0; i < pc->nfds; i++)
+		if (pc->entries[i].file)
+			fput(pc->entries[i].file);
+}
+
+/**
+ * poll_cache_release_file - detach a file from all persistent poll sets
+ * @file:	the file being released
+ *
+ * Called from __fput() through poll_cache_file_release().  Removes the
+ * wait queue registrations on @file and marks the poll sets that used it
+ * dead, so that their owners rebuild them on the next poll().
+ */
+void poll_cache_release_file(struct file *file)
+{
+	struct poll_cache_entry *e, *tmp;
+
+	spin_lock(&poll_cache_files_lock);
+	list_for_each_entry_safe(e, tmp, &file->f_poll_cache_links, flink) {
+		list_del_init(&e->flink);
+		poll_cache_unregister(e);
+		e->file = NULL;
+		e->pc->dead = 1;
+	}
+	spin_unlock(&poll_cache_files_lock);
+}
+
+/**
+ * poll_cache_release - drop a task's persistent poll set
+ * @tsk:	the task, which must be current
+ *
+ * Removes all wait queue registrations held by the poll set of @tsk, if
+ * it has one.
+ */
+void poll_cache_release(struct task_struct *tsk)
+{
+	struct poll_cache *pc = tsk->poll_cache;
+
+	if (pc) {
+		tsk->poll_cache = NULL;
+		poll_cache_free(pc);
+	}
+}
+
+/*
+ * Is @pc still valid for the pollfd array in @list?  The descriptors and
+ * events must be identical, every descriptor must still refer to the
+ * file the cache registered on and none of those files may have been
+ * released since.  On success a reference is held on each file until
+ * poll_cache_put_files().
+ */
+static bool poll_cache_get_files(struct poll_cache *pc, unsigned int nfds,
+				 struct poll_list *list)
+{
+	struct files_struct *files = current->files;
+	struct poll_cache_entry *e = pc->entries;
+	struct poll_list *walk;
+	unsigned int got = 0;
+	bool valid = true;
+	int dead;
+
+	if (pc->nfds != nfds)
+		return false;
+
+	rcu_read_lock();
+	for (walk = list; walk != NULL && valid; walk = walk->next) {
+		struct pollfd *pfd = walk->entries;
+		struct pollfd *pfd_end = pfd + walk->len;
+
+		for (; pfd != pfd_end; pfd++, e++, got++) {
+			if (e->fd != pfd->fd || e->events != pfd->events ||
+			    (pfd->fd >= 0 && fcheck_files(files, pfd->fd) !=
+			     e->file) ||
+			    (e->file &&
+			     !atomic_long_inc_not_zero(&e->file->f_count))) {
+				valid = false;
+				break;
+			}
+		}
+	}
+	rcu_read_unlock();
+
+	/*
+	 * The file may have been released and its memory reused for a new
+	 * file on the same descriptor, so also check that no release hit
+	 * the set.
+	 */
+	spin_lock(&poll_cache_files_lock);
+	dead = pc->dead;
+	spin_unlock(&poll_cache_files_lock);
+
+	if (valid && !dead)
+		return true;
+
+	for (e = pc->entries; got--; e++)
+		if (e->file)
+			fput(e->file);
+	return false;
+}
+
+/*
+ * Build a poll set for @list, registering on every file's wait queues
+ * and queueing the entries that are ready right away.  As with
+ * poll_cache_get_files(), the file references are held on return.
+ */
+static struct poll_cache *poll_cache_build(unsigned int nfds,
+					   struct poll_list *list)
+{
+	struct poll_cache_table pct;
+	struct poll_cache *pc;
+	struct poll_list *walk;
+	size_t size = poll_cache_size(nfds);
+	unsigned int i = 0;
+
+	if (size > PAGE_SIZE)
+		pc = vmalloc(size);
+	else
+		pc = kmalloc(size, GFP_KERNEL);
+	if (!pc)
+		return NULL;
+
+	spin_lock_init(&pc->lock);
+	INIT_LIST_HEAD(&pc->ready_list);
+	init_waitqueue_head(&pc->wq);
+	pc->nfds = 0;
+	pc->dead = 0;
+
+	init_poll_funcptr(&pct.pt, poll_cache_queue_proc);
+	pct.pc = pc;
+	pct.error = 0;
+
+	for (walk = list; walk != NULL; walk = walk->next) {
+		int j;
+
+		for (j = 0; j < walk->len; j++, i++) {
+			struct pollfd *pfd = &walk->entries[j];
+			struct poll_cache_entry *e = &pc->entries[i];
+			unsigned int mask = 0;
+
+			e->fd = pfd->fd;
+			e->events = pfd->events;
+			e->file = NULL;
+			e->pc = pc;
+			INIT_LIST_HEAD(&e->flink);
+			INIT_LIST_HEAD(&e->ready);
+			INIT_LIST_HEAD(&e->waits);
+			pc->nfds++;
+
+			if (e->fd >= 0) {
+				e->file = fget(e->fd);
+				mask = POLLNVAL;
+			}
+			if (e->file) {
+				mask = DEFAULT_POLLMASK;
+				if (e->file->f_op && e->file->f_op->poll) {
+					pct.entry = e;
+					pct.pt.key = e->events |
+							POLLERR | POLLHUP;
+					mask = e->file->f_op->poll(e->file,
+								   &pct.pt);
+				}
+				mask &= e->events | POLLERR | POLLHUP;
+
+				spin_lock(&poll_cache_files_lock);
+				list_add(&e->flink,
+					 &e->file->f_poll_cache_links);
+				spin_unlock(&poll_cache_files_lock);
+			}
+			e->revents = mask;
+			if (pct.error) {
+				poll_cache_put_files(pc);
+				poll_cache_free(pc);
+				return NULL;
+			}
+			if (mask) {
+				spin_lock_irq(&pc->lock);
+				if (list_empty(&e->ready))
+					list_add_tail(&e->ready,
+						      &pc->ready_list);
+				spin_unlock_irq(&pc->lock);
+			}
+		}
+	}
+
+	return pc;
+}
+
+/*
+ * Poll the entries queued on the ready list.  Entries that are still
+ * ready are requeued, so the next call reports them again.
+ */
+static int poll_cache_scan(struct poll_cache *pc)
+{
+	LIST_HEAD(txlist);
+	int count = 0;
+
+	spin_lock_irq(&pc->lock);
+	list_splice_init(&pc->ready_list, &txlist);
+	spin_unlock_irq(&pc->lock);
+
+	while (!list_empty(&txlist)) {
+		struct poll_cache_entry *e;
+		unsigned int mask = POLLNVAL;
+
+		e = list_first_entry(&txlist, struct poll_cache_entry, ready);
+		spin_lock_irq(&pc->lock);
+		list_del_init(&e->ready);
+		spin_unlock_irq(&pc->lock);
+
+		if (e->file) {
+			mask = DEFAULT_POLLMASK;
+			if (e->file->f_op && e->file->f_op->poll)
+				mask = e->file->f_op->poll(e->file, NULL);
+			mask &= e->events | POLLERR | POLLHUP;
+		}
+		e->revents = mask;
+		if (mask) {
+			count++;
+			spin_lock_irq(&pc->lock);
+			if (list_empty(&e->ready))
+				list_add_tail(&e->ready, &pc->ready_list);
+			spin_unlock_irq(&pc->lock);
+		}
+	}
+
+	return count;
+}
+
+/*
+ * do_poll() on the current task's persistent poll set.  Returns false if
+ * no poll set could be built, in which case the caller falls back to a
+ * plain do_poll().
+ */
+static bool do_poll_cached(unsigned int nfds, struct poll_list *list,
+			   struct timespec *end_time, int *countp)
+{
+	struct poll_cache *pc = current->poll_cache;
+	struct poll_cache_entry *e;
+	struct poll_list *walk;
+	ktime_t expire, *to = NULL;
+	int timed_out = 0, count;
+	unsigned long slack = 0;
+	DEFINE_WAIT(wait);
+
+	if (pc && !poll_cache_get_files(pc, nfds, list)) {
+		poll_cache_release(current);
+		pc = NULL;
+	}
+	if (!pc) {
+		pc = poll_cache_build(nfds, list);
+		if (!pc)
+			return false;
+		current->poll_cache = pc;
+	}
+
+	if (end_time && !end_time->tv_sec && !end_time->tv_nsec)
+		timed_out = 1;
+
+	if (end_time && !timed_out)
+		slack = select_estimate_accuracy(end_time);
+
+	for (;;) {
+		bool idle;
+
+		count = poll_cache_scan(pc);
+		if (!count && signal_pending(current))
+			count = -EINTR;
+		if (count || timed_out)
+			break;
+
+		if (end_time && !to) {
+			expire = timespec_to_ktime(*end_time);
+			to = &expire;
+		}
+
+		prepare_to_wait(&pc->wq, &wait, TASK_INTERRUPTIBLE);
+		spin_lock_irq(&pc->lock);
+		idle = list_empty(&pc->ready_list);
+		spin_unlock_irq(&pc->lock);
+		if (idle && !schedule_hrtimeout_range(to, slack,
+						      HRTIMER_MODE_ABS))
+			timed_out = 1;
+		finish_wait(&pc->wq, &wait);
+	}
+
+	e = pc->entries;
+	for (walk = list; walk != NULL; walk = walk->next) {
+		int j;
+
+		for (j = 0; j < walk->len; j++, e++)
+			walk->entries[j].revents = e->revents;
+	}
+	poll_cache_put_files(pc);
+
+	*countp = count;
+	return true;
+}
+
 #define N_STACK_PPS ((sizeof(stack_pps) - sizeof(struct poll_list))  / \
 			sizeof(struct pollfd))
 
@@ -867,9 +1307,12 @@ int do_sys_poll(struct pollfd __user *ufds, unsigned int nfds,
 		}
 	}
 
-	poll_initwait(&table);
-	fdcount = do_poll(nfds, head, &table, end_time);
-	poll_freewait(&table);
+	if (!current->poll_cache_enabled ||
+	    !do_poll_cached(nfds, head, end_time, &fdcount)) {
+		poll_initwait(&table);
+		fdcount = do_poll(nfds, head, &table, end_time);
+		poll_freewait(&table);
+	}
 
 	for (walk = head; walk; walk = walk->next) {
 		struct pollfd *fds = walk->entries;
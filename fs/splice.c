@@ -25,6 +25,7 @@
 #include <linux/mm_inline.h>
 #include <linux/swap.h>
 #include <linux/writeback.h>
+#include <linux/backing-dev.h>
 #include <linux/buffer_head.h>
 #include <linux/module.h>
 #include <linux/syscalls.h>
@@ -240,6 +241,7 @@ ssize_t splice_to_pipe(struct pipe_inode_info *pipe,
 			do_wakeup = 0;
 		}
 
+		pipe_writer_blocked(pipe);
 		pipe->waiting_writers++;
 		pipe_wait(pipe);
 		pipe->waiting_writers--;
@@ -712,6 +714,66 @@ static int pipe_to_sendpage(struct pipe_inode_info *pipe,
  * SPLICE_F_MOVE isn't set, or we cannot move the page, we simply create
  * a new page in the output file page cache and fill/dirty that.
  */
+static int pipe_to_file_steal(struct pipe_inode_info *pipe,
+			      struct pipe_buffer *buf,
+			      struct address_space *mapping, pgoff_t index)
+{
+	struct page *page = buf->page;
+
+	/*
+	 * tmpfs pages carry swap-backed state and accounting that a
+	 * foreign page does not have; always copy into those.
+	 */
+	if (mapping_cap_swap_backed(mapping))
+		return 1;
+
+	if (buf->offset || buf->len != PAGE_CACHE_SIZE)
+		return 1;
+
+	/* returns with the page locked on success */
+	if (buf->ops->steal(pipe, buf))
+		return 1;
+
+	if (add_to_page_cache_locked(page, mapping, index, GFP_KERNEL)) {
+		unlock_page(page);
+		return 1;
+	}
+
+	/*
+	 * The page may have come from another file's page cache: drop the
+	 * state that described its old home, and publish it as uptodate
+	 * before unlocking so a racing reader cannot ->readpage() over the
+	 * data we are about to write.
+	 */
+	ClearPageMappedToDisk(page);
+	ClearPageError(page);
+	SetPageUptodate(page);
+	if (!(buf->flags & PIPE_BUF_FLAG_LRU)) {
+		lru_cache_add_file(page);
+		buf->flags |= PIPE_BUF_FLAG_LRU;
+	}
+	unlock_page(page);
+	return 0;
+}
+
+/*
+ * ->write_begin() failed after the page was moved in: take it out of the
+ * page cache again so no data without backing blocks stays visible. The
+ * pipe buffer keeps its own reference and contents.
+ */
+static void pipe_to_file_unsteal(struct address_space *mapping,
+				 struct page *page)
+{
+	lock_page(page);
+	if (page->mapping == mapping && !PageDirty(page) &&
+	    !page_mapped(page)) {
+		ClearPageUptodate(page);
+		remove_from_page_cache(page);
+		page_cache_release(page);
+	}
+	unlock_page(page);
+}
+
 int pipe_to_file(struct pipe_inode_info *pipe, struct pipe_buffer *buf,
 		 struct splice_desc *sd)
 {
@@ -720,6 +782,7 @@ int pipe_to_file(struct pipe_inode_info *pipe, struct pipe_buffer *buf,
 	unsigned int offset, this_len;
 	struct page *page;
 	void *fsdata;
+	bool stolen = false;
 	int ret;
 
 	offset = sd->pos & ~PAGE_CACHE_MASK;
@@ -728,10 +791,25 @@ int pipe_to_file(struct pipe_inode_info *pipe, struct pipe_buffer *buf,
 	if (this_len + offset > PAGE_CACHE_SIZE)
 		this_len = PAGE_CACHE_SIZE - offset;
 
+	/*
+	 * A full, aligned page can be moved into the page cache as is.
+	 * ->write_begin() then finds it there, uptodate, and only has to
+	 * map blocks for it; if the page got dropped in between we simply
+	 * fall back to copying below.
+	 */
+	if ((sd->flags & SPLICE_F_MOVE) && !offset &&
+	    this_len == PAGE_CACHE_SIZE &&
+	    !pipe_to_file_steal(pipe, buf, mapping,
+				sd->pos >> PAGE_CACHE_SHIFT))
+		stolen = true;
+
 	ret = pagecache_write_begin(file, mapping, sd->pos, this_len,
 				AOP_FLAG_UNINTERRUPTIBLE, &page, &fsdata);
-	if (unlikely(ret))
+	if (unlikely(ret)) {
+		if (stolen)
+			pipe_to_file_unsteal(mapping, buf->page);
 		goto out;
+	}
 
 	if (buf->page != page) {
 		/*
@@ -859,6 +937,7 @@ int splice_from_pipe_next(struct pipe_inode_info *pipe, struct splice_desc *sd)
 			sd->need_wakeup = false;
 		}
 
+		pipe->full_waits = 0;
 		pipe_wait(pipe);
 	}
 
@@ -1777,6 +1856,7 @@ static int opipe_prep(struct pipe_inode_info *pipe, unsigned int flags)
 			ret = -ERESTARTSYS;
 			break;
 		}
+		pipe_writer_blocked(pipe);
 		pipe->waiting_writers++;
 		pipe_wait(pipe);
 		pipe->waiting_writers--;
@@ -168,6 +168,10 @@ int squashfs_read_data(struct super_block *sb, void **buffer, u64 index,
 		 */
 		int i, in, pg_offset = 0;
 
+		/* The output buffer may cover less than a full block */
+		if (length > pages << PAGE_CACHE_SHIFT)
+			goto block_release;
+
 		for (i = 0; i < b; i++) {
 			wait_on_buffer(bh[i]);
 			if (!buffer_uptodate(bh[i]))
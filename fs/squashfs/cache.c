@@ -103,6 +103,10 @@ struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 			cache->next_blk = (i + 1) % cache->entries;
 			entry = &cache->entry[i];
 
+			cache->misses++;
+			if (entry->block != SQUASHFS_INVALID_BLK)
+				cache->evictions++;
+
 			/*
 			 * Initialise choosen cache entry, and fill it in from
 			 * disk.
@@ -147,6 +151,7 @@ struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 		 * for reuse.
 		 */
 		entry = &cache->entry[i];
+		cache->hits++;
 		if (entry->refcount == 0)
 			cache->unused--;
 		entry->refcount++;
@@ -0,0 +1,145 @@
+/*
+ * Squashfs - a compressed read only filesystem for Linux
+ *
+ * Copyright (c) 2002, 2003, 2004, 2005, 2006, 2007, 2008, 2009
+ * Phillip Lougher <phillip@lougher.demon.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * file_direct.c
+ */
+
+/*
+ * This file implements reading a datablock directly into the page cache.
+ * All the page cache pages covered by the block are grabbed and handed to
+ * the decompressor as its output buffer, avoiding the intermediate copy
+ * through the read_page cache (and the contention on it).
+ */
+
+#include <linux/fs.h>
+#include <linux/vfs.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/pagemap.h>
+#include <linux/highmem.h>
+
+#include "squashfs_fs.h"
+#include "squashfs_fs_sb.h"
+#include "squashfs_fs_i.h"
+#include "squashfs.h"
+
+/*
+ * Read and decompress the datablock at @block (compressed size @bsize)
+ * that contains @target_page directly into the page cache.
+ *
+ * Returns 0 if the block was read, in which case all the pages, including
+ * @target_page, have been unlocked.  Returns -EAGAIN if not all the pages
+ * of the block could be grabbed, in which case nothing has been done and
+ * the caller should read the block through the read_page cache instead.
+ * Any other error leaves @target_page locked for the caller to fail.
+ */
+int squashfs_readpage_block(struct page *target_page, u64 block, int bsize)
+{
+	struct inode *inode = target_page->mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+
+	int file_end = (i_size_read(inode) - 1) >> PAGE_CACHE_SHIFT;
+	int mask = (1 << (msblk->block_log - PAGE_CACHE_SHIFT)) - 1;
+	int start_index = target_page->index & ~mask;
+	int end_index = start_index | mask;
+	int i, n, pages, bytes, grabbed = 0, res = -ENOMEM;
+	struct page **page;
+	void **pageaddr;
+
+	if (end_index > file_end)
+		end_index = file_end;
+
+	pages = end_index - start_index + 1;
+
+	page = kmalloc(pages * sizeof(*page), GFP_KERNEL);
+	if (page == NULL)
+		return res;
+
+	pageaddr = kmalloc(pages * sizeof(*pageaddr), GFP_KERNEL);
+	if (pageaddr == NULL)
+		goto out_free;
+
+	/*
+	 * Grab all the pages of the block.  If any page is missing, or is
+	 * already up to date, decompressing into the page cache would lose
+	 * data or overwrite valid data, so fall back to the read_page cache.
+	 */
+	for (i = 0, n = start_index; n <= end_index; i++, n++) {
+		page[i] = (n == target_page->index) ? target_page :
+			grab_cache_page_nowait(target_page->mapping, n);
+		if (page[i] == NULL) {
+			res = -EAGAIN;
+			goto release_pages;
+		}
+
+		grabbed++;
+		if (page[i] != target_page && PageUptodate(page[i])) {
+			res = -EAGAIN;
+			goto release_pages;
+		}
+	}
+
+	for (i = 0; i < pages; i++)
+		pageaddr[i] = kmap(page[i]);
+
+	res = squashfs_read_data(inode->i_sb, pageaddr, block, bsize, NULL,
+		msblk->block_size, pages);
+
+	if (res < 0) {
+		ERROR("Unable to read page, block %llx, size %x\n", block,
+			bsize);
+		for (i = 0; i < pages; i++)
+			kunmap(page[i]);
+		goto release_pages;
+	}
+
+	/* Zero the part of the block beyond the decompressed data */
+	for (i = 0, bytes = res; i < pages; i++, bytes -= PAGE_CACHE_SIZE) {
+		int avail = max_t(int, min_t(int, bytes, PAGE_CACHE_SIZE), 0);
+
+		if (avail < PAGE_CACHE_SIZE)
+			memset(pageaddr[i] + avail, 0, PAGE_CACHE_SIZE - avail);
+		kunmap(page[i]);
+		flush_dcache_page(page[i]);
+		SetPageUptodate(page[i]);
+		unlock_page(page[i]);
+		if (page[i] != target_page)
+			page_cache_release(page[i]);
+	}
+
+	kfree(pageaddr);
+	kfree(page);
+	return 0;
+
+release_pages:
+	/* Release every page grabbed so far, leaving target_page locked */
+	for (i = 0; i < grabbed; i++) {
+		if (page[i] == target_page)
+			continue;
+		unlock_page(page[i]);
+		page_cache_release(page[i]);
+	}
+
+	kfree(pageaddr);
+out_free:
+	kfree(page);
+	return res;
+}
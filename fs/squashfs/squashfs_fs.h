@@ -204,6 +204,10 @@
 /* cached data constants for filesystem */
 #define SQUASHFS_CACHED_BLKS		8
 
+/* limits on the cache sizes selectable at mount time */
+#define SQUASHFS_MAX_CACHED_BLKS	64
+#define SQUASHFS_MAX_CACHED_FRAGMENTS	64
+
 #define SQUASHFS_MAX_FILE_SIZE_LOG	64
 
 #define SQUASHFS_MAX_FILE_SIZE		(1LL << \
@@ -23,6 +23,9 @@
  * squashfs_fs_sb.h
  */
 
+#include <linux/kobject.h>
+#include <linux/completion.h>
+
 #include "squashfs_fs.h"
 
 struct squashfs_cache {
@@ -36,6 +39,9 @@ struct squashfs_cache {
 	spinlock_t		lock;
 	wait_queue_head_t	wait_queue;
 	struct squashfs_cache_entry *entry;
+	unsigned long		hits;
+	unsigned long		misses;
+	unsigned long		evictions;
 };
 
 struct squashfs_cache_entry {
@@ -62,7 +68,6 @@ struct squashfs_sb_info {
 	__le64					*id_table;
 	__le64					*fragment_index;
 	__le64					*xattr_id_table;
-	struct mutex				read_data_mutex;
 	struct mutex				meta_index_mutex;
 	struct meta_index			*meta_index;
 	void					*stream;
@@ -75,5 +80,9 @@ struct squashfs_sb_info {
 	long long				bytes_used;
 	unsigned int				inodes;
 	int					xattr_ids;
+	int					cached_blks;
+	int					cached_frags;
+	struct kobject				kobj;
+	struct completion			kobj_unregister;
 };
 #endif
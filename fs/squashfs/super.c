@@ -36,6 +36,9 @@
 #include <linux/module.h>
 #include <linux/magic.h>
 #include <linux/xattr.h>
+#include <linux/parser.h>
+#include <linux/seq_file.h>
+#include <linux/mount.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -74,6 +77,74 @@ static const struct squashfs_decompressor *supported_squashfs_filesystem(short
 }
 
 
+enum {
+	Opt_metadata_cache, Opt_fragment_cache, Opt_err
+};
+
+static const match_table_t tokens = {
+	{Opt_metadata_cache, "metadata_cache=%u"},
+	{Opt_fragment_cache, "fragment_cache=%u"},
+	{Opt_err, NULL}
+};
+
+
+/*
+ * Parse the mount options.  These only select the number of metadata and
+ * fragment blocks cached, which otherwise default to the built-in sizes.
+ */
+static int squashfs_parse_options(struct squashfs_sb_info *msblk,
+	char *options)
+{
+	substring_t args[MAX_OPT_ARGS];
+	char *p;
+	int option;
+
+	msblk->cached_blks = SQUASHFS_CACHED_BLKS;
+	msblk->cached_frags = SQUASHFS_CACHED_FRAGMENTS;
+
+	if (options == NULL)
+		return 0;
+
+	while ((p = strsep(&options, ",")) != NULL) {
+		if (!*p)
+			continue;
+
+		switch (match_token(p, tokens, args)) {
+		case Opt_metadata_cache:
+			/*
+			 * The block list read-ahead in file.c relies on at
+			 * least SQUASHFS_CACHED_BLKS metadata blocks.
+			 */
+			if (match_int(&args[0], &option) ||
+					option < SQUASHFS_CACHED_BLKS ||
+					option > SQUASHFS_MAX_CACHED_BLKS) {
+				ERROR("metadata_cache must be between %d and "
+					"%d\n", SQUASHFS_CACHED_BLKS,
+					SQUASHFS_MAX_CACHED_BLKS);
+				return -EINVAL;
+			}
+			msblk->cached_blks = option;
+			break;
+		case Opt_fragment_cache:
+			if (match_int(&args[0], &option) || option < 1 ||
+					option > SQUASHFS_MAX_CACHED_FRAGMENTS) {
+				ERROR("fragment_cache must be between 1 and "
+					"%d\n", SQUASHFS_MAX_CACHED_FRAGMENTS);
+				return -EINVAL;
+			}
+			msblk->cached_frags = option;
+			break;
+		default:
+			ERROR("Unrecognised mount option \"%s\" or missing "
+				"value\n", p);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+
 static int squashfs_fill_super(struct super_block *sb, void *data, int silent)
 {
 	struct squashfs_sb_info *msblk;
@@ -104,9 +175,12 @@ static int squashfs_fill_super(struct super_block *sb, void *data, int silent)
 	msblk->devblksize = sb_min_blocksize(sb, BLOCK_SIZE);
 	msblk->devblksize_log2 = ffz(~msblk->devblksize);
 
-	mutex_init(&msblk->read_data_mutex);
 	mutex_init(&msblk->meta_index_mutex);
 
+	err = squashfs_parse_options(msblk, data);
+	if (err)
+		goto failed_mount;
+
 	/*
 	 * msblk->bytes_used is checked in squashfs_read_table to ensure reads
 	 * are not beyond filesystem end.  But as we're using
@@ -199,17 +273,18 @@ static int squashfs_fill_super(struct super_block *sb, void *data, int silent)
 
 	err = -ENOMEM;
 
-	msblk->stream = squashfs_decompressor_init(msblk);
+	msblk->stream = squashfs_decompressor_create(msblk);
 	if (msblk->stream == NULL)
 		goto failed_mount;
 
 	msblk->block_cache = squashfs_cache_init("metadata",
-			SQUASHFS_CACHED_BLKS, SQUASHFS_METADATA_SIZE);
+			msblk->cached_blks, SQUASHFS_METADATA_SIZE);
 	if (msblk->block_cache == NULL)
 		goto failed_mount;
 
-	/* Allocate read_page block */
-	msblk->read_page = squashfs_cache_init("data", 1, msblk->block_size);
+	/* Allocate read_page block, one per decompressor that can be active */
+	msblk->read_page = squashfs_cache_init("data",
+		squashfs_max_decompressors(), msblk->block_size);
 	if (msblk->read_page == NULL) {
 		ERROR("Failed to allocate read_page block\n");
 		goto failed_mount;
@@ -229,7 +304,7 @@ static int squashfs_fill_super(struct super_block *sb, void *data, int silent)
 		goto allocate_lookup_table;
 
 	msblk->fragment_cache = squashfs_cache_init("fragment",
-		SQUASHFS_CACHED_FRAGMENTS, msblk->block_size);
+		msblk->cached_frags, msblk->block_size);
 	if (msblk->fragment_cache == NULL) {
 		err = -ENOMEM;
 		goto failed_mount;
@@ -298,6 +373,13 @@ allocate_root:
 		goto failed_mount;
 	}
 
+	err = squashfs_sysfs_register(sb);
+	if (err) {
+		dput(sb->s_root);
+		sb->s_root = NULL;
+		goto failed_mount;
+	}
+
 	TRACE("Leaving squashfs_fill_super\n");
 	kfree(sblk);
 	return 0;
@@ -306,7 +388,7 @@ failed_mount:
 	squashfs_cache_delete(msblk->block_cache);
 	squashfs_cache_delete(msblk->fragment_cache);
 	squashfs_cache_delete(msblk->read_page);
-	squashfs_decompressor_free(msblk, msblk->stream);
+	squashfs_decompressor_destroy(msblk);
 	kfree(msblk->inode_lookup_table);
 	kfree(msblk->fragment_index);
 	kfree(msblk->id_table);
@@ -344,6 +426,19 @@ static int squashfs_statfs(struct dentry *dentry, struct kstatfs *buf)
 }
 
 
+static int squashfs_show_options(struct seq_file *seq, struct vfsmount *vfs)
+{
+	struct squashfs_sb_info *msblk = vfs->mnt_sb->s_fs_info;
+
+	if (msblk->cached_blks != SQUASHFS_CACHED_BLKS)
+		seq_printf(seq, ",metadata_cache=%d", msblk->cached_blks);
+	if (msblk->cached_frags != SQUASHFS_CACHED_FRAGMENTS)
+		seq_printf(seq, ",fragment_cache=%d", msblk->cached_frags);
+
+	return 0;
+}
+
+
 static int squashfs_remount(struct super_block *sb, int *flags, char *data)
 {
 	*flags |= MS_RDONLY;
@@ -355,10 +450,11 @@ static void squashfs_put_super(struct super_block *sb)
 {
 	if (sb->s_fs_info) {
 		struct squashfs_sb_info *sbi = sb->s_fs_info;
+		squashfs_sysfs_unregister(sb);
 		squashfs_cache_delete(sbi->block_cache);
 		squashfs_cache_delete(sbi->fragment_cache);
 		squashfs_cache_delete(sbi->read_page);
-		squashfs_decompressor_free(sbi, sbi->stream);
+		squashfs_decompressor_destroy(sbi);
 		kfree(sbi->id_table);
 		kfree(sbi->fragment_index);
 		kfree(sbi->meta_index);
@@ -411,8 +507,15 @@ static int __init init_squashfs_fs(void)
 	if (err)
 		return err;
 
+	err = squashfs_sysfs_init();
+	if (err) {
+		destroy_inodecache();
+		return err;
+	}
+
 	err = register_filesystem(&squashfs_fs_type);
 	if (err) {
+		squashfs_sysfs_exit();
 		destroy_inodecache();
 		return err;
 	}
@@ -427,6 +530,7 @@ static int __init init_squashfs_fs(void)
 static void __exit exit_squashfs_fs(void)
 {
 	unregister_filesystem(&squashfs_fs_type);
+	squashfs_sysfs_exit();
 	destroy_inodecache();
 }
 
@@ -466,6 +570,7 @@ static const struct super_operations squashfs_super_ops = {
 	.destroy_inode = squashfs_destroy_inode,
 	.statfs = squashfs_statfs,
 	.put_super = squashfs_put_super,
+	.show_options = squashfs_show_options,
 	.remount_fs = squashfs_remount
 };
 
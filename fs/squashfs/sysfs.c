@@ -0,0 +1,184 @@
+/*
+ * Squashfs - a compressed read only filesystem for Linux
+ *
+ * Copyright (c) 2002, 2003, 2004, 2005, 2006, 2007, 2008, 2009
+ * Phillip Lougher <phillip@lougher.demon.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * sysfs.c
+ */
+
+/*
+ * This file implements the per-mount sysfs directory, /sys/fs/squashfs/<dev>,
+ * which reports the size of the metadata and fragment caches chosen at
+ * mount time, and how well they are doing.
+ */
+
+#include <linux/fs.h>
+#include <linux/kobject.h>
+#include <linux/sysfs.h>
+#include <linux/spinlock.h>
+#include <linux/completion.h>
+
+#include "squashfs_fs.h"
+#include "squashfs_fs_sb.h"
+#include "squashfs.h"
+
+static struct kset *squashfs_kset;
+
+enum {
+	CACHE_METADATA,
+	CACHE_FRAGMENT
+};
+
+enum {
+	STAT_ENTRIES,
+	STAT_HITS,
+	STAT_MISSES,
+	STAT_EVICTIONS
+};
+
+struct squashfs_attr {
+	struct attribute attr;
+	int cache;
+	int stat;
+};
+
+#define SQUASHFS_ATTR(_name, _cache, _stat)				\
+static struct squashfs_attr squashfs_attr_##_name = {			\
+	.attr = { .name = __stringify(_name), .mode = 0444 },		\
+	.cache = _cache,						\
+	.stat = _stat,							\
+}
+
+SQUASHFS_ATTR(metadata_cache_entries, CACHE_METADATA, STAT_ENTRIES);
+SQUASHFS_ATTR(metadata_cache_hits, CACHE_METADATA, STAT_HITS);
+SQUASHFS_ATTR(metadata_cache_misses, CACHE_METADATA, STAT_MISSES);
+SQUASHFS_ATTR(metadata_cache_evictions, CACHE_METADATA, STAT_EVICTIONS);
+SQUASHFS_ATTR(fragment_cache_entries, CACHE_FRAGMENT, STAT_ENTRIES);
+SQUASHFS_ATTR(fragment_cache_hits, CACHE_FRAGMENT, STAT_HITS);
+SQUASHFS_ATTR(fragment_cache_misses, CACHE_FRAGMENT, STAT_MISSES);
+SQUASHFS_ATTR(fragment_cache_evictions, CACHE_FRAGMENT, STAT_EVICTIONS);
+
+static struct attribute *squashfs_attrs[] = {
+	&squashfs_attr_metadata_cache_entries.attr,
+	&squashfs_attr_metadata_cache_hits.attr,
+	&squashfs_attr_metadata_cache_misses.attr,
+	&squashfs_attr_metadata_cache_evictions.attr,
+	&squashfs_attr_fragment_cache_entries.attr,
+	&squashfs_attr_fragment_cache_hits.attr,
+	&squashfs_attr_fragment_cache_misses.attr,
+	&squashfs_attr_fragment_cache_evictions.attr,
+	NULL,
+};
+
+
+static ssize_t squashfs_attr_show(struct kobject *kobj,
+	struct attribute *attr, char *buf)
+{
+	struct squashfs_sb_info *msblk = container_of(kobj,
+		struct squashfs_sb_info, kobj);
+	struct squashfs_attr *a = container_of(attr, struct squashfs_attr,
+		attr);
+	struct squashfs_cache *cache = a->cache == CACHE_METADATA ?
+		msblk->block_cache : msblk->fragment_cache;
+	unsigned long val = 0;
+
+	/* Filesystems without fragments have no fragment cache */
+	if (cache == NULL)
+		return snprintf(buf, PAGE_SIZE, "0\n");
+
+	spin_lock(&cache->lock);
+	switch (a->stat) {
+	case STAT_ENTRIES:
+		val = cache->entries;
+		break;
+	case STAT_HITS:
+		val = cache->hits;
+		break;
+	case STAT_MISSES:
+		val = cache->misses;
+		break;
+	case STAT_EVICTIONS:
+		val = cache->evictions;
+		break;
+	}
+	spin_unlock(&cache->lock);
+
+	return snprintf(buf, PAGE_SIZE, "%lu\n", val);
+}
+
+
+static void squashfs_sb_release(struct kobject *kobj)
+{
+	struct squashfs_sb_info *msblk = container_of(kobj,
+		struct squashfs_sb_info, kobj);
+
+	complete(&msblk->kobj_unregister);
+}
+
+
+static const struct sysfs_ops squashfs_attr_ops = {
+	.show	= squashfs_attr_show,
+};
+
+
+static struct kobj_type squashfs_ktype = {
+	.default_attrs	= squashfs_attrs,
+	.sysfs_ops	= &squashfs_attr_ops,
+	.release	= squashfs_sb_release,
+};
+
+
+int squashfs_sysfs_register(struct super_block *sb)
+{
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+	int err;
+
+	msblk->kobj.kset = squashfs_kset;
+	init_completion(&msblk->kobj_unregister);
+	err = kobject_init_and_add(&msblk->kobj, &squashfs_ktype, NULL,
+		"%s", sb->s_id);
+	if (err) {
+		kobject_put(&msblk->kobj);
+		wait_for_completion(&msblk->kobj_unregister);
+	}
+
+	return err;
+}
+
+
+void squashfs_sysfs_unregister(struct super_block *sb)
+{
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+
+	kobject_put(&msblk->kobj);
+	wait_for_completion(&msblk->kobj_unregister);
+}
+
+
+int __init squashfs_sysfs_init(void)
+{
+	squashfs_kset = kset_create_and_add("squashfs", NULL, fs_kobj);
+
+	return squashfs_kset ? 0 : -ENOMEM;
+}
+
+
+void squashfs_sysfs_exit(void)
+{
+	kset_unregister(squashfs_kset);
+}
@@ -31,6 +31,8 @@
 #include <linux/mutex.h>
 #include <linux/backing-dev.h>
 #include <linux/rculist_bl.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
 #include "internal.h"
 
 
@@ -57,7 +59,10 @@ static struct super_block *alloc_super(struct file_system_type *type)
 		}
 #ifdef CONFIG_SMP
 		s->s_files = alloc_percpu(struct list_head);
-		if (!s->s_files) {
+		s->s_walk_stats = alloc_percpu(struct sb_walk_stats);
+		if (!s->s_files || !s->s_walk_stats) {
+			free_percpu(s->s_walk_stats);
+			free_percpu(s->s_files);
 			security_sb_free(s);
 			kfree(s);
 			s = NULL;
@@ -126,6 +131,7 @@ out:
 static inline void destroy_super(struct super_block *s)
 {
 #ifdef CONFIG_SMP
+	free_percpu(s->s_walk_stats);
 	free_percpu(s->s_files);
 #endif
 	security_sb_free(s);
@@ -1174,3 +1180,68 @@ struct vfsmount *kern_mount_data(struct file_system_type *type, void *data)
 }
 
 EXPORT_SYMBOL_GPL(kern_mount_data);
+
+#ifdef CONFIG_PROC_FS
+static void sb_walk_stats_sum(struct super_block *sb,
+			      struct sb_walk_stats *sum)
+{
+#ifdef CONFIG_SMP
+	int cpu;
+
+	sum->rcu = sum->ref = 0;
+	for_each_possible_cpu(cpu) {
+		struct sb_walk_stats *st = per_cpu_ptr(sb->s_walk_stats, cpu);
+
+		sum->rcu += st->rcu;
+		sum->ref += st->ref;
+	}
+#else
+	*sum = sb->s_walk_stats;
+#endif
+}
+
+/*
+ * /proc/fs/pathwalk: per superblock count of path lookups that finished
+ * in rcu-walk mode, and of the times rcu-walk had to fall back to
+ * ref-walk on that filesystem (revalidate, permission, follow_link...).
+ */
+static int pathwalk_stats_show(struct seq_file *m, void *v)
+{
+	struct super_block *sb;
+	struct sb_walk_stats st;
+
+	seq_printf(m, "%-16s %-12s %12s %12s\n",
+		   "device", "fstype", "rcu-walk", "ref-walk");
+	spin_lock(&sb_lock);
+	list_for_each_entry(sb, &super_blocks, s_list) {
+		if (list_empty(&sb->s_instances))
+			continue;
+		sb_walk_stats_sum(sb, &st);
+		if (!st.rcu && !st.ref)
+			continue;
+		seq_printf(m, "%-16s %-12s %12lu %12lu\n",
+			   sb->s_id, sb->s_type->name, st.rcu, st.ref);
+	}
+	spin_unlock(&sb_lock);
+	return 0;
+}
+
+static int pathwalk_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, pathwalk_stats_show, NULL);
+}
+
+static const struct file_operations pathwalk_stats_fops = {
+	.open		= pathwalk_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init pathwalk_stats_init(void)
+{
+	proc_create("fs/pathwalk", 0444, NULL, &pathwalk_stats_fops);
+	return 0;
+}
+module_init(pathwalk_stats_init);
+#endif
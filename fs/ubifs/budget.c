@@ -86,6 +86,10 @@ static int run_gc(struct ubifs_info *c)
 	if (lnum < 0)
 		return lnum;
 
+	spin_lock(&c->space_lock);
+	c->fg_gc_freed += 1;
+	spin_unlock(&c->space_lock);
+
 	/* GC freed one LEB, return it to lprops */
 	dbg_budg("GC freed LEB %d", lnum);
 	err = ubifs_return_leb(c, lnum);
@@ -458,6 +462,9 @@ int ubifs_budget_space(struct ubifs_info *c, struct ubifs_budget_req *req)
 		return 0;
 	idx_growth = calc_idx_growth(c, req);
 
+	/* Background GC waits for a period without budgeting requests */
+	c->last_budget = jiffies;
+
 again:
 	spin_lock(&c->space_lock);
 	ubifs_assert(c->budg_idx_growth >= 0);
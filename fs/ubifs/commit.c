@@ -227,10 +227,9 @@ out:
  * This function implements various file-system background activities:
  * o when a write-buffer timer expires it synchronizes the appropriate
  *   write-buffer;
- * o when the journal is about to be full, it starts in-advance commit.
- *
- * Note, other stuff like background garbage collection may be added here in
- * future.
+ * o when the journal is about to be full, it starts in-advance commit;
+ * o when nothing was budgeted for %BG_GC_IDLE_TIMEOUT seconds and there are
+ *   too few empty LEBs, it garbage collects dirty LEBs.
  */
 int ubifs_bg_thread(void *info)
 {
@@ -258,7 +257,19 @@ int ubifs_bg_thread(void *info)
 			 */
 			if (kthread_should_stop())
 				break;
-			schedule();
+			if (!ubifs_bg_gc_wanted(c)) {
+				schedule();
+				continue;
+			}
+
+			/* Wait for an idle period, then run background GC */
+			if (schedule_timeout(BG_GC_IDLE_TIMEOUT * HZ) ||
+			    c->need_bgt)
+				continue;
+			__set_current_state(TASK_RUNNING);
+			err = ubifs_bg_gc(c);
+			if (err)
+				ubifs_ro_mode(c, err);
 			continue;
 		} else
 			__set_current_state(TASK_RUNNING);
@@ -269,6 +280,11 @@ int ubifs_bg_thread(void *info)
 			ubifs_ro_mode(c, err);
 
 		run_bg_commit(c);
+
+		if (c->need_tnc_trim) {
+			c->need_tnc_trim = 0;
+			ubifs_trim_tnc(c);
+		}
 		cond_resched();
 	}
 
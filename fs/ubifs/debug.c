@@ -2801,6 +2801,27 @@ static ssize_t write_debugfs_file(struct file *file, const char __user *buf,
 		mutex_lock(&c->tnc_mutex);
 		dbg_dump_tnc(c);
 		mutex_unlock(&c->tnc_mutex);
+	} else if (file->f_path.dentry == d->dfs_dump_tnc_stats) {
+		mutex_lock(&c->tnc_mutex);
+		printk(KERN_DEBUG "(pid %d) TNC statistics: clean znodes %ld "
+		       "(limit %lu), dirty znodes %ld\n", current->pid,
+		       atomic_long_read(&c->clean_zn_cnt), ubifs_max_clean_zn,
+		       atomic_long_read(&c->dirty_zn_cnt));
+		printk(KERN_DEBUG "\tznode hits %lu, misses %lu, "
+		       "LNC hits %lu, misses %lu\n", c->zn_hits, c->zn_misses,
+		       c->lnc_hits, c->lnc_misses);
+		mutex_unlock(&c->tnc_mutex);
+	} else if (file->f_path.dentry == d->dfs_dump_gc_stats) {
+		spin_lock(&c->space_lock);
+		printk(KERN_DEBUG "(pid %d) GC statistics: empty LEBs %d "
+		       "(background target %u), total dirty %lld\n",
+		       current->pid, c->lst.empty_lebs, ubifs_bg_gc_lebs,
+		       c->lst.total_dirty);
+		printk(KERN_DEBUG "\tbackground runs %lu, freed %lu, "
+		       "commits %lu, fails %lu; foreground freed %lu\n",
+		       c->bg_gc_runs, c->bg_gc_freed, c->bg_gc_commits,
+		       c->bg_gc_fails, c->fg_gc_freed);
+		spin_unlock(&c->space_lock);
 	} else
 		return -EINVAL;
 
@@ -2861,6 +2882,18 @@ int dbg_debugfs_init_fs(struct ubifs_info *c)
 		goto out_remove;
 	d->dfs_dump_tnc = dent;
 
+	fname = "dump_tnc_stats";
+	dent = debugfs_create_file(fname, S_IWUSR, d->dfs_dir, c, &dfs_fops);
+	if (IS_ERR(dent))
+		goto out_remove;
+	d->dfs_dump_tnc_stats = dent;
+
+	fname = "dump_gc_stats";
+	dent = debugfs_create_file(fname, S_IWUSR, d->dfs_dir, c, &dfs_fops);
+	if (IS_ERR(dent))
+		goto out_remove;
+	d->dfs_dump_gc_stats = dent;
+
 	return 0;
 
 out_remove:
@@ -52,6 +52,8 @@
  * dfs_dump_lprops: "dump lprops" debugfs knob
  * dfs_dump_budg: "dump budgeting information" debugfs knob
  * dfs_dump_tnc: "dump TNC" debugfs knob
+ * dfs_dump_tnc_stats: "dump TNC and LNC hit/miss statistics" debugfs knob
+ * dfs_dump_gc_stats: "dump garbage collection statistics" debugfs knob
  */
 struct ubifs_debug_info {
 	void *buf;
@@ -79,6 +81,8 @@ struct ubifs_debug_info {
 	struct dentry *dfs_dump_lprops;
 	struct dentry *dfs_dump_budg;
 	struct dentry *dfs_dump_tnc;
+	struct dentry *dfs_dump_tnc_stats;
+	struct dentry *dfs_dump_gc_stats;
 };
 
 #define ubifs_assert(expr) do {                                                \
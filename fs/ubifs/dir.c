@@ -137,7 +137,15 @@ struct inode *ubifs_new_inode(struct ubifs_info *c, const struct inode *dir,
 
 	ui->flags = inherit_flags(dir, mode);
 	ubifs_set_inode_flags(inode);
-	if (S_ISREG(mode))
+	if (S_ISDIR(dir->i_mode) &&
+	    ubifs_inode(dir)->compr_type != UBIFS_COMPR_NONE &&
+	    (S_ISREG(mode) || S_ISDIR(mode)))
+		/*
+		 * The compressor was selected for the parent directory, so
+		 * new files and sub-directories inherit it.
+		 */
+		ui->compr_type = ubifs_inode(dir)->compr_type;
+	else if (S_ISREG(mode))
 		ui->compr_type = c->default_compr;
 	else
 		ui->compr_type = UBIFS_COMPR_NONE;
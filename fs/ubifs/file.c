@@ -805,26 +805,78 @@ out_bu_off:
 	goto out_free;
 }
 
+/**
+ * bulk_read_more - continue bulk-read into the following data nodes.
+ * @c: UBIFS file-system description object
+ * @bu: bulk-read information
+ * @inode: inode to read
+ * @end: index of the page to stop at
+ *
+ * A single bulk-read stops at the end of a LEB or after %UBIFS_MAX_BULK_READ
+ * data nodes. This function keeps bulk-reading the pages which follow
+ * @ui->last_page_read, typically from the next LEBs, until @end is reached,
+ * the end of the file is reached, or the pages are already up-to-date.
+ */
+static void bulk_read_more(struct ubifs_info *c, struct bu_info *bu,
+			   struct inode *inode, pgoff_t end)
+{
+	struct ubifs_inode *ui = ubifs_inode(inode);
+
+	while (ui->bulk_read && ui->last_page_read + 1 < end) {
+		pgoff_t index = ui->last_page_read + 1;
+		struct page *page;
+		int done;
+
+		page = find_or_create_page(inode->i_mapping, index,
+					   GFP_NOFS | __GFP_COLD);
+		if (!page)
+			break;
+		if (PageUptodate(page)) {
+			unlock_page(page);
+			page_cache_release(page);
+			break;
+		}
+
+		bu->buf_len = c->max_bu_buf_len;
+		data_key_init(c, &bu->key, inode->i_ino,
+			      index << UBIFS_BLOCKS_PER_PAGE_SHIFT);
+		done = ubifs_do_bulk_read(c, bu, page);
+		if (!done)
+			/* The page is read later by the usual means */
+			unlock_page(page);
+		page_cache_release(page);
+		if (!done || ui->last_page_read < index)
+			break;
+	}
+}
+
 /**
  * ubifs_bulk_read - determine whether to bulk-read and, if so, do it.
+ * @file: file the page is read for (may be %NULL)
  * @page: page from which to start bulk-read.
  *
  * Some flash media are capable of reading sequentially at faster rates. UBIFS
  * bulk-read facility is designed to take advantage of that, by reading in one
  * go consecutive data nodes that are also located consecutively in the same
  * LEB. This function returns %1 if a bulk-read is done and %0 otherwise.
+ *
+ * With the 'auto_bulk_read' mount option, bulk-read is only used when the VFS
+ * read-ahead window of @file shows that it is read sequentially, and it then
+ * covers the whole window rather than stopping at the end of the LEB.
  */
-static int ubifs_bulk_read(struct page *page)
+static int ubifs_bulk_read(struct file *file, struct page *page)
 {
 	struct inode *inode = page->mapping->host;
 	struct ubifs_info *c = inode->i_sb->s_fs_info;
 	struct ubifs_inode *ui = ubifs_inode(inode);
 	pgoff_t index = page->index, last_page_read = ui->last_page_read;
 	struct bu_info *bu;
-	int err = 0, allocated = 0;
+	int err = 0, allocated = 0, ra_pages = 0;
 
 	ui->last_page_read = index;
-	if (!c->bulk_read)
+	if (c->auto_bulk_read && file)
+		ra_pages = file->f_ra.size;
+	if (!c->bulk_read && ra_pages < UBIFS_BULK_READ_RA_PAGES)
 		return 0;
 
 	/*
@@ -844,7 +896,7 @@ static int ubifs_bulk_read(struct page *page)
 
 	if (!ui->bulk_read) {
 		ui->read_in_a_row += 1;
-		if (ui->read_in_a_row < 3)
+		if (ui->read_in_a_row < 3 && !ra_pages)
 			goto out_unlock;
 		/* Three reads in a row, so switch on bulk-read */
 		ui->bulk_read = 1;
@@ -869,6 +921,8 @@ static int ubifs_bulk_read(struct page *page)
 	data_key_init(c, &bu->key, inode->i_ino,
 		      page->index << UBIFS_BLOCKS_PER_PAGE_SHIFT);
 	err = ubifs_do_bulk_read(c, bu, page);
+	if (err && ra_pages)
+		bulk_read_more(c, bu, inode, index + ra_pages);
 
 	if (!allocated)
 		mutex_unlock(&c->bu_mutex);
@@ -882,7 +936,7 @@ out_unlock:
 
 static int ubifs_readpage(struct file *file, struct page *page)
 {
-	if (ubifs_bulk_read(page))
+	if (ubifs_bulk_read(file, page))
 		return 0;
 	do_readpage(page);
 	unlock_page(page);
@@ -56,6 +56,8 @@
 #include <linux/slab.h>
 #include <linux/pagemap.h>
 #include <linux/list_sort.h>
+#include <linux/kthread.h>
+#include <linux/module.h>
 #include "ubifs.h"
 
 /*
@@ -66,6 +68,16 @@
 #define SOFT_LEBS_LIMIT 4
 #define HARD_LEBS_LIMIT 32
 
+/*
+ * Number of empty LEBs the background thread tries to keep available by
+ * garbage collecting dirty LEBs while the file-system is idle, so that
+ * budgeting does not have to run GC synchronously (%0 disables background GC).
+ */
+unsigned int ubifs_bg_gc_lebs;
+module_param_named(bg_gc_lebs, ubifs_bg_gc_lebs, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(bg_gc_lebs, "Empty LEBs to keep by idle-time background "
+		 "garbage collection (0 = disabled)");
+
 /**
  * switch_gc_head - switch the garbage collection journal head.
  * @c: UBIFS file-system description object
@@ -821,6 +833,89 @@ out:
 	return ret;
 }
 
+/**
+ * ubifs_bg_gc_wanted - check if background garbage collection should run.
+ * @c: UBIFS file-system description object
+ *
+ * This function returns non-zero if background GC is enabled, there are less
+ * than %ubifs_bg_gc_lebs empty LEBs and at least one LEB worth of dirty space
+ * was added since background GC last failed to free an LEB.
+ */
+int ubifs_bg_gc_wanted(struct ubifs_info *c)
+{
+	unsigned int target = ubifs_bg_gc_lebs;
+	int ret;
+
+	if (!target || c->ro_error || c->ro_media || c->ro_mount)
+		return 0;
+
+	spin_lock(&c->space_lock);
+	ret = c->lst.empty_lebs < target &&
+	      c->lst.total_dirty >= c->bg_gc_dirty + c->leb_size;
+	spin_unlock(&c->space_lock);
+	return ret;
+}
+
+/**
+ * ubifs_bg_gc - idle-time background garbage collection.
+ * @c: UBIFS file-system description object
+ *
+ * This function is called by the background thread when nothing was budgeted
+ * for %BG_GC_IDLE_TIMEOUT seconds. It garbage collects dirty LEBs until there
+ * are %ubifs_bg_gc_lebs empty LEBs, GC cannot make progress, or new activity
+ * starts. Returns zero in case of success and a negative error code in case of
+ * failure.
+ */
+int ubifs_bg_gc(struct ubifs_info *c)
+{
+	int lnum, err = 0, committed = 0;
+
+	while (ubifs_bg_gc_wanted(c)) {
+		/* Give way to the foreground and to other background work */
+		if (kthread_should_stop() || c->need_bgt ||
+		    time_before(jiffies, c->last_budget + BG_GC_IDLE_TIMEOUT * HZ))
+			break;
+
+		c->bg_gc_runs += 1;
+		down_read(&c->commit_sem);
+		lnum = ubifs_garbage_collect(c, 1);
+		up_read(&c->commit_sem);
+
+		if (lnum == -EAGAIN && !committed) {
+			/* Commit, so that index LEBs and the journal are freed */
+			dbg_gc("background GC needs commit");
+			c->bg_gc_commits += 1;
+			committed = 1;
+			err = ubifs_run_commit(c);
+			if (err)
+				break;
+			continue;
+		}
+
+		if (lnum < 0) {
+			/* Do not retry until more space gets dirty */
+			if (lnum == -EAGAIN || lnum == -ENOSPC) {
+				spin_lock(&c->space_lock);
+				c->bg_gc_dirty = c->lst.total_dirty;
+				spin_unlock(&c->space_lock);
+				c->bg_gc_fails += 1;
+			} else
+				err = lnum;
+			break;
+		}
+
+		dbg_gc("background GC freed LEB %d", lnum);
+		err = ubifs_return_leb(c, lnum);
+		if (err)
+			break;
+		c->bg_gc_freed += 1;
+		committed = 0;
+		cond_resched();
+	}
+
+	return err;
+}
+
 /**
  * ubifs_gc_start_commit - garbage collection at start of commit.
  * @c: UBIFS file-system description object
@@ -26,6 +26,7 @@
 
 #include <linux/compat.h>
 #include <linux/mount.h>
+#include <mtd/ubifs-user.h>
 #include "ubifs.h"
 
 /**
@@ -144,11 +145,50 @@ out_unlock:
 	return err;
 }
 
+/**
+ * setcompr - change the compressor of an inode.
+ * @inode: inode to change
+ * @compr_type: new compressor type (%UBIFS_COMPR_NONE, etc)
+ *
+ * This function returns zero in case of success and a negative error code in
+ * case of failure.
+ */
+static int setcompr(struct inode *inode, int compr_type)
+{
+	int err, release;
+	struct ubifs_inode *ui = ubifs_inode(inode);
+	struct ubifs_info *c = inode->i_sb->s_fs_info;
+	struct ubifs_budget_req req = { .dirtied_ino = 1,
+					.dirtied_ino_d = ui->data_len };
+
+	err = ubifs_budget_space(c, &req);
+	if (err)
+		return err;
+
+	mutex_lock(&ui->ui_mutex);
+	ui->compr_type = compr_type;
+	ui->compr_fails = ui->compr_skip = 0;
+	inode->i_ctime = ubifs_current_time(inode);
+	release = ui->dirty;
+	mark_inode_dirty_sync(inode);
+	mutex_unlock(&ui->ui_mutex);
+
+	if (release)
+		ubifs_release_budget(c, &req);
+	if (IS_SYNC(inode))
+		err = write_inode_now(inode, 1);
+	return err;
+}
+
 long ubifs_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
 	int flags, err;
 	struct inode *inode = file->f_path.dentry->d_inode;
 
+	BUILD_BUG_ON((int)UBIFS_IOC_COMPR_NONE != UBIFS_COMPR_NONE);
+	BUILD_BUG_ON((int)UBIFS_IOC_COMPR_LZO != UBIFS_COMPR_LZO);
+	BUILD_BUG_ON((int)UBIFS_IOC_COMPR_ZLIB != UBIFS_COMPR_ZLIB);
+
 	switch (cmd) {
 	case FS_IOC_GETFLAGS:
 		flags = ubifs2ioctl(ubifs_inode(inode)->flags);
@@ -182,6 +222,38 @@ long ubifs_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		return err;
 	}
 
+	case UBIFS_IOCGCOMPR:
+		flags = ubifs_inode(inode)->compr_type;
+		return put_user(flags, (__s32 __user *) arg);
+
+	case UBIFS_IOCSCOMPR: {
+		__s32 compr_type;
+
+		if (IS_RDONLY(inode))
+			return -EROFS;
+
+		if (!is_owner_or_cap(inode))
+			return -EACCES;
+
+		if (!S_ISREG(inode->i_mode) && !S_ISDIR(inode->i_mode))
+			return -EINVAL;
+
+		if (get_user(compr_type, (__s32 __user *) arg))
+			return -EFAULT;
+
+		if (compr_type < 0 || compr_type >= UBIFS_COMPR_TYPES_CNT ||
+		    !ubifs_compr_present(compr_type))
+			return -EINVAL;
+
+		err = mnt_want_write(file->f_path.mnt);
+		if (err)
+			return err;
+		dbg_gen("set compressor %d, ino %lu", compr_type, inode->i_ino);
+		err = setcompr(inode, compr_type);
+		mnt_drop_write(file->f_path.mnt);
+		return err;
+	}
+
 	default:
 		return -ENOTTY;
 	}
@@ -197,6 +269,9 @@ long ubifs_compat_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 	case FS_IOC32_SETFLAGS:
 		cmd = FS_IOC_SETFLAGS;
 		break;
+	case UBIFS_IOCGCOMPR:
+	case UBIFS_IOCSCOMPR:
+		break;
 	default:
 		return -ENOIOCTLCMD;
 	}
@@ -689,7 +689,7 @@ int ubifs_jnl_write_data(struct ubifs_info *c, const struct inode *inode,
 			 const union ubifs_key *key, const void *buf, int len)
 {
 	struct ubifs_data_node *data;
-	int err, lnum, offs, compr_type, out_len;
+	int err, lnum, offs, compr_type, out_len, trial;
 	int dlen = UBIFS_DATA_NODE_SZ + UBIFS_BLOCK_SIZE * WORST_COMPR_FACTOR;
 	struct ubifs_inode *ui = ubifs_inode(inode);
 
@@ -710,11 +710,24 @@ int ubifs_jnl_write_data(struct ubifs_info *c, const struct inode *inode,
 	if (!(ui->flags & UBIFS_COMPR_FL))
 		/* Compression is disabled for this inode */
 		compr_type = UBIFS_COMPR_NONE;
-	else
+	else if (ui->compr_skip) {
+		/* Recent blocks did not compress, do not waste time trying */
+		ui->compr_skip -= 1;
+		compr_type = UBIFS_COMPR_NONE;
+	} else
 		compr_type = ui->compr_type;
 
+	trial = compr_type != UBIFS_COMPR_NONE && len >= UBIFS_MIN_COMPR_LEN;
 	out_len = dlen - UBIFS_DATA_NODE_SZ;
 	ubifs_compress(buf, len, &data->data, &out_len, &compr_type);
+	if (trial) {
+		if (compr_type != UBIFS_COMPR_NONE)
+			ui->compr_fails = 0;
+		else if (++ui->compr_fails >= UBIFS_INCOMPR_TRIALS) {
+			ui->compr_fails = 0;
+			ui->compr_skip = UBIFS_INCOMPR_SKIP;
+		}
+	}
 	ubifs_assert(out_len <= UBIFS_BLOCK_SIZE);
 
 	dlen = UBIFS_DATA_NODE_SZ + out_len;
@@ -591,10 +591,7 @@ static int drop_incomplete_group(struct ubifs_scan_leb *sleb, int *offs)
 struct ubifs_scan_leb *ubifs_recover_leb(struct ubifs_info *c, int lnum,
 					 int offs, void *sbuf, int grouped)
 {
-	int err, len = c->leb_size - offs, need_clean = 0, quiet = 1;
-	int empty_chkd = 0, start = offs;
 	struct ubifs_scan_leb *sleb;
-	void *buf = sbuf + offs;
 
 	dbg_rcvry("%d:%d", lnum, offs);
 
@@ -602,6 +599,28 @@ struct ubifs_scan_leb *ubifs_recover_leb(struct ubifs_info *c, int lnum,
 	if (IS_ERR(sleb))
 		return sleb;
 
+	return ubifs_recover_started(c, sleb, offs, grouped);
+}
+
+/**
+ * ubifs_recover_started - recover a LEB which has already been read.
+ * @c: UBIFS file-system description object
+ * @sleb: scanning information returned by 'ubifs_start_scan()'
+ * @offs: offset
+ * @grouped: nodes may be grouped for recovery
+ *
+ * This is the same as 'ubifs_recover_leb()', but the LEB has already been read
+ * to @sleb->buf by 'ubifs_start_scan()'. @sleb is freed in case of failure.
+ */
+struct ubifs_scan_leb *ubifs_recover_started(struct ubifs_info *c,
+					     struct ubifs_scan_leb *sleb,
+					     int offs, int grouped)
+{
+	int err, len = c->leb_size - offs, need_clean = 0, quiet = 1;
+	int empty_chkd = 0, start = offs, lnum = sleb->lnum;
+	void *sbuf = sleb->buf;
+	void *buf = sbuf + offs;
+
 	if (sleb->ecc)
 		need_clean = 1;
 
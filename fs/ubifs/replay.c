@@ -491,7 +491,7 @@ int ubifs_validate_entry(struct ubifs_info *c,
 /**
  * replay_bud - replay a bud logical eraseblock.
  * @c: UBIFS file-system description object
- * @lnum: bud logical eraseblock number to replay
+ * @sleb: the bud as read by 'ubifs_start_scan()'
  * @offs: bud start offset
  * @jhead: journal head to which this bud belongs
  * @free: amount of free space in the bud is returned here
@@ -499,21 +499,20 @@ int ubifs_validate_entry(struct ubifs_info *c,
  * here
  *
  * This function returns zero in case of success and a negative error code in
- * case of failure.
+ * case of failure. @sleb is freed in any case.
  */
-static int replay_bud(struct ubifs_info *c, int lnum, int offs, int jhead,
-		      int *free, int *dirty)
+static int replay_bud(struct ubifs_info *c, struct ubifs_scan_leb *sleb,
+		      int offs, int jhead, int *free, int *dirty)
 {
-	int err = 0, used = 0;
-	struct ubifs_scan_leb *sleb;
+	int err = 0, used = 0, lnum = sleb->lnum;
 	struct ubifs_scan_node *snod;
 	struct ubifs_bud *bud;
 
 	dbg_mnt("replay bud LEB %d, head %d", lnum, jhead);
 	if (c->need_recovery)
-		sleb = ubifs_recover_leb(c, lnum, offs, c->sbuf, jhead != GCHD);
+		sleb = ubifs_recover_started(c, sleb, offs, jhead != GCHD);
 	else
-		sleb = ubifs_scan(c, lnum, offs, c->sbuf, 0);
+		sleb = ubifs_scan_started(c, sleb, offs, 0);
 	if (IS_ERR(sleb))
 		return PTR_ERR(sleb);
 
@@ -700,30 +699,102 @@ static int insert_ref_node(struct ubifs_info *c, int lnum, int offs,
 	return 0;
 }
 
+/**
+ * struct bud_readahead - read-ahead of the next bud to replay.
+ * @work: the work which reads the bud
+ * @c: UBIFS file-system description object
+ * @b: the bud to read
+ * @buf: LEB-sized buffer to read the bud to
+ * @sleb: result of 'ubifs_start_scan()' for the bud
+ */
+struct bud_readahead {
+	struct work_struct work;
+	struct ubifs_info *c;
+	struct bud_entry *b;
+	void *buf;
+	struct ubifs_scan_leb *sleb;
+};
+
+static void bud_readahead_work(struct work_struct *work)
+{
+	struct bud_readahead *ra = container_of(work, struct bud_readahead,
+						work);
+
+	ra->sleb = ubifs_start_scan(ra->c, ra->b->bud->lnum, ra->b->bud->start,
+				    ra->buf);
+}
+
 /**
  * replay_buds - replay all buds.
  * @c: UBIFS file-system description object
  *
+ * Buds are read in advance: while one bud is parsed and inserted to the
+ * TNC, the next one is being read to a second LEB-sized buffer by a work
+ * item. If the second buffer cannot be allocated, the buds are simply read
+ * one by one.
+ *
  * This function returns zero in case of success and a negative error code in
  * case of failure.
  */
 static int replay_buds(struct ubifs_info *c)
 {
 	struct bud_entry *b;
-	int err, uninitialized_var(free), uninitialized_var(dirty);
+	struct ubifs_scan_leb *sleb;
+	struct bud_readahead ra;
+	void *bufs[2];
+	int err = 0, cur = 0, pending = 0;
+	int uninitialized_var(free), uninitialized_var(dirty);
+
+	bufs[0] = c->sbuf;
+	bufs[1] = NULL;
+	if (!list_empty(&c->replay_buds) &&
+	    !list_is_singular(&c->replay_buds))
+		bufs[1] = vmalloc(c->leb_size);
+	if (!bufs[1])
+		dbg_mnt("no read-ahead of buds");
+
+	ra.c = c;
+	INIT_WORK_ONSTACK(&ra.work, bud_readahead_work);
 
 	list_for_each_entry(b, &c->replay_buds, list) {
-		err = replay_bud(c, b->bud->lnum, b->bud->start, b->bud->jhead,
-				 &free, &dirty);
+		if (pending) {
+			flush_work(&ra.work);
+			pending = 0;
+			sleb = ra.sleb;
+			cur = !cur;
+		} else
+			sleb = ubifs_start_scan(c, b->bud->lnum, b->bud->start,
+						bufs[cur]);
+		if (IS_ERR(sleb)) {
+			err = PTR_ERR(sleb);
+			break;
+		}
+
+		if (bufs[1] && !list_is_last(&b->list, &c->replay_buds)) {
+			ra.b = list_entry(b->list.next, struct bud_entry, list);
+			ra.buf = bufs[!cur];
+			queue_work(system_long_wq, &ra.work);
+			pending = 1;
+		}
+
+		err = replay_bud(c, sleb, b->bud->start, b->bud->jhead, &free,
+				 &dirty);
 		if (err)
-			return err;
+			break;
 		err = insert_ref_node(c, b->bud->lnum, b->bud->start, b->sqnum,
 				      free, dirty, b->bud->jhead);
 		if (err)
-			return err;
+			break;
 	}
 
-	return 0;
+	if (pending) {
+		flush_work(&ra.work);
+		if (!IS_ERR(ra.sleb))
+			ubifs_scan_destroy(ra.sleb);
+	}
+	destroy_work_on_stack(&ra.work);
+	vfree(bufs[1]);
+	return err;
 }
 
 /**
@@ -1019,6 +1090,7 @@ out:
 int ubifs_replay_journal(struct ubifs_info *c)
 {
 	int err, i, lnum, offs, free;
+	ktime_t t_log, t_buds, t_tree, t_end;
 
 	BUILD_BUG_ON(UBIFS_TRUN_KEY > 5);
 
@@ -1034,6 +1106,7 @@ int ubifs_replay_journal(struct ubifs_info *c)
 	}
 
 	dbg_mnt("start replaying the journal");
+	t_log = ktime_get();
 	c->replaying = 1;
 	lnum = c->ltail_lnum = c->lhead_lnum;
 	offs = c->lhead_offs;
@@ -1056,13 +1129,16 @@ int ubifs_replay_journal(struct ubifs_info *c)
 		offs = 0;
 	}
 
+	t_buds = ktime_get();
 	err = replay_buds(c);
 	if (err)
 		goto out;
 
+	t_tree = ktime_get();
 	err = apply_replay_tree(c);
 	if (err)
 		goto out;
+	t_end = ktime_get();
 
 	/*
 	 * UBIFS budgeting calculations use @c->budg_uncommitted_idx variable
@@ -1077,6 +1153,11 @@ int ubifs_replay_journal(struct ubifs_info *c)
 	dbg_mnt("finished, log head LEB %d:%d, max_sqnum %llu, "
 		"highest_inum %lu", c->lhead_lnum, c->lhead_offs, c->max_sqnum,
 		(unsigned long)c->highest_inum);
+	dbg_mnt("replay took %lld us: log %lld us, buds %lld us, TNC %lld us",
+		ktime_to_us(ktime_sub(t_end, t_log)),
+		ktime_to_us(ktime_sub(t_buds, t_log)),
+		ktime_to_us(ktime_sub(t_tree, t_buds)),
+		ktime_to_us(ktime_sub(t_end, t_tree)));
 out:
 	destroy_replay_tree(c);
 	destroy_bud_list(c);
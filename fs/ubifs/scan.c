@@ -268,14 +268,34 @@ void ubifs_scanned_corruption(const struct ubifs_info *c, int lnum, int offs,
 struct ubifs_scan_leb *ubifs_scan(const struct ubifs_info *c, int lnum,
 				  int offs, void *sbuf, int quiet)
 {
-	void *buf = sbuf + offs;
-	int err, len = c->leb_size - offs;
 	struct ubifs_scan_leb *sleb;
 
 	sleb = ubifs_start_scan(c, lnum, offs, sbuf);
 	if (IS_ERR(sleb))
 		return sleb;
 
+	return ubifs_scan_started(c, sleb, offs, quiet);
+}
+
+/**
+ * ubifs_scan_started - scan a logical eraseblock which has already been read.
+ * @c: UBIFS file-system description object
+ * @sleb: scanning information returned by 'ubifs_start_scan()'
+ * @offs: offset to start at
+ * @quiet: print no messages
+ *
+ * This is the same as 'ubifs_scan()', but the LEB has already been read to
+ * @sleb->buf by 'ubifs_start_scan()'. This allows the read to be done in
+ * advance. @sleb is freed in case of failure.
+ */
+struct ubifs_scan_leb *ubifs_scan_started(const struct ubifs_info *c,
+					  struct ubifs_scan_leb *sleb,
+					  int offs, int quiet)
+{
+	int lnum = sleb->lnum;
+	void *buf = sleb->buf + offs;
+	int err, len = c->leb_size - offs;
+
 	while (len >= 8) {
 		struct ubifs_ch *ch = buf;
 		int node_len, ret;
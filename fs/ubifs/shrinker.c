@@ -39,6 +39,7 @@
  * un-mounts, which is done by the 'ubifs_infos_lock' and 'c->umount_mutex'.
  */
 
+#include <linux/module.h>
 #include "ubifs.h"
 
 /* List of all UBIFS file-system instances */
@@ -57,6 +58,17 @@ DEFINE_SPINLOCK(ubifs_infos_lock);
 /* Global clean znode counter (for all mounted UBIFS instances) */
 atomic_long_t ubifs_clean_zn_cnt;
 
+/*
+ * Maximum number of clean znodes a file-system may keep in the TNC before the
+ * background thread starts freeing the oldest ones (%0 means no limit). Note,
+ * leaf node cache entries belong to znodes and are freed together with them.
+ */
+unsigned long ubifs_max_clean_zn;
+module_param_named(max_clean_znodes, ubifs_max_clean_zn, ulong,
+		   S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(max_clean_znodes, "Maximum count of clean znodes per "
+		 "file-system (0 = no limit)");
+
 /**
  * shrink_tnc - shrink TNC tree.
  * @c: UBIFS file-system description object
@@ -277,6 +289,45 @@ static int kick_a_thread(void)
 	return 0;
 }
 
+/**
+ * ubifs_trim_tnc - enforce the clean znode limit.
+ * @c: UBIFS file-system description object
+ *
+ * This function is called by the background thread when the file-system has
+ * more than %ubifs_max_clean_zn clean znodes. It frees the oldest ones until
+ * the count is 1/8 below the limit, so that it does not have to run again
+ * right away.
+ */
+void ubifs_trim_tnc(struct ubifs_info *c)
+{
+	unsigned long max = ubifs_max_clean_zn;
+	int freed = 0, contention = 0;
+	long nr;
+
+	if (!max)
+		return;
+
+	/* Do not get in the way of un-mount, it frees everything anyway */
+	if (!mutex_trylock(&c->umount_mutex))
+		return;
+	mutex_lock(&c->tnc_mutex);
+
+	nr = atomic_long_read(&c->clean_zn_cnt) - (long)(max - max / 8);
+	if (nr > 0) {
+		freed = shrink_tnc(c, nr, OLD_ZNODE_AGE, &contention);
+		if (freed < nr)
+			freed += shrink_tnc(c, nr - freed, YOUNG_ZNODE_AGE,
+					    &contention);
+		if (freed < nr)
+			freed += shrink_tnc(c, nr - freed, 0, &contention);
+	}
+
+	mutex_unlock(&c->tnc_mutex);
+	mutex_unlock(&c->umount_mutex);
+	dbg_tnc("%d znodes were freed to stay within the limit of %lu",
+		freed, max);
+}
+
 int ubifs_shrinker(struct shrinker *shrink, int nr, gfp_t gfp_mask)
 {
 	int freed, contention = 0;
@@ -433,6 +433,8 @@ static int ubifs_show_options(struct seq_file *s, struct vfsmount *mnt)
 		seq_printf(s, ",bulk_read");
 	else if (c->mount_opts.bulk_read == 1)
 		seq_printf(s, ",no_bulk_read");
+	else if (c->mount_opts.bulk_read == 3)
+		seq_printf(s, ",auto_bulk_read");
 
 	if (c->mount_opts.chk_data_crc == 2)
 		seq_printf(s, ",chk_data_crc");
@@ -913,6 +915,7 @@ static int check_volume_empty(struct ubifs_info *c)
  * Opt_norm_unmount: run a journal commit before un-mounting
  * Opt_bulk_read: enable bulk-reads
  * Opt_no_bulk_read: disable bulk-reads
+ * Opt_auto_bulk_read: bulk-read files which are read sequentially
  * Opt_chk_data_crc: check CRCs when reading data nodes
  * Opt_no_chk_data_crc: do not check CRCs when reading data nodes
  * Opt_override_compr: override default compressor
@@ -923,6 +926,7 @@ enum {
 	Opt_norm_unmount,
 	Opt_bulk_read,
 	Opt_no_bulk_read,
+	Opt_auto_bulk_read,
 	Opt_chk_data_crc,
 	Opt_no_chk_data_crc,
 	Opt_override_compr,
@@ -934,6 +938,7 @@ static const match_table_t tokens = {
 	{Opt_norm_unmount, "norm_unmount"},
 	{Opt_bulk_read, "bulk_read"},
 	{Opt_no_bulk_read, "no_bulk_read"},
+	{Opt_auto_bulk_read, "auto_bulk_read"},
 	{Opt_chk_data_crc, "chk_data_crc"},
 	{Opt_no_chk_data_crc, "no_chk_data_crc"},
 	{Opt_override_compr, "compr=%s"},
@@ -1001,10 +1006,17 @@ static int ubifs_parse_options(struct ubifs_info *c, char *options,
 		case Opt_bulk_read:
 			c->mount_opts.bulk_read = 2;
 			c->bulk_read = 1;
+			c->auto_bulk_read = 0;
 			break;
 		case Opt_no_bulk_read:
 			c->mount_opts.bulk_read = 1;
 			c->bulk_read = 0;
+			c->auto_bulk_read = 0;
+			break;
+		case Opt_auto_bulk_read:
+			c->mount_opts.bulk_read = 3;
+			c->bulk_read = 0;
+			c->auto_bulk_read = 1;
 			break;
 		case Opt_chk_data_crc:
 			c->mount_opts.chk_data_crc = 2;
@@ -1092,7 +1104,7 @@ static void destroy_journal(struct ubifs_info *c)
  */
 static void bu_init(struct ubifs_info *c)
 {
-	ubifs_assert(c->bulk_read == 1);
+	ubifs_assert(c->bulk_read || c->auto_bulk_read);
 
 	if (c->bu.buf)
 		return; /* Already initialized */
@@ -1110,6 +1122,7 @@ again:
 			   "disabling it", c->max_bu_buf_len);
 		c->mount_opts.bulk_read = 1;
 		c->bulk_read = 0;
+		c->auto_bulk_read = 0;
 		return;
 	}
 }
@@ -1199,7 +1212,7 @@ static int mount_ubifs(struct ubifs_info *c)
 			goto out_free;
 	}
 
-	if (c->bulk_read == 1)
+	if (c->bulk_read || c->auto_bulk_read)
 		bu_init(c);
 
 	/*
@@ -1834,7 +1847,7 @@ static int ubifs_remount_fs(struct super_block *sb, int *flags, char *data)
 		ubifs_remount_ro(c);
 	}
 
-	if (c->bulk_read == 1)
+	if (c->bulk_read || c->auto_bulk_read)
 		bu_init(c);
 	else {
 		dbg_gen("disable bulk-read");
@@ -417,9 +417,11 @@ static int tnc_read_node_nm(struct ubifs_info *c, struct ubifs_zbranch *zbr,
 		/* Read from the leaf node cache */
 		ubifs_assert(zbr->len != 0);
 		memcpy(node, zbr->leaf, zbr->len);
+		c->lnc_hits += 1;
 		return 0;
 	}
 
+	c->lnc_misses += 1;
 	err = ubifs_tnc_read_node(c, zbr, node);
 	if (err)
 		return err;
@@ -540,6 +542,7 @@ static int matches_name(struct ubifs_info *c, struct ubifs_zbranch *zbr,
 
 	/* If possible, match against the dent in the leaf node cache */
 	if (!zbr->leaf) {
+		c->lnc_misses += 1;
 		dent = kmalloc(zbr->len, GFP_NOFS);
 		if (!dent)
 			return -ENOMEM;
@@ -552,8 +555,10 @@ static int matches_name(struct ubifs_info *c, struct ubifs_zbranch *zbr,
 		err = lnc_add_directly(c, zbr, dent);
 		if (err)
 			goto out_free;
-	} else
+	} else {
+		c->lnc_hits += 1;
 		dent = zbr->leaf;
+	}
 
 	nlen = le16_to_cpu(dent->nlen);
 	err = memcmp(dent->name, nm->name, min_t(int, nlen, nm->len));
@@ -828,6 +833,7 @@ static int fallible_matches_name(struct ubifs_info *c,
 
 	/* If possible, match against the dent in the leaf node cache */
 	if (!zbr->leaf) {
+		c->lnc_misses += 1;
 		dent = kmalloc(zbr->len, GFP_NOFS);
 		if (!dent)
 			return -ENOMEM;
@@ -845,8 +851,10 @@ static int fallible_matches_name(struct ubifs_info *c,
 		err = lnc_add_directly(c, zbr, dent);
 		if (err)
 			goto out_free;
-	} else
+	} else {
+		c->lnc_hits += 1;
 		dent = zbr->leaf;
+	}
 
 	nlen = le16_to_cpu(dent->nlen);
 	err = memcmp(dent->name, nm->name, min_t(int, nlen, nm->len));
@@ -1201,6 +1209,7 @@ int ubifs_lookup_level0(struct ubifs_info *c, const union ubifs_key *key,
 		zbr = &znode->zbranch[*n];
 
 		if (zbr->znode) {
+			c->zn_hits += 1;
 			znode->time = time;
 			znode = zbr->znode;
 			continue;
@@ -1340,6 +1349,7 @@ static int lookup_level0_dirty(struct ubifs_info *c, const union ubifs_key *key,
 		zbr = &znode->zbranch[*n];
 
 		if (zbr->znode) {
+			c->zn_hits += 1;
 			znode->time = time;
 			znode = dirty_cow_znode(c, zbr);
 			if (IS_ERR(znode))
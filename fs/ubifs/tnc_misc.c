@@ -432,12 +432,23 @@ struct ubifs_znode *ubifs_load_znode(struct ubifs_info *c,
 	 * one is only used in shrinker.
 	 */
 	atomic_long_inc(&ubifs_clean_zn_cnt);
+	c->zn_misses += 1;
 
 	zbr->znode = znode;
 	znode->parent = parent;
 	znode->time = get_seconds();
 	znode->iip = iip;
 
+	/*
+	 * The znodes on the current lookup path are in use, so leave freeing
+	 * of the excess to the background thread.
+	 */
+	if (ubifs_max_clean_zn &&
+	    atomic_long_read(&c->clean_zn_cnt) > ubifs_max_clean_zn) {
+		c->need_tnc_trim = 1;
+		ubifs_wake_up_bgt(c);
+	}
+
 	return znode;
 
 out:
@@ -100,6 +100,12 @@
 #define WBUF_TIMEOUT_SOFTLIMIT 3
 #define WBUF_TIMEOUT_HARDLIMIT 5
 
+/*
+ * Background garbage collection starts after this many seconds without
+ * budgeting requests
+ */
+#define BG_GC_IDLE_TIMEOUT 5
+
 /* Maximum possible inode number (only 32-bit inodes are supported now) */
 #define MAX_INUM 0xFFFFFFFF
 
@@ -151,12 +157,27 @@
  */
 #define WORST_COMPR_FACTOR 2
 
+/*
+ * When %UBIFS_INCOMPR_TRIALS data blocks of an inode in a row do not compress,
+ * the data is most probably compressed already, so the next
+ * %UBIFS_INCOMPR_SKIP blocks are written without trying, and then compression
+ * is tried again.
+ */
+#define UBIFS_INCOMPR_TRIALS 4
+#define UBIFS_INCOMPR_SKIP 64
+
 /* Maximum expected tree height for use by bottom_up_buf */
 #define BOTTOM_UP_HEIGHT 64
 
 /* Maximum number of data nodes to bulk-read */
 #define UBIFS_MAX_BULK_READ 32
 
+/*
+ * Minimum VFS read-ahead window (in pages) at which adaptive bulk-read
+ * considers a file to be read sequentially
+ */
+#define UBIFS_BULK_READ_RA_PAGES 8
+
 /*
  * Lockdep classes for UBIFS inode @ui_mutex.
  */
@@ -353,7 +374,10 @@ struct ubifs_gced_idx_leb {
  *                 inodes
  * @ui_size: inode size used by UBIFS when writing to flash
  * @flags: inode flags (@UBIFS_COMPR_FL, etc)
- * @compr_type: default compression type used for this inode
+ * @compr_type: default compression type used for this inode (for directories,
+ *              the type inherited by new inodes, if not %UBIFS_COMPR_NONE)
+ * @compr_fails: count of consecutive data blocks which did not compress
+ * @compr_skip: count of data blocks to write without trying to compress them
  * @last_page_read: page number of last page read (for bulk read)
  * @read_in_a_row: number of consecutive pages read in a row (for bulk read)
  * @data_len: length of the data attached to the inode
@@ -404,6 +428,8 @@ struct ubifs_inode {
 	loff_t synced_i_size;
 	loff_t ui_size;
 	int flags;
+	unsigned int compr_fails;
+	unsigned int compr_skip;
 	pgoff_t last_page_read;
 	pgoff_t read_in_a_row;
 	int data_len;
@@ -912,7 +938,8 @@ struct ubifs_orphan {
 /**
  * struct ubifs_mount_opts - UBIFS-specific mount options information.
  * @unmount_mode: selected unmount mode (%0 default, %1 normal, %2 fast)
- * @bulk_read: enable/disable bulk-reads (%0 default, %1 disabe, %2 enable)
+ * @bulk_read: enable/disable bulk-reads (%0 default, %1 disabe, %2 enable,
+ *             %3 adaptive)
  * @chk_data_crc: enable/disable CRC data checking when reading data nodes
  *                (%0 default, %1 disabe, %2 enable)
  * @override_compr: override default compressor (%0 - do not override and use
@@ -975,14 +1002,19 @@ struct ubifs_debug_info;
  * @no_chk_data_crc: do not check CRCs when reading data nodes (except during
  *                   recovery)
  * @bulk_read: enable bulk-reads
+ * @auto_bulk_read: enable bulk-reads for files the VFS reads sequentially
  * @default_compr: default compression algorithm (%UBIFS_COMPR_LZO, etc)
  * @rw_incompat: the media is not R/W compatible
  *
- * @tnc_mutex: protects the Tree Node Cache (TNC), @zroot, @cnext, @enext, and
- *             @calc_idx_sz
+ * @tnc_mutex: protects the Tree Node Cache (TNC), @zroot, @cnext, @enext,
+ *             @calc_idx_sz and the TNC statistics below
  * @zroot: zbranch which points to the root index node and znode
  * @cnext: next znode to commit
  * @enext: next znode to commit to empty space
+ * @zn_hits: how many times a looked up znode was found in the TNC
+ * @zn_misses: how many times a looked up znode had to be read from the media
+ * @lnc_hits: how many times a node was found in the leaf node cache
+ * @lnc_misses: how many times a node had to be read to the leaf node cache
  * @gap_lebs: array of LEBs used by the in-gaps commit method
  * @cbuf: commit buffer
  * @ileb_buf: buffer for commit in-the-gaps method
@@ -1100,6 +1132,8 @@ struct ubifs_debug_info;
  * @bgt: UBIFS background thread
  * @bgt_name: background thread name
  * @need_bgt: if background thread should run
+ * @need_tnc_trim: if background thread should free clean znodes because there
+ *                 are more than %ubifs_max_clean_zn of them
  * @need_wbuf_sync: if write-buffers have to be synchronized
  *
  * @gc_lnum: LEB number used for garbage collection
@@ -1108,6 +1142,16 @@ struct ubifs_debug_info;
  * @idx_gc_cnt: number of elements on the idx_gc list
  * @gc_seq: incremented for every non-index LEB garbage collected
  * @gced_lnum: last non-index LEB that was garbage collected
+ * @last_budget: time (in jiffies) of the last budgeting request, used by
+ *               background GC to detect idle periods
+ * @bg_gc_dirty: total dirty space when background GC last failed to free an
+ *               LEB
+ * @bg_gc_runs: how many times background GC invoked the garbage collector
+ * @bg_gc_freed: how many LEBs were freed by background GC
+ * @bg_gc_commits: how many commits background GC had to run
+ * @bg_gc_fails: how many times background GC could not free an LEB
+ * @fg_gc_freed: how many LEBs budgeting had to free by GC (protected by
+ *               @space_lock)
  *
  * @infos_list: links all 'ubifs_info' objects
  * @umount_mutex: serializes shrinker and un-mount
@@ -1223,6 +1267,7 @@ struct ubifs_info {
 	unsigned int big_lpt:1;
 	unsigned int no_chk_data_crc:1;
 	unsigned int bulk_read:1;
+	unsigned int auto_bulk_read:1;
 	unsigned int default_compr:2;
 	unsigned int rw_incompat:1;
 
@@ -1230,6 +1275,10 @@ struct ubifs_info {
 	struct ubifs_zbranch zroot;
 	struct ubifs_znode *cnext;
 	struct ubifs_znode *enext;
+	unsigned long zn_hits;
+	unsigned long zn_misses;
+	unsigned long lnc_hits;
+	unsigned long lnc_misses;
 	int *gap_lebs;
 	void *cbuf;
 	void *ileb_buf;
@@ -1336,6 +1385,7 @@ struct ubifs_info {
 	struct task_struct *bgt;
 	char bgt_name[sizeof(BGT_NAME_PATTERN) + 9];
 	int need_bgt;
+	int need_tnc_trim;
 	int need_wbuf_sync;
 
 	int gc_lnum;
@@ -1344,6 +1394,13 @@ struct ubifs_info {
 	int idx_gc_cnt;
 	int gc_seq;
 	int gced_lnum;
+	unsigned long last_budget;
+	long long bg_gc_dirty;
+	unsigned long bg_gc_runs;
+	unsigned long bg_gc_freed;
+	unsigned long bg_gc_commits;
+	unsigned long bg_gc_fails;
+	unsigned long fg_gc_freed;
 
 	struct list_head infos_list;
 	struct mutex umount_mutex;
@@ -1425,6 +1482,8 @@ struct ubifs_info {
 extern struct list_head ubifs_infos;
 extern spinlock_t ubifs_infos_lock;
 extern atomic_long_t ubifs_clean_zn_cnt;
+extern unsigned long ubifs_max_clean_zn;
+extern unsigned int ubifs_bg_gc_lebs;
 extern struct kmem_cache *ubifs_inode_slab;
 extern const struct super_operations ubifs_super_operations;
 extern const struct address_space_operations ubifs_file_address_operations;
@@ -1462,6 +1521,9 @@ int ubifs_sync_wbufs_by_inode(struct ubifs_info *c, struct inode *inode);
 /* scan.c */
 struct ubifs_scan_leb *ubifs_scan(const struct ubifs_info *c, int lnum,
 				  int offs, void *sbuf, int quiet);
+struct ubifs_scan_leb *ubifs_scan_started(const struct ubifs_info *c,
+					  struct ubifs_scan_leb *sleb,
+					  int offs, int quiet);
 void ubifs_scan_destroy(struct ubifs_scan_leb *sleb);
 int ubifs_scan_a_node(const struct ubifs_info *c, void *buf, int len, int lnum,
 		      int offs, int quiet);
@@ -1587,6 +1649,7 @@ int ubifs_tnc_end_commit(struct ubifs_info *c);
 
 /* shrinker.c */
 int ubifs_shrinker(struct shrinker *shrink, int nr_to_scan, gfp_t gfp_mask);
+void ubifs_trim_tnc(struct ubifs_info *c);
 
 /* commit.c */
 int ubifs_bg_thread(void *info);
@@ -1618,6 +1681,8 @@ int ubifs_gc_end_commit(struct ubifs_info *c);
 void ubifs_destroy_idx_gc(struct ubifs_info *c);
 int ubifs_get_idx_gc_leb(struct ubifs_info *c);
 int ubifs_garbage_collect_leb(struct ubifs_info *c, struct ubifs_lprops *lp);
+int ubifs_bg_gc_wanted(struct ubifs_info *c);
+int ubifs_bg_gc(struct ubifs_info *c);
 
 /* orphan.c */
 int ubifs_add_orphan(struct ubifs_info *c, ino_t inum);
@@ -1714,6 +1779,9 @@ int ubifs_recover_master_node(struct ubifs_info *c);
 int ubifs_write_rcvrd_mst_node(struct ubifs_info *c);
 struct ubifs_scan_leb *ubifs_recover_leb(struct ubifs_info *c, int lnum,
 					 int offs, void *sbuf, int grouped);
+struct ubifs_scan_leb *ubifs_recover_started(struct ubifs_info *c,
+					     struct ubifs_scan_leb *sleb,
+					     int offs, int grouped);
 struct ubifs_scan_leb *ubifs_recover_log_leb(struct ubifs_info *c, int lnum,
 					     int offs, void *sbuf);
 int ubifs_recover_inl_heads(const struct ubifs_info *c, void *sbuf);
@@ -0,0 +1,88 @@
+#ifndef BLK_MQ_H
+#define BLK_MQ_H
+
+#include <linux/blkdev.h>
+
+/*
+ * A hardware dispatch queue.  Each CPU has a software submission queue
+ * (struct blk_mq_ctx) mapped onto one of these; bios become tagged
+ * requests on the submitting CPU's software queue, and running the
+ * hardware queue hands everything pending to the driver's ->queue_rq().
+ * Runs of one hardware queue are serialised by BLK_MQ_S_RUNNING, so
+ * ->queue_rq() never sees the same hctx concurrently.
+ */
+struct blk_mq_hw_ctx {
+	spinlock_t		lock;		/* protects dispatch */
+	struct list_head	dispatch;	/* requests bounced by the driver */
+	unsigned long		state;		/* BLK_MQ_S_* flags */
+	struct work_struct	run_work;
+
+	struct request_queue	*queue;
+	void			*driver_data;
+	unsigned int		queue_num;
+
+	unsigned int		nr_ctx;
+	struct blk_mq_ctx	**ctxs;
+	unsigned long		*ctx_map;	/* software queues with work */
+
+	unsigned int		queue_depth;
+	unsigned long		*tag_map;
+	struct request		*rqs;		/* one request per tag */
+	wait_queue_head_t	tag_wait;
+
+	unsigned long		queued;
+	unsigned long		run;
+};
+
+typedef int (queue_rq_fn)(struct blk_mq_hw_ctx *, struct request *);
+typedef int (init_hctx_fn)(struct blk_mq_hw_ctx *, void *, unsigned int);
+typedef void (exit_hctx_fn)(struct blk_mq_hw_ctx *, unsigned int);
+
+struct blk_mq_ops {
+	/*
+	 * Queue a new request to the hardware.  Called without sleeping;
+	 * returns one of the BLK_MQ_RQ_QUEUE_* values.
+	 */
+	queue_rq_fn		*queue_rq;
+
+	/*
+	 * Called on completion from the BLOCK_SOFTIRQ of the submitting
+	 * CPU; defaults to blk_mq_end_io(rq, rq->errors).
+	 */
+	softirq_done_fn		*complete;
+
+	init_hctx_fn		*init_hctx;
+	exit_hctx_fn		*exit_hctx;
+};
+
+struct blk_mq_reg {
+	struct blk_mq_ops	*ops;
+	unsigned int		nr_hw_queues;
+	unsigned int		queue_depth;	/* tags per hardware queue */
+	int			numa_node;
+};
+
+enum {
+	BLK_MQ_RQ_QUEUE_OK	= 0,	/* queued fine */
+	BLK_MQ_RQ_QUEUE_BUSY	= 1,	/* out of resources, stop the queue */
+	BLK_MQ_RQ_QUEUE_ERROR	= 2,	/* end the request with -EIO */
+
+	BLK_MQ_S_STOPPED	= 0,
+	BLK_MQ_S_RUNNING	= 1,
+
+	BLK_MQ_MAX_DEPTH	= 2048,
+};
+
+extern struct request_queue *blk_mq_init_queue(struct blk_mq_reg *, void *);
+extern void blk_mq_run_hw_queue(struct blk_mq_hw_ctx *, bool);
+extern void blk_mq_run_queues(struct request_queue *, bool);
+extern void blk_mq_stop_hw_queue(struct blk_mq_hw_ctx *);
+extern void blk_mq_start_stopped_hw_queue(struct blk_mq_hw_ctx *);
+extern void blk_mq_complete_request(struct request *);
+extern void blk_mq_end_io(struct request *, int);
+
+#define queue_for_each_hw_ctx(q, hctx, i)				\
+	for ((i) = 0; (i) < (q)->nr_hw_queues &&			\
+	     ({ hctx = (q)->queue_hw_ctx[i]; 1; }); (i)++)
+
+#endif
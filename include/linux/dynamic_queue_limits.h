@@ -0,0 +1,82 @@
+#ifndef _LINUX_DQL_H
+#define _LINUX_DQL_H
+
+/*
+ * Dynamic queue limits (DQL)
+ *
+ * Limits the number of objects (bytes, packets, ...) outstanding in a
+ * queue that is consumed asynchronously, typically a NIC transmit ring.
+ * The limit is sized dynamically so that the queue never starves while
+ * holding as little excess data as possible.
+ *
+ * The producer calls dql_queued() for each batch it adds to the queue
+ * and stops queuing while dql_avail() is negative.  The consumer calls
+ * dql_completed() from its completion routine with the number of
+ * objects it has consumed; the limit is recalculated there.
+ *
+ * dql_queued() and dql_completed() may run concurrently on different
+ * CPUs, but each of them must be serialized against itself.
+ *
+ * For more documentation see lib/dynamic_queue_limits.c
+ */
+
+#ifdef __KERNEL__
+
+#include <linux/cache.h>
+#include <linux/bug.h>
+
+struct dql {
+	/* Fields accessed in enqueue path (dql_queued) */
+	unsigned int	num_queued;		/* Total ever queued */
+	unsigned int	adj_limit;		/* limit + num_completed */
+	unsigned int	last_obj_cnt;		/* Count at last queuing */
+
+	/* Fields accessed only by completion path (dql_completed) */
+	unsigned int	limit ____cacheline_aligned_in_smp; /* Current limit */
+	unsigned int	num_completed;		/* Total ever completed */
+	unsigned int	prev_ovlimit;		/* Previous over limit */
+	unsigned int	prev_num_queued;	/* Previous queue total */
+	unsigned int	prev_last_obj_cnt;	/* Previous queuing cnt */
+	unsigned int	lowest_slack;		/* Lowest slack found */
+	unsigned long	slack_start_time;	/* Time slacks seen */
+
+	/* Configuration */
+	unsigned int	max_limit;		/* Max limit */
+	unsigned int	min_limit;		/* Minimum limit */
+	unsigned int	slack_hold_time;	/* Time to measure slack */
+};
+
+/* Set some static maximums */
+#define DQL_MAX_OBJECT (UINT_MAX / 16)
+#define DQL_MAX_LIMIT ((UINT_MAX / 2) - DQL_MAX_OBJECT)
+
+/*
+ * Record number of objects queued.  Assumes that caller has already
+ * checked availability in the queue with dql_avail.
+ */
+static inline void dql_queued(struct dql *dql, unsigned int count)
+{
+	BUG_ON(count > DQL_MAX_OBJECT);
+
+	dql->num_queued += count;
+	dql->last_obj_cnt = count;
+}
+
+/* Returns how many objects can be queued, < 0 indicates over limit. */
+static inline int dql_avail(const struct dql *dql)
+{
+	return ACCESS_ONCE(dql->adj_limit) - ACCESS_ONCE(dql->num_queued);
+}
+
+/* Record number of completed objects and recalculate the limit. */
+extern void dql_completed(struct dql *dql, unsigned int count);
+
+/* Reset dql state */
+extern void dql_reset(struct dql *dql);
+
+/* Initialize dql state */
+extern int dql_init(struct dql *dql, unsigned hold_time);
+
+#endif /* __KERNEL__ */
+
+#endif /* _LINUX_DQL_H */
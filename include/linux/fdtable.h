@@ -10,6 +10,7 @@
 #include <linux/spinlock.h>
 #include <linux/rcupdate.h>
 #include <linux/types.h>
+#include <linux/bitops.h>
 #include <linux/init.h>
 #include <linux/fs.h>
 
@@ -53,6 +54,8 @@ struct files_struct {
    */
 	spinlock_t file_lock ____cacheline_aligned_in_smp;
 	int next_fd;
+	atomic_t nolock_users;		/* lockless alloc_fd()/fd_install() */
+	int resizing;			/* expand_fdtable() is copying fdt */
 	struct embedded_fd_set close_on_exec_init;
 	struct embedded_fd_set open_fds_init;
 	struct file __rcu * fd_array[NR_OPEN_DEFAULT];
@@ -68,6 +71,57 @@ struct files_struct {
 #define files_fdtable(files) \
 		(rcu_dereference_check_fdtable((files), (files)->fdt))
 
+/*
+ * open_fds and close_on_exec are also updated outside file_lock by the
+ * alloc_fd() and fd_install() fast paths, so every writer of a shared
+ * table has to use atomic bitops on them.
+ */
+static inline void fdt_set_open(unsigned int fd, struct fdtable *fdt)
+{
+	set_bit(fd, fdt->open_fds->fds_bits);
+}
+
+static inline void fdt_clear_open(unsigned int fd, struct fdtable *fdt)
+{
+	clear_bit(fd, fdt->open_fds->fds_bits);
+}
+
+static inline void fdt_set_cloexec(unsigned int fd, struct fdtable *fdt)
+{
+	set_bit(fd, fdt->close_on_exec->fds_bits);
+}
+
+static inline void fdt_clear_cloexec(unsigned int fd, struct fdtable *fdt)
+{
+	clear_bit(fd, fdt->close_on_exec->fds_bits);
+}
+
+/*
+ * Lockless users of a shared table bracket their access with these;
+ * expand_fdtable() raises ->resizing and waits for them to drain before
+ * it copies the bitmaps and the fd array, so nothing they set is lost.
+ */
+static inline bool files_nolock_begin(struct files_struct *files)
+{
+	preempt_disable();
+	atomic_inc(&files->nolock_users);
+	smp_mb__after_atomic_inc();
+	if (likely(!ACCESS_ONCE(files->resizing))) {
+		smp_rmb();
+		return true;
+	}
+	atomic_dec(&files->nolock_users);
+	preempt_enable();
+	return false;
+}
+
+static inline void files_nolock_end(struct files_struct *files)
+{
+	smp_mb__before_atomic_dec();
+	atomic_dec(&files->nolock_users);
+	preempt_enable();
+}
+
 struct file_operations;
 struct vfsmount;
 struct dentry;
@@ -650,6 +650,7 @@ struct address_space {
 	struct list_head	private_list;	/* ditto */
 	struct address_space	*assoc_mapping;	/* ditto */
 	struct mutex		unmap_mutex;    /* to protect unmapping */
+	atomic_t		ra_wasted;	/* readahead windows evicted unused */
 } __attribute__((aligned(sizeof(long))));
 	/*
 	 * On most architectures that alignment is already the case; but
@@ -921,6 +922,8 @@ struct file_ra_state {
 
 	unsigned int ra_pages;		/* Maximum readahead window */
 	unsigned int mmap_miss;		/* Cache miss stat for mmap accesses */
+	unsigned int ra_wasted;		/* mapping->ra_wasted last seen */
+	unsigned int ra_shift;		/* window is capped to ra_pages >> this */
 	loff_t prev_pos;		/* Cache last read() position */
 };
 
@@ -972,6 +975,8 @@ struct file {
 	/* Used by fs/eventpoll.c to link all the hooks to this file */
 	struct list_head	f_ep_links;
 #endif /* #ifdef CONFIG_EPOLL */
+	/* Used by fs/select.c to link persistent poll set entries */
+	struct list_head	f_poll_cache_links;
 	struct address_space	*f_mapping;
 #ifdef CONFIG_DEBUG_WRITECOUNT
 	unsigned long f_mnt_write_state;
@@ -1356,6 +1361,12 @@ extern int send_sigurg(struct fown_struct *fown);
 extern struct list_head super_blocks;
 extern spinlock_t sb_lock;
 
+/* Path walk statistics, see /proc/fs/pathwalk */
+struct sb_walk_stats {
+	unsigned long		rcu;	/* lookups finished in rcu-walk */
+	unsigned long		ref;	/* drops from rcu-walk to ref-walk */
+};
+
 struct super_block {
 	struct list_head	s_list;		/* Keep this first */
 	dev_t			s_dev;		/* search index; _not_ kdev_t */
@@ -1384,8 +1395,10 @@ struct super_block {
 	struct hlist_bl_head	s_anon;		/* anonymous dentries for (nfs) exporting */
 #ifdef CONFIG_SMP
 	struct list_head __percpu *s_files;
+	struct sb_walk_stats __percpu *s_walk_stats;
 #else
 	struct list_head	s_files;
+	struct sb_walk_stats	s_walk_stats;
 #endif
 	/* s_dentry_lru, s_nr_dentry_unused protected by dcache.c lru locks */
 	struct list_head	s_dentry_lru;	/* unused dentry lru */
@@ -152,6 +152,11 @@ struct fscache_retrieval {
 	unsigned long		start_time;	/* time at which retrieval started */
 };
 
+/*
+ * maximum number of pages passed to a cache's write_pages() at once
+ */
+#define FSCACHE_STORE_BATCH	16
+
 typedef int (*fscache_page_retrieval_func_t)(struct fscache_retrieval *op,
 					     struct page *page,
 					     gfp_t gfp);
@@ -275,6 +280,11 @@ struct fscache_cache_ops {
 	/* write a page to its backing block in the cache */
 	int (*write_page)(struct fscache_storage *op, struct page *page);
 
+	/* write a run of up to FSCACHE_STORE_BATCH pages with consecutive
+	 * indices to the cache (optional; write_page is used if absent) */
+	int (*write_pages)(struct fscache_storage *op,
+			   struct page **pages, unsigned nr_pages);
+
 	/* detach backing block from a page (optional)
 	 * - must release the cookie lock before returning
 	 * - may sleep
@@ -286,6 +296,18 @@ struct fscache_cache_ops {
 	void (*dissociate_pages)(struct fscache_cache *cache);
 };
 
+/*
+ * per-cookie retrieval and storage statistics
+ */
+struct fscache_cookie_stats {
+	atomic_t		read_hits;	/* pages read from the cache */
+	atomic_t		read_misses;	/* pages allotted space but not read */
+	atomic_t		read_nobufs;	/* pages the cache couldn't take */
+	atomic_t		stores;		/* pages sent to the cache to store */
+	atomic_t		read_ops;	/* completed retrieval ops */
+	atomic_long_t		read_jif;	/* jiffies spent in retrieval ops */
+};
+
 /*
  * data file or index object cookie
  * - a file will only appear in one cache
@@ -305,6 +327,9 @@ struct fscache_cookie {
 	struct radix_tree_root		stores;		/* pages to be stored on this cookie */
 #define FSCACHE_COOKIE_PENDING_TAG	0		/* pages tag: pending write to cache */
 #define FSCACHE_COOKIE_STORING_TAG	1		/* pages tag: writing to cache */
+#ifdef CONFIG_FSCACHE_STATS
+	struct fscache_cookie_stats	stats;
+#endif
 
 	unsigned long			flags;
 #define FSCACHE_COOKIE_LOOKING_UP	0	/* T if non-index cookie being looked up still */
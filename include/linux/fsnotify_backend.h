@@ -131,6 +131,7 @@ struct fsnotify_group {
 	wait_queue_head_t notification_waitq;	/* read() on the notification file blocks on this waitq */
 	unsigned int q_len;			/* events on the queue */
 	unsigned int max_events;		/* maximum events allowed on the list */
+	struct hlist_head *notification_hash;	/* optional: queued events by inode and name */
 	/*
 	 * Valid fsnotify group priorities.  Events are send in order from highest
 	 * priority to lowest priority.  We default to the lowest priority.
@@ -189,6 +190,7 @@ struct fsnotify_group {
 struct fsnotify_event_holder {
 	struct fsnotify_event *event;
 	struct list_head event_list;
+	struct hlist_node hash_node;	/* group->notification_hash, if the group has one */
 };
 
 /*
@@ -377,13 +379,22 @@ extern struct fsnotify_event *fsnotify_add_notify_event(struct fsnotify_group *g
 							struct fsnotify_event *event,
 							struct fsnotify_event_private_data *priv,
 							struct fsnotify_event *(*merge)(struct list_head *,
-											struct fsnotify_event *));
+											struct fsnotify_event *,
+											struct fsnotify_event_private_data *));
+/* give the group a hash of its queued events so merge can look past the tail */
+extern int fsnotify_alloc_notify_hash(struct fsnotify_group *group);
+/* newest queued event about the same inode and name as event, or NULL */
+extern struct fsnotify_event_holder *fsnotify_find_queued_event(struct fsnotify_group *group,
+								 struct fsnotify_event *event);
 /* true if the group notification queue is empty */
 extern bool fsnotify_notify_queue_is_empty(struct fsnotify_group *group);
 /* return, but do not dequeue the first event on the notification queue */
 extern struct fsnotify_event *fsnotify_peek_notify_event(struct fsnotify_group *group);
 /* return AND dequeue the first event on the notification queue */
 extern struct fsnotify_event *fsnotify_remove_notify_event(struct fsnotify_group *group);
+/* put a dequeued event back at the head of the notification queue */
+extern int fsnotify_requeue_notify_event(struct fsnotify_group *group,
+					 struct fsnotify_event *event);
 
 /* functions used to manipulate the marks attached to inodes */
 
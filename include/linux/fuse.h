@@ -47,12 +47,14 @@
  *  - FUSE_IOCTL_UNRESTRICTED shall now return with array of 'struct
  *    fuse_ioctl_iovec' instead of ambiguous 'struct iovec'
  *  - add FUSE_IOCTL_32BIT flag
+ *  - add FUSE_DEV_IOC_CLONE ioctl on the fuse device
  */
 
 #ifndef _LINUX_FUSE_H
 #define _LINUX_FUSE_H
 
 #include <linux/types.h>
+#include <linux/ioctl.h>
 
 /*
  * Version negotiation:
@@ -624,4 +626,13 @@ struct fuse_notify_retrieve_in {
 	__u64	dummy4;
 };
 
+/**
+ * Device ioctls
+ *
+ * FUSE_DEV_IOC_CLONE: attach the fuse device file this is issued on to
+ * the connection of the already mounted fuse device file whose
+ * descriptor is passed in.  The new file gets its own request queue.
+ */
+#define FUSE_DEV_IOC_CLONE	_IOR(229, 0, __u32)
+
 #endif /* _LINUX_FUSE_H */
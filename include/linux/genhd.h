@@ -79,6 +79,25 @@ struct partition {
 	__le32 nr_sects;		/* nr of sectors in partition */
 } __attribute__((packed));
 
+/*
+ * Completion latency histogram: bucket 0 counts I/Os that took less
+ * than 1us, bucket i those that took [2^(i-1), 2^i) us and the last
+ * bucket everything slower.
+ */
+#define DISK_LAT_BUCKETS	24
+
+enum {
+	DISK_LAT_READ = 0,		/* same as READ */
+	DISK_LAT_WRITE,			/* same as WRITE */
+	DISK_LAT_DISCARD,
+	DISK_LAT_NR
+};
+
+static inline int disk_lat_bucket(unsigned long usecs)
+{
+	return min_t(int, fls_long(usecs), DISK_LAT_BUCKETS - 1);
+}
+
 struct disk_stats {
 	unsigned long sectors[2];	/* READs and WRITEs */
 	unsigned long ios[2];
@@ -86,6 +105,7 @@ struct disk_stats {
 	unsigned long ticks[2];
 	unsigned long io_ticks;
 	unsigned long time_in_queue;
+	unsigned long lat_hist[DISK_LAT_NR][DISK_LAT_BUCKETS];
 };
 
 #define PARTITION_META_INFO_VOLNAMELTH	64
@@ -616,6 +636,8 @@ extern void blk_unregister_region(dev_t devt, unsigned long range);
 
 extern ssize_t part_size_show(struct device *dev,
 			      struct device_attribute *attr, char *buf);
+extern ssize_t part_latency_hist_show(struct device *dev,
+				      struct device_attribute *attr, char *buf);
 extern ssize_t part_stat_show(struct device *dev,
 			      struct device_attribute *attr, char *buf);
 extern ssize_t part_inflight_show(struct device *dev,
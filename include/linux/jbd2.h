@@ -657,9 +657,18 @@ struct transaction_run_stats_s {
 	__u32			rs_blocks_logged;
 };
 
+/*
+ * Latency histograms: bucket 0 counts times below 64us, bucket i times
+ * in [32us << i, 64us << i), and the last bucket everything longer.
+ */
+#define JBD2_HIST_BUCKETS	16
+#define JBD2_HIST_SHIFT		6	/* log2 of bucket 0's limit in us */
+
 struct transaction_stats_s {
 	unsigned long		ts_tid;
 	struct transaction_run_stats_s run;
+	unsigned long		ts_commit_hist[JBD2_HIST_BUCKETS];
+	unsigned long		ts_wait_hist[JBD2_HIST_BUCKETS];
 };
 
 static inline unsigned long
@@ -1209,6 +1218,8 @@ int jbd2_log_do_checkpoint(journal_t *journal);
 
 void __jbd2_log_wait_for_space(journal_t *journal);
 extern void __jbd2_journal_drop_transaction(journal_t *, transaction_t *);
+extern void jbd2_hist_account(journal_t *journal, unsigned long *hist,
+			      u64 ns);
 extern int jbd2_cleanup_journal_tail(journal_t *);
 
 /* Debugging code only: */
@@ -27,6 +27,18 @@ enum {
 };
 
 struct loop_func_table;
+struct loop_device;
+
+/*
+ * Plain file-backed requests are spread over this many work items on
+ * the kloopd workqueue instead of all going through lo_thread.
+ */
+#define LO_NR_WORKERS	4
+
+struct loop_worker {
+	struct work_struct	work;
+	struct loop_device	*lo;
+};
 
 struct loop_device {
 	int		lo_number;
@@ -62,6 +74,10 @@ struct loop_device {
 	struct task_struct	*lo_thread;
 	wait_queue_head_t	lo_event;
 
+	struct bio_list		lo_wq_list;	/* bios for lo_workers */
+	struct loop_worker	lo_workers[LO_NR_WORKERS];
+	unsigned int		lo_next_worker;
+
 	struct request_queue	*lo_queue;
 	struct gendisk		*lo_disk;
 	struct list_head	lo_list;
@@ -76,6 +92,7 @@ enum {
 	LO_FLAGS_READ_ONLY	= 1,
 	LO_FLAGS_USE_AOPS	= 2,
 	LO_FLAGS_AUTOCLEAR	= 4,
+	LO_FLAGS_DIRECT_IO	= 16,
 };
 
 #include <asm/posix_types.h>	/* for __kernel_old_dev_t */
@@ -160,5 +177,6 @@ int loop_unregister_transfer(int number);
 #define LOOP_GET_STATUS64	0x4C05
 #define LOOP_CHANGE_FD		0x4C06
 #define LOOP_SET_CAPACITY	0x4C07
+#define LOOP_SET_DIRECT_IO	0x4C08
 
 #endif
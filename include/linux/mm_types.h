@@ -183,6 +183,9 @@ struct vm_area_struct {
 #ifdef CONFIG_NUMA
 	struct mempolicy *vm_policy;	/* NUMA policy for the VMA */
 #endif
+#ifdef CONFIG_SWAP
+	atomic_long_t swap_readahead_info; /* see swapin_readahead_vma() */
+#endif
 };
 
 struct core_thread {
@@ -222,7 +225,7 @@ struct mm_rss_stat {
 struct mm_struct {
 	struct vm_area_struct * mmap;		/* list of VMAs */
 	struct rb_root mm_rb;
-	struct vm_area_struct * mmap_cache;	/* last find_vma result */
+	u32 vmacache_seqnum;			/* per-thread vmacache */
 #ifdef CONFIG_MMU
 	unsigned long (*get_unmapped_area) (struct file *filp,
 				unsigned long addr, unsigned long len,
@@ -315,6 +318,15 @@ struct mm_struct {
 #endif
 	/* How many tasks sharing this mm are OOM_DISABLE */
 	atomic_t oom_disable_count;
+#ifdef CONFIG_KSM
+	unsigned long ksm_pages_scanned;	/* pages ksmd has looked at */
+	unsigned long ksm_pages_merged;		/* of those, pages it merged */
+	unsigned long ksm_pages_skipped;	/* passed over as volatile */
+#endif
+#ifdef CONFIG_FUTEX_PRIVATE_HASH
+	/* hash buckets of PROCESS_PRIVATE futexes, set up on first use */
+	struct futex_private_hash *futex_hash;
+#endif
 };
 
 /* Future-safe accessor for struct mm_struct's cpu_vm_mask. */
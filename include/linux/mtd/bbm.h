@@ -28,6 +28,8 @@
 #ifndef __LINUX_MTD_BBM_H
 #define __LINUX_MTD_BBM_H
 
+#include <linux/mutex.h>
+
 /* The maximum number of NAND chips in an array */
 #define NAND_MAX_CHIPS		8
 
@@ -131,6 +133,10 @@ struct nand_bbt_descr {
  * @isbad_bbt:		function to determine if a block is bad
  * @badblock_pattern:	[REPLACEABLE] bad block scan pattern used for
  *			initial bad block scan
+ * @bbt_td:		[REPLACEABLE] bad block table descriptor for flash
+ *			based bad block table
+ * @bbt_md:		[REPLACEABLE] bad block table mirror descriptor
+ * @bbt_mutex:		[INTERN] serializes updates of the flash based table
  * @priv:		[OPTIONAL] pointer to private bbm date
  */
 struct bbm_info {
@@ -144,6 +150,10 @@ struct bbm_info {
 
 	/* TODO Add more NAND specific fileds */
 	struct nand_bbt_descr *badblock_pattern;
+	struct nand_bbt_descr *bbt_td;
+	struct nand_bbt_descr *bbt_md;
+
+	struct mutex bbt_mutex;
 
 	void *priv;
 };
@@ -151,5 +161,6 @@ struct bbm_info {
 /* OneNAND BBT interface */
 extern int onenand_scan_bbt(struct mtd_info *mtd, struct nand_bbt_descr *bd);
 extern int onenand_default_bbt(struct mtd_info *mtd);
+extern int onenand_update_bbt(struct mtd_info *mtd, loff_t offs);
 
 #endif	/* __LINUX_MTD_BBM_H */
@@ -25,6 +25,8 @@
 #include <linux/uio.h>
 #include <linux/notifier.h>
 #include <linux/device.h>
+#include <linux/list.h>
+#include <linux/workqueue.h>
 
 #include <mtd/mtd-abi.h>
 
@@ -110,6 +112,45 @@ struct mtd_oob_ops {
 	uint8_t		*oobbuf;
 };
 
+#define MTD_IO_READ	0
+#define MTD_IO_WRITE	1
+
+/**
+ * struct mtd_io_req - asynchronous I/O request
+ * @rw:		MTD_IO_READ or MTD_IO_WRITE
+ * @ofs:	flash offset to start at
+ * @vecs:	buffers to read into or write from, in flash order
+ * @count:	number of vectors
+ * @callback:	called once the request has been carried out, possibly from
+ *		another thread
+ * @priv:	for use by the submitter
+ *
+ * @retlen:	number of bytes transferred, set on completion
+ * @error:	0 or negative error code (as returned by read/write), set on
+ *		completion
+ *
+ * @mtd:	device the request was submitted to, set by mtd_submit_io()
+ * @drv_data:	for use by the driver the request is queued on
+ * @list:	for use by the driver the request is queued on
+ *
+ * Requests submitted to the same device complete in submission order.
+ */
+struct mtd_io_req {
+	int		rw;
+	loff_t		ofs;
+	struct kvec	*vecs;
+	unsigned long	count;
+	void		(*callback) (struct mtd_io_req *req);
+	void		*priv;
+
+	size_t		retlen;
+	int		error;
+
+	struct mtd_info	*mtd;
+	void		*drv_data;
+	struct list_head list;
+};
+
 #define MTD_MAX_OOBFREE_ENTRIES_LARGE	32
 #define MTD_MAX_ECCPOS_ENTRIES_LARGE	448
 /*
@@ -247,6 +288,12 @@ struct mtd_info {
 	   which contains an (ofs, len) tuple.
 	*/
 	int (*writev) (struct mtd_info *mtd, const struct kvec *vecs, unsigned long count, loff_t to, size_t *retlen);
+	int (*readv) (struct mtd_info *mtd, struct kvec *vecs, unsigned long count, loff_t from, size_t *retlen);
+
+	/* Asynchronous I/O. Returns 0 once the request is queued, after which
+	   the driver completes it with mtd_io_callback(). Use mtd_submit_io(),
+	   which falls back to readv/writev for drivers without this method. */
+	int (*submit_io) (struct mtd_info *mtd, struct mtd_io_req *req);
 
 	/* Sync */
 	void (*sync) (struct mtd_info *mtd);
@@ -348,14 +395,23 @@ int default_mtd_writev(struct mtd_info *mtd, const struct kvec *vecs,
 int default_mtd_readv(struct mtd_info *mtd, struct kvec *vecs,
 		      unsigned long count, loff_t from, size_t *retlen);
 
+int mtd_submit_io(struct mtd_info *mtd, struct mtd_io_req *req);
+void mtd_do_io(struct mtd_info *mtd, struct mtd_io_req *req);
+
 #ifdef CONFIG_MTD_PARTITIONS
 void mtd_erase_callback(struct erase_info *instr);
+void mtd_io_callback(struct mtd_io_req *req);
 #else
 static inline void mtd_erase_callback(struct erase_info *instr)
 {
 	if (instr->callback)
 		instr->callback(instr);
 }
+
+static inline void mtd_io_callback(struct mtd_io_req *req)
+{
+	req->callback(req);
+}
 #endif
 
 /*
@@ -14,6 +14,7 @@
 
 #include <linux/spinlock.h>
 #include <linux/completion.h>
+#include <linux/workqueue.h>
 #include <linux/mtd/flashchip.h>
 #include <linux/mtd/onenand_regs.h>
 #include <linux/mtd/bbm.h>
@@ -77,6 +78,9 @@ struct onenand_bufferram {
  * @wq:			[INTERN] wait queue to sleep on if a OneNAND
  *			operation is in progress
  * @state:		[INTERN] the current state of the OneNAND device
+ * @io_list:		[INTERN] queued asynchronous I/O requests
+ * @io_lock:		[INTERN] spinlock protecting @io_list
+ * @io_work:		[INTERN] work carrying out the queued requests
  * @page_buf:		[INTERN] page main data buffer
  * @oob_buf:		[INTERN] page oob data buffer
  * @subpagesize:	[INTERN] holds the subpagesize
@@ -127,6 +131,11 @@ struct onenand_chip {
 	spinlock_t		chip_lock;
 	wait_queue_head_t	wq;
 	flstate_t		state;
+
+	struct list_head	io_list;
+	spinlock_t		io_lock;
+	struct work_struct	io_work;
+
 	unsigned char		*page_buf;
 	unsigned char		*oob_buf;
 #ifdef CONFIG_MTD_ONENAND_VERIFY_WRITE
@@ -196,6 +205,7 @@ struct onenand_chip {
 #define ONENAND_HAS_4KB_PAGE		(0x0008)
 #define ONENAND_HAS_CACHE_PROGRAM	(0x0010)
 #define ONENAND_SKIP_UNLOCK_CHECK	(0x0100)
+#define ONENAND_USE_FLASH_BBT		(0x0200)
 #define ONENAND_PAGEBUF_ALLOC		(0x1000)
 #define ONENAND_OOBBUF_ALLOC		(0x2000)
 
@@ -220,6 +230,9 @@ struct onenand_manufacturers {
 
 int onenand_bbt_read_oob(struct mtd_info *mtd, loff_t from,
 			 struct mtd_oob_ops *ops);
+int onenand_bbt_erase(struct mtd_info *mtd, loff_t addr);
+int onenand_bbt_write(struct mtd_info *mtd, loff_t to,
+		      struct mtd_oob_ops *ops);
 unsigned onenand_block(struct onenand_chip *this, loff_t addr);
 loff_t onenand_addr(struct onenand_chip *this, int block);
 int flexonenand_region(struct mtd_info *mtd, loff_t addr);
@@ -100,11 +100,39 @@ struct nlmsgerr {
 #define NETLINK_PKTINFO		3
 #define NETLINK_BROADCAST_ERROR	4
 #define NETLINK_NO_ENOBUFS	5
+#define NETLINK_RX_RING		6
 
 struct nl_pktinfo {
 	__u32	group;
 };
 
+struct nl_mmap_req {
+	unsigned int	nm_block_size;
+	unsigned int	nm_block_nr;
+	unsigned int	nm_frame_size;
+	unsigned int	nm_frame_nr;
+};
+
+struct nl_mmap_hdr {
+	unsigned int	nm_status;
+	unsigned int	nm_len;
+	__u32		nm_group;
+	/* credentials */
+	__u32		nm_pid;
+	__u32		nm_uid;
+	__u32		nm_gid;
+};
+
+enum nl_mmap_status {
+	NL_MMAP_STATUS_UNUSED,		/* owned by the kernel */
+	NL_MMAP_STATUS_VALID,		/* message is in the frame */
+	NL_MMAP_STATUS_COPY,		/* message must be read with recvmsg() */
+};
+
+#define NL_MMAP_MSG_ALIGNMENT	NLMSG_ALIGNTO
+#define NL_MMAP_MSG_ALIGN(len)	NLMSG_ALIGN(len)
+#define NL_MMAP_HDRLEN		NL_MMAP_MSG_ALIGN(sizeof(struct nl_mmap_hdr))
+
 #define NET_MAJOR 36		/* Major 36 is reserved for networking 						*/
 
 enum {
@@ -172,6 +172,11 @@ struct nfs_inode {
 	unsigned long		npages;
 	unsigned long		ncommit;
 
+	/* Entry in the server's list of inodes with write requests */
+	struct list_head	write_list;
+	/* When background writeback started holding back a short write */
+	unsigned long		write_gather_start;
+
 	/* Open contexts for shared mmap writes */
 	struct list_head	open_files;
 
@@ -219,6 +224,7 @@ struct nfs_inode {
 #define NFS_INO_FSCACHE		(5)		/* inode can be cached by FS-Cache */
 #define NFS_INO_FSCACHE_LOCK	(6)		/* FS-Cache cookie management lock */
 #define NFS_INO_COMMIT		(7)		/* inode is committing unstable writes */
+#define NFS_INO_GATHER		(8)		/* holding back a short tail write */
 
 static inline struct nfs_inode *NFS_I(const struct inode *inode)
 {
@@ -355,6 +361,7 @@ extern int nfs_open(struct inode *, struct file *);
 extern int nfs_release(struct inode *, struct file *);
 extern int nfs_attribute_timeout(struct inode *inode);
 extern int nfs_revalidate_inode(struct nfs_server *server, struct inode *inode);
+extern int nfs_revalidate_inode_rcu(struct nfs_server *server, struct inode *inode);
 extern int __nfs_revalidate_inode(struct nfs_server *, struct inode *);
 extern int nfs_revalidate_mapping(struct inode *inode, struct address_space *mapping);
 extern int nfs_setattr(struct dentry *, struct iattr *);
@@ -113,6 +113,8 @@ enum nfs_stat_eventcounters {
 	NFSIOS_SHORTREAD,
 	NFSIOS_SHORTWRITE,
 	NFSIOS_DELAY,
+	NFSIOS_WRITEGATHER,
+	NFSIOS_COMMITBATCH,
 	__NFSIOS_COUNTSMAX,
 };
 
@@ -369,6 +369,9 @@ static inline int lock_page_or_retry(struct page *page, struct mm_struct *mm,
  */
 extern void wait_on_page_bit(struct page *page, int bit_nr);
 
+extern int wait_on_page_locked_async(struct page *page,
+				     struct wait_bit_queue *wait);
+
 /* 
  * Wait for a page to be unlocked.
  *
@@ -5,6 +5,9 @@
 
 #define PIPE_DEF_BUFFERS	16
 
+/* Upper bound on the released pages a pipe keeps for reuse */
+#define PIPE_POOL_MAX		8
+
 #define PIPE_BUF_FLAG_LRU	0x01	/* page is on the LRU */
 #define PIPE_BUF_FLAG_ATOMIC	0x02	/* was atomically mapped */
 #define PIPE_BUF_FLAG_GIFT	0x04	/* page is a gift */
@@ -32,7 +35,11 @@ struct pipe_buffer {
  *	@nrbufs: the number of non-empty pipe buffers in this pipe
  *	@buffers: total number of buffers (should be a power of 2)
  *	@curbuf: the current pipe buffer entry
- *	@tmp_page: cached released page
+ *	@nr_pool: number of pages in @pool
+ *	@pool_target: how many released pages to keep, from recent peak usage
+ *	@pool_peak: most buffers in use since the pipe was last empty
+ *	@full_waits: writer sleeps on a full pipe since it was last empty
+ *	@sized: buffer count was set by F_SETPIPE_SZ, don't grow it
  *	@readers: number of current readers of this pipe
  *	@writers: number of current writers of this pipe
  *	@waiting_writers: number of writers blocked waiting for room
@@ -42,6 +49,7 @@ struct pipe_buffer {
  *	@fasync_writers: writer side fasync
  *	@inode: inode this pipe is attached to
  *	@bufs: the circular array of pipe buffers
+ *	@pool: released pages cached for the next writes
  **/
 struct pipe_inode_info {
 	wait_queue_head_t wait;
@@ -51,11 +59,14 @@ struct pipe_inode_info {
 	unsigned int waiting_writers;
 	unsigned int r_counter;
 	unsigned int w_counter;
-	struct page *tmp_page;
+	unsigned int nr_pool, pool_target, pool_peak;
+	unsigned int full_waits;
+	bool sized;
 	struct fasync_struct *fasync_readers;
 	struct fasync_struct *fasync_writers;
 	struct inode *inode;
 	struct pipe_buffer *bufs;
+	struct page *pool[PIPE_POOL_MAX];
 };
 
 /*
@@ -147,6 +158,9 @@ int pipe_proc_fn(struct ctl_table *, int, void __user *, size_t *, loff_t *);
 /* Drop the inode semaphore and wait for a pipe event, atomically */
 void pipe_wait(struct pipe_inode_info *pipe);
 
+/* A writer is about to wait for room in a full pipe */
+void pipe_writer_blocked(struct pipe_inode_info *pipe);
+
 struct pipe_inode_info * alloc_pipe_info(struct inode * inode);
 void free_pipe_info(struct inode * inode);
 void __free_pipe_info(struct pipe_inode_info *);
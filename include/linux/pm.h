@@ -539,6 +539,14 @@ extern void __suspend_report_result(const char *function, void *fn, int ret);
 	} while (0)
 
 extern int device_pm_wait_for_dev(struct device *sub, struct device *dev);
+
+#ifdef CONFIG_PM_SLEEP_TIMING
+extern void dpm_timing_record(const char *name, const char *info, int event,
+			      u64 start, int error);
+#else
+static inline void dpm_timing_record(const char *name, const char *info,
+				     int event, u64 start, int error) {}
+#endif
 #else /* !CONFIG_PM_SLEEP */
 
 #define device_pm_lock() do {} while (0)
@@ -555,6 +563,9 @@ static inline int device_pm_wait_for_dev(struct device *a, struct device *b)
 {
 	return 0;
 }
+
+static inline void dpm_timing_record(const char *name, const char *info,
+				     int event, u64 start, int error) {}
 #endif /* !CONFIG_PM_SLEEP */
 
 /* How to reorder dpm_list after device_move() */
@@ -138,6 +138,22 @@ extern int core_sys_select(int n, fd_set __user *inp, fd_set __user *outp,
 
 extern int poll_select_set_timeout(struct timespec *to, long sec, long nsec);
 
+struct task_struct;
+extern void poll_cache_release(struct task_struct *tsk);
+extern void poll_cache_release_file(struct file *file);
+
+/* Called from __fput() before the file's wait queues can go away */
+static inline void poll_cache_file_release(struct file *file)
+{
+	/*
+	 * No new links can be added once the last reference is gone, so
+	 * the unlocked check is safe, as in eventpoll_release().
+	 */
+	if (likely(list_empty(&file->f_poll_cache_links)))
+		return;
+	poll_cache_release_file(file);
+}
+
 #endif /* KERNEL */
 
 #endif /* _LINUX_POLL_H */
@@ -102,4 +102,14 @@
 
 #define PR_MCE_KILL_GET 34
 
+/* Get/set floating-point "run fast" mode (flush-to-zero, default NaN), if meaningful */
+#define PR_GET_FP_RUNFAST 35
+#define PR_SET_FP_RUNFAST 36
+# define PR_FP_RUNFAST_OFF	0	/* IEEE 754 compliant, subnormals may trap */
+# define PR_FP_RUNFAST_ON	1	/* flush subnormals to zero, default NaN */
+
+/* Get/set whether poll() keeps its wait queue registrations between calls */
+#define PR_GET_POLL_CACHE 37
+#define PR_SET_POLL_CACHE 38
+
 #endif /* _LINUX_PRCTL_H */
@@ -38,6 +38,12 @@ struct res_counter {
 	 * the limit that usage can be exceed
 	 */
 	unsigned long long soft_limit;
+	/*
+	 * background reclaim is started once usage exceeds high_wmark,
+	 * and stops again when usage drops below low_wmark
+	 */
+	unsigned long long high_wmark;
+	unsigned long long low_wmark;
 	/*
 	 * the number of unsuccessful attempts to consume the resource
 	 */
@@ -92,6 +98,8 @@ enum {
 	RES_LIMIT,
 	RES_FAILCNT,
 	RES_SOFT_LIMIT,
+	RES_HIGH_WMARK,
+	RES_LOW_WMARK,
 };
 
 /*
@@ -213,6 +221,28 @@ static inline bool res_counter_check_under_soft_limit(struct res_counter *cnt)
 	return ret;
 }
 
+static inline bool res_counter_check_over_high_wmark(struct res_counter *cnt)
+{
+	bool ret;
+	unsigned long flags;
+
+	spin_lock_irqsave(&cnt->lock, flags);
+	ret = cnt->usage > cnt->high_wmark;
+	spin_unlock_irqrestore(&cnt->lock, flags);
+	return ret;
+}
+
+static inline bool res_counter_check_under_low_wmark(struct res_counter *cnt)
+{
+	bool ret;
+	unsigned long flags;
+
+	spin_lock_irqsave(&cnt->lock, flags);
+	ret = cnt->usage < cnt->low_wmark;
+	spin_unlock_irqrestore(&cnt->lock, flags);
+	return ret;
+}
+
 static inline void res_counter_reset_max(struct res_counter *cnt)
 {
 	unsigned long flags;
@@ -258,4 +288,27 @@ res_counter_set_soft_limit(struct res_counter *cnt,
 	return 0;
 }
 
+/*
+ * Set the high (member == RES_HIGH_WMARK) or low background reclaim
+ * watermark, keeping low_wmark <= high_wmark.
+ */
+static inline int
+res_counter_set_wmark(struct res_counter *cnt, int member,
+		      unsigned long long wmark)
+{
+	unsigned long flags;
+	int ret = -EINVAL;
+
+	spin_lock_irqsave(&cnt->lock, flags);
+	if (member == RES_HIGH_WMARK && wmark >= cnt->low_wmark) {
+		cnt->high_wmark = wmark;
+		ret = 0;
+	} else if (member == RES_LOW_WMARK && wmark <= cnt->high_wmark) {
+		cnt->low_wmark = wmark;
+		ret = 0;
+	}
+	spin_unlock_irqrestore(&cnt->lock, flags);
+	return ret;
+}
+
 #endif
@@ -26,7 +26,7 @@
  */
 struct anon_vma {
 	struct anon_vma *root;	/* Root of this anon_vma tree */
-	spinlock_t lock;	/* Serialize access to vma list */
+	rwlock_t lock;		/* Serialize access to vma list */
 #if defined(CONFIG_KSM) || defined(CONFIG_MIGRATION)
 
 	/*
@@ -48,6 +48,17 @@ struct anon_vma {
 	 * mm_take_all_locks() (mm_all_locks_mutex).
 	 */
 	struct list_head head;	/* Chain of private "related" vmas */
+
+	/*
+	 * Count of child anon_vmas and VMAs which point to this anon_vma.
+	 *
+	 * This counter is used for making decision about reusing anon_vma
+	 * instead of forking new one. See comments in anon_vma_clone().
+	 * Protected by the root anon_vma's lock.
+	 */
+	unsigned degree;
+
+	struct anon_vma *parent;	/* Parent of this anon_vma */
 };
 
 /*
@@ -119,24 +130,39 @@ static inline void vma_lock_anon_vma(struct vm_area_struct *vma)
 {
 	struct anon_vma *anon_vma = vma->anon_vma;
 	if (anon_vma)
-		spin_lock(&anon_vma->root->lock);
+		write_lock(&anon_vma->root->lock);
 }
 
 static inline void vma_unlock_anon_vma(struct vm_area_struct *vma)
 {
 	struct anon_vma *anon_vma = vma->anon_vma;
 	if (anon_vma)
-		spin_unlock(&anon_vma->root->lock);
+		write_unlock(&anon_vma->root->lock);
 }
 
+/*
+ * The root's lock is taken for writing to change the anon_vma tree or
+ * for anything that must exclude rmap walkers (huge page split and
+ * collapse); walking the vma lists only needs it for reading.
+ */
 static inline void anon_vma_lock(struct anon_vma *anon_vma)
 {
-	spin_lock(&anon_vma->root->lock);
+	write_lock(&anon_vma->root->lock);
 }
 
 static inline void anon_vma_unlock(struct anon_vma *anon_vma)
 {
-	spin_unlock(&anon_vma->root->lock);
+	write_unlock(&anon_vma->root->lock);
+}
+
+static inline void anon_vma_lock_read(struct anon_vma *anon_vma)
+{
+	read_lock(&anon_vma->root->lock);
+}
+
+static inline void anon_vma_unlock_read(struct anon_vma *anon_vma)
+{
+	read_unlock(&anon_vma->root->lock);
 }
 
 /*
@@ -243,13 +269,25 @@ int try_to_munlock(struct page *);
 /*
  * Called by memory-failure.c to kill processes.
  */
-struct anon_vma *__page_lock_anon_vma(struct page *page);
+struct anon_vma *__page_lock_anon_vma(struct page *page, int read);
 
 static inline struct anon_vma *page_lock_anon_vma(struct page *page)
 {
 	struct anon_vma *anon_vma;
 
-	__cond_lock(RCU, anon_vma = __page_lock_anon_vma(page));
+	__cond_lock(RCU, anon_vma = __page_lock_anon_vma(page, 0));
+
+	/* (void) is needed to make gcc happy */
+	(void) __cond_lock(&anon_vma->root->lock, anon_vma);
+
+	return anon_vma;
+}
+
+static inline struct anon_vma *page_lock_anon_vma_read(struct page *page)
+{
+	struct anon_vma *anon_vma;
+
+	__cond_lock(RCU, anon_vma = __page_lock_anon_vma(page, 1));
 
 	/* (void) is needed to make gcc happy */
 	(void) __cond_lock(&anon_vma->root->lock, anon_vma);
@@ -258,6 +296,7 @@ static inline struct anon_vma *page_lock_anon_vma(struct page *page)
 }
 
 void page_unlock_anon_vma(struct anon_vma *anon_vma);
+void page_unlock_anon_vma_read(struct anon_vma *anon_vma);
 int page_mapped_in_vma(struct page *page, struct vm_area_struct *vma);
 
 /*
@@ -97,7 +97,9 @@ struct exec_domain;
 struct futex_pi_state;
 struct robust_list_head;
 struct bio_list;
+struct blk_plug;
 struct fs_struct;
+struct poll_cache;
 struct perf_event_context;
 
 /*
@@ -360,6 +362,8 @@ extern signed long schedule_timeout_killable(signed long timeout);
 extern signed long schedule_timeout_uninterruptible(signed long timeout);
 asmlinkage void schedule(void);
 extern int mutex_spin_on_owner(struct mutex *lock, struct thread_info *owner);
+extern int rwsem_spin_on_owner(struct rw_semaphore *sem,
+			       struct thread_info *owner);
 
 struct nsproxy;
 struct user_namespace;
@@ -1139,6 +1143,19 @@ struct sched_statistics {
 };
 #endif
 
+#ifdef CONFIG_SMP
+/*
+ * Decayed runnable time of a sched_entity, in ~1us units, see
+ * update_entity_load_avg() in kernel/sched_fair.c.
+ */
+struct sched_avg {
+	u32			runnable_avg_sum;
+	u32			runnable_avg_period;
+	u64			last_runnable_update;
+	unsigned long		load_avg_contrib;
+};
+#endif
+
 struct sched_entity {
 	struct load_weight	load;		/* for load-balancing */
 	struct rb_node		run_node;
@@ -1163,6 +1180,10 @@ struct sched_entity {
 	/* rq "owned" by this entity/group: */
 	struct cfs_rq		*my_q;
 #endif
+
+#ifdef CONFIG_SMP
+	struct sched_avg	avg;
+#endif
 };
 
 struct sched_rt_entity {
@@ -1190,6 +1211,11 @@ enum perf_event_task_context {
 	perf_nr_task_contexts,
 };
 
+/* Per-thread cache of recently looked up VMAs, see mm/vmacache.c */
+#define VMACACHE_BITS 2
+#define VMACACHE_SIZE (1U << VMACACHE_BITS)
+#define VMACACHE_MASK (VMACACHE_SIZE - 1)
+
 struct task_struct {
 	volatile long state;	/* -1 unrunnable, 0 runnable, >0 stopped */
 	void *stack;
@@ -1254,6 +1280,9 @@ struct task_struct {
 #endif
 
 	struct mm_struct *mm, *active_mm;
+	/* per-thread vma caching */
+	u32 vmacache_seqnum;
+	struct vm_area_struct *vmacache[VMACACHE_SIZE];
 #ifdef CONFIG_COMPAT_BRK
 	unsigned brk_randomized:1;
 #endif
@@ -1354,6 +1383,9 @@ struct task_struct {
 	struct fs_struct *fs;
 /* open file information */
 	struct files_struct *files;
+/* persistent poll set, see PR_SET_POLL_CACHE */
+	struct poll_cache *poll_cache;
+	unsigned int poll_cache_enabled:1;
 /* namespaces */
 	struct nsproxy *nsproxy;
 /* signal handlers */
@@ -1432,6 +1464,11 @@ struct task_struct {
 /* stacked block device info */
 	struct bio_list *bio_list;
 
+#ifdef CONFIG_BLOCK
+/* stack plugging */
+	struct blk_plug *plug;
+#endif
+
 /* VM state */
 	struct reclaim_state *reclaim_state;
 
@@ -1909,6 +1946,10 @@ extern void wake_up_idle_cpu(int cpu);
 static inline void wake_up_idle_cpu(int cpu) { }
 #endif
 
+#ifdef CONFIG_NO_HZ_FULL
+extern bool sched_can_stop_tick(void);
+#endif
+
 extern unsigned int sysctl_sched_latency;
 extern unsigned int sysctl_sched_min_granularity;
 extern unsigned int sysctl_sched_wakeup_granularity;
@@ -1947,6 +1988,10 @@ static inline unsigned int get_sysctl_timer_migration(void)
 extern unsigned int sysctl_sched_rt_period;
 extern int sysctl_sched_rt_runtime;
 
+#ifdef CONFIG_CFS_BANDWIDTH
+extern unsigned int sysctl_sched_cfs_bandwidth_slice;
+#endif
+
 int sched_rt_handler(struct ctl_table *table, int write,
 		void __user *buffer, size_t *lenp,
 		loff_t *ppos);
@@ -32,6 +32,7 @@ struct shmem_sb_info {
 	gid_t gid;		    /* Mount gid for root directory */
 	mode_t mode;		    /* Mount mode for root directory */
 	struct mempolicy *mpol;     /* default memory policy for mappings */
+	unsigned char huge;	    /* Whether to try for PMD-aligned mappings */
 };
 
 static inline struct shmem_inode_info *SHMEM_I(struct inode *inode)
@@ -42,4 +43,9 @@ static inline struct shmem_inode_info *SHMEM_I(struct inode *inode)
 extern int init_tmpfs(void);
 extern int shmem_fill_super(struct super_block *sb, void *data, int silent);
 
+#if defined(CONFIG_SHMEM) && defined(CONFIG_TRANSPARENT_HUGEPAGE) && \
+	defined(CONFIG_SYSFS)
+extern struct kobj_attribute shmem_enabled_attr;
+#endif
+
 #endif
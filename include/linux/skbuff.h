@@ -487,6 +487,7 @@ static inline struct rtable *skb_rtable(const struct sk_buff *skb)
 extern void kfree_skb(struct sk_buff *skb);
 extern void consume_skb(struct sk_buff *skb);
 extern void	       __kfree_skb(struct sk_buff *skb);
+extern void	       __kfree_skb_defer(struct sk_buff *skb);
 extern struct sk_buff *__alloc_skb(unsigned int size,
 				   gfp_t priority, int fclone, int node);
 static inline struct sk_buff *alloc_skb(unsigned int size,
@@ -503,6 +504,32 @@ static inline struct sk_buff *alloc_skb_fclone(unsigned int size,
 
 extern bool skb_recycle_check(struct sk_buff *skb, int skb_size);
 
+struct skb_recycle_pool;
+
+/**
+ *	struct skb_recycle_stats - receive buffer recycling counters
+ *	@recycled: buffers taken back into the pool
+ *	@reused: allocations served from the pool
+ *	@rejected: buffers that could not be recycled and were freed
+ */
+struct skb_recycle_stats {
+	u64	recycled;
+	u64	reused;
+	u64	rejected;
+};
+
+extern struct skb_recycle_pool *skb_recycle_pool_create(unsigned int skb_size,
+							unsigned int max_len);
+extern void skb_recycle_pool_destroy(struct skb_recycle_pool *pool);
+extern void skb_recycle_pool_resize(struct skb_recycle_pool *pool,
+				    unsigned int skb_size);
+extern bool skb_recycle_pool_put(struct skb_recycle_pool *pool,
+				 struct sk_buff *skb);
+extern struct sk_buff *skb_recycle_pool_get(struct skb_recycle_pool *pool,
+					    unsigned int length);
+extern void skb_recycle_pool_stats(struct skb_recycle_pool *pool,
+				   struct skb_recycle_stats *stats);
+
 extern struct sk_buff *skb_morph(struct sk_buff *dst, struct sk_buff *src);
 extern struct sk_buff *skb_clone(struct sk_buff *skb,
 				 gfp_t priority);
@@ -1564,6 +1591,29 @@ static inline struct sk_buff *netdev_alloc_skb_ip_align(struct net_device *dev,
 	return skb;
 }
 
+/**
+ *	netdev_alloc_skb_recycle - allocate an rx buffer, preferring a pool
+ *	@dev: network device to receive on
+ *	@length: length to allocate
+ *	@pool: recycling pool of @dev
+ *
+ *	Like netdev_alloc_skb_ip_align(), but takes the buffer from @pool
+ *	when the local CPU has one cached.
+ */
+static inline struct sk_buff *netdev_alloc_skb_recycle(struct net_device *dev,
+		unsigned int length, struct skb_recycle_pool *pool)
+{
+	struct sk_buff *skb = skb_recycle_pool_get(pool, length + NET_IP_ALIGN);
+
+	if (!skb)
+		return netdev_alloc_skb_ip_align(dev, length);
+
+	skb->dev = dev;
+	if (NET_IP_ALIGN)
+		skb_reserve(skb, NET_IP_ALIGN);
+	return skb;
+}
+
 /**
  *	__netdev_alloc_page - allocate a page for ps-rx on a specific device
  *	@dev: network device to receive on
@@ -1862,6 +1912,12 @@ extern int             skb_splice_bits(struct sk_buff *skb,
 						struct pipe_inode_info *pipe,
 						unsigned int len,
 						unsigned int flags);
+extern int             skb_splice_bits_nolock(struct sk_buff *skb,
+						struct sock *sk,
+						unsigned int offset,
+						struct pipe_inode_info *pipe,
+						unsigned int len,
+						unsigned int flags);
 extern void	       skb_copy_and_csum_dev(const struct sk_buff *skb, u8 *to);
 extern void	       skb_split(struct sk_buff *skb,
 				 struct sk_buff *skb1, const u32 len);
@@ -22,6 +22,10 @@ struct tsc2005_platform_data {
 
 	u32	esd_timeout;    /* msec of inactivity before we check */
 
+	u32	ts_report_rate;	/* Max. reports per second, the controller
+				   waits between conversions to keep it.
+				   0 for the default of about 250 */
+
 	unsigned ts_ignore_last:1;
 
 	void (*set_reset)(bool enable);
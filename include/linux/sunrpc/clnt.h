@@ -29,12 +29,22 @@ struct rpc_inode;
 /*
  * The high-level client handle
  */
+/*
+ * Upper limit on the number of transports a client may spread its
+ * requests over
+ */
+#define RPC_MAX_XPRTS		16
+
 struct rpc_clnt {
 	atomic_t		cl_count;	/* Number of references */
 	struct list_head	cl_clients;	/* Global list of clients */
 	struct list_head	cl_tasks;	/* List of tasks */
 	spinlock_t		cl_lock;	/* spinlock */
 	struct rpc_xprt *	cl_xprt;	/* transport */
+	struct rpc_xprt *	cl_xprts[RPC_MAX_XPRTS]; /* all transports,
+						 * cl_xprts[0] is cl_xprt */
+	unsigned int		cl_nxprts;	/* number of transports */
+	atomic_t		cl_xprt_rotor;	/* transport search start */
 	struct rpc_procinfo *	cl_procinfo;	/* procedure info */
 	u32			cl_prog,	/* RPC program number */
 				cl_vers,	/* RPC version number */
@@ -116,6 +126,7 @@ struct rpc_create_args {
 	unsigned long		flags;
 	char			*client_name;
 	struct svc_xprt		*bc_xprt;	/* NFSv4.1 backchannel */
+	unsigned int		nconnect;	/* number of transports to open */
 };
 
 /* Values for "flags" field */
@@ -170,6 +170,7 @@ struct rpc_xprt {
 	struct list_head	free;		/* free slots */
 	struct rpc_rqst *	slot;		/* slot table storage */
 	unsigned int		max_reqs;	/* total slots */
+	unsigned int		slots_used;	/* slots in use */
 	unsigned long		state;		/* transport state */
 	unsigned char		shutdown   : 1,	/* being shut down */
 				resvport   : 1; /* use a reserved port */
@@ -222,6 +223,7 @@ struct rpc_xprt {
 
 		unsigned long long	req_u,		/* average requests on the wire */
 					bklog_u;	/* backlog queue utilization */
+		unsigned int		max_slots_used;	/* high water mark */
 	} stat;
 
 	struct net		*xprt_net;
@@ -0,0 +1,14 @@
+#ifndef _LINUX_SWAP_SLOTS_H
+#define _LINUX_SWAP_SLOTS_H
+
+#include <linux/swap.h>
+
+/* Number of swap slots a cpu takes from swap_lock at a time */
+#define SWAP_SLOTS_CACHE_SIZE	64
+
+#ifdef CONFIG_SWAP
+extern void disable_swap_slots_cache(void);
+extern void reenable_swap_slots_cache(void);
+#endif
+
+#endif /* _LINUX_SWAP_SLOTS_H */
@@ -106,6 +106,7 @@ enum {
 #define TCP_THIN_LINEAR_TIMEOUTS 16      /* Use linear timeouts for thin streams*/
 #define TCP_THIN_DUPACK         17      /* Fast retrans. after 1 dupack */
 #define TCP_USER_TIMEOUT	18	/* How long for loss retry before timeout */
+#define TCP_FASTOPEN		23	/* Enable FastOpen on listeners */
 
 /* for TCP_INFO socket option */
 #define TCPI_OPT_TIMESTAMPS	1
@@ -282,6 +283,7 @@ struct tcp_request_sock {
 #endif
 	u32				rcv_isn;
 	u32				snt_isn;
+	u32				rcv_nxt; /* the ack # by SYNACK */
 };
 
 static inline struct tcp_request_sock *tcp_rsk(const struct request_sock *req)
@@ -289,12 +291,22 @@ static inline struct tcp_request_sock *tcp_rsk(const struct request_sock *req)
 	return (struct tcp_request_sock *)req;
 }
 
+/* TCP small queues state, tcp_sock::tsq_flags bits */
+enum tsq_flags {
+	TSQ_THROTTLED,	/* tcp_write_xmit() stopped on the output limit */
+	TSQ_QUEUED,	/* socket is on this cpu's tsq_tasklet list */
+	TSQ_OWNED,	/* tasklet found the socket owned by user */
+};
+
 struct tcp_sock {
 	/* inet_connection_sock has to be the first member of tcp_sock */
 	struct inet_connection_sock	inet_conn;
 	u16	tcp_header_len;	/* Bytes of tcp header to send		*/
 	u16	xmit_size_goal_segs; /* Goal for segmenting output packets */
 
+	unsigned long	tsq_flags;	/* TCP small queues, see enum tsq_flags */
+	struct list_head tsq_node;	/* anchor in tsq_tasklet.head list */
+
 /*
  *	Header prediction flags
  *	0x5?10 << 16 + snd_wnd in net byte order
@@ -460,6 +472,14 @@ struct tcp_sock {
 	 * contains related tcp_cookie_transactions fields.
 	 */
 	struct tcp_cookie_values  *cookie_values;
+
+/* TCP Fast Open */
+	struct tcp_fastopen_request *fastopen_req; /* active open in progress */
+	struct request_sock	*fastopen_rsk;	/* passive open awaiting ACK */
+	int			fastopen_max_qlen; /* listener, 0 to disable */
+	u8	syn_fastopen:1,	/* SYN includes Fast Open option */
+		syn_data:1,	/* SYN includes data */
+		syn_data_acked:1; /* data in SYN is acked by SYN-ACK */
 };
 
 static inline struct tcp_sock *tcp_sk(const struct sock *sk)
@@ -67,6 +67,11 @@ struct tick_sched {
 	unsigned long			next_jiffies;
 	ktime_t				idle_expires;
 	int				do_timer_last;
+#ifdef CONFIG_NO_HZ_FULL
+	int				full_deferred;
+	unsigned long			full_kick_pending;
+	ktime_t				full_last_tick;
+#endif
 };
 
 extern void __init tick_init(void);
@@ -139,4 +144,21 @@ static inline u64 get_cpu_idle_time_us(int cpu, u64 *unused) { return -1; }
 static inline u64 get_cpu_iowait_time_us(int cpu, u64 *unused) { return -1; }
 # endif /* !NO_HZ */
 
+#ifdef CONFIG_NO_HZ_FULL
+extern bool tick_nohz_full_running;
+extern void __tick_nohz_full_kick_cpu(int cpu);
+
+/*
+ * Make an adaptive-tick cpu restart its tick, e.g. because a second
+ * task or a new timer was queued on it.
+ */
+static inline void tick_nohz_full_kick_cpu(int cpu)
+{
+	if (tick_nohz_full_running)
+		__tick_nohz_full_kick_cpu(cpu);
+}
+#else
+static inline void tick_nohz_full_kick_cpu(int cpu) { }
+#endif
+
 #endif
@@ -35,6 +35,16 @@ struct timer_list {
 
 extern struct tvec_base boot_tvec_bases;
 
+/*
+ * Per-CPU timer wheel statistics, see timer_get_wheel_stats():
+ */
+struct timer_wheel_stats {
+	unsigned long ticks;		/* jiffies processed */
+	unsigned long expired;		/* timers run */
+	unsigned long max_batch;	/* most timers run in one jiffy */
+	unsigned long skipped;		/* idle jiffies stepped over */
+};
+
 #ifdef CONFIG_LOCKDEP
 /*
  * NB: because we have to copy the lockdep_map, setting the lockdep_map key
@@ -286,6 +296,7 @@ extern int try_to_del_timer_sync(struct timer_list *timer);
 
 extern void init_timers(void);
 extern void run_local_timers(void);
+extern void timer_get_wheel_stats(int cpu, struct timer_wheel_stats *stats);
 struct hrtimer;
 extern enum hrtimer_restart it_real_fn(struct hrtimer *);
 
@@ -0,0 +1,49 @@
+/*
+ * This file is part of UBIFS.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef __UBIFS_USER_H__
+#define __UBIFS_USER_H__
+
+#include <linux/types.h>
+
+/*
+ * Per-inode compressor selection
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *
+ * The compressor used for the data of a regular file may be read and changed
+ * with the %UBIFS_IOCGCOMPR and %UBIFS_IOCSCOMPR ioctl commands, which take a
+ * pointer to a 32-bit integer containing one of the %UBIFS_IOC_COMPR_*
+ * constants. The new compressor is only used for data written after the
+ * change. When set on a directory, files and directories created in it later
+ * inherit the compressor, while %UBIFS_IOC_COMPR_NONE makes them use the
+ * default compressor of the file-system again. Whether data is compressed at
+ * all is still controlled by the FS_COMPR_FL inode flag (see 'chattr +c').
+ */
+enum {
+	UBIFS_IOC_COMPR_NONE,
+	UBIFS_IOC_COMPR_LZO,
+	UBIFS_IOC_COMPR_ZLIB,
+};
+
+#define UBIFS_IOC_MAGIC 'O'
+
+/* Get the compressor of an inode */
+#define UBIFS_IOCGCOMPR _IOR(UBIFS_IOC_MAGIC, 16, __s32)
+/* Set the compressor of an inode */
+#define UBIFS_IOCSCOMPR _IOW(UBIFS_IOC_MAGIC, 17, __s32)
+
+#endif /* __UBIFS_USER_H__ */
@@ -33,7 +33,8 @@ struct inet_peer {
 	atomic_t		refcnt;
 	/*
 	 * Once inet_peer is queued for deletion (refcnt == -1), following fields
-	 * are not available: rid, ip_id_count, tcp_ts, tcp_ts_stamp
+	 * are not available: rid, ip_id_count, tcp_ts, tcp_ts_stamp,
+	 * tcp_fastopen_*
 	 * We can share memory with rcu_head to keep inet_peer small
 	 */
 	union {
@@ -42,6 +43,12 @@ struct inet_peer {
 			atomic_t	ip_id_count;	/* IP ID for the next packet */
 			__u32		tcp_ts;
 			__u32		tcp_ts_stamp;
+			/* TCP Fast Open client cache, see tcp_fastopen.c */
+			unsigned long	tcp_fastopen_syn_loss_stamp;
+			__u16		tcp_fastopen_mss;
+			__s8		tcp_fastopen_cookie_len;
+			__u8		tcp_fastopen_syn_loss;
+			__u8		tcp_fastopen_cookie[16];
 		};
 		struct rcu_head         rcu;
 	};
@@ -574,11 +574,12 @@ struct Scsi_Host {
 	struct blk_queue_tag	*bqt;
 
 	/*
-	 * The following two fields are protected with host_lock;
-	 * however, eh routines can safely access during eh processing
-	 * without acquiring the lock.
+	 * host_busy is updated without host_lock.  host_failed and
+	 * host_eh_scheduled are protected with host_lock; however, eh
+	 * routines can safely access during eh processing without
+	 * acquiring the lock.
 	 */
-	unsigned int host_busy;		   /* commands actually active on low-level */
+	atomic_t host_busy;		   /* commands actually active on low-level */
 	unsigned int host_failed;	   /* commands that failed. */
 	unsigned int host_eh_scheduled;    /* EH scheduled without command */
     
@@ -115,6 +115,37 @@ DEFINE_EVENT(workqueue_work, workqueue_execute_end,
 	TP_ARGS(work)
 );
 
+/**
+ * workqueue_create_worker - called when a new worker has been created
+ * @cpu:	cpu of the gcwq the worker serves, WORK_CPU_UNBOUND for unbound
+ * @id:		worker id within the gcwq
+ * @nr_workers:	number of workers of the gcwq before this one starts
+ *
+ * Allows to see which load makes the concurrency management spawn
+ * additional kworkers.
+ */
+TRACE_EVENT(workqueue_create_worker,
+
+	TP_PROTO(unsigned int cpu, int id, int nr_workers),
+
+	TP_ARGS(cpu, id, nr_workers),
+
+	TP_STRUCT__entry(
+		__field( unsigned int,	cpu		)
+		__field( int,		id		)
+		__field( int,		nr_workers	)
+	),
+
+	TP_fast_assign(
+		__entry->cpu		= cpu;
+		__entry->id		= id;
+		__entry->nr_workers	= nr_workers;
+	),
+
+	TP_printk("cpu=%u id=%d nr_workers=%d",
+		  __entry->cpu, __entry->id, __entry->nr_workers)
+);
+
 #endif /*  _TRACE_WORKQUEUE_H */
 
 /* This part must be outside protection */
@@ -8,6 +8,8 @@
 #include <linux/device.h>
 #include <linux/writeback.h>
 
+#define KBps(x)			((x) << (PAGE_SHIFT - 10))
+
 struct wb_writeback_work;
 
 DECLARE_EVENT_CLASS(writeback_work_class,
@@ -147,11 +149,93 @@ DEFINE_EVENT(wbc_class, name, \
 DEFINE_WBC_EVENT(wbc_writeback_start);
 DEFINE_WBC_EVENT(wbc_writeback_written);
 DEFINE_WBC_EVENT(wbc_writeback_wait);
-DEFINE_WBC_EVENT(wbc_balance_dirty_start);
-DEFINE_WBC_EVENT(wbc_balance_dirty_written);
-DEFINE_WBC_EVENT(wbc_balance_dirty_wait);
 DEFINE_WBC_EVENT(wbc_writepage);
 
+TRACE_EVENT(bdi_write_bandwidth,
+
+	TP_PROTO(struct backing_dev_info *bdi, unsigned long elapsed,
+		 unsigned long written),
+
+	TP_ARGS(bdi, elapsed, written),
+
+	TP_STRUCT__entry(
+		__array(char,		name, 32)
+		__field(unsigned long,	write_bw)
+		__field(unsigned long,	avg_write_bw)
+		__field(unsigned long,	elapsed)
+		__field(unsigned long,	written)
+	),
+
+	TP_fast_assign(
+		strncpy(__entry->name,
+			bdi->dev ? dev_name(bdi->dev) : "(unknown)", 32);
+		__entry->write_bw	= KBps(bdi->write_bandwidth);
+		__entry->avg_write_bw	= KBps(bdi->avg_write_bandwidth);
+		__entry->elapsed	= jiffies_to_msecs(elapsed);
+		__entry->written	= written;
+	),
+
+	TP_printk("bdi %s: write_bw=%lu awrite_bw=%lu elapsed=%lu written=%lu",
+		  __entry->name,
+		  __entry->write_bw,	/* write bandwidth */
+		  __entry->avg_write_bw,	/* avg write bandwidth */
+		  __entry->elapsed,	/* ms */
+		  __entry->written)	/* pages since last sample */
+);
+
+TRACE_EVENT(balance_dirty_pages,
+
+	TP_PROTO(struct backing_dev_info *bdi,
+		 unsigned long thresh,
+		 unsigned long bg_thresh,
+		 unsigned long dirty,
+		 unsigned long bdi_thresh,
+		 unsigned long bdi_dirty,
+		 unsigned long dirtied,
+		 long pause),
+
+	TP_ARGS(bdi, thresh, bg_thresh, dirty, bdi_thresh, bdi_dirty,
+		dirtied, pause),
+
+	TP_STRUCT__entry(
+		__array(char,		bdi, 32)
+		__field(unsigned long,	limit)
+		__field(unsigned long,	bg_limit)
+		__field(unsigned long,	dirty)
+		__field(unsigned long,	bdi_limit)
+		__field(unsigned long,	bdi_dirty)
+		__field(unsigned long,	write_bw)
+		__field(unsigned int,	dirtied)
+		__field(long,		pause)
+	),
+
+	TP_fast_assign(
+		strncpy(__entry->bdi,
+			bdi->dev ? dev_name(bdi->dev) : "(unknown)", 32);
+		__entry->limit		= thresh;
+		__entry->bg_limit	= bg_thresh;
+		__entry->dirty		= dirty;
+		__entry->bdi_limit	= bdi_thresh;
+		__entry->bdi_dirty	= bdi_dirty;
+		__entry->write_bw	= KBps(bdi->avg_write_bandwidth);
+		__entry->dirtied	= dirtied;
+		__entry->pause		= pause * 1000 / HZ;
+	),
+
+	TP_printk("bdi %s: limit=%lu bg_limit=%lu dirty=%lu "
+		  "bdi_limit=%lu bdi_dirty=%lu write_bw=%lu "
+		  "dirtied=%u paused=%ld",
+		  __entry->bdi,
+		  __entry->limit,
+		  __entry->bg_limit,
+		  __entry->dirty,
+		  __entry->bdi_limit,
+		  __entry->bdi_dirty,
+		  __entry->write_bw,	/* bdi write bandwidth, KB/s */
+		  __entry->dirtied,
+		  __entry->pause)	/* ms */
+);
+
 DECLARE_EVENT_CLASS(writeback_congest_waited_template,
 
 	TP_PROTO(unsigned int usec_timeout, unsigned int usec_delayed),
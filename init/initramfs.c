@@ -8,6 +8,10 @@
 #include <linux/dirent.h>
 #include <linux/syscalls.h>
 #include <linux/utime.h>
+#include <linux/async.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/cpumask.h>
 
 static __initdata char *message;
 static void __init error(char *x)
@@ -290,6 +294,10 @@ static void __init clean_path(char *path, mode_t mode)
 
 static __initdata int wfd;
 
+/* statistics, printed once the whole archive has been unpacked */
+static __initdata unsigned long nr_files;
+static __initdata unsigned long long nr_bytes;
+
 static int __init do_name(void)
 {
 	state = SkipIt;
@@ -313,6 +321,7 @@ static int __init do_name(void)
 				if (body_len)
 					sys_ftruncate(wfd, body_len);
 				vcollected = kstrdup(collected, GFP_KERNEL);
+				nr_files++;
 				state = CopyFile;
 			}
 		}
@@ -337,6 +346,7 @@ static int __init do_copy(void)
 {
 	if (count >= body_len) {
 		sys_write(wfd, victim, body_len);
+		nr_bytes += body_len;
 		sys_close(wfd);
 		do_utime(vcollected, mtime);
 		kfree(vcollected);
@@ -345,6 +355,7 @@ static int __init do_copy(void)
 		return 0;
 	} else {
 		sys_write(wfd, victim, count);
+		nr_bytes += count;
 		body_len -= count;
 		eat(count);
 		return 1;
@@ -411,6 +422,115 @@ static unsigned my_inptr;   /* index of next byte to be processed in inbuf */
 
 #include <linux/decompress/generic.h>
 
+/*
+ * With more than one CPU online the decompressor runs in a thread of its own
+ * and hands its output to the cpio parser through a small ring of chunks, so
+ * that decompressing the next chunk overlaps with writing out the previous
+ * one.
+ */
+#define UNPACK_CHUNK_SIZE	(64 * 1024)
+#define UNPACK_CHUNKS		8
+
+static __initdata struct unpack_pipe {
+	decompress_fn decompress;
+	char *in;
+	unsigned in_len;
+	int res;
+	int done;		/* decompressor has returned */
+	unsigned head;		/* chunks filled by the decompressor */
+	unsigned tail;		/* chunks consumed by the cpio parser */
+	wait_queue_head_t wait;
+	char *buf[UNPACK_CHUNKS];
+	unsigned len[UNPACK_CHUNKS];
+} unpack;
+
+static int __init pipe_flush(void *bufv, unsigned len)
+{
+	char *buf = (char *) bufv;
+	int origLen = len;
+	unsigned n, slot;
+
+	while (len) {
+		wait_event(unpack.wait,
+			   unpack.head - unpack.tail < UNPACK_CHUNKS);
+		if (message)
+			return -1;
+		n = min_t(unsigned, len, UNPACK_CHUNK_SIZE);
+		slot = unpack.head % UNPACK_CHUNKS;
+		memcpy(unpack.buf[slot], buf, n);
+		unpack.len[slot] = n;
+		smp_wmb();
+		unpack.head++;
+		wake_up(&unpack.wait);
+		buf += n;
+		len -= n;
+	}
+	return origLen;
+}
+
+static int __init unpack_thread(void *unused)
+{
+	unpack.res = unpack.decompress(unpack.in, unpack.in_len, NULL,
+				       pipe_flush, NULL, &my_inptr, error);
+	smp_wmb();
+	unpack.done = 1;
+	wake_up(&unpack.wait);
+	return 0;
+}
+
+static int __init decompress_buffer(decompress_fn decompress,
+				    char *buf, unsigned len)
+{
+	struct task_struct *tsk;
+	unsigned i, slot;
+	int res;
+
+	if (num_online_cpus() < 2)
+		goto sync;
+
+	for (i = 0; i < UNPACK_CHUNKS; i++) {
+		unpack.buf[i] = kmalloc(UNPACK_CHUNK_SIZE, GFP_KERNEL);
+		if (!unpack.buf[i])
+			goto free;
+	}
+
+	init_waitqueue_head(&unpack.wait);
+	unpack.decompress = decompress;
+	unpack.in = buf;
+	unpack.in_len = len;
+	unpack.head = unpack.tail = 0;
+	unpack.done = 0;
+
+	tsk = kthread_run(unpack_thread, NULL, "initramfs_unpack");
+	if (IS_ERR(tsk))
+		goto free;
+
+	for (;;) {
+		wait_event(unpack.wait,
+			   unpack.tail != unpack.head || unpack.done);
+		smp_rmb();
+		if (unpack.tail == unpack.head)
+			break;
+		slot = unpack.tail % UNPACK_CHUNKS;
+		flush_buffer(unpack.buf[slot], unpack.len[slot]);
+		smp_mb();
+		unpack.tail++;
+		wake_up(&unpack.wait);
+	}
+	res = unpack.res;
+
+	for (i = 0; i < UNPACK_CHUNKS; i++)
+		kfree(unpack.buf[i]);
+	return res;
+
+free:
+	while (i)
+		kfree(unpack.buf[--i]);
+sync:
+	return decompress(buf, len, NULL, flush_buffer, NULL,
+			  &my_inptr, error);
+}
+
 static char * __init unpack_to_rootfs(char *buf, unsigned len)
 {
 	int written, res;
@@ -446,8 +566,7 @@ static char * __init unpack_to_rootfs(char *buf, unsigned len)
 		this_header = 0;
 		decompress = decompress_method(buf, len, &compress_name);
 		if (decompress) {
-			res = decompress(buf, len, NULL, flush_buffer, NULL,
-				   &my_inptr, error);
+			res = decompress_buffer(decompress, buf, len);
 			if (res)
 				error("decompressor failed");
 		} else if (compress_name) {
@@ -569,7 +688,34 @@ static void __init clean_rootfs(void)
 }
 #endif
 
-static int __init populate_rootfs(void)
+static int __initdata initramfs_async = 1;
+
+static int __init initramfs_async_setup(char *str)
+{
+	initramfs_async = simple_strtol(str, NULL, 0) != 0;
+	return 1;
+}
+__setup("initramfs_async=", initramfs_async_setup);
+
+static LIST_HEAD(initramfs_domain);
+static async_cookie_t initramfs_cookie;
+
+/**
+ * wait_for_initramfs - wait until the initramfs has been unpacked
+ *
+ * Anything that looks at the root filesystem while the kernel is still
+ * booting must call this first, as the initramfs may be unpacked in the
+ * background.
+ */
+void wait_for_initramfs(void)
+{
+	if (!initramfs_cookie)
+		return;
+	async_synchronize_cookie_domain(initramfs_cookie + 1,
+					&initramfs_domain);
+}
+
+static void __init unpack_rootfs_images(void)
 {
 	char *err = unpack_to_rootfs(__initramfs_start, __initramfs_size);
 	if (err)
@@ -582,7 +728,7 @@ static int __init populate_rootfs(void)
 			initrd_end - initrd_start);
 		if (!err) {
 			free_initrd();
-			return 0;
+			return;
 		} else {
 			clean_rootfs();
 			unpack_to_rootfs(__initramfs_start, __initramfs_size);
@@ -606,6 +752,26 @@ static int __init populate_rootfs(void)
 		free_initrd();
 #endif
 	}
+}
+
+static void __init do_populate_rootfs(void *unused, async_cookie_t cookie)
+{
+	ktime_t start = ktime_get();
+
+	unpack_rootfs_images();
+	printk(KERN_INFO "Unpacked %lu files (%llu KiB) into rootfs in %lld ms\n",
+	       nr_files, nr_bytes >> 10,
+	       ktime_to_ms(ktime_sub(ktime_get(), start)));
+}
+
+static int __init populate_rootfs(void)
+{
+	if (initramfs_async)
+		initramfs_cookie = async_schedule_domain(do_populate_rootfs,
+							 NULL,
+							 &initramfs_domain);
+	else
+		do_populate_rootfs(NULL, 0);
 	return 0;
 }
 rootfs_initcall(populate_rootfs);
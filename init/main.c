@@ -897,6 +897,9 @@ static int __init kernel_init(void * unused)
 
 	do_basic_setup();
 
+	/* The initramfs may still be being unpacked in the background */
+	wait_for_initramfs();
+
 	/* Open the /dev/console on the rootfs, this should never fail */
 	if (sys_open((const char __user *) "/dev/console", O_RDWR, 0) < 0)
 		printk(KERN_WARNING "Warning: unable to open an initial console.\n");
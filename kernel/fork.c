@@ -40,6 +40,7 @@
 #include <linux/tracehook.h>
 #include <linux/futex.h>
 #include <linux/compat.h>
+#include <linux/vmacache.h>
 #include <linux/task_io_accounting_ops.h>
 #include <linux/rcupdate.h>
 #include <linux/ptrace.h>
@@ -319,7 +320,7 @@ static int dup_mmap(struct mm_struct *mm, struct mm_struct *oldmm)
 
 	mm->locked_vm = 0;
 	mm->mmap = NULL;
-	mm->mmap_cache = NULL;
+	mm->vmacache_seqnum = 0;
 	mm->free_area_cache = oldmm->mmap_base;
 	mm->cached_hole_size = ~0UL;
 	mm->map_count = 0;
@@ -496,6 +497,14 @@ static struct mm_struct * mm_init(struct mm_struct * mm, struct task_struct *p)
 	mm_init_aio(mm);
 	mm_init_owner(mm, p);
 	atomic_set(&mm->oom_disable_count, 0);
+#ifdef CONFIG_KSM
+	mm->ksm_pages_scanned = 0;
+	mm->ksm_pages_merged = 0;
+	mm->ksm_pages_skipped = 0;
+#endif
+#ifdef CONFIG_FUTEX_PRIVATE_HASH
+	mm->futex_hash = NULL;
+#endif
 
 	if (likely(!mm_alloc_pgd(mm))) {
 		mm->def_flags = 0;
@@ -533,6 +542,7 @@ void __mmdrop(struct mm_struct *mm)
 	mm_free_pgd(mm);
 	destroy_context(mm);
 	mmu_notifier_mm_destroy(mm);
+	futex_mm_free(mm);
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
 	VM_BUG_ON(mm->pmd_huge_pte);
 #endif
@@ -733,6 +743,10 @@ static int copy_mm(unsigned long clone_flags, struct task_struct * tsk)
 	tsk->mm = NULL;
 	tsk->active_mm = NULL;
 
+	/* Do not inherit the parent's cached VMAs */
+	tsk->vmacache_seqnum = 0;
+	vmacache_flush(tsk);
+
 	/*
 	 * Are we cloning a kernel thread?
 	 *
@@ -1101,7 +1115,11 @@ static struct task_struct *copy_process(unsigned long clone_flags,
 	p->real_start_time = p->start_time;
 	monotonic_to_bootbased(&p->real_start_time);
 	p->io_context = NULL;
+	p->poll_cache = NULL;
 	p->audit_context = NULL;
+#ifdef CONFIG_BLOCK
+	p->plug = NULL;
+#endif
 	cgroup_fork(p);
 #ifdef CONFIG_NUMA
 	p->mempolicy = mpol_dup(p->mempolicy);
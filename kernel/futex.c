@@ -59,6 +59,8 @@
 #include <linux/magic.h>
 #include <linux/pid.h>
 #include <linux/nsproxy.h>
+#include <linux/bootmem.h>
+#include <linux/log2.h>
 
 #include <asm/futex.h>
 
@@ -66,8 +68,6 @@
 
 int __read_mostly futex_cmpxchg_enabled;
 
-#define FUTEX_HASHBITS (CONFIG_BASE_SMALL ? 4 : 8)
-
 /*
  * Futex flags used to encode options to functions and preserve them across
  * restarts.
@@ -147,7 +147,72 @@ struct futex_hash_bucket {
 	struct plist_head chain;
 };
 
-static struct futex_hash_bucket futex_queues[1<<FUTEX_HASHBITS];
+static unsigned long __read_mostly futex_hashsize;
+static struct futex_hash_bucket *futex_queues __read_mostly;
+
+#ifdef CONFIG_FUTEX_PRIVATE_HASH
+/*
+ * The PROCESS_PRIVATE futexes of a process that has more than one user
+ * of its mm are hashed into a table of its own.  The table is set up on
+ * the first private futex operation with more than one user and never
+ * changes afterwards: waiters are queued by bucket, so the hash of a
+ * key must stay stable while anybody may be waiting on it.  While the
+ * mm has a single user nobody else can be waiting, so until then the
+ * global table is used without committing to it.
+ */
+#define FUTEX_PRIVATE_HASH_MIN	16
+#define FUTEX_PRIVATE_HASH_MAX	512
+
+struct futex_private_hash {
+	unsigned long mask;
+	struct futex_hash_bucket queues[0];
+};
+
+/* Marks an mm whose private futexes stay in the global table. */
+static struct futex_private_hash futex_no_private_hash;
+
+static void futex_private_hash_init(struct mm_struct *mm)
+{
+	struct futex_private_hash *fph;
+	unsigned long i, size;
+
+	if (likely(mm->futex_hash) || atomic_read(&mm->mm_users) <= 1)
+		return;
+
+	size = roundup_pow_of_two(4 * atomic_read(&mm->mm_users));
+	size = clamp_t(unsigned long, size, FUTEX_PRIVATE_HASH_MIN,
+		       min_t(unsigned long, futex_hashsize,
+			     FUTEX_PRIVATE_HASH_MAX));
+
+	fph = kmalloc(sizeof(*fph) + size * sizeof(fph->queues[0]),
+		      GFP_KERNEL | __GFP_NOWARN);
+	if (fph) {
+		fph->mask = size - 1;
+		for (i = 0; i < size; i++) {
+			plist_head_init(&fph->queues[i].chain,
+					&fph->queues[i].lock);
+			spin_lock_init(&fph->queues[i].lock);
+		}
+	} else {
+		fph = &futex_no_private_hash;
+	}
+
+	/* cmpxchg() orders the initialization before the publication. */
+	if (cmpxchg(&mm->futex_hash, NULL, fph) &&
+	    fph != &futex_no_private_hash)
+		kfree(fph);
+}
+
+void futex_mm_free(struct mm_struct *mm)
+{
+	if (mm->futex_hash != &futex_no_private_hash)
+		kfree(mm->futex_hash);
+}
+#else
+static inline void futex_private_hash_init(struct mm_struct *mm)
+{
+}
+#endif
 
 /*
  * We hash on the keys returned from get_futex_key (see below).
@@ -157,7 +222,19 @@ static struct futex_hash_bucket *hash_futex(union futex_key *key)
 	u32 hash = jhash2((u32*)&key->both.word,
 			  (sizeof(key->both.word)+sizeof(key->both.ptr))/4,
 			  key->both.offset);
-	return &futex_queues[hash & ((1 << FUTEX_HASHBITS)-1)];
+
+#ifdef CONFIG_FUTEX_PRIVATE_HASH
+	if (!(key->both.offset & (FUT_OFF_INODE | FUT_OFF_MMSHARED)) &&
+	    key->private.mm) {
+		struct futex_private_hash *fph;
+
+		fph = ACCESS_ONCE(key->private.mm->futex_hash);
+		smp_read_barrier_depends();
+		if (fph && fph != &futex_no_private_hash)
+			return &fph->queues[hash & fph->mask];
+	}
+#endif
+	return &futex_queues[hash & (futex_hashsize - 1)];
 }
 
 /*
@@ -256,6 +333,8 @@ get_futex_key(u32 __user *uaddr, int fshared, union futex_key *key)
 			return -EFAULT;
 		key->private.mm = mm;
 		key->private.address = address;
+		if (mm)
+			futex_private_hash_init(mm);
 		get_futex_key_refs(key);
 		return 0;
 	}
@@ -2666,7 +2745,19 @@ SYSCALL_DEFINE6(futex, u32 __user *, uaddr, int, op, u32, val,
 static int __init futex_init(void)
 {
 	u32 curval;
-	int i;
+	unsigned int futex_shift;
+	unsigned long i;
+
+#if CONFIG_BASE_SMALL
+	futex_hashsize = 16;
+#else
+	futex_hashsize = roundup_pow_of_two(256 * num_possible_cpus());
+#endif
+	futex_queues = alloc_large_system_hash("futex", sizeof(*futex_queues),
+					       futex_hashsize, 0, 0,
+					       &futex_shift, NULL,
+					       futex_hashsize);
+	futex_hashsize = 1UL << futex_shift;
 
 	/*
 	 * This will fail and we want it. Some arch implementations do
@@ -2682,11 +2773,11 @@ static int __init futex_init(void)
 	if (curval == -EFAULT)
 		futex_cmpxchg_enabled = 1;
 
-	for (i = 0; i < ARRAY_SIZE(futex_queues); i++) {
+	for (i = 0; i < futex_hashsize; i++) {
 		plist_head_init(&futex_queues[i].chain, &futex_queues[i].lock);
 		spin_lock_init(&futex_queues[i].lock);
 	}
 
 	return 0;
 }
-__initcall(futex_init);
+core_initcall(futex_init);
@@ -35,6 +35,7 @@
 #include <linux/resource.h>
 #include <linux/notifier.h>
 #include <linux/suspend.h>
+#include <linux/initrd.h>
 #include <asm/uaccess.h>
 
 #include <trace/events/module.h>
@@ -153,6 +154,8 @@ static int ____call_usermodehelper(void *data)
 			goto fail;
 	}
 
+	wait_for_initramfs();
+
 	retval = kernel_execve(sub_info->path,
 			       (const char *const *)sub_info->argv,
 			       (const char *const *)sub_info->envp);
@@ -1298,6 +1298,23 @@ static inline int fastpath_timer_check(struct task_struct *tsk)
 	return 0;
 }
 
+#ifdef CONFIG_NO_HZ_FULL
+/*
+ * Armed cpu timers are only checked from the tick, so the tick must
+ * keep running while @tsk or its thread group has any.
+ */
+int posix_cpu_timers_can_stop_tick(struct task_struct *tsk)
+{
+	if (!task_cputime_zero(&tsk->cputime_expires))
+		return 0;
+
+	if (tsk->signal->cputimer.running)
+		return 0;
+
+	return 1;
+}
+#endif
+
 /*
  * This is called from the timer interrupt handler.  The irq handler has
  * already updated our counts.  We need to check if any timers fire now.
@@ -40,6 +40,7 @@
 #include <linux/cpu.h>
 #include <linux/notifier.h>
 #include <linux/rculist.h>
+#include <linux/kthread.h>
 
 #include <asm/uaccess.h>
 
@@ -111,6 +112,15 @@ static DEFINE_SPINLOCK(logbuf_lock);
 static unsigned log_start;	/* Index into log_buf: next char to be read by syslog() */
 static unsigned con_start;	/* Index into log_buf: next char to be sent to consoles */
 static unsigned log_end;	/* Index into log_buf: most-recently-written-char + 1 */
+static unsigned con_dropped;	/* Lines overwritten before reaching the consoles */
+
+/* Console output is done by this kthread, see printk_offload_console() */
+static struct task_struct *printk_kthread;
+
+#define PRINTK_PENDING_WAKEUP	0x01	/* wake up klogd */
+#define PRINTK_PENDING_OUTPUT	0x02	/* wake up printk_kthread */
+
+static DEFINE_PER_CPU(int, printk_pending);
 
 /*
  *	Array of consoles built from command line options (console=)
@@ -562,8 +572,34 @@ static void call_console_drivers(unsigned start, unsigned end)
 	_call_console_drivers(start_print, end, msg_level);
 }
 
+/*
+ * Tell the consoles how many lines were overwritten in log_buf before
+ * they got to print them.
+ */
+static void call_console_drivers_dropped(unsigned dropped)
+{
+	struct console *con;
+	char msg[64];
+	int len;
+
+	if (console_loglevel <= 4 && !ignore_loglevel)
+		return;
+
+	len = scnprintf(msg, sizeof(msg),
+			"** %u printk lines dropped **\n", dropped);
+	for_each_console(con) {
+		if ((con->flags & CON_ENABLED) && con->write &&
+				(cpu_online(smp_processor_id()) ||
+				(con->flags & CON_ANYTIME)))
+			con->write(con, msg, len);
+	}
+}
+
 static void emit_log_char(char c)
 {
+	/* Overwriting a line the consoles have not seen yet? */
+	if (log_end - con_start >= log_buf_len && LOG_BUF(con_start) == '\n')
+		con_dropped++;
 	LOG_BUF(log_end) = c;
 	log_end++;
 	if (log_end - log_start > log_buf_len)
@@ -602,6 +638,38 @@ static int printk_time = 0;
 #endif
 module_param_named(time, printk_time, bool, S_IRUGO | S_IWUSR);
 
+/*
+ * With printk.synchronous=0, once the printk kthread runs, printk() only
+ * stores the message and leaves console output to the kthread, so that
+ * callers do not wait for slow consoles.  Oopses, panics, KERN_CRIT and
+ * more severe messages, and everything from the point a restart, halt
+ * or power off begins still print synchronously, flushing whatever the
+ * kthread had not printed yet.
+ */
+static int printk_sync = 1;
+module_param_named(synchronous, printk_sync, bool, S_IRUGO | S_IWUSR);
+
+static inline bool printk_offload_console(int level)
+{
+	return printk_kthread && !printk_sync && !oops_in_progress &&
+	       system_state == SYSTEM_RUNNING && level > 2;
+}
+
+static int printk_kthread_func(void *unused)
+{
+	while (!kthread_should_stop()) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (console_suspended ||
+		    ACCESS_ONCE(con_start) == ACCESS_ONCE(log_end))
+			schedule();
+		__set_current_state(TASK_RUNNING);
+
+		console_lock();
+		console_unlock();
+	}
+	return 0;
+}
+
 /* Check if we have any console registered that can be called early in boot. */
 static int have_callable_console(void)
 {
@@ -837,6 +905,18 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 			new_text_line = 1;
 	}
 
+	/*
+	 * Leave the consoles to the printk kthread, which the next
+	 * printk_tick() wakes.  It cannot be woken from here as printk()
+	 * may be called with scheduler locks held.
+	 */
+	if (printk_offload_console(current_log_level)) {
+		printk_cpu = UINT_MAX;
+		spin_unlock(&logbuf_lock);
+		this_cpu_or(printk_pending, PRINTK_PENDING_OUTPUT);
+		goto out_lockdep;
+	}
+
 	/*
 	 * Try to acquire and then immediately release the
 	 * console semaphore. The release will do all the
@@ -850,6 +930,7 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 	if (console_trylock_for_printk(this_cpu))
 		console_unlock();
 
+out_lockdep:
 	lockdep_on();
 out_restore_irqs:
 	raw_local_irq_restore(flags);
@@ -866,6 +947,10 @@ static void call_console_drivers(unsigned start, unsigned end)
 {
 }
 
+static void call_console_drivers_dropped(unsigned dropped)
+{
+}
+
 #endif
 
 static int __add_preferred_console(char *name, int idx, char *options,
@@ -1095,13 +1180,16 @@ int is_console_locked(void)
 	return console_locked;
 }
 
-static DEFINE_PER_CPU(int, printk_pending);
-
 void printk_tick(void)
 {
-	if (__this_cpu_read(printk_pending)) {
+	int pending = __this_cpu_read(printk_pending);
+
+	if (pending) {
 		__this_cpu_write(printk_pending, 0);
-		wake_up_interruptible(&log_wait);
+		if (pending & PRINTK_PENDING_OUTPUT)
+			wake_up_process(printk_kthread);
+		if (pending & PRINTK_PENDING_WAKEUP)
+			wake_up_interruptible(&log_wait);
 	}
 }
 
@@ -1115,7 +1203,7 @@ int printk_needs_cpu(int cpu)
 void wake_up_klogd(void)
 {
 	if (waitqueue_active(&log_wait))
-		this_cpu_write(printk_pending, 1);
+		this_cpu_or(printk_pending, PRINTK_PENDING_WAKEUP);
 }
 
 /**
@@ -1135,7 +1223,7 @@ void wake_up_klogd(void)
 void console_unlock(void)
 {
 	unsigned long flags;
-	unsigned _con_start, _log_end;
+	unsigned _con_start, _log_end, _dropped;
 	unsigned wake_klogd = 0;
 
 	if (console_suspended) {
@@ -1152,9 +1240,13 @@ void console_unlock(void)
 			break;			/* Nothing to print */
 		_con_start = con_start;
 		_log_end = log_end;
+		_dropped = con_dropped;
 		con_start = log_end;		/* Flush */
+		con_dropped = 0;
 		spin_unlock(&logbuf_lock);
 		stop_critical_timings();	/* don't trace print latency */
+		if (_dropped)
+			call_console_drivers_dropped(_dropped);
 		call_console_drivers(_con_start, _log_end);
 		start_critical_timings();
 		local_irq_restore(flags);
@@ -1460,6 +1552,16 @@ static int __init printk_late_init(void)
 		}
 	}
 	hotcpu_notifier(console_cpu_notify, 0);
+
+#ifdef CONFIG_PRINTK
+	{
+		struct task_struct *t;
+
+		t = kthread_run(printk_kthread_func, NULL, "printk");
+		if (!IS_ERR(t))
+			printk_kthread = t;
+	}
+#endif
 	return 0;
 }
 late_initcall(printk_late_init);
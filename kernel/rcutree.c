@@ -47,6 +47,10 @@
 #include <linux/mutex.h>
 #include <linux/time.h>
 #include <linux/kernel_stat.h>
+#include <linux/tick.h>
+#include <linux/kthread.h>
+#include <linux/bootmem.h>
+#include <linux/wait.h>
 
 #include "rcutree.h"
 
@@ -238,7 +242,11 @@ static int rcu_implicit_offline_qs(struct rcu_data *rdp)
 	if (rdp->preemptable)
 		return 0;
 
-	/* The CPU is online, so send it a reschedule IPI. */
+	/*
+	 * The CPU is online, so send it a reschedule IPI.  An adaptive-tick
+	 * CPU also needs its tick back to report the quiescent state.
+	 */
+	tick_nohz_full_kick_cpu(rdp->cpu);
 	if (rdp->cpu != smp_processor_id())
 		smp_send_reschedule(rdp->cpu);
 	else
@@ -1109,6 +1117,117 @@ static void rcu_offline_cpu(int cpu)
 
 #endif /* #else #ifdef CONFIG_HOTPLUG_CPU */
 
+#ifdef CONFIG_RCU_NOCB_CPU
+
+/*
+ * CPUs listed in rcu_nocbs= hand their ready callbacks to a per-CPU,
+ * per-flavor kthread instead of invoking them from RCU_SOFTIRQ.  Until
+ * the kthreads are spawned, callbacks are invoked as usual.
+ */
+static cpumask_var_t rcu_nocb_mask;
+static bool have_rcu_nocb_mask;
+
+static int __init rcu_nocb_setup(char *str)
+{
+	alloc_bootmem_cpumask_var(&rcu_nocb_mask);
+	have_rcu_nocb_mask = true;
+	cpulist_parse(str, rcu_nocb_mask);
+	return 1;
+}
+__setup("rcu_nocbs=", rcu_nocb_setup);
+
+/*
+ * Queue the ready callbacks [list, tail) for the rcuo kthread, if this
+ * CPU has one.  Returns the number of callbacks handed off.
+ */
+static long rcu_nocb_enqueue(struct rcu_data *rdp, struct rcu_head *list,
+			     struct rcu_head **tail)
+{
+	struct rcu_head *rhp;
+	unsigned long flags;
+	long count = 0;
+
+	if (!rdp->nocb_kthread)
+		return 0;
+
+	for (rhp = list; rhp; rhp = rhp->next)
+		count++;
+
+	raw_spin_lock_irqsave(&rdp->nocb_lock, flags);
+	*rdp->nocb_tail = list;
+	rdp->nocb_tail = tail;
+	raw_spin_unlock_irqrestore(&rdp->nocb_lock, flags);
+	atomic_long_add(count, &rdp->nocb_q_count);
+	wake_up(&rdp->nocb_wq);
+	return count;
+}
+
+/*
+ * Per-CPU kthread that invokes the callbacks handed off by
+ * rcu_do_batch(), with bottom halves disabled as in RCU_SOFTIRQ.
+ */
+static int rcu_nocb_kthread(void *arg)
+{
+	struct rcu_data *rdp = arg;
+	struct rcu_head *list, *next;
+	unsigned long flags;
+	long count;
+
+	for (;;) {
+		/* Sleep interruptibly so that idle threads stay out of the
+		 * load average and the hung task detector. */
+		if (wait_event_interruptible(rdp->nocb_wq,
+					     ACCESS_ONCE(rdp->nocb_head))) {
+			flush_signals(current);
+			continue;
+		}
+
+		raw_spin_lock_irqsave(&rdp->nocb_lock, flags);
+		list = rdp->nocb_head;
+		rdp->nocb_head = NULL;
+		rdp->nocb_tail = &rdp->nocb_head;
+		raw_spin_unlock_irqrestore(&rdp->nocb_lock, flags);
+
+		count = 0;
+		while (list) {
+			next = list->next;
+			prefetch(next);
+			debug_rcu_head_unqueue(list);
+			local_bh_disable();
+			list->func(list);
+			local_bh_enable();
+			list = next;
+			count++;
+			cond_resched();
+		}
+		atomic_long_sub(count, &rdp->nocb_q_count);
+		rdp->n_nocb_invoked += count;
+	}
+	return 0;
+}
+
+static void __init rcu_boot_init_nocb_percpu_data(struct rcu_data *rdp)
+{
+	rdp->nocb_head = NULL;
+	rdp->nocb_tail = &rdp->nocb_head;
+	raw_spin_lock_init(&rdp->nocb_lock);
+	init_waitqueue_head(&rdp->nocb_wq);
+}
+
+#else /* #ifdef CONFIG_RCU_NOCB_CPU */
+
+static long rcu_nocb_enqueue(struct rcu_data *rdp, struct rcu_head *list,
+			     struct rcu_head **tail)
+{
+	return 0;
+}
+
+static void __init rcu_boot_init_nocb_percpu_data(struct rcu_data *rdp)
+{
+}
+
+#endif /* #else #ifdef CONFIG_RCU_NOCB_CPU */
+
 /*
  * Invoke any RCU callbacks that have made it to the end of their grace
  * period.  Thottle as specified by rdp->blimit.
@@ -1118,6 +1237,7 @@ static void rcu_do_batch(struct rcu_state *rsp, struct rcu_data *rdp)
 	unsigned long flags;
 	struct rcu_head *next, *list, **tail;
 	int count;
+	long offloaded;
 
 	/* If no callbacks are ready, just return.*/
 	if (!cpu_has_callbacks_ready_to_invoke(rdp))
@@ -1137,7 +1257,10 @@ static void rcu_do_batch(struct rcu_state *rsp, struct rcu_data *rdp)
 			rdp->nxttail[count] = &rdp->nxtlist;
 	local_irq_restore(flags);
 
-	/* Invoke callbacks. */
+	/* Hand the callbacks to the rcuo kthread, or invoke them here. */
+	offloaded = rcu_nocb_enqueue(rdp, list, tail);
+	if (offloaded)
+		list = NULL;
 	count = 0;
 	while (list) {
 		next = list->next;
@@ -1152,7 +1275,7 @@ static void rcu_do_batch(struct rcu_state *rsp, struct rcu_data *rdp)
 	local_irq_save(flags);
 
 	/* Update count, and requeue any remaining callbacks. */
-	rdp->qlen -= count;
+	rdp->qlen -= count + offloaded;
 	rdp->n_cbs_invoked += count;
 	if (list != NULL) {
 		*tail = rdp->nxtlist;
@@ -1749,6 +1872,7 @@ rcu_boot_init_percpu_data(int cpu, struct rcu_state *rsp)
 #ifdef CONFIG_NO_HZ
 	rdp->dynticks = &per_cpu(rcu_dynticks, cpu);
 #endif /* #ifdef CONFIG_NO_HZ */
+	rcu_boot_init_nocb_percpu_data(rdp);
 	rdp->cpu = cpu;
 	raw_spin_unlock_irqrestore(&rnp->lock, flags);
 }
@@ -1982,3 +2106,59 @@ void __init rcu_init(void)
 }
 
 #include "rcutree_plugin.h"
+
+#ifdef CONFIG_RCU_NOCB_CPU
+
+static void __init rcu_spawn_one_nocb_kthread(struct rcu_data *rdp,
+					      char abbr,
+					      const struct cpumask *affinity)
+{
+	struct task_struct *t;
+
+	t = kthread_run(rcu_nocb_kthread, rdp, "rcuo%c/%d", abbr, rdp->cpu);
+	if (IS_ERR(t)) {
+		printk(KERN_ERR "RCU: could not spawn rcuo%c/%d\n",
+		       abbr, rdp->cpu);
+		return;
+	}
+	if (affinity)
+		set_cpus_allowed_ptr(t, affinity);
+	ACCESS_ONCE(rdp->nocb_kthread) = t;
+}
+
+/*
+ * Spawn the callback offload kthreads, affined to the CPUs that still
+ * process their own callbacks.
+ */
+static int __init rcu_spawn_nocb_kthreads(void)
+{
+	cpumask_var_t housekeeping;
+	const struct cpumask *affinity = NULL;
+	int cpu;
+
+	if (!have_rcu_nocb_mask)
+		return 0;
+
+	if (zalloc_cpumask_var(&housekeeping, GFP_KERNEL)) {
+		cpumask_andnot(housekeeping, cpu_possible_mask, rcu_nocb_mask);
+		if (!cpumask_empty(housekeeping))
+			affinity = housekeeping;
+	}
+
+	for_each_cpu_and(cpu, rcu_nocb_mask, cpu_possible_mask) {
+		rcu_spawn_one_nocb_kthread(&per_cpu(rcu_sched_data, cpu), 's',
+					   affinity);
+		rcu_spawn_one_nocb_kthread(&per_cpu(rcu_bh_data, cpu), 'b',
+					   affinity);
+#ifdef CONFIG_TREE_PREEMPT_RCU
+		rcu_spawn_one_nocb_kthread(&per_cpu(rcu_preempt_data, cpu), 'p',
+					   affinity);
+#endif /* #ifdef CONFIG_TREE_PREEMPT_RCU */
+	}
+
+	free_cpumask_var(housekeeping);
+	return 0;
+}
+early_initcall(rcu_spawn_nocb_kthreads);
+
+#endif /* #ifdef CONFIG_RCU_NOCB_CPU */
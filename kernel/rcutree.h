@@ -239,6 +239,17 @@ struct rcu_data {
 	unsigned long n_rp_need_fqs;
 	unsigned long n_rp_need_nothing;
 
+#ifdef CONFIG_RCU_NOCB_CPU
+	/* 6) Callbacks offloaded to the rcuo kthread. */
+	struct rcu_head *nocb_head;	/* CBs waiting for the kthread. */
+	struct rcu_head **nocb_tail;
+	atomic_long_t nocb_q_count;	/* # CBs waiting for the kthread. */
+	unsigned long n_nocb_invoked;	/* # CBs invoked by the kthread. */
+	raw_spinlock_t nocb_lock;	/* Protects nocb_head and nocb_tail. */
+	wait_queue_head_t nocb_wq;	/* For the kthread to sleep on. */
+	struct task_struct *nocb_kthread;
+#endif /* #ifdef CONFIG_RCU_NOCB_CPU */
+
 	int cpu;
 };
 
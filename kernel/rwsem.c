@@ -13,6 +13,71 @@
 #include <asm/system.h>
 #include <asm/atomic.h>
 
+#ifdef CONFIG_RWSEM_SPIN_ON_OWNER
+static inline void rwsem_set_owner(struct rw_semaphore *sem)
+{
+	sem->owner = current_thread_info();
+}
+
+static inline void rwsem_clear_owner(struct rw_semaphore *sem)
+{
+	sem->owner = NULL;
+}
+
+/*
+ * Optimistic spinning for writers, as done for mutexes in
+ * __mutex_lock_common(): while the write owner is running on another
+ * CPU it is likely to release the rwsem soon, so spin for it instead
+ * of going to sleep.  Readers are not tracked, so if there is no write
+ * owner we try once and then sleep.  The trylock fails while tasks are
+ * queued, so spinners do not overtake sleeping waiters.
+ */
+static void __down_write_optimistic(struct rw_semaphore *sem)
+{
+	struct thread_info *owner;
+
+	preempt_disable();
+	for (;;) {
+		/*
+		 * If we own the BKL, then don't spin. The owner of
+		 * the rwsem might be waiting on us to release the BKL.
+		 */
+		if (unlikely(current->lock_depth >= 0))
+			break;
+
+		owner = ACCESS_ONCE(sem->owner);
+		if (owner && !rwsem_spin_on_owner(sem, owner))
+			break;
+
+		if (__down_write_trylock(sem)) {
+			preempt_enable();
+			return;
+		}
+
+		if (!owner || need_resched() || rt_task(current))
+			break;
+
+		arch_mutex_cpu_relax();
+	}
+	preempt_enable();
+
+	__down_write(sem);
+}
+#else
+static inline void rwsem_set_owner(struct rw_semaphore *sem)
+{
+}
+
+static inline void rwsem_clear_owner(struct rw_semaphore *sem)
+{
+}
+
+static inline void __down_write_optimistic(struct rw_semaphore *sem)
+{
+	__down_write(sem);
+}
+#endif
+
 /*
  * lock for reading
  */
@@ -48,7 +113,8 @@ void __sched down_write(struct rw_semaphore *sem)
 	might_sleep();
 	rwsem_acquire(&sem->dep_map, 0, 0, _RET_IP_);
 
-	LOCK_CONTENDED(sem, __down_write_trylock, __down_write);
+	LOCK_CONTENDED(sem, __down_write_trylock, __down_write_optimistic);
+	rwsem_set_owner(sem);
 }
 
 EXPORT_SYMBOL(down_write);
@@ -60,8 +126,10 @@ int down_write_trylock(struct rw_semaphore *sem)
 {
 	int ret = __down_write_trylock(sem);
 
-	if (ret == 1)
+	if (ret == 1) {
 		rwsem_acquire(&sem->dep_map, 0, 1, _RET_IP_);
+		rwsem_set_owner(sem);
+	}
 	return ret;
 }
 
@@ -86,6 +154,7 @@ void up_write(struct rw_semaphore *sem)
 {
 	rwsem_release(&sem->dep_map, 1, _RET_IP_);
 
+	rwsem_clear_owner(sem);
 	__up_write(sem);
 }
 
@@ -100,6 +169,7 @@ void downgrade_write(struct rw_semaphore *sem)
 	 * lockdep: a downgraded write will live on as a write
 	 * dependency.
 	 */
+	rwsem_clear_owner(sem);
 	__downgrade_write(sem);
 }
 
@@ -131,7 +201,8 @@ void down_write_nested(struct rw_semaphore *sem, int subclass)
 	might_sleep();
 	rwsem_acquire(&sem->dep_map, subclass, 0, _RET_IP_);
 
-	LOCK_CONTENDED(sem, __down_write_trylock, __down_write);
+	LOCK_CONTENDED(sem, __down_write_trylock, __down_write_optimistic);
+	rwsem_set_owner(sem);
 }
 
 EXPORT_SYMBOL(down_write_nested);
@@ -201,13 +201,21 @@ EXPORT_SYMBOL(local_bh_enable_ip);
  * The two things to balance is latency against fairness -
  * we want to handle softirqs as soon as possible, but they
  * should not be able to lock up the box.
+ *
+ * In addition each vector may only run for MAX_SOFTIRQ_TIME per
+ * invocation of __do_softirq().  A vector that used up its budget
+ * is left pending and handed to ksoftirqd, where it competes with
+ * the interrupted tasks under the scheduler's control, while the
+ * other vectors are still serviced here.
  */
 #define MAX_SOFTIRQ_RESTART 10
+#define MAX_SOFTIRQ_TIME (2 * NSEC_PER_MSEC)
 
 asmlinkage void __do_softirq(void)
 {
 	struct softirq_action *h;
-	__u32 pending;
+	__u32 pending, deferred = 0;
+	u32 spent[NR_SOFTIRQS] = { 0 };
 	int max_restart = MAX_SOFTIRQ_RESTART;
 	int cpu;
 
@@ -220,8 +228,12 @@ asmlinkage void __do_softirq(void)
 
 	cpu = smp_processor_id();
 restart:
-	/* Reset the pending bitmask before enabling irqs */
-	set_softirq_pending(0);
+	/*
+	 * Reset the pending bitmask before enabling irqs, keeping the
+	 * vectors that are over budget for ksoftirqd.
+	 */
+	set_softirq_pending(pending & deferred);
+	pending &= ~deferred;
 
 	local_irq_enable();
 
@@ -231,12 +243,22 @@ restart:
 		if (pending & 1) {
 			unsigned int vec_nr = h - softirq_vec;
 			int prev_count = preempt_count();
+			u64 start, delta;
 
 			kstat_incr_softirqs_this_cpu(vec_nr);
 
 			trace_softirq_entry(vec_nr);
+			start = local_clock();
 			h->action(h);
+			delta = local_clock() - start;
 			trace_softirq_exit(vec_nr);
+
+			kstat_add_softirq_time_this_cpu(vec_nr, delta);
+			if (delta >= MAX_SOFTIRQ_TIME - spent[vec_nr]) {
+				spent[vec_nr] = MAX_SOFTIRQ_TIME;
+				deferred |= 1 << vec_nr;
+			} else
+				spent[vec_nr] += delta;
 			if (unlikely(prev_count != preempt_count())) {
 				printk(KERN_ERR "huh, entered softirq %u %s %p"
 				       "with preempt_count %08x,"
@@ -255,11 +277,14 @@ restart:
 	local_irq_disable();
 
 	pending = local_softirq_pending();
-	if (pending && --max_restart)
+	if ((pending & ~deferred) && --max_restart)
 		goto restart;
 
-	if (pending)
+	if (pending) {
+		if (pending & deferred)
+			__this_cpu_inc(kstat.softirqs_deferred);
 		wakeup_softirqd();
+	}
 
 	lockdep_softirq_exit();
 
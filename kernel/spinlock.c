@@ -372,6 +372,15 @@ void __lockfunc _raw_spin_lock_nest_lock(raw_spinlock_t *lock,
 }
 EXPORT_SYMBOL(_raw_spin_lock_nest_lock);
 
+void __lockfunc _raw_write_lock_nest_lock(rwlock_t *lock,
+				      struct lockdep_map *nest_lock)
+{
+	preempt_disable();
+	rwlock_acquire_nest(&lock->dep_map, 0, 0, nest_lock, _RET_IP_);
+	LOCK_CONTENDED(lock, do_raw_write_trylock, do_raw_write_lock);
+}
+EXPORT_SYMBOL(_raw_write_lock_nest_lock);
+
 #endif
 
 notrace int in_lock_functions(unsigned long addr)
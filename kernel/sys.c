@@ -37,6 +37,7 @@
 #include <linux/ptrace.h>
 #include <linux/fs_struct.h>
 #include <linux/gfp.h>
+#include <linux/poll.h>
 
 #include <linux/compat.h>
 #include <linux/syscalls.h>
@@ -79,6 +80,12 @@
 #ifndef SET_TSC_CTL
 # define SET_TSC_CTL(a)		(-EINVAL)
 #endif
+#ifndef GET_FP_RUNFAST_CTL
+# define GET_FP_RUNFAST_CTL(a)	(-EINVAL)
+#endif
+#ifndef SET_FP_RUNFAST_CTL
+# define SET_FP_RUNFAST_CTL(a,b)	(-EINVAL)
+#endif
 
 /*
  * this is where the system-wide overflow UID and GID are defined, for
@@ -1736,6 +1743,25 @@ SYSCALL_DEFINE5(prctl, int, option, unsigned long, arg2, unsigned long, arg3,
 			else
 				error = PR_MCE_KILL_DEFAULT;
 			break;
+		case PR_GET_FP_RUNFAST:
+			error = GET_FP_RUNFAST_CTL(me);
+			break;
+		case PR_SET_FP_RUNFAST:
+			error = SET_FP_RUNFAST_CTL(me, arg2);
+			break;
+		case PR_GET_POLL_CACHE:
+			if (arg2 | arg3 | arg4 | arg5)
+				return -EINVAL;
+			error = me->poll_cache_enabled;
+			break;
+		case PR_SET_POLL_CACHE:
+			if (arg2 > 1 || arg3 | arg4 | arg5)
+				return -EINVAL;
+			me->poll_cache_enabled = arg2;
+			if (!arg2)
+				poll_cache_release(me);
+			error = 0;
+			break;
 		default:
 			error = -EINVAL;
 			break;
@@ -11,12 +11,14 @@
  *
  *  Distribute under GPLv2.
  */
+#include <linux/bootmem.h>
 #include <linux/cpu.h>
 #include <linux/err.h>
 #include <linux/hrtimer.h>
 #include <linux/interrupt.h>
 #include <linux/kernel_stat.h>
 #include <linux/percpu.h>
+#include <linux/posix-timers.h>
 #include <linux/profile.h>
 #include <linux/sched.h>
 #include <linux/tick.h>
@@ -124,6 +126,191 @@ static int __init setup_tick_nohz(char *str)
 
 __setup("nohz=", setup_tick_nohz);
 
+#ifdef CONFIG_NO_HZ_FULL
+/*
+ * Adaptive ticks: a cpu in tick_nohz_full_mask that runs a single task
+ * in user space defers its tick to the next timer wheel event, but at
+ * most TICK_NOHZ_FULL_MAX_DEFER jiffies.  The boot cpu keeps ticking
+ * and does the timekeeping.  Anything that needs the tick back - a
+ * second task, a new timer, a grace period waiting for this cpu - kicks
+ * it with tick_nohz_full_kick_cpu().
+ */
+#define TICK_NOHZ_FULL_MAX_DEFER	HZ
+
+bool tick_nohz_full_running;
+static cpumask_var_t tick_nohz_full_mask;
+static DEFINE_PER_CPU(struct call_single_data, tick_nohz_full_csd);
+
+static int __init setup_tick_nohz_full(char *str)
+{
+	int cpu = smp_processor_id();
+
+	alloc_bootmem_cpumask_var(&tick_nohz_full_mask);
+	if (cpulist_parse(str, tick_nohz_full_mask) < 0) {
+		printk(KERN_WARNING "NOHZ: Incorrect nohz_full cpu list\n");
+		return 1;
+	}
+
+	if (cpumask_test_cpu(cpu, tick_nohz_full_mask)) {
+		printk(KERN_WARNING "NOHZ: Clearing boot CPU %d from nohz_full, "
+		       "it does the timekeeping\n", cpu);
+		cpumask_clear_cpu(cpu, tick_nohz_full_mask);
+	}
+
+	tick_nohz_full_running = !cpumask_empty(tick_nohz_full_mask);
+	return 1;
+}
+
+__setup("nohz_full=", setup_tick_nohz_full);
+
+/*
+ * The timekeeping cpu must not stop its tick while adaptive-tick cpus
+ * rely on it for jiffies.
+ */
+static inline int tick_nohz_full_keep_tick(int cpu)
+{
+	return tick_nohz_full_running && cpu == tick_do_timer_cpu;
+}
+
+static int tick_nohz_full_can_defer(int cpu, struct pt_regs *regs)
+{
+	if (!cpumask_test_cpu(cpu, tick_nohz_full_mask))
+		return 0;
+
+	/*
+	 * Only defer from user mode: this tick then reported the
+	 * quiescent state to RCU, and no kernel work is waiting on it.
+	 */
+	if (!regs || !user_mode(regs))
+		return 0;
+
+	if (cpu == tick_do_timer_cpu)
+		return 0;
+
+	if (!sched_can_stop_tick() || !posix_cpu_timers_can_stop_tick(current))
+		return 0;
+
+	if (rcu_needs_cpu(cpu) || printk_needs_cpu(cpu) || arch_needs_cpu(cpu))
+		return 0;
+
+	return 1;
+}
+
+/*
+ * Called at the end of tick_sched_timer() to push the next tick out.
+ * Returns 0 if the tick has to stay periodic.
+ */
+static int tick_nohz_full_defer(struct tick_sched *ts, int cpu,
+				struct pt_regs *regs)
+{
+	unsigned long seq, last_jiffies;
+	ktime_t last_update;
+	long delta_jiffies;
+
+	if (!tick_nohz_full_running)
+		return 0;
+
+	/*
+	 * Publish the deferral before checking the conditions, pairs
+	 * with the barrier in __tick_nohz_full_kick_cpu(): either we see
+	 * the second task or the kicker sees full_deferred.
+	 */
+	ts->full_deferred = 1;
+	smp_mb();
+
+	if (!tick_nohz_full_can_defer(cpu, regs))
+		goto out_periodic;
+
+	do {
+		seq = read_seqbegin(&xtime_lock);
+		last_update = last_jiffies_update;
+		last_jiffies = jiffies;
+	} while (read_seqretry(&xtime_lock, seq));
+
+	delta_jiffies = get_next_timer_interrupt(last_jiffies) - last_jiffies;
+	if (delta_jiffies <= 1)
+		goto out_periodic;
+	delta_jiffies = min_t(long, delta_jiffies, TICK_NOHZ_FULL_MAX_DEFER);
+
+	ts->full_last_tick = hrtimer_get_expires(&ts->sched_timer);
+	hrtimer_set_expires(&ts->sched_timer,
+			    ktime_add_ns(last_update,
+					 tick_period.tv64 * delta_jiffies));
+	return 1;
+
+out_periodic:
+	ts->full_deferred = 0;
+	return 0;
+}
+
+/*
+ * Account the ticks skipped since the tick was deferred to the task
+ * that ran alone meanwhile; update_process_times() does the current one.
+ */
+static void tick_nohz_full_account(struct tick_sched *ts, struct pt_regs *regs)
+{
+	u64 ticks;
+
+	if (!ts->full_deferred)
+		return;
+	ts->full_deferred = 0;
+
+	if (!regs)
+		return;
+
+	ticks = ktime_divns(ktime_sub(hrtimer_get_expires(&ts->sched_timer),
+				      ts->full_last_tick),
+			    ktime_to_ns(tick_period));
+	while (ticks-- > 1)
+		account_process_tick(current, user_mode(regs));
+}
+
+static void tick_nohz_full_restart(void *info)
+{
+	struct tick_sched *ts = &__get_cpu_var(tick_cpu_sched);
+	unsigned long flags;
+
+	local_irq_save(flags);
+	clear_bit(0, &ts->full_kick_pending);
+	if (ts->full_deferred &&
+	    hrtimer_try_to_cancel(&ts->sched_timer) >= 0) {
+		/* fire at the next tick boundary, it accounts the gap */
+		hrtimer_set_expires(&ts->sched_timer, ts->full_last_tick);
+		hrtimer_forward(&ts->sched_timer, ktime_get(), tick_period);
+		/* may run under rq->lock, so no softirq wakeup */
+		__hrtimer_start_range_ns(&ts->sched_timer,
+					 hrtimer_get_expires(&ts->sched_timer),
+					 0, HRTIMER_MODE_ABS_PINNED, 0);
+	}
+	local_irq_restore(flags);
+}
+
+void __tick_nohz_full_kick_cpu(int cpu)
+{
+	struct tick_sched *ts = &per_cpu(tick_cpu_sched, cpu);
+	struct call_single_data *csd;
+
+	smp_mb();
+	if (!ts->full_deferred)
+		return;
+
+	if (cpu == get_cpu()) {
+		tick_nohz_full_restart(NULL);
+	} else if (!test_and_set_bit(0, &ts->full_kick_pending)) {
+		csd = &per_cpu(tick_nohz_full_csd, cpu);
+		csd->func = tick_nohz_full_restart;
+		csd->info = NULL;
+		__smp_call_function_single(cpu, csd, 0);
+	}
+	put_cpu();
+}
+#else
+static inline int tick_nohz_full_keep_tick(int cpu)
+{
+	return 0;
+}
+#endif /* CONFIG_NO_HZ_FULL */
+
 /**
  * tick_nohz_update_jiffies - update jiffies when idle was interrupted
  *
@@ -325,7 +512,7 @@ void tick_nohz_stop_sched_tick(int inidle)
 	} while (read_seqretry(&xtime_lock, seq));
 
 	if (rcu_needs_cpu(cpu) || printk_needs_cpu(cpu) ||
-	    arch_needs_cpu(cpu)) {
+	    arch_needs_cpu(cpu) || tick_nohz_full_keep_tick(cpu)) {
 		next_jiffies = last_jiffies + 1;
 		delta_jiffies = 1;
 	} else {
@@ -740,6 +927,10 @@ static enum hrtimer_restart tick_sched_timer(struct hrtimer *timer)
 	if (tick_do_timer_cpu == cpu)
 		tick_do_update_jiffies64(now);
 
+#ifdef CONFIG_NO_HZ_FULL
+	tick_nohz_full_account(ts, regs);
+#endif
+
 	/*
 	 * Do not call, when we are not in irq context and have
 	 * no valid regs pointer
@@ -761,6 +952,11 @@ static enum hrtimer_restart tick_sched_timer(struct hrtimer *timer)
 		profile_tick(CPU_PROFILING);
 	}
 
+#ifdef CONFIG_NO_HZ_FULL
+	if (tick_nohz_full_defer(ts, cpu, regs))
+		return HRTIMER_RESTART;
+#endif
+
 	hrtimer_forward(timer, now, tick_period);
 
 	return HRTIMER_RESTART;
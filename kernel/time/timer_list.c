@@ -157,6 +157,20 @@ static void print_cpu(struct seq_file *m, int cpu, u64 now)
 #undef P
 #undef P_ns
 
+	{
+		struct timer_wheel_stats ws;
+
+		timer_get_wheel_stats(cpu, &ws);
+		SEQ_printf(m, "  .%-15s: %Lu\n", "wheel_ticks",
+			   (unsigned long long)ws.ticks);
+		SEQ_printf(m, "  .%-15s: %Lu\n", "wheel_expired",
+			   (unsigned long long)ws.expired);
+		SEQ_printf(m, "  .%-15s: %Lu\n", "wheel_max_batch",
+			   (unsigned long long)ws.max_batch);
+		SEQ_printf(m, "  .%-15s: %Lu\n", "wheel_skipped",
+			   (unsigned long long)ws.skipped);
+	}
+
 #ifdef CONFIG_TICK_ONESHOT
 # define P(x) \
 	SEQ_printf(m, "  .%-15s: %Lu\n", #x, \
@@ -259,7 +273,7 @@ static int timer_list_show(struct seq_file *m, void *v)
 	u64 now = ktime_to_ns(ktime_get());
 	int cpu;
 
-	SEQ_printf(m, "Timer List Version: v0.6\n");
+	SEQ_printf(m, "Timer List Version: v0.7\n");
 	SEQ_printf(m, "HRTIMER_MAX_CLOCK_BASES: %d\n", HRTIMER_MAX_CLOCK_BASES);
 	SEQ_printf(m, "now at %Ld nsecs\n", (unsigned long long)now);
 
@@ -55,33 +55,52 @@ u64 jiffies_64 __cacheline_aligned_in_smp = INITIAL_JIFFIES;
 EXPORT_SYMBOL(jiffies_64);
 
 /*
- * per-CPU timer vector definitions:
+ * per-CPU timer wheel definitions:
+ *
+ * The wheel has LVL_DEPTH levels of LVL_SIZE buckets.  The granularity
+ * of a level is LVL_CLK_DIV times the one of the level below, so level 0
+ * is exact and outer levels fire up to 1/8th late.  Timers are queued
+ * once, in the level matching their timeout, and never cascade: a
+ * bucket expires as a whole when the wheel clock reaches it.  Timers
+ * beyond the range of the outermost level sit in its last bucket and
+ * are requeued from there until they are due.
+ *
+ * With HZ=1000 this covers ~12 days with 1ms granularity for the first
+ * 63ms, 8ms up to ~0.5s, 64ms up to ~4s, 512ms up to ~32s and so on.
  */
-#define TVN_BITS (CONFIG_BASE_SMALL ? 4 : 6)
-#define TVR_BITS (CONFIG_BASE_SMALL ? 6 : 8)
-#define TVN_SIZE (1 << TVN_BITS)
-#define TVR_SIZE (1 << TVR_BITS)
-#define TVN_MASK (TVN_SIZE - 1)
-#define TVR_MASK (TVR_SIZE - 1)
-
-struct tvec {
-	struct list_head vec[TVN_SIZE];
-};
+#define LVL_CLK_SHIFT	3
+#define LVL_CLK_DIV	(1UL << LVL_CLK_SHIFT)
+#define LVL_CLK_MASK	(LVL_CLK_DIV - 1)
+#define LVL_SHIFT(n)	((n) * LVL_CLK_SHIFT)
+#define LVL_GRAN(n)	(1UL << LVL_SHIFT(n))
+
+#define LVL_BITS	6
+#define LVL_SIZE	(1UL << LVL_BITS)
+#define LVL_MASK	(LVL_SIZE - 1)
+#define LVL_OFFS(n)	((n) * LVL_SIZE)
+
+/* First timeout (in jiffies) handled by level n */
+#define LVL_START(n)	((LVL_SIZE - 1) << (((n) - 1) * LVL_CLK_SHIFT))
+
+#if HZ > 100
+# define LVL_DEPTH	9
+#else
+# define LVL_DEPTH	8
+#endif
 
-struct tvec_root {
-	struct list_head vec[TVR_SIZE];
-};
+#define WHEEL_SIZE	(LVL_SIZE * LVL_DEPTH)
+#define WHEEL_TIMEOUT_CUTOFF	(LVL_START(LVL_DEPTH))
+#define WHEEL_TIMEOUT_MAX	\
+	(WHEEL_TIMEOUT_CUTOFF - LVL_GRAN(LVL_DEPTH - 1))
 
 struct tvec_base {
 	spinlock_t lock;
 	struct timer_list *running_timer;
 	unsigned long timer_jiffies;
 	unsigned long next_timer;
-	struct tvec_root tv1;
-	struct tvec tv2;
-	struct tvec tv3;
-	struct tvec tv4;
-	struct tvec tv5;
+	struct timer_wheel_stats stats;
+	DECLARE_BITMAP(pending_map, WHEEL_SIZE);
+	struct list_head vectors[WHEEL_SIZE];
 } ____cacheline_aligned;
 
 struct tvec_base boot_tvec_bases;
@@ -330,46 +349,136 @@ void set_timer_slack(struct timer_list *timer, int slack_hz)
 }
 EXPORT_SYMBOL_GPL(set_timer_slack);
 
-static void internal_add_timer(struct tvec_base *base, struct timer_list *timer)
+/*
+ * Bucket of level @lvl for @expires, rounded up to the level granularity
+ * so that a timer never fires early.  The jiffy the bucket expires at is
+ * returned in @bucket_expiry.
+ */
+static inline unsigned int calc_index(unsigned long expires, unsigned int lvl,
+				      unsigned long *bucket_expiry)
 {
-	unsigned long expires = timer->expires;
-	unsigned long idx = expires - base->timer_jiffies;
-	struct list_head *vec;
-
-	if (idx < TVR_SIZE) {
-		int i = expires & TVR_MASK;
-		vec = base->tv1.vec + i;
-	} else if (idx < 1 << (TVR_BITS + TVN_BITS)) {
-		int i = (expires >> TVR_BITS) & TVN_MASK;
-		vec = base->tv2.vec + i;
-	} else if (idx < 1 << (TVR_BITS + 2 * TVN_BITS)) {
-		int i = (expires >> (TVR_BITS + TVN_BITS)) & TVN_MASK;
-		vec = base->tv3.vec + i;
-	} else if (idx < 1 << (TVR_BITS + 3 * TVN_BITS)) {
-		int i = (expires >> (TVR_BITS + 2 * TVN_BITS)) & TVN_MASK;
-		vec = base->tv4.vec + i;
-	} else if ((signed long) idx < 0) {
+	expires = (expires + LVL_GRAN(lvl) - 1) >> LVL_SHIFT(lvl);
+	*bucket_expiry = expires << LVL_SHIFT(lvl);
+	return LVL_OFFS(lvl) + (expires & LVL_MASK);
+}
+
+static unsigned int calc_wheel_index(unsigned long expires, unsigned long clk,
+				     unsigned long *bucket_expiry)
+{
+	unsigned long delta = expires - clk;
+	unsigned int lvl;
+
+	if ((long)delta < 0) {
 		/*
 		 * Can happen if you add a timer with expires == jiffies,
 		 * or you set a timer to go off in the past
 		 */
-		vec = base->tv1.vec + (base->timer_jiffies & TVR_MASK);
-	} else {
-		int i;
-		/* If the timeout is larger than 0xffffffff on 64-bit
-		 * architectures then we use the maximum timeout:
+		*bucket_expiry = clk;
+		return clk & LVL_MASK;
+	}
+
+	for (lvl = 0; lvl < LVL_DEPTH - 1; lvl++)
+		if (delta < LVL_START(lvl + 1))
+			return calc_index(expires, lvl, bucket_expiry);
+
+	/*
+	 * Beyond the wheel: park the timer in the last bucket of the
+	 * outermost level; __run_timers() requeues it until it is due.
+	 */
+	if (delta >= WHEEL_TIMEOUT_CUTOFF)
+		expires = clk + WHEEL_TIMEOUT_MAX;
+	return calc_index(expires, LVL_DEPTH - 1, bucket_expiry);
+}
+
+#ifdef CONFIG_NO_HZ
+/*
+ * Find the first expiring bucket, optionally ignoring buckets which
+ * only hold deferrable timers.  Returns the jiffy it expires at, at
+ * most NEXT_TIMER_MAX_DELTA after ->timer_jiffies.  Must be called
+ * with the base lock held.
+ */
+static unsigned long __next_timer_interrupt(struct tvec_base *base,
+					    bool skip_deferrable)
+{
+	unsigned long clk = base->timer_jiffies;
+	unsigned long expires = clk + NEXT_TIMER_MAX_DELTA;
+	unsigned int lvl, i;
+
+	for (lvl = 0; lvl < LVL_DEPTH; lvl++) {
+		/*
+		 * The buckets of a level cover the 64 units starting with
+		 * the first one that has not been collected yet.
 		 */
-		if (idx > 0xffffffffUL) {
-			idx = 0xffffffffUL;
-			expires = idx + base->timer_jiffies;
+		unsigned long unit;
+
+		unit = (clk + LVL_GRAN(lvl) - 1) >> LVL_SHIFT(lvl);
+
+		for (i = 0; i < LVL_SIZE; i++) {
+			unsigned int idx = LVL_OFFS(lvl) +
+					   ((unit + i) & LVL_MASK);
+			unsigned long bucket_expiry;
+			struct timer_list *nte;
+
+			if (!test_bit(idx, base->pending_map))
+				continue;
+			if (skip_deferrable) {
+				list_for_each_entry(nte, base->vectors + idx,
+						    entry)
+					if (!tbase_get_deferrable(nte->base))
+						break;
+				if (&nte->entry == base->vectors + idx)
+					continue;
+			}
+			bucket_expiry = (unit + i) << LVL_SHIFT(lvl);
+			if (time_before(bucket_expiry, expires))
+				expires = bucket_expiry;
+			break;
 		}
-		i = (expires >> (TVR_BITS + 3 * TVN_BITS)) & TVN_MASK;
-		vec = base->tv5.vec + i;
 	}
+	return expires;
+}
+
+/*
+ * After an idle period, step ->timer_jiffies straight to the first
+ * expiring bucket instead of walking every jiffy in between.
+ */
+static void forward_timer_base(struct tvec_base *base)
+{
+	unsigned long now = jiffies, next;
+
+	if ((long)(now - base->timer_jiffies) < 2)
+		return;
+
+	next = __next_timer_interrupt(base, false);
+	if (time_after(next, now))
+		next = now;
+	if (time_after(next, base->timer_jiffies)) {
+		base->stats.skipped += next - base->timer_jiffies;
+		base->timer_jiffies = next;
+	}
+}
+#else
+static inline void forward_timer_base(struct tvec_base *base) { }
+#endif
+
+static void internal_add_timer(struct tvec_base *base, struct timer_list *timer)
+{
+	unsigned long bucket_expiry;
+	unsigned int idx;
+
+	/* Don't let a stale clock coarsen the placement */
+	forward_timer_base(base);
+	idx = calc_wheel_index(timer->expires, base->timer_jiffies,
+			       &bucket_expiry);
 	/*
 	 * Timers are FIFO:
 	 */
-	list_add_tail(&timer->entry, vec);
+	list_add_tail(&timer->entry, base->vectors + idx);
+	__set_bit(idx, base->pending_map);
+
+	if (time_before(bucket_expiry, base->next_timer) &&
+	    !tbase_get_deferrable(timer->base))
+		base->next_timer = bucket_expiry;
 }
 
 #ifdef CONFIG_TIMER_STATS
@@ -615,13 +724,32 @@ static inline void detach_timer(struct timer_list *timer,
 	entry->prev = LIST_POISON2;
 }
 
+/*
+ * Remove a queued timer from the wheel, clearing the bucket's pending
+ * bit and invalidating ->next_timer when the bucket runs empty.
+ */
+static void detach_wheel_timer(struct tvec_base *base,
+			       struct timer_list *timer, int clear_pending)
+{
+	struct list_head *prev = timer->entry.prev;
+
+	detach_timer(timer, clear_pending);
+
+	if (list_empty(prev) && prev >= base->vectors &&
+	    prev < base->vectors + WHEEL_SIZE) {
+		__clear_bit(prev - base->vectors, base->pending_map);
+		if (!tbase_get_deferrable(timer->base))
+			base->next_timer = base->timer_jiffies;
+	}
+}
+
 /*
  * We are using hashed locking: holding per_cpu(tvec_bases).lock
  * means that all timers which are tied to this base via timer->base are
  * locked, and the base itself is locked too.
  *
  * So __run_timers/migrate_timers can safely modify all timers which could
- * be found on ->tvX lists.
+ * be found on the wheel lists.
  *
  * When the timer's base is locked, and the timer removed from list, it is
  * possible to set timer->base = NULL and drop the lock: the timer remains
@@ -661,10 +789,7 @@ __mod_timer(struct timer_list *timer, unsigned long expires,
 	base = lock_timer_base(timer, &flags);
 
 	if (timer_pending(timer)) {
-		detach_timer(timer, 0);
-		if (timer->expires == base->next_timer &&
-		    !tbase_get_deferrable(timer->base))
-			base->next_timer = base->timer_jiffies;
+		detach_wheel_timer(base, timer, 0);
 		ret = 1;
 	} else {
 		if (pending_only)
@@ -700,11 +825,12 @@ __mod_timer(struct timer_list *timer, unsigned long expires,
 	}
 
 	timer->expires = expires;
-	if (time_before(timer->expires, base->next_timer) &&
-	    !tbase_get_deferrable(timer->base))
-		base->next_timer = timer->expires;
 	internal_add_timer(base, timer);
 
+	/* an adaptive-tick cpu must reevaluate its deferred tick */
+	if (base == new_base)
+		tick_nohz_full_kick_cpu(cpu);
+
 out_unlock:
 	spin_unlock_irqrestore(&base->lock, flags);
 
@@ -863,9 +989,6 @@ void add_timer_on(struct timer_list *timer, int cpu)
 	spin_lock_irqsave(&base->lock, flags);
 	timer_set_base(timer, base);
 	debug_activate(timer, timer->expires);
-	if (time_before(timer->expires, base->next_timer) &&
-	    !tbase_get_deferrable(timer->base))
-		base->next_timer = timer->expires;
 	internal_add_timer(base, timer);
 	/*
 	 * Check whether the other CPU is idle and needs to be
@@ -876,6 +999,7 @@ void add_timer_on(struct timer_list *timer, int cpu)
 	 * the timer wheel.
 	 */
 	wake_up_idle_cpu(cpu);
+	tick_nohz_full_kick_cpu(cpu);
 	spin_unlock_irqrestore(&base->lock, flags);
 }
 EXPORT_SYMBOL_GPL(add_timer_on);
@@ -901,10 +1025,7 @@ int del_timer(struct timer_list *timer)
 	if (timer_pending(timer)) {
 		base = lock_timer_base(timer, &flags);
 		if (timer_pending(timer)) {
-			detach_timer(timer, 1);
-			if (timer->expires == base->next_timer &&
-			    !tbase_get_deferrable(timer->base))
-				base->next_timer = base->timer_jiffies;
+			detach_wheel_timer(base, timer, 1);
 			ret = 1;
 		}
 		spin_unlock_irqrestore(&base->lock, flags);
@@ -935,10 +1056,7 @@ int try_to_del_timer_sync(struct timer_list *timer)
 	timer_stats_timer_clear_start_info(timer);
 	ret = 0;
 	if (timer_pending(timer)) {
-		detach_timer(timer, 1);
-		if (timer->expires == base->next_timer &&
-		    !tbase_get_deferrable(timer->base))
-			base->next_timer = base->timer_jiffies;
+		detach_wheel_timer(base, timer, 1);
 		ret = 1;
 	}
 out:
@@ -991,26 +1109,6 @@ int del_timer_sync(struct timer_list *timer)
 EXPORT_SYMBOL(del_timer_sync);
 #endif
 
-static int cascade(struct tvec_base *base, struct tvec *tv, int index)
-{
-	/* cascade all the timers from tv up one level */
-	struct timer_list *timer, *tmp;
-	struct list_head tv_list;
-
-	list_replace_init(tv->vec + index, &tv_list);
-
-	/*
-	 * We are removing _all_ timers from the list, so we
-	 * don't have to detach them individually.
-	 */
-	list_for_each_entry_safe(timer, tmp, &tv_list, entry) {
-		BUG_ON(tbase_get_base(timer->base) != base);
-		internal_add_timer(base, timer);
-	}
-
-	return index;
-}
-
 static void call_timer_fn(struct timer_list *timer, void (*fn)(unsigned long),
 			  unsigned long data)
 {
@@ -1052,14 +1150,33 @@ static void call_timer_fn(struct timer_list *timer, void (*fn)(unsigned long),
 	}
 }
 
-#define INDEX(N) ((base->timer_jiffies >> (TVR_BITS + (N) * TVN_BITS)) & TVN_MASK)
+/*
+ * Move the buckets expiring at ->timer_jiffies, on every level whose
+ * granularity the clock is aligned to, onto @work_list.
+ */
+static void collect_expired_timers(struct tvec_base *base,
+				   struct list_head *work_list)
+{
+	unsigned long clk = base->timer_jiffies;
+	unsigned int lvl, idx;
+
+	for (lvl = 0; lvl < LVL_DEPTH; lvl++) {
+		idx = LVL_OFFS(lvl) + (clk & LVL_MASK);
+		if (__test_and_clear_bit(idx, base->pending_map))
+			list_splice_tail_init(base->vectors + idx, work_list);
+		/* Is it time to look at the next level? */
+		if (clk & LVL_CLK_MASK)
+			break;
+		clk >>= LVL_CLK_SHIFT;
+	}
+}
 
 /**
  * __run_timers - run all expired timers (if any) on this CPU.
  * @base: the timer vector to be processed.
  *
- * This function cascades all vectors and executes all expired timer
- * vectors.
+ * This function executes all timers which expired since the last run,
+ * a whole tick's worth of buckets at a time.
  */
 static inline void __run_timers(struct tvec_base *base)
 {
@@ -1069,23 +1186,27 @@ static inline void __run_timers(struct tvec_base *base)
 	while (time_after_eq(jiffies, base->timer_jiffies)) {
 		struct list_head work_list;
 		struct list_head *head = &work_list;
-		int index = base->timer_jiffies & TVR_MASK;
+		unsigned long clk, count = 0;
+
+		forward_timer_base(base);
+		INIT_LIST_HEAD(head);
+		collect_expired_timers(base, head);
+		clk = base->timer_jiffies++;
+		base->stats.ticks++;
 
-		/*
-		 * Cascade timers:
-		 */
-		if (!index &&
-			(!cascade(base, &base->tv2, INDEX(0))) &&
-				(!cascade(base, &base->tv3, INDEX(1))) &&
-					!cascade(base, &base->tv4, INDEX(2)))
-			cascade(base, &base->tv5, INDEX(3));
-		++base->timer_jiffies;
-		list_replace_init(base->tv1.vec + index, &work_list);
 		while (!list_empty(head)) {
 			void (*fn)(unsigned long);
 			unsigned long data;
 
 			timer = list_first_entry(head, struct timer_list,entry);
+
+			/* Parked beyond the wheel range and not due yet */
+			if (unlikely(time_after(timer->expires, clk))) {
+				list_del(&timer->entry);
+				internal_add_timer(base, timer);
+				continue;
+			}
+
 			fn = timer->function;
 			data = timer->data;
 
@@ -1093,92 +1214,37 @@ static inline void __run_timers(struct tvec_base *base)
 
 			base->running_timer = timer;
 			detach_timer(timer, 1);
+			count++;
 
 			spin_unlock_irq(&base->lock);
 			call_timer_fn(timer, fn, data);
 			spin_lock_irq(&base->lock);
 		}
+
+		base->stats.expired += count;
+		if (count > base->stats.max_batch)
+			base->stats.max_batch = count;
 	}
 	base->running_timer = NULL;
 	spin_unlock_irq(&base->lock);
 }
 
-#ifdef CONFIG_NO_HZ
-/*
- * Find out when the next timer event is due to happen. This
- * is used on S/390 to stop all activity when a CPU is idle.
- * This function needs to be called with interrupts disabled.
+/**
+ * timer_get_wheel_stats - read the timer wheel statistics of a CPU
+ * @cpu: the CPU to look at
+ * @stats: where to store the statistics
  */
-static unsigned long __next_timer_interrupt(struct tvec_base *base)
-{
-	unsigned long timer_jiffies = base->timer_jiffies;
-	unsigned long expires = timer_jiffies + NEXT_TIMER_MAX_DELTA;
-	int index, slot, array, found = 0;
-	struct timer_list *nte;
-	struct tvec *varray[4];
-
-	/* Look for timer events in tv1. */
-	index = slot = timer_jiffies & TVR_MASK;
-	do {
-		list_for_each_entry(nte, base->tv1.vec + slot, entry) {
-			if (tbase_get_deferrable(nte->base))
-				continue;
-
-			found = 1;
-			expires = nte->expires;
-			/* Look at the cascade bucket(s)? */
-			if (!index || slot < index)
-				goto cascade;
-			return expires;
-		}
-		slot = (slot + 1) & TVR_MASK;
-	} while (slot != index);
-
-cascade:
-	/* Calculate the next cascade event */
-	if (index)
-		timer_jiffies += TVR_SIZE - index;
-	timer_jiffies >>= TVR_BITS;
-
-	/* Check tv2-tv5. */
-	varray[0] = &base->tv2;
-	varray[1] = &base->tv3;
-	varray[2] = &base->tv4;
-	varray[3] = &base->tv5;
-
-	for (array = 0; array < 4; array++) {
-		struct tvec *varp = varray[array];
-
-		index = slot = timer_jiffies & TVN_MASK;
-		do {
-			list_for_each_entry(nte, varp->vec + slot, entry) {
-				if (tbase_get_deferrable(nte->base))
-					continue;
-
-				found = 1;
-				if (time_before(nte->expires, expires))
-					expires = nte->expires;
-			}
-			/*
-			 * Do we still search for the first timer or are
-			 * we looking up the cascade buckets ?
-			 */
-			if (found) {
-				/* Look at the cascade bucket(s)? */
-				if (!index || slot < index)
-					break;
-				return expires;
-			}
-			slot = (slot + 1) & TVN_MASK;
-		} while (slot != index);
+void timer_get_wheel_stats(int cpu, struct timer_wheel_stats *stats)
+{
+	struct tvec_base *base = per_cpu(tvec_bases, cpu);
+	unsigned long flags;
 
-		if (index)
-			timer_jiffies += TVN_SIZE - index;
-		timer_jiffies >>= TVN_BITS;
-	}
-	return expires;
+	spin_lock_irqsave(&base->lock, flags);
+	*stats = base->stats;
+	spin_unlock_irqrestore(&base->lock, flags);
 }
 
+#ifdef CONFIG_NO_HZ
 /*
  * Check, if the next hrtimer event is before the next timer wheel
  * event:
@@ -1240,7 +1306,7 @@ unsigned long get_next_timer_interrupt(unsigned long now)
 		return now + NEXT_TIMER_MAX_DELTA;
 	spin_lock(&base->lock);
 	if (time_before_eq(base->next_timer, base->timer_jiffies))
-		base->next_timer = __next_timer_interrupt(base);
+		base->next_timer = __next_timer_interrupt(base, true);
 	expires = base->next_timer;
 	spin_unlock(&base->lock);
 
@@ -1620,14 +1686,9 @@ static int __cpuinit init_timers_cpu(int cpu)
 
 	spin_lock_init(&base->lock);
 
-	for (j = 0; j < TVN_SIZE; j++) {
-		INIT_LIST_HEAD(base->tv5.vec + j);
-		INIT_LIST_HEAD(base->tv4.vec + j);
-		INIT_LIST_HEAD(base->tv3.vec + j);
-		INIT_LIST_HEAD(base->tv2.vec + j);
-	}
-	for (j = 0; j < TVR_SIZE; j++)
-		INIT_LIST_HEAD(base->tv1.vec + j);
+	for (j = 0; j < WHEEL_SIZE; j++)
+		INIT_LIST_HEAD(base->vectors + j);
+	bitmap_zero(base->pending_map, WHEEL_SIZE);
 
 	base->timer_jiffies = jiffies;
 	base->next_timer = base->timer_jiffies;
@@ -1643,9 +1704,6 @@ static void migrate_timer_list(struct tvec_base *new_base, struct list_head *hea
 		timer = list_first_entry(head, struct timer_list, entry);
 		detach_timer(timer, 0);
 		timer_set_base(timer, new_base);
-		if (time_before(timer->expires, new_base->next_timer) &&
-		    !tbase_get_deferrable(timer->base))
-			new_base->next_timer = timer->expires;
 		internal_add_timer(new_base, timer);
 	}
 }
@@ -1668,14 +1726,9 @@ static void __cpuinit migrate_timers(int cpu)
 
 	BUG_ON(old_base->running_timer);
 
-	for (i = 0; i < TVR_SIZE; i++)
-		migrate_timer_list(new_base, old_base->tv1.vec + i);
-	for (i = 0; i < TVN_SIZE; i++) {
-		migrate_timer_list(new_base, old_base->tv2.vec + i);
-		migrate_timer_list(new_base, old_base->tv3.vec + i);
-		migrate_timer_list(new_base, old_base->tv4.vec + i);
-		migrate_timer_list(new_base, old_base->tv5.vec + i);
-	}
+	for (i = 0; i < WHEEL_SIZE; i++)
+		migrate_timer_list(new_base, old_base->vectors + i);
+	bitmap_zero(old_base->pending_map, WHEEL_SIZE);
 
 	spin_unlock(&old_base->lock);
 	spin_unlock_irq(&new_base->lock);
@@ -258,6 +258,13 @@ static void ftrace_update_pid_func(void)
 }
 
 #ifdef CONFIG_FUNCTION_PROFILER
+/*
+ * Call durations are histogrammed in power of two microsecond slots:
+ * slot 0 holds calls below 1us, slot n calls of [2^(n-1), 2^n) us and
+ * the last slot everything longer.
+ */
+#define FTRACE_PROFILE_HIST_SLOTS	16
+
 struct ftrace_profile {
 	struct hlist_node		node;
 	unsigned long			ip;
@@ -265,6 +272,7 @@ struct ftrace_profile {
 #ifdef CONFIG_FUNCTION_GRAPH_TRACER
 	unsigned long long		time;
 	unsigned long long		time_squared;
+	unsigned int			hist[FTRACE_PROFILE_HIST_SLOTS];
 #endif
 };
 
@@ -280,6 +288,9 @@ struct ftrace_profile_stat {
 	struct ftrace_profile_page	*pages;
 	struct ftrace_profile_page	*start;
 	struct tracer_stat		stat;
+#ifdef CONFIG_FUNCTION_GRAPH_TRACER
+	struct tracer_stat		hist_stat;
+#endif
 };
 
 #define PROFILE_RECORDS_SIZE						\
@@ -430,6 +441,59 @@ out:
 	return ret;
 }
 
+#ifdef CONFIG_FUNCTION_GRAPH_TRACER
+static void *function_hist_start(struct tracer_stat *trace)
+{
+	struct ftrace_profile_stat *stat =
+		container_of(trace, struct ftrace_profile_stat, hist_stat);
+
+	if (!stat || !stat->start)
+		return NULL;
+
+	return function_stat_next(&stat->start->records[0], 0);
+}
+
+static int function_hist_headers(struct seq_file *m)
+{
+	int i;
+
+	seq_printf(m, "  Function                               Hit");
+	seq_printf(m, "       <1");
+	for (i = 1; i < FTRACE_PROFILE_HIST_SLOTS - 1; i++)
+		seq_printf(m, " %8lu", 1UL << i);
+	seq_printf(m, "   longer\n");
+	seq_printf(m, "  --------                               ---");
+	seq_printf(m, "  (us)\n");
+	return 0;
+}
+
+static int function_hist_show(struct seq_file *m, void *v)
+{
+	struct ftrace_profile *rec = v;
+	char str[KSYM_SYMBOL_LEN];
+	int ret = 0;
+	int i;
+
+	mutex_lock(&ftrace_profile_lock);
+
+	/* we raced with function_profile_reset() */
+	if (unlikely(rec->counter == 0)) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	kallsyms_lookup(rec->ip, NULL, NULL, NULL, str);
+	seq_printf(m, "  %-30.30s  %10lu", str, rec->counter);
+	for (i = 0; i < FTRACE_PROFILE_HIST_SLOTS; i++)
+		seq_printf(m, " %8u", rec->hist[i]);
+	seq_putc(m, '\n');
+out:
+	mutex_unlock(&ftrace_profile_lock);
+
+	return ret;
+}
+#endif
+
 static void ftrace_profile_reset(struct ftrace_profile_stat *stat)
 {
 	struct ftrace_profile_page *pg;
@@ -657,10 +721,29 @@ function_profile_call(unsigned long ip, unsigned long parent_ip)
 #ifdef CONFIG_FUNCTION_GRAPH_TRACER
 static int profile_graph_entry(struct ftrace_graph_ent *trace)
 {
+	/* only profile set_graph_function and what they call */
+	if (!(trace->depth || ftrace_graph_addr(trace->func)))
+		return 0;
+
 	function_profile_call(trace->func, 0);
 	return 1;
 }
 
+static inline int profile_hist_slot(unsigned long long calltime)
+{
+	unsigned long us;
+	int slot;
+
+	do_div(calltime, NSEC_PER_USEC);
+	if (calltime >= 1ULL << (FTRACE_PROFILE_HIST_SLOTS - 2))
+		return FTRACE_PROFILE_HIST_SLOTS - 1;
+
+	us = calltime;
+	slot = us ? ilog2(us) + 1 : 0;
+
+	return slot;
+}
+
 static void profile_graph_return(struct ftrace_graph_ret *trace)
 {
 	struct ftrace_profile_stat *stat;
@@ -698,6 +781,7 @@ static void profile_graph_return(struct ftrace_graph_ret *trace)
 	if (rec) {
 		rec->time += calltime;
 		rec->time_squared += calltime * calltime;
+		rec->hist[profile_hist_slot(calltime)]++;
 	}
 
  out:
@@ -813,6 +897,43 @@ static struct tracer_stat function_stats __initdata = {
 	.stat_show	= function_stat_show
 };
 
+#ifdef CONFIG_FUNCTION_GRAPH_TRACER
+static struct tracer_stat function_hists __initdata = {
+	.name		= "function_hists",
+	.stat_start	= function_hist_start,
+	.stat_next	= function_stat_next,
+	.stat_cmp	= function_stat_cmp,
+	.stat_headers	= function_hist_headers,
+	.stat_show	= function_hist_show
+};
+
+static __init int ftrace_profile_hist_register(struct ftrace_profile_stat *stat,
+					       int cpu)
+{
+	char *name;
+	int ret;
+
+	name = kmalloc(32, GFP_KERNEL);
+	if (!name)
+		return -ENOMEM;
+
+	stat->hist_stat = function_hists;
+	snprintf(name, 32, "function_hist%d", cpu);
+	stat->hist_stat.name = name;
+	ret = register_stat_tracer(&stat->hist_stat);
+	if (ret)
+		kfree(name);
+
+	return ret;
+}
+#else
+static inline int ftrace_profile_hist_register(struct ftrace_profile_stat *stat,
+					       int cpu)
+{
+	return 0;
+}
+#endif
+
 static __init void ftrace_profile_debugfs(struct dentry *d_tracer)
 {
 	struct ftrace_profile_stat *stat;
@@ -847,6 +968,12 @@ static __init void ftrace_profile_debugfs(struct dentry *d_tracer)
 			kfree(name);
 			return;
 		}
+		if (ftrace_profile_hist_register(stat, cpu)) {
+			WARN(1,
+			     "Could not register function histogram for cpu %d\n",
+			     cpu);
+			return;
+		}
 	}
 
 	entry = debugfs_create_file("function_profile_enabled", 0644,
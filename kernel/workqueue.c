@@ -41,6 +41,8 @@
 #include <linux/debug_locks.h>
 #include <linux/lockdep.h>
 #include <linux/idr.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include "workqueue_sched.h"
 
@@ -152,6 +154,7 @@ struct global_cwq {
 
 	int			nr_workers;	/* L: total number of workers */
 	int			nr_idle;	/* L: currently idle ones */
+	unsigned long		nr_created;	/* L: workers ever started */
 
 	/* workers are chained either in the idle_list or busy_hash */
 	struct list_head	idle_list;	/* X: list of idle workers */
@@ -169,6 +172,23 @@ struct global_cwq {
 	struct worker		*first_idle;	/* L: first idle worker */
 } ____cacheline_aligned_in_smp;
 
+/*
+ * Queueing statistics of a cwq.  Slot n of wait_hist counts works
+ * which waited less than 2^n usecs between insert_work() and the
+ * start of their callback, the last slot collects everything longer.
+ */
+#define WQ_STATS_HIST_SLOTS	20
+
+struct cwq_stats {
+	u64			queued;		/* works inserted */
+	u64			executed;	/* works started */
+	unsigned int		nr_pending;	/* currently waiting */
+	unsigned int		max_pending;	/* peak of nr_pending */
+	u64			wait_sum;	/* total wait in nsecs */
+	u64			wait_max;	/* longest wait in nsecs */
+	unsigned long		wait_hist[WQ_STATS_HIST_SLOTS];
+};
+
 /*
  * The per-CPU workqueue.  The lower WORK_STRUCT_FLAG_BITS of
  * work_struct->data are used for flags and thus cwqs need to be
@@ -184,6 +204,9 @@ struct cpu_workqueue_struct {
 	int			nr_active;	/* L: nr of active works */
 	int			max_active;	/* L: max active works */
 	struct list_head	delayed_works;	/* L: delayed works */
+#ifdef CONFIG_WORKQUEUE_STATS
+	struct cwq_stats	stats;		/* L: queueing statistics */
+#endif
 };
 
 /*
@@ -897,6 +920,51 @@ static inline struct list_head *gcwq_determine_ins_pos(struct global_cwq *gcwq,
 	return &twork->entry;
 }
 
+#ifdef CONFIG_WORKQUEUE_STATS
+static void cwq_stats_queued(struct cpu_workqueue_struct *cwq,
+			     struct work_struct *work)
+{
+	struct cwq_stats *st = &cwq->stats;
+
+	work->queued_at = local_clock();
+	st->queued++;
+	if (++st->nr_pending > st->max_pending)
+		st->max_pending = st->nr_pending;
+}
+
+static void cwq_stats_executed(struct cpu_workqueue_struct *cwq,
+			       struct work_struct *work)
+{
+	struct cwq_stats *st = &cwq->stats;
+	u64 wait = local_clock() - work->queued_at;
+	int slot;
+
+	/* clocks of different cpus may be slightly apart */
+	if ((s64)wait < 0)
+		wait = 0;
+
+	st->executed++;
+	st->nr_pending--;
+	st->wait_sum += wait;
+	if (wait > st->wait_max)
+		st->wait_max = wait;
+	slot = min_t(int, fls64(div_u64(wait, NSEC_PER_USEC)),
+		     WQ_STATS_HIST_SLOTS - 1);
+	st->wait_hist[slot]++;
+}
+
+static void cwq_stats_cancelled(struct cpu_workqueue_struct *cwq)
+{
+	cwq->stats.nr_pending--;
+}
+#else
+static inline void cwq_stats_queued(struct cpu_workqueue_struct *cwq,
+				    struct work_struct *work) { }
+static inline void cwq_stats_executed(struct cpu_workqueue_struct *cwq,
+				      struct work_struct *work) { }
+static inline void cwq_stats_cancelled(struct cpu_workqueue_struct *cwq) { }
+#endif
+
 /**
  * insert_work - insert a work into gcwq
  * @cwq: cwq @work belongs to
@@ -918,6 +986,7 @@ static void insert_work(struct cpu_workqueue_struct *cwq,
 
 	/* we own @work, set data and link */
 	set_work_cwq(work, cwq, extra_flags);
+	cwq_stats_queued(cwq, work);
 
 	/*
 	 * Ensure that we get the right work->data if we see the
@@ -1407,8 +1476,11 @@ fail:
  */
 static void start_worker(struct worker *worker)
 {
+	trace_workqueue_create_worker(worker->gcwq->cpu, worker->id,
+				      worker->gcwq->nr_workers);
 	worker->flags |= WORKER_STARTED;
 	worker->gcwq->nr_workers++;
+	worker->gcwq->nr_created++;
 	worker_enter_idle(worker);
 	wake_up_process(worker->task);
 }
@@ -1818,6 +1890,7 @@ __acquires(&gcwq->lock)
 
 	/* claim and process */
 	debug_work_deactivate(work);
+	cwq_stats_executed(cwq, work);
 	hlist_add_head(&worker->hentry, bwh);
 	worker->current_work = work;
 	worker->current_cwq = cwq;
@@ -2556,6 +2629,7 @@ static int try_to_grab_pending(struct work_struct *work)
 		if (gcwq == get_work_gcwq(work)) {
 			debug_work_deactivate(work);
 			list_del_init(&work->entry);
+			cwq_stats_cancelled(get_work_cwq(work));
 			cwq_dec_nr_in_flight(get_work_cwq(work),
 				get_work_color(work),
 				*work_data_bits(work) & WORK_STRUCT_DELAYED);
@@ -3786,3 +3860,102 @@ static int __init init_workqueues(void)
 	return 0;
 }
 early_initcall(init_workqueues);
+
+#ifdef CONFIG_WORKQUEUE_STATS
+static void wq_stats_add(struct cwq_stats *sum, const struct cwq_stats *st)
+{
+	int i;
+
+	sum->queued += st->queued;
+	sum->executed += st->executed;
+	sum->nr_pending += st->nr_pending;
+	sum->max_pending = max(sum->max_pending, st->max_pending);
+	sum->wait_sum += st->wait_sum;
+	sum->wait_max = max(sum->wait_max, st->wait_max);
+	for (i = 0; i < WQ_STATS_HIST_SLOTS; i++)
+		sum->wait_hist[i] += st->wait_hist[i];
+}
+
+static int wq_stats_show(struct seq_file *m, void *v)
+{
+	struct workqueue_struct *wq;
+	unsigned int cpu;
+	int i;
+
+	seq_printf(m, "# pool workers created\n");
+	for_each_gcwq_cpu(cpu) {
+		struct global_cwq *gcwq = get_gcwq(cpu);
+
+		spin_lock_irq(&gcwq->lock);
+		if (cpu == WORK_CPU_UNBOUND)
+			seq_printf(m, "cpu/u %d %lu\n",
+				   gcwq->nr_workers, gcwq->nr_created);
+		else
+			seq_printf(m, "cpu/%u %d %lu\n", cpu,
+				   gcwq->nr_workers, gcwq->nr_created);
+		spin_unlock_irq(&gcwq->lock);
+	}
+
+	seq_printf(m, "# workqueue queued executed pending max_pending "
+		   "avg_wait_us max_wait_us wait_hist(<1us, <2us, <4us, ...)\n");
+
+	spin_lock(&workqueue_lock);
+	list_for_each_entry(wq, &workqueues, list) {
+		struct cwq_stats sum = { };
+		u64 avg = 0;
+
+		for_each_cwq_cpu(cpu, wq) {
+			struct cpu_workqueue_struct *cwq = get_cwq(cpu, wq);
+			struct global_cwq *gcwq = cwq->gcwq;
+
+			spin_lock_irq(&gcwq->lock);
+			wq_stats_add(&sum, &cwq->stats);
+			spin_unlock_irq(&gcwq->lock);
+		}
+
+		if (sum.executed)
+			avg = div64_u64(sum.wait_sum, sum.executed);
+
+		seq_printf(m, "%s %llu %llu %u %u %llu %llu", wq->name,
+			   (unsigned long long)sum.queued,
+			   (unsigned long long)sum.executed,
+			   sum.nr_pending, sum.max_pending,
+			   (unsigned long long)div_u64(avg, NSEC_PER_USEC),
+			   (unsigned long long)div_u64(sum.wait_max,
+						       NSEC_PER_USEC));
+		for (i = 0; i < WQ_STATS_HIST_SLOTS; i++)
+			seq_printf(m, " %lu", sum.wait_hist[i]);
+		seq_putc(m, '\n');
+	}
+	spin_unlock(&workqueue_lock);
+
+	return 0;
+}
+
+static int wq_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wq_stats_show, NULL);
+}
+
+static const struct file_operations wq_stats_fops = {
+	.open		= wq_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init init_workqueue_stats(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("workqueue", NULL);
+	if (!dir)
+		return -ENOMEM;
+	if (!debugfs_create_file("stats", 0444, dir, NULL, &wq_stats_fops)) {
+		debugfs_remove(dir);
+		return -ENOMEM;
+	}
+	return 0;
+}
+late_initcall(init_workqueue_stats);
+#endif /* CONFIG_WORKQUEUE_STATS */
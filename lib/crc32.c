@@ -28,13 +28,13 @@
 #include <linux/init.h>
 #include <asm/atomic.h>
 #include "crc32defs.h"
-#if CRC_LE_BITS == 8
+#if CRC_LE_BITS > 8
 # define tole(x) __constant_cpu_to_le32(x)
 #else
 # define tole(x) (x)
 #endif
 
-#if CRC_BE_BITS == 8
+#if CRC_BE_BITS > 8
 # define tobe(x) __constant_cpu_to_be32(x)
 #else
 # define tobe(x) (x)
@@ -45,26 +45,36 @@ MODULE_AUTHOR("Matt Domsch <Matt_Domsch@dell.com>");
 MODULE_DESCRIPTION("Ethernet CRC32 calculations");
 MODULE_LICENSE("GPL");
 
-#if CRC_LE_BITS == 8 || CRC_BE_BITS == 8
+#if CRC_LE_BITS > 8 || CRC_BE_BITS > 8
 
+/*
+ * Slice-by-4 and slice-by-8: fold 4 or 8 input bytes per iteration with
+ * one table lookup per byte, all lookups of an iteration being
+ * independent of each other.
+ */
 static inline u32
 crc32_body(u32 crc, unsigned char const *buf, size_t len, const u32 (*tab)[256])
 {
 # ifdef __LITTLE_ENDIAN
-#  define DO_CRC(x) crc = tab[0][(crc ^ (x)) & 255] ^ (crc >> 8)
-#  define DO_CRC4 crc = tab[3][(crc) & 255] ^ \
-		tab[2][(crc >> 8) & 255] ^ \
-		tab[1][(crc >> 16) & 255] ^ \
-		tab[0][(crc >> 24) & 255]
+#  define DO_CRC(x) crc = t0[(crc ^ (x)) & 255] ^ (crc >> 8)
+#  define DO_CRC4 (t3[(q) & 255] ^ t2[(q >> 8) & 255] ^ \
+		   t1[(q >> 16) & 255] ^ t0[(q >> 24) & 255])
+#  define DO_CRC8 (t7[(q) & 255] ^ t6[(q >> 8) & 255] ^ \
+		   t5[(q >> 16) & 255] ^ t4[(q >> 24) & 255])
 # else
-#  define DO_CRC(x) crc = tab[0][((crc >> 24) ^ (x)) & 255] ^ (crc << 8)
-#  define DO_CRC4 crc = tab[0][(crc) & 255] ^ \
-		tab[1][(crc >> 8) & 255] ^ \
-		tab[2][(crc >> 16) & 255] ^ \
-		tab[3][(crc >> 24) & 255]
+#  define DO_CRC(x) crc = t0[((crc >> 24) ^ (x)) & 255] ^ (crc << 8)
+#  define DO_CRC4 (t0[(q) & 255] ^ t1[(q >> 8) & 255] ^ \
+		   t2[(q >> 16) & 255] ^ t3[(q >> 24) & 255])
+#  define DO_CRC8 (t4[(q) & 255] ^ t5[(q >> 8) & 255] ^ \
+		   t6[(q >> 16) & 255] ^ t7[(q >> 24) & 255])
 # endif
 	const u32 *b;
 	size_t    rem_len;
+	const u32 *t0 = tab[0], *t1 = tab[1], *t2 = tab[2], *t3 = tab[3];
+# if CRC_LE_BITS == 64 || CRC_BE_BITS == 64
+	const u32 *t4 = tab[4], *t5 = tab[5], *t6 = tab[6], *t7 = tab[7];
+# endif
+	u32 q;
 
 	/* Align it */
 	if (unlikely((long)buf & 3 && len)) {
@@ -72,13 +82,25 @@ crc32_body(u32 crc, unsigned char const *buf, size_t len, const u32 (*tab)[256])
 			DO_CRC(*buf++);
 		} while ((--len) && ((long)buf)&3);
 	}
+
+# if CRC_LE_BITS == 64 || CRC_BE_BITS == 64
+	rem_len = len & 7;
+	len = len >> 3;
+# else
 	rem_len = len & 3;
-	/* load data 32 bits wide, xor data 32 bits wide. */
 	len = len >> 2;
+# endif
+	/* load data 32 bits wide, xor data 32 bits wide. */
 	b = (const u32 *)buf;
 	for (--b; len; --len) {
-		crc ^= *++b; /* use pre increment for speed */
-		DO_CRC4;
+		q = crc ^ *++b; /* use pre increment for speed */
+# if CRC_LE_BITS == 64 || CRC_BE_BITS == 64
+		crc = DO_CRC8;
+		q = *++b;
+		crc ^= DO_CRC4;
+# else
+		crc = DO_CRC4;
+# endif
 	}
 	len = rem_len;
 	/* And the last few bytes */
@@ -91,6 +113,7 @@ crc32_body(u32 crc, unsigned char const *buf, size_t len, const u32 (*tab)[256])
 	return crc;
 #undef DO_CRC
 #undef DO_CRC4
+#undef DO_CRC8
 }
 #endif
 /**
@@ -122,26 +145,33 @@ u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len)
 
 u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len)
 {
-# if CRC_LE_BITS == 8
+# if CRC_LE_BITS > 8
 	const u32      (*tab)[] = crc32table_le;
 
 	crc = __cpu_to_le32(crc);
 	crc = crc32_body(crc, p, len, tab);
 	return __le32_to_cpu(crc);
+# elif CRC_LE_BITS == 8
+	/* aka Sarwate algorithm */
+	while (len--) {
+		crc ^= *p++;
+		crc = (crc >> 8) ^ crc32table_le[0][crc & 255];
+	}
+	return crc;
 # elif CRC_LE_BITS == 4
 	while (len--) {
 		crc ^= *p++;
-		crc = (crc >> 4) ^ crc32table_le[crc & 15];
-		crc = (crc >> 4) ^ crc32table_le[crc & 15];
+		crc = (crc >> 4) ^ crc32table_le[0][crc & 15];
+		crc = (crc >> 4) ^ crc32table_le[0][crc & 15];
 	}
 	return crc;
 # elif CRC_LE_BITS == 2
 	while (len--) {
 		crc ^= *p++;
-		crc = (crc >> 2) ^ crc32table_le[crc & 3];
-		crc = (crc >> 2) ^ crc32table_le[crc & 3];
-		crc = (crc >> 2) ^ crc32table_le[crc & 3];
-		crc = (crc >> 2) ^ crc32table_le[crc & 3];
+		crc = (crc >> 2) ^ crc32table_le[0][crc & 3];
+		crc = (crc >> 2) ^ crc32table_le[0][crc & 3];
+		crc = (crc >> 2) ^ crc32table_le[0][crc & 3];
+		crc = (crc >> 2) ^ crc32table_le[0][crc & 3];
 	}
 	return crc;
 # endif
@@ -179,26 +209,33 @@ u32 __pure crc32_be(u32 crc, unsigned char const *p, size_t len)
 #else				/* Table-based approach */
 u32 __pure crc32_be(u32 crc, unsigned char const *p, size_t len)
 {
-# if CRC_BE_BITS == 8
+# if CRC_BE_BITS > 8
 	const u32      (*tab)[] = crc32table_be;
 
 	crc = __cpu_to_be32(crc);
 	crc = crc32_body(crc, p, len, tab);
 	return __be32_to_cpu(crc);
+# elif CRC_BE_BITS == 8
+	/* aka Sarwate algorithm */
+	while (len--) {
+		crc ^= *p++ << 24;
+		crc = (crc << 8) ^ crc32table_be[0][crc >> 24];
+	}
+	return crc;
 # elif CRC_BE_BITS == 4
 	while (len--) {
 		crc ^= *p++ << 24;
-		crc = (crc << 4) ^ crc32table_be[crc >> 28];
-		crc = (crc << 4) ^ crc32table_be[crc >> 28];
+		crc = (crc << 4) ^ crc32table_be[0][crc >> 28];
+		crc = (crc << 4) ^ crc32table_be[0][crc >> 28];
 	}
 	return crc;
 # elif CRC_BE_BITS == 2
 	while (len--) {
 		crc ^= *p++ << 24;
-		crc = (crc << 2) ^ crc32table_be[crc >> 30];
-		crc = (crc << 2) ^ crc32table_be[crc >> 30];
-		crc = (crc << 2) ^ crc32table_be[crc >> 30];
-		crc = (crc << 2) ^ crc32table_be[crc >> 30];
+		crc = (crc << 2) ^ crc32table_be[0][crc >> 30];
+		crc = (crc << 2) ^ crc32table_be[0][crc >> 30];
+		crc = (crc << 2) ^ crc32table_be[0][crc >> 30];
+		crc = (crc << 2) ^ crc32table_be[0][crc >> 30];
 	}
 	return crc;
 # endif
@@ -335,6 +372,119 @@ EXPORT_SYMBOL(crc32_be);
  * the same way on decoding, it doesn't make a difference.
  */
 
+#ifdef CONFIG_CRC32_SELFTEST
+
+#include <linux/hrtimer.h>
+#include <linux/slab.h>
+
+#define CRC32_TEST_LEN		4096
+#define CRC32_TEST_RUNS		100
+#define CRC32_BENCH_LOOPS	256
+
+static u32 crc32_test_seed __initdata = 0x2545f491;
+
+static u32 __init crc32_test_rand(void)
+{
+	crc32_test_seed = crc32_test_seed * 1103515245 + 12345;
+	return crc32_test_seed >> 8;
+}
+
+/* bit at a time references the table driven variants are checked against */
+static u32 __init crc32_le_bitwise(u32 crc, unsigned char const *p, size_t len)
+{
+	int i;
+
+	while (len--) {
+		crc ^= *p++;
+		for (i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ ((crc & 1) ? CRCPOLY_LE : 0);
+	}
+	return crc;
+}
+
+static u32 __init crc32_be_bitwise(u32 crc, unsigned char const *p, size_t len)
+{
+	int i;
+
+	while (len--) {
+		crc ^= *p++ << 24;
+		for (i = 0; i < 8; i++)
+			crc = (crc << 1) ^
+			      ((crc & 0x80000000) ? CRCPOLY_BE : 0);
+	}
+	return crc;
+}
+
+/* returns the throughput of @fn over @buf in KiB/s */
+static unsigned long __init crc32_bench(u32 (*fn)(u32, unsigned char const *,
+						    size_t),
+					unsigned char *buf, int loops)
+{
+	unsigned long flags;
+	ktime_t start;
+	s64 nsec;
+	u64 kib;
+	int i;
+
+	local_irq_save(flags);
+	start = ktime_get();
+	for (i = 0; i < loops; i++)
+		fn(0, buf, CRC32_TEST_LEN);
+	nsec = ktime_to_ns(ktime_sub(ktime_get(), start));
+	local_irq_restore(flags);
+
+	if (nsec <= 0)
+		return 0;
+
+	kib = (u64)loops * CRC32_TEST_LEN * NSEC_PER_SEC / 1024;
+	do_div(kib, nsec);
+	return kib;
+}
+
+static int __init crc32_selftest(void)
+{
+	unsigned char *buf;
+	int i, errors = 0;
+
+	buf = kmalloc(CRC32_TEST_LEN + 8, GFP_KERNEL);
+	if (!buf)
+		return 0;
+
+	for (i = 0; i < CRC32_TEST_LEN + 8; i++)
+		buf[i] = crc32_test_rand();
+
+	/* random seeds, alignments and lengths against the references */
+	for (i = 0; i < CRC32_TEST_RUNS; i++) {
+		u32 seed = crc32_test_rand() << 8 | crc32_test_rand();
+		unsigned int off = crc32_test_rand() & 7;
+		size_t len = crc32_test_rand() % CRC32_TEST_LEN;
+
+		if (crc32_le(seed, buf + off, len) !=
+		    crc32_le_bitwise(seed, buf + off, len))
+			errors++;
+		if (crc32_be(seed, buf + off, len) !=
+		    crc32_be_bitwise(seed, buf + off, len))
+			errors++;
+	}
+
+	if (errors)
+		printk(KERN_WARNING "crc32: %d self tests failed\n", errors);
+	else
+		printk(KERN_INFO "crc32: self tests passed\n");
+
+	printk(KERN_INFO "crc32: CRC_LE_BITS = %d: %lu KiB/s, "
+	       "CRC_BE_BITS = %d: %lu KiB/s, bitwise: %lu KiB/s\n",
+	       CRC_LE_BITS, crc32_bench(crc32_le, buf, CRC32_BENCH_LOOPS),
+	       CRC_BE_BITS, crc32_bench(crc32_be, buf, CRC32_BENCH_LOOPS),
+	       crc32_bench(crc32_le_bitwise, buf, 4));
+
+	kfree(buf);
+	return 0;
+}
+
+module_init(crc32_selftest);
+#endif /* CONFIG_CRC32_SELFTEST */
+
 #ifdef UNITTEST
 
 #include <stdlib.h>
@@ -0,0 +1,155 @@
+/*
+ * Self test and benchmark for the LZO1X compressor and decompressor
+ *
+ * Compresses a few buffers of differing compressibility, checks that
+ * they decompress to the original data and that truncated input is
+ * refused, and reports the decompression throughput.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/hrtimer.h>
+#include <linux/lzo.h>
+
+#define LZO_TEST_LEN	(64 * 1024)
+#define LZO_TEST_LOOPS	64
+
+static u32 lzo_test_seed __initdata = 0x9e3779b9;
+
+static u32 __init lzo_test_rand(void)
+{
+	lzo_test_seed = lzo_test_seed * 1103515245 + 12345;
+	return lzo_test_seed >> 8;
+}
+
+/*
+ * mode 0: random bytes (incompressible, long literal runs)
+ * mode 1: text like, short matches close by
+ * mode 2: long repeats of a short pattern (overlapping matches)
+ */
+static void __init lzo_test_fill(unsigned char *buf, size_t len, int mode)
+{
+	static const char text[] __initconst = "the quick brown fox ";
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		u32 r = lzo_test_rand();
+
+		switch (mode) {
+		case 0:
+			buf[i] = r;
+			break;
+		case 1:
+			if (i > 64 && (r & 3))
+				buf[i] = buf[i - 1 - (r >> 4) % 64];
+			else
+				buf[i] = text[r % (sizeof(text) - 1)];
+			break;
+		default:
+			buf[i] = text[i % 5];
+			break;
+		}
+	}
+}
+
+static int __init lzo_test_one(unsigned char *src, unsigned char *dst,
+			       unsigned char *out, void *wrkmem, int mode)
+{
+	size_t dst_len, out_len;
+	unsigned long flags;
+	ktime_t start;
+	s64 nsec;
+	u64 kib;
+	int ret, i;
+
+	lzo_test_fill(src, LZO_TEST_LEN, mode);
+
+	ret = lzo1x_1_compress(src, LZO_TEST_LEN, dst, &dst_len, wrkmem);
+	if (ret != LZO_E_OK) {
+		printk(KERN_ERR "lzo: mode %d: compression failed: %d\n",
+		       mode, ret);
+		return -EINVAL;
+	}
+
+	out_len = LZO_TEST_LEN;
+	ret = lzo1x_decompress_safe(dst, dst_len, out, &out_len);
+	if (ret != LZO_E_OK || out_len != LZO_TEST_LEN ||
+	    memcmp(src, out, LZO_TEST_LEN)) {
+		printk(KERN_ERR "lzo: mode %d: decompression mismatch: %d\n",
+		       mode, ret);
+		return -EINVAL;
+	}
+
+	/* the safe decompressor must notice a truncated stream */
+	out_len = LZO_TEST_LEN;
+	ret = lzo1x_decompress_safe(dst, dst_len / 2, out, &out_len);
+	if (ret == LZO_E_OK) {
+		printk(KERN_ERR "lzo: mode %d: truncated input accepted\n",
+		       mode);
+		return -EINVAL;
+	}
+
+	local_irq_save(flags);
+	start = ktime_get();
+	for (i = 0; i < LZO_TEST_LOOPS; i++) {
+		out_len = LZO_TEST_LEN;
+		lzo1x_decompress_safe(dst, dst_len, out, &out_len);
+	}
+	nsec = ktime_to_ns(ktime_sub(ktime_get(), start));
+	local_irq_restore(flags);
+
+	kib = (u64)LZO_TEST_LOOPS * LZO_TEST_LEN * NSEC_PER_SEC / 1024;
+	if (nsec > 0)
+		do_div(kib, nsec);
+	else
+		kib = 0;
+
+	printk(KERN_INFO "lzo: mode %d: %u -> %zu bytes, "
+	       "decompression %llu KiB/s\n", mode, LZO_TEST_LEN, dst_len,
+	       (unsigned long long)kib);
+	return 0;
+}
+
+static int __init lzo_test_init(void)
+{
+	unsigned char *src, *dst, *out;
+	void *wrkmem;
+	int mode, ret = -ENOMEM;
+
+	src = vmalloc(LZO_TEST_LEN);
+	dst = vmalloc(lzo1x_worst_compress(LZO_TEST_LEN));
+	out = vmalloc(LZO_TEST_LEN);
+	wrkmem = vmalloc(LZO1X_MEM_COMPRESS);
+	if (!src || !dst || !out || !wrkmem)
+		goto out;
+
+	for (mode = 0; mode < 3; mode++) {
+		ret = lzo_test_one(src, dst, out, wrkmem, mode);
+		if (ret)
+			break;
+	}
+	if (!ret)
+		printk(KERN_INFO "lzo: self tests passed\n");
+out:
+	vfree(wrkmem);
+	vfree(out);
+	vfree(dst);
+	vfree(src);
+	return ret;
+}
+
+static void __exit lzo_test_exit(void)
+{
+}
+
+module_init(lzo_test_init);
+module_exit(lzo_test_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("LZO1X self test and benchmark");
@@ -46,6 +46,9 @@ void __init_rwsem(struct rw_semaphore *sem, const char *name,
 	sem->activity = 0;
 	spin_lock_init(&sem->wait_lock);
 	INIT_LIST_HEAD(&sem->wait_list);
+#ifdef CONFIG_RWSEM_SPIN_ON_OWNER
+	sem->owner = NULL;
+#endif
 }
 EXPORT_SYMBOL(__init_rwsem);
 
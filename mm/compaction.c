@@ -14,6 +14,8 @@
 #include <linux/backing-dev.h>
 #include <linux/sysctl.h>
 #include <linux/sysfs.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
 #include "internal.h"
 
 #define CREATE_TRACE_POINTS
@@ -41,9 +43,21 @@ struct compact_control {
 
 	unsigned int order;		/* order a direct compactor needs */
 	int migratetype;		/* MOVABLE, RECLAIMABLE etc */
+	unsigned long min_blocks;	/* free blocks of order kcompactd wants */
 	struct zone *zone;
 };
 
+/* Number of free blocks of the given order, counting larger blocks too */
+static unsigned long zone_free_blocks(struct zone *zone, unsigned int order)
+{
+	unsigned long blocks = 0;
+	unsigned int o;
+
+	for (o = order; o < MAX_ORDER; o++)
+		blocks += zone->free_area[o].nr_free << (o - order);
+	return blocks;
+}
+
 static unsigned long release_freepages(struct list_head *freelist)
 {
 	struct page *page, *next;
@@ -408,6 +422,10 @@ static int compact_finished(struct zone *zone,
 	if (cc->order == -1)
 		return COMPACT_CONTINUE;
 
+	/* kcompactd: keep going until it has the blocks it wants */
+	if (cc->min_blocks && zone_free_blocks(zone, cc->order) < cc->min_blocks)
+		return COMPACT_CONTINUE;
+
 	/* Direct compactor: Is a suitable page free? */
 	for (order = cc->order; order < MAX_ORDER; order++) {
 		/* Job done if page is free of the right migratetype */
@@ -475,6 +493,9 @@ static int compact_zone(struct zone *zone, struct compact_control *cc)
 	int ret;
 
 	ret = compaction_suitable(zone, cc->order);
+	if (ret == COMPACT_PARTIAL && cc->min_blocks &&
+	    zone_free_blocks(zone, cc->order) < cc->min_blocks)
+		ret = COMPACT_CONTINUE;
 	switch (ret) {
 	case COMPACT_PARTIAL:
 	case COMPACT_SKIPPED:
@@ -595,6 +616,212 @@ unsigned long try_to_compact_pages(struct zonelist *zonelist,
 }
 
 
+/*
+ * kcompactd
+ *
+ * Atomic high-order allocations, such as jumbo frame skbs or DMA buffers
+ * allocated from interrupt context, cannot compact memory themselves and
+ * simply fail once the free lists run out of large enough blocks.  One
+ * kcompactd thread per node compacts in the background instead: it is
+ * woken when a high-order allocation falls back to the slow path, and by
+ * kswapd when reclaim has left fewer than kcompactd_min_blocks free
+ * blocks of kcompactd_order in a zone.  It uses asynchronous migration,
+ * so it does not wait on writeback.
+ */
+int sysctl_kcompactd_order = PAGE_ALLOC_COSTLY_ORDER;
+int sysctl_kcompactd_min_blocks = 8;
+
+static bool kcompactd_node_suitable(pg_data_t *pgdat, int order,
+				    int classzone_idx)
+{
+	int zoneid;
+
+	for (zoneid = 0; zoneid <= classzone_idx; zoneid++) {
+		struct zone *zone = &pgdat->node_zones[zoneid];
+
+		if (!populated_zone(zone))
+			continue;
+		if (compaction_suitable(zone, order) == COMPACT_CONTINUE)
+			return true;
+	}
+	return false;
+}
+
+static void kcompactd_do_work(pg_data_t *pgdat)
+{
+	int order = pgdat->kcompactd_max_order;
+	int classzone_idx = pgdat->kcompactd_classzone_idx;
+	int zoneid;
+
+	pgdat->kcompactd_max_order = 0;
+	pgdat->kcompactd_classzone_idx = 0;
+	if (!order)
+		return;
+
+	count_vm_event(KCOMPACTD_WAKE);
+
+	/* Flush pending updates to the LRU lists */
+	lru_add_drain();
+
+	for (zoneid = 0; zoneid <= classzone_idx; zoneid++) {
+		struct zone *zone = &pgdat->node_zones[zoneid];
+		struct compact_control cc = {
+			.nr_freepages = 0,
+			.nr_migratepages = 0,
+			.order = order,
+			.migratetype = MIGRATE_MOVABLE,
+			.zone = zone,
+			.sync = false,
+		};
+		int status;
+
+		if (!populated_zone(zone))
+			continue;
+		if (compaction_deferred(zone))
+			continue;
+		if (kthread_should_stop())
+			return;
+
+		if (order <= sysctl_kcompactd_order)
+			cc.min_blocks = sysctl_kcompactd_min_blocks;
+		INIT_LIST_HEAD(&cc.freepages);
+		INIT_LIST_HEAD(&cc.migratepages);
+
+		status = compact_zone(zone, &cc);
+
+		if (zone_watermark_ok(zone, order, low_wmark_pages(zone),
+				      0, 0)) {
+			zone->compact_considered = 0;
+			zone->compact_defer_shift = 0;
+			if (status != COMPACT_SKIPPED)
+				count_vm_event(KCOMPACTD_SUCCESS);
+		} else if (status == COMPACT_COMPLETE) {
+			/* Scanned the whole zone in vain: back off */
+			defer_compaction(zone);
+		}
+
+		VM_BUG_ON(!list_empty(&cc.freepages));
+		VM_BUG_ON(!list_empty(&cc.migratepages));
+	}
+}
+
+static bool kcompactd_work_requested(pg_data_t *pgdat)
+{
+	return pgdat->kcompactd_max_order > 0 || kthread_should_stop();
+}
+
+static int kcompactd(void *p)
+{
+	pg_data_t *pgdat = p;
+	const struct cpumask *cpumask = cpumask_of_node(pgdat->node_id);
+
+	if (!cpumask_empty(cpumask))
+		set_cpus_allowed_ptr(current, cpumask);
+	set_freezable();
+
+	pgdat->kcompactd_max_order = 0;
+	pgdat->kcompactd_classzone_idx = 0;
+
+	while (!kthread_should_stop()) {
+		wait_event_freezable(pgdat->kcompactd_wait,
+				     kcompactd_work_requested(pgdat));
+		kcompactd_do_work(pgdat);
+	}
+	return 0;
+}
+
+/**
+ * wakeup_kcompactd - ask for background compaction on a node
+ * @pgdat: The node to compact
+ * @order: The order of the allocation that found too few free blocks
+ * @classzone_idx: The highest zone the allocation may use
+ *
+ * May be called from atomic context.
+ */
+void wakeup_kcompactd(pg_data_t *pgdat, int order, int classzone_idx)
+{
+	if (!order || !pgdat->kcompactd)
+		return;
+	if (!waitqueue_active(&pgdat->kcompactd_wait))
+		return;
+	if (!kcompactd_node_suitable(pgdat, order, classzone_idx))
+		return;
+
+	if (pgdat->kcompactd_max_order < order)
+		pgdat->kcompactd_max_order = order;
+	if (pgdat->kcompactd_classzone_idx < classzone_idx)
+		pgdat->kcompactd_classzone_idx = classzone_idx;
+
+	wake_up_interruptible(&pgdat->kcompactd_wait);
+}
+
+/*
+ * Called by kswapd as it goes to sleep, to wake kcompactd if a zone is
+ * short of free blocks of sysctl_kcompactd_order.
+ */
+void kcompactd_check_node(pg_data_t *pgdat, int classzone_idx)
+{
+	int order = sysctl_kcompactd_order;
+	int zoneid;
+
+	if (!order || !sysctl_kcompactd_min_blocks)
+		return;
+
+	for (zoneid = 0; zoneid <= classzone_idx; zoneid++) {
+		struct zone *zone = &pgdat->node_zones[zoneid];
+
+		if (!populated_zone(zone))
+			continue;
+		if (zone_free_blocks(zone, order) < sysctl_kcompactd_min_blocks) {
+			wakeup_kcompactd(pgdat, order, classzone_idx);
+			return;
+		}
+	}
+}
+
+/*
+ * Called at boot for every node with memory, and on memory hot-add.
+ */
+int kcompactd_run(int nid)
+{
+	pg_data_t *pgdat = NODE_DATA(nid);
+	int ret = 0;
+
+	if (pgdat->kcompactd)
+		return 0;
+
+	pgdat->kcompactd = kthread_run(kcompactd, pgdat, "kcompactd%d", nid);
+	if (IS_ERR(pgdat->kcompactd)) {
+		printk(KERN_ERR "Failed to start kcompactd on node %d\n", nid);
+		pgdat->kcompactd = NULL;
+		ret = -1;
+	}
+	return ret;
+}
+
+/*
+ * Called by memory hotplug when all memory in a node is offlined.
+ */
+void kcompactd_stop(int nid)
+{
+	struct task_struct *kcompactd = NODE_DATA(nid)->kcompactd;
+
+	if (kcompactd) {
+		kthread_stop(kcompactd);
+		NODE_DATA(nid)->kcompactd = NULL;
+	}
+}
+
+static int __init kcompactd_init(void)
+{
+	int nid;
+
+	for_each_node_state(nid, N_HIGH_MEMORY)
+		kcompactd_run(nid);
+	return 0;
+}
+module_init(kcompactd_init)
+
 /* Compact all zones within a node */
 static int compact_node(int nid)
 {
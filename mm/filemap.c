@@ -452,10 +452,14 @@ int add_to_page_cache_lru(struct page *page, struct address_space *mapping,
 
 	ret = add_to_page_cache(page, mapping, offset, gfp_mask);
 	if (ret == 0) {
-		if (page_is_file_cache(page))
-			lru_cache_add_file(page);
-		else
+		if (!page_is_file_cache(page))
 			lru_cache_add_anon(page);
+		else if (workingset_refault(mapping, offset)) {
+			/* It only just got evicted: part of the working set */
+			workingset_activation(page);
+			lru_cache_add_lru(page, LRU_ACTIVE_FILE);
+		} else
+			lru_cache_add_file(page);
 	}
 	return ret;
 }
@@ -600,6 +604,44 @@ int __lock_page_killable(struct page *page)
 }
 EXPORT_SYMBOL_GPL(__lock_page_killable);
 
+/**
+ * wait_on_page_locked_async - arm an asynchronous wait for page unlock
+ * @page: the page to wait on
+ * @wait: wait entry whose ->wait.func handles the wakeup
+ *
+ * If @page is locked, queue @wait on its waitqueue and return -EIOCBRETRY;
+ * @wait's wake function runs once PG_locked clears and must dequeue the
+ * entry itself.  Returns 0, without queueing, if the page is not locked.
+ * Used by AIO to retry a buffered read instead of sleeping in it.
+ */
+int wait_on_page_locked_async(struct page *page, struct wait_bit_queue *wait)
+{
+	wait_queue_head_t *q = page_waitqueue(page);
+	struct address_space *mapping;
+	unsigned long flags;
+	int ret = 0;
+
+	wait->key.flags = &page->flags;
+	wait->key.bit_nr = PG_locked;
+
+	spin_lock_irqsave(&q->lock, flags);
+	if (PageLocked(page)) {
+		__add_wait_queue(q, &wait->wait);
+		ret = -EIOCBRETRY;
+	}
+	spin_unlock_irqrestore(&q->lock, flags);
+
+	if (ret) {
+		/* Unplug as sync_page() would, but do not sleep. */
+		smp_mb();
+		mapping = page_mapping(page);
+		if (mapping && mapping->a_ops && mapping->a_ops->sync_page)
+			mapping->a_ops->sync_page(page);
+	}
+	return ret;
+}
+EXPORT_SYMBOL_GPL(wait_on_page_locked_async);
+
 /**
  * __lock_page_nosync - get a lock on the page, without calling sync_page()
  * @page: the page to lock
@@ -767,24 +809,29 @@ EXPORT_SYMBOL(find_or_create_page);
 unsigned find_get_pages(struct address_space *mapping, pgoff_t start,
 			    unsigned int nr_pages, struct page **pages)
 {
-	unsigned int i;
-	unsigned int ret;
-	unsigned int nr_found;
+	struct radix_tree_iter iter;
+	void **slot;
+	unsigned ret = 0;
+
+	if (unlikely(!nr_pages))
+		return 0;
 
 	rcu_read_lock();
 restart:
-	nr_found = radix_tree_gang_lookup_slot(&mapping->page_tree,
-				(void ***)pages, start, nr_pages);
-	ret = 0;
-	for (i = 0; i < nr_found; i++) {
+	radix_tree_for_each_slot(slot, &mapping->page_tree, &iter, start) {
 		struct page *page;
 repeat:
-		page = radix_tree_deref_slot((void **)pages[i]);
+		page = radix_tree_deref_slot(slot);
 		if (unlikely(!page))
 			continue;
+
 		if (radix_tree_deref_retry(page)) {
-			if (ret)
-				start = pages[ret-1]->index;
+			/*
+			 * Transient condition which can only trigger
+			 * when entry at index 0 moves out of or back
+			 * to root: none yet gotten, safe to restart.
+			 */
+			WARN_ON(iter.index);
 			goto restart;
 		}
 
@@ -792,14 +839,16 @@ repeat:
 			goto repeat;
 
 		/* Has the page moved? */
-		if (unlikely(page != *((void **)pages[i]))) {
+		if (unlikely(page != *slot)) {
 			page_cache_release(page);
 			goto repeat;
 		}
 
 		pages[ret] = page;
-		ret++;
+		if (++ret == nr_pages)
+			break;
 	}
+
 	rcu_read_unlock();
 	return ret;
 }
@@ -819,29 +868,37 @@ repeat:
 unsigned find_get_pages_contig(struct address_space *mapping, pgoff_t index,
 			       unsigned int nr_pages, struct page **pages)
 {
-	unsigned int i;
-	unsigned int ret;
-	unsigned int nr_found;
+	struct radix_tree_iter iter;
+	void **slot;
+	unsigned int ret = 0;
+
+	if (unlikely(!nr_pages))
+		return 0;
 
 	rcu_read_lock();
 restart:
-	nr_found = radix_tree_gang_lookup_slot(&mapping->page_tree,
-				(void ***)pages, index, nr_pages);
-	ret = 0;
-	for (i = 0; i < nr_found; i++) {
+	radix_tree_for_each_contig(slot, &mapping->page_tree, &iter, index) {
 		struct page *page;
 repeat:
-		page = radix_tree_deref_slot((void **)pages[i]);
+		page = radix_tree_deref_slot(slot);
+		/* The hole, there no reason to continue */
 		if (unlikely(!page))
-			continue;
-		if (radix_tree_deref_retry(page))
+			break;
+
+		if (radix_tree_deref_retry(page)) {
+			/*
+			 * Transient condition which can only trigger
+			 * when entry at index 0 moves out of or back
+			 * to root: none yet gotten, safe to restart.
+			 */
 			goto restart;
+		}
 
 		if (!page_cache_get_speculative(page))
 			goto repeat;
 
 		/* Has the page moved? */
-		if (unlikely(page != *((void **)pages[i]))) {
+		if (unlikely(page != *slot)) {
 			page_cache_release(page);
 			goto repeat;
 		}
@@ -851,14 +908,14 @@ repeat:
 		 * otherwise we can get both false positives and false
 		 * negatives, which is just confusing to the caller.
 		 */
-		if (page->mapping == NULL || page->index != index) {
+		if (page->mapping == NULL || page->index != iter.index) {
 			page_cache_release(page);
 			break;
 		}
 
 		pages[ret] = page;
-		ret++;
-		index++;
+		if (++ret == nr_pages)
+			break;
 	}
 	rcu_read_unlock();
 	return ret;
@@ -879,36 +936,46 @@ EXPORT_SYMBOL(find_get_pages_contig);
 unsigned find_get_pages_tag(struct address_space *mapping, pgoff_t *index,
 			int tag, unsigned int nr_pages, struct page **pages)
 {
-	unsigned int i;
-	unsigned int ret;
-	unsigned int nr_found;
+	struct radix_tree_iter iter;
+	void **slot;
+	unsigned ret = 0;
+
+	if (unlikely(!nr_pages))
+		return 0;
 
 	rcu_read_lock();
 restart:
-	nr_found = radix_tree_gang_lookup_tag_slot(&mapping->page_tree,
-				(void ***)pages, *index, nr_pages, tag);
-	ret = 0;
-	for (i = 0; i < nr_found; i++) {
+	radix_tree_for_each_tagged(slot, &mapping->page_tree,
+				   &iter, *index, tag) {
 		struct page *page;
 repeat:
-		page = radix_tree_deref_slot((void **)pages[i]);
+		page = radix_tree_deref_slot(slot);
 		if (unlikely(!page))
 			continue;
-		if (radix_tree_deref_retry(page))
+
+		if (radix_tree_deref_retry(page)) {
+			/*
+			 * Transient condition which can only trigger
+			 * when entry at index 0 moves out of or back
+			 * to root: none yet gotten, safe to restart.
+			 */
 			goto restart;
+		}
 
 		if (!page_cache_get_speculative(page))
 			goto repeat;
 
 		/* Has the page moved? */
-		if (unlikely(page != *((void **)pages[i]))) {
+		if (unlikely(page != *slot)) {
 			page_cache_release(page);
 			goto repeat;
 		}
 
 		pages[ret] = page;
-		ret++;
+		if (++ret == nr_pages)
+			break;
 	}
+
 	rcu_read_unlock();
 
 	if (ret)
@@ -985,8 +1052,58 @@ static void shrink_readahead_size_eio(struct file *filp,
  * This is really ugly. But the goto's actually try to clarify some
  * of the logic when it comes to error handling etc.
  */
+/*
+ * do_generic_file_read() looks cached pages up a run at a time: a single
+ * RCU radix tree walk takes references on up to FILE_READ_BATCH
+ * consecutive pages, which are then handed out one by one instead of
+ * going through find_get_page() for every page of a large read.
+ */
+#define FILE_READ_BATCH		PAGEVEC_SIZE
+
+struct file_read_batch {
+	pgoff_t start;		/* index of pages[0] */
+	unsigned int nr;	/* pages looked up */
+	unsigned int next;	/* first page not handed out yet */
+	struct page *pages[FILE_READ_BATCH];
+};
+
+static void file_read_batch_release(struct file_read_batch *rb)
+{
+	while (rb->next < rb->nr)
+		page_cache_release(rb->pages[rb->next++]);
+	rb->nr = rb->next = 0;
+}
+
+/*
+ * Return the page at @index with a reference held, or NULL if it is not
+ * in the page cache; @last_index bounds how far ahead to look.
+ */
+static struct page *file_read_batch_get(struct file_read_batch *rb,
+					struct address_space *mapping,
+					pgoff_t index, pgoff_t last_index)
+{
+	unsigned long nr;
+
+	if (index >= rb->start + rb->next && index < rb->start + rb->nr) {
+		while (rb->start + rb->next < index)
+			page_cache_release(rb->pages[rb->next++]);
+		return rb->pages[rb->next++];
+	}
+
+	file_read_batch_release(rb);
+	nr = last_index > index ? last_index - index : 1;
+	nr = min_t(unsigned long, nr, FILE_READ_BATCH);
+	rb->start = index;
+	rb->nr = find_get_pages_contig(mapping, index, nr, rb->pages);
+	if (!rb->nr)
+		return NULL;
+	rb->next = 1;
+	return rb->pages[0];
+}
+
 static void do_generic_file_read(struct file *filp, loff_t *ppos,
-		read_descriptor_t *desc, read_actor_t actor)
+		read_descriptor_t *desc, read_actor_t actor,
+		struct wait_bit_queue *async_wait)
 {
 	struct address_space *mapping = filp->f_mapping;
 	struct inode *inode = mapping->host;
@@ -996,6 +1113,7 @@ static void do_generic_file_read(struct file *filp, loff_t *ppos,
 	pgoff_t prev_index;
 	unsigned long offset;      /* offset into pagecache page */
 	unsigned int prev_offset;
+	struct file_read_batch rb = { .nr = 0, .next = 0 };
 	int error;
 
 	index = *ppos >> PAGE_CACHE_SHIFT;
@@ -1012,7 +1130,7 @@ static void do_generic_file_read(struct file *filp, loff_t *ppos,
 
 		cond_resched();
 find_page:
-		page = find_get_page(mapping, index);
+		page = file_read_batch_get(&rb, mapping, index, last_index);
 		if (!page) {
 			page_cache_sync_readahead(mapping,
 					ra, filp,
@@ -1105,6 +1223,17 @@ page_ok:
 		goto out;
 
 page_not_up_to_date:
+		/*
+		 * An AIO read does not sleep on a page that is under I/O:
+		 * it queues the iocb on the page and gets retried from the
+		 * wakeup with whatever it has copied so far.
+		 */
+		if (async_wait) {
+			error = wait_on_page_locked_async(page, async_wait);
+			if (error)
+				goto readpage_error;
+		}
+
 		/* Get exclusive access to the page ... */
 		error = lock_page_killable(page);
 		if (unlikely(error))
@@ -1143,6 +1272,12 @@ readpage:
 		}
 
 		if (!PageUptodate(page)) {
+			if (async_wait) {
+				error = wait_on_page_locked_async(page,
+								  async_wait);
+				if (error)
+					goto readpage_error;
+			}
 			error = lock_page_killable(page);
 			if (unlikely(error))
 				goto readpage_error;
@@ -1194,6 +1329,7 @@ no_cached_page:
 	}
 
 out:
+	file_read_batch_release(&rb);
 	ra->prev_pos = prev_index;
 	ra->prev_pos <<= PAGE_CACHE_SHIFT;
 	ra->prev_pos |= prev_offset;
@@ -1294,11 +1430,15 @@ generic_file_aio_read(struct kiocb *iocb, const struct iovec *iov,
 		unsigned long nr_segs, loff_t pos)
 {
 	struct file *filp = iocb->ki_filp;
+	struct wait_bit_queue *async_wait = NULL;
 	ssize_t retval;
 	unsigned long seg = 0;
 	size_t count;
 	loff_t *ppos = &iocb->ki_pos;
 
+	if (kiocbIsAsyncWait(iocb))
+		async_wait = &iocb->ki_wait;
+
 	count = 0;
 	retval = generic_segment_checks(iov, &nr_segs, &count, VERIFY_WRITE);
 	if (retval)
@@ -1366,7 +1506,8 @@ generic_file_aio_read(struct kiocb *iocb, const struct iovec *iov,
 		if (desc.count == 0)
 			continue;
 		desc.error = 0;
-		do_generic_file_read(filp, ppos, &desc, file_read_actor);
+		do_generic_file_read(filp, ppos, &desc, file_read_actor,
+				     async_wait);
 		retval += desc.written;
 		if (desc.error) {
 			retval = retval ?: desc.error;
@@ -85,12 +85,20 @@
  * @mm_list: link into the mm_slots list, rooted in ksm_mm_head
  * @rmap_list: head for this mm_slot's singly-linked list of rmap_items
  * @mm: the mm that this information is valid for
+ * @pass_merged: pages merged from this mm during the current full scan
+ * @full_scans: completed full scans of this mm
+ * @idle_passes: consecutive full scans of this mm that merged nothing
+ * @skip_passes: full scans this mm is to sit out before the next visit
  */
 struct mm_slot {
 	struct hlist_node link;
 	struct list_head mm_list;
 	struct rmap_item *rmap_list;
 	struct mm_struct *mm;
+	unsigned long pass_merged;
+	unsigned int full_scans;
+	unsigned int idle_passes;
+	unsigned int skip_passes;
 };
 
 /**
@@ -128,6 +136,8 @@ struct stable_node {
  * @mm: the memory structure this rmap_item is pointing into
  * @address: the virtual address this rmap_item tracks (+ flags in low bits)
  * @oldchecksum: previous checksum of the page at that virtual address
+ * @volatility: consecutive visits on which that checksum changed
+ * @skip: visits to pass over before comparing this page again
  * @node: rb node of this rmap_item in the unstable tree
  * @head: pointer to stable_node heading this list in the stable tree
  * @hlist: link into hlist of rmap_items hanging off that stable_node
@@ -138,6 +148,8 @@ struct rmap_item {
 	struct mm_struct *mm;
 	unsigned long address;		/* + low bits used for flags below */
 	unsigned int oldchecksum;	/* when unstable */
+	unsigned char volatility;
+	unsigned char skip;
 	union {
 		struct rb_node node;	/* when node of unstable tree */
 		struct {		/* when listed from stable tree */
@@ -182,6 +194,18 @@ static unsigned long ksm_pages_unshared;
 /* The number of rmap_items in use: to calculate pages_volatile */
 static unsigned long ksm_rmap_items;
 
+/* The number of page visits skipped because the page kept changing */
+static unsigned long ksm_pages_skipped;
+
+/*
+ * Upper bound on how many full scans a volatile page, or an mm whose
+ * last scans merged nothing, gets to sit out.  An rmap_item left in the
+ * unstable tree by a skipped mm ages by one seqnr per scan, and the age
+ * is kept in the low byte of rmap_item->address, so this must stay well
+ * below SEQNR_MASK.
+ */
+#define KSM_MAX_SKIP_PASSES	8
+
 /* Number of pages ksmd should scan in one batch */
 static unsigned int ksm_thread_pages_to_scan = 100;
 
@@ -567,7 +591,7 @@ static void remove_rmap_item_from_tree(struct rmap_item *rmap_item)
 		 * than left over from before.
 		 */
 		age = (unsigned char)(ksm_scan.seqnr - rmap_item->address);
-		BUG_ON(age > 1);
+		BUG_ON(age > KSM_MAX_SKIP_PASSES + 1);
 		if (!age)
 			rb_erase(&rmap_item->node, &root_unstable_tree);
 
@@ -1180,7 +1204,7 @@ static void stable_tree_append(struct rmap_item *rmap_item,
  * @page: the page that we are searching identical page to.
  * @rmap_item: the reverse mapping into the virtual address of this page
  */
-static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
+static int cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 {
 	struct rmap_item *tree_rmap_item;
 	struct page *tree_page = NULL;
@@ -1205,7 +1229,7 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 			unlock_page(kpage);
 		}
 		put_page(kpage);
-		return;
+		return !err;
 	}
 
 	/*
@@ -1217,8 +1241,19 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 	checksum = calc_checksum(page);
 	if (rmap_item->oldchecksum != checksum) {
 		rmap_item->oldchecksum = checksum;
-		return;
+		/*
+		 * Back off exponentially from a page that keeps changing:
+		 * the first change (which includes the very first visit)
+		 * is free, then skip it for 1, 3, 7.. scans, up to
+		 * KSM_MAX_SKIP_PASSES.
+		 */
+		if (rmap_item->volatility < ilog2(KSM_MAX_SKIP_PASSES) + 2)
+			rmap_item->volatility++;
+		rmap_item->skip = min((1 << (rmap_item->volatility - 1)) - 1,
+				      KSM_MAX_SKIP_PASSES);
+		return 0;
 	}
+	rmap_item->volatility = 0;
 
 	tree_rmap_item =
 		unstable_tree_search_insert(rmap_item, page, &tree_page);
@@ -1251,9 +1286,11 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 			if (!stable_node) {
 				break_cow(tree_rmap_item);
 				break_cow(rmap_item);
-			}
+			} else
+				return 1;
 		}
 	}
+	return 0;
 }
 
 static struct rmap_item *get_next_rmap_item(struct mm_slot *mm_slot,
@@ -1284,6 +1321,39 @@ static struct rmap_item *get_next_rmap_item(struct mm_slot *mm_slot,
 	return rmap_item;
 }
 
+/*
+ * Pick the mm_slot after @slot to scan next, passing over those whose
+ * recent full scans merged nothing and which are still sitting out.
+ * Called under ksm_mmlist_lock.
+ */
+static struct mm_slot *ksm_next_mm_slot(struct mm_slot *slot)
+{
+	for (;;) {
+		slot = list_entry(slot->mm_list.next, struct mm_slot, mm_list);
+		if (slot == &ksm_mm_head || !slot->skip_passes)
+			return slot;
+		slot->skip_passes--;
+	}
+}
+
+/*
+ * A full scan of @slot's mm has just completed: an mm that keeps
+ * yielding nothing is visited on fewer and fewer full scans, so that
+ * ksmd spends its pages_to_scan where merges are actually found.  The
+ * first scan of an mm only primes checksums, so it is never held
+ * against it.
+ */
+static void ksm_end_mm_scan(struct mm_slot *slot)
+{
+	if (slot->pass_merged)
+		slot->idle_passes = 0;
+	else if (slot->full_scans && slot->idle_passes < KSM_MAX_SKIP_PASSES)
+		slot->idle_passes++;
+	slot->skip_passes = slot->idle_passes;
+	slot->pass_merged = 0;
+	slot->full_scans++;
+}
+
 static struct rmap_item *scan_get_next_rmap_item(struct page **page)
 {
 	struct mm_struct *mm;
@@ -1311,9 +1381,15 @@ static struct rmap_item *scan_get_next_rmap_item(struct page **page)
 		root_unstable_tree = RB_ROOT;
 
 		spin_lock(&ksm_mmlist_lock);
-		slot = list_entry(slot->mm_list.next, struct mm_slot, mm_list);
+		slot = ksm_next_mm_slot(slot);
 		ksm_scan.mm_slot = slot;
 		spin_unlock(&ksm_mmlist_lock);
+
+		/* Every mm is sitting out this scan */
+		if (slot == &ksm_mm_head) {
+			ksm_scan.seqnr++;
+			return NULL;
+		}
 next_mm:
 		ksm_scan.address = 0;
 		ksm_scan.rmap_list = &slot->rmap_list;
@@ -1374,9 +1450,11 @@ next_mm:
 	 */
 	remove_trailing_rmap_items(slot, ksm_scan.rmap_list);
 
+	if (ksm_scan.address)
+		ksm_end_mm_scan(slot);
+
 	spin_lock(&ksm_mmlist_lock);
-	ksm_scan.mm_slot = list_entry(slot->mm_list.next,
-						struct mm_slot, mm_list);
+	ksm_scan.mm_slot = ksm_next_mm_slot(slot);
 	if (ksm_scan.address == 0) {
 		/*
 		 * We've completed a full scan of all vmas, holding mmap_sem
@@ -1423,8 +1501,17 @@ static void ksm_do_scan(unsigned int scan_npages)
 		rmap_item = scan_get_next_rmap_item(&page);
 		if (!rmap_item)
 			return;
-		if (!PageKsm(page) || !in_stable_tree(rmap_item))
-			cmp_and_merge_page(page, rmap_item);
+		rmap_item->mm->ksm_pages_scanned++;
+		if (!PageKsm(page) || !in_stable_tree(rmap_item)) {
+			if (rmap_item->skip) {
+				rmap_item->skip--;
+				rmap_item->mm->ksm_pages_skipped++;
+				ksm_pages_skipped++;
+			} else if (cmp_and_merge_page(page, rmap_item)) {
+				ksm_scan.mm_slot->pass_merged++;
+				rmap_item->mm->ksm_pages_merged++;
+			}
+		}
 		put_page(page);
 	}
 }
@@ -1554,6 +1641,8 @@ void __ksm_exit(struct mm_struct *mm)
 			list_del(&mm_slot->mm_list);
 			easy_to_free = 1;
 		} else {
+			/* ksmd must get to it on its next step */
+			mm_slot->skip_passes = 0;
 			list_move(&mm_slot->mm_list,
 				  &ksm_scan.mm_slot->mm_list);
 		}
@@ -1615,7 +1704,7 @@ again:
 		struct anon_vma_chain *vmac;
 		struct vm_area_struct *vma;
 
-		anon_vma_lock(anon_vma);
+		anon_vma_lock_read(anon_vma);
 		list_for_each_entry(vmac, &anon_vma->head, same_anon_vma) {
 			vma = vmac->vma;
 			if (rmap_item->address < vma->vm_start ||
@@ -1638,7 +1727,7 @@ again:
 			if (!search_new_forks || !mapcount)
 				break;
 		}
-		anon_vma_unlock(anon_vma);
+		anon_vma_unlock_read(anon_vma);
 		if (!mapcount)
 			goto out;
 	}
@@ -1668,7 +1757,7 @@ again:
 		struct anon_vma_chain *vmac;
 		struct vm_area_struct *vma;
 
-		anon_vma_lock(anon_vma);
+		anon_vma_lock_read(anon_vma);
 		list_for_each_entry(vmac, &anon_vma->head, same_anon_vma) {
 			vma = vmac->vma;
 			if (rmap_item->address < vma->vm_start ||
@@ -1686,11 +1775,11 @@ again:
 			ret = try_to_unmap_one(page, vma,
 					rmap_item->address, flags);
 			if (ret != SWAP_AGAIN || !page_mapped(page)) {
-				anon_vma_unlock(anon_vma);
+				anon_vma_unlock_read(anon_vma);
 				goto out;
 			}
 		}
-		anon_vma_unlock(anon_vma);
+		anon_vma_unlock_read(anon_vma);
 	}
 	if (!search_new_forks++)
 		goto again;
@@ -1720,7 +1809,7 @@ again:
 		struct anon_vma_chain *vmac;
 		struct vm_area_struct *vma;
 
-		anon_vma_lock(anon_vma);
+		anon_vma_lock_read(anon_vma);
 		list_for_each_entry(vmac, &anon_vma->head, same_anon_vma) {
 			vma = vmac->vma;
 			if (rmap_item->address < vma->vm_start ||
@@ -1737,11 +1826,11 @@ again:
 
 			ret = rmap_one(page, vma, rmap_item->address, arg);
 			if (ret != SWAP_AGAIN) {
-				anon_vma_unlock(anon_vma);
+				anon_vma_unlock_read(anon_vma);
 				goto out;
 			}
 		}
-		anon_vma_unlock(anon_vma);
+		anon_vma_unlock_read(anon_vma);
 	}
 	if (!search_new_forks++)
 		goto again;
@@ -1963,6 +2052,13 @@ static ssize_t pages_volatile_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(pages_volatile);
 
+static ssize_t pages_skipped_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_skipped);
+}
+KSM_ATTR_RO(pages_skipped);
+
 static ssize_t full_scans_show(struct kobject *kobj,
 			       struct kobj_attribute *attr, char *buf)
 {
@@ -1978,6 +2074,7 @@ static struct attribute *ksm_attrs[] = {
 	&pages_sharing_attr.attr,
 	&pages_unshared_attr.attr,
 	&pages_volatile_attr.attr,
+	&pages_skipped_attr.attr,
 	&full_scans_attr.attr,
 	NULL,
 };
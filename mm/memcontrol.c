@@ -237,6 +237,10 @@ struct mem_cgroup {
 	atomic_t	refcnt;
 
 	unsigned int	swappiness;
+	/* Upper bound, in pages, on the per-cpu charge stock */
+	unsigned int	charge_batch;
+	/* reclaims from usage above res.high_wmark down to res.low_wmark */
+	struct work_struct bg_reclaim_work;
 	/* OOM-Killer disable */
 	int		oom_kill_disable;
 
@@ -650,11 +654,31 @@ static bool __memcg_event_check(struct mem_cgroup *mem, int event_mask_shift)
  * Check events in order.
  *
  */
+static struct workqueue_struct *memcg_bg_reclaim_wq;
+
+/*
+ * Kick background reclaim for mem and every ancestor whose usage went
+ * above its high watermark.
+ */
+static void mem_cgroup_check_wmarks(struct mem_cgroup *mem)
+{
+	if (!memcg_bg_reclaim_wq)
+		return;
+
+	for (; mem; mem = parent_mem_cgroup(mem)) {
+		if (ACCESS_ONCE(mem->res.high_wmark) == RESOURCE_MAX)
+			continue;
+		if (res_counter_check_over_high_wmark(&mem->res))
+			queue_work(memcg_bg_reclaim_wq, &mem->bg_reclaim_work);
+	}
+}
+
 static void memcg_check_events(struct mem_cgroup *mem, struct page *page)
 {
 	/* threshold event is triggered in finer grain than soft limit */
 	if (unlikely(__memcg_event_check(mem, THRESHOLDS_EVENTS_THRESH))) {
 		mem_cgroup_threshold(mem);
+		mem_cgroup_check_wmarks(mem);
 		if (unlikely(__memcg_event_check(mem, SOFTLIMIT_EVENTS_THRESH)))
 			mem_cgroup_update_tree(mem, page);
 	}
@@ -1459,6 +1483,40 @@ static int mem_cgroup_hierarchical_reclaim(struct mem_cgroup *root_mem,
 	return total;
 }
 
+/*
+ * Background reclaim, the kswapd of a memory cgroup: once usage has gone
+ * above res.high_wmark, reclaim from the hierarchy below mem, through the
+ * same path as limit reclaim, until usage is under res.low_wmark - so
+ * that charges do not have to stall at the hard limit.
+ */
+static void mem_cgroup_bg_reclaim(struct work_struct *work)
+{
+	struct mem_cgroup *mem = container_of(work, struct mem_cgroup,
+					      bg_reclaim_work);
+	int nr_retries = MEM_CGROUP_RECLAIM_RETRIES;
+
+	while (!res_counter_check_under_low_wmark(&mem->res)) {
+		if (!mem_cgroup_hierarchical_reclaim(mem, NULL, GFP_KERNEL,
+					MEM_CGROUP_RECLAIM_SHRINK)) {
+			if (!--nr_retries)
+				break;
+			/* maybe some writeback is necessary */
+			congestion_wait(BLK_RW_ASYNC, HZ/10);
+		}
+		cond_resched();
+	}
+}
+
+static int __init mem_cgroup_bg_reclaim_init(void)
+{
+	if (mem_cgroup_disabled())
+		return 0;
+	memcg_bg_reclaim_wq = alloc_workqueue("memcg_bgreclaim",
+					      WQ_UNBOUND | WQ_MEM_RECLAIM, 0);
+	return memcg_bg_reclaim_wq ? 0 : -ENOMEM;
+}
+module_init(mem_cgroup_bg_reclaim_init);
+
 /*
  * Check OOM-Killer is already running under our hierarchy.
  * If someone is running, return false.
@@ -1659,12 +1717,26 @@ EXPORT_SYMBOL(mem_cgroup_update_page_stat);
 
 /*
  * size of first charge trial. "32" comes from vmscan.c's magic value.
- * TODO: maybe necessary to use big numbers in big irons.
+ * A cpu that keeps running through its stock quickly charges more at a
+ * time, up to memory.charge_batch pages (CHARGE_BATCH_DEFAULT unless
+ * set), so busy cgroups on big machines hit res_counter less often.
  */
 #define CHARGE_SIZE	(32 * PAGE_SIZE)
+#define CHARGE_BATCH_DEFAULT	256	/* pages */
+#define CHARGE_BATCH_MAX	16384	/* pages */
+
+/*
+ * A stock used up within STOCK_FAST of its refill doubles the next
+ * batch; one that lasted longer than STOCK_SLOW halves it.
+ */
+#define STOCK_FAST	(HZ / 50 ? HZ / 50 : 1)
+#define STOCK_SLOW	HZ
+
 struct memcg_stock_pcp {
 	struct mem_cgroup *cached; /* this never be root cgroup */
 	int charge;
+	int batch;		/* bytes charged by the last refill */
+	unsigned long refill_time; /* jiffies of the last refill */
 	struct work_struct work;
 };
 static DEFINE_PER_CPU(struct memcg_stock_pcp, memcg_stock);
@@ -1704,6 +1776,7 @@ static void drain_stock(struct memcg_stock_pcp *stock)
 	}
 	stock->cached = NULL;
 	stock->charge = 0;
+	stock->batch = 0;
 }
 
 /*
@@ -1718,9 +1791,10 @@ static void drain_local_stock(struct work_struct *dummy)
 
 /*
  * Cache charges(val) which is from res_counter, to local per_cpu area.
- * This will be consumed by consume_stock() function, later.
+ * This will be consumed by consume_stock() function, later. batch is
+ * the size of the res_counter charge val came from.
  */
-static void refill_stock(struct mem_cgroup *mem, int val)
+static void refill_stock(struct mem_cgroup *mem, int val, int batch)
 {
 	struct memcg_stock_pcp *stock = &get_cpu_var(memcg_stock);
 
@@ -1729,6 +1803,43 @@ static void refill_stock(struct mem_cgroup *mem, int val)
 		stock->cached = mem;
 	}
 	stock->charge += val;
+	stock->batch = batch;
+	stock->refill_time = jiffies;
+	put_cpu_var(memcg_stock);
+}
+
+/*
+ * Size of the res_counter charge to make when this cpu's stock for mem
+ * has run out, adapted to how fast the last one was used up.
+ */
+static int memcg_charge_batch(struct mem_cgroup *mem)
+{
+	struct memcg_stock_pcp *stock;
+	int max = ACCESS_ONCE(mem->charge_batch) * PAGE_SIZE;
+	int batch = CHARGE_SIZE;
+
+	stock = &get_cpu_var(memcg_stock);
+	if (stock->cached == mem && stock->batch) {
+		batch = stock->batch;
+		if (time_before(jiffies, stock->refill_time + STOCK_FAST))
+			batch *= 2;
+		else if (time_after(jiffies, stock->refill_time + STOCK_SLOW))
+			batch /= 2;
+	}
+	put_cpu_var(memcg_stock);
+
+	return clamp_t(int, batch, min_t(int, CHARGE_SIZE, max), max);
+}
+
+/*
+ * A batched charge failed near the limit: start over from CHARGE_SIZE.
+ */
+static void memcg_reset_charge_batch(struct mem_cgroup *mem)
+{
+	struct memcg_stock_pcp *stock = &get_cpu_var(memcg_stock);
+
+	if (stock->cached == mem)
+		stock->batch = 0;
 	put_cpu_var(memcg_stock);
 }
 
@@ -1835,7 +1946,7 @@ enum {
 };
 
 static int __mem_cgroup_do_charge(struct mem_cgroup *mem, gfp_t gfp_mask,
-				int csize, bool oom_check)
+				int csize, int page_size, bool oom_check)
 {
 	struct mem_cgroup *mem_over_limit;
 	struct res_counter *fail_res;
@@ -1858,13 +1969,13 @@ static int __mem_cgroup_do_charge(struct mem_cgroup *mem, gfp_t gfp_mask,
 		mem_over_limit = mem_cgroup_from_res_counter(fail_res, res);
 	/*
 	 * csize can be either a huge page (HPAGE_SIZE), a batch of
-	 * regular pages (CHARGE_SIZE), or a single regular page
-	 * (PAGE_SIZE).
+	 * regular pages (see memcg_charge_batch()), or a single regular
+	 * page (PAGE_SIZE).
 	 *
 	 * Never reclaim on behalf of optional batching, retry with a
 	 * single page instead.
 	 */
-	if (csize == CHARGE_SIZE)
+	if (csize > page_size)
 		return CHARGE_RETRY;
 
 	if (!(gfp_mask & __GFP_WAIT))
@@ -1915,7 +2026,8 @@ static int __mem_cgroup_try_charge(struct mm_struct *mm,
 	int nr_oom_retries = MEM_CGROUP_RECLAIM_RETRIES;
 	struct mem_cgroup *mem = NULL;
 	int ret;
-	int csize = max(CHARGE_SIZE, (unsigned long) page_size);
+	int csize = page_size;
+	bool batch = page_size == PAGE_SIZE;
 
 	/*
 	 * Unlike gloval-vm's OOM-kill, we're not in memory shortage
@@ -1983,6 +2095,9 @@ again:
 		rcu_read_unlock();
 	}
 
+	if (batch)
+		csize = memcg_charge_batch(mem);
+
 	do {
 		bool oom_check;
 
@@ -1998,12 +2113,16 @@ again:
 			nr_oom_retries = MEM_CGROUP_RECLAIM_RETRIES;
 		}
 
-		ret = __mem_cgroup_do_charge(mem, gfp_mask, csize, oom_check);
+		ret = __mem_cgroup_do_charge(mem, gfp_mask, csize, page_size,
+					     oom_check);
 
 		switch (ret) {
 		case CHARGE_OK:
 			break;
 		case CHARGE_RETRY: /* not in OOM situation but retry */
+			if (csize > page_size)
+				memcg_reset_charge_batch(mem);
+			batch = false;
 			csize = page_size;
 			css_put(&mem->css);
 			mem = NULL;
@@ -2026,7 +2145,7 @@ again:
 	} while (ret != CHARGE_OK);
 
 	if (csize > page_size)
-		refill_stock(mem, csize - page_size);
+		refill_stock(mem, csize - page_size, csize);
 	css_put(&mem->css);
 done:
 	*memcg = mem;
@@ -3557,6 +3676,20 @@ static int mem_cgroup_write(struct cgroup *cont, struct cftype *cft,
 		else
 			ret = -EINVAL;
 		break;
+	case RES_HIGH_WMARK:
+	case RES_LOW_WMARK:
+		/* the root cgroup is never charged */
+		if (mem_cgroup_is_root(memcg)) {
+			ret = -EINVAL;
+			break;
+		}
+		ret = res_counter_memparse_write_strategy(buffer, &val);
+		if (ret)
+			break;
+		ret = res_counter_set_wmark(&memcg->res, name, val);
+		if (!ret)
+			mem_cgroup_check_wmarks(memcg);
+		break;
 	default:
 		ret = -EINVAL; /* should be BUG() ? */
 		break;
@@ -3837,6 +3970,24 @@ static int mem_cgroup_swappiness_write(struct cgroup *cgrp, struct cftype *cft,
 	return 0;
 }
 
+static u64 mem_cgroup_charge_batch_read(struct cgroup *cgrp,
+					struct cftype *cft)
+{
+	return mem_cgroup_from_cont(cgrp)->charge_batch;
+}
+
+static int mem_cgroup_charge_batch_write(struct cgroup *cgrp,
+					 struct cftype *cft, u64 val)
+{
+	struct mem_cgroup *memcg = mem_cgroup_from_cont(cgrp);
+
+	if (!val || val > CHARGE_BATCH_MAX)
+		return -EINVAL;
+	/* cpus pick up the new bound at their next refill */
+	memcg->charge_batch = val;
+	return 0;
+}
+
 static void __mem_cgroup_threshold(struct mem_cgroup *memcg, bool swap)
 {
 	struct mem_cgroup_threshold_ary *t;
@@ -4194,6 +4345,18 @@ static struct cftype mem_cgroup_files[] = {
 		.write_string = mem_cgroup_write,
 		.read_u64 = mem_cgroup_read,
 	},
+	{
+		.name = "high_wmark_in_bytes",
+		.private = MEMFILE_PRIVATE(_MEM, RES_HIGH_WMARK),
+		.write_string = mem_cgroup_write,
+		.read_u64 = mem_cgroup_read,
+	},
+	{
+		.name = "low_wmark_in_bytes",
+		.private = MEMFILE_PRIVATE(_MEM, RES_LOW_WMARK),
+		.write_string = mem_cgroup_write,
+		.read_u64 = mem_cgroup_read,
+	},
 	{
 		.name = "failcnt",
 		.private = MEMFILE_PRIVATE(_MEM, RES_FAILCNT),
@@ -4218,6 +4381,11 @@ static struct cftype mem_cgroup_files[] = {
 		.read_u64 = mem_cgroup_swappiness_read,
 		.write_u64 = mem_cgroup_swappiness_write,
 	},
+	{
+		.name = "charge_batch",
+		.read_u64 = mem_cgroup_charge_batch_read,
+		.write_u64 = mem_cgroup_charge_batch_write,
+	},
 	{
 		.name = "move_charge_at_immigrate",
 		.read_u64 = mem_cgroup_move_charge_read,
@@ -4486,11 +4654,15 @@ mem_cgroup_create(struct cgroup_subsys *ss, struct cgroup *cont)
 		res_counter_init(&mem->memsw, NULL);
 	}
 	mem->last_scanned_child = 0;
+	INIT_WORK(&mem->bg_reclaim_work, mem_cgroup_bg_reclaim);
 	spin_lock_init(&mem->reclaim_param_lock);
 	INIT_LIST_HEAD(&mem->oom_notify);
 
-	if (parent)
+	if (parent) {
 		mem->swappiness = get_swappiness(parent);
+		mem->charge_batch = parent->charge_batch;
+	} else
+		mem->charge_batch = CHARGE_BATCH_DEFAULT;
 	atomic_set(&mem->refcnt, 1);
 	mem->move_charge_at_immigrate = 0;
 	mutex_init(&mem->thresholds_lock);
@@ -4514,6 +4686,7 @@ static void mem_cgroup_destroy(struct cgroup_subsys *ss,
 {
 	struct mem_cgroup *mem = mem_cgroup_from_cont(cont);
 
+	cancel_work_sync(&mem->bg_reclaim_work);
 	mem_cgroup_put(mem);
 }
 
@@ -703,7 +703,7 @@ static int unmap_and_move(new_page_t get_new_page, unsigned long private,
 		 * Only page_lock_anon_vma() understands the subtleties of
 		 * getting a hold on an anon_vma from outside one of its mms.
 		 */
-		anon_vma = page_lock_anon_vma(page);
+		anon_vma = page_lock_anon_vma_read(page);
 		if (anon_vma) {
 			/*
 			 * Take a reference count on the anon_vma if the
@@ -711,7 +711,7 @@ static int unmap_and_move(new_page_t get_new_page, unsigned long private,
 			 * exist when the page is remapped later
 			 */
 			get_anon_vma(anon_vma);
-			page_unlock_anon_vma(anon_vma);
+			page_unlock_anon_vma_read(anon_vma);
 		} else if (PageSwapCache(page)) {
 			/*
 			 * We cannot be sure that the anon_vma of an unmapped
@@ -840,10 +840,10 @@ static int unmap_and_move_huge_page(new_page_t get_new_page,
 	}
 
 	if (PageAnon(hpage)) {
-		anon_vma = page_lock_anon_vma(hpage);
+		anon_vma = page_lock_anon_vma_read(hpage);
 		if (anon_vma) {
 			get_anon_vma(anon_vma);
-			page_unlock_anon_vma(anon_vma);
+			page_unlock_anon_vma_read(anon_vma);
 		}
 	}
 
@@ -43,18 +43,17 @@
 static long ratelimit_pages = 32;
 
 /*
- * When balance_dirty_pages decides that the caller needs to perform some
- * non-background writeback, this is how many pages it will attempt to write.
- * It should be somewhat larger than dirtied pages to ensure that reasonably
- * large amounts of I/O are submitted.
+ * Sample the bdi write bandwidth at most this often.
  */
-static inline long sync_writeback_pages(unsigned long dirtied)
-{
-	if (dirtied < ratelimit_pages)
-		dirtied = ratelimit_pages;
+#define BANDWIDTH_INTERVAL	max(HZ/5, 1)
 
-	return dirtied + dirtied / 2;
-}
+/*
+ * Upper bound for a single balance_dirty_pages() sleep.  Long enough to
+ * let a slow device make progress, short enough to stay responsive.
+ */
+#define MAX_PAUSE		max(HZ/5, 1)
+
+static DEFINE_SPINLOCK(bdi_bandwidth_lock);
 
 /* The following parameters are exported via /proc/sys/vm */
 
@@ -219,6 +218,7 @@ int dirty_bytes_handler(struct ctl_table *table, int write,
  */
 static inline void __bdi_writeout_inc(struct backing_dev_info *bdi)
 {
+	__inc_bdi_stat(bdi, BDI_WRITTEN);
 	__prop_inc_percpu_max(&vm_completions, &bdi->completions,
 			      bdi->max_prop_frac);
 }
@@ -468,34 +468,135 @@ unsigned long bdi_dirty_limit(struct backing_dev_info *bdi, unsigned long dirty)
 	return bdi_dirty;
 }
 
+/*
+ * Fold the pages written during the last @elapsed jiffies into the
+ * bandwidth estimate.  write_bandwidth is a moving average over a ~3s
+ * period; avg_write_bandwidth only follows it when the two move in the
+ * same direction, which filters out the spikes caused by bursty
+ * completions.
+ */
+static void bdi_update_write_bandwidth(struct backing_dev_info *bdi,
+				       unsigned long elapsed,
+				       unsigned long written)
+{
+	const unsigned long period = roundup_pow_of_two(3 * HZ);
+	unsigned long avg = bdi->avg_write_bandwidth;
+	unsigned long old = bdi->write_bandwidth;
+	u64 bw;
+
+	/*
+	 * bw = written * HZ / elapsed
+	 *
+	 *                   bw * elapsed + write_bandwidth * (period - elapsed)
+	 * write_bandwidth = ---------------------------------------------------
+	 *                                          period
+	 */
+	bw = written - bdi->written_stamp;
+	bw *= HZ;
+	if (unlikely(elapsed > period)) {
+		do_div(bw, elapsed);
+		avg = bw;
+		goto out;
+	}
+	bw += (u64)bdi->write_bandwidth * (period - elapsed);
+	bw >>= ilog2(period);
+
+	if (avg > old && old >= (unsigned long)bw)
+		avg -= (avg - old) >> 3;
+
+	if (avg < old && old <= (unsigned long)bw)
+		avg += (old - avg) >> 3;
+
+out:
+	bdi->write_bandwidth = bw;
+	bdi->avg_write_bandwidth = max(avg, 1UL);
+	trace_bdi_write_bandwidth(bdi, elapsed, written - bdi->written_stamp);
+}
+
+/**
+ * bdi_update_bandwidth - refresh the write bandwidth estimate of @bdi
+ * @bdi: the backing device
+ * @start_time: when the caller started the current writeback pass
+ *
+ * Called from the flusher between writeback chunks and from throttled
+ * writers.  Periods in which the device sat idle because nobody was
+ * writing back (more than a second with no flusher activity since
+ * @start_time) are not folded in, so they do not drag the estimate down.
+ */
+void bdi_update_bandwidth(struct backing_dev_info *bdi,
+			  unsigned long start_time)
+{
+	unsigned long now = jiffies;
+	unsigned long elapsed;
+	unsigned long written;
+
+	if (time_before(now, bdi->bw_time_stamp + BANDWIDTH_INTERVAL))
+		return;
+
+	spin_lock(&bdi_bandwidth_lock);
+	elapsed = now - bdi->bw_time_stamp;
+	if (elapsed < BANDWIDTH_INTERVAL)
+		goto unlock;
+
+	written = percpu_counter_read(&bdi->bdi_stat[BDI_WRITTEN]);
+
+	if (elapsed > HZ && time_before(bdi->bw_time_stamp, start_time))
+		goto snapshot;
+
+	bdi_update_write_bandwidth(bdi, elapsed, written);
+
+snapshot:
+	bdi->written_stamp = written;
+	bdi->bw_time_stamp = now;
+unlock:
+	spin_unlock(&bdi_bandwidth_lock);
+}
+
+/*
+ * How long a task that just dirtied @pages_dirtied pages against @bdi
+ * should sleep: the time the device needs to write them back at its
+ * measured bandwidth, stretched by how far the bdi is above its share of
+ * the dirty limit so that the heaviest dirtiers back off the hardest.
+ */
+static unsigned long bdi_dirty_pause(struct backing_dev_info *bdi,
+				     unsigned long pages_dirtied,
+				     unsigned long bdi_dirty,
+				     unsigned long bdi_thresh)
+{
+	unsigned long bw = bdi->avg_write_bandwidth;
+	u64 pause;
+
+	pause = (u64)HZ * pages_dirtied;
+	if (bdi_dirty > bdi_thresh && bdi_thresh)
+		pause = div_u64(pause * bdi_dirty, bdi_thresh);
+	pause = div_u64(pause, bw);
+
+	return clamp_t(unsigned long, pause, 1, MAX_PAUSE);
+}
+
 /*
  * balance_dirty_pages() must be called by processes which are generating dirty
- * data.  It looks at the number of dirty pages in the machine and will force
- * the caller to perform writeback if the system is over `vm_dirty_ratio'.
- * If we're over `background_thresh' then the writeback threads are woken to
- * perform some writeout.
+ * data.  It looks at the number of dirty pages in the machine and will put
+ * the caller to sleep, for a time derived from the bdi's measured write
+ * bandwidth, while the system is over `vm_dirty_ratio'.  If we're over
+ * `background_thresh' then the writeback threads are woken to perform some
+ * writeout.
  */
 static void balance_dirty_pages(struct address_space *mapping,
-				unsigned long write_chunk)
+				unsigned long pages_dirtied)
 {
 	long nr_reclaimable, bdi_nr_reclaimable;
 	long nr_writeback, bdi_nr_writeback;
 	unsigned long background_thresh;
 	unsigned long dirty_thresh;
 	unsigned long bdi_thresh;
-	unsigned long pages_written = 0;
-	unsigned long pause = 1;
+	unsigned long start_time = jiffies;
+	unsigned long pause;
 	bool dirty_exceeded = false;
+	bool throttled = false;
 	struct backing_dev_info *bdi = mapping->backing_dev_info;
 
 	for (;;) {
-		struct writeback_control wbc = {
-			.sync_mode	= WB_SYNC_NONE,
-			.older_than_this = NULL,
-			.nr_to_write	= write_chunk,
-			.range_cyclic	= 1,
-		};
-
 		nr_reclaimable = global_page_state(NR_FILE_DIRTY) +
 					global_page_state(NR_UNSTABLE_NFS);
 		nr_writeback = global_page_state(NR_WRITEBACK);
@@ -548,34 +649,37 @@ static void balance_dirty_pages(struct address_space *mapping,
 		if (!bdi->dirty_exceeded)
 			bdi->dirty_exceeded = 1;
 
-		/* Note: nr_reclaimable denotes nr_dirty + nr_unstable.
-		 * Unstable writes are a feature of certain networked
-		 * filesystems (i.e. NFS) in which data may have been
-		 * written to the server's write cache, but has not yet
-		 * been flushed to permanent storage.
-		 * Only move pages to writeback if this bdi is over its
-		 * threshold otherwise wait until the disk writes catch
-		 * up.
+		/*
+		 * Rather than submitting IO from this context, which turns
+		 * concurrent dirtiers into competing seeky writers, leave
+		 * the writeout to the flusher and sleep for as long as the
+		 * device needs to retire what we have dirtied.  Sizing the
+		 * sleep from the measured bandwidth of *this* bdi keeps
+		 * writers to a slow stick from holding global dirty pages
+		 * (and thus unrelated writers) hostage for long.
 		 */
-		trace_wbc_balance_dirty_start(&wbc, bdi);
-		if (bdi_nr_reclaimable > bdi_thresh) {
-			writeback_inodes_wb(&bdi->wb, &wbc);
-			pages_written += write_chunk - wbc.nr_to_write;
-			trace_wbc_balance_dirty_written(&wbc, bdi);
-			if (pages_written >= write_chunk)
-				break;		/* We've done our duty */
-		}
-		trace_wbc_balance_dirty_wait(&wbc, bdi);
+		if (!writeback_in_progress(bdi))
+			bdi_start_background_writeback(bdi);
+
+		bdi_update_bandwidth(bdi, start_time);
+		pause = bdi_dirty_pause(bdi, pages_dirtied,
+					bdi_nr_reclaimable + bdi_nr_writeback,
+					bdi_thresh);
+		trace_balance_dirty_pages(bdi, dirty_thresh, background_thresh,
+					  nr_reclaimable + nr_writeback,
+					  bdi_thresh,
+					  bdi_nr_reclaimable + bdi_nr_writeback,
+					  pages_dirtied, pause);
 		__set_current_state(TASK_UNINTERRUPTIBLE);
 		io_schedule_timeout(pause);
+		throttled = true;
 
 		/*
-		 * Increase the delay for each loop, up to our previous
-		 * default of taking a 100ms nap.
+		 * The task is about to die anyway; let it go so it can
+		 * release its memory instead of waiting on the device.
 		 */
-		pause <<= 1;
-		if (pause > HZ / 10)
-			pause = HZ / 10;
+		if (fatal_signal_pending(current))
+			break;
 	}
 
 	if (!dirty_exceeded && bdi->dirty_exceeded)
@@ -592,7 +696,7 @@ static void balance_dirty_pages(struct address_space *mapping,
 	 * In normal mode, we start background writeout at the lower
 	 * background_thresh, to keep the amount of dirty memory low.
 	 */
-	if ((laptop_mode && pages_written) ||
+	if ((laptop_mode && throttled) ||
 	    (!laptop_mode && (nr_reclaimable > background_thresh)))
 		bdi_start_background_writeback(bdi);
 }
@@ -641,7 +745,7 @@ void balance_dirty_pages_ratelimited_nr(struct address_space *mapping,
 	p =  &__get_cpu_var(bdp_ratelimits);
 	*p += nr_pages_dirtied;
 	if (unlikely(*p >= ratelimit)) {
-		ratelimit = sync_writeback_pages(*p);
+		ratelimit = *p;
 		*p = 0;
 		preempt_enable();
 		balance_dirty_pages(mapping, ratelimit);
@@ -1039,11 +1143,17 @@ static int __writepage(struct page *page, struct writeback_control *wbc,
 int generic_writepages(struct address_space *mapping,
 		       struct writeback_control *wbc)
 {
+	struct blk_plug plug;
+	int ret;
+
 	/* deal with chardevs and other special file */
 	if (!mapping->a_ops->writepage)
 		return 0;
 
-	return write_cache_pages(mapping, wbc, __writepage, mapping);
+	blk_start_plug(&plug);
+	ret = write_cache_pages(mapping, wbc, __writepage, mapping);
+	blk_finish_plug(&plug);
+	return ret;
 }
 
 EXPORT_SYMBOL(generic_writepages);
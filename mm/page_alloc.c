@@ -1043,6 +1043,78 @@ static int rmqueue_bulk(struct zone *zone, unsigned int order,
 	return i;
 }
 
+/*
+ * The per-cpu high watermark adapts to each CPU's recent alloc/free
+ * pattern between high_min (6 * batch) and PCP_HIGH_SCALE times that.
+ * A CPU that has to refill its list shortly after spilling a batch is
+ * bouncing the same pages through zone->lock, so it is allowed to hold
+ * more; a CPU that only frees gets its list trimmed in large chunks and
+ * its watermark lowered again.  vmstat_update() decays the watermark
+ * back towards high_min once the traffic stops.
+ */
+#define PCP_HIGH_SCALE	4
+
+/*
+ * Number of pages to hand back to the buddy allocator once pcp->count
+ * reaches pcp->high.  Called with interrupts disabled.
+ */
+static inline int nr_pcp_free(struct per_cpu_pages *pcp)
+{
+	/*
+	 * Nothing was allocated from this list since it was last at
+	 * high: the pages are not going to be reused locally, so move
+	 * them out with one lock round trip instead of high/batch ones.
+	 */
+	if (pcp->free_count >= pcp->high && pcp->count > pcp->batch) {
+		pcp->high = max(pcp->high - pcp->batch, pcp->high_min);
+		pcp->free_count = 0;
+		pcp->spilled = 0;
+		return pcp->count - pcp->batch;
+	}
+
+	pcp->spilled = 1;
+	return pcp->batch;
+}
+
+/*
+ * The list ran dry: if we spilled a batch since the last refill, raise
+ * the watermark so the next free burst stays on this CPU.  Called with
+ * interrupts disabled.
+ */
+static inline void pcp_refill_high(struct per_cpu_pages *pcp)
+{
+	if (pcp->spilled) {
+		pcp->high = min(pcp->high + pcp->batch, pcp->high_max);
+		pcp->spilled = 0;
+	}
+}
+
+/*
+ * Called from the vmstat counter updater to let an adaptively raised
+ * high watermark fall back towards high_min, giving back any pages
+ * above the lowered mark.
+ *
+ * Note that this function must be called with the thread pinned to
+ * a single processor.
+ */
+void decay_pcp_high(struct zone *zone, struct per_cpu_pages *pcp)
+{
+	unsigned long flags;
+	int to_free;
+
+	if (pcp->high <= pcp->high_min)
+		return;
+
+	local_irq_save(flags);
+	pcp->high -= max((pcp->high - pcp->high_min) >> 2, 1);
+	to_free = pcp->count - pcp->high;
+	if (to_free > 0) {
+		free_pcppages_bulk(zone, to_free, pcp);
+		pcp->count -= to_free;
+	}
+	local_irq_restore(flags);
+}
+
 #ifdef CONFIG_NUMA
 /*
  * Called from the vmstat counter updater to drain pagesets of this
@@ -1105,11 +1177,46 @@ void drain_local_pages(void *arg)
 }
 
 /*
- * Spill all the per-cpu pages from all CPUs back into the buddy allocator
+ * Spill all the per-cpu pages from all CPUs back into the buddy allocator.
+ *
+ * Only CPUs that actually hold per-cpu pages in some zone get the IPI;
+ * on large machines most lists are empty by the time direct reclaim or
+ * memory offlining gets here.
  */
 void drain_all_pages(void)
 {
-	on_each_cpu(drain_local_pages, NULL, 1);
+	int cpu;
+	struct zone *zone;
+
+	/*
+	 * Kept in BSS so that CONFIG_CPUMASK_OFFSTACK=y does not need an
+	 * allocation from the direct reclaim path.  Concurrent callers may
+	 * scribble over each other's mask; the worst case is an extra IPI
+	 * or a list that refilled after being sampled, which the caller
+	 * has to tolerate anyway.
+	 */
+	static cpumask_t cpus_with_pcps;
+
+	for_each_online_cpu(cpu) {
+		bool has_pcps = false;
+
+		for_each_populated_zone(zone) {
+			if (per_cpu_ptr(zone->pageset, cpu)->pcp.count) {
+				has_pcps = true;
+				break;
+			}
+		}
+		if (has_pcps)
+			cpumask_set_cpu(cpu, &cpus_with_pcps);
+		else
+			cpumask_clear_cpu(cpu, &cpus_with_pcps);
+	}
+
+	preempt_disable();
+	smp_call_function_many(&cpus_with_pcps, drain_local_pages, NULL, 1);
+	if (cpumask_test_cpu(smp_processor_id(), &cpus_with_pcps))
+		drain_local_pages(NULL);
+	preempt_enable();
 }
 
 #ifdef CONFIG_HIBERNATION
@@ -1191,9 +1298,12 @@ void free_hot_cold_page(struct page *page, int cold)
 	else
 		list_add(&page->lru, &pcp->lists[migratetype]);
 	pcp->count++;
+	pcp->free_count++;
 	if (pcp->count >= pcp->high) {
-		free_pcppages_bulk(zone, pcp->batch, pcp);
-		pcp->count -= pcp->batch;
+		int to_free = nr_pcp_free(pcp);
+
+		free_pcppages_bulk(zone, to_free, pcp);
+		pcp->count -= to_free;
 	}
 
 out:
@@ -1296,12 +1406,14 @@ again:
 		pcp = &this_cpu_ptr(zone->pageset)->pcp;
 		list = &pcp->lists[migratetype];
 		if (list_empty(list)) {
+			pcp_refill_high(pcp);
 			pcp->count += rmqueue_bulk(zone, 0,
 					pcp->batch, list,
 					migratetype, cold);
 			if (unlikely(list_empty(list)))
 				goto failed;
 		}
+		pcp->free_count = 0;
 
 		if (cold)
 			page = list_entry(list->prev, struct page, lru);
@@ -1943,8 +2055,12 @@ void wake_all_kswapd(unsigned int order, struct zonelist *zonelist,
 	struct zoneref *z;
 	struct zone *zone;
 
-	for_each_zone_zonelist(zone, z, zonelist, high_zoneidx)
+	for_each_zone_zonelist(zone, z, zonelist, high_zoneidx) {
 		wakeup_kswapd(zone, order, classzone_idx);
+		if (order)
+			wakeup_kcompactd(zone->zone_pgdat, order,
+					 classzone_idx);
+	}
 }
 
 static inline int
@@ -3426,6 +3542,8 @@ static void setup_pageset(struct per_cpu_pageset *p, unsigned long batch)
 	pcp = &p->pcp;
 	pcp->count = 0;
 	pcp->high = 6 * batch;
+	pcp->high_min = pcp->high;
+	pcp->high_max = PCP_HIGH_SCALE * pcp->high;
 	pcp->batch = max(1UL, 1 * batch);
 	for (migratetype = 0; migratetype < MIGRATE_PCPTYPES; migratetype++)
 		INIT_LIST_HEAD(&pcp->lists[migratetype]);
@@ -3443,6 +3561,9 @@ static void setup_pagelist_highmark(struct per_cpu_pageset *p,
 
 	pcp = &p->pcp;
 	pcp->high = high;
+	/* an explicit percpu_pagelist_fraction disables adaptive sizing */
+	pcp->high_min = high;
+	pcp->high_max = high;
 	pcp->batch = max(1UL, high/4);
 	if ((high/4) > (PAGE_SHIFT * 8))
 		pcp->batch = PAGE_SHIFT * 8;
@@ -4136,6 +4257,9 @@ static void __paginginit free_area_init_core(struct pglist_data *pgdat,
 	pgdat_resize_init(pgdat);
 	pgdat->nr_zones = 0;
 	init_waitqueue_head(&pgdat->kswapd_wait);
+#ifdef CONFIG_COMPACTION
+	init_waitqueue_head(&pgdat->kcompactd_wait);
+#endif
 	pgdat->kswapd_max_order = 0;
 	pgdat_page_cgroup_init(pgdat);
 	
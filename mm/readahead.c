@@ -26,6 +26,8 @@ void
 file_ra_state_init(struct file_ra_state *ra, struct address_space *mapping)
 {
 	ra->ra_pages = mapping->backing_dev_info->ra_pages;
+	ra->ra_wasted = atomic_read(&mapping->ra_wasted);
+	ra->ra_shift = 0;
 	ra->prev_pos = -1;
 }
 EXPORT_SYMBOL_GPL(file_ra_state_init);
@@ -109,9 +111,12 @@ EXPORT_SYMBOL(read_cache_pages);
 static int read_pages(struct address_space *mapping, struct file *filp,
 		struct list_head *pages, unsigned nr_pages)
 {
+	struct blk_plug plug;
 	unsigned page_idx;
 	int ret;
 
+	blk_start_plug(&plug);
+
 	if (mapping->a_ops->readpages) {
 		ret = mapping->a_ops->readpages(filp, mapping, pages, nr_pages);
 		/* Clean up the remaining pages */
@@ -130,6 +135,7 @@ static int read_pages(struct address_space *mapping, struct file *filp,
 	}
 	ret = 0;
 out:
+	blk_finish_plug(&plug);
 	return ret;
 }
 
@@ -189,8 +195,10 @@ __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 	 * uptodate then the caller will launch readpage again, and
 	 * will then handle the error.
 	 */
-	if (ret)
+	if (ret) {
+		count_vm_events(READAHEAD_PAGES, ret);
 		read_pages(mapping, filp, &page_pool, ret);
+	}
 	BUG_ON(!list_empty(&page_pool));
 out:
 	return ret;
@@ -228,6 +236,7 @@ int force_page_cache_readahead(struct address_space *mapping, struct file *filp,
 	}
 	return ret;
 }
+EXPORT_SYMBOL_GPL(force_page_cache_readahead);
 
 /*
  * Given a desired number of PAGE_CACHE_SIZE readahead pages, return a
@@ -291,6 +300,35 @@ static unsigned long get_next_ra_size(struct file_ra_state *ra,
 	return min(newsize, max);
 }
 
+/*
+ * Don't shrink the window below ra_pages >> RA_MAX_SHIFT.
+ */
+#define RA_MAX_SHIFT	3
+
+/*
+ * Per-file feedback on how well readahead has been doing.  Reclaim bumps
+ * mapping->ra_wasted whenever it evicts a PG_readahead marker that was
+ * never reached, i.e. the tail of a window was read for nothing; halve
+ * the window cap each time that happens.  Every marker hit is evidence
+ * that the stream is really sequential and doubles the cap again, up to
+ * ra->ra_pages.
+ */
+static unsigned long ra_max_pages(struct address_space *mapping,
+				  struct file_ra_state *ra,
+				  bool hit_readahead_marker)
+{
+	unsigned int wasted = atomic_read(&mapping->ra_wasted);
+
+	if (wasted != ra->ra_wasted) {
+		ra->ra_wasted = wasted;
+		if (ra->ra_shift < RA_MAX_SHIFT)
+			ra->ra_shift++;
+	} else if (hit_readahead_marker && ra->ra_shift)
+		ra->ra_shift--;
+
+	return max_sane_readahead(max(ra->ra_pages >> ra->ra_shift, 1U));
+}
+
 /*
  * On-demand readahead design.
  *
@@ -392,7 +430,7 @@ ondemand_readahead(struct address_space *mapping,
 		   bool hit_readahead_marker, pgoff_t offset,
 		   unsigned long req_size)
 {
-	unsigned long max = max_sane_readahead(ra->ra_pages);
+	unsigned long max = ra_max_pages(mapping, ra, hit_readahead_marker);
 
 	/*
 	 * start of file
@@ -545,6 +583,7 @@ page_cache_async_readahead(struct address_space *mapping,
 		return;
 
 	ClearPageReadahead(page);
+	count_vm_event(READAHEAD_HIT);
 
 	/*
 	 * Defer asynchronous read-ahead on IO congestion.
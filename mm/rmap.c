@@ -25,7 +25,7 @@
  *   mm->mmap_sem
  *     page->flags PG_locked (lock_page)
  *       mapping->i_mmap_lock
- *         anon_vma->lock
+ *         anon_vma->lock (rwlock of the root anon_vma)
  *           mm->page_table_lock or pte_lock
  *             zone->lru_lock (in mark_page_accessed, isolate_lru_page)
  *             swap_lock (in swap_duplicate, swap_info_get)
@@ -67,7 +67,14 @@ static struct kmem_cache *anon_vma_chain_cachep;
 
 static inline struct anon_vma *anon_vma_alloc(void)
 {
-	return kmem_cache_alloc(anon_vma_cachep, GFP_KERNEL);
+	struct anon_vma *anon_vma;
+
+	anon_vma = kmem_cache_alloc(anon_vma_cachep, GFP_KERNEL);
+	if (anon_vma) {
+		anon_vma->degree = 1;	/* Reference for first vma */
+		anon_vma->parent = anon_vma;
+	}
+	return anon_vma;
 }
 
 void anon_vma_free(struct anon_vma *anon_vma)
@@ -149,6 +156,8 @@ int anon_vma_prepare(struct vm_area_struct *vma)
 			avc->vma = vma;
 			list_add(&avc->same_vma, &vma->anon_vma_chain);
 			list_add_tail(&avc->same_anon_vma, &anon_vma->head);
+			/* vma reference or self-parent link for new root */
+			anon_vma->degree++;
 			allocated = NULL;
 			avc = NULL;
 		}
@@ -188,20 +197,59 @@ static void anon_vma_chain_link(struct vm_area_struct *vma,
 /*
  * Attach the anon_vmas from src to dst.
  * Returns 0 on success, -ENOMEM on failure.
+ *
+ * If dst->anon_vma is NULL this function tries to find and reuse an
+ * existing anon_vma which has no vmas and only one child anon_vma.
+ * This prevents degradation of the anon_vma hierarchy to an endless
+ * linear chain in the case of a constantly forking task.  On the other
+ * hand, an anon_vma with more than one child isn't reused even if there
+ * was no live vma, thus the rmap walker has a good chance of avoiding
+ * scanning the whole hierarchy when it searches where a page is mapped.
  */
 int anon_vma_clone(struct vm_area_struct *dst, struct vm_area_struct *src)
 {
 	struct anon_vma_chain *avc, *pavc;
 
 	list_for_each_entry_reverse(pavc, &src->anon_vma_chain, same_vma) {
+		struct anon_vma *anon_vma = pavc->anon_vma;
+
 		avc = anon_vma_chain_alloc();
 		if (!avc)
 			goto enomem_failure;
-		anon_vma_chain_link(dst, avc, pavc->anon_vma);
+		anon_vma_chain_link(dst, avc, anon_vma);
+
+		/*
+		 * Reuse existing anon_vma if its degree is lower than two,
+		 * that means it has no vma and only one anon_vma child.
+		 *
+		 * Do not choose the parent anon_vma, otherwise the first
+		 * child would always reuse it.  The root anon_vma is never
+		 * reused: it has a self-parent reference and at least one
+		 * child.
+		 */
+		if (!dst->anon_vma && anon_vma != src->anon_vma &&
+		    anon_vma->degree < 2)
+			dst->anon_vma = anon_vma;
+	}
+	/*
+	 * Account dst only once the clone can no longer fail.  A racing
+	 * clone may pick the same anon_vma; that only makes the degree
+	 * heuristic more conservative.
+	 */
+	if (dst->anon_vma) {
+		anon_vma_lock(dst->anon_vma);
+		dst->anon_vma->degree++;
+		anon_vma_unlock(dst->anon_vma);
 	}
 	return 0;
 
  enomem_failure:
+	/*
+	 * dst->anon_vma is dropped here, otherwise its degree would be
+	 * decremented in unlink_anon_vmas() without having been raised.
+	 * Callers don't care about dst->anon_vma if anon_vma_clone() failed.
+	 */
+	dst->anon_vma = NULL;
 	unlink_anon_vmas(dst);
 	return -ENOMEM;
 }
@@ -220,6 +268,9 @@ int anon_vma_fork(struct vm_area_struct *vma, struct vm_area_struct *pvma)
 	if (!pvma->anon_vma)
 		return 0;
 
+	/* Drop inherited anon_vma, we'll reuse an existing one or allocate. */
+	vma->anon_vma = NULL;
+
 	/*
 	 * First, attach the new VMA to the parent VMA's anon_vmas,
 	 * so rmap can find non-COWed pages in child processes.
@@ -227,6 +278,10 @@ int anon_vma_fork(struct vm_area_struct *vma, struct vm_area_struct *pvma)
 	if (anon_vma_clone(vma, pvma))
 		return -ENOMEM;
 
+	/* An existing anon_vma has been reused, all done then. */
+	if (vma->anon_vma)
+		return 0;
+
 	/* Then add our own anon_vma. */
 	anon_vma = anon_vma_alloc();
 	if (!anon_vma)
@@ -240,6 +295,7 @@ int anon_vma_fork(struct vm_area_struct *vma, struct vm_area_struct *pvma)
 	 * lock any of the anon_vmas in this anon_vma tree.
 	 */
 	anon_vma->root = pvma->anon_vma->root;
+	anon_vma->parent = pvma->anon_vma;
 	/*
 	 * With KSM refcounts, an anon_vma can stay around longer than the
 	 * process it belongs to.  The root anon_vma needs to be pinned
@@ -249,6 +305,9 @@ int anon_vma_fork(struct vm_area_struct *vma, struct vm_area_struct *pvma)
 	/* Mark this anon_vma as the one where our new (COWed) pages go. */
 	vma->anon_vma = anon_vma;
 	anon_vma_chain_link(vma, avc, anon_vma);
+	anon_vma_lock(anon_vma);
+	anon_vma->parent->degree++;
+	anon_vma_unlock(anon_vma);
 
 	return 0;
 
@@ -271,6 +330,14 @@ static void anon_vma_unlink(struct anon_vma_chain *anon_vma_chain)
 	anon_vma_lock(anon_vma);
 	list_del(&anon_vma_chain->same_anon_vma);
 
+	/*
+	 * An anon_vma without vmas no longer counts as a child of its
+	 * parent.  The parent is still alive: it is further down the
+	 * same vma's anon_vma_chain, which is unlinked newest first.
+	 */
+	if (list_empty(&anon_vma->head))
+		anon_vma->parent->degree--;
+
 	/* We must garbage collect the anon_vma if it's empty */
 	empty = list_empty(&anon_vma->head) && !anonvma_external_refcount(anon_vma);
 	anon_vma_unlock(anon_vma);
@@ -287,6 +354,13 @@ void unlink_anon_vmas(struct vm_area_struct *vma)
 {
 	struct anon_vma_chain *avc, *next;
 
+	/* Drop the vma's reference before its anon_vma can go away below. */
+	if (vma->anon_vma) {
+		anon_vma_lock(vma->anon_vma);
+		vma->anon_vma->degree--;
+		anon_vma_unlock(vma->anon_vma);
+	}
+
 	/*
 	 * Unlink each anon_vma chained to the VMA.  This list is ordered
 	 * from newest to oldest, ensuring the root anon_vma gets freed last.
@@ -302,7 +376,7 @@ static void anon_vma_ctor(void *data)
 {
 	struct anon_vma *anon_vma = data;
 
-	spin_lock_init(&anon_vma->lock);
+	rwlock_init(&anon_vma->lock);
 	anonvma_external_refcount_init(anon_vma);
 	INIT_LIST_HEAD(&anon_vma->head);
 }
@@ -318,7 +392,7 @@ void __init anon_vma_init(void)
  * Getting a lock on a stable anon_vma from a page off the LRU is
  * tricky: page_lock_anon_vma rely on RCU to guard against the races.
  */
-struct anon_vma *__page_lock_anon_vma(struct page *page)
+struct anon_vma *__page_lock_anon_vma(struct page *page, int read)
 {
 	struct anon_vma *anon_vma, *root_anon_vma;
 	unsigned long anon_mapping;
@@ -332,20 +406,26 @@ struct anon_vma *__page_lock_anon_vma(struct page *page)
 
 	anon_vma = (struct anon_vma *) (anon_mapping - PAGE_MAPPING_ANON);
 	root_anon_vma = ACCESS_ONCE(anon_vma->root);
-	spin_lock(&root_anon_vma->lock);
+	if (read)
+		read_lock(&root_anon_vma->lock);
+	else
+		write_lock(&root_anon_vma->lock);
 
 	/*
 	 * If this page is still mapped, then its anon_vma cannot have been
 	 * freed.  But if it has been unmapped, we have no security against
 	 * the anon_vma structure being freed and reused (for another anon_vma:
-	 * SLAB_DESTROY_BY_RCU guarantees that - so the spin_lock above cannot
+	 * SLAB_DESTROY_BY_RCU guarantees that - so the lock above cannot
 	 * corrupt): with anon_vma_prepare() or anon_vma_fork() redirecting
 	 * anon_vma->root before page_unlock_anon_vma() is called to unlock.
 	 */
 	if (page_mapped(page))
 		return anon_vma;
 
-	spin_unlock(&root_anon_vma->lock);
+	if (read)
+		read_unlock(&root_anon_vma->lock);
+	else
+		write_unlock(&root_anon_vma->lock);
 out:
 	rcu_read_unlock();
 	return NULL;
@@ -359,6 +439,14 @@ void page_unlock_anon_vma(struct anon_vma *anon_vma)
 	rcu_read_unlock();
 }
 
+void page_unlock_anon_vma_read(struct anon_vma *anon_vma)
+	__releases(&anon_vma->root->lock)
+	__releases(RCU)
+{
+	anon_vma_unlock_read(anon_vma);
+	rcu_read_unlock();
+}
+
 /*
  * At what user virtual address is page expected in @vma?
  * Returns virtual address or -EFAULT if page's index/offset is not
@@ -579,7 +667,7 @@ static int page_referenced_anon(struct page *page,
 	struct anon_vma_chain *avc;
 	int referenced = 0;
 
-	anon_vma = page_lock_anon_vma(page);
+	anon_vma = page_lock_anon_vma_read(page);
 	if (!anon_vma)
 		return referenced;
 
@@ -602,7 +690,7 @@ static int page_referenced_anon(struct page *page,
 			break;
 	}
 
-	page_unlock_anon_vma(anon_vma);
+	page_unlock_anon_vma_read(anon_vma);
 	return referenced;
 }
 
@@ -1284,7 +1372,7 @@ static int try_to_unmap_anon(struct page *page, enum ttu_flags flags)
 	struct anon_vma_chain *avc;
 	int ret = SWAP_AGAIN;
 
-	anon_vma = page_lock_anon_vma(page);
+	anon_vma = page_lock_anon_vma_read(page);
 	if (!anon_vma)
 		return ret;
 
@@ -1312,7 +1400,7 @@ static int try_to_unmap_anon(struct page *page, enum ttu_flags flags)
 			break;
 	}
 
-	page_unlock_anon_vma(anon_vma);
+	page_unlock_anon_vma_read(anon_vma);
 	return ret;
 }
 
@@ -1495,29 +1583,40 @@ int try_to_munlock(struct page *page)
  */
 void drop_anon_vma(struct anon_vma *anon_vma)
 {
+	struct anon_vma *root;
+	int empty;
+	int last_root_user = 0;
+	int root_empty = 0;
+
 	BUG_ON(atomic_read(&anon_vma->external_refcount) <= 0);
-	if (atomic_dec_and_lock(&anon_vma->external_refcount, &anon_vma->root->lock)) {
-		struct anon_vma *root = anon_vma->root;
-		int empty = list_empty(&anon_vma->head);
-		int last_root_user = 0;
-		int root_empty = 0;
 
-		/*
-		 * The refcount on a non-root anon_vma got dropped.  Drop
-		 * the refcount on the root and check if we need to free it.
-		 */
-		if (empty && anon_vma != root) {
-			BUG_ON(atomic_read(&root->external_refcount) <= 0);
-			last_root_user = atomic_dec_and_test(&root->external_refcount);
-			root_empty = list_empty(&root->head);
-		}
+	/* atomic_dec_and_lock(), open coded for the root's rwlock */
+	if (atomic_add_unless(&anon_vma->external_refcount, -1, 1))
+		return;
+	anon_vma_lock(anon_vma);
+	if (!atomic_dec_and_test(&anon_vma->external_refcount)) {
 		anon_vma_unlock(anon_vma);
+		return;
+	}
 
-		if (empty) {
-			anon_vma_free(anon_vma);
-			if (root_empty && last_root_user)
-				anon_vma_free(root);
-		}
+	root = anon_vma->root;
+	empty = list_empty(&anon_vma->head);
+
+	/*
+	 * The refcount on a non-root anon_vma got dropped.  Drop
+	 * the refcount on the root and check if we need to free it.
+	 */
+	if (empty && anon_vma != root) {
+		BUG_ON(atomic_read(&root->external_refcount) <= 0);
+		last_root_user = atomic_dec_and_test(&root->external_refcount);
+		root_empty = list_empty(&root->head);
+	}
+	anon_vma_unlock(anon_vma);
+
+	if (empty) {
+		anon_vma_free(anon_vma);
+		if (root_empty && last_root_user)
+			anon_vma_free(root);
 	}
 }
 #endif
@@ -1543,7 +1642,7 @@ static int rmap_walk_anon(struct page *page, int (*rmap_one)(struct page *,
 	anon_vma = page_anon_vma(page);
 	if (!anon_vma)
 		return ret;
-	anon_vma_lock(anon_vma);
+	anon_vma_lock_read(anon_vma);
 	list_for_each_entry(avc, &anon_vma->head, same_anon_vma) {
 		struct vm_area_struct *vma = avc->vma;
 		unsigned long address = vma_address(page, vma);
@@ -1553,7 +1652,7 @@ static int rmap_walk_anon(struct page *page, int (*rmap_one)(struct page *,
 		if (ret != SWAP_AGAIN)
 			break;
 	}
-	anon_vma_unlock(anon_vma);
+	anon_vma_unlock_read(anon_vma);
 	return ret;
 }
 
@@ -122,6 +122,44 @@ static unsigned long shmem_default_max_inodes(void)
 static int shmem_getpage(struct inode *inode, unsigned long idx,
 			 struct page **pagep, enum sgp_type sgp, int *type);
 
+/*
+ * Values for sbinfo->huge, the huge= mount option, and for shmem_huge,
+ * which stands in for it on the internal mount behind SysV SHM and
+ * MAP_SHARED|MAP_ANONYMOUS.
+ */
+#define SHMEM_HUGE_NEVER	0
+#define SHMEM_HUGE_ALWAYS	1
+#define SHMEM_HUGE_WITHIN_SIZE	2
+
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+static int shmem_huge __read_mostly;
+
+#if defined(CONFIG_SYSFS) || defined(CONFIG_TMPFS)
+static int shmem_parse_huge(const char *str)
+{
+	if (!strcmp(str, "never"))
+		return SHMEM_HUGE_NEVER;
+	if (!strcmp(str, "always"))
+		return SHMEM_HUGE_ALWAYS;
+	if (!strcmp(str, "within_size"))
+		return SHMEM_HUGE_WITHIN_SIZE;
+	return -EINVAL;
+}
+
+static const char *shmem_format_huge(int huge)
+{
+	switch (huge) {
+	case SHMEM_HUGE_ALWAYS:
+		return "always";
+	case SHMEM_HUGE_WITHIN_SIZE:
+		return "within_size";
+	default:
+		return "never";
+	}
+}
+#endif
+#endif /* CONFIG_TRANSPARENT_HUGEPAGE */
+
 static inline struct page *shmem_dir_alloc(gfp_t gfp_mask)
 {
 	/*
@@ -1291,7 +1329,7 @@ repeat:
 
 	if (swap.val) {
 		/* Look it up and read it in.. */
-		swappage = lookup_swap_cache(swap);
+		swappage = lookup_swap_cache(swap, NULL, 0);
 		if (!swappage) {
 			shmem_swp_unmap(entry);
 			/* here we actually do the io */
@@ -1586,6 +1624,124 @@ out_nomem:
 	return retval;
 }
 
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+/*
+ * Place a mapping of a huge-enabled file so that file offsets and user
+ * addresses agree modulo HPAGE_PMD_SIZE.  Every process mapping the
+ * file then sees its PMD-sized extents at PMD-aligned addresses, which
+ * is what a PMD-level mapping of shmem pages needs; but the page cache
+ * still holds only order-0 pages here, so today the mapping is filled
+ * in with ordinary ptes.
+ */
+static unsigned long shmem_get_unmapped_area(struct file *file,
+					     unsigned long uaddr,
+					     unsigned long len,
+					     unsigned long pgoff,
+					     unsigned long flags)
+{
+	unsigned long (*get_area)(struct file *, unsigned long,
+				  unsigned long, unsigned long, unsigned long);
+	struct inode *inode = file->f_path.dentry->d_inode;
+	struct super_block *sb = inode->i_sb;
+	unsigned long addr, offset, inflated_len;
+	unsigned long inflated_addr, inflated_offset;
+	int huge;
+
+	if (len > TASK_SIZE)
+		return -ENOMEM;
+
+	get_area = current->mm->get_unmapped_area;
+	addr = get_area(file, uaddr, len, pgoff, flags);
+
+	if (IS_ERR_VALUE(addr) || (addr & ~PAGE_MASK))
+		return addr;
+	if (addr > TASK_SIZE - len || len < HPAGE_PMD_SIZE)
+		return addr;
+	/* The caller asked for this address and got it */
+	if ((flags & MAP_FIXED) || (uaddr && uaddr == addr))
+		return addr;
+
+	huge = (sb->s_flags & MS_NOUSER) ? shmem_huge : SHMEM_SB(sb)->huge;
+	if (huge == SHMEM_HUGE_NEVER)
+		return addr;
+	if (huge == SHMEM_HUGE_WITHIN_SIZE &&
+	    ((loff_t)pgoff << PAGE_SHIFT) + HPAGE_PMD_SIZE > i_size_read(inode))
+		return addr;
+
+	offset = (pgoff << PAGE_SHIFT) & (HPAGE_PMD_SIZE - 1);
+	if ((addr & (HPAGE_PMD_SIZE - 1)) == offset)
+		goto aligned;
+
+	inflated_len = len + HPAGE_PMD_SIZE - PAGE_SIZE;
+	if (inflated_len > TASK_SIZE || inflated_len < len)
+		goto failed;
+
+	inflated_addr = get_area(NULL, 0, inflated_len, 0, flags);
+	if (IS_ERR_VALUE(inflated_addr) || (inflated_addr & ~PAGE_MASK))
+		goto failed;
+
+	inflated_offset = inflated_addr & (HPAGE_PMD_SIZE - 1);
+	inflated_addr += offset - inflated_offset;
+	if (inflated_offset > offset)
+		inflated_addr += HPAGE_PMD_SIZE;
+	if (inflated_addr > TASK_SIZE - len)
+		goto failed;
+
+	/* mmap_sem is held for write, so the area is still free */
+	addr = inflated_addr;
+aligned:
+	count_vm_event(SHMEM_HUGE_ALIGNED);
+	return addr;
+failed:
+	count_vm_event(SHMEM_HUGE_ALIGN_FAILED);
+	return addr;
+}
+
+#ifdef CONFIG_SYSFS
+static ssize_t shmem_enabled_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	static const int values[] = {
+		SHMEM_HUGE_ALWAYS,
+		SHMEM_HUGE_WITHIN_SIZE,
+		SHMEM_HUGE_NEVER,
+	};
+	int i, count = 0;
+
+	for (i = 0; i < ARRAY_SIZE(values); i++)
+		count += sprintf(buf + count,
+				 shmem_huge == values[i] ? "[%s] " : "%s ",
+				 shmem_format_huge(values[i]));
+	buf[count - 1] = '\n';
+	return count;
+}
+
+static ssize_t shmem_enabled_store(struct kobject *kobj,
+				   struct kobj_attribute *attr,
+				   const char *buf, size_t count)
+{
+	char tmp[16];
+	int huge;
+
+	if (count + 1 > sizeof(tmp))
+		return -EINVAL;
+	memcpy(tmp, buf, count);
+	tmp[count] = '\0';
+	if (count && tmp[count - 1] == '\n')
+		tmp[count - 1] = '\0';
+
+	huge = shmem_parse_huge(tmp);
+	if (huge < 0)
+		return huge;
+	shmem_huge = huge;
+	return count;
+}
+
+struct kobj_attribute shmem_enabled_attr =
+	__ATTR(shmem_enabled, 0644, shmem_enabled_show, shmem_enabled_store);
+#endif /* CONFIG_SYSFS */
+#endif /* CONFIG_TRANSPARENT_HUGEPAGE */
+
 static int shmem_mmap(struct file *file, struct vm_area_struct *vma)
 {
 	file_accessed(file);
@@ -2270,6 +2426,14 @@ static int shmem_parse_options(char *options, struct shmem_sb_info *sbinfo,
 		} else if (!strcmp(this_char,"mpol")) {
 			if (mpol_parse_str(value, &sbinfo->mpol, 1))
 				goto bad_val;
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+		} else if (!strcmp(this_char,"huge")) {
+			int huge = shmem_parse_huge(value);
+
+			if (huge < 0)
+				goto bad_val;
+			sbinfo->huge = huge;
+#endif
 		} else {
 			printk(KERN_ERR "tmpfs: Bad mount option %s\n",
 			       this_char);
@@ -2316,6 +2480,7 @@ static int shmem_remount_fs(struct super_block *sb, int *flags, char *data)
 	sbinfo->max_blocks  = config.max_blocks;
 	sbinfo->max_inodes  = config.max_inodes;
 	sbinfo->free_inodes = config.max_inodes - inodes;
+	sbinfo->huge = config.huge;
 
 	mpol_put(sbinfo->mpol);
 	sbinfo->mpol        = config.mpol;	/* transfers initial ref */
@@ -2339,6 +2504,10 @@ static int shmem_show_options(struct seq_file *seq, struct vfsmount *vfs)
 		seq_printf(seq, ",uid=%u", sbinfo->uid);
 	if (sbinfo->gid != 0)
 		seq_printf(seq, ",gid=%u", sbinfo->gid);
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+	if (sbinfo->huge)
+		seq_printf(seq, ",huge=%s", shmem_format_huge(sbinfo->huge));
+#endif
 	shmem_show_mpol(seq, sbinfo->mpol);
 	return 0;
 }
@@ -2485,6 +2654,9 @@ static const struct address_space_operations shmem_aops = {
 
 static const struct file_operations shmem_file_operations = {
 	.mmap		= shmem_mmap,
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+	.get_unmapped_area = shmem_get_unmapped_area,
+#endif
 #ifdef CONFIG_TMPFS
 	.llseek		= generic_file_llseek,
 	.read		= do_sync_read,
@@ -1297,18 +1297,35 @@ static __always_inline int slab_trylock(struct page *page)
 	return rc;
 }
 
+/*
+ * Take the list_lock of a node, counting how often another cpu has it.
+ */
+static inline void lock_node(struct kmem_cache *s, struct kmem_cache_node *n)
+{
+	if (!spin_trylock(&n->list_lock)) {
+		stat(s, LIST_LOCK_CONTENDED);
+		spin_lock(&n->list_lock);
+	}
+}
+
 /*
  * Management of partially allocated slabs
  */
-static void add_partial(struct kmem_cache_node *n,
+static inline void __add_partial(struct kmem_cache_node *n,
 				struct page *page, int tail)
 {
-	spin_lock(&n->list_lock);
 	n->nr_partial++;
 	if (tail)
 		list_add_tail(&page->lru, &n->partial);
 	else
 		list_add(&page->lru, &n->partial);
+}
+
+static void add_partial(struct kmem_cache *s, struct kmem_cache_node *n,
+				struct page *page, int tail)
+{
+	lock_node(s, n);
+	__add_partial(n, page, tail);
 	spin_unlock(&n->list_lock);
 }
 
@@ -1323,7 +1340,7 @@ static void remove_partial(struct kmem_cache *s, struct page *page)
 {
 	struct kmem_cache_node *n = get_node(s, page_to_nid(page));
 
-	spin_lock(&n->list_lock);
+	lock_node(s, n);
 	__remove_partial(n, page);
 	spin_unlock(&n->list_lock);
 }
@@ -1347,7 +1364,8 @@ static inline int lock_and_freeze_slab(struct kmem_cache_node *n,
 /*
  * Try to allocate a partial slab from a specific node.
  */
-static struct page *get_partial_node(struct kmem_cache_node *n)
+static struct page *get_partial_node(struct kmem_cache *s,
+					struct kmem_cache_node *n)
 {
 	struct page *page;
 
@@ -1360,7 +1378,7 @@ static struct page *get_partial_node(struct kmem_cache_node *n)
 	if (!n || !n->nr_partial)
 		return NULL;
 
-	spin_lock(&n->list_lock);
+	lock_node(s, n);
 	list_for_each_entry(page, &n->partial, lru)
 		if (lock_and_freeze_slab(n, page))
 			goto out;
@@ -1413,7 +1431,7 @@ static struct page *get_any_partial(struct kmem_cache *s, gfp_t flags)
 
 		if (n && cpuset_zone_allowed_hardwall(zone, flags) &&
 				n->nr_partial > s->min_partial) {
-			page = get_partial_node(n);
+			page = get_partial_node(s, n);
 			if (page) {
 				put_mems_allowed();
 				return page;
@@ -1433,7 +1451,7 @@ static struct page *get_partial(struct kmem_cache *s, gfp_t flags, int node)
 	struct page *page;
 	int searchnode = (node == NUMA_NO_NODE) ? numa_node_id() : node;
 
-	page = get_partial_node(get_node(s, searchnode));
+	page = get_partial_node(s, get_node(s, searchnode));
 	if (page || node != -1)
 		return page;
 
@@ -1456,7 +1474,7 @@ static void unfreeze_slab(struct kmem_cache *s, struct page *page, int tail)
 	if (page->inuse) {
 
 		if (page->freelist) {
-			add_partial(n, page, tail);
+			add_partial(s, n, page, tail);
 			stat(s, tail ? DEACTIVATE_TO_TAIL : DEACTIVATE_TO_HEAD);
 		} else {
 			stat(s, DEACTIVATE_FULL);
@@ -1477,7 +1495,7 @@ static void unfreeze_slab(struct kmem_cache *s, struct page *page, int tail)
 			 * kmem_cache_shrink can reclaim any empty slabs from
 			 * the partial list.
 			 */
-			add_partial(n, page, 1);
+			add_partial(s, n, page, 1);
 			slab_unlock(page);
 		} else {
 			slab_unlock(page);
@@ -1528,6 +1546,71 @@ static inline void flush_slab(struct kmem_cache *s, struct kmem_cache_cpu *c)
 	deactivate_slab(s, c);
 }
 
+/*
+ * Per cpu partial lists
+ *
+ * A slab that gets its first free object back is normally added to the
+ * partial list of its node, and the next cpu slab is taken from there,
+ * both under the node list_lock. With a per cpu partial list that slab
+ * instead stays frozen and goes onto a short list of the freeing cpu,
+ * from which that cpu refills its cpu slab without touching list_lock.
+ * Remote frees into those slabs are handled as for any frozen slab.
+ *
+ * Must be called with interrupts disabled.
+ */
+static void unfreeze_cpu_partial(struct kmem_cache *s,
+				 struct kmem_cache_cpu *c)
+{
+	struct page *page, *next;
+
+	if (!c->nr_partial)
+		return;
+
+	stat(s, CPU_PARTIAL_DRAIN);
+	list_for_each_entry_safe(page, next, &c->partial, lru) {
+		list_del(&page->lru);
+		slab_lock(page);
+		unfreeze_slab(s, page, 1);
+	}
+	c->nr_partial = 0;
+}
+
+/*
+ * Add an already frozen slab to the partial list of this cpu, moving
+ * the old contents to the node lists in one go if the list is full.
+ */
+static void put_cpu_partial(struct kmem_cache *s, struct page *page)
+{
+	struct kmem_cache_cpu *c = __this_cpu_ptr(s->cpu_slab);
+
+	if (c->nr_partial >= s->cpu_partial)
+		unfreeze_cpu_partial(s, c);
+	list_add(&page->lru, &c->partial);
+	c->nr_partial++;
+	stat(s, CPU_PARTIAL_FREE);
+}
+
+/*
+ * Take a slab from the cpu partial list and lock it, as long as it is
+ * on the node we want.
+ */
+static struct page *get_cpu_partial(struct kmem_cache_cpu *c, int node)
+{
+	struct page *page;
+
+	if (!c->nr_partial)
+		return NULL;
+
+	page = list_first_entry(&c->partial, struct page, lru);
+	if (node != NUMA_NO_NODE && page_to_nid(page) != node)
+		return NULL;
+
+	list_del(&page->lru);
+	c->nr_partial--;
+	slab_lock(page);
+	return page;
+}
+
 /*
  * Flush cpu slab.
  *
@@ -1537,8 +1620,11 @@ static inline void __flush_cpu_slab(struct kmem_cache *s, int cpu)
 {
 	struct kmem_cache_cpu *c = per_cpu_ptr(s->cpu_slab, cpu);
 
-	if (likely(c && c->page))
+	if (unlikely(!c))
+		return;
+	if (c->page)
 		flush_slab(s, c);
+	unfreeze_cpu_partial(s, c);
 }
 
 static void flush_cpu_slab(void *d)
@@ -1685,6 +1771,13 @@ another_slab:
 	deactivate_slab(s, c);
 
 new_slab:
+	new = get_cpu_partial(c, node);
+	if (new) {
+		c->page = new;
+		stat(s, CPU_PARTIAL_ALLOC);
+		goto load_freelist;
+	}
+
 	new = get_partial(s, gfpflags, node);
 	if (new) {
 		c->page = new;
@@ -1859,7 +1952,13 @@ checks_ok:
 	 * then add it.
 	 */
 	if (unlikely(!prior)) {
-		add_partial(get_node(s, page_to_nid(page)), page, 1);
+		if (s->cpu_partial && !kmem_cache_debug(s)) {
+			__SetPageSlubFrozen(page);
+			slab_unlock(page);
+			put_cpu_partial(s, page);
+			return;
+		}
+		add_partial(s, get_node(s, page_to_nid(page)), page, 1);
 		stat(s, FREE_ADD_PARTIAL);
 	}
 
@@ -1933,6 +2032,88 @@ void kmem_cache_free(struct kmem_cache *s, void *x)
 }
 EXPORT_SYMBOL(kmem_cache_free);
 
+/*
+ * Bulk allocation and freeing. Interrupts are disabled once for the
+ * whole array instead of per object. Allocation either fills all of
+ * the array and returns its size, or frees what it got and returns 0.
+ */
+int kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t flags, size_t size,
+			  void **p)
+{
+	struct kmem_cache_cpu *c;
+	unsigned long irqflags;
+	size_t i, j;
+
+	if (slab_pre_alloc_hook(s, flags))
+		return 0;
+
+	local_irq_save(irqflags);
+	c = __this_cpu_ptr(s->cpu_slab);
+	for (i = 0; i < size; i++) {
+		void **object = c->freelist;
+
+		if (unlikely(!object)) {
+			object = __slab_alloc(s, flags, NUMA_NO_NODE,
+					      _RET_IP_, c);
+			if (unlikely(!object))
+				break;
+			/* The slowpath may have enabled interrupts */
+			c = __this_cpu_ptr(s->cpu_slab);
+		} else {
+			c->freelist = get_freepointer(s, object);
+			stat(s, ALLOC_FASTPATH);
+		}
+		p[i] = object;
+	}
+	local_irq_restore(irqflags);
+
+	for (j = 0; j < i; j++) {
+		if (unlikely(flags & __GFP_ZERO))
+			memset(p[j], 0, s->objsize);
+		slab_post_alloc_hook(s, flags, p[j]);
+		trace_kmem_cache_alloc(_RET_IP_, p[j], s->objsize, s->size,
+				       flags);
+	}
+
+	if (unlikely(i < size)) {
+		kmem_cache_free_bulk(s, i, p);
+		return 0;
+	}
+	return size;
+}
+EXPORT_SYMBOL(kmem_cache_alloc_bulk);
+
+void kmem_cache_free_bulk(struct kmem_cache *s, size_t size, void **p)
+{
+	struct kmem_cache_cpu *c;
+	unsigned long flags;
+	size_t i;
+
+	for (i = 0; i < size; i++)
+		slab_free_hook(s, p[i]);
+
+	local_irq_save(flags);
+	c = __this_cpu_ptr(s->cpu_slab);
+	for (i = 0; i < size; i++) {
+		void **object = p[i];
+		struct page *page = virt_to_head_page(object);
+
+		slab_free_hook_irq(s, object);
+
+		if (likely(page == c->page && c->node != NUMA_NO_NODE)) {
+			set_freepointer(s, object, c->freelist);
+			c->freelist = object;
+			stat(s, FREE_FASTPATH);
+		} else
+			__slab_free(s, page, object, _RET_IP_);
+	}
+	local_irq_restore(flags);
+
+	for (i = 0; i < size; i++)
+		trace_kmem_cache_free(_RET_IP_, p[i]);
+}
+EXPORT_SYMBOL(kmem_cache_free_bulk);
+
 /*
  * Object placement in a slab is made very easy because we always start at
  * offset 0. If we tune the size of the object to the alignment then we can
@@ -2107,12 +2288,18 @@ init_kmem_cache_node(struct kmem_cache_node *n, struct kmem_cache *s)
 
 static inline int alloc_kmem_cache_cpus(struct kmem_cache *s)
 {
+	int cpu;
+
 	BUILD_BUG_ON(PERCPU_DYNAMIC_EARLY_SIZE <
 			SLUB_PAGE_SHIFT * sizeof(struct kmem_cache_cpu));
 
 	s->cpu_slab = alloc_percpu(struct kmem_cache_cpu);
+	if (!s->cpu_slab)
+		return 0;
 
-	return s->cpu_slab != NULL;
+	for_each_possible_cpu(cpu)
+		INIT_LIST_HEAD(&per_cpu_ptr(s->cpu_slab, cpu)->partial);
+	return 1;
 }
 
 static struct kmem_cache *kmem_cache_node;
@@ -2162,7 +2349,9 @@ static void early_kmem_cache_node_alloc(int node)
 	 * the boot sequence, we still disable irqs.
 	 */
 	local_irq_save(flags);
-	add_partial(n, page, 0);
+	spin_lock(&n->list_lock);
+	__add_partial(n, page, 0);
+	spin_unlock(&n->list_lock);
 	local_irq_restore(flags);
 }
 
@@ -2338,6 +2527,25 @@ static int calculate_sizes(struct kmem_cache *s, int forced_order)
 
 }
 
+/*
+ * Fewer slabs are kept on the cpu partial lists of caches with large
+ * objects, as each of those slabs holds more memory. Debugging needs
+ * every free to go through the node lists, so it gets none.
+ */
+static void set_cpu_partial(struct kmem_cache *s)
+{
+	if (kmem_cache_debug(s))
+		s->cpu_partial = 0;
+	else if (s->size >= PAGE_SIZE)
+		s->cpu_partial = 2;
+	else if (s->size >= 1024)
+		s->cpu_partial = 3;
+	else if (s->size >= 256)
+		s->cpu_partial = 4;
+	else
+		s->cpu_partial = 6;
+}
+
 static int kmem_cache_open(struct kmem_cache *s,
 		const char *name, size_t size,
 		size_t align, unsigned long flags,
@@ -2370,6 +2578,7 @@ static int kmem_cache_open(struct kmem_cache *s,
 	 * list to avoid pounding the page allocator excessively.
 	 */
 	set_min_partial(s, ilog2(s->size));
+	set_cpu_partial(s);
 	s->refcount = 1;
 #ifdef CONFIG_NUMA
 	s->remote_node_defrag_ratio = 1000;
@@ -3944,6 +4153,52 @@ static ssize_t min_partial_store(struct kmem_cache *s, const char *buf,
 }
 SLAB_ATTR(min_partial);
 
+static ssize_t cpu_partial_show(struct kmem_cache *s, char *buf)
+{
+	return sprintf(buf, "%d\n", s->cpu_partial);
+}
+
+static ssize_t cpu_partial_store(struct kmem_cache *s, const char *buf,
+				 size_t length)
+{
+	unsigned long slabs;
+	int err;
+
+	err = strict_strtoul(buf, 10, &slabs);
+	if (err)
+		return err;
+	if (slabs > INT_MAX || (slabs && kmem_cache_debug(s)))
+		return -EINVAL;
+
+	s->cpu_partial = slabs;
+	flush_all(s);
+	return length;
+}
+SLAB_ATTR(cpu_partial);
+
+static ssize_t slabs_cpu_partial_show(struct kmem_cache *s, char *buf)
+{
+	unsigned long sum = 0;
+	int cpu;
+	int len;
+
+	for_each_online_cpu(cpu)
+		sum += per_cpu_ptr(s->cpu_slab, cpu)->nr_partial;
+
+	len = sprintf(buf, "%lu", sum);
+
+#ifdef CONFIG_SMP
+	for_each_online_cpu(cpu) {
+		int nr = per_cpu_ptr(s->cpu_slab, cpu)->nr_partial;
+
+		if (nr && len < PAGE_SIZE - 20)
+			len += sprintf(buf + len, " C%d=%d", cpu, nr);
+	}
+#endif
+	return len + sprintf(buf + len, "\n");
+}
+SLAB_ATTR_RO(slabs_cpu_partial);
+
 static ssize_t ctor_show(struct kmem_cache *s, char *buf)
 {
 	if (!s->ctor)
@@ -4284,6 +4539,10 @@ STAT_ATTR(DEACTIVATE_TO_HEAD, deactivate_to_head);
 STAT_ATTR(DEACTIVATE_TO_TAIL, deactivate_to_tail);
 STAT_ATTR(DEACTIVATE_REMOTE_FREES, deactivate_remote_frees);
 STAT_ATTR(ORDER_FALLBACK, order_fallback);
+STAT_ATTR(CPU_PARTIAL_ALLOC, cpu_partial_alloc);
+STAT_ATTR(CPU_PARTIAL_FREE, cpu_partial_free);
+STAT_ATTR(CPU_PARTIAL_DRAIN, cpu_partial_drain);
+STAT_ATTR(LIST_LOCK_CONTENDED, list_lock_contended);
 #endif
 
 static struct attribute *slab_attrs[] = {
@@ -4292,6 +4551,8 @@ static struct attribute *slab_attrs[] = {
 	&objs_per_slab_attr.attr,
 	&order_attr.attr,
 	&min_partial_attr.attr,
+	&cpu_partial_attr.attr,
+	&slabs_cpu_partial_attr.attr,
 	&objects_attr.attr,
 	&objects_partial_attr.attr,
 	&partial_attr.attr,
@@ -4340,6 +4601,10 @@ static struct attribute *slab_attrs[] = {
 	&deactivate_to_tail_attr.attr,
 	&deactivate_remote_frees_attr.attr,
 	&order_fallback_attr.attr,
+	&cpu_partial_alloc_attr.attr,
+	&cpu_partial_free_attr.attr,
+	&cpu_partial_drain_attr.attr,
+	&list_lock_contended_attr.attr,
 #endif
 #ifdef CONFIG_FAILSLAB
 	&failslab_attr.attr,
@@ -0,0 +1,164 @@
+/*
+ *  linux/mm/swap_slots.c
+ *
+ *  Per-cpu caches of free swap slots.
+ *
+ *  Every swap slot allocation used to take swap_lock, which all cpus
+ *  doing swapout then contend on.  Instead each cpu takes a batch of
+ *  slots at a time from get_swap_pages() and hands them out from its
+ *  own cache.  The batch comes from one cluster of one swap area, so
+ *  each cpu's writes also stay sequential on the device.
+ *
+ *  The caches only run while there is plenty of free swap: once free
+ *  swap drops to a few batches per cpu they are drained and allocation
+ *  goes straight to swap_lock again, so that no cpu sits on slots that
+ *  another one could still use.
+ *
+ *  Slots are freed individually as before: swapcache_free() must see
+ *  the count of each entry to uncharge its memory cgroup.
+ */
+
+#include <linux/swap_slots.h>
+#include <linux/cpu.h>
+#include <linux/init.h>
+#include <linux/mutex.h>
+#include <linux/notifier.h>
+#include <linux/percpu.h>
+
+struct swap_slots_cache {
+	struct mutex	alloc_lock;	/* protects the fields below */
+	int		nr;		/* slots left in the cache */
+	int		cur;		/* next slot to hand out */
+	swp_entry_t	slots[SWAP_SLOTS_CACHE_SIZE];
+};
+
+static DEFINE_PER_CPU(struct swap_slots_cache, swp_slots);
+
+/* Protects the two flags below and serializes draining */
+static DEFINE_MUTEX(swap_slots_cache_mutex);
+/* Set up, and not disabled by swapoff */
+static bool swap_slot_cache_enabled;
+/* Enough free swap for caching to be worthwhile */
+static bool swap_slot_cache_active;
+
+/* Free swap, in batches per online cpu, to start and to stop caching */
+#define SLOTS_CACHE_ACTIVATE	5
+#define SLOTS_CACHE_DEACTIVATE	2
+
+static void drain_slots_cache_cpu(unsigned int cpu)
+{
+	struct swap_slots_cache *cache = &per_cpu(swp_slots, cpu);
+
+	mutex_lock(&cache->alloc_lock);
+	while (cache->nr) {
+		swapcache_free(cache->slots[cache->cur], NULL);
+		cache->slots[cache->cur++].val = 0;
+		cache->nr--;
+	}
+	cache->cur = 0;
+	mutex_unlock(&cache->alloc_lock);
+}
+
+static void drain_slots_cache(void)
+{
+	unsigned int cpu;
+
+	get_online_cpus();
+	for_each_online_cpu(cpu)
+		drain_slots_cache_cpu(cpu);
+	put_online_cpus();
+}
+
+static bool check_cache_active(void)
+{
+	long batch = (long)num_online_cpus() * SWAP_SLOTS_CACHE_SIZE;
+	long pages;
+
+	if (!swap_slot_cache_enabled)
+		return false;
+
+	pages = nr_swap_pages;
+	if (!swap_slot_cache_active) {
+		if (pages > batch * SLOTS_CACHE_ACTIVATE)
+			swap_slot_cache_active = true;
+	} else if (pages < batch * SLOTS_CACHE_DEACTIVATE) {
+		mutex_lock(&swap_slots_cache_mutex);
+		if (swap_slot_cache_active) {
+			swap_slot_cache_active = false;
+			drain_slots_cache();
+		}
+		mutex_unlock(&swap_slots_cache_mutex);
+	}
+	return swap_slot_cache_active;
+}
+
+/*
+ * Called by swapoff once the area is no longer writable, so that slots
+ * already cached from it are handed back before try_to_unuse() runs.
+ */
+void disable_swap_slots_cache(void)
+{
+	mutex_lock(&swap_slots_cache_mutex);
+	swap_slot_cache_enabled = false;
+	drain_slots_cache();
+	mutex_unlock(&swap_slots_cache_mutex);
+}
+
+void reenable_swap_slots_cache(void)
+{
+	mutex_lock(&swap_slots_cache_mutex);
+	swap_slot_cache_enabled = true;
+	mutex_unlock(&swap_slots_cache_mutex);
+}
+
+swp_entry_t get_swap_page(void)
+{
+	struct swap_slots_cache *cache;
+	swp_entry_t entry;
+
+	if (check_cache_active()) {
+		/*
+		 * We may migrate to another cpu after picking the cache:
+		 * the mutex keeps its contents consistent regardless.
+		 */
+		cache = &per_cpu(swp_slots, raw_smp_processor_id());
+		mutex_lock(&cache->alloc_lock);
+		if (!cache->nr && swap_slot_cache_active) {
+			cache->cur = 0;
+			cache->nr = get_swap_pages(SWAP_SLOTS_CACHE_SIZE,
+						   cache->slots);
+		}
+		if (cache->nr) {
+			entry = cache->slots[cache->cur];
+			cache->slots[cache->cur++].val = 0;
+			cache->nr--;
+			mutex_unlock(&cache->alloc_lock);
+			return entry;
+		}
+		mutex_unlock(&cache->alloc_lock);
+	}
+
+	if (!get_swap_pages(1, &entry))
+		entry.val = 0;
+	return entry;
+}
+
+static int __cpuinit swap_slots_cpu_callback(struct notifier_block *nfb,
+					     unsigned long action, void *hcpu)
+{
+	if (action == CPU_DEAD || action == CPU_DEAD_FROZEN)
+		drain_slots_cache_cpu((unsigned long)hcpu);
+	return NOTIFY_OK;
+}
+
+static int __init swap_slots_init(void)
+{
+	unsigned int cpu;
+
+	for_each_possible_cpu(cpu)
+		mutex_init(&per_cpu(swp_slots, cpu).alloc_lock);
+	hotcpu_notifier(swap_slots_cpu_callback, 0);
+	swap_slot_cache_enabled = true;
+	return 0;
+}
+subsys_initcall(swap_slots_init);
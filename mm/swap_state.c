@@ -57,6 +57,35 @@ static struct {
 	unsigned long find_total;
 } swap_cache_info;
 
+/*
+ * Swap-in readahead mode: 0 reads the neighbouring slots of the swap
+ * area, 1 the swap entries of the neighbouring virtual addresses.
+ */
+int swap_vma_readahead __read_mostly = 1;
+
+/*
+ * VMA based readahead keeps its state in vma->swap_readahead_info: the
+ * page aligned address of the last fault, with the readahead window in
+ * the upper and the readahead hits since then in the lower half of the
+ * in-page bits.
+ */
+#define SWAP_RA_WIN_SHIFT	(PAGE_SHIFT / 2)
+#define SWAP_RA_HITS_MASK	((1UL << SWAP_RA_WIN_SHIFT) - 1)
+#define SWAP_RA_HITS_MAX	SWAP_RA_HITS_MASK
+#define SWAP_RA_WIN_MASK	(~PAGE_MASK & ~SWAP_RA_HITS_MASK)
+
+#define SWAP_RA_HITS(v)		((v) & SWAP_RA_HITS_MASK)
+#define SWAP_RA_WIN(v)		(((v) & SWAP_RA_WIN_MASK) >> SWAP_RA_WIN_SHIFT)
+#define SWAP_RA_ADDR(v)		((v) & PAGE_MASK)
+
+#define SWAP_RA_VAL(addr, win, hits)				\
+	(((addr) & PAGE_MASK) |					\
+	 (((win) << SWAP_RA_WIN_SHIFT) & SWAP_RA_WIN_MASK) |	\
+	 ((hits) & SWAP_RA_HITS_MASK))
+
+/* Upper bound of the VMA readahead window, in pages */
+#define SWAP_RA_MAX_WIN		16
+
 void show_swap_cache_info(void)
 {
 	printk("%lu pages in swap cache\n", total_swapcache_pages);
@@ -263,15 +292,35 @@ void free_pages_and_swap_cache(struct page **pages, int nr)
  * lock getting page table operations atomic even if we drop the page
  * lock before returning.
  */
-struct page * lookup_swap_cache(swp_entry_t entry)
+struct page * lookup_swap_cache(swp_entry_t entry,
+			struct vm_area_struct *vma, unsigned long addr)
 {
 	struct page *page;
 
 	page = find_get_page(&swapper_space, entry.val);
 
-	if (page)
+	if (page) {
 		INC_CACHE_INFO(find_success);
 
+		/*
+		 * PG_readahead aliases PG_reclaim, which reclaim sets on
+		 * pages under writeback; only trust it otherwise.
+		 */
+		if (!PageWriteback(page) && TestClearPageReadahead(page)) {
+			count_vm_event(SWAP_RA_HIT);
+			if (vma) {
+				unsigned long ra, hits;
+
+				ra = atomic_long_read(&vma->swap_readahead_info);
+				hits = min(SWAP_RA_HITS(ra) + 1,
+					   SWAP_RA_HITS_MAX);
+				atomic_long_set(&vma->swap_readahead_info,
+					SWAP_RA_VAL(SWAP_RA_ADDR(ra),
+						    SWAP_RA_WIN(ra), hits));
+			}
+		}
+	}
+
 	INC_CACHE_INFO(find_total);
 	return page;
 }
@@ -280,14 +329,20 @@ struct page * lookup_swap_cache(swp_entry_t entry)
  * Locate a page of swap in physical memory, reserving swap cache space
  * and reading the disk if it is not already cached.
  * A failure return means that either the page allocation failed or that
- * the swap entry is no longer in use.
+ * the swap entry is no longer in use. *allocated tells whether a read was
+ * started rather than a cached page found.  Readahead gives up on a slot
+ * that is only reserved for the swap cache, since it may sit unused in a
+ * per-cpu slot cache for a long time.
  */
-struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
-			struct vm_area_struct *vma, unsigned long addr)
+static struct page *__read_swap_cache_async(swp_entry_t entry,
+			gfp_t gfp_mask, struct vm_area_struct *vma,
+			unsigned long addr, bool *allocated, bool readahead)
 {
 	struct page *found_page, *new_page = NULL;
 	int err;
 
+	*allocated = false;
+
 	do {
 		/*
 		 * First check the swap cache.  Since this is normally
@@ -320,6 +375,8 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 		err = swapcache_prepare(entry);
 		if (err == -EEXIST) {	/* seems racy */
 			radix_tree_preload_end();
+			if (readahead && !__swap_count(entry))
+				break;
 			continue;
 		}
 		if (err) {		/* swp entry is obsolete ? */
@@ -338,6 +395,7 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 			 */
 			lru_cache_add_anon(new_page);
 			swap_readpage(new_page);
+			*allocated = true;
 			return new_page;
 		}
 		radix_tree_preload_end();
@@ -355,6 +413,37 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 	return found_page;
 }
 
+struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr)
+{
+	bool allocated;
+
+	return __read_swap_cache_async(entry, gfp_mask, vma, addr,
+					&allocated, false);
+}
+
+/*
+ * Start reading a page ahead of its use. Pages that are actually read are
+ * marked, so that lookup_swap_cache() can count the readahead hits.
+ */
+static void swap_readahead_page(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr)
+{
+	struct page *page;
+	bool allocated;
+
+	page = __read_swap_cache_async(entry, gfp_mask, vma, addr,
+				       &allocated, true);
+	if (!page)
+		return;
+
+	if (allocated) {
+		SetPageReadahead(page);
+		count_vm_event(SWAP_RA);
+	}
+	page_cache_release(page);
+}
+
 /**
  * swapin_readahead - swap in pages in hope we need them soon
  * @entry: swap entry of this memory
@@ -378,7 +467,6 @@ struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 			struct vm_area_struct *vma, unsigned long addr)
 {
 	int nr_pages;
-	struct page *page;
 	unsigned long offset;
 	unsigned long end_offset;
 
@@ -391,13 +479,122 @@ struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 	 */
 	nr_pages = valid_swaphandles(entry, &offset);
 	for (end_offset = offset + nr_pages; offset < end_offset; offset++) {
+		if (offset == swp_offset(entry))
+			continue;
 		/* Ok, do the async read-ahead now */
-		page = read_swap_cache_async(swp_entry(swp_type(entry), offset),
-						gfp_mask, vma, addr);
-		if (!page)
-			break;
-		page_cache_release(page);
+		swap_readahead_page(swp_entry(swp_type(entry), offset),
+					gfp_mask, vma, addr);
+	}
+	lru_add_drain();	/* Push any new pages onto the LRU now */
+	return read_swap_cache_async(entry, gfp_mask, vma, addr);
+}
+
+/*
+ * Size the readahead window like file readahead does: by the number of
+ * readahead pages used since the last fault in this vma, with faults on
+ * consecutive pages as a cue when there were none. Records faddr as the
+ * last fault and returns the previous one in *prev.
+ */
+static unsigned int swap_ra_window(struct vm_area_struct *vma,
+			unsigned long faddr, unsigned long *prev)
+{
+	unsigned long ra = atomic_long_read(&vma->swap_readahead_info);
+	unsigned int hits, prev_win, win, max_win;
+
+	max_win = page_cluster < ilog2(SWAP_RA_MAX_WIN) ?
+			1 << page_cluster : SWAP_RA_MAX_WIN;
+	hits = SWAP_RA_HITS(ra);
+	prev_win = SWAP_RA_WIN(ra);
+	*prev = SWAP_RA_ADDR(ra);
+
+	win = hits + 2;
+	if (win == 2) {
+		if (faddr != *prev + PAGE_SIZE && faddr + PAGE_SIZE != *prev)
+			win = 1;
+	} else {
+		win = max_t(unsigned int, roundup_pow_of_two(win), 4);
+	}
+
+	/* Don't shrink the window too fast */
+	win = max(win, prev_win / 2);
+	win = min(win, max_win);
+
+	atomic_long_set(&vma->swap_readahead_info, SWAP_RA_VAL(faddr, win, 0));
+	return win;
+}
+
+/**
+ * swapin_readahead_vma - swap in pages of neighbouring addresses
+ * @entry: swap entry of this memory
+ * @gfp_mask: memory allocation flags
+ * @vma: user vma this address belongs to
+ * @addr: faulting address
+ * @pmd: pmd covering @addr
+ *
+ * Returns the struct page for entry and addr, after queueing swapin.
+ *
+ * Where the swap area is fragmented, neighbouring slots rarely belong
+ * together, but neighbouring addresses of a process usually do. So read
+ * the swap entries of the ptes around @addr, placing the window ahead of
+ * or behind @addr when faults move in one direction.
+ *
+ * Falls back to swapin_readahead() unless vm.swap_vma_readahead is set.
+ *
+ * Caller must hold down_read on the vma->vm_mm.
+ */
+struct page *swapin_readahead_vma(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr,
+			pmd_t *pmd)
+{
+	pte_t ptes[SWAP_RA_MAX_WIN], *pte;
+	unsigned long faddr = addr & PAGE_MASK;
+	unsigned long prev, lo, hi, start, end, left;
+	unsigned int win, i;
+
+	if (!swap_vma_readahead)
+		return swapin_readahead(entry, gfp_mask, vma, addr);
+
+	win = swap_ra_window(vma, faddr, &prev);
+	if (win == 1)
+		goto skip;
+
+	/* Stay within the vma and the page table that maps faddr */
+	lo = max(vma->vm_start, faddr & PMD_MASK);
+	hi = (faddr & PMD_MASK) + PMD_SIZE;
+	if (hi - 1 >= vma->vm_end - 1)
+		hi = vma->vm_end;
+
+	if (faddr == prev + PAGE_SIZE)
+		left = 0;
+	else if (faddr + PAGE_SIZE == prev)
+		left = win - 1;
+	else
+		left = (win - 1) / 2;
+
+	start = faddr - min(left, (faddr - lo) >> PAGE_SHIFT) * PAGE_SIZE;
+	end = min(hi, start + win * PAGE_SIZE);
+
+	/*
+	 * A racy snapshot will do: read_swap_cache_async() copes with
+	 * entries that were freed meanwhile.
+	 */
+	pte = pte_offset_map(pmd, start);
+	for (i = 0; start + i * PAGE_SIZE < end; i++)
+		ptes[i] = pte[i];
+	pte_unmap(pte);
+
+	for (i = 0; start + i * PAGE_SIZE < end; i++) {
+		unsigned long a = start + i * PAGE_SIZE;
+		swp_entry_t e;
+
+		if (a == faddr || !is_swap_pte(ptes[i]))
+			continue;
+		e = pte_to_swp_entry(ptes[i]);
+		if (unlikely(non_swap_entry(e)))
+			continue;
+		swap_readahead_page(e, gfp_mask, vma, a);
 	}
 	lru_add_drain();	/* Push any new pages onto the LRU now */
+skip:
 	return read_swap_cache_async(entry, gfp_mask, vma, addr);
 }
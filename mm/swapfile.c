@@ -35,6 +35,7 @@
 #include <asm/pgtable.h>
 #include <asm/tlbflush.h>
 #include <linux/swapops.h>
+#include <linux/swap_slots.h>
 #include <linux/page_cgroup.h>
 
 static bool swap_count_continued(struct swap_info_struct *, pgoff_t,
@@ -203,14 +204,140 @@ static void discard_swap_cluster(struct swap_info_struct *si,
 	}
 }
 
-static int wait_for_discard(void *word)
+#define SWAPFILE_CLUSTER	256
+#define LATENCY_LIMIT		256
+
+/*
+ * Freed clusters are not discarded straight away: they are marked in
+ * discard_pending and the worker runs a little later, so that clusters
+ * freed together go down to the device as a few large requests rather
+ * than many small ones, and never from the allocation path.
+ */
+#define SWAP_DISCARD_DELAY	(HZ / 10)
+
+static inline unsigned long swap_cluster(unsigned long offset)
+{
+	return offset / SWAPFILE_CLUSTER;
+}
+
+/* Called under swap_lock when a slot of a discardable area is taken... */
+static inline void swap_cluster_alloc(struct swap_info_struct *si,
+				      unsigned long offset)
+{
+	unsigned long idx = swap_cluster(offset);
+
+	if (!si->cluster_count)
+		return;
+	if (!si->cluster_count[idx]++)
+		clear_bit(idx, si->discard_pending);
+}
+
+/* ...and when it is freed again. */
+static inline void swap_cluster_free(struct swap_info_struct *si,
+				     unsigned long offset)
+{
+	unsigned long idx = swap_cluster(offset);
+
+	if (!si->cluster_count)
+		return;
+	VM_BUG_ON(!si->cluster_count[idx]);
+	if (!--si->cluster_count[idx]) {
+		set_bit(idx, si->discard_pending);
+		if (si->flags & SWP_WRITEOK)
+			schedule_delayed_work(&si->discard_work,
+					      SWAP_DISCARD_DELAY);
+	}
+}
+
+static inline int swap_cluster_busy(struct swap_info_struct *si,
+				    unsigned long offset)
+{
+	return si->discard_busy && test_bit(swap_cluster(offset),
+					    si->discard_busy);
+}
+
+/*
+ * Discard runs of free clusters.  While a cluster is being discarded it
+ * is marked busy, and scan_swap_map steps over it, so the discard never
+ * races with a write to the same slots.  A cluster that was reused
+ * before the worker got to it has had its pending bit cleared again.
+ */
+static void swap_discard_work(struct work_struct *work)
 {
-	schedule();
+	struct swap_info_struct *si = container_of(to_delayed_work(work),
+					struct swap_info_struct, discard_work);
+	unsigned long nr = si->nr_clusters;
+	unsigned long start = 0, end, idx;
+	pgoff_t first, last;
+
+	spin_lock(&swap_lock);
+	while ((start = find_next_bit(si->discard_pending, nr, start)) < nr) {
+		end = find_next_zero_bit(si->discard_pending, nr, start);
+		for (idx = start; idx < end; idx++) {
+			clear_bit(idx, si->discard_pending);
+			set_bit(idx, si->discard_busy);
+		}
+		first = start * SWAPFILE_CLUSTER;
+		last = min_t(pgoff_t, end * SWAPFILE_CLUSTER, si->max);
+		spin_unlock(&swap_lock);
+
+		discard_swap_cluster(si, first, last - first);
+		cond_resched();
+
+		spin_lock(&swap_lock);
+		for (idx = start; idx < end; idx++)
+			clear_bit(idx, si->discard_busy);
+		start = end;
+	}
+	spin_unlock(&swap_lock);
+}
+
+/*
+ * Set up cluster accounting for a discardable area, counting the slots
+ * of swap_map which are already taken (the header and bad pages), so
+ * that their clusters are never discarded.
+ */
+static int swap_discard_setup(struct swap_info_struct *si,
+			      unsigned char *swap_map)
+{
+	unsigned long nr = DIV_ROUND_UP(si->max, SWAPFILE_CLUSTER);
+	unsigned long i;
+
+	si->cluster_count = vzalloc(nr * sizeof(*si->cluster_count));
+	si->discard_pending = kzalloc(BITS_TO_LONGS(nr) * sizeof(long),
+				      GFP_KERNEL);
+	si->discard_busy = kzalloc(BITS_TO_LONGS(nr) * sizeof(long),
+				   GFP_KERNEL);
+	if (!si->cluster_count || !si->discard_pending || !si->discard_busy)
+		goto nomem;
+
+	for (i = 0; i < si->max; i++)
+		if (swap_map[i])
+			si->cluster_count[swap_cluster(i)]++;
+	si->nr_clusters = nr;
+	INIT_DELAYED_WORK(&si->discard_work, swap_discard_work);
 	return 0;
+nomem:
+	vfree(si->cluster_count);
+	kfree(si->discard_pending);
+	kfree(si->discard_busy);
+	si->cluster_count = NULL;
+	si->discard_pending = si->discard_busy = NULL;
+	return -ENOMEM;
 }
 
-#define SWAPFILE_CLUSTER	256
-#define LATENCY_LIMIT		256
+static void swap_discard_release(struct swap_info_struct *si)
+{
+	if (!si->cluster_count)
+		return;
+	cancel_delayed_work_sync(&si->discard_work);
+	vfree(si->cluster_count);
+	kfree(si->discard_pending);
+	kfree(si->discard_busy);
+	si->cluster_count = NULL;
+	si->discard_pending = si->discard_busy = NULL;
+	si->nr_clusters = 0;
+}
 
 static inline unsigned long scan_swap_map(struct swap_info_struct *si,
 					  unsigned char usage)
@@ -219,7 +346,6 @@ static inline unsigned long scan_swap_map(struct swap_info_struct *si,
 	unsigned long scan_base;
 	unsigned long last_in_cluster = 0;
 	int latency_ration = LATENCY_LIMIT;
-	int found_free_cluster = 0;
 
 	/*
 	 * We try to cluster swap pages by allocating them sequentially
@@ -240,19 +366,6 @@ static inline unsigned long scan_swap_map(struct swap_info_struct *si,
 			si->cluster_nr = SWAPFILE_CLUSTER - 1;
 			goto checks;
 		}
-		if (si->flags & SWP_DISCARDABLE) {
-			/*
-			 * Start range check on racing allocations, in case
-			 * they overlap the cluster we eventually decide on
-			 * (we scan without swap_lock to allow preemption).
-			 * It's hardly conceivable that cluster_nr could be
-			 * wrapped during our scan, but don't depend on it.
-			 */
-			if (si->lowest_alloc)
-				goto checks;
-			si->lowest_alloc = si->max;
-			si->highest_alloc = 0;
-		}
 		spin_unlock(&swap_lock);
 
 		/*
@@ -276,7 +389,6 @@ static inline unsigned long scan_swap_map(struct swap_info_struct *si,
 				offset -= SWAPFILE_CLUSTER - 1;
 				si->cluster_next = offset;
 				si->cluster_nr = SWAPFILE_CLUSTER - 1;
-				found_free_cluster = 1;
 				goto checks;
 			}
 			if (unlikely(--latency_ration < 0)) {
@@ -297,7 +409,6 @@ static inline unsigned long scan_swap_map(struct swap_info_struct *si,
 				offset -= SWAPFILE_CLUSTER - 1;
 				si->cluster_next = offset;
 				si->cluster_nr = SWAPFILE_CLUSTER - 1;
-				found_free_cluster = 1;
 				goto checks;
 			}
 			if (unlikely(--latency_ration < 0)) {
@@ -309,7 +420,6 @@ static inline unsigned long scan_swap_map(struct swap_info_struct *si,
 		offset = scan_base;
 		spin_lock(&swap_lock);
 		si->cluster_nr = SWAPFILE_CLUSTER - 1;
-		si->lowest_alloc = 0;
 	}
 
 checks:
@@ -335,6 +445,10 @@ checks:
 	if (si->swap_map[offset])
 		goto scan;
 
+	/* its cluster is being discarded: come back to it later */
+	if (swap_cluster_busy(si, offset))
+		goto scan;
+
 	if (offset == si->lowest_bit)
 		si->lowest_bit++;
 	if (offset == si->highest_bit)
@@ -345,62 +459,9 @@ checks:
 		si->highest_bit = 0;
 	}
 	si->swap_map[offset] = usage;
+	swap_cluster_alloc(si, offset);
 	si->cluster_next = offset + 1;
 	si->flags -= SWP_SCANNING;
-
-	if (si->lowest_alloc) {
-		/*
-		 * Only set when SWP_DISCARDABLE, and there's a scan
-		 * for a free cluster in progress or just completed.
-		 */
-		if (found_free_cluster) {
-			/*
-			 * To optimize wear-levelling, discard the
-			 * old data of the cluster, taking care not to
-			 * discard any of its pages that have already
-			 * been allocated by racing tasks (offset has
-			 * already stepped over any at the beginning).
-			 */
-			if (offset < si->highest_alloc &&
-			    si->lowest_alloc <= last_in_cluster)
-				last_in_cluster = si->lowest_alloc - 1;
-			si->flags |= SWP_DISCARDING;
-			spin_unlock(&swap_lock);
-
-			if (offset < last_in_cluster)
-				discard_swap_cluster(si, offset,
-					last_in_cluster - offset + 1);
-
-			spin_lock(&swap_lock);
-			si->lowest_alloc = 0;
-			si->flags &= ~SWP_DISCARDING;
-
-			smp_mb();	/* wake_up_bit advises this */
-			wake_up_bit(&si->flags, ilog2(SWP_DISCARDING));
-
-		} else if (si->flags & SWP_DISCARDING) {
-			/*
-			 * Delay using pages allocated by racing tasks
-			 * until the whole discard has been issued. We
-			 * could defer that delay until swap_writepage,
-			 * but it's easier to keep this self-contained.
-			 */
-			spin_unlock(&swap_lock);
-			wait_on_bit(&si->flags, ilog2(SWP_DISCARDING),
-				wait_for_discard, TASK_UNINTERRUPTIBLE);
-			spin_lock(&swap_lock);
-		} else {
-			/*
-			 * Note pages allocated by racing tasks while
-			 * scan for a free cluster is in progress, so
-			 * that its final discard can exclude them.
-			 */
-			if (offset < si->lowest_alloc)
-				si->lowest_alloc = offset;
-			if (offset > si->highest_alloc)
-				si->highest_alloc = offset;
-		}
-	}
 	return offset;
 
 scan:
@@ -441,17 +502,24 @@ no_page:
 	return 0;
 }
 
-swp_entry_t get_swap_page(void)
+/*
+ * Allocate up to n swap entries for the swap cache, all from the same
+ * swap area, taking swap_lock just once.  Returns how many were found.
+ */
+int get_swap_pages(int n, swp_entry_t entries[])
 {
 	struct swap_info_struct *si;
 	pgoff_t offset;
 	int type, next;
 	int wrapped = 0;
+	int n_ret = 0;
 
 	spin_lock(&swap_lock);
 	if (nr_swap_pages <= 0)
 		goto noswap;
-	nr_swap_pages--;
+	if (n > nr_swap_pages)
+		n = nr_swap_pages;
+	nr_swap_pages -= n;
 
 	for (type = swap_list.next; type >= 0 && wrapped < 2; type = next) {
 		si = swap_info[type];
@@ -469,18 +537,21 @@ swp_entry_t get_swap_page(void)
 
 		swap_list.next = next;
 		/* This is called for allocating swap entry for cache */
-		offset = scan_swap_map(si, SWAP_HAS_CACHE);
-		if (offset) {
-			spin_unlock(&swap_lock);
-			return swp_entry(type, offset);
+		while (n_ret < n) {
+			offset = scan_swap_map(si, SWAP_HAS_CACHE);
+			if (!offset)
+				break;
+			entries[n_ret++] = swp_entry(type, offset);
 		}
+		if (n_ret)
+			break;
 		next = swap_list.next;
 	}
 
-	nr_swap_pages++;
+	nr_swap_pages += n - n_ret;
 noswap:
 	spin_unlock(&swap_lock);
-	return (swp_entry_t) {0};
+	return n_ret;
 }
 
 /* The only caller of this function is now susupend routine */
@@ -580,6 +651,7 @@ static unsigned char swap_entry_free(struct swap_info_struct *p,
 	/* free if no reference */
 	if (!usage) {
 		struct gendisk *disk = p->bdev->bd_disk;
+		swap_cluster_free(p, offset);
 		if (offset < p->lowest_bit)
 			p->lowest_bit = offset;
 		if (offset > p->highest_bit)
@@ -649,6 +721,27 @@ static inline int page_swapcount(struct page *page)
 	return count;
 }
 
+/*
+ * How many references are there to a swap entry, not counting the swap
+ * cache?  Zero for a slot that a per-cpu slot cache is holding on to.
+ */
+int __swap_count(swp_entry_t entry)
+{
+	struct swap_info_struct *p;
+	unsigned long offset = swp_offset(entry);
+	unsigned long type = swp_type(entry);
+	int count = 0;
+
+	if (type >= nr_swapfiles)
+		return 0;
+	p = swap_info[type];
+	spin_lock(&swap_lock);
+	if (p->swap_map && offset < p->max)
+		count = swap_count(p->swap_map[offset]);
+	spin_unlock(&swap_lock);
+	return count;
+}
+
 /*
  * We can write to an anon page without COW if there are no other references
  * to it.  And as a side-effect, free up its swap: because the old content
@@ -1616,10 +1709,15 @@ SYSCALL_DEFINE1(swapoff, const char __user *, specialfile)
 	p->flags &= ~SWP_WRITEOK;
 	spin_unlock(&swap_lock);
 
+	/* hand back slots of this area sitting in the per-cpu caches */
+	disable_swap_slots_cache();
+
 	current->flags |= PF_OOM_ORIGIN;
 	err = try_to_unuse(type);
 	current->flags &= ~PF_OOM_ORIGIN;
 
+	reenable_swap_slots_cache();
+
 	if (err) {
 		/* re-insert swap space back into swap_list */
 		spin_lock(&swap_lock);
@@ -1647,6 +1745,7 @@ SYSCALL_DEFINE1(swapoff, const char __user *, specialfile)
 	down_write(&swap_unplug_sem);
 	up_write(&swap_unplug_sem);
 
+	swap_discard_release(p);
 	destroy_swap_extents(p);
 	if (p->flags & SWP_CONTINUED)
 		free_swap_count_continuations(p);
@@ -2094,7 +2193,8 @@ SYSCALL_DEFINE2(swapon, const char __user *, specialfile, int, swap_flags)
 			p->flags |= SWP_SOLIDSTATE;
 			p->cluster_next = 1 + (random32() % p->highest_bit);
 		}
-		if (discard_swap(p) == 0 && (swap_flags & SWAP_FLAG_DISCARD))
+		if (discard_swap(p) == 0 && (swap_flags & SWAP_FLAG_DISCARD) &&
+		    swap_discard_setup(p, swap_map) == 0)
 			p->flags |= SWP_DISCARDABLE;
 	}
 
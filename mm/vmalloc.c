@@ -21,6 +21,7 @@
 #include <linux/debugobjects.h>
 #include <linux/kallsyms.h>
 #include <linux/list.h>
+#include <linux/list_sort.h>
 #include <linux/rbtree.h>
 #include <linux/radix-tree.h>
 #include <linux/rcupdate.h>
@@ -508,6 +509,28 @@ static unsigned long lazy_max_pages(void)
 
 static atomic_t vmap_lazy_nr = ATOMIC_INIT(0);
 
+/*
+ * Lazily freed vmap areas wait on the list of the CPU that freed them,
+ * so that vfree() does not contend on a global lock and a purge need
+ * not walk every vmap area in the system to find them.
+ */
+struct vmap_lazy_list {
+	spinlock_t lock;
+	struct list_head list;
+};
+
+static DEFINE_PER_CPU(struct vmap_lazy_list, vmap_lazy_list);
+
+/*
+ * A purge flushes each run of lazily freed areas separately, merging
+ * runs less than VMAP_PURGE_MERGE_GAP apart, as long as that takes at
+ * most VMAP_PURGE_MAX_RANGES flushes and the runs cover less than a
+ * quarter of the span between the lowest and highest address;
+ * otherwise it flushes the whole span at once.
+ */
+#define VMAP_PURGE_MAX_RANGES	4
+#define VMAP_PURGE_MERGE_GAP	(32UL * PAGE_SIZE)
+
 /* for per-CPU blocks */
 static void purge_fragmented_blocks_allcpus(void);
 
@@ -530,6 +553,55 @@ void set_iounmap_nonlazy(void)
  * Returns with *start = min(*start, lowest purged address)
  *              *end = max(*end, highest purged address)
  */
+static int vmap_area_cmp(void *priv, struct list_head *a, struct list_head *b)
+{
+	struct vmap_area *va = list_entry(a, struct vmap_area, purge_list);
+	struct vmap_area *vb = list_entry(b, struct vmap_area, purge_list);
+
+	if (va->va_start < vb->va_start)
+		return -1;
+	return va->va_start > vb->va_start;
+}
+
+/*
+ * Flush the kernel TLB for the areas on @valist, which span [start, end)
+ * and cover nr pages.  Returns the number of flushes issued.
+ */
+static int flush_vmap_area_ranges(struct list_head *valist,
+				  unsigned long start, unsigned long end,
+				  int nr)
+{
+	struct {
+		unsigned long start, end;
+	} range[VMAP_PURGE_MAX_RANGES];
+	struct vmap_area *va;
+	int i, n = 0;
+
+	if (((end - start) >> PAGE_SHIFT) / 4 <= nr)
+		goto flush_span;
+
+	list_sort(NULL, valist, vmap_area_cmp);
+	list_for_each_entry(va, valist, purge_list) {
+		if (n && va->va_start <= range[n - 1].end + VMAP_PURGE_MERGE_GAP) {
+			range[n - 1].end = max(range[n - 1].end, va->va_end);
+			continue;
+		}
+		if (n == VMAP_PURGE_MAX_RANGES)
+			goto flush_span;
+		range[n].start = va->va_start;
+		range[n].end = va->va_end;
+		n++;
+	}
+
+	for (i = 0; i < n; i++)
+		flush_tlb_kernel_range(range[i].start, range[i].end);
+	return n;
+
+flush_span:
+	flush_tlb_kernel_range(start, end);
+	return 1;
+}
+
 static void __purge_vmap_area_lazy(unsigned long *start, unsigned long *end,
 					int sync, int force_flush)
 {
@@ -538,6 +610,7 @@ static void __purge_vmap_area_lazy(unsigned long *start, unsigned long *end,
 	struct vmap_area *va;
 	struct vmap_area *n_va;
 	int nr = 0;
+	int cpu;
 
 	/*
 	 * If sync is 0 but force_flush is 1, we'll go sync anyway but callers
@@ -553,26 +626,40 @@ static void __purge_vmap_area_lazy(unsigned long *start, unsigned long *end,
 	if (sync)
 		purge_fragmented_blocks_allcpus();
 
-	rcu_read_lock();
-	list_for_each_entry_rcu(va, &vmap_area_list, list) {
-		if (va->flags & VM_LAZY_FREE) {
-			if (va->va_start < *start)
-				*start = va->va_start;
-			if (va->va_end > *end)
-				*end = va->va_end;
-			nr += (va->va_end - va->va_start) >> PAGE_SHIFT;
-			list_add_tail(&va->purge_list, &valist);
-			va->flags |= VM_LAZY_FREEING;
-			va->flags &= ~VM_LAZY_FREE;
-		}
+	for_each_possible_cpu(cpu) {
+		struct vmap_lazy_list *lazy = &per_cpu(vmap_lazy_list, cpu);
+
+		spin_lock(&lazy->lock);
+		list_splice_init(&lazy->list, &valist);
+		spin_unlock(&lazy->lock);
+	}
+
+	list_for_each_entry(va, &valist, purge_list) {
+		if (va->va_start < *start)
+			*start = va->va_start;
+		if (va->va_end > *end)
+			*end = va->va_end;
+		nr += (va->va_end - va->va_start) >> PAGE_SHIFT;
+		va->flags |= VM_LAZY_FREEING;
+		va->flags &= ~VM_LAZY_FREE;
 	}
-	rcu_read_unlock();
 
-	if (nr)
+	if (nr) {
 		atomic_sub(nr, &vmap_lazy_nr);
+		count_vm_event(VMAP_PURGE);
+		count_vm_events(VMAP_PURGE_PAGES, nr);
+	}
 
-	if (nr || force_flush)
+	/*
+	 * vm_unmap_aliases() has widened the range with its own dirty
+	 * vmap block space, so it gets the single span flush it asked for.
+	 */
+	if (force_flush) {
 		flush_tlb_kernel_range(*start, *end);
+		count_vm_event(VMAP_FLUSH_RANGES);
+	} else if (nr)
+		count_vm_events(VMAP_FLUSH_RANGES,
+			flush_vmap_area_ranges(&valist, *start, *end, nr));
 
 	if (nr) {
 		spin_lock(&vmap_area_lock);
@@ -611,7 +698,15 @@ static void purge_vmap_area_lazy(void)
  */
 static void free_vmap_area_noflush(struct vmap_area *va)
 {
+	struct vmap_lazy_list *lazy;
+
 	va->flags |= VM_LAZY_FREE;
+	lazy = &get_cpu_var(vmap_lazy_list);
+	spin_lock(&lazy->lock);
+	list_add_tail(&va->purge_list, &lazy->list);
+	spin_unlock(&lazy->lock);
+	put_cpu_var(vmap_lazy_list);
+
 	atomic_add((va->va_end - va->va_start) >> PAGE_SHIFT, &vmap_lazy_nr);
 	if (unlikely(atomic_read(&vmap_lazy_nr) > lazy_max_pages()))
 		try_purge_vmap_area_lazy();
@@ -1112,10 +1207,15 @@ void __init vmalloc_init(void)
 
 	for_each_possible_cpu(i) {
 		struct vmap_block_queue *vbq;
+		struct vmap_lazy_list *lazy;
 
 		vbq = &per_cpu(vmap_block_queue, i);
 		spin_lock_init(&vbq->lock);
 		INIT_LIST_HEAD(&vbq->free);
+
+		lazy = &per_cpu(vmap_lazy_list, i);
+		spin_lock_init(&lazy->lock);
+		INIT_LIST_HEAD(&lazy->list);
 	}
 
 	/* Import existing vmlist entries. */
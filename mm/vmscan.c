@@ -520,6 +520,19 @@ static int __remove_mapping(struct address_space *mapping, struct page *page)
 
 		freepage = mapping->a_ops->freepage;
 
+		if (page_is_file_cache(page)) {
+			workingset_eviction(mapping, page);
+			/*
+			 * The readahead marker was never reached: the
+			 * window behind it was read in for nothing.
+			 * Same bit as PG_reclaim, but the page is clean
+			 * and not under writeback here.
+			 */
+			if (unlikely(PageReadahead(page))) {
+				atomic_inc(&mapping->ra_wasted);
+				__count_vm_event(READAHEAD_WASTED);
+			}
+		}
 		__remove_from_page_cache(page);
 		spin_unlock_irq(&mapping->tree_lock);
 		mem_cgroup_uncharge_cache_page(page);
@@ -2600,6 +2613,13 @@ static void kswapd_try_to_sleep(pg_data_t *pgdat, int order, int classzone_idx)
 		 * them before going back to sleep.
 		 */
 		set_pgdat_percpu_threshold(pgdat, calculate_normal_threshold);
+
+		/*
+		 * Reclaim is done: if it left the node short of the
+		 * larger free blocks, have kcompactd rebuild them.
+		 */
+		kcompactd_check_node(pgdat, classzone_idx);
+
 		schedule();
 		set_pgdat_percpu_threshold(pgdat, calculate_pressure_threshold);
 	} else {
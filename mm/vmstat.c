@@ -458,6 +458,7 @@ void refresh_cpu_vm_stats(int cpu)
 				p->expire = 3;
 #endif
 			}
+		decay_pcp_high(zone, &p->pcp);
 		cond_resched();
 #ifdef CONFIG_NUMA
 		/*
@@ -918,6 +919,23 @@ static const char * const vmstat_text[] = {
 	"allocstall",
 
 	"pgrotated",
+	"workingset_refault",
+	"workingset_activate",
+	"readahead_pages",
+	"readahead_hit",
+	"readahead_wasted",
+	"vmap_purge",
+	"vmap_purge_pages",
+	"vmap_flush_ranges",
+#ifdef CONFIG_DEBUG_VM_VMACACHE
+	"vmacache_find_calls",
+	"vmacache_find_hits",
+#endif
+
+#ifdef CONFIG_SWAP
+	"swap_ra",
+	"swap_ra_hit",
+#endif
 
 #ifdef CONFIG_COMPACTION
 	"compact_blocks_moved",
@@ -926,11 +944,17 @@ static const char * const vmstat_text[] = {
 	"compact_stall",
 	"compact_fail",
 	"compact_success",
+	"compact_daemon_wake",
+	"compact_daemon_success",
 #endif
 
 #ifdef CONFIG_HUGETLB_PAGE
 	"htlb_buddy_alloc_success",
 	"htlb_buddy_alloc_fail",
+#endif
+#if defined(CONFIG_TRANSPARENT_HUGEPAGE) && defined(CONFIG_SHMEM)
+	"shmem_huge_aligned",
+	"shmem_huge_align_failed",
 #endif
 	"unevictable_pgs_culled",
 	"unevictable_pgs_scanned",
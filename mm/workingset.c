@@ -0,0 +1,188 @@
+/*
+ * linux/mm/workingset.c
+ *
+ * Workingset detection for the page cache.
+ *
+ * The inactive file list only holds a page for as long as it takes
+ * reclaim to get to it, so a big streaming read can push out pages
+ * that are used over and over, just a little less often than the list
+ * is cycled.  Those pages then refault straight away, and scan ratios
+ * alone never notice that the active list is too large.
+ *
+ * Each zone counts the pages leaving its inactive file list, evicted
+ * or activated, in zone->inactive_age.  When a page cache page is
+ * evicted, a shadow entry remembers the mapping, index and that count.
+ * When the page is read back in, the difference between the count then
+ * and the recorded one is its refault distance: the number of inactive
+ * slots it was missing to still be in memory.  If that is no more than
+ * the size of the active file list, the page could have stayed had the
+ * active list been smaller, so it is activated right away and competes
+ * with the active pages rather than again being thrown out by the next
+ * streaming reader.
+ *
+ * The page cache radix tree only holds pages here, so the shadow
+ * entries live in a separate hash table sized to track about one
+ * evicted page per four pages of memory.  Each bucket is a small ring
+ * in which the oldest entry is overwritten.  Entries are identified by
+ * a hash of mapping and index: an occasional false match only costs one
+ * needless activation.
+ */
+
+#include <linux/mm.h>
+#include <linux/swap.h>
+#include <linux/pagemap.h>
+#include <linux/bootmem.h>
+#include <linux/jhash.h>
+#include <linux/init.h>
+#include <linux/vmstat.h>
+
+#define SHADOW_BUCKET_SIZE	7
+
+struct shadow_entry {
+	unsigned int cookie;		/* hash of mapping and index, 0 if unused */
+	unsigned int eviction;		/* zone->inactive_age at eviction */
+	struct zone *zone;		/* zone the page was evicted from */
+};
+
+struct shadow_bucket {
+	spinlock_t lock;
+	unsigned int hand;		/* next entry to overwrite */
+	struct shadow_entry entries[SHADOW_BUCKET_SIZE];
+};
+
+static struct shadow_bucket *shadow_table __read_mostly;
+static unsigned int shadow_hash_shift __read_mostly;
+static unsigned int shadow_hash_mask __read_mostly;
+
+static unsigned long shadow_entries __initdata;
+static int __init set_shadow_entries(char *str)
+{
+	if (!str)
+		return 0;
+	shadow_entries = simple_strtoul(str, &str, 0) / SHADOW_BUCKET_SIZE;
+	return 1;
+}
+__setup("workingset_entries=", set_shadow_entries);
+
+static struct shadow_bucket *shadow_lookup(struct address_space *mapping,
+					   pgoff_t index, unsigned int *cookie)
+{
+	unsigned long ptr = (unsigned long)mapping;
+	u32 hash;
+
+	hash = jhash_3words((u32)ptr, (u32)(((u64)ptr) >> 32), (u32)index,
+			    (u32)(((u64)index) >> 32));
+	*cookie = hash | 1;
+	return &shadow_table[(hash >> (32 - shadow_hash_shift)) &
+			     shadow_hash_mask];
+}
+
+/**
+ * workingset_eviction - note the eviction of a page cache page
+ * @mapping: address space the page was removed from
+ * @page: the page being evicted
+ *
+ * Called by reclaim, with the page locked and off the LRU.
+ */
+void workingset_eviction(struct address_space *mapping, struct page *page)
+{
+	struct zone *zone = page_zone(page);
+	struct shadow_bucket *b;
+	struct shadow_entry *e;
+	unsigned int cookie;
+	unsigned long eviction;
+
+	eviction = atomic_long_inc_return(&zone->inactive_age);
+	if (!shadow_table)
+		return;
+
+	b = shadow_lookup(mapping, page->index, &cookie);
+	spin_lock(&b->lock);
+	e = &b->entries[b->hand];
+	if (++b->hand == SHADOW_BUCKET_SIZE)
+		b->hand = 0;
+	e->cookie = cookie;
+	e->eviction = eviction;
+	e->zone = zone;
+	spin_unlock(&b->lock);
+}
+
+/**
+ * workingset_refault - evaluate the refault of a previously evicted page
+ * @mapping: address space the page is being added to
+ * @index: its index in @mapping
+ *
+ * Returns %true if the page was evicted recently enough that it should
+ * go straight to the active list.
+ */
+bool workingset_refault(struct address_space *mapping, pgoff_t index)
+{
+	struct shadow_bucket *b;
+	struct zone *zone = NULL;
+	unsigned int cookie, eviction = 0, distance;
+	int i;
+
+	if (!shadow_table)
+		return false;
+
+	b = shadow_lookup(mapping, index, &cookie);
+	spin_lock(&b->lock);
+	for (i = 0; i < SHADOW_BUCKET_SIZE; i++) {
+		struct shadow_entry *e = &b->entries[i];
+
+		if (e->cookie == cookie) {
+			e->cookie = 0;
+			eviction = e->eviction;
+			zone = e->zone;
+			break;
+		}
+	}
+	spin_unlock(&b->lock);
+
+	if (!zone)
+		return false;
+
+	count_vm_event(WORKINGSET_REFAULT);
+	distance = (unsigned int)atomic_long_read(&zone->inactive_age) -
+			eviction;
+	if (distance > zone_page_state(zone, NR_ACTIVE_FILE))
+		return false;
+
+	count_vm_event(WORKINGSET_ACTIVATE);
+	return true;
+}
+
+/**
+ * workingset_activation - note a page moving to the active list
+ * @page: the page being activated
+ */
+void workingset_activation(struct page *page)
+{
+	atomic_long_inc(&page_zone(page)->inactive_age);
+}
+
+static int __init workingset_init(void)
+{
+	struct shadow_bucket *table;
+	unsigned long i;
+
+	table = alloc_large_system_hash("Workingset",
+					sizeof(struct shadow_bucket),
+					shadow_entries,
+					PAGE_SHIFT + 5,
+					0,
+					&shadow_hash_shift,
+					&shadow_hash_mask,
+					0);
+
+	for (i = 0; i <= shadow_hash_mask; i++) {
+		spin_lock_init(&table[i].lock);
+		table[i].hand = 0;
+		memset(table[i].entries, 0, sizeof(table[i].entries));
+	}
+
+	smp_wmb();	/* initialise the buckets before publishing them */
+	shadow_table = table;
+	return 0;
+}
+core_initcall(workingset_init);
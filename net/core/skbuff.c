@@ -57,6 +57,7 @@
 #include <linux/init.h>
 #include <linux/scatterlist.h>
 #include <linux/errqueue.h>
+#include <linux/cpu.h>
 
 #include <net/protocol.h>
 #include <net/dst.h>
@@ -73,6 +74,50 @@
 static struct kmem_cache *skbuff_head_cache __read_mostly;
 static struct kmem_cache *skbuff_fclone_cache __read_mostly;
 
+/*
+ * The NET_RX and NET_TX softirqs free and allocate most skb heads.  Each
+ * cpu keeps the heads they free in a small array that RX allocations
+ * are served from.  The array is refilled from and spills over to
+ * skbuff_head_cache in bulk, a batch at a time.
+ */
+#define NAPI_SKB_CACHE_SIZE	64
+#define NAPI_SKB_CACHE_BULK	16
+
+struct napi_skb_cache {
+	unsigned int	count;
+	void		*skbs[NAPI_SKB_CACHE_SIZE];
+};
+
+static DEFINE_PER_CPU(struct napi_skb_cache, napi_skb_cache);
+
+/* Hard interrupts may nest in a softirq, but must not touch the cache */
+static inline bool napi_skb_cache_usable(void)
+{
+	return in_serving_softirq() && !in_irq();
+}
+
+static struct sk_buff *napi_skb_cache_get(gfp_t gfp_mask)
+{
+	struct napi_skb_cache *nc = &__get_cpu_var(napi_skb_cache);
+
+	if (unlikely(!nc->count)) {
+		nc->count = kmem_cache_alloc_bulk(skbuff_head_cache, gfp_mask,
+						  NAPI_SKB_CACHE_BULK,
+						  nc->skbs);
+		if (unlikely(!nc->count))
+			return NULL;
+	}
+	return nc->skbs[--nc->count];
+}
+
+static void napi_skb_cache_drain(struct napi_skb_cache *nc)
+{
+	if (nc->count) {
+		kmem_cache_free_bulk(skbuff_head_cache, nc->count, nc->skbs);
+		nc->count = 0;
+	}
+}
+
 static void sock_pipe_buf_release(struct pipe_inode_info *pipe,
 				  struct pipe_buffer *buf)
 {
@@ -88,7 +133,17 @@ static void sock_pipe_buf_get(struct pipe_inode_info *pipe,
 static int sock_pipe_buf_steal(struct pipe_inode_info *pipe,
 			       struct pipe_buffer *buf)
 {
-	return 1;
+	struct page *page = buf->page;
+
+	/*
+	 * Once the skb is gone a plain order-0 page may be referenced by
+	 * the pipe only, and can then be moved into a file's page cache.
+	 */
+	if (PageCompound(page) || PageSlab(page) || page->mapping ||
+	    PageLRU(page))
+		return 1;
+
+	return generic_pipe_buf_steal(pipe, buf);
 }
 
 
@@ -178,7 +233,10 @@ struct sk_buff *__alloc_skb(unsigned int size, gfp_t gfp_mask,
 	cache = fclone ? skbuff_fclone_cache : skbuff_head_cache;
 
 	/* Get the HEAD */
-	skb = kmem_cache_alloc_node(cache, gfp_mask & ~__GFP_DMA, node);
+	if (!fclone && node == NUMA_NO_NODE && napi_skb_cache_usable())
+		skb = napi_skb_cache_get(gfp_mask & ~__GFP_DMA);
+	else
+		skb = kmem_cache_alloc_node(cache, gfp_mask & ~__GFP_DMA, node);
 	if (!skb)
 		goto out;
 	prefetchw(skb);
@@ -420,6 +478,36 @@ void __kfree_skb(struct sk_buff *skb)
 }
 EXPORT_SYMBOL(__kfree_skb);
 
+/**
+ *	__kfree_skb_defer - private function
+ *	@skb: buffer
+ *
+ *	Like __kfree_skb(), but when called from a softirq the head is kept
+ *	in a per cpu cache, for reuse by the next allocations there or to be
+ *	freed in bulk once the cache is full.
+ */
+void __kfree_skb_defer(struct sk_buff *skb)
+{
+	struct napi_skb_cache *nc;
+
+	if (skb->fclone != SKB_FCLONE_UNAVAILABLE ||
+	    !napi_skb_cache_usable()) {
+		__kfree_skb(skb);
+		return;
+	}
+
+	skb_release_all(skb);
+	nc = &__get_cpu_var(napi_skb_cache);
+	if (unlikely(nc->count == NAPI_SKB_CACHE_SIZE)) {
+		kmem_cache_free_bulk(skbuff_head_cache, NAPI_SKB_CACHE_BULK,
+				     nc->skbs + NAPI_SKB_CACHE_SIZE -
+				     NAPI_SKB_CACHE_BULK);
+		nc->count -= NAPI_SKB_CACHE_BULK;
+	}
+	nc->skbs[nc->count++] = skb;
+}
+EXPORT_SYMBOL(__kfree_skb_defer);
+
 /**
  *	kfree_skb - free an sk_buff
  *	@skb: buffer to free
@@ -504,6 +592,188 @@ bool skb_recycle_check(struct sk_buff *skb, int skb_size)
 }
 EXPORT_SYMBOL(skb_recycle_check);
 
+/*
+ * Receive buffer recycling pools.  A driver owns one pool per device;
+ * buffers that pass skb_recycle_check() on transmit completion are
+ * parked on the local CPU's list and handed back to the receive refill
+ * path running on that CPU, bypassing skbuff_head_cache and the page
+ * allocator.  The lists are protected by disabling bottom halves.
+ */
+struct skb_recycle_cpu {
+	struct sk_buff_head		list;
+	struct skb_recycle_stats	stats;
+};
+
+struct skb_recycle_pool {
+	unsigned int			skb_size;
+	unsigned int			max_len;
+	struct skb_recycle_cpu __percpu	*cpu;
+};
+
+/**
+ *	skb_recycle_pool_create - allocate a receive buffer recycling pool
+ *	@skb_size: receive buffer size, as passed to netdev_alloc_skb()
+ *	@max_len: maximum number of buffers kept per CPU
+ *
+ *	Returns the new pool or %NULL if out of memory.  A @skb_size of
+ *	zero creates a pool that does not accept buffers until it is
+ *	resized.
+ */
+struct skb_recycle_pool *skb_recycle_pool_create(unsigned int skb_size,
+						 unsigned int max_len)
+{
+	struct skb_recycle_pool *pool;
+	int cpu;
+
+	pool = kzalloc(sizeof(*pool), GFP_KERNEL);
+	if (!pool)
+		return NULL;
+
+	pool->cpu = alloc_percpu(struct skb_recycle_cpu);
+	if (!pool->cpu) {
+		kfree(pool);
+		return NULL;
+	}
+
+	for_each_possible_cpu(cpu)
+		skb_queue_head_init(&per_cpu_ptr(pool->cpu, cpu)->list);
+
+	pool->skb_size = skb_size;
+	pool->max_len = max_len;
+	return pool;
+}
+EXPORT_SYMBOL(skb_recycle_pool_create);
+
+static void skb_recycle_pool_purge(struct skb_recycle_pool *pool)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		skb_queue_purge(&per_cpu_ptr(pool->cpu, cpu)->list);
+}
+
+/**
+ *	skb_recycle_pool_destroy - free a recycling pool
+ *	@pool: pool to free, may be %NULL
+ *
+ *	Frees all buffers still cached in the pool.  The caller must make
+ *	sure that no other users of the pool remain.
+ */
+void skb_recycle_pool_destroy(struct skb_recycle_pool *pool)
+{
+	if (!pool)
+		return;
+
+	skb_recycle_pool_purge(pool);
+	free_percpu(pool->cpu);
+	kfree(pool);
+}
+EXPORT_SYMBOL(skb_recycle_pool_destroy);
+
+/**
+ *	skb_recycle_pool_resize - change the receive buffer size of a pool
+ *	@pool: pool to resize
+ *	@skb_size: new receive buffer size, zero disables recycling
+ *
+ *	Drops the cached buffers if the size changes.  Must not race with
+ *	skb_recycle_pool_put() or skb_recycle_pool_get(), so drivers call
+ *	it while their NAPI context is disabled, e.g. on MTU changes.
+ */
+void skb_recycle_pool_resize(struct skb_recycle_pool *pool,
+			     unsigned int skb_size)
+{
+	if (pool->skb_size == skb_size)
+		return;
+
+	skb_recycle_pool_purge(pool);
+	pool->skb_size = skb_size;
+}
+EXPORT_SYMBOL(skb_recycle_pool_resize);
+
+/**
+ *	skb_recycle_pool_put - try to recycle a transmitted buffer
+ *	@pool: pool of the receiving device
+ *	@skb: buffer whose transmission completed
+ *
+ *	Returns true if @skb was taken by the pool.  Otherwise the caller
+ *	still owns @skb and must free it.  Must be called from softirq or
+ *	process context, typically from the NAPI poll routine; with
+ *	interrupts disabled (hard irq, netpoll) the buffer is refused.
+ */
+bool skb_recycle_pool_put(struct skb_recycle_pool *pool, struct sk_buff *skb)
+{
+	struct skb_recycle_cpu *rc;
+	bool ret = false;
+
+	if (!pool->skb_size || in_irq() || irqs_disabled())
+		return false;
+
+	local_bh_disable();
+	rc = this_cpu_ptr(pool->cpu);
+	if (skb_queue_len(&rc->list) < pool->max_len &&
+	    skb_recycle_check(skb, pool->skb_size)) {
+		__skb_queue_head(&rc->list, skb);
+		rc->stats.recycled++;
+		ret = true;
+	} else {
+		rc->stats.rejected++;
+	}
+	local_bh_enable();
+	return ret;
+}
+EXPORT_SYMBOL(skb_recycle_pool_put);
+
+/**
+ *	skb_recycle_pool_get - take a receive buffer from a pool
+ *	@pool: pool to take the buffer from
+ *	@length: required buffer length
+ *
+ *	Returns a clean buffer laid out like one fresh from
+ *	__netdev_alloc_skb(), except that skb->dev is not set, or %NULL
+ *	if the local CPU has none cached.  Callers fall back to the
+ *	regular allocator in that case.
+ */
+struct sk_buff *skb_recycle_pool_get(struct skb_recycle_pool *pool,
+				     unsigned int length)
+{
+	struct skb_recycle_cpu *rc;
+	struct sk_buff *skb;
+
+	if (length > pool->skb_size || irqs_disabled())
+		return NULL;
+
+	local_bh_disable();
+	rc = this_cpu_ptr(pool->cpu);
+	skb = __skb_dequeue(&rc->list);
+	if (skb)
+		rc->stats.reused++;
+	local_bh_enable();
+	return skb;
+}
+EXPORT_SYMBOL(skb_recycle_pool_get);
+
+/**
+ *	skb_recycle_pool_stats - sum the counters of a pool
+ *	@pool: pool to report on
+ *	@stats: filled with the totals over all CPUs
+ */
+void skb_recycle_pool_stats(struct skb_recycle_pool *pool,
+			    struct skb_recycle_stats *stats)
+{
+	int cpu;
+
+	memset(stats, 0, sizeof(*stats));
+	for_each_possible_cpu(cpu) {
+		const struct skb_recycle_stats *s;
+
+		s = &per_cpu_ptr(pool->cpu, cpu)->stats;
+		stats->recycled += s->recycled;
+		stats->reused += s->reused;
+		stats->rejected += s->rejected;
+	}
+}
+EXPORT_SYMBOL(skb_recycle_pool_stats);
+
 static void __copy_skb_header(struct sk_buff *new, const struct sk_buff *old)
 {
 	new->tstamp		= old->tstamp;
@@ -1525,10 +1795,15 @@ static int __skb_splice_bits(struct sk_buff *skb, struct pipe_inode_info *pipe,
  * the fragments, and the frag list. It does NOT handle frag lists within
  * the frag list, if such a thing exists. We'd probably need to recurse to
  * handle that cleanly.
+ *
+ * @sk is used to copy linear data into pages. If @sk_locked is set, the
+ * caller owns the lock of @sk and it is dropped around splice_to_pipe().
  */
-int skb_splice_bits(struct sk_buff *skb, unsigned int offset,
-		    struct pipe_inode_info *pipe, unsigned int tlen,
-		    unsigned int flags)
+static int __skb_splice_to_pipe(struct sk_buff *skb, struct sock *sk,
+				unsigned int offset,
+				struct pipe_inode_info *pipe,
+				unsigned int tlen, unsigned int flags,
+				bool sk_locked)
 {
 	struct partial_page partial[PIPE_DEF_BUFFERS];
 	struct page *pages[PIPE_DEF_BUFFERS];
@@ -1540,7 +1815,6 @@ int skb_splice_bits(struct sk_buff *skb, unsigned int offset,
 		.spd_release = sock_spd_release,
 	};
 	struct sk_buff *frag_iter;
-	struct sock *sk = skb->sk;
 	int ret = 0;
 
 	if (splice_grow_spd(pipe, &spd))
@@ -1576,15 +1850,46 @@ done:
 		 * we call into ->sendpage() with the i_mutex lock held
 		 * and networking will grab the socket lock.
 		 */
-		release_sock(sk);
+		if (sk_locked)
+			release_sock(sk);
 		ret = splice_to_pipe(pipe, &spd);
-		lock_sock(sk);
+		if (sk_locked)
+			lock_sock(sk);
 	}
 
 	splice_shrink_spd(pipe, &spd);
 	return ret;
 }
 
+int skb_splice_bits(struct sk_buff *skb, unsigned int offset,
+		    struct pipe_inode_info *pipe, unsigned int tlen,
+		    unsigned int flags)
+{
+	return __skb_splice_to_pipe(skb, skb->sk, offset, pipe, tlen, flags,
+				    true);
+}
+
+/**
+ *	skb_splice_bits_nolock - map skb data to a pipe
+ *	@skb: buffer to map
+ *	@sk: receiving socket, its lock is not held by the caller
+ *	@offset: offset into @skb
+ *	@pipe: destination pipe
+ *	@tlen: number of bytes to map
+ *	@flags: splice flags
+ *
+ *	Like skb_splice_bits(), for protocols that serialize readers with
+ *	their own lock instead of the socket lock.
+ */
+int skb_splice_bits_nolock(struct sk_buff *skb, struct sock *sk,
+			   unsigned int offset, struct pipe_inode_info *pipe,
+			   unsigned int tlen, unsigned int flags)
+{
+	return __skb_splice_to_pipe(skb, sk, offset, pipe, tlen, flags,
+				    false);
+}
+EXPORT_SYMBOL_GPL(skb_splice_bits_nolock);
+
 /**
  *	skb_store_bits - store bits from kernel buffer to skb
  *	@skb: destination buffer
@@ -2771,6 +3076,15 @@ done:
 }
 EXPORT_SYMBOL_GPL(skb_gro_receive);
 
+static int __cpuinit skb_cpu_callback(struct notifier_block *nfb,
+				      unsigned long action, void *hcpu)
+{
+	if (action == CPU_DEAD || action == CPU_DEAD_FROZEN)
+		napi_skb_cache_drain(&per_cpu(napi_skb_cache,
+					      (unsigned long)hcpu));
+	return NOTIFY_OK;
+}
+
 void __init skb_init(void)
 {
 	skbuff_head_cache = kmem_cache_create("skbuff_head_cache",
@@ -2784,6 +3098,7 @@ void __init skb_init(void)
 						0,
 						SLAB_HWCACHE_ALIGN|SLAB_PANIC,
 						NULL);
+	hotcpu_notifier(skb_cpu_callback, 0);
 }
 
 /**
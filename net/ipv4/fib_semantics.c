@@ -148,10 +148,24 @@ static const struct
 
 /* Release a nexthop info record */
 
+static void free_nh_rth_input(struct fib_nh *nh)
+{
+	struct rtable *rt = xchg((struct rtable **)&nh->nh_rth_input, NULL);
+
+	if (rt)
+		call_rcu_bh(&rt->dst.rcu_head, dst_rcu_free);
+}
+
+/* Readers that found this fib_info before it died may still cache an
+ * input route in its nexthops, so only drop those after a grace period.
+ */
 static void free_fib_info_rcu(struct rcu_head *head)
 {
 	struct fib_info *fi = container_of(head, struct fib_info, rcu);
 
+	change_nexthops(fi) {
+		free_nh_rth_input(nexthop_nh);
+	} endfor_nexthops(fi);
 	kfree(fi);
 }
 
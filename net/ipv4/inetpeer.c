@@ -512,6 +512,9 @@ struct inet_peer *inet_getpeer(struct inetpeer_addr *daddr, int create)
 		atomic_set(&p->rid, 0);
 		atomic_set(&p->ip_id_count, secure_ip_id(daddr->a4));
 		p->tcp_ts_stamp = 0;
+		p->tcp_fastopen_mss = 0;
+		p->tcp_fastopen_cookie_len = 0;
+		p->tcp_fastopen_syn_loss = 0;
 		INIT_LIST_HEAD(&p->unused);
 
 
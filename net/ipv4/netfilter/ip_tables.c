@@ -24,6 +24,8 @@
 #include <linux/proc_fs.h>
 #include <linux/err.h>
 #include <linux/cpumask.h>
+#include <linux/seq_file.h>
+#include <linux/sort.h>
 
 #include <linux/netfilter/x_tables.h>
 #include <linux/netfilter_ipv4/ip_tables.h>
@@ -62,6 +64,11 @@ MODULE_DESCRIPTION("IPv4 packet filter");
 #define inline
 #endif
 
+static unsigned int classify_min_rules __read_mostly = 128;
+module_param(classify_min_rules, uint, 0644);
+MODULE_PARM_DESC(classify_min_rules, "Build a rule classifier for tables "
+		 "with at least this many rules (0 = never)");
+
 void *ipt_alloc_initial_table(const struct xt_table *info)
 {
 	return xt_alloc_initial_table(ipt, IPT);
@@ -293,6 +300,238 @@ struct ipt_entry *ipt_next_entry(const struct ipt_entry *entry)
 	return (void *)entry + entry->next_offset;
 }
 
+/*
+ * Rule classifier.
+ *
+ * Walking the rules, ipt_do_table() only ever looks at the extension
+ * matches and the target of a rule whose ipt_ip part matched the packet;
+ * rules failing ip_packet_match() have no side effects.  So once a table
+ * has many rules on an exact source or destination address, we can jump
+ * straight to the next rule (in table order) which can possibly match:
+ * it is the first of the next rule keyed on the packet's address and the
+ * next rule not keyed on an address at all.  The result is the same as
+ * the linear walk; jumps, returns, and targets which rewrote the packet
+ * just start a new lookup from where they land.
+ */
+struct ipt_cls_key {
+	__be32		addr;
+	unsigned int	rule;
+};
+
+struct ipt_cls_stats {
+	unsigned long	lookups;	/* classifier invocations */
+	unsigned long	tested;		/* rules checked with ip_packet_match */
+	unsigned long	skipped;	/* rules never looked at */
+};
+
+struct ipt_classifier {
+	unsigned int		nrules;
+	unsigned int		nkeyed;
+	unsigned int		nwild;
+	bool			by_dst;		/* key on daddr, else saddr */
+	unsigned int		*offsets;	/* offset of each rule */
+	struct ipt_cls_key	*keyed;		/* sorted by addr, then rule */
+	unsigned int		*wild;		/* rules without an address key */
+	struct ipt_cls_stats __percpu *stats;
+};
+
+static bool ipt_cls_keyed(const struct ipt_ip *ip, bool by_dst)
+{
+	if (by_dst)
+		return ip->dmsk.s_addr == htonl(0xFFFFFFFF) &&
+		       !(ip->invflags & IPT_INV_DSTIP);
+	return ip->smsk.s_addr == htonl(0xFFFFFFFF) &&
+	       !(ip->invflags & IPT_INV_SRCIP);
+}
+
+static int ipt_cls_key_cmp(const void *a, const void *b)
+{
+	const struct ipt_cls_key *ka = a, *kb = b;
+	u32 aa = ntohl(ka->addr), ab = ntohl(kb->addr);
+
+	if (aa != ab)
+		return aa < ab ? -1 : 1;
+	if (ka->rule != kb->rule)
+		return ka->rule < kb->rule ? -1 : 1;
+	return 0;
+}
+
+static void ipt_cls_free(struct ipt_classifier *cls)
+{
+	if (!cls)
+		return;
+	free_percpu(cls->stats);
+	vfree(cls->offsets);
+	kfree(cls);
+}
+
+/* Called once the table is checked, before it is copied to the other CPUs. */
+static void ipt_cls_build(struct xt_table_info *newinfo, void *entry0)
+{
+	struct ipt_classifier *cls;
+	const struct ipt_entry *iter;
+	unsigned int nsrc = 0, ndst = 0, i, k, w;
+
+	if (!classify_min_rules || newinfo->number < classify_min_rules)
+		return;
+
+	xt_entry_foreach(iter, entry0, newinfo->size) {
+		nsrc += ipt_cls_keyed(&iter->ip, false);
+		ndst += ipt_cls_keyed(&iter->ip, true);
+	}
+
+	/* the rules without a key are still walked one by one */
+	if (max(nsrc, ndst) < newinfo->number / 4)
+		return;
+
+	cls = kzalloc(sizeof(*cls), GFP_KERNEL);
+	if (!cls)
+		return;
+
+	cls->nrules = newinfo->number;
+	cls->by_dst = ndst >= nsrc;
+	cls->nkeyed = cls->by_dst ? ndst : nsrc;
+	cls->nwild = cls->nrules - cls->nkeyed;
+
+	cls->offsets = vmalloc(cls->nrules * sizeof(*cls->offsets) +
+			       cls->nkeyed * sizeof(*cls->keyed) +
+			       cls->nwild * sizeof(*cls->wild));
+	cls->stats = alloc_percpu(struct ipt_cls_stats);
+	if (!cls->offsets || !cls->stats) {
+		ipt_cls_free(cls);
+		return;
+	}
+	cls->keyed = (void *)(cls->offsets + cls->nrules);
+	cls->wild = (void *)(cls->keyed + cls->nkeyed);
+
+	i = k = w = 0;
+	xt_entry_foreach(iter, entry0, newinfo->size) {
+		cls->offsets[i] = (void *)iter - entry0;
+		if (ipt_cls_keyed(&iter->ip, cls->by_dst)) {
+			cls->keyed[k].addr = cls->by_dst ? iter->ip.dst.s_addr :
+							   iter->ip.src.s_addr;
+			cls->keyed[k++].rule = i;
+		} else {
+			cls->wild[w++] = i;
+		}
+		++i;
+	}
+	sort(cls->keyed, cls->nkeyed, sizeof(*cls->keyed),
+	     ipt_cls_key_cmp, NULL);
+
+	newinfo->classifier = cls;
+}
+
+static void ipt_free_table_info(struct xt_table_info *info)
+{
+	ipt_cls_free(info->classifier);
+	xt_free_table_info(info);
+}
+
+/* number of the rule at offset off, or nrules if there is none */
+static unsigned int ipt_cls_rule(const struct ipt_classifier *cls,
+				 unsigned int off)
+{
+	unsigned int lo = 0, hi = cls->nrules;
+
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+
+		if (cls->offsets[mid] < off)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return (lo < cls->nrules && cls->offsets[lo] == off) ? lo : cls->nrules;
+}
+
+/* first keyed entry for addr at or after rule */
+static unsigned int ipt_cls_first_keyed(const struct ipt_classifier *cls,
+					__be32 addr, unsigned int rule)
+{
+	struct ipt_cls_key key = { .addr = addr, .rule = rule };
+	unsigned int lo = 0, hi = cls->nkeyed;
+
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+
+		if (ipt_cls_key_cmp(&cls->keyed[mid], &key) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* first unkeyed entry at or after rule */
+static unsigned int ipt_cls_first_wild(const struct ipt_classifier *cls,
+				       unsigned int rule)
+{
+	unsigned int lo = 0, hi = cls->nwild;
+
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+
+		if (cls->wild[mid] < rule)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/*
+ * Return the first rule at or after e whose ipt_ip part matches the
+ * packet, or e itself if the classifier can't tell.
+ */
+static struct ipt_entry *
+ipt_cls_next(const struct ipt_classifier *cls, const void *table_base,
+	     struct ipt_entry *e, const struct iphdr *ip,
+	     const char *indev, const char *outdev, int fragoff)
+{
+	struct ipt_cls_stats *stats = this_cpu_ptr(cls->stats);
+	unsigned int start, rule, k, w, tested = 0;
+	__be32 addr;
+
+	start = ipt_cls_rule(cls, (void *)e - table_base);
+	if (start == cls->nrules)
+		return e;
+
+	addr = cls->by_dst ? ip->daddr : ip->saddr;
+	k = ipt_cls_first_keyed(cls, addr, start);
+	w = ipt_cls_first_wild(cls, start);
+	stats->lookups++;
+
+	for (;;) {
+		unsigned int krule = UINT_MAX, wrule = UINT_MAX;
+		struct ipt_entry *next;
+
+		if (k < cls->nkeyed && cls->keyed[k].addr == addr)
+			krule = cls->keyed[k].rule;
+		if (w < cls->nwild)
+			wrule = cls->wild[w];
+		if (krule < wrule) {
+			rule = krule;
+			k++;
+		} else if (wrule != UINT_MAX) {
+			rule = wrule;
+			w++;
+		} else {
+			break;
+		}
+
+		tested++;
+		next = (void *)table_base + cls->offsets[rule];
+		if (ip_packet_match(ip, indev, outdev, &next->ip, fragoff)) {
+			stats->tested += tested;
+			stats->skipped += rule - start + 1 - tested;
+			return next;
+		}
+	}
+	stats->tested += tested;
+	return e;
+}
+
 /* Returns one of the generic firewall policies, like NF_ACCEPT. */
 unsigned int
 ipt_do_table(struct sk_buff *skb,
@@ -310,6 +549,7 @@ ipt_do_table(struct sk_buff *skb,
 	struct ipt_entry *e, **jumpstack;
 	unsigned int *stackptr, origptr, cpu;
 	const struct xt_table_info *private;
+	const struct ipt_classifier *cls;
 	struct xt_action_param acpar;
 
 	/* Initialization */
@@ -338,6 +578,7 @@ ipt_do_table(struct sk_buff *skb,
 	jumpstack  = (struct ipt_entry **)private->jumpstack[cpu];
 	stackptr   = per_cpu_ptr(private->stackptr, cpu);
 	origptr    = *stackptr;
+	cls        = private->classifier;
 
 	e = get_entry(table_base, private->hook_entry[hook]);
 
@@ -350,6 +591,9 @@ ipt_do_table(struct sk_buff *skb,
 		const struct xt_entry_match *ematch;
 
 		IP_NF_ASSERT(e);
+		if (cls)
+			e = ipt_cls_next(cls, table_base, e, ip, indev, outdev,
+					 acpar.fragoff);
 		if (!ip_packet_match(ip, indev, outdev,
 		    &e->ip, acpar.fragoff)) {
  no_match:
@@ -868,6 +1112,8 @@ translate_table(struct net *net, struct xt_table_info *newinfo, void *entry0,
 		return ret;
 	}
 
+	ipt_cls_build(newinfo, entry0);
+
 	/* And one copy for every other CPU */
 	for_each_possible_cpu(i) {
 		if (newinfo->entries[i] && newinfo->entries[i] != entry0)
@@ -1229,7 +1475,7 @@ __do_replace(struct net *net, const char *name, unsigned int valid_hooks,
 	xt_entry_foreach(iter, loc_cpu_old_entry, oldinfo->size)
 		cleanup_entry(iter, net);
 
-	xt_free_table_info(oldinfo);
+	ipt_free_table_info(oldinfo);
 	if (copy_to_user(counters_ptr, counters,
 			 sizeof(struct xt_counters) * num_counters) != 0)
 		ret = -EFAULT;
@@ -1291,7 +1537,7 @@ do_replace(struct net *net, const void __user *user, unsigned int len)
 	xt_entry_foreach(iter, loc_cpu_entry, newinfo->size)
 		cleanup_entry(iter, net);
  free_newinfo:
-	xt_free_table_info(newinfo);
+	ipt_free_table_info(newinfo);
 	return ret;
 }
 
@@ -1760,10 +2006,12 @@ translate_compat_table(struct net *net,
 				break;
 			cleanup_entry(iter1, net);
 		}
-		xt_free_table_info(newinfo);
+		ipt_free_table_info(newinfo);
 		return ret;
 	}
 
+	ipt_cls_build(newinfo, entry1);
+
 	/* And one copy for every other CPU */
 	for_each_possible_cpu(i)
 		if (newinfo->entries[i] && newinfo->entries[i] != entry1)
@@ -1771,11 +2019,11 @@ translate_compat_table(struct net *net,
 
 	*pinfo = newinfo;
 	*pentry0 = entry1;
-	xt_free_table_info(info);
+	ipt_free_table_info(info);
 	return 0;
 
 free_newinfo:
-	xt_free_table_info(newinfo);
+	ipt_free_table_info(newinfo);
 out:
 	xt_entry_foreach(iter0, entry0, total_size) {
 		if (j-- == 0)
@@ -1839,7 +2087,7 @@ compat_do_replace(struct net *net, void __user *user, unsigned int len)
 	xt_entry_foreach(iter, loc_cpu_entry, newinfo->size)
 		cleanup_entry(iter, net);
  free_newinfo:
-	xt_free_table_info(newinfo);
+	ipt_free_table_info(newinfo);
 	return ret;
 }
 
@@ -2058,6 +2306,110 @@ do_ipt_get_ctl(struct sock *sk, int cmd, void __user *user, int *len)
 	return ret;
 }
 
+#ifdef CONFIG_PROC_FS
+#define IPT_CLS_PROC_DIR	"ip_tables_classifier"
+
+static int ipt_cls_seq_show(struct seq_file *m, void *v)
+{
+	const struct xt_table *table = m->private;
+	const struct xt_table_info *private;
+	const struct ipt_classifier *cls;
+	struct ipt_cls_stats sum = { 0 };
+	int cpu;
+
+	/* like the packet path, this keeps the rules from being replaced */
+	xt_info_rdlock_bh();
+	private = table->private;
+	cls = private->classifier;
+	seq_printf(m, "rules:\t\t%u\n", private->number);
+	if (!cls) {
+		seq_puts(m, "classifier:\toff\n");
+		goto out;
+	}
+
+	for_each_possible_cpu(cpu) {
+		const struct ipt_cls_stats *stats = per_cpu_ptr(cls->stats, cpu);
+
+		sum.lookups += stats->lookups;
+		sum.tested += stats->tested;
+		sum.skipped += stats->skipped;
+	}
+	seq_printf(m, "classifier:\t%s\n"
+		      "keyed:\t\t%u\n"
+		      "lookups:\t%lu\n"
+		      "tested:\t\t%lu\n"
+		      "skipped:\t%lu\n",
+		   cls->by_dst ? "daddr" : "saddr", cls->nkeyed,
+		   sum.lookups, sum.tested, sum.skipped);
+out:
+	xt_info_rdunlock_bh();
+	return 0;
+}
+
+static int ipt_cls_seq_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ipt_cls_seq_show, PDE(inode)->data);
+}
+
+static const struct file_operations ipt_cls_fops = {
+	.owner	 = THIS_MODULE,
+	.open	 = ipt_cls_seq_open,
+	.read	 = seq_read,
+	.llseek	 = seq_lseek,
+	.release = single_release,
+};
+
+static int ipt_cls_proc_create(struct net *net, struct xt_table *table)
+{
+	char name[sizeof(IPT_CLS_PROC_DIR "/") + XT_TABLE_MAXNAMELEN];
+
+	snprintf(name, sizeof(name), IPT_CLS_PROC_DIR "/%s", table->name);
+	if (!proc_create_data(name, S_IRUGO, net->proc_net, &ipt_cls_fops,
+			      table))
+		return -ENOMEM;
+	return 0;
+}
+
+static void ipt_cls_proc_remove(struct net *net, const struct xt_table *table)
+{
+	char name[sizeof(IPT_CLS_PROC_DIR "/") + XT_TABLE_MAXNAMELEN];
+
+	snprintf(name, sizeof(name), IPT_CLS_PROC_DIR "/%s", table->name);
+	remove_proc_entry(name, net->proc_net);
+}
+
+static int __net_init ipt_cls_proc_net_init(struct net *net)
+{
+	return proc_mkdir(IPT_CLS_PROC_DIR, net->proc_net) ? 0 : -ENOMEM;
+}
+
+static void __net_exit ipt_cls_proc_net_exit(struct net *net)
+{
+	proc_net_remove(net, IPT_CLS_PROC_DIR);
+}
+#else
+static inline int ipt_cls_proc_create(struct net *net, struct xt_table *table)
+{
+	return 0;
+}
+
+static inline void ipt_cls_proc_remove(struct net *net,
+				       const struct xt_table *table)
+{
+}
+
+static inline int ipt_cls_proc_net_init(struct net *net)
+{
+	return 0;
+}
+
+static inline void ipt_cls_proc_net_exit(struct net *net)
+{
+}
+#endif /* CONFIG_PROC_FS */
+
+static void __ipt_unregister_table(struct net *net, struct xt_table *table);
+
 struct xt_table *ipt_register_table(struct net *net,
 				    const struct xt_table *table,
 				    const struct ipt_replace *repl)
@@ -2088,15 +2440,21 @@ struct xt_table *ipt_register_table(struct net *net,
 		goto out_free;
 	}
 
+	ret = ipt_cls_proc_create(net, new_table);
+	if (ret != 0) {
+		__ipt_unregister_table(net, new_table);
+		goto out;
+	}
+
 	return new_table;
 
 out_free:
-	xt_free_table_info(newinfo);
+	ipt_free_table_info(newinfo);
 out:
 	return ERR_PTR(ret);
 }
 
-void ipt_unregister_table(struct net *net, struct xt_table *table)
+static void __ipt_unregister_table(struct net *net, struct xt_table *table)
 {
 	struct xt_table_info *private;
 	void *loc_cpu_entry;
@@ -2111,7 +2469,13 @@ void ipt_unregister_table(struct net *net, struct xt_table *table)
 		cleanup_entry(iter, net);
 	if (private->number > private->initial_entries)
 		module_put(table_owner);
-	xt_free_table_info(private);
+	ipt_free_table_info(private);
+}
+
+void ipt_unregister_table(struct net *net, struct xt_table *table)
+{
+	ipt_cls_proc_remove(net, table);
+	__ipt_unregister_table(net, table);
 }
 
 /* Returns 1 if the type and code is matched by the range, 0 otherwise */
@@ -2210,11 +2574,21 @@ static struct xt_match ipt_builtin_mt[] __read_mostly = {
 
 static int __net_init ip_tables_net_init(struct net *net)
 {
-	return xt_proto_init(net, NFPROTO_IPV4);
+	int ret;
+
+	ret = xt_proto_init(net, NFPROTO_IPV4);
+	if (ret < 0)
+		return ret;
+
+	ret = ipt_cls_proc_net_init(net);
+	if (ret < 0)
+		xt_proto_fini(net, NFPROTO_IPV4);
+	return ret;
 }
 
 static void __net_exit ip_tables_net_exit(struct net *net)
 {
+	ipt_cls_proc_net_exit(net);
 	xt_proto_fini(net, NFPROTO_IPV4);
 }
 
@@ -1078,6 +1078,35 @@ static int slow_chain_length(const struct rtable *head)
 	return length >> FRACT_BITS;
 }
 
+/*
+ * Hand out a route that is not entered into the hash table.  The caller
+ * holds the sole reference and it is released when the caller is done
+ * with it.  To avoid expensive rcu stuff for this uncached dst, we set
+ * DST_NOCACHE so that dst_release() can free dst without waiting a grace
+ * period.
+ */
+static int rt_bind_uncached(struct rtable *rt, struct rtable **rp,
+			    struct sk_buff *skb)
+{
+	rt->dst.flags |= DST_NOCACHE;
+	if (rt->rt_type == RTN_UNICAST || rt_is_output_route(rt)) {
+		int err = arp_bind_neighbour(&rt->dst);
+		if (err) {
+			if (net_ratelimit())
+				printk(KERN_WARNING
+				    "Neighbour table failure & not caching routes.\n");
+			ip_rt_put(rt);
+			return err;
+		}
+	}
+
+	if (rp)
+		*rp = rt;
+	else
+		skb_dst_set(skb, &rt->dst);
+	return 0;
+}
+
 static int rt_intern_hash(unsigned hash, struct rtable *rt,
 			  struct rtable **rp, struct sk_buff *skb, int ifindex)
 {
@@ -1104,27 +1133,8 @@ restart:
 		 * If we drop it here, the callers have no way to resolve routes
 		 * when we're not caching.  Instead, just point *rp at rt, so
 		 * the caller gets a single use out of the route
-		 * Note that we do rt_free on this new route entry, so that
-		 * once its refcount hits zero, we are still able to reap it
-		 * (Thanks Alexey)
-		 * Note: To avoid expensive rcu stuff for this uncached dst,
-		 * we set DST_NOCACHE so that dst_release() can free dst without
-		 * waiting a grace period.
 		 */
-
-		rt->dst.flags |= DST_NOCACHE;
-		if (rt->rt_type == RTN_UNICAST || rt_is_output_route(rt)) {
-			int err = arp_bind_neighbour(&rt->dst);
-			if (err) {
-				if (net_ratelimit())
-					printk(KERN_WARNING
-					    "Neighbour table failure & not caching routes.\n");
-				ip_rt_put(rt);
-				return err;
-			}
-		}
-
-		goto skip_hashing;
+		return rt_bind_uncached(rt, rp, skb);
 	}
 
 	rthp = &rt_hash_table[hash].chain;
@@ -1264,7 +1274,6 @@ restart:
 
 	spin_unlock_bh(rt_hash_lock_addr(hash));
 
-skip_hashing:
 	if (rp)
 		*rp = rt;
 	else
@@ -1695,6 +1704,10 @@ unsigned short ip_rt_frag_needed(struct net *net, struct iphdr *iph,
 
 static void ip_rt_update_pmtu(struct dst_entry *dst, u32 mtu)
 {
+	/* Routes shared through a nexthop describe no single destination. */
+	if (!(dst->flags & DST_HOST))
+		return;
+
 	if (dst_mtu(dst) > mtu && mtu >= 68 &&
 	    !(dst_metric_locked(dst, RTAX_MTU))) {
 		if (mtu < ip_rt_min_pmtu) {
@@ -1957,12 +1970,60 @@ static void ip_handle_martian_source(struct net_device *dev,
 #endif
 }
 
+/*
+ * A forwarding route can be shared by every flow leaving through the same
+ * gateway nexthop when nothing in it depends on the packet's addresses:
+ * no redirect or directly connected source to remember, no routing realms
+ * and no IP options, which are processed against rt_dst and rt_spec_dst.
+ */
+static inline int rt_nexthop_cacheable(const struct sk_buff *skb,
+				       struct fib_result *res,
+				       unsigned int flags, u32 itag)
+{
+	if (flags || itag || !res->fi || !FIB_RES_GW(*res) ||
+	    FIB_RES_NH(*res).nh_scope != RT_SCOPE_LINK)
+		return 0;
+#if defined(CONFIG_NET_CLS_ROUTE) && defined(CONFIG_IP_MULTIPLE_TABLES)
+	if (fib_rules_tclass(res))
+		return 0;
+#endif
+	return skb->protocol == htons(ETH_P_IP) && ip_hdr(skb)->ihl == 5;
+}
+
+/*
+ * Publish a shared forwarding route on its nexthop.  The slot holds no
+ * reference of its own, like a hash chain; a replaced route is freed after
+ * a grace period.  If another CPU published one first, rt is only used for
+ * this packet.
+ */
+static int rt_cache_nexthop(struct fib_nh *nh, struct rtable *rt)
+{
+	struct rtable *orig;
+	int err;
+
+	err = arp_bind_neighbour(&rt->dst);
+	if (err) {
+		if (net_ratelimit())
+			printk(KERN_WARNING "ipv4: Neighbour table overflow.\n");
+		rt_drop(rt);
+		return err;
+	}
+
+	orig = rcu_dereference(nh->nh_rth_input);
+	if (cmpxchg((struct rtable **)&nh->nh_rth_input, orig, rt) == orig) {
+		if (orig)
+			rt_free(orig);
+	} else
+		rt->dst.flags |= DST_NOCACHE;
+	return 0;
+}
+
 /* called in rcu_read_lock() section */
 static int __mkroute_input(struct sk_buff *skb,
 			   struct fib_result *res,
 			   struct in_device *in_dev,
 			   __be32 daddr, __be32 saddr, u32 tos,
-			   struct rtable **result)
+			   bool noref)
 {
 	struct rtable *rth;
 	int err;
@@ -1970,6 +2031,7 @@ static int __mkroute_input(struct sk_buff *skb,
 	unsigned int flags = 0;
 	__be32 spec_dst;
 	u32 itag;
+	int shared;
 
 	/* get a working reference to the output device */
 	out_dev = __in_dev_get_rcu(FIB_RES_DEV(*res));
@@ -2013,6 +2075,22 @@ static int __mkroute_input(struct sk_buff *skb,
 		}
 	}
 
+	shared = rt_nexthop_cacheable(skb, res, flags, itag);
+	if (shared) {
+		rth = rcu_dereference(FIB_RES_NH(*res).nh_rth_input);
+		if (rth && rth->fl.iif == in_dev->dev->ifindex &&
+		    !rt_is_expired(rth)) {
+			if (noref) {
+				dst_use_noref(&rth->dst, jiffies);
+				skb_dst_set_noref(skb, &rth->dst);
+			} else {
+				dst_use(&rth->dst, jiffies);
+				skb_dst_set(skb, &rth->dst);
+			}
+			RT_CACHE_STAT_INC(in_hit);
+			return 0;
+		}
+	}
 
 	rth = dst_alloc(&ipv4_dst_ops);
 	if (!rth) {
@@ -2049,8 +2127,19 @@ static int __mkroute_input(struct sk_buff *skb,
 
 	rth->rt_flags = flags;
 
-	*result = rth;
-	err = 0;
+	if (!shared)
+		return rt_bind_uncached(rth, NULL, skb);
+
+	/* Nothing flow specific may be left in a shared route. */
+	rth->dst.flags &= ~DST_HOST;
+	rth->fl.fl4_dst	= rth->rt_dst = 0;
+	rth->fl.fl4_src	= rth->rt_src = 0;
+	rth->fl.fl4_tos	= 0;
+	rth->fl.mark	= 0;
+
+	err = rt_cache_nexthop(&FIB_RES_NH(*res), rth);
+	if (err == 0)
+		skb_dst_set(skb, &rth->dst);
  cleanup:
 	return err;
 }
@@ -2059,26 +2148,15 @@ static int ip_mkroute_input(struct sk_buff *skb,
 			    struct fib_result *res,
 			    const struct flowi *fl,
 			    struct in_device *in_dev,
-			    __be32 daddr, __be32 saddr, u32 tos)
+			    __be32 daddr, __be32 saddr, u32 tos, bool noref)
 {
-	struct rtable* rth = NULL;
-	int err;
-	unsigned hash;
-
 #ifdef CONFIG_IP_ROUTE_MULTIPATH
 	if (res->fi && res->fi->fib_nhs > 1 && fl->oif == 0)
 		fib_select_multipath(fl, res);
 #endif
 
-	/* create a routing cache entry */
-	err = __mkroute_input(skb, res, in_dev, daddr, saddr, tos, &rth);
-	if (err)
-		return err;
-
-	/* put it into the cache */
-	hash = rt_hash(daddr, saddr, fl->iif,
-		       rt_genid(dev_net(rth->dst.dev)));
-	return rt_intern_hash(hash, rth, NULL, skb, fl->iif);
+	/* forwarding routes are never entered into the hash table */
+	return __mkroute_input(skb, res, in_dev, daddr, saddr, tos, noref);
 }
 
 /*
@@ -2093,7 +2171,7 @@ static int ip_mkroute_input(struct sk_buff *skb,
  */
 
 static int ip_route_input_slow(struct sk_buff *skb, __be32 daddr, __be32 saddr,
-			       u8 tos, struct net_device *dev)
+			       u8 tos, struct net_device *dev, bool noref)
 {
 	struct fib_result res;
 	struct in_device *in_dev = __in_dev_get_rcu(dev);
@@ -2168,7 +2246,8 @@ static int ip_route_input_slow(struct sk_buff *skb, __be32 daddr, __be32 saddr,
 	if (res.type != RTN_UNICAST)
 		goto martian_destination;
 
-	err = ip_mkroute_input(skb, &res, &fl, in_dev, daddr, saddr, tos);
+	err = ip_mkroute_input(skb, &res, &fl, in_dev, daddr, saddr, tos,
+			       noref);
 out:	return err;
 
 brd_input:
@@ -2344,7 +2423,7 @@ skip_cache:
 		rcu_read_unlock();
 		return -EINVAL;
 	}
-	res = ip_route_input_slow(skb, daddr, saddr, tos, dev);
+	res = ip_route_input_slow(skb, daddr, saddr, tos, dev, noref);
 	rcu_read_unlock();
 	return res;
 }
@@ -2931,6 +3010,8 @@ static int inet_rtm_getroute(struct sk_buff *in_skb, struct nlmsghdr* nlh, void
 
 	/* Bugfix: need to give ip_route_input enough of an IP header to not gag. */
 	ip_hdr(skb)->protocol = IPPROTO_ICMP;
+	/* No header length, so the reply describes a per-flow route. */
+	ip_hdr(skb)->ihl = 0;
 	skb_reserve(skb, MAX_HEADER + sizeof(struct iphdr));
 
 	src = tb[RTA_SRC] ? nla_get_be32(tb[RTA_SRC]) : 0;
@@ -0,0 +1,139 @@
+/*
+ * TCP Fast Open: cookie generation on the passive side and the cookie
+ * cache used by the active side.
+ *
+ * A client that has been given a cookie by a server may send data in
+ * the SYN of later connections to it, saving one round trip.  The
+ * cookie authenticates the client address, so a server only creates the
+ * connection for data in a SYN whose cookie it has generated itself.
+ */
+
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/cryptohash.h>
+#include <linux/random.h>
+#include <linux/spinlock.h>
+#include <net/inetpeer.h>
+#include <net/tcp.h>
+#if defined(CONFIG_IPV6) || defined(CONFIG_IPV6_MODULE)
+#include <linux/ipv6.h>
+#endif
+
+int sysctl_tcp_fastopen __read_mostly = TFO_CLIENT_ENABLE;
+
+/* Key for cookies, the message is the two addresses followed by it */
+static u32 tcp_fastopen_secret[SHA_MESSAGE_BYTES / 4 - 2] __read_mostly;
+
+/* Serializes tcp_fastopen_* updates in inet_peer */
+static DEFINE_SPINLOCK(tcp_fastopen_cache_lock);
+
+static int __init tcp_fastopen_init(void)
+{
+	get_random_bytes(tcp_fastopen_secret, sizeof(tcp_fastopen_secret));
+	return 0;
+}
+late_initcall(tcp_fastopen_init);
+
+/*
+ * Computes the Fast Open cookie for a client at @saddr connecting to
+ * the local address @daddr.
+ */
+void tcp_fastopen_cookie_gen(__be32 saddr, __be32 daddr,
+			     struct tcp_fastopen_cookie *foc)
+{
+	__u32 workspace[SHA_WORKSPACE_WORDS];
+	__u32 digest[SHA_DIGEST_WORDS];
+	__u32 mess[SHA_MESSAGE_BYTES / 4];
+
+	mess[0] = (__force u32)saddr;
+	mess[1] = (__force u32)daddr;
+	memcpy(&mess[2], tcp_fastopen_secret, sizeof(tcp_fastopen_secret));
+
+	sha_init(digest);
+	sha_transform(digest, (char *)mess, workspace);
+
+	memcpy(foc->val, digest, TCP_FASTOPEN_COOKIE_SIZE);
+	foc->len = TCP_FASTOPEN_COOKIE_SIZE;
+}
+
+static struct inet_peer *tcp_fastopen_peer(struct sock *sk, int create)
+{
+	if (sk->sk_family == AF_INET)
+		return inet_getpeer_v4(inet_sk(sk)->inet_daddr, create);
+#if defined(CONFIG_IPV6) || defined(CONFIG_IPV6_MODULE)
+	if (sk->sk_family == AF_INET6)
+		return inet_getpeer_v6(&inet6_sk(sk)->daddr, create);
+#endif
+	return NULL;
+}
+
+/*
+ * Looks up the cookie and MSS cached for the destination of @sk, and
+ * how many recent SYNs with data to it were lost.  Values that are not
+ * cached are left untouched.
+ */
+void tcp_fastopen_cache_get(struct sock *sk, u16 *mss,
+			    struct tcp_fastopen_cookie *cookie,
+			    int *syn_loss, unsigned long *last_syn_loss)
+{
+	struct inet_peer *peer = tcp_fastopen_peer(sk, 0);
+
+	BUILD_BUG_ON(sizeof(peer->tcp_fastopen_cookie) <
+		     TCP_FASTOPEN_COOKIE_MAX);
+
+	if (!peer)
+		return;
+
+	spin_lock_bh(&tcp_fastopen_cache_lock);
+	if (peer->tcp_fastopen_mss)
+		*mss = peer->tcp_fastopen_mss;
+	if (peer->tcp_fastopen_cookie_len > 0) {
+		cookie->len = peer->tcp_fastopen_cookie_len;
+		memcpy(cookie->val, peer->tcp_fastopen_cookie, cookie->len);
+	}
+	*syn_loss = peer->tcp_fastopen_syn_loss;
+	*last_syn_loss = peer->tcp_fastopen_syn_loss_stamp;
+	spin_unlock_bh(&tcp_fastopen_cache_lock);
+
+	inet_putpeer(peer);
+}
+
+/*
+ * Records what the SYN-ACK to a Fast Open SYN told us: the server MSS,
+ * a new cookie if it sent one, and whether our SYN with data was lost.
+ */
+void tcp_fastopen_cache_set(struct sock *sk, u16 mss,
+			    struct tcp_fastopen_cookie *cookie,
+			    bool syn_lost)
+{
+	struct inet_peer *peer = tcp_fastopen_peer(sk, 1);
+
+	if (!peer)
+		return;
+
+	spin_lock_bh(&tcp_fastopen_cache_lock);
+	if (mss)
+		peer->tcp_fastopen_mss = mss;
+	if (cookie->len > 0) {
+		peer->tcp_fastopen_cookie_len = cookie->len;
+		memcpy(peer->tcp_fastopen_cookie, cookie->val, cookie->len);
+	}
+	if (syn_lost) {
+		if (peer->tcp_fastopen_syn_loss < 0xff)
+			peer->tcp_fastopen_syn_loss++;
+		peer->tcp_fastopen_syn_loss_stamp = jiffies;
+	} else {
+		peer->tcp_fastopen_syn_loss = 0;
+	}
+	spin_unlock_bh(&tcp_fastopen_cache_lock);
+
+	inet_putpeer(peer);
+}
+
+void tcp_free_fastopen_req(struct tcp_sock *tp)
+{
+	if (tp->fastopen_req != NULL) {
+		kfree(tp->fastopen_req);
+		tp->fastopen_req = NULL;
+	}
+}
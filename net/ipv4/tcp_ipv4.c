@@ -756,7 +756,8 @@ static void tcp_v4_reqsk_send_ack(struct sock *sk, struct sk_buff *skb,
  */
 static int tcp_v4_send_synack(struct sock *sk, struct dst_entry *dst,
 			      struct request_sock *req,
-			      struct request_values *rvp)
+			      struct request_values *rvp,
+			      struct tcp_fastopen_cookie *foc)
 {
 	const struct inet_request_sock *ireq = inet_rsk(req);
 	int err = -1;
@@ -766,7 +767,7 @@ static int tcp_v4_send_synack(struct sock *sk, struct dst_entry *dst,
 	if (!dst && (dst = inet_csk_route_req(sk, req)) == NULL)
 		return -1;
 
-	skb = tcp_make_synack(sk, dst, req, rvp);
+	skb = tcp_make_synack(sk, dst, req, rvp, foc);
 
 	if (skb) {
 		__tcp_v4_send_check(skb, ireq->loc_addr, ireq->rmt_addr);
@@ -785,7 +786,112 @@ static int tcp_v4_rtx_synack(struct sock *sk, struct request_sock *req,
 			      struct request_values *rvp)
 {
 	TCP_INC_STATS_BH(sock_net(sk), TCP_MIB_RETRANSSEGS);
-	return tcp_v4_send_synack(sk, NULL, req, rvp);
+	return tcp_v4_send_synack(sk, NULL, req, rvp, NULL);
+}
+
+/*
+ * Decides whether the SYN @skb may open a Fast Open connection.  On
+ * return @valid_foc holds the cookie to send back in the SYN-ACK, if
+ * any: one is sent to clients asking for it or presenting a bad one.
+ */
+static bool tcp_fastopen_check(struct sock *sk, struct sk_buff *skb,
+			       struct tcp_fastopen_cookie *foc,
+			       struct tcp_fastopen_cookie *valid_foc)
+{
+	const struct tcp_sock *tp = tcp_sk(sk);
+	const struct iphdr *iph = ip_hdr(skb);
+	bool syn_data = TCP_SKB_CB(skb)->end_seq != TCP_SKB_CB(skb)->seq + 1;
+
+	if (foc->len < 0 ||
+	    !(sysctl_tcp_fastopen & TFO_SERVER_ENABLE) ||
+	    !tp->fastopen_max_qlen)
+		return false;
+
+	/* Children not accepted yet count against the Fast Open limit */
+	if (sk->sk_ack_backlog >= tp->fastopen_max_qlen ||
+	    sk_acceptq_is_full(sk))
+		return false;
+
+	tcp_fastopen_cookie_gen(iph->saddr, iph->daddr, valid_foc);
+
+	if (foc->len == 0) {
+		NET_INC_STATS_BH(sock_net(sk), LINUX_MIB_TCPFASTOPENCOOKIEREQD);
+		return false;
+	}
+
+	if (foc->len == valid_foc->len &&
+	    !memcmp(foc->val, valid_foc->val, foc->len)) {
+		if (!syn_data || tcp_hdr(skb)->fin)
+			return false;
+		/* The client already holds the right cookie */
+		valid_foc->len = -1;
+		return true;
+	}
+
+	NET_INC_STATS_BH(sock_net(sk), LINUX_MIB_TCPFASTOPENPASSIVEFAIL);
+	return false;
+}
+
+/*
+ * Creates the child socket for a Fast Open SYN right away, queues the
+ * data of the SYN to it and puts it on the accept queue of @sk.  The
+ * child keeps its own copy of @req to retransmit the SYN-ACK from.
+ */
+static int tcp_v4_conn_req_fastopen(struct sock *sk, struct sk_buff *skb,
+				    struct request_sock *req)
+{
+	struct request_sock *rsk;
+	struct tcp_sock *tp;
+	struct sk_buff *skb2;
+	struct sock *child;
+	u32 end_seq = TCP_SKB_CB(skb)->end_seq;
+
+	rsk = inet_reqsk_alloc(&tcp_request_sock_ops);
+	if (!rsk)
+		return -1;
+
+	req->retrans = 0;
+	req->sk = NULL;
+	child = inet_csk(sk)->icsk_af_ops->syn_recv_sock(sk, skb, req, NULL);
+	if (child == NULL) {
+		__reqsk_free(rsk);
+		return -1;
+	}
+
+	/* syn_recv_sock() took over the IP options, nothing left to free */
+	memcpy(rsk, req, sizeof(struct tcp_request_sock));
+	rsk->dl_next = NULL;
+
+	tp = tcp_sk(child);
+	tp->fastopen_rsk = rsk;
+	/* The window of a SYN is never scaled */
+	tp->snd_wnd = ntohs(tcp_hdr(skb)->window);
+	tp->max_window = tp->snd_wnd;
+
+	inet_csk_reqsk_queue_add(sk, req, child);
+
+	skb2 = skb_clone(skb, GFP_ATOMIC);
+	if (skb2) {
+		skb_dst_drop(skb2);
+		__skb_pull(skb2, tcp_hdr(skb)->doff * 4);
+		skb_set_owner_r(skb2, child);
+		__skb_queue_tail(&child->sk_receive_queue, skb2);
+		tp->rcv_nxt = end_seq;
+		tp->rcv_wup = end_seq;
+	} else {
+		/* Ask the client to send the data again */
+		tcp_rsk(req)->rcv_nxt = tcp_rsk(req)->rcv_isn + 1;
+		tcp_rsk(rsk)->rcv_nxt = tcp_rsk(rsk)->rcv_isn + 1;
+	}
+
+	inet_csk_reset_xmit_timer(child, ICSK_TIME_RETRANS,
+				  TCP_TIMEOUT_INIT, TCP_RTO_MAX);
+	NET_INC_STATS_BH(sock_net(sk), LINUX_MIB_TCPFASTOPENPASSIVE);
+
+	sk->sk_data_ready(sk, 0);
+	bh_unlock_sock(child);
+	sock_put(child);
+	return 0;
 }
 
 /*
@@ -1222,6 +1328,9 @@ int tcp_v4_conn_request(struct sock *sk, struct sk_buff *skb)
 	__be32 saddr = ip_hdr(skb)->saddr;
 	__be32 daddr = ip_hdr(skb)->daddr;
 	__u32 isn = TCP_SKB_CB(skb)->when;
+	struct tcp_fastopen_cookie foc = { .len = -1 };
+	struct tcp_fastopen_cookie valid_foc = { .len = -1 };
+	bool fastopen;
 #ifdef CONFIG_SYN_COOKIES
 	int want_cookie = 0;
 #else
@@ -1266,7 +1375,7 @@ int tcp_v4_conn_request(struct sock *sk, struct sk_buff *skb)
 	tcp_clear_options(&tmp_opt);
 	tmp_opt.mss_clamp = TCP_MSS_DEFAULT;
 	tmp_opt.user_mss  = tp->rx_opt.user_mss;
-	tcp_parse_options(skb, &tmp_opt, &hash_location, 0);
+	tcp_parse_options(skb, &tmp_opt, &hash_location, 0, &foc);
 
 	if (tmp_opt.cookie_plus > 0 &&
 	    tmp_opt.saw_tstamp &&
@@ -1372,12 +1481,26 @@ int tcp_v4_conn_request(struct sock *sk, struct sk_buff *skb)
 	}
 	tcp_rsk(req)->snt_isn = isn;
 
+	fastopen = !want_cookie &&
+		   tcp_fastopen_check(sk, skb, &foc, &valid_foc);
+	if (fastopen) {
+		/* The SYN-ACK acknowledges the data queued to the child */
+		tcp_rsk(req)->rcv_nxt = TCP_SKB_CB(skb)->end_seq;
+		if (tcp_v4_conn_req_fastopen(sk, skb, req))
+			goto drop_and_release;
+	}
+
 	if (tcp_v4_send_synack(sk, dst, req,
-			       (struct request_values *)&tmp_ext) ||
-	    want_cookie)
-		goto drop_and_free;
+			       (struct request_values *)&tmp_ext,
+			       &valid_foc) ||
+	    want_cookie) {
+		if (!fastopen)
+			goto drop_and_free;
+		return 0;
+	}
 
-	inet_csk_reqsk_queue_hash_add(sk, req, TCP_TIMEOUT_INIT);
+	if (!fastopen)
+		inet_csk_reqsk_queue_hash_add(sk, req, TCP_TIMEOUT_INIT);
 	return 0;
 
 drop_and_release:
@@ -1737,6 +1860,7 @@ do_time_wait:
 	case TCP_TW_SYN: {
 		struct sock *sk2 = inet_lookup_listener(dev_net(skb->dev),
 							&tcp_hashinfo,
+							iph->saddr, th->source,
 							iph->daddr, th->dest,
 							inet_iif(skb));
 		if (sk2) {
@@ -1937,6 +2061,13 @@ void tcp_v4_destroy_sock(struct sock *sk)
 		tp->cookie_values = NULL;
 	}
 
+	/* TCP Fast Open */
+	tcp_free_fastopen_req(tp);
+	if (tp->fastopen_rsk != NULL) {
+		reqsk_free(tp->fastopen_rsk);
+		tp->fastopen_rsk = NULL;
+	}
+
 	percpu_counter_dec(&tcp_sockets_allocated);
 }
 EXPORT_SYMBOL(tcp_v4_destroy_sock);
@@ -2574,6 +2705,7 @@ struct proto tcp_prot = {
 	.sendmsg		= tcp_sendmsg,
 	.sendpage		= tcp_sendpage,
 	.backlog_rcv		= tcp_v4_do_rcv,
+	.release_cb		= tcp_release_cb,
 	.hash			= inet_hash,
 	.unhash			= inet_unhash,
 	.get_port		= inet_csk_get_port,
@@ -216,6 +216,51 @@ static ssize_t ieee80211_if_parse_smps(struct ieee80211_sub_if_data *sdata,
 
 __IEEE80211_IF_FILE_W(smps);
 
+IEEE80211_IF_FMT(tx_coalesce_ms, u.mgd.tx_coalesce_ms, "%u\n");
+
+static ssize_t ieee80211_if_parse_tx_coalesce_ms(
+	struct ieee80211_sub_if_data *sdata, const char *buf, int buflen)
+{
+	unsigned long val;
+	char tmp[10];
+	int len;
+
+	len = min_t(int, buflen, sizeof(tmp) - 1);
+	memcpy(tmp, buf, len);
+	tmp[len] = '\0';
+
+	if (strict_strtoul(strim(tmp), 0, &val))
+		return -EINVAL;
+
+	/* a few beacon intervals at most */
+	if (val > 1000)
+		return -ERANGE;
+
+	sdata->u.mgd.tx_coalesce_ms = val;
+	return buflen;
+}
+
+__IEEE80211_IF_FILE_W(tx_coalesce_ms);
+
+IEEE80211_IF_FMT(ps_wakeups, u.mgd.ps_wakeups, "%u\n");
+__IEEE80211_IF_FILE(ps_wakeups, NULL);
+IEEE80211_IF_FMT(ps_tx_deferred, u.mgd.ps_tx_deferred, "%u\n");
+__IEEE80211_IF_FILE(ps_tx_deferred, NULL);
+
+static ssize_t ieee80211_if_fmt_ps_awake_ms(
+	const struct ieee80211_sub_if_data *sdata, char *buf, int buflen)
+{
+	const struct ieee80211_if_managed *ifmgd = &sdata->u.mgd;
+	unsigned int awake = ifmgd->ps_awake_ms;
+
+	/* include the current wakeup */
+	if (ifmgd->ps_awake_since)
+		awake += jiffies_to_msecs(jiffies - ifmgd->ps_awake_since);
+
+	return scnprintf(buf, buflen, "%u\n", awake);
+}
+__IEEE80211_IF_FILE(ps_awake_ms, NULL);
+
 /* AP attributes */
 IEEE80211_IF_FILE(num_sta_ps, u.ap.num_sta_ps, ATOMIC);
 IEEE80211_IF_FILE(dtim_count, u.ap.dtim_count, DEC);
@@ -291,6 +336,10 @@ static void add_sta_files(struct ieee80211_sub_if_data *sdata)
 	DEBUGFS_ADD(last_beacon);
 	DEBUGFS_ADD(ave_beacon);
 	DEBUGFS_ADD_MODE(smps, 0600);
+	DEBUGFS_ADD_MODE(tx_coalesce_ms, 0600);
+	DEBUGFS_ADD(ps_awake_ms);
+	DEBUGFS_ADD(ps_wakeups);
+	DEBUGFS_ADD(ps_tx_deferred);
 }
 
 static void add_ap_files(struct ieee80211_sub_if_data *sdata)
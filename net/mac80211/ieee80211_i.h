@@ -416,6 +416,19 @@ struct ieee80211_if_managed {
 	 * generated for the current association.
 	 */
 	int last_cqm_event_signal;
+
+	/*
+	 * While power save is active, frames are held back for up to
+	 * tx_coalesce_ms (0 disables this) and sent together when the
+	 * radio wakes up for the next beacon.
+	 */
+	unsigned int tx_coalesce_ms;
+
+	/* power save statistics, updated by ieee80211_ps_update_stats() */
+	unsigned long ps_awake_since; /* jiffies, 0 while dozing */
+	unsigned int ps_awake_ms;
+	unsigned int ps_wakeups;
+	unsigned int ps_tx_deferred;
 };
 
 struct ieee80211_if_ibss {
@@ -926,6 +939,9 @@ struct ieee80211_local {
 	struct work_struct dynamic_ps_enable_work;
 	struct work_struct dynamic_ps_disable_work;
 	struct timer_list dynamic_ps_timer;
+	/* frames are held back until the next wakeup, see tx_coalesce_ms */
+	struct timer_list ps_tx_coalesce_timer;
+	bool ps_tx_coalescing;
 	struct notifier_block network_latency_notifier;
 	struct notifier_block ifa_notifier;
 
@@ -1291,6 +1307,10 @@ u32 ieee80211_mandatory_rates(struct ieee80211_local *local,
 void ieee80211_dynamic_ps_enable_work(struct work_struct *work);
 void ieee80211_dynamic_ps_disable_work(struct work_struct *work);
 void ieee80211_dynamic_ps_timer(unsigned long data);
+void ieee80211_ps_tx_coalesce_timer(unsigned long data);
+void ieee80211_ps_tx_release(struct ieee80211_local *local);
+void ieee80211_ps_tx_coalesce_stop(struct ieee80211_local *local);
+void ieee80211_ps_update_stats(struct ieee80211_local *local);
 void ieee80211_send_nullfunc(struct ieee80211_local *local,
 			     struct ieee80211_sub_if_data *sdata,
 			     int powersave);
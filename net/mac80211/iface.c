@@ -444,6 +444,7 @@ static void ieee80211_do_stop(struct ieee80211_sub_if_data *sdata,
 
 	del_timer_sync(&local->dynamic_ps_timer);
 	cancel_work_sync(&local->dynamic_ps_enable_work);
+	ieee80211_ps_tx_coalesce_stop(local);
 
 	/* APs need special treatment */
 	if (sdata->vif.type == NL80211_IFTYPE_AP) {
@@ -180,6 +180,9 @@ int ieee80211_hw_config(struct ieee80211_local *local, u32 changed)
 		/* WARN_ON(ret); */
 	}
 
+	if (changed & IEEE80211_CONF_CHANGE_PS)
+		ieee80211_ps_update_stats(local);
+
 	return ret;
 }
 
@@ -597,6 +600,8 @@ struct ieee80211_hw *ieee80211_alloc_hw(size_t priv_data_len,
 		  ieee80211_dynamic_ps_disable_work);
 	setup_timer(&local->dynamic_ps_timer,
 		    ieee80211_dynamic_ps_timer, (unsigned long) local);
+	setup_timer(&local->ps_tx_coalesce_timer,
+		    ieee80211_ps_tx_coalesce_timer, (unsigned long) local);
 
 	sta_info_init(local);
 
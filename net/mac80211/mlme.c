@@ -577,6 +577,7 @@ static void ieee80211_change_ps(struct ieee80211_local *local)
 		ieee80211_hw_config(local, IEEE80211_CONF_CHANGE_PS);
 		del_timer_sync(&local->dynamic_ps_timer);
 		cancel_work_sync(&local->dynamic_ps_enable_work);
+		ieee80211_ps_tx_coalesce_stop(local);
 	}
 }
 
@@ -675,6 +676,8 @@ void ieee80211_dynamic_ps_disable_work(struct work_struct *work)
 		container_of(work, struct ieee80211_local,
 			     dynamic_ps_disable_work);
 
+	local->ps_tx_coalescing = false;
+
 	if (local->hw.conf.flags & IEEE80211_CONF_PS) {
 		local->hw.conf.flags &= ~IEEE80211_CONF_PS;
 		ieee80211_hw_config(local, IEEE80211_CONF_CHANGE_PS);
@@ -722,6 +725,62 @@ void ieee80211_dynamic_ps_timer(unsigned long data)
 	ieee80211_queue_work(&local->hw, &local->dynamic_ps_enable_work);
 }
 
+void ieee80211_ps_tx_coalesce_timer(unsigned long data)
+{
+	struct ieee80211_local *local = (void *) data;
+
+	if (local->quiescing || local->suspended)
+		return;
+
+	/* no beacon woke us up in time, send the held frames now */
+	ieee80211_queue_work(&local->hw, &local->dynamic_ps_disable_work);
+}
+
+/* The radio is awake for a beacon, send the held frames with it. */
+void ieee80211_ps_tx_release(struct ieee80211_local *local)
+{
+	if (!local->ps_tx_coalescing)
+		return;
+
+	del_timer(&local->ps_tx_coalesce_timer);
+	ieee80211_queue_work(&local->hw, &local->dynamic_ps_disable_work);
+}
+
+/* Power save is going away, stop holding frames back. */
+void ieee80211_ps_tx_coalesce_stop(struct ieee80211_local *local)
+{
+	del_timer_sync(&local->ps_tx_coalesce_timer);
+
+	if (local->ps_tx_coalescing) {
+		local->ps_tx_coalescing = false;
+		ieee80211_wake_queues_by_reason(&local->hw,
+					IEEE80211_QUEUE_STOP_REASON_PS);
+	}
+}
+
+/* Account awake time of the power save interface, called on PS changes. */
+void ieee80211_ps_update_stats(struct ieee80211_local *local)
+{
+	struct ieee80211_sub_if_data *sdata = local->ps_sdata;
+	struct ieee80211_if_managed *ifmgd;
+
+	if (!sdata)
+		return;
+
+	ifmgd = &sdata->u.mgd;
+
+	if (!(local->hw.conf.flags & IEEE80211_CONF_PS)) {
+		if (!ifmgd->ps_awake_since) {
+			ifmgd->ps_awake_since = jiffies ? : 1;
+			ifmgd->ps_wakeups++;
+		}
+	} else if (ifmgd->ps_awake_since) {
+		ifmgd->ps_awake_ms +=
+			jiffies_to_msecs(jiffies - ifmgd->ps_awake_since);
+		ifmgd->ps_awake_since = 0;
+	}
+}
+
 /* MLME */
 static void ieee80211_sta_wmm_params(struct ieee80211_local *local,
 				     struct ieee80211_sub_if_data *sdata,
@@ -992,6 +1051,7 @@ static void ieee80211_set_disassoc(struct ieee80211_sub_if_data *sdata,
 
 	del_timer_sync(&local->dynamic_ps_timer);
 	cancel_work_sync(&local->dynamic_ps_enable_work);
+	ieee80211_ps_tx_coalesce_stop(local);
 
 	if (local->hw.conf.flags & IEEE80211_CONF_PS) {
 		local->hw.conf.flags &= ~IEEE80211_CONF_PS;
@@ -1709,6 +1769,9 @@ static void ieee80211_rx_mgmt_beacon(struct ieee80211_sub_if_data *sdata,
 	 */
 	ieee80211_sta_reset_beacon_monitor(sdata);
 
+	if (local->ps_sdata == sdata)
+		ieee80211_ps_tx_release(local);
+
 	ncrc = crc32_be(0, (void *)&mgmt->u.beacon.beacon_int, 4);
 	ncrc = ieee802_11_parse_elems_crc(mgmt->u.beacon.variable,
 					  len - baselen, &elems,
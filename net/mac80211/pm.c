@@ -35,6 +35,7 @@ int __ieee80211_suspend(struct ieee80211_hw *hw)
 	 */
 	cancel_work_sync(&local->dynamic_ps_enable_work);
 	del_timer_sync(&local->dynamic_ps_timer);
+	ieee80211_ps_tx_coalesce_stop(local);
 
 	/* disable keys */
 	list_for_each_entry(sdata, &local->interfaces, list)
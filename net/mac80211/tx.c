@@ -236,8 +236,21 @@ ieee80211_tx_h_dynamic_ps(struct ieee80211_tx_data *tx)
 	if (local->hw.conf.flags & IEEE80211_CONF_PS) {
 		ieee80211_stop_queues_by_reason(&local->hw,
 						IEEE80211_QUEUE_STOP_REASON_PS);
-		ieee80211_queue_work(&local->hw,
-				     &local->dynamic_ps_disable_work);
+		/*
+		 * Hold the frames back until the radio wakes up for the
+		 * next beacon anyway, so that a burst of small frames costs
+		 * a single wakeup. Voice frames are never delayed.
+		 */
+		if (ifmgd->tx_coalesce_ms && skb_get_queue_mapping(tx->skb)) {
+			ifmgd->ps_tx_deferred++;
+			if (!local->ps_tx_coalescing) {
+				local->ps_tx_coalescing = true;
+				mod_timer(&local->ps_tx_coalesce_timer, jiffies +
+					  msecs_to_jiffies(ifmgd->tx_coalesce_ms));
+			}
+		} else
+			ieee80211_queue_work(&local->hw,
+					     &local->dynamic_ps_disable_work);
 	}
 
 	mod_timer(&local->dynamic_ps_timer, jiffies +
@@ -193,6 +193,8 @@ static struct rpc_clnt * rpc_new_client(const struct rpc_create_args *args, stru
 	strlcpy(clnt->cl_server, args->servername, len);
 
 	clnt->cl_xprt     = xprt;
+	clnt->cl_xprts[0] = xprt;
+	clnt->cl_nxprts   = 1;
 	clnt->cl_procinfo = version->procs;
 	clnt->cl_maxproc  = version->nrprocs;
 	clnt->cl_protname = program->name;
@@ -283,6 +285,7 @@ struct rpc_clnt *rpc_create(struct rpc_create_args *args)
 {
 	struct rpc_xprt *xprt;
 	struct rpc_clnt *clnt;
+	unsigned int i;
 	struct xprt_create xprtargs = {
 		.net = args->net,
 		.ident = args->protocol,
@@ -340,6 +343,22 @@ struct rpc_clnt *rpc_create(struct rpc_create_args *args)
 	if (IS_ERR(clnt))
 		return clnt;
 
+	/*
+	 * Open any additional transports to the same server.  Tasks are
+	 * spread over them by rpc_task_pick_xprt(); failing to open one
+	 * just leaves the client with fewer.
+	 */
+	for (i = 1; i < args->nconnect && i < RPC_MAX_XPRTS; i++) {
+		xprt = xprt_create_transport(&xprtargs);
+		if (IS_ERR(xprt)) {
+			dprintk("RPC:       %s: transport %u: error %ld\n",
+					__func__, i, PTR_ERR(xprt));
+			break;
+		}
+		xprt->resvport = clnt->cl_xprt->resvport;
+		clnt->cl_xprts[clnt->cl_nxprts++] = xprt;
+	}
+
 	if (!(args->flags & RPC_CLNT_CREATE_NOPING)) {
 		int err = rpc_ping(clnt);
 		if (err != 0) {
@@ -372,6 +391,7 @@ struct rpc_clnt *
 rpc_clone_client(struct rpc_clnt *clnt)
 {
 	struct rpc_clnt *new;
+	unsigned int i;
 	int err = -ENOMEM;
 
 	new = kmemdup(clnt, sizeof(*new), GFP_KERNEL);
@@ -397,7 +417,8 @@ rpc_clone_client(struct rpc_clnt *clnt)
 		goto out_no_path;
 	if (new->cl_auth)
 		atomic_inc(&new->cl_auth->au_count);
-	xprt_get(clnt->cl_xprt);
+	for (i = 0; i < clnt->cl_nxprts; i++)
+		xprt_get(clnt->cl_xprts[i]);
 	atomic_inc(&clnt->cl_count);
 	rpc_register_client(new);
 	rpciod_up();
@@ -470,6 +491,8 @@ EXPORT_SYMBOL_GPL(rpc_shutdown_client);
 static void
 rpc_free_client(struct rpc_clnt *clnt)
 {
+	unsigned int i;
+
 	dprintk("RPC:       destroying %s client for %s\n",
 			clnt->cl_protname, clnt->cl_server);
 	if (!IS_ERR(clnt->cl_path.dentry)) {
@@ -487,7 +510,8 @@ out_free:
 	rpc_free_iostats(clnt->cl_metrics);
 	kfree(clnt->cl_principal);
 	clnt->cl_metrics = NULL;
-	xprt_put(clnt->cl_xprt);
+	for (i = 0; i < clnt->cl_nxprts; i++)
+		xprt_put(clnt->cl_xprts[i]);
 	rpciod_down();
 	kfree(clnt);
 }
@@ -583,12 +607,36 @@ void rpc_task_release_client(struct rpc_task *task)
 	}
 }
 
+/*
+ * Pick the transport with the fewest requests in progress, starting the
+ * search at a different transport each time so that ties are broken
+ * round-robin.
+ */
+static struct rpc_xprt *rpc_task_pick_xprt(struct rpc_clnt *clnt)
+{
+	struct rpc_xprt *xprt, *best;
+	unsigned int i, start, n = clnt->cl_nxprts;
+
+	if (n <= 1)
+		return clnt->cl_xprt;
+
+	start = atomic_inc_return(&clnt->cl_xprt_rotor);
+	best = clnt->cl_xprts[start % n];
+	for (i = 1; i < n; i++) {
+		xprt = clnt->cl_xprts[(start + i) % n];
+		if (xprt->slots_used < best->slots_used)
+			best = xprt;
+	}
+	return best;
+}
+
 static
 void rpc_task_set_client(struct rpc_task *task, struct rpc_clnt *clnt)
 {
 	if (clnt != NULL) {
 		rpc_task_release_client(task);
 		task->tk_client = clnt;
+		task->tk_xprt = rpc_task_pick_xprt(clnt);
 		atomic_inc(&clnt->cl_count);
 		if (clnt->cl_softrtry)
 			task->tk_flags |= RPC_TASK_SOFT;
@@ -832,8 +880,11 @@ EXPORT_SYMBOL_GPL(rpc_max_payload);
  */
 void rpc_force_rebind(struct rpc_clnt *clnt)
 {
+	unsigned int i;
+
 	if (clnt->cl_autobind)
-		xprt_clear_bound(clnt->cl_xprt);
+		for (i = 0; i < clnt->cl_nxprts; i++)
+			xprt_clear_bound(clnt->cl_xprts[i]);
 }
 EXPORT_SYMBOL_GPL(rpc_force_rebind);
 
@@ -536,7 +536,7 @@ void rpcb_getport_async(struct rpc_task *task)
 	int status;
 
 	clnt = rpcb_find_transport_owner(task->tk_client);
-	xprt = clnt->cl_xprt;
+	xprt = task->tk_xprt;
 
 	dprintk("RPC: %5u %s(%s, %u, %u, %d)\n",
 		task->tk_pid, __func__,
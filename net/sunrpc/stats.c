@@ -180,7 +180,7 @@ void rpc_print_iostats(struct seq_file *seq, struct rpc_clnt *clnt)
 {
 	struct rpc_iostats *stats = clnt->cl_metrics;
 	struct rpc_xprt *xprt = clnt->cl_xprt;
-	unsigned int op, maxproc = clnt->cl_maxproc;
+	unsigned int i, op, maxproc = clnt->cl_maxproc;
 
 	if (!stats)
 		return;
@@ -192,6 +192,14 @@ void rpc_print_iostats(struct seq_file *seq, struct rpc_clnt *clnt)
 	if (xprt)
 		xprt->ops->print_stats(xprt, seq);
 
+	/* index, slots in use now, most slots ever in use, sends */
+	for (i = 0; i < clnt->cl_nxprts; i++) {
+		xprt = clnt->cl_xprts[i];
+		seq_printf(seq, "\txprtq:\t%u %u %u %lu\n", i,
+				xprt->slots_used, xprt->stat.max_slots_used,
+				xprt->stat.sends);
+	}
+
 	seq_printf(seq, "\tper-op statistics\n");
 	for (op = 0; op < maxproc; op++) {
 		struct rpc_iostats *metrics = &stats[op];
@@ -939,6 +939,8 @@ static void xprt_alloc_slot(struct rpc_task *task)
 		struct rpc_rqst	*req = list_entry(xprt->free.next, struct rpc_rqst, rq_list);
 		list_del_init(&req->rq_list);
 		task->tk_rqstp = req;
+		if (++xprt->slots_used > xprt->stat.max_slots_used)
+			xprt->stat.max_slots_used = xprt->slots_used;
 		xprt_request_init(task, xprt);
 		return;
 	}
@@ -954,6 +956,7 @@ static void xprt_free_slot(struct rpc_xprt *xprt, struct rpc_rqst *req)
 
 	spin_lock(&xprt->reserve_lock);
 	list_add(&req->rq_list, &xprt->free);
+	xprt->slots_used--;
 	rpc_wake_up_next(&xprt->backlog);
 	spin_unlock(&xprt->reserve_lock);
 }
@@ -22,6 +22,8 @@
 #include <linux/init.h>
 #include <linux/skbuff.h>
 #include <linux/percpu.h>
+#include <linux/jhash.h>
+#include <linux/log2.h>
 #include <net/sock.h>
 #include <linux/un.h>
 #include <net/af_unix.h>
@@ -33,16 +35,13 @@
 #include "avc_ss.h"
 #include "classmap.h"
 
-#define AVC_CACHE_SLOTS			512
+#define AVC_DEF_CACHE_SLOTS		512
+#define AVC_MAX_CACHE_SLOTS		65536
 #define AVC_DEF_CACHE_THRESHOLD		512
 #define AVC_CACHE_RECLAIM		16
 
 #ifdef CONFIG_SECURITY_SELINUX_AVC_STATS
-#define avc_cache_stats_incr(field)				\
-do {								\
-	per_cpu(avc_cache_stats, get_cpu()).field++;		\
-	put_cpu();						\
-} while (0)
+#define avc_cache_stats_incr(field)	this_cpu_inc(avc_cache_stats.field)
 #else
 #define avc_cache_stats_incr(field)	do {} while (0)
 #endif
@@ -61,8 +60,9 @@ struct avc_node {
 };
 
 struct avc_cache {
-	struct hlist_head	slots[AVC_CACHE_SLOTS]; /* head for avc_node->list */
-	spinlock_t		slots_lock[AVC_CACHE_SLOTS]; /* lock for writes */
+	struct hlist_head	*slots; /* head for avc_node->list */
+	spinlock_t		*slots_lock; /* lock for writes */
+	unsigned int		nr_slots; /* power of two */
 	atomic_t		lru_hint;	/* LRU hint for reclaim scan */
 	atomic_t		active_nodes;
 	u32			latest_notif;	/* latest revocation notification */
@@ -91,9 +91,31 @@ static struct avc_cache avc_cache;
 static struct avc_callback_node *avc_callbacks;
 static struct kmem_cache *avc_node_cachep;
 
+/*
+ * Number of hash slots, set with avc_cache_slots= on the command line.
+ * A larger table also raises the default cache threshold to match.
+ */
+static unsigned int avc_cache_slots __initdata = AVC_DEF_CACHE_SLOTS;
+
+static int __init avc_cache_slots_setup(char *str)
+{
+	unsigned long slots;
+
+	if (!strict_strtoul(str, 0, &slots) && slots)
+		avc_cache_slots = roundup_pow_of_two(min_t(unsigned long, slots,
+						AVC_MAX_CACHE_SLOTS));
+	return 1;
+}
+__setup("avc_cache_slots=", avc_cache_slots_setup);
+
+/*
+ * SIDs are small, densely allocated integers, so the shift-and-xor that
+ * used to be here put most source/target pairs of a policy into a few
+ * chains.  jhash spreads them over the whole table.
+ */
 static inline int avc_hash(u32 ssid, u32 tsid, u16 tclass)
 {
-	return (ssid ^ (tsid<<2) ^ (tclass<<4)) & (AVC_CACHE_SLOTS - 1);
+	return jhash_3words(ssid, tsid, tclass, 0) & (avc_cache.nr_slots - 1);
 }
 
 /**
@@ -172,7 +194,18 @@ void __init avc_init(void)
 {
 	int i;
 
-	for (i = 0; i < AVC_CACHE_SLOTS; i++) {
+	avc_cache.nr_slots = avc_cache_slots;
+	avc_cache.slots = kmalloc(avc_cache.nr_slots * sizeof(struct hlist_head),
+				  GFP_KERNEL);
+	avc_cache.slots_lock = kmalloc(avc_cache.nr_slots * sizeof(spinlock_t),
+				       GFP_KERNEL);
+	if (!avc_cache.slots || !avc_cache.slots_lock)
+		panic("SELinux: cannot allocate %u AVC slots\n",
+		      avc_cache.nr_slots);
+	if (avc_cache.nr_slots > avc_cache_threshold)
+		avc_cache_threshold = avc_cache.nr_slots;
+
+	for (i = 0; i < avc_cache.nr_slots; i++) {
 		INIT_HLIST_HEAD(&avc_cache.slots[i]);
 		spin_lock_init(&avc_cache.slots_lock[i]);
 	}
@@ -195,7 +228,7 @@ int avc_get_hash_stats(char *page)
 
 	slots_used = 0;
 	max_chain_len = 0;
-	for (i = 0; i < AVC_CACHE_SLOTS; i++) {
+	for (i = 0; i < avc_cache.nr_slots; i++) {
 		head = &avc_cache.slots[i];
 		if (!hlist_empty(head)) {
 			struct hlist_node *next;
@@ -214,7 +247,7 @@ int avc_get_hash_stats(char *page)
 	return scnprintf(page, PAGE_SIZE, "entries: %d\nbuckets used: %d/%d\n"
 			 "longest chain: %d\n",
 			 atomic_read(&avc_cache.active_nodes),
-			 slots_used, AVC_CACHE_SLOTS, max_chain_len);
+			 slots_used, avc_cache.nr_slots, max_chain_len);
 }
 
 static void avc_node_free(struct rcu_head *rhead)
@@ -254,8 +287,9 @@ static inline int avc_reclaim_node(void)
 	struct hlist_node *next;
 	spinlock_t *lock;
 
-	for (try = 0, ecx = 0; try < AVC_CACHE_SLOTS; try++) {
-		hvalue = atomic_inc_return(&avc_cache.lru_hint) & (AVC_CACHE_SLOTS - 1);
+	for (try = 0, ecx = 0; try < avc_cache.nr_slots; try++) {
+		hvalue = atomic_inc_return(&avc_cache.lru_hint) &
+			(avc_cache.nr_slots - 1);
 		head = &avc_cache.slots[hvalue];
 		lock = &avc_cache.slots_lock[hvalue];
 
@@ -675,7 +709,7 @@ static void avc_flush(void)
 	unsigned long flag;
 	int i;
 
-	for (i = 0; i < AVC_CACHE_SLOTS; i++) {
+	for (i = 0; i < avc_cache.nr_slots; i++) {
 		head = &avc_cache.slots[i];
 		lock = &avc_cache.slots_lock[i];
 
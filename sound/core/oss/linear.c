@@ -37,6 +37,8 @@ struct linear_priv {
 	unsigned int dst_bytes;		/* byte size of destination format */
 	unsigned int copy_bytes;	/* bytes to copy per conversion */
 	unsigned int flip; /* MSB flip for signeness, done after endian conv */
+	int s16x2;		/* 16 to 16 bit, can convert two samples per word */
+	u32 flip16x2;		/* sign flip for a pair of destination samples */
 };
 
 static inline void do_convert(struct linear_priv *data,
@@ -52,6 +54,57 @@ static inline void do_convert(struct linear_priv *data,
 	memcpy(dst, p + data->dst_ofs, data->dst_bytes);
 }
 
+static inline u32 swab16x2(u32 x)
+{
+#if defined(CONFIG_ARM) && __LINUX_ARM_ARCH__ >= 6
+	asm("rev16	%0, %1" : "=r" (x) : "r" (x));
+	return x;
+#else
+	return ((x & 0x00ff00ff) << 8) | ((x >> 8) & 0x00ff00ff);
+#endif
+}
+
+/*
+ * Fast path for 16 bit to 16 bit conversions on interleaved buffers: the
+ * whole transfer is one array of samples, converted a word at a time.
+ */
+static void convert_s16x2(struct linear_priv *data,
+			  const struct snd_pcm_plugin_channel *src_channels,
+			  struct snd_pcm_plugin_channel *dst_channels,
+			  unsigned int nchannels, snd_pcm_uframes_t frames)
+{
+	const u32 *src = src_channels[0].area.addr;
+	u32 *dst = dst_channels[0].area.addr;
+	size_t samples = frames * nchannels;
+	size_t words = samples / 2;
+	unsigned int channel;
+
+	for (channel = 0; channel < nchannels; channel++)
+		dst_channels[channel].enabled = 1;
+	if (data->cvt_endian) {
+		while (words-- > 0)
+			*dst++ = swab16x2(*src++) ^ data->flip16x2;
+	} else {
+		while (words-- > 0)
+			*dst++ = *src++ ^ data->flip16x2;
+	}
+	if (samples & 1)
+		do_convert(data, (unsigned char *)dst, (unsigned char *)src);
+}
+
+static int linear_s16x2_ok(const struct snd_pcm_plugin_channel *channels,
+			   unsigned int nchannels, int check_enabled)
+{
+	unsigned int channel;
+
+	if (check_enabled)
+		for (channel = 0; channel < nchannels; channel++)
+			if (!channels[channel].enabled)
+				return 0;
+	return snd_pcm_plugin_channels_interleaved(channels, nchannels, 16) &&
+	       !((unsigned long)channels[0].area.addr & 3);
+}
+
 static void convert(struct snd_pcm_plugin *plugin,
 		    const struct snd_pcm_plugin_channel *src_channels,
 		    struct snd_pcm_plugin_channel *dst_channels,
@@ -60,6 +113,12 @@ static void convert(struct snd_pcm_plugin *plugin,
 	struct linear_priv *data = (struct linear_priv *)plugin->extra_data;
 	int channel;
 	int nchannels = plugin->src_format.channels;
+	if (data->s16x2 &&
+	    linear_s16x2_ok(src_channels, nchannels, 1) &&
+	    linear_s16x2_ok(dst_channels, nchannels, 0)) {
+		convert_s16x2(data, src_channels, dst_channels, nchannels, frames);
+		return;
+	}
 	for (channel = 0; channel < nchannels; ++channel) {
 		char *src;
 		char *dst;
@@ -144,6 +203,16 @@ static void init_data(struct linear_priv *data, int src_format, int dst_format)
 		else
 			data->flip = cpu_to_be32(0x80000000);
 	}
+	if (src_bytes == 2 && dst_bytes == 2 &&
+	    snd_pcm_format_physical_width(src_format) == 16 &&
+	    snd_pcm_format_physical_width(dst_format) == 16) {
+		u16 flip16 = 0;
+
+		if (data->flip)
+			flip16 = dst_le ? cpu_to_le16(0x8000) : cpu_to_be16(0x8000);
+		data->s16x2 = 1;
+		data->flip16x2 = flip16 | ((u32)flip16 << 16);
+	}
 }
 
 int snd_pcm_plugin_build_linear(struct snd_pcm_substream *plug,
@@ -750,3 +750,22 @@ int snd_pcm_area_copy(const struct snd_pcm_channel_area *src_area, size_t src_of
 	}
 	return 0;
 }
+
+/*
+ * Check whether the channels are interleaved frame by frame in a single
+ * buffer without padding, so that the whole transfer can be treated as
+ * one array of samples.  width is the physical sample width in bits.
+ */
+int snd_pcm_plugin_channels_interleaved(const struct snd_pcm_plugin_channel *channels,
+					unsigned int nchannels, unsigned int width)
+{
+	unsigned int channel;
+
+	for (channel = 0; channel < nchannels; channel++) {
+		if (channels[channel].area.addr != channels[0].area.addr ||
+		    channels[channel].area.first != channel * width ||
+		    channels[channel].area.step != nchannels * width)
+			return 0;
+	}
+	return 1;
+}
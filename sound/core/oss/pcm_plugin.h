@@ -152,6 +152,8 @@ int snd_pcm_area_copy(const struct snd_pcm_channel_area *src_channel,
 		      const struct snd_pcm_channel_area *dst_channel,
 		      size_t dst_offset,
 		      size_t samples, int format);
+int snd_pcm_plugin_channels_interleaved(const struct snd_pcm_plugin_channel *channels,
+					unsigned int nchannels, unsigned int width);
 
 void *snd_pcm_plug_buf_alloc(struct snd_pcm_substream *plug, snd_pcm_uframes_t size);
 void snd_pcm_plug_buf_unlock(struct snd_pcm_substream *plug, void *ptr);
@@ -46,6 +46,7 @@ struct rate_priv {
 	unsigned int pitch;
 	unsigned int pos;
 	rate_f func;
+	rate_f func_s16x2;	/* interleaved stereo variant of func */
 	snd_pcm_sframes_t old_src_frames, old_dst_frames;
 	struct rate_channel channels[0];
 };
@@ -61,13 +62,60 @@ static void rate_init(struct snd_pcm_plugin *plugin)
 	}
 }
 
+/*
+ * Linear interpolation between S1 and S2 at pos / BITS.  The result is a
+ * weighted average of the two samples, so it cannot leave the S16 range.
+ * The packed stereo variant below must give bit-identical results.
+ */
+static inline signed short rate_interp(signed short S1, signed short S2,
+				       unsigned int pos)
+{
+	return (S1 * (signed int)(BITS - pos) + S2 * (signed int)pos) >> SHIFT;
+}
+
+/*
+ * Interleaved S16 stereo frames are handled as one 32-bit word each, both
+ * channels at once.  Each channel stays in its own halfword, so nothing
+ * here depends on the byte order.
+ */
+union rate_frame {
+	u32 both;
+	signed short ch[2];
+};
+
+static inline u32 rate_interp_s16x2(u32 S1, u32 S2, unsigned int pos)
+{
+#if defined(CONFIG_ARM) && __LINUX_ARM_ARCH__ >= 6
+	u32 coef = (pos << 16) | (BITS - pos);
+	u32 lo, hi;
+	s32 l, h;
+
+	/* regroup as (S1, S2) pairs per channel, then one dual MAC each */
+	asm("pkhbt	%0, %1, %2, lsl #16" : "=r" (lo) : "r" (S1), "r" (S2));
+	asm("pkhtb	%0, %2, %1, asr #16" : "=r" (hi) : "r" (S1), "r" (S2));
+	asm("smuad	%0, %1, %2" : "=r" (l) : "r" (lo), "r" (coef));
+	asm("smuad	%0, %1, %2" : "=r" (h) : "r" (hi), "r" (coef));
+	l >>= SHIFT;
+	asm("pkhbt	%0, %1, %2, lsl %3"
+	    : "=r" (lo) : "r" (l), "r" (h), "i" (16 - SHIFT));
+	return lo;
+#else
+	union rate_frame a, b, r;
+
+	a.both = S1;
+	b.both = S2;
+	r.ch[0] = rate_interp(a.ch[0], b.ch[0], pos);
+	r.ch[1] = rate_interp(a.ch[1], b.ch[1], pos);
+	return r.both;
+#endif
+}
+
 static void resample_expand(struct snd_pcm_plugin *plugin,
 			    const struct snd_pcm_plugin_channel *src_channels,
 			    struct snd_pcm_plugin_channel *dst_channels,
 			    int src_frames, int dst_frames)
 {
 	unsigned int pos = 0;
-	signed int val;
 	signed short S1, S2;
 	signed short *src, *dst;
 	unsigned int channel;
@@ -104,12 +152,7 @@ static void resample_expand(struct snd_pcm_plugin *plugin,
 					src += src_step;
 				}
 			}
-			val = S1 + ((S2 - S1) * (signed int)pos) / BITS;
-			if (val < -32768)
-				val = -32768;
-			else if (val > 32767)
-				val = 32767;
-			*dst = val;
+			*dst = rate_interp(S1, S2, pos);
 			dst += dst_step;
 			pos += data->pitch;
 		}
@@ -126,7 +169,6 @@ static void resample_shrink(struct snd_pcm_plugin *plugin,
 			    int src_frames, int dst_frames)
 {
 	unsigned int pos = 0;
-	signed int val;
 	signed short S1, S2;
 	signed short *src, *dst;
 	unsigned int channel;
@@ -162,12 +204,7 @@ static void resample_shrink(struct snd_pcm_plugin *plugin,
 			}
 			if (pos & ~R_MASK) {
 				pos &= R_MASK;
-				val = S1 + ((S2 - S1) * (signed int)pos) / BITS;
-				if (val < -32768)
-					val = -32768;
-				else if (val > 32767)
-					val = 32767;
-				*dst = val;
+				*dst = rate_interp(S1, S2, pos);
 				dst += dst_step;
 				dst_frames1--;
 			}
@@ -180,6 +217,87 @@ static void resample_shrink(struct snd_pcm_plugin *plugin,
 	data->pos = pos;
 }
 
+static void resample_expand_s16x2(struct snd_pcm_plugin *plugin,
+				  const struct snd_pcm_plugin_channel *src_channels,
+				  struct snd_pcm_plugin_channel *dst_channels,
+				  int src_frames, int dst_frames)
+{
+	struct rate_priv *data = (struct rate_priv *)plugin->extra_data;
+	struct rate_channel *rchannels = data->channels;
+	unsigned int pos = data->pos;
+	union rate_frame S1, S2;
+	u32 *src = src_channels[0].area.addr;
+	u32 *dst = dst_channels[0].area.addr;
+
+	S1.ch[0] = rchannels[0].last_S1;
+	S1.ch[1] = rchannels[1].last_S1;
+	S2.ch[0] = rchannels[0].last_S2;
+	S2.ch[1] = rchannels[1].last_S2;
+	dst_channels[0].enabled = 1;
+	dst_channels[1].enabled = 1;
+	while (dst_frames-- > 0) {
+		if (pos & ~R_MASK) {
+			pos &= R_MASK;
+			S1 = S2;
+			if (src_frames-- > 0)
+				S2.both = *src++;
+		}
+		*dst++ = rate_interp_s16x2(S1.both, S2.both, pos);
+		pos += data->pitch;
+	}
+	rchannels[0].last_S1 = S1.ch[0];
+	rchannels[1].last_S1 = S1.ch[1];
+	rchannels[0].last_S2 = S2.ch[0];
+	rchannels[1].last_S2 = S2.ch[1];
+	data->pos = pos;
+}
+
+static void resample_shrink_s16x2(struct snd_pcm_plugin *plugin,
+				  const struct snd_pcm_plugin_channel *src_channels,
+				  struct snd_pcm_plugin_channel *dst_channels,
+				  int src_frames, int dst_frames)
+{
+	struct rate_priv *data = (struct rate_priv *)plugin->extra_data;
+	struct rate_channel *rchannels = data->channels;
+	unsigned int pos = data->pos;
+	union rate_frame S1, S2;
+	u32 *src = src_channels[0].area.addr;
+	u32 *dst = dst_channels[0].area.addr;
+
+	S1.ch[0] = rchannels[0].last_S1;
+	S1.ch[1] = rchannels[1].last_S1;
+	S2.ch[0] = rchannels[0].last_S2;
+	S2.ch[1] = rchannels[1].last_S2;
+	dst_channels[0].enabled = 1;
+	dst_channels[1].enabled = 1;
+	while (dst_frames > 0) {
+		S1 = S2;
+		if (src_frames-- > 0)
+			S2.both = *src++;
+		if (pos & ~R_MASK) {
+			pos &= R_MASK;
+			*dst++ = rate_interp_s16x2(S1.both, S2.both, pos);
+			dst_frames--;
+		}
+		pos += data->pitch;
+	}
+	rchannels[0].last_S1 = S1.ch[0];
+	rchannels[1].last_S1 = S1.ch[1];
+	rchannels[0].last_S2 = S2.ch[0];
+	rchannels[1].last_S2 = S2.ch[1];
+	data->pos = pos;
+}
+
+/* both channels enabled, interleaved and word aligned */
+static int rate_s16x2_ok(const struct snd_pcm_plugin_channel *channels,
+			 int check_enabled)
+{
+	if (check_enabled && (!channels[0].enabled || !channels[1].enabled))
+		return 0;
+	return snd_pcm_plugin_channels_interleaved(channels, 2, 16) &&
+	       !((unsigned long)channels[0].area.addr & 3);
+}
+
 static snd_pcm_sframes_t rate_src_frames(struct snd_pcm_plugin *plugin, snd_pcm_uframes_t frames)
 {
 	struct rate_priv *data;
@@ -276,7 +394,13 @@ static snd_pcm_sframes_t rate_transfer(struct snd_pcm_plugin *plugin,
 	if (dst_frames > dst_channels[0].frames)
 		dst_frames = dst_channels[0].frames;
 	data = (struct rate_priv *)plugin->extra_data;
-	data->func(plugin, src_channels, dst_channels, frames, dst_frames);
+	if (data->func_s16x2 &&
+	    rate_s16x2_ok(src_channels, 1) && rate_s16x2_ok(dst_channels, 0))
+		data->func_s16x2(plugin, src_channels, dst_channels,
+				 frames, dst_frames);
+	else
+		data->func(plugin, src_channels, dst_channels,
+			   frames, dst_frames);
 	return dst_frames;
 }
 
@@ -332,10 +456,14 @@ int snd_pcm_plugin_build_rate(struct snd_pcm_substream *plug,
 	if (src_format->rate < dst_format->rate) {
 		data->pitch = ((src_format->rate << SHIFT) + (dst_format->rate >> 1)) / dst_format->rate;
 		data->func = resample_expand;
+		data->func_s16x2 = resample_expand_s16x2;
 	} else {
 		data->pitch = ((dst_format->rate << SHIFT) + (src_format->rate >> 1)) / src_format->rate;
 		data->func = resample_shrink;
+		data->func_s16x2 = resample_shrink_s16x2;
 	}
+	if (src_format->channels != 2)
+		data->func_s16x2 = NULL;
 	data->pos = 0;
 	rate_init(plugin);
 	data->old_src_frames = data->old_dst_frames = 0;
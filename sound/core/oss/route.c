@@ -44,6 +44,56 @@ static inline void copy_area(const struct snd_pcm_plugin_channel *src_channel,
 	snd_pcm_area_copy(&src_channel->area, 0, &dst_channel->area, 0, frames, format);
 }
 
+/* duplicate a mono S16 sample into both halves of a stereo frame */
+static inline u32 dup_s16x2(u16 sample)
+{
+#if defined(CONFIG_ARM) && __LINUX_ARM_ARCH__ >= 6
+	u32 frame;
+
+	asm("pkhbt	%0, %1, %1, lsl #16" : "=r" (frame) : "r" ((u32)sample));
+	return frame;
+#else
+	return sample | ((u32)sample << 16);
+#endif
+}
+
+/*
+ * Fast paths for interleaved buffers: expanding 16 bit mono to stereo a
+ * frame per word, and passing frames through unchanged with one copy.
+ */
+static int route_interleaved(const struct snd_pcm_plugin_channel *src_channels,
+			     struct snd_pcm_plugin_channel *dst_channels,
+			     int nsrcs, int ndsts, snd_pcm_uframes_t frames,
+			     int format)
+{
+	int width = snd_pcm_format_physical_width(format);
+	int channel;
+
+	for (channel = 0; channel < nsrcs; channel++)
+		if (!src_channels[channel].enabled)
+			return 0;
+	if (!snd_pcm_plugin_channels_interleaved(src_channels, nsrcs, width) ||
+	    !snd_pcm_plugin_channels_interleaved(dst_channels, ndsts, width))
+		return 0;
+
+	if (nsrcs == 1 && ndsts == 2 && width == 16 &&
+	    !((unsigned long)dst_channels[0].area.addr & 3)) {
+		const u16 *src = src_channels[0].area.addr;
+		u32 *dst = dst_channels[0].area.addr;
+
+		while (frames-- > 0)
+			*dst++ = dup_s16x2(*src++);
+	} else if (nsrcs == ndsts && width % 8 == 0) {
+		memcpy(dst_channels[0].area.addr, src_channels[0].area.addr,
+		       frames * nsrcs * (width / 8));
+	} else
+		return 0;
+
+	for (channel = 0; channel < ndsts; channel++)
+		dst_channels[channel].enabled = 1;
+	return 1;
+}
+
 static snd_pcm_sframes_t route_transfer(struct snd_pcm_plugin *plugin,
 					const struct snd_pcm_plugin_channel *src_channels,
 					struct snd_pcm_plugin_channel *dst_channels,
@@ -62,6 +112,10 @@ static snd_pcm_sframes_t route_transfer(struct snd_pcm_plugin *plugin,
 	ndsts = plugin->dst_format.channels;
 
 	format = plugin->dst_format.format;
+	if (route_interleaved(src_channels, dst_channels, nsrcs, ndsts,
+			      frames, format))
+		return frames;
+
 	dvp = dst_channels;
 	if (nsrcs <= 1) {
 		/* expand to all channels */
@@ -81,6 +81,7 @@ struct aic3x_priv {
 	struct list_head list;
 	int master;
 	int gpio_reset;
+	int in_reset;
 	int power;
 #define AIC3X_MODEL_3X 0
 #define AIC3X_MODEL_33 1
@@ -131,15 +132,13 @@ static const u8 aic3x_reg[AIC3X_CACHEREGNUM] = {
 static int aic3x_read(struct snd_soc_codec *codec, unsigned int reg,
 		      u8 *value)
 {
-	u8 *cache = codec->reg_cache;
-
 	if (codec->cache_only)
 		return -EINVAL;
 	if (reg >= AIC3X_CACHEREGNUM)
 		return -1;
 
 	*value = codec->hw_read(codec, reg);
-	cache[reg] = *value;
+	snd_soc_cache_write(codec, reg, *value);
 
 	return 0;
 }
@@ -1046,14 +1045,14 @@ static int aic3x_set_dai_fmt(struct snd_soc_dai *codec_dai,
 
 static int aic3x_init_3007(struct snd_soc_codec *codec)
 {
-	u8 tmp1, tmp2, *cache = codec->reg_cache;
+	unsigned int tmp1, tmp2;
 
 	/*
 	 * There is no need to cache writes to undocumented page 0xD but
 	 * respective page 0 register cache entries must be preserved
 	 */
-	tmp1 = cache[0xD];
-	tmp2 = cache[0x8];
+	snd_soc_cache_read(codec, 0xD, &tmp1);
+	snd_soc_cache_read(codec, 0x8, &tmp2);
 	/* Class-D speaker driver init; datasheet p. 46 */
 	snd_soc_write(codec, AIC3X_PAGE_SELECT, 0x0D);
 	snd_soc_write(codec, 0xD, 0x0D);
@@ -1061,8 +1060,8 @@ static int aic3x_init_3007(struct snd_soc_codec *codec)
 	snd_soc_write(codec, 0x8, 0x5D);
 	snd_soc_write(codec, 0x8, 0x5C);
 	snd_soc_write(codec, AIC3X_PAGE_SELECT, 0x00);
-	cache[0xD] = tmp1;
-	cache[0x8] = tmp2;
+	snd_soc_cache_write(codec, 0xD, tmp1);
+	snd_soc_cache_write(codec, 0x8, tmp2);
 
 	return 0;
 }
@@ -1079,8 +1078,10 @@ static int aic3x_regulator_event(struct notifier_block *nb,
 		 * Put codec to reset and require cache sync as at least one
 		 * of the supplies was disabled
 		 */
-		if (gpio_is_valid(aic3x->gpio_reset))
+		if (gpio_is_valid(aic3x->gpio_reset)) {
 			gpio_set_value(aic3x->gpio_reset, 0);
+			aic3x->in_reset = 1;
+		}
 		aic3x->codec->cache_sync = 1;
 	}
 
@@ -1090,8 +1091,8 @@ static int aic3x_regulator_event(struct notifier_block *nb,
 static int aic3x_set_power(struct snd_soc_codec *codec, int power)
 {
 	struct aic3x_priv *aic3x = snd_soc_codec_get_drvdata(codec);
+	unsigned int val;
 	int i, ret;
-	u8 *cache = codec->reg_cache;
 
 	if (power) {
 		ret = regulator_bulk_enable(ARRAY_SIZE(aic3x->supplies),
@@ -1113,8 +1114,20 @@ static int aic3x_set_power(struct snd_soc_codec *codec, int power)
 
 		/* Sync reg_cache with the hardware */
 		codec->cache_only = 0;
-		for (i = 0; i < ARRAY_SIZE(aic3x_reg); i++)
-			snd_soc_write(codec, i, cache[i]);
+		if (aic3x->in_reset) {
+			/*
+			 * The codec came out of reset with its default
+			 * register values, so only non-default registers
+			 * need to be written back
+			 */
+			snd_soc_cache_sync(codec);
+			aic3x->in_reset = 0;
+		} else {
+			for (i = 0; i < ARRAY_SIZE(aic3x_reg); i++) {
+				snd_soc_cache_read(codec, i, &val);
+				snd_soc_write(codec, i, val);
+			}
+		}
 		if (aic3x->model == AIC3X_MODEL_3007)
 			aic3x_init_3007(codec);
 		codec->cache_sync = 0;
@@ -1383,6 +1396,7 @@ static int aic3x_probe(struct snd_soc_codec *codec)
 		if (ret != 0)
 			goto err_gpio;
 		gpio_direction_output(aic3x->gpio_reset, 0);
+		aic3x->in_reset = 1;
 	}
 
 	for (i = 0; i < ARRAY_SIZE(aic3x->supplies); i++)
@@ -1466,6 +1480,7 @@ static struct snd_soc_codec_driver soc_codec_dev_aic3x = {
 	.reg_cache_size = ARRAY_SIZE(aic3x_reg),
 	.reg_word_size = sizeof(u8),
 	.reg_cache_default = aic3x_reg,
+	.compress_type = SND_SOC_RBTREE_COMPRESSION,
 	.probe = aic3x_probe,
 	.remove = aic3x_remove,
 	.suspend = aic3x_suspend,
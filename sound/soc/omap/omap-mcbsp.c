@@ -376,7 +376,11 @@ static int omap_mcbsp_dai_hw_params(struct snd_pcm_substream *substream,
 	default:
 		return -EINVAL;
 	}
-	if (cpu_is_omap343x()) {
+	/*
+	 * Threshold and packet mode DMA need the McBSP FIFO.  Ports without
+	 * one (all of 24xx) stay on element synchronised requests.
+	 */
+	if (omap_mcbsp_get_fifo_size(bus_id)) {
 		dma_data->set_threshold = omap_mcbsp_set_threshold;
 		/* TODO: Currently, MODE_ELEMENT == MODE_FRAME */
 		if (omap_mcbsp_get_dma_op_mode(bus_id) ==
@@ -37,7 +37,8 @@ static const struct snd_pcm_hardware omap_pcm_hardware = {
 				  SNDRV_PCM_INFO_MMAP_VALID |
 				  SNDRV_PCM_INFO_INTERLEAVED |
 				  SNDRV_PCM_INFO_PAUSE |
-				  SNDRV_PCM_INFO_RESUME,
+				  SNDRV_PCM_INFO_RESUME |
+				  SNDRV_PCM_INFO_NO_PERIOD_WAKEUP,
 	.formats		= SNDRV_PCM_FMTBIT_S16_LE |
 				  SNDRV_PCM_FMTBIT_S32_LE,
 	.period_bytes_min	= 32,
@@ -192,11 +193,21 @@ static int omap_pcm_prepare(struct snd_pcm_substream *substream)
 	dma_params.frame_count	= runtime->periods;
 	omap_set_dma_params(prtd->dma_ch, &dma_params);
 
-	if ((cpu_is_omap1510()))
+	if ((cpu_is_omap1510())) {
 		omap_enable_dma_irq(prtd->dma_ch, OMAP_DMA_FRAME_IRQ |
 			      OMAP_DMA_LAST_IRQ | OMAP_DMA_BLOCK_IRQ);
-	else
+	} else if (!runtime->no_period_wakeup) {
 		omap_enable_dma_irq(prtd->dma_ch, OMAP_DMA_FRAME_IRQ);
+	} else {
+		/*
+		 * No period wakeups: the buffer loops through the self link
+		 * and omap_pcm_pointer() reads the position from the DMA
+		 * progress counters, so only error interrupts are left on.
+		 * BLOCK_IRQ is enabled by the DMA core at request time.
+		 */
+		omap_disable_dma_irq(prtd->dma_ch, OMAP_DMA_FRAME_IRQ |
+				     OMAP_DMA_BLOCK_IRQ);
+	}
 
 	if (!(cpu_class_is_omap1())) {
 		omap_set_dma_src_burst_mode(prtd->dma_ch,
@@ -274,6 +285,10 @@ static int omap_pcm_open(struct snd_pcm_substream *substream)
 
 	snd_soc_set_runtime_hwparams(substream, &omap_pcm_hardware);
 
+	/* OMAP1510 tracks the position from the period interrupts */
+	if (cpu_is_omap1510())
+		runtime->hw.info &= ~SNDRV_PCM_INFO_NO_PERIOD_WAKEUP;
+
 	/* Ensure that buffer size is a multiple of period size */
 	ret = snd_pcm_hw_constraint_integer(runtime,
 					    SNDRV_PCM_HW_PARAM_PERIODS);
@@ -761,32 +761,121 @@ int snd_soc_codec_set_cache_io(struct snd_soc_codec *codec,
 }
 EXPORT_SYMBOL_GPL(snd_soc_codec_set_cache_io);
 
+/*
+ * The rbtree cache groups adjacent registers into blocks so that a sparse
+ * register map is stored as a few runs of populated registers instead of
+ * one tree node per register.  Registers that are not covered by any block
+ * read back as zero.
+ */
 struct snd_soc_rbtree_node {
+	/* the actual rbtree node holding this block */
 	struct rb_node node;
-	unsigned int reg;
-	unsigned int value;
-	unsigned int defval;
-} __attribute__ ((packed));
+	/* base register handled by this block */
+	unsigned int base_reg;
+	/* number of bytes needed to represent a register value */
+	unsigned int word_size;
+	/* block of adjacent registers */
+	void *block;
+	/* number of registers available in the block */
+	unsigned int blklen;
+};
 
 struct snd_soc_rbtree_ctx {
 	struct rb_root root;
+	/* the block that was looked up or modified last */
+	struct snd_soc_rbtree_node *cached_rbnode;
 };
 
+static inline void snd_soc_rbtree_get_base_top_reg(
+	struct snd_soc_rbtree_node *rbnode,
+	unsigned int *base, unsigned int *top)
+{
+	*base = rbnode->base_reg;
+	*top = rbnode->base_reg + rbnode->blklen - 1;
+}
+
+static unsigned int snd_soc_rbtree_get_register(
+	struct snd_soc_rbtree_node *rbnode, unsigned int idx)
+{
+	unsigned int val;
+
+	switch (rbnode->word_size) {
+	case 1: {
+		u8 *p = rbnode->block;
+		val = p[idx];
+		return val;
+	}
+	case 2: {
+		u16 *p = rbnode->block;
+		val = p[idx];
+		return val;
+	}
+	default:
+		BUG();
+		break;
+	}
+	return -1;
+}
+
+static void snd_soc_rbtree_set_register(struct snd_soc_rbtree_node *rbnode,
+					unsigned int idx, unsigned int val)
+{
+	switch (rbnode->word_size) {
+	case 1: {
+		u8 *p = rbnode->block;
+		p[idx] = val;
+		break;
+	}
+	case 2: {
+		u16 *p = rbnode->block;
+		p[idx] = val;
+		break;
+	}
+	default:
+		BUG();
+		break;
+	}
+}
+
+static unsigned int snd_soc_rbtree_get_default(struct snd_soc_codec *codec,
+					       unsigned int reg)
+{
+	if (!codec->reg_def_copy)
+		return 0;
+
+	switch (codec->driver->reg_word_size) {
+	case 1: {
+		const u8 *cache = codec->reg_def_copy;
+		return cache[reg];
+	}
+	case 2: {
+		const u16 *cache = codec->reg_def_copy;
+		return cache[reg];
+	}
+	default:
+		BUG();
+		break;
+	}
+	return 0;
+}
+
 static struct snd_soc_rbtree_node *snd_soc_rbtree_lookup(
 	struct rb_root *root, unsigned int reg)
 {
 	struct rb_node *node;
 	struct snd_soc_rbtree_node *rbnode;
+	unsigned int base_reg, top_reg;
 
 	node = root->rb_node;
 	while (node) {
 		rbnode = container_of(node, struct snd_soc_rbtree_node, node);
-		if (rbnode->reg < reg)
-			node = node->rb_left;
-		else if (rbnode->reg > reg)
-			node = node->rb_right;
-		else
+		snd_soc_rbtree_get_base_top_reg(rbnode, &base_reg, &top_reg);
+		if (reg >= base_reg && reg <= top_reg)
 			return rbnode;
+		else if (reg > top_reg)
+			node = node->rb_right;
+		else if (reg < base_reg)
+			node = node->rb_left;
 	}
 
 	return NULL;
@@ -797,19 +886,24 @@ static int snd_soc_rbtree_insert(struct rb_root *root,
 {
 	struct rb_node **new, *parent;
 	struct snd_soc_rbtree_node *rbnode_tmp;
+	unsigned int base_reg_tmp, top_reg_tmp;
 
 	parent = NULL;
 	new = &root->rb_node;
 	while (*new) {
 		rbnode_tmp = container_of(*new, struct snd_soc_rbtree_node,
 					  node);
+		snd_soc_rbtree_get_base_top_reg(rbnode_tmp, &base_reg_tmp,
+						&top_reg_tmp);
 		parent = *new;
-		if (rbnode_tmp->reg < rbnode->reg)
-			new = &((*new)->rb_left);
-		else if (rbnode_tmp->reg > rbnode->reg)
-			new = &((*new)->rb_right);
-		else
+		/* if this register has already been inserted, just return */
+		if (rbnode->base_reg >= base_reg_tmp &&
+		    rbnode->base_reg <= top_reg_tmp)
 			return 0;
+		else if (rbnode->base_reg > top_reg_tmp)
+			new = &((*new)->rb_right);
+		else if (rbnode->base_reg < base_reg_tmp)
+			new = &((*new)->rb_left);
 	}
 
 	/* insert the node into the rbtree */
@@ -819,60 +913,161 @@ static int snd_soc_rbtree_insert(struct rb_root *root,
 	return 1;
 }
 
+/*
+ * Find the block covering @reg, checking the most recently used block
+ * first since register accesses tend to be clustered.
+ */
+static struct snd_soc_rbtree_node *snd_soc_rbtree_find(
+	struct snd_soc_rbtree_ctx *rbtree_ctx, unsigned int reg)
+{
+	struct snd_soc_rbtree_node *rbnode;
+	unsigned int base_reg, top_reg;
+
+	rbnode = rbtree_ctx->cached_rbnode;
+	if (rbnode) {
+		snd_soc_rbtree_get_base_top_reg(rbnode, &base_reg, &top_reg);
+		if (reg >= base_reg && reg <= top_reg)
+			return rbnode;
+	}
+
+	rbnode = snd_soc_rbtree_lookup(&rbtree_ctx->root, reg);
+	if (rbnode)
+		rbtree_ctx->cached_rbnode = rbnode;
+	return rbnode;
+}
+
 static int snd_soc_rbtree_cache_sync(struct snd_soc_codec *codec)
 {
 	struct snd_soc_rbtree_ctx *rbtree_ctx;
 	struct rb_node *node;
 	struct snd_soc_rbtree_node *rbnode;
+	unsigned int regtmp;
 	unsigned int val;
 	int ret;
+	int i;
 
 	rbtree_ctx = codec->reg_cache;
 	for (node = rb_first(&rbtree_ctx->root); node; node = rb_next(node)) {
 		rbnode = rb_entry(node, struct snd_soc_rbtree_node, node);
-		if (rbnode->value == rbnode->defval)
-			continue;
-		ret = snd_soc_cache_read(codec, rbnode->reg, &val);
-		if (ret)
-			return ret;
-		ret = snd_soc_write(codec, rbnode->reg, val);
-		if (ret)
-			return ret;
-		dev_dbg(codec->dev, "Synced register %#x, value = %#x\n",
-			rbnode->reg, val);
+		for (i = 0; i < rbnode->blklen; ++i) {
+			regtmp = rbnode->base_reg + i;
+			val = snd_soc_rbtree_get_register(rbnode, i);
+			/* the hardware already holds its default value */
+			if (val == snd_soc_rbtree_get_default(codec, regtmp))
+				continue;
+			ret = snd_soc_write(codec, regtmp, val);
+			if (ret)
+				return ret;
+			dev_dbg(codec->dev, "Synced register %#x, value = %#x\n",
+				regtmp, val);
+		}
 	}
 
 	return 0;
 }
 
+static int snd_soc_rbtree_insert_to_block(struct snd_soc_rbtree_node *rbnode,
+					  unsigned int pos, unsigned int reg,
+					  unsigned int value)
+{
+	u8 *blk;
+
+	blk = krealloc(rbnode->block,
+		       (rbnode->blklen + 1) * rbnode->word_size, GFP_KERNEL);
+	if (!blk)
+		return -ENOMEM;
+
+	/* insert the register value in the correct place in the rbnode block */
+	memmove(blk + (pos + 1) * rbnode->word_size,
+		blk + pos * rbnode->word_size,
+		(rbnode->blklen - pos) * rbnode->word_size);
+
+	/* update the rbnode block, its size and the base register */
+	rbnode->block = blk;
+	rbnode->blklen++;
+	if (!pos)
+		rbnode->base_reg = reg;
+
+	snd_soc_rbtree_set_register(rbnode, pos, value);
+	return 0;
+}
+
+/*
+ * Return the position at which @reg would extend @rbnode, or -1 if the
+ * register is not adjacent to the block.
+ */
+static inline int snd_soc_rbtree_adjacent_pos(
+	struct snd_soc_rbtree_node *rbnode, unsigned int reg)
+{
+	if (reg + 1 == rbnode->base_reg)
+		return 0;
+	if (reg == rbnode->base_reg + rbnode->blklen)
+		return rbnode->blklen;
+	return -1;
+}
+
 static int snd_soc_rbtree_cache_write(struct snd_soc_codec *codec,
 				      unsigned int reg, unsigned int value)
 {
 	struct snd_soc_rbtree_ctx *rbtree_ctx;
 	struct snd_soc_rbtree_node *rbnode;
+	struct rb_node *node;
+	unsigned int reg_tmp;
+	int pos;
+	int ret;
 
 	rbtree_ctx = codec->reg_cache;
-	rbnode = snd_soc_rbtree_lookup(&rbtree_ctx->root, reg);
+	rbnode = snd_soc_rbtree_find(rbtree_ctx, reg);
 	if (rbnode) {
-		if (rbnode->value == value)
-			return 0;
-		rbnode->value = value;
-	} else {
-		/* bail out early, no need to create the rbnode yet */
-		if (!value)
-			return 0;
-		/*
-		 * for uninitialized registers whose value is changed
-		 * from the default zero, create an rbnode and insert
-		 * it into the tree.
-		 */
-		rbnode = kzalloc(sizeof *rbnode, GFP_KERNEL);
-		if (!rbnode)
-			return -ENOMEM;
-		rbnode->reg = reg;
-		rbnode->value = value;
-		snd_soc_rbtree_insert(&rbtree_ctx->root, rbnode);
+		reg_tmp = reg - rbnode->base_reg;
+		if (snd_soc_rbtree_get_register(rbnode, reg_tmp) != value)
+			snd_soc_rbtree_set_register(rbnode, reg_tmp, value);
+		return 0;
+	}
+
+	/* bail out early, no need to create the rbnode yet */
+	if (!value)
+		return 0;
+
+	/*
+	 * look for an adjacent register to the one we are about to add,
+	 * starting with the last used block as registers are usually
+	 * written in ascending order.
+	 */
+	rbnode = rbtree_ctx->cached_rbnode;
+	pos = rbnode ? snd_soc_rbtree_adjacent_pos(rbnode, reg) : -1;
+	for (node = rb_first(&rbtree_ctx->root); node && pos < 0;
+	     node = rb_next(node)) {
+		rbnode = rb_entry(node, struct snd_soc_rbtree_node, node);
+		pos = snd_soc_rbtree_adjacent_pos(rbnode, reg);
+	}
+	if (pos >= 0) {
+		ret = snd_soc_rbtree_insert_to_block(rbnode, pos, reg, value);
+		if (ret)
+			return ret;
+		rbtree_ctx->cached_rbnode = rbnode;
+		return 0;
+	}
+
+	/*
+	 * we did not manage to find a place to insert it in an existing
+	 * block so create a new rbnode with a single register in its block.
+	 */
+	rbnode = kzalloc(sizeof *rbnode, GFP_KERNEL);
+	if (!rbnode)
+		return -ENOMEM;
+	rbnode->blklen = 1;
+	rbnode->base_reg = reg;
+	rbnode->word_size = codec->driver->reg_word_size;
+	rbnode->block = kmalloc(rbnode->blklen * rbnode->word_size,
+				GFP_KERNEL);
+	if (!rbnode->block) {
+		kfree(rbnode);
+		return -ENOMEM;
 	}
+	snd_soc_rbtree_set_register(rbnode, 0, value);
+	snd_soc_rbtree_insert(&rbtree_ctx->root, rbnode);
+	rbtree_ctx->cached_rbnode = rbnode;
 
 	return 0;
 }
@@ -884,9 +1079,10 @@ static int snd_soc_rbtree_cache_read(struct snd_soc_codec *codec,
 	struct snd_soc_rbtree_node *rbnode;
 
 	rbtree_ctx = codec->reg_cache;
-	rbnode = snd_soc_rbtree_lookup(&rbtree_ctx->root, reg);
+	rbnode = snd_soc_rbtree_find(rbtree_ctx, reg);
 	if (rbnode) {
-		*value = rbnode->value;
+		*value = snd_soc_rbtree_get_register(rbnode,
+						     reg - rbnode->base_reg);
 	} else {
 		/* uninitialized registers default to 0 */
 		*value = 0;
@@ -912,6 +1108,7 @@ static int snd_soc_rbtree_cache_exit(struct snd_soc_codec *codec)
 		rbtree_node = rb_entry(next, struct snd_soc_rbtree_node, node);
 		next = rb_next(&rbtree_node->node);
 		rb_erase(&rbtree_node->node, &rbtree_ctx->root);
+		kfree(rbtree_node->block);
 		kfree(rbtree_node);
 	}
 
@@ -925,6 +1122,9 @@ static int snd_soc_rbtree_cache_exit(struct snd_soc_codec *codec)
 static int snd_soc_rbtree_cache_init(struct snd_soc_codec *codec)
 {
 	struct snd_soc_rbtree_ctx *rbtree_ctx;
+	unsigned int val;
+	int i;
+	int ret;
 
 	codec->reg_cache = kmalloc(sizeof *rbtree_ctx, GFP_KERNEL);
 	if (!codec->reg_cache)
@@ -932,57 +1132,25 @@ static int snd_soc_rbtree_cache_init(struct snd_soc_codec *codec)
 
 	rbtree_ctx = codec->reg_cache;
 	rbtree_ctx->root = RB_ROOT;
+	rbtree_ctx->cached_rbnode = NULL;
 
 	if (!codec->reg_def_copy)
 		return 0;
 
-/*
- * populate the rbtree with the initialized registers.  All other
- * registers will be inserted into the tree when they are first written.
- *
- * The reasoning behind this, is that we need to step through and
- * dereference the cache in u8/u16 increments without sacrificing
- * portability.  This could also be done using memcpy() but that would
- * be slightly more cryptic.
- */
-#define snd_soc_rbtree_populate(cache)					\
-({									\
-	int ret, i;							\
-	struct snd_soc_rbtree_node *rbtree_node;			\
-									\
-	ret = 0;							\
-	cache = codec->reg_def_copy;					\
-	for (i = 0; i < codec->driver->reg_cache_size; ++i) {		\
-		if (!cache[i])						\
-			continue;					\
-		rbtree_node = kzalloc(sizeof *rbtree_node, GFP_KERNEL);	\
-		if (!rbtree_node) {					\
-			ret = -ENOMEM;					\
-			snd_soc_cache_exit(codec);			\
-			break;						\
-		}							\
-		rbtree_node->reg = i;					\
-		rbtree_node->value = cache[i];				\
-		rbtree_node->defval = cache[i];				\
-		snd_soc_rbtree_insert(&rbtree_ctx->root,		\
-				      rbtree_node);			\
-	}								\
-	ret;								\
-})
-
-	switch (codec->driver->reg_word_size) {
-	case 1: {
-		const u8 *cache;
-
-		return snd_soc_rbtree_populate(cache);
-	}
-	case 2: {
-		const u16 *cache;
-
-		return snd_soc_rbtree_populate(cache);
-	}
-	default:
-		BUG();
+	/*
+	 * populate the rbtree with the initialized registers.  All other
+	 * registers will be inserted into the tree when they are first
+	 * written.  Runs of adjacent non-zero defaults end up in one block.
+	 */
+	for (i = 0; i < codec->driver->reg_cache_size; ++i) {
+		val = snd_soc_rbtree_get_default(codec, i);
+		if (!val)
+			continue;
+		ret = snd_soc_rbtree_cache_write(codec, i, val);
+		if (ret) {
+			snd_soc_cache_exit(codec);
+			return ret;
+		}
 	}
 
 	return 0;
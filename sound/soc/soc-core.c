@@ -1880,6 +1880,7 @@ static int soc_probe(struct platform_device *pdev)
 	INIT_LIST_HEAD(&card->widgets);
 	INIT_LIST_HEAD(&card->paths);
 	INIT_LIST_HEAD(&card->dapm_list);
+	INIT_LIST_HEAD(&card->dapm_dirty);
 
 	soc_init_card_debugfs(card);
 
@@ -116,6 +116,24 @@ static void pop_dbg(struct device *dev, u32 pop_time, const char *fmt, ...)
 	kfree(buf);
 }
 
+/*
+ * Queue a widget for a power check on the next DAPM run.  Only widgets
+ * on the card's dirty list and their neighbours are re-evaluated.
+ */
+static void dapm_mark_dirty(struct snd_soc_dapm_widget *w)
+{
+	if (list_empty(&w->dirty))
+		list_add_tail(&w->dirty, &w->dapm->card->dapm_dirty);
+}
+
+static void dapm_mark_all_dirty(struct snd_soc_card *card)
+{
+	struct snd_soc_dapm_widget *w;
+
+	list_for_each_entry(w, &card->widgets, list)
+		dapm_mark_dirty(w);
+}
+
 /* create a new dapm widget */
 static inline struct snd_soc_dapm_widget *dapm_cnew_widget(
 	const struct snd_soc_dapm_widget *_widget)
@@ -978,6 +996,19 @@ static void dapm_widget_update(struct snd_soc_dapm_context *dapm)
 }
 
 
+static void dapm_widget_set_power(struct snd_soc_dapm_widget *w, int power,
+				  struct list_head *up_list,
+				  struct list_head *down_list)
+{
+	trace_snd_soc_dapm_widget_power(w, power);
+
+	if (power)
+		dapm_seq_insert(w, up_list, dapm_up_seq);
+	else
+		dapm_seq_insert(w, down_list, dapm_down_seq);
+
+	w->power = power;
+}
 
 /*
  * Scan each dapm widget for complete audio path.
@@ -991,7 +1022,8 @@ static void dapm_widget_update(struct snd_soc_dapm_context *dapm)
 static int dapm_power_widgets(struct snd_soc_dapm_context *dapm, int event)
 {
 	struct snd_soc_card *card = dapm->codec->card;
-	struct snd_soc_dapm_widget *w;
+	struct snd_soc_dapm_widget *w, *n;
+	struct snd_soc_dapm_path *path;
 	struct snd_soc_dapm_context *d;
 	LIST_HEAD(up_list);
 	LIST_HEAD(down_list);
@@ -1004,9 +1036,42 @@ static int dapm_power_widgets(struct snd_soc_dapm_context *dapm, int event)
 		if (d->n_widgets)
 			d->dev_power = 0;
 
+	/* The suspend state of the card affects every endpoint */
+	if (event == SND_SOC_DAPM_STREAM_SUSPEND ||
+	    event == SND_SOC_DAPM_STREAM_RESUME)
+		dapm_mark_all_dirty(card);
+
 	/* Check which widgets we need to power and store them in
-	 * lists indicating if they should be powered up or down.
+	 * lists indicating if they should be powered up or down.  Only
+	 * widgets that were marked dirty are checked; any of them that
+	 * change state queue their neighbours for a check in turn.
+	 * Supplies depend on their sinks alone and are checked below.
 	 */
+	list_for_each_entry(w, &card->dapm_dirty, dirty) {
+		if (!w->power_check || w->id == snd_soc_dapm_supply)
+			continue;
+
+		if (!w->force)
+			power = w->power_check(w);
+		else
+			power = 1;
+
+		if (w->power == power)
+			continue;
+
+		dapm_widget_set_power(w, power, &up_list, &down_list);
+
+		list_for_each_entry(path, &w->sources, list_sink)
+			if (path->source)
+				dapm_mark_dirty(path->source);
+		list_for_each_entry(path, &w->sinks, list_source)
+			if (path->sink)
+				dapm_mark_dirty(path->sink);
+	}
+
+	list_for_each_entry_safe(w, n, &card->dapm_dirty, dirty)
+		list_del_init(&w->dirty);
+
 	list_for_each_entry(w, &card->widgets, list) {
 		switch (w->id) {
 		case snd_soc_dapm_pre:
@@ -1015,29 +1080,20 @@ static int dapm_power_widgets(struct snd_soc_dapm_context *dapm, int event)
 		case snd_soc_dapm_post:
 			dapm_seq_insert(w, &up_list, dapm_up_seq);
 			break;
-
-		default:
+		case snd_soc_dapm_supply:
 			if (!w->power_check)
-				continue;
-
+				break;
 			if (!w->force)
 				power = w->power_check(w);
 			else
 				power = 1;
-			if (power)
+			if (w->power != power)
+				dapm_widget_set_power(w, power, &up_list,
+						      &down_list);
+			/* fall through */
+		default:
+			if (w->power_check && w->power)
 				w->dapm->dev_power = 1;
-
-			if (w->power == power)
-				continue;
-
-			trace_snd_soc_dapm_widget_power(w, power);
-
-			if (power)
-				dapm_seq_insert(w, &up_list, dapm_up_seq);
-			else
-				dapm_seq_insert(w, &down_list, dapm_down_seq);
-
-			w->power = power;
 			break;
 		}
 	}
@@ -1273,6 +1329,9 @@ static int dapm_mux_update_power(struct snd_soc_dapm_widget *widget,
 			path->connect = 1; /* new connection */
 		else
 			path->connect = 0; /* old connection must be powered down */
+
+		dapm_mark_dirty(path->source);
+		dapm_mark_dirty(path->sink);
 	}
 
 	if (found)
@@ -1301,6 +1360,8 @@ static int dapm_mixer_update_power(struct snd_soc_dapm_widget *widget,
 		/* found, now check type */
 		found = 1;
 		path->connect = connect;
+		dapm_mark_dirty(path->source);
+		dapm_mark_dirty(path->sink);
 		break;
 	}
 
@@ -1389,6 +1450,7 @@ static void dapm_free_widgets(struct snd_soc_dapm_context *dapm)
 		if (w->dapm != dapm)
 			continue;
 		list_del(&w->list);
+		list_del(&w->dirty);
 		/*
 		 * remove source and sink paths associated to this widget.
 		 * While removing the path, remove reference to it from both
@@ -1428,6 +1490,7 @@ static int snd_soc_dapm_set_pin(struct snd_soc_dapm_context *dapm,
 			/* Allow disabling of forced pins */
 			if (status == 0)
 				w->force = 0;
+			dapm_mark_dirty(w);
 			return 0;
 		}
 	}
@@ -1502,6 +1565,10 @@ static int snd_soc_dapm_add_route(struct snd_soc_dapm_context *dapm,
 	if (wsource == NULL || wsink == NULL)
 		return -ENODEV;
 
+	/* a new route may complete or break paths through both ends */
+	dapm_mark_dirty(wsource);
+	dapm_mark_dirty(wsink);
+
 	path = kzalloc(sizeof(struct snd_soc_dapm_path), GFP_KERNEL);
 	if (!path)
 		return -ENOMEM;
@@ -1697,6 +1764,7 @@ int snd_soc_dapm_new_widgets(struct snd_soc_dapm_context *dapm)
 		}
 
 		w->new = 1;
+		dapm_mark_dirty(w);
 	}
 
 	dapm_power_widgets(dapm, SND_SOC_DAPM_STREAM_NOP);
@@ -2133,6 +2201,7 @@ int snd_soc_dapm_new_control(struct snd_soc_dapm_context *dapm,
 	INIT_LIST_HEAD(&w->sources);
 	INIT_LIST_HEAD(&w->sinks);
 	INIT_LIST_HEAD(&w->list);
+	INIT_LIST_HEAD(&w->dirty);
 	list_add(&w->list, &dapm->card->widgets);
 
 	/* machine layer set ups unconnected pins and insertions */
@@ -2186,9 +2255,11 @@ static void soc_dapm_stream_event(struct snd_soc_dapm_context *dapm,
 			switch(event) {
 			case SND_SOC_DAPM_STREAM_START:
 				w->active = 1;
+				dapm_mark_dirty(w);
 				break;
 			case SND_SOC_DAPM_STREAM_STOP:
 				w->active = 0;
+				dapm_mark_dirty(w);
 				break;
 			case SND_SOC_DAPM_STREAM_SUSPEND:
 			case SND_SOC_DAPM_STREAM_RESUME:
@@ -2269,6 +2340,7 @@ int snd_soc_dapm_force_enable_pin(struct snd_soc_dapm_context *dapm,
 				"dapm: force enable pin %s\n", pin);
 			w->connected = 1;
 			w->force = 1;
+			dapm_mark_dirty(w);
 			return 0;
 		}
 	}
@@ -2360,6 +2432,7 @@ int snd_soc_dapm_ignore_suspend(struct snd_soc_dapm_context *dapm,
 			continue;
 		if (!strcmp(w->name, pin)) {
 			w->ignore_suspend = 1;
+			dapm_mark_dirty(w);
 			return 0;
 		}
 	}
@@ -1,9 +1,18 @@
 #ifndef BENCH_H
 #define BENCH_H
 
+#include <pthread.h>
+
 extern int bench_sched_messaging(int argc, const char **argv, const char *prefix);
 extern int bench_sched_pipe(int argc, const char **argv, const char *prefix);
 extern int bench_mem_memcpy(int argc, const char **argv, const char *prefix __used);
+extern int bench_mem_pagefault(int argc, const char **argv, const char *prefix);
+extern int bench_mem_mmap(int argc, const char **argv, const char *prefix);
+extern int bench_futex_hash(int argc, const char **argv, const char *prefix);
+extern int bench_futex_wake(int argc, const char **argv, const char *prefix);
+extern int bench_futex_requeue(int argc, const char **argv, const char *prefix);
+extern int bench_epoll_wait(int argc, const char **argv, const char *prefix);
+extern int bench_epoll_ctl(int argc, const char **argv, const char *prefix);
 
 #define BENCH_FORMAT_DEFAULT_STR	"default"
 #define BENCH_FORMAT_DEFAULT		0
@@ -14,4 +23,26 @@ extern int bench_mem_memcpy(int argc, const char **argv, const char *prefix __us
 
 extern int bench_format;
 
+/*
+ * helpers for the multi-threaded suites, see bench/threads.c
+ */
+struct bench_thread {
+	pthread_t	thread;
+	unsigned int	id;
+	unsigned long	ops;
+	void		*priv;
+} __attribute__((aligned(64)));	/* keep counters off shared cachelines */
+
+extern volatile int bench_done;
+
+extern unsigned int bench_nr_cpus(void);
+extern struct bench_thread *bench_threads_start(unsigned int nr,
+						 void *(*fn)(void *),
+						 void **privs);
+extern void bench_threads_wait_start(void);
+extern void bench_threads_run(unsigned int seconds);
+extern void bench_threads_join(struct bench_thread *threads, unsigned int nr);
+extern void bench_threads_print(const char *what, struct bench_thread *threads,
+				unsigned int nr, double secs);
+
 #endif
@@ -0,0 +1,133 @@
+/*
+ * epoll-ctl.c
+ *
+ * ctl: Threads add, modify and remove their own file descriptors on one
+ * shared epoll instance, contending on its internal locks.
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+static unsigned int nthreads;
+static unsigned int nfds = 64;
+static unsigned int runtime = 5;
+static int epfd;
+
+static const struct option options[] = {
+	OPT_UINTEGER('t', "threads", &nthreads,
+		     "Specify number of threads (default: online CPUs)"),
+	OPT_UINTEGER('f', "nfds", &nfds,
+		     "Specify number of file descriptors per thread"),
+	OPT_UINTEGER('r', "runtime", &runtime,
+		     "Specify runtime in seconds"),
+	OPT_END()
+};
+
+static const char * const bench_epoll_ctl_usage[] = {
+	"perf bench epoll ctl <options>",
+	NULL
+};
+
+static void *worker(void *arg)
+{
+	struct bench_thread *t = arg;
+	int *fds = t->priv;
+	struct epoll_event ev;
+	unsigned long ops = 0;
+	unsigned int i;
+
+	bench_threads_wait_start();
+
+	while (!bench_done) {
+		for (i = 0; i < nfds; i++, ops += 3) {
+			ev.events = EPOLLIN;
+			ev.data.fd = fds[i];
+			if (epoll_ctl(epfd, EPOLL_CTL_ADD, fds[i], &ev))
+				die("EPOLL_CTL_ADD: %s\n", strerror(errno));
+
+			ev.events = EPOLLOUT;
+			if (epoll_ctl(epfd, EPOLL_CTL_MOD, fds[i], &ev))
+				die("EPOLL_CTL_MOD: %s\n", strerror(errno));
+
+			if (epoll_ctl(epfd, EPOLL_CTL_DEL, fds[i], &ev))
+				die("EPOLL_CTL_DEL: %s\n", strerror(errno));
+		}
+	}
+
+	t->ops = ops;
+	return NULL;
+}
+
+int bench_epoll_ctl(int argc, const char **argv,
+		    const char *prefix __used)
+{
+	struct bench_thread *threads;
+	struct timeval start, stop, diff;
+	void **privs;
+	int *fds;
+	unsigned int i, j;
+
+	argc = parse_options(argc, argv, options,
+			     bench_epoll_ctl_usage, 0);
+
+	if (!nthreads)
+		nthreads = bench_nr_cpus();
+	if (!nfds || !runtime)
+		usage_with_options(bench_epoll_ctl_usage, options);
+
+	epfd = epoll_create(nthreads * nfds);
+	if (epfd < 0)
+		die("epoll_create: %s\n", strerror(errno));
+
+	privs = zalloc(nthreads * sizeof(*privs));
+	if (!privs)
+		die("memory allocation failed\n");
+	for (i = 0; i < nthreads; i++) {
+		fds = zalloc(nfds * sizeof(int));
+		if (!fds)
+			die("memory allocation failed\n");
+		for (j = 0; j < nfds; j++) {
+			fds[j] = eventfd(0, 0);
+			if (fds[j] < 0)
+				die("eventfd: %s\n", strerror(errno));
+		}
+		privs[i] = fds;
+	}
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# %u threads cycling %u fds each through ADD/MOD/DEL"
+		       " for %u secs\n\n", nthreads, nfds, runtime);
+
+	threads = bench_threads_start(nthreads, worker, privs);
+	gettimeofday(&start, NULL);
+	bench_threads_run(runtime);
+	bench_threads_join(threads, nthreads);
+	gettimeofday(&stop, NULL);
+	timersub(&stop, &start, &diff);
+
+	bench_threads_print("ops", threads, nthreads,
+			    diff.tv_sec + diff.tv_usec / 1000000.0);
+
+	for (i = 0; i < nthreads; i++) {
+		fds = privs[i];
+		for (j = 0; j < nfds; j++)
+			close(fds[j]);
+		free(fds);
+	}
+	close(epfd);
+	free(privs);
+	free(threads);
+	return 0;
+}
@@ -0,0 +1,172 @@
+/*
+ * epoll-wait.c
+ *
+ * wait: Threads signal eventfds and collect the events with epoll_wait(),
+ * either all on one shared epoll instance (the contended case) or on one
+ * instance each.
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/time.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+static unsigned int nthreads;
+static unsigned int nfds = 64;
+static unsigned int runtime = 5;
+static bool multiq;
+
+static const struct option options[] = {
+	OPT_UINTEGER('t', "threads", &nthreads,
+		     "Specify number of threads (default: online CPUs)"),
+	OPT_UINTEGER('f', "nfds", &nfds,
+		     "Specify number of eventfds per thread"),
+	OPT_UINTEGER('r', "runtime", &runtime,
+		     "Specify runtime in seconds"),
+	OPT_BOOLEAN('m', "multiq", &multiq,
+		    "Use one epoll instance per thread instead of a shared one"),
+	OPT_END()
+};
+
+static const char * const bench_epoll_wait_usage[] = {
+	"perf bench epoll wait <options>",
+	NULL
+};
+
+struct epoll_worker {
+	int	epfd;
+	int	*fds;
+};
+
+static void *worker(void *arg)
+{
+	struct bench_thread *t = arg;
+	struct epoll_worker *w = t->priv;
+	struct epoll_event ev;
+	unsigned long ops = 0;
+	unsigned int i = 0;
+	uint64_t val = 1;
+	int ret;
+
+	bench_threads_wait_start();
+
+	while (!bench_done) {
+		if (write(w->fds[i], &val, sizeof(val)) != sizeof(val))
+			die("eventfd write: %s\n", strerror(errno));
+		if (++i == nfds)
+			i = 0;
+
+		ret = epoll_wait(w->epfd, &ev, 1, 100);
+		if (ret < 0 && errno != EINTR)
+			die("epoll_wait: %s\n", strerror(errno));
+		if (ret <= 0)
+			continue;
+
+		/* with a shared instance another thread may have got there first */
+		if (read(ev.data.fd, &val, sizeof(val)) == sizeof(val))
+			ops++;
+		else if (errno != EAGAIN)
+			die("eventfd read: %s\n", strerror(errno));
+		val = 1;
+	}
+
+	t->ops = ops;
+	return NULL;
+}
+
+int bench_epoll_wait(int argc, const char **argv,
+		     const char *prefix __used)
+{
+	struct bench_thread *threads;
+	struct epoll_worker *workers;
+	struct epoll_event ev;
+	struct timeval start, stop, diff;
+	void **privs;
+	unsigned int i, j;
+	int shared_epfd = -1;
+
+	argc = parse_options(argc, argv, options,
+			     bench_epoll_wait_usage, 0);
+
+	if (!nthreads)
+		nthreads = bench_nr_cpus();
+	if (!nfds || !runtime)
+		usage_with_options(bench_epoll_wait_usage, options);
+
+	workers = zalloc(nthreads * sizeof(*workers));
+	privs = zalloc(nthreads * sizeof(*privs));
+	if (!workers || !privs)
+		die("memory allocation failed\n");
+
+	if (!multiq) {
+		shared_epfd = epoll_create(nthreads * nfds);
+		if (shared_epfd < 0)
+			die("epoll_create: %s\n", strerror(errno));
+	}
+
+	for (i = 0; i < nthreads; i++) {
+		struct epoll_worker *w = &workers[i];
+
+		w->epfd = multiq ? epoll_create(nfds) : shared_epfd;
+		if (w->epfd < 0)
+			die("epoll_create: %s\n", strerror(errno));
+		w->fds = zalloc(nfds * sizeof(int));
+		if (!w->fds)
+			die("memory allocation failed\n");
+
+		for (j = 0; j < nfds; j++) {
+			w->fds[j] = eventfd(0, 0);
+			if (w->fds[j] < 0)
+				die("eventfd: %s\n", strerror(errno));
+			fcntl(w->fds[j], F_SETFL, O_NONBLOCK);
+
+			ev.events = EPOLLIN;
+			ev.data.fd = w->fds[j];
+			if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, w->fds[j], &ev))
+				die("epoll_ctl: %s\n", strerror(errno));
+		}
+		privs[i] = w;
+	}
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# %u threads with %u eventfds each on %s"
+		       " for %u secs\n\n", nthreads, nfds,
+		       multiq ? "per-thread epoll instances" :
+		       "a shared epoll instance", runtime);
+
+	threads = bench_threads_start(nthreads, worker, privs);
+	gettimeofday(&start, NULL);
+	bench_threads_run(runtime);
+	bench_threads_join(threads, nthreads);
+	gettimeofday(&stop, NULL);
+	timersub(&stop, &start, &diff);
+
+	bench_threads_print("events", threads, nthreads,
+			    diff.tv_sec + diff.tv_usec / 1000000.0);
+
+	for (i = 0; i < nthreads; i++) {
+		for (j = 0; j < nfds; j++)
+			close(workers[i].fds[j]);
+		free(workers[i].fds);
+		if (multiq)
+			close(workers[i].epfd);
+	}
+	if (!multiq)
+		close(shared_epfd);
+	free(workers);
+	free(privs);
+	free(threads);
+	return 0;
+}
@@ -0,0 +1,115 @@
+/*
+ * futex-hash.c
+ *
+ * hash: Stress the futex hash table with FUTEX_WAIT calls that return
+ * immediately, from several threads at once.  Each call hashes the futex
+ * and takes its bucket lock, which is the part we want to measure.
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "bench.h"
+#include "futex.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+static unsigned int nthreads;
+static unsigned int nfutexes = 1024;
+static unsigned int runtime = 5;
+static bool fshared;
+static int futex_flag;
+
+static const struct option options[] = {
+	OPT_UINTEGER('t', "threads", &nthreads,
+		     "Specify number of threads (default: online CPUs)"),
+	OPT_UINTEGER('f', "futexes", &nfutexes,
+		     "Specify number of futexes per thread"),
+	OPT_UINTEGER('r', "runtime", &runtime,
+		     "Specify runtime in seconds"),
+	OPT_BOOLEAN('S', "shared", &fshared,
+		    "Use shared futexes instead of private ones"),
+	OPT_END()
+};
+
+static const char * const bench_futex_hash_usage[] = {
+	"perf bench futex hash <options>",
+	NULL
+};
+
+static void *worker(void *arg)
+{
+	struct bench_thread *t = arg;
+	u_int32_t *futexes = t->priv;
+	unsigned long ops = 0;
+	unsigned int i;
+	int ret;
+
+	bench_threads_wait_start();
+
+	while (!bench_done) {
+		/* the value never matches, so each call fails with EAGAIN
+		 * once the bucket has been looked up */
+		for (i = 0; i < nfutexes; i++, ops++) {
+			ret = futex_wait(&futexes[i], 1234, futex_flag);
+			if (ret == 0 || errno != EAGAIN)
+				die("futex_wait: %s\n", strerror(errno));
+		}
+	}
+
+	t->ops = ops;
+	return NULL;
+}
+
+int bench_futex_hash(int argc, const char **argv,
+		     const char *prefix __used)
+{
+	struct bench_thread *threads;
+	struct timeval start, stop, diff;
+	void **futexes;
+	unsigned int i;
+
+	argc = parse_options(argc, argv, options,
+			     bench_futex_hash_usage, 0);
+
+	if (!nthreads)
+		nthreads = bench_nr_cpus();
+	if (!nfutexes || !runtime)
+		usage_with_options(bench_futex_hash_usage, options);
+	futex_flag = fshared ? 0 : FUTEX_PRIVATE_FLAG;
+
+	futexes = zalloc(nthreads * sizeof(*futexes));
+	if (!futexes)
+		die("memory allocation failed\n");
+	for (i = 0; i < nthreads; i++) {
+		futexes[i] = zalloc(nfutexes * sizeof(u_int32_t));
+		if (!futexes[i])
+			die("memory allocation failed\n");
+	}
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# %u threads operating on %u %s futexes each"
+		       " for %u secs\n\n", nthreads, nfutexes,
+		       fshared ? "shared" : "private", runtime);
+
+	threads = bench_threads_start(nthreads, worker, futexes);
+	gettimeofday(&start, NULL);
+	bench_threads_run(runtime);
+	bench_threads_join(threads, nthreads);
+	gettimeofday(&stop, NULL);
+	timersub(&stop, &start, &diff);
+
+	bench_threads_print("ops", threads, nthreads,
+			    diff.tv_sec + diff.tv_usec / 1000000.0);
+
+	for (i = 0; i < nthreads; i++)
+		free(futexes[i]);
+	free(futexes);
+	free(threads);
+	return 0;
+}
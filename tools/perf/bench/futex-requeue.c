@@ -0,0 +1,135 @@
+/*
+ * futex-requeue.c
+ *
+ * requeue: Block a number of threads on one futex and measure how long
+ * it takes to move them all onto a second futex with FUTEX_CMP_REQUEUE,
+ * waking one per call, as a condition variable broadcast would.
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "bench.h"
+#include "futex.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <limits.h>
+#include <sys/time.h>
+
+static u_int32_t futex1, futex2;
+static unsigned int nthreads;
+static unsigned int nrequeue = 1;
+static unsigned int nrepeat = 10;
+static bool fshared;
+static int futex_flag;
+
+static const struct option options[] = {
+	OPT_UINTEGER('t', "threads", &nthreads,
+		     "Specify number of threads (default: online CPUs)"),
+	OPT_UINTEGER('q', "nrequeue", &nrequeue,
+		     "Specify number of threads to requeue per call"),
+	OPT_UINTEGER('r', "repeat", &nrepeat,
+		     "Specify number of times to repeat the run"),
+	OPT_BOOLEAN('S', "shared", &fshared,
+		    "Use shared futexes instead of private ones"),
+	OPT_END()
+};
+
+static const char * const bench_futex_requeue_usage[] = {
+	"perf bench futex requeue <options>",
+	NULL
+};
+
+static void *waiter(void *arg __used)
+{
+	bench_threads_wait_start();
+
+	while (futex_wait(&futex1, 0, futex_flag) && errno == EINTR)
+		;
+
+	return NULL;
+}
+
+int bench_futex_requeue(int argc, const char **argv,
+			const char *prefix __used)
+{
+	struct bench_thread *threads;
+	struct timeval start, stop, diff;
+	double usecs, total_usecs = 0.0;
+	unsigned int i, moved;
+	int ret;
+
+	argc = parse_options(argc, argv, options,
+			     bench_futex_requeue_usage, 0);
+
+	if (!nthreads)
+		nthreads = bench_nr_cpus();
+	if (!nrequeue || !nrepeat)
+		usage_with_options(bench_futex_requeue_usage, options);
+	futex_flag = fshared ? 0 : FUTEX_PRIVATE_FLAG;
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# Requeuing %u threads, %u at a time, on %s futexes"
+		       " (%u runs)\n\n", nthreads, nrequeue,
+		       fshared ? "shared" : "private", nrepeat);
+
+	for (i = 0; i < nrepeat; i++) {
+		threads = bench_threads_start(nthreads, waiter, NULL);
+		bench_threads_run(0);
+
+		/* give the waiters time to block in the kernel */
+		usleep(100000);
+
+		/* the return value counts both woken and requeued waiters */
+		moved = 0;
+		gettimeofday(&start, NULL);
+		while (moved < nthreads) {
+			ret = futex_cmp_requeue(&futex1, 0, &futex2, 1,
+						nrequeue, futex_flag);
+			if (ret < 0)
+				die("futex_cmp_requeue: %s\n", strerror(errno));
+			moved += ret;
+		}
+		gettimeofday(&stop, NULL);
+		timersub(&stop, &start, &diff);
+
+		/* everyone left now sleeps on futex2 */
+		futex_wake(&futex2, INT_MAX, futex_flag);
+		bench_threads_join(threads, nthreads);
+		free(threads);
+
+		usecs = diff.tv_sec * 1000000.0 + diff.tv_usec;
+		total_usecs += usecs;
+		if (bench_format == BENCH_FORMAT_DEFAULT)
+			printf(" [run %3u] requeued %u threads in %.3lf ms\n",
+			       i, nthreads, usecs / 1000.0);
+	}
+
+	usecs = total_usecs / nrepeat;
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf("\n %14.3lf ms average to requeue %u threads\n",
+		       usecs / 1000.0, nthreads);
+		printf(" %14.0lf requeues/sec\n",
+		       usecs ? nthreads / (usecs / 1000000.0) : 0.0);
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		printf("%u %.3lf\n", nthreads, usecs / 1000.0);
+		break;
+
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+
+	return 0;
+}
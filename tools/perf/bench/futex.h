@@ -0,0 +1,53 @@
+/*
+ * futex.h
+ *
+ * Thin wrappers around the futex system call for the futex suites
+ */
+
+#ifndef BENCH_FUTEX_H
+#define BENCH_FUTEX_H
+
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <linux/futex.h>
+
+#ifndef FUTEX_PRIVATE_FLAG
+#define FUTEX_PRIVATE_FLAG	128
+#endif
+
+static inline int
+futex_syscall(u_int32_t *uaddr, int op, u_int32_t val, void *timeout,
+	      u_int32_t *uaddr2, u_int32_t val3, int opflags)
+{
+	return syscall(__NR_futex, uaddr, op | opflags, val, timeout,
+		       uaddr2, val3);
+}
+
+static inline int
+futex_wait(u_int32_t *uaddr, u_int32_t val, int opflags)
+{
+	return futex_syscall(uaddr, FUTEX_WAIT, val, NULL, NULL, 0, opflags);
+}
+
+static inline int
+futex_wake(u_int32_t *uaddr, int nr_wake, int opflags)
+{
+	return futex_syscall(uaddr, FUTEX_WAKE, nr_wake, NULL, NULL, 0,
+			     opflags);
+}
+
+/*
+ * Wake nr_wake waiters on uaddr and move up to nr_requeue of the rest to
+ * uaddr2, provided *uaddr still equals val.  The requeue count is passed
+ * in the timeout slot, as the kernel expects.
+ */
+static inline int
+futex_cmp_requeue(u_int32_t *uaddr, u_int32_t val, u_int32_t *uaddr2,
+		  int nr_wake, int nr_requeue, int opflags)
+{
+	return futex_syscall(uaddr, FUTEX_CMP_REQUEUE, nr_wake,
+			     (void *)(long)nr_requeue, uaddr2, val, opflags);
+}
+
+#endif /* BENCH_FUTEX_H */
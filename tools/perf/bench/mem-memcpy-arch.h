@@ -10,3 +10,14 @@
 
 #endif
 
+
+#ifdef ARCH_ARM
+
+#define MEMCPY_FN(fn, name, desc)		\
+	extern void *fn(void *, const void *, size_t);
+
+#include "mem-memcpy-arm-asm-def.h"
+
+#undef MEMCPY_FN
+
+#endif
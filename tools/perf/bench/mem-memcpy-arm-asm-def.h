@@ -0,0 +1,4 @@
+
+MEMCPY_FN(__memcpy,
+	"arm",
+	"memcpy() in arch/arm/lib/memcpy.S")
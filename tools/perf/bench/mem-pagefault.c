@@ -0,0 +1,108 @@
+/*
+ * mem-pagefault.c
+ *
+ * page-fault: Threads repeatedly touch every page of a private anonymous
+ * region and drop it again with MADV_DONTNEED, so that each touch takes
+ * a fresh page fault.  The regions are separate but share one mm, so
+ * the threads contend on mmap_sem and the page table locks.
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/mman.h>
+
+static unsigned int nthreads;
+static const char *size_str = "1MB";
+static unsigned int runtime = 5;
+static size_t region_size;
+static size_t page_size;
+
+static const struct option options[] = {
+	OPT_UINTEGER('t', "threads", &nthreads,
+		     "Specify number of threads (default: online CPUs)"),
+	OPT_STRING('l', "length", &size_str, "1MB",
+		   "Specify size of the region each thread faults in"
+		   " (default: 1MB)"),
+	OPT_UINTEGER('r', "runtime", &runtime,
+		     "Specify runtime in seconds"),
+	OPT_END()
+};
+
+static const char * const bench_mem_pagefault_usage[] = {
+	"perf bench mem page-fault <options>",
+	NULL
+};
+
+static void *worker(void *arg)
+{
+	struct bench_thread *t = arg;
+	char *region;
+	unsigned long ops = 0;
+	size_t off;
+
+	region = mmap(NULL, region_size, PROT_READ | PROT_WRITE,
+		      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (region == MAP_FAILED)
+		die("mmap: %s\n", strerror(errno));
+
+	bench_threads_wait_start();
+
+	while (!bench_done) {
+		for (off = 0; off < region_size; off += page_size, ops++)
+			region[off] = 1;
+		if (madvise(region, region_size, MADV_DONTNEED))
+			die("madvise: %s\n", strerror(errno));
+	}
+
+	munmap(region, region_size);
+	t->ops = ops;
+	return NULL;
+}
+
+int bench_mem_pagefault(int argc, const char **argv,
+			const char *prefix __used)
+{
+	struct bench_thread *threads;
+	struct timeval start, stop, diff;
+	s64 len;
+
+	argc = parse_options(argc, argv, options,
+			     bench_mem_pagefault_usage, 0);
+
+	if (!nthreads)
+		nthreads = bench_nr_cpus();
+	len = perf_atoll((char *)size_str);
+	if (len <= 0 || !runtime) {
+		fprintf(stderr, "Invalid length:%s\n", size_str);
+		return 1;
+	}
+	page_size = sysconf(_SC_PAGESIZE);
+	region_size = (len + page_size - 1) & ~(page_size - 1);
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# %u threads faulting %s each for %u secs\n\n",
+		       nthreads, size_str, runtime);
+
+	threads = bench_threads_start(nthreads, worker, NULL);
+	gettimeofday(&start, NULL);
+	bench_threads_run(runtime);
+	bench_threads_join(threads, nthreads);
+	gettimeofday(&stop, NULL);
+	timersub(&stop, &start, &diff);
+
+	bench_threads_print("faults", threads, nthreads,
+			    diff.tv_sec + diff.tv_usec / 1000000.0);
+
+	free(threads);
+	return 0;
+}
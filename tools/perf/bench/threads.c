@@ -0,0 +1,140 @@
+/*
+ * threads.c
+ *
+ * Thread start-up, timing and reporting shared by the multi-threaded
+ * suites (futex, epoll, mem page-fault and mmap)
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+volatile int bench_done;
+
+static pthread_mutex_t start_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t start_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t ready_cond = PTHREAD_COND_INITIALIZER;
+static unsigned int nr_ready;
+static int started;
+
+unsigned int bench_nr_cpus(void)
+{
+	long nr = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return nr > 0 ? nr : 1;
+}
+
+/*
+ * Called by each worker before its measured loop: blocks until every
+ * worker has been created so that they all start together.
+ */
+void bench_threads_wait_start(void)
+{
+	pthread_mutex_lock(&start_lock);
+	nr_ready++;
+	pthread_cond_signal(&ready_cond);
+	while (!started)
+		pthread_cond_wait(&start_cond, &start_lock);
+	pthread_mutex_unlock(&start_lock);
+}
+
+/*
+ * Create nr workers running fn, each passed its struct bench_thread.
+ * Returns once all of them are waiting in bench_threads_wait_start().
+ */
+struct bench_thread *bench_threads_start(unsigned int nr,
+					 void *(*fn)(void *),
+					 void **privs)
+{
+	struct bench_thread *threads;
+	unsigned int i;
+
+	if (posix_memalign((void **)&threads, 64, nr * sizeof(*threads)))
+		die("memory allocation failed\n");
+
+	bench_done = 0;
+	started = 0;
+	nr_ready = 0;
+
+	for (i = 0; i < nr; i++) {
+		threads[i].id = i;
+		threads[i].ops = 0;
+		threads[i].priv = privs ? privs[i] : NULL;
+		if (pthread_create(&threads[i].thread, NULL, fn, &threads[i]))
+			die("pthread_create failed\n");
+	}
+
+	pthread_mutex_lock(&start_lock);
+	while (nr_ready < nr)
+		pthread_cond_wait(&ready_cond, &start_lock);
+	pthread_mutex_unlock(&start_lock);
+
+	return threads;
+}
+
+/*
+ * Release the workers, let them run for the given number of seconds
+ * (if non-zero) and tell them to stop.
+ */
+void bench_threads_run(unsigned int seconds)
+{
+	pthread_mutex_lock(&start_lock);
+	started = 1;
+	pthread_cond_broadcast(&start_cond);
+	pthread_mutex_unlock(&start_lock);
+
+	if (seconds) {
+		sleep(seconds);
+		bench_done = 1;
+	}
+}
+
+void bench_threads_join(struct bench_thread *threads, unsigned int nr)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr; i++)
+		if (pthread_join(threads[i].thread, NULL))
+			die("pthread_join failed\n");
+}
+
+/*
+ * Print per-thread and aggregate operation rates for a run of secs
+ * seconds.
+ */
+void bench_threads_print(const char *what, struct bench_thread *threads,
+			 unsigned int nr, double secs)
+{
+	unsigned long total = 0;
+	unsigned int i;
+
+	for (i = 0; i < nr; i++)
+		total += threads[i].ops;
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		for (i = 0; i < nr; i++)
+			printf(" [thread %3u] %14.0lf %s/sec\n", i,
+			       (double)threads[i].ops / secs, what);
+		printf("\n %14.0lf %s/sec total (%u threads)\n",
+		       (double)total / secs, what, nr);
+		printf(" %14.0lf %s/sec per thread\n",
+		       (double)total / secs / nr, what);
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		printf("%u %.0lf\n", nr, (double)total / secs);
+		break;
+
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+}
@@ -13,6 +13,8 @@
  * Available subsystem list:
  *  sched ... scheduler and IPC mechanism
  *  mem   ... memory access performance
+ *  futex ... futex hashing, wakeup and requeue
+ *  epoll ... epoll event delivery and control
  *
  */
 
@@ -52,6 +54,41 @@ static struct bench_suite mem_suites[] = {
 	{ "memcpy",
 	  "Simple memory copy in various ways",
 	  bench_mem_memcpy },
+	{ "page-fault",
+	  "Page fault scaling with multiple threads",
+	  bench_mem_pagefault },
+	{ "mmap",
+	  "mmap()/munmap() scaling with multiple threads",
+	  bench_mem_mmap },
+	suite_all,
+	{ NULL,
+	  NULL,
+	  NULL             }
+};
+
+static struct bench_suite futex_suites[] = {
+	{ "hash",
+	  "Futex hash table scaling with multiple threads",
+	  bench_futex_hash },
+	{ "wake",
+	  "Wake up threads blocked on a futex",
+	  bench_futex_wake },
+	{ "requeue",
+	  "Requeue threads from one futex to another",
+	  bench_futex_requeue },
+	suite_all,
+	{ NULL,
+	  NULL,
+	  NULL             }
+};
+
+static struct bench_suite epoll_suites[] = {
+	{ "wait",
+	  "epoll_wait() event delivery with multiple threads",
+	  bench_epoll_wait },
+	{ "ctl",
+	  "Contended epoll_ctl() ADD/MOD/DEL",
+	  bench_epoll_ctl },
 	suite_all,
 	{ NULL,
 	  NULL,
@@ -71,6 +108,12 @@ static struct bench_subsys subsystems[] = {
 	{ "mem",
 	  "memory access performance",
 	  mem_suites },
+	{ "futex",
+	  "futex hashing, wakeup and requeue",
+	  futex_suites },
+	{ "epoll",
+	  "epoll event delivery and control",
+	  epoll_suites },
 	{ "all",		/* sentinel: easy for help */
 	  "test all subsystem (pseudo subsystem)",
 	  NULL },
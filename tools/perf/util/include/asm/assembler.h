@@ -0,0 +1,30 @@
+
+#ifndef PERF_ASM_ASSEMBLER_H
+#define PERF_ASM_ASSEMBLER_H
+
+/* assembler.h ... dummy header file for including arch/arm/lib/memcpy.S */
+
+#ifndef __ARMEB__
+#define pull		lsr
+#define push		lsl
+#else
+#define pull		lsl
+#define push		lsr
+#endif
+
+#if defined(__ARM_ARCH_5__) || defined(__ARM_ARCH_5T__) ||	\
+	defined(__ARM_ARCH_5E__) || defined(__ARM_ARCH_5TE__) ||	\
+	defined(__ARM_ARCH_5TEJ__) || defined(__ARM_ARCH_6__) ||	\
+	defined(__ARM_ARCH_6J__) || defined(__ARM_ARCH_6K__) ||	\
+	defined(__ARM_ARCH_6Z__) || defined(__ARM_ARCH_6ZK__) ||	\
+	defined(__ARM_ARCH_7A__)
+#define PLD(code...)	code
+#else
+#define PLD(code...)
+#endif
+
+#define CALGN(code...)
+
+#define W(instr)	instr
+
+#endif	/* PERF_ASM_ASSEMBLER_H */